@@ -522,7 +522,8 @@ e_source_backend_summary_setup_get_indexed_fields (ESourceBackendSummarySetup *e
  * be used for #E_BOOK_QUERY_BEGINS_WITH queries. An #E_BOOK_INDEX_SUFFIX index
  * will be constructed efficiently for suffix matching and will be used for
  * #E_BOOK_QUERY_ENDS_WITH queries. Similar an #E_BOOK_INDEX_PHONE index will optimize
- * #E_BOOK_QUERY_EQUALS_PHONE_NUMBER searches.
+ * #E_BOOK_QUERY_EQUALS_PHONE_NUMBER searches and an #E_BOOK_INDEX_SUBSTRING index
+ * will optimize #E_BOOK_QUERY_CONTAINS searches.
  *
  * <note><para>The specified indexed fields must also be a part of the summary, any indexed fields
  * specified that are not already a part of the summary will be ignored.</para></note>
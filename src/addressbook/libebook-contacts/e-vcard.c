@@ -165,6 +165,7 @@ static EVCardAttribute *e_vcard_attribute_ref (EVCardAttribute *attr);
 static void e_vcard_attribute_unref (EVCardAttribute *attr);
 static EVCardAttributeParam *e_vcard_attribute_param_ref (EVCardAttributeParam *param);
 static void e_vcard_attribute_param_unref (EVCardAttributeParam *param);
+static void cache_version_from_attr (EVCard *self, EVCardAttribute *attr);
 
 /* Encoding used in v-card
  * Note: v-card spec defines additional 7BIT 8BIT and X- encoding
@@ -178,6 +179,8 @@ typedef enum {
 struct _EVCardPrivate {
 	GList *attributes;
 	gchar *vcard;
+	gchar *serialized; /* pre-parsed attributes of the vcard, as returned by e_vcard_serialize() */
+	GHashTable *attributes_index; /* upper-case name ~> first EVCardAttribute * with it */
 	EVCardVersion version;
 };
 
@@ -218,6 +221,8 @@ vcard_finalize (GObject *object)
 		priv->attributes, (GDestroyNotify) e_vcard_attribute_free);
 
 	g_free (priv->vcard);
+	g_free (priv->serialized);
+	g_clear_pointer (&priv->attributes_index, g_hash_table_unref);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_vcard_parent_class)->finalize (object);
@@ -763,6 +768,323 @@ read_attribute_params (EVCardAttribute *attr,
 	*p = lp;
 }
 
+/* The fast path of the parser. It handles the common attributes of the vCards
+ * in the form written by the e_vcard_to_string() and by most of the other
+ * producers, which means without quoted-printable, charset conversion,
+ * quoted parameter values or any of the broken constructs the read_attribute()
+ * is forgiving about. It works on whole lines, found with strcspn() and memchr(),
+ * instead of one character at a time, and copies the line only when it is folded.
+ * Any time it finds something it is not sure about it gives up, leaving
+ * the line to the read_attribute(), thus both return the same results. */
+
+#define is_name_char(_chr) ((_chr) == '-' || (_chr) == '_' || g_ascii_isalnum (_chr))
+
+static gboolean
+fast_is_name (const gchar *ptr,
+	      const gchar *end)
+{
+	if (ptr >= end)
+		return FALSE;
+
+	for (; ptr < end; ptr++) {
+		if (!is_name_char (*ptr))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+fast_equal (const gchar *ptr,
+	    const gchar *end,
+	    const gchar *str)
+{
+	gsize len = strlen (str);
+
+	return (gsize) (end - ptr) == len && g_ascii_strncasecmp (ptr, str, len) == 0;
+}
+
+/* Reads the comma-separated parameter values between @ptr and @end;
+ * the @first_is_name means the first value is a bare parameter */
+static GList *
+fast_read_param_values (const gchar *ptr,
+			const gchar *end,
+			gboolean first_is_name)
+{
+	GList *values = NULL;
+
+	while (ptr <= end) {
+		const gchar *value_end;
+
+		value_end = memchr (ptr, ',', end - ptr);
+		if (!value_end)
+			value_end = end;
+
+		/* the parser either ignores or interprets the empty values and an '=' in the value */
+		if (value_end == ptr || memchr (ptr, '=', value_end - ptr) ||
+		    (first_is_name && !values && !fast_is_name (ptr, value_end))) {
+			g_list_free_full (values, g_free);
+			return NULL;
+		}
+
+		values = g_list_prepend (values, g_strndup (ptr, value_end - ptr));
+		ptr = value_end + 1;
+	}
+
+	return g_list_reverse (values);
+}
+
+static gboolean
+fast_read_params (EVCardAttribute *attr,
+		  const gchar *ptr,
+		  const gchar *end)
+{
+	while (ptr < end) {
+		EVCardAttributeParam *param;
+		const gchar *token_end, *eq;
+		GList *values;
+
+		token_end = memchr (ptr, ';', end - ptr);
+		if (!token_end)
+			token_end = end;
+
+		/* an empty parameter is skipped */
+		if (token_end == ptr) {
+			ptr++;
+			continue;
+		}
+
+		eq = memchr (ptr, '=', token_end - ptr);
+		if (eq) {
+			if (!fast_is_name (ptr, eq))
+				return FALSE;
+
+			values = fast_read_param_values (eq + 1, token_end, FALSE);
+			if (!values)
+				return FALSE;
+
+			/* leave the encoding and charset conversions on the read_attribute() */
+			if ((fast_equal (ptr, eq, "ENCODING") && !g_ascii_strcasecmp (values->data, "quoted-printable")) ||
+			    (fast_equal (ptr, eq, "CHARSET") && g_ascii_strcasecmp (values->data, "utf-8") != 0)) {
+				g_list_free_full (values, g_free);
+				return FALSE;
+			}
+
+			param = g_slice_new (EVCardAttributeParam);
+			param->ref_count = 1;
+			param->name = g_strndup (ptr, eq - ptr);
+			param->values = values;
+		} else {
+			values = fast_read_param_values (ptr, token_end, TRUE);
+			if (!values)
+				return FALSE;
+
+			/* the parser interprets these bare parameters */
+			if (!g_ascii_strcasecmp (values->data, "quoted-printable") ||
+			    (!g_ascii_strcasecmp (values->data, "base64") && values->next)) {
+				g_list_free_full (values, g_free);
+				return FALSE;
+			}
+
+			param = g_slice_new (EVCardAttributeParam);
+			param->ref_count = 1;
+
+			if (!g_ascii_strcasecmp (values->data, "base64")) {
+				param->name = g_strdup ("ENCODING");
+				g_free (values->data);
+				values->data = g_strdup ("b");
+			} else {
+				param->name = g_strdup ("TYPE");
+			}
+
+			param->values = values;
+		}
+
+		e_vcard_attribute_add_param (attr, param);
+
+		ptr = token_end + 1;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+fast_read_values (EVCardAttribute *attr,
+		  const gchar *ptr,
+		  const gchar *end)
+{
+	GList *values = NULL;
+	gboolean split_semicolon, split_comma;
+
+	split_semicolon = !e_vcard_attribute_is_singlevalue_type (attr);
+	split_comma = !g_ascii_strcasecmp (attr->name, EVC_CATEGORIES);
+
+	if (!memchr (ptr, '\\', end - ptr)) {
+		/* nothing to unescape, the values can be copied directly */
+		for (;;) {
+			const gchar *value_end = NULL;
+
+			if (split_comma) {
+				for (value_end = ptr; value_end < end; value_end++) {
+					if (*value_end == ',' || (*value_end == ';' && split_semicolon))
+						break;
+				}
+			} else if (split_semicolon) {
+				value_end = memchr (ptr, ';', end - ptr);
+			}
+
+			if (!value_end)
+				value_end = end;
+
+			values = g_list_prepend (values, g_strndup (ptr, value_end - ptr));
+
+			if (value_end >= end)
+				break;
+
+			ptr = value_end + 1;
+		}
+	} else {
+		gchar *buffer, *out;
+
+		buffer = g_malloc (end - ptr + 1);
+		out = buffer;
+
+		for (; ptr < end; ptr++) {
+			if (*ptr == '\\') {
+				/* the parser reads the line end after the backslash */
+				if (ptr + 1 >= end) {
+					g_list_free_full (values, g_free);
+					g_free (buffer);
+					return FALSE;
+				}
+
+				ptr++;
+
+				switch (*ptr) {
+				case 'n': *out++ = '\n'; break;
+				case 'N': *out++ = '\n'; break;
+				case 'r': *out++ = '\r'; break;
+				case 'R': *out++ = '\r'; break;
+				case ';': *out++ = ';'; break;
+				case ',': *out++ = ','; break;
+				case '\\': *out++ = '\\'; break;
+				default:
+					*out++ = '\\';
+					*out++ = *ptr;
+					break;
+				}
+			} else if ((*ptr == ';' && split_semicolon) ||
+				   (*ptr == ',' && split_comma)) {
+				values = g_list_prepend (values, g_strndup (buffer, out - buffer));
+				out = buffer;
+			} else {
+				*out++ = *ptr;
+			}
+		}
+
+		values = g_list_prepend (values, g_strndup (buffer, out - buffer));
+
+		g_free (buffer);
+	}
+
+	attr->values = g_list_concat (attr->values, g_list_reverse (values));
+
+	return TRUE;
+}
+
+/* Parses one unfolded line of the @len bytes */
+static EVCardAttribute *
+fast_read_line (const gchar *line,
+		gsize len)
+{
+	EVCardAttribute *attr;
+	const gchar *end = line + len, *colon, *ptr, *name_start;
+	gchar *attr_group = NULL;
+
+	colon = memchr (line, ':', len);
+	if (!colon || memchr (line, '"', colon - line) ||
+	    !g_utf8_validate (line, len, NULL))
+		return NULL;
+
+	for (ptr = line; ptr < colon && is_name_char (*ptr); ptr++) {
+		/* just find the end of the name */
+	}
+
+	name_start = line;
+
+	if (ptr < colon && *ptr == '.' && ptr > line) {
+		attr_group = g_strndup (line, ptr - line);
+
+		name_start = ptr + 1;
+		for (ptr = name_start; ptr < colon && is_name_char (*ptr); ptr++) {
+			/* just find the end of the name */
+		}
+	}
+
+	if (ptr == name_start || (ptr < colon && *ptr != ';')) {
+		g_free (attr_group);
+		return NULL;
+	}
+
+	/* This consumes (takes) both strings */
+	attr = e_vcard_attribute_new_take (attr_group, g_strndup (name_start, ptr - name_start));
+
+	if ((*ptr == ';' && !fast_read_params (attr, ptr + 1, colon)) ||
+	    !fast_read_values (attr, colon + 1, end)) {
+		e_vcard_attribute_free (attr);
+		return NULL;
+	}
+
+	return attr;
+}
+
+/* Returns FALSE when the attribute at @p should be read by the read_attribute() */
+static gboolean
+fast_read_attribute (const gchar **p,
+		     EVCardAttribute **out_attr)
+{
+	EVCardAttribute *attr;
+	const gchar *line = *p, *line_end, *next;
+	GString *unfolded = NULL;
+	gsize len;
+
+	len = strcspn (line, "\r\n");
+	line_end = line + len;
+	next = skip_newline (line_end, FALSE);
+
+	while (next != line_end) {
+		if (!unfolded)
+			unfolded = g_string_new_len (line, len);
+
+		len = strcspn (next, "\r\n");
+		g_string_append_len (unfolded, next, len);
+
+		line_end = next + len;
+		next = skip_newline (line_end, FALSE);
+	}
+
+	if (unfolded) {
+		attr = fast_read_line (unfolded->str, unfolded->len);
+		g_string_free (unfolded, TRUE);
+	} else {
+		attr = fast_read_line (line, len);
+	}
+
+	if (!attr)
+		return FALSE;
+
+	/* the same as skip_to_next_line() */
+	while (*line_end == '\r' || *line_end == '\n')
+		line_end++;
+
+	*p = line_end;
+	*out_attr = attr;
+
+	return TRUE;
+}
+
+#undef is_name_char
+
 /* reads an entire attribute from the input buffer, leaving p pointing
  * at the start of the next line (past the \r\n) */
 static EVCardAttribute *
@@ -776,6 +1098,9 @@ read_attribute (const gchar **p)
 	gboolean is_qp = FALSE;
 	gchar *charset = NULL;
 
+	if (fast_read_attribute (p, &attr))
+		return attr;
+
 	/* first read in the group/name */
 	str = g_string_sized_new (16);
 	for (lp = skip_newline ( *p, is_qp);
@@ -937,18 +1262,377 @@ parse (EVCard *evc,
 	evc->priv->attributes = g_list_reverse (evc->priv->attributes);
 }
 
+/* The serialized form of the attributes is a plain text, thus it can be
+ * stored in the same way as the vCard itself. It begins with the E_VCARD_SERIALIZED_MAGIC,
+ * followed by the attributes, each of them written as:
+ *
+ *    group name flags n-params [param-name n-values value...]... n-values value...
+ *
+ * where the strings are written as "<length>:<bytes>" (a NULL group as "-")
+ * and the numbers as "<number>:". The values are stored already unfolded
+ * and unescaped, thus reading them back is only about copying the strings.
+ *
+ * The binary values (like an inline PHOTO or LOGO) are not stored, to not have
+ * them twice; such attributes have the E_VCARD_SERIALIZED_IN_VCARD flag, with
+ * no parameters and no values, and they are read from the vCard string instead. */
+#define E_VCARD_SERIALIZED_MAGIC "EVCS1:"
+#define E_VCARD_SERIALIZED_ENCODING_SET 0x10
+#define E_VCARD_SERIALIZED_IN_VCARD 0x20
+
+typedef struct _SerializedReader {
+	const gchar *ptr;
+	const gchar *end;
+	const gchar *vcard; /* where to look for the next E_VCARD_SERIALIZED_IN_VCARD attribute */
+} SerializedReader;
+
+static gboolean
+serialized_attribute_is_binary (EVCardAttribute *attr)
+{
+	const gchar *value;
+
+	if (attr->encoding == EVC_ENCODING_BASE64)
+		return TRUE;
+
+	value = attr->values ? attr->values->data : NULL;
+
+	return value && g_ascii_strncasecmp (value, "data:", 5) == 0;
+}
+
+/* Finds the next binary attribute of the @group and the @name in the vCard string;
+ * only the lines beginning with the name are read, which is much cheaper than
+ * to parse the whole vCard. */
+static EVCardAttribute *
+serialized_read_from_vcard (SerializedReader *reader,
+			    const gchar *group,
+			    const gchar *name)
+{
+	const gchar *line = reader->vcard;
+	gsize group_len = group ? strlen (group) : 0;
+	gsize name_len = strlen (name);
+
+	while (line && *line && g_ascii_strncasecmp (line, "END:", 4) != 0) {
+		const gchar *ptr = line;
+
+		if (group) {
+			if (g_ascii_strncasecmp (ptr, group, group_len) == 0 && ptr[group_len] == '.')
+				ptr += group_len + 1;
+			else
+				ptr = NULL;
+		}
+
+		if (ptr && g_ascii_strncasecmp (ptr, name, name_len) == 0 &&
+		    (ptr[name_len] == ':' || ptr[name_len] == ';')) {
+			EVCardAttribute *attr;
+
+			/* leaves the 'line' at the start of the next line */
+			attr = read_attribute (&line);
+
+			if (attr && g_strcmp0 (attr->group, group) == 0 &&
+			    g_strcmp0 (attr->name, name) == 0 &&
+			    serialized_attribute_is_binary (attr)) {
+				reader->vcard = line;
+				return attr;
+			}
+
+			if (attr)
+				e_vcard_attribute_free (attr);
+		} else {
+			line = strchr (line, '\n');
+			if (line)
+				line++;
+		}
+	}
+
+	return NULL;
+}
+
+static gboolean
+serialized_read_number (SerializedReader *reader,
+			guint *out_number)
+{
+	guint64 number = 0;
+	const gchar *ptr;
+
+	for (ptr = reader->ptr; ptr < reader->end && g_ascii_isdigit (*ptr); ptr++) {
+		number = (number * 10) + (*ptr - '0');
+
+		if (number > G_MAXINT32)
+			return FALSE;
+	}
+
+	if (ptr == reader->ptr || ptr >= reader->end || *ptr != ':')
+		return FALSE;
+
+	reader->ptr = ptr + 1;
+	*out_number = (guint) number;
+
+	return TRUE;
+}
+
+static gboolean
+serialized_read_string (SerializedReader *reader,
+			gboolean allow_null,
+			gchar **out_string)
+{
+	guint len;
+
+	if (allow_null && reader->ptr < reader->end && *reader->ptr == '-') {
+		reader->ptr++;
+		*out_string = NULL;
+
+		return TRUE;
+	}
+
+	if (!serialized_read_number (reader, &len) ||
+	    (gsize) len > (gsize) (reader->end - reader->ptr))
+		return FALSE;
+
+	*out_string = g_strndup (reader->ptr, len);
+	reader->ptr += len;
+
+	return TRUE;
+}
+
+static gboolean
+serialized_read_values (SerializedReader *reader,
+			GList **out_values)
+{
+	GList *values = NULL;
+	guint ii, n_values;
+
+	if (!serialized_read_number (reader, &n_values))
+		return FALSE;
+
+	for (ii = 0; ii < n_values; ii++) {
+		gchar *value;
+
+		if (!serialized_read_string (reader, FALSE, &value)) {
+			g_list_free_full (values, g_free);
+			return FALSE;
+		}
+
+		values = g_list_prepend (values, value);
+	}
+
+	*out_values = g_list_reverse (values);
+
+	return TRUE;
+}
+
+static EVCardAttribute *
+serialized_read_attribute (SerializedReader *reader)
+{
+	EVCardAttribute *attr;
+	gchar *attr_group = NULL, *attr_name = NULL;
+	guint ii, flags = 0, n_params = 0;
+
+	if (!serialized_read_string (reader, TRUE, &attr_group))
+		return NULL;
+
+	if (!serialized_read_string (reader, FALSE, &attr_name) ||
+	    !serialized_read_number (reader, &flags) ||
+	    !serialized_read_number (reader, &n_params)) {
+		g_free (attr_group);
+		g_free (attr_name);
+		return NULL;
+	}
+
+	if ((flags & E_VCARD_SERIALIZED_IN_VCARD) != 0) {
+		guint n_values = 0;
+
+		if (!n_params &&
+		    serialized_read_number (reader, &n_values) &&
+		    !n_values)
+			attr = serialized_read_from_vcard (reader, attr_group, attr_name);
+		else
+			attr = NULL;
+
+		g_free (attr_group);
+		g_free (attr_name);
+
+		return attr;
+	}
+
+	/* This consumes (takes) both strings */
+	attr = e_vcard_attribute_new_take (attr_group, attr_name);
+	attr->encoding = flags & ~E_VCARD_SERIALIZED_ENCODING_SET;
+	attr->encoding_set = (flags & E_VCARD_SERIALIZED_ENCODING_SET) != 0;
+
+	if (attr->encoding > EVC_ENCODING_QP) {
+		e_vcard_attribute_free (attr);
+		return NULL;
+	}
+
+	for (ii = 0; ii < n_params; ii++) {
+		EVCardAttributeParam *param;
+		gchar *param_name = NULL;
+
+		if (!serialized_read_string (reader, FALSE, &param_name)) {
+			e_vcard_attribute_free (attr);
+			return NULL;
+		}
+
+		param = g_slice_new (EVCardAttributeParam);
+		param->ref_count = 1;
+		param->name = param_name;
+		param->values = NULL;
+
+		/* the parameters are already merged and in the right order */
+		attr->params = g_list_prepend (attr->params, param);
+
+		if (!serialized_read_values (reader, &param->values)) {
+			e_vcard_attribute_free (attr);
+			return NULL;
+		}
+	}
+
+	attr->params = g_list_reverse (attr->params);
+
+	if (!serialized_read_values (reader, &attr->values)) {
+		e_vcard_attribute_free (attr);
+		return NULL;
+	}
+
+	return attr;
+}
+
+/* Returns FALSE when the @serialized is not valid, in which case
+ * the attributes of the @evc are left untouched. The @vcs is the vCard
+ * string the @serialized had been created from. */
+static gboolean
+deserialize (EVCard *evc,
+	     const gchar *serialized,
+	     const gchar *vcs,
+	     gboolean ignore_uid)
+{
+	SerializedReader reader;
+	GList *attrs = NULL, *link;
+
+	if (!g_str_has_prefix (serialized, E_VCARD_SERIALIZED_MAGIC))
+		return FALSE;
+
+	reader.ptr = serialized + strlen (E_VCARD_SERIALIZED_MAGIC);
+	reader.end = reader.ptr + strlen (reader.ptr);
+	reader.vcard = vcs;
+
+	while (reader.ptr < reader.end) {
+		EVCardAttribute *attr;
+
+		attr = serialized_read_attribute (&reader);
+		if (!attr) {
+			g_list_free_full (attrs, (GDestroyNotify) e_vcard_attribute_free);
+			return FALSE;
+		}
+
+		if (ignore_uid && g_ascii_strcasecmp (attr->name, EVC_UID) == 0) {
+			e_vcard_attribute_free (attr);
+			continue;
+		}
+
+		attrs = g_list_prepend (attrs, attr);
+	}
+
+	attrs = g_list_reverse (attrs);
+
+	evc->priv->version = E_VCARD_VERSION_UNKNOWN;
+
+	for (link = attrs; link; link = g_list_next (link)) {
+		cache_version_from_attr (evc, link->data);
+	}
+
+	evc->priv->attributes = g_list_concat (evc->priv->attributes, attrs);
+
+	return TRUE;
+}
+
+/* The index is keyed by upper-case copies of the names, owned by the index;
+ * the names are not interned, because they come from the vCards, which can
+ * have any X- attributes, and the interned strings are never freed. */
+static void
+e_vcard_index_add (EVCard *evc,
+		   EVCardAttribute *attr,
+		   gboolean replace)
+{
+	gchar *key;
+
+	key = g_ascii_strup (attr->name, -1);
+
+	/* the passed-in key is freed when it's already in the index */
+	if (replace || !g_hash_table_contains (evc->priv->attributes_index, key))
+		g_hash_table_insert (evc->priv->attributes_index, key, attr);
+	else
+		g_free (key);
+}
+
+static void
+e_vcard_clear_index (EVCard *evc)
+{
+	g_clear_pointer (&evc->priv->attributes_index, g_hash_table_unref);
+}
+
+/* Expects the attributes being parsed already */
+static EVCardAttribute *
+e_vcard_lookup_index (EVCard *evc,
+		      const gchar *name)
+{
+	EVCardAttribute *attr;
+	gchar buffer[64], *tmp = NULL;
+	const gchar *key = name;
+	gsize ii;
+
+	if (!evc->priv->attributes_index) {
+		GList *link;
+
+		evc->priv->attributes_index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+		for (link = evc->priv->attributes; link; link = g_list_next (link)) {
+			e_vcard_index_add (evc, link->data, FALSE);
+		}
+	}
+
+	for (ii = 0; name[ii] && !g_ascii_islower (name[ii]); ii++) {
+		/* the names are usually upper-case already */
+	}
+
+	if (name[ii]) {
+		gsize len = ii + strlen (name + ii);
+
+		if (len < sizeof (buffer)) {
+			for (ii = 0; ii <= len; ii++) {
+				buffer[ii] = g_ascii_toupper (name[ii]);
+			}
+
+			key = buffer;
+		} else {
+			tmp = g_ascii_strup (name, len);
+			key = tmp;
+		}
+	}
+
+	attr = g_hash_table_lookup (evc->priv->attributes_index, key);
+
+	g_free (tmp);
+
+	return attr;
+}
+
 static GList *
 e_vcard_ensure_attributes (EVCard *evc)
 {
 	if (evc->priv->vcard) {
 		gboolean have_uid = (evc->priv->attributes != NULL);
 		gchar *vcs = evc->priv->vcard;
+		gchar *serialized = evc->priv->serialized;
 
 		/* detach vCard to avoid loops */
 		evc->priv->vcard = NULL;
+		evc->priv->serialized = NULL;
+
+		/* Read the pre-parsed attributes, if available, or parse the vCard */
+		if (!serialized || !deserialize (evc, serialized, vcs, have_uid))
+			parse (evc, vcs, have_uid);
 
-		/* Parse the vCard */
-		parse (evc, vcs, have_uid);
+		g_free (serialized);
 		g_free (vcs);
 	}
 
@@ -1144,6 +1828,7 @@ e_vcard_construct_full (EVCard *evc,
 	g_return_if_fail (evc->priv->attributes == NULL);
 
 	evc->priv->version = E_VCARD_VERSION_UNKNOWN;
+	e_vcard_clear_index (evc);
 
 	/* Lazy construction */
 	if (*str) {
@@ -1165,6 +1850,122 @@ e_vcard_construct_full (EVCard *evc,
 	}
 }
 
+/**
+ * e_vcard_construct_serialized:
+ * @evc: an existing #EVCard
+ * @str: a vCard string
+ * @serialized: (nullable): attributes of the @str, as returned by e_vcard_serialize(), or %NULL
+ * @uid: (nullable): a unique ID string
+ *
+ * Similar to e_vcard_construct_with_uid(), only when the attributes of the @evc
+ * are needed, they are read from the @serialized, instead of parsing
+ * the @str, which is considerably faster. The @serialized should be
+ * the result of the e_vcard_serialize() called on an #EVCard with the @str.
+ * When the @serialized is %NULL or not valid, the @str is parsed
+ * as usual.
+ *
+ * This modifies @evc.
+ *
+ * Since: 3.62
+ **/
+void
+e_vcard_construct_serialized (EVCard *evc,
+			      const gchar *str,
+			      const gchar *serialized,
+			      const gchar *uid)
+{
+	g_return_if_fail (E_IS_VCARD (evc));
+	g_return_if_fail (str != NULL);
+
+	e_vcard_construct_full (evc, str, -1, uid);
+
+	if (evc->priv->vcard && serialized && *serialized)
+		evc->priv->serialized = g_strdup (serialized);
+}
+
+static void
+serialized_append_string (GString *str,
+			  const gchar *value)
+{
+	gsize len = value ? strlen (value) : 0;
+
+	g_string_append_printf (str, "%" G_GSIZE_FORMAT ":", len);
+	g_string_append_len (str, value, len);
+}
+
+static void
+serialized_append_values (GString *str,
+			  GList *values)
+{
+	GList *link;
+
+	g_string_append_printf (str, "%u:", g_list_length (values));
+
+	for (link = values; link; link = g_list_next (link)) {
+		serialized_append_string (str, link->data);
+	}
+}
+
+/**
+ * e_vcard_serialize:
+ * @self: an #EVCard
+ *
+ * Serializes the parsed attributes of the @self into a string,
+ * which can be passed to e_vcard_construct_serialized() later,
+ * together with the vCard string of the @self, to avoid parsing
+ * of the vCard string. The returned string contains only
+ * the attributes; it is not a vCard and it's not meant to be read
+ * in any other way. The binary values, like an inline photo, are
+ * not part of it, they are read from the vCard string instead.
+ *
+ * Returns: (transfer full): a newly allocated string with serialized attributes
+ *    of the @self. Free it with g_free(), when no longer needed.
+ *
+ * Since: 3.62
+ **/
+gchar *
+e_vcard_serialize (EVCard *self)
+{
+	GString *str;
+	GList *link;
+
+	g_return_val_if_fail (E_IS_VCARD (self), NULL);
+
+	str = g_string_sized_new (1024);
+	g_string_append (str, E_VCARD_SERIALIZED_MAGIC);
+
+	for (link = e_vcard_ensure_attributes (self); link; link = g_list_next (link)) {
+		EVCardAttribute *attr = link->data;
+		GList *plink;
+
+		if (attr->group)
+			serialized_append_string (str, attr->group);
+		else
+			g_string_append_c (str, '-');
+
+		serialized_append_string (str, attr->name);
+
+		if (serialized_attribute_is_binary (attr)) {
+			g_string_append_printf (str, "%u:0:0:", E_VCARD_SERIALIZED_IN_VCARD);
+			continue;
+		}
+
+		g_string_append_printf (str, "%u:%u:", attr->encoding | (attr->encoding_set ? E_VCARD_SERIALIZED_ENCODING_SET : 0),
+			g_list_length (attr->params));
+
+		for (plink = attr->params; plink; plink = g_list_next (plink)) {
+			EVCardAttributeParam *param = plink->data;
+
+			serialized_append_string (str, param->name);
+			serialized_append_values (str, param->values);
+		}
+
+		serialized_append_values (str, attr->values);
+	}
+
+	return g_string_free (str, FALSE);
+}
+
 /**
  * e_vcard_new:
  *
@@ -1864,6 +2665,7 @@ e_vcard_convert_to_generic (EVCard *self,
 	g_clear_pointer (&evc_prop, g_hash_table_destroy);
 
 	converted->priv->attributes = g_list_reverse (converted->priv->attributes);
+	e_vcard_clear_index (converted);
 
 	return converted;
 }
@@ -2778,6 +3580,9 @@ e_vcard_foreach_remove (EVCard *self,
 		link = next;
 	}
 
+	if (n_removed)
+		e_vcard_clear_index (self);
+
 	return n_removed;
 }
 
@@ -2981,6 +3786,7 @@ e_vcard_remove_attribute (EVCard *evc,
 	 * already been called if this is a valid call and attr is among
 	 * our attributes. */
 	evc->priv->attributes = g_list_remove (evc->priv->attributes, attr);
+	e_vcard_clear_index (evc);
 	e_vcard_attribute_free (attr);
 }
 
@@ -3021,6 +3827,10 @@ e_vcard_append_attribute (EVCard *evc,
 	} else {
 		evc->priv->attributes = g_list_append (e_vcard_ensure_attributes (evc), attr);
 		cache_version_from_attr (evc, attr);
+
+		/* the first attribute of the name is still the same */
+		if (evc->priv->attributes_index)
+			e_vcard_index_add (evc, attr, FALSE);
 	}
 }
 
@@ -3172,6 +3982,8 @@ e_vcard_append_attributes_take (EVCard *self,
 
 	link = e_vcard_ensure_attributes (self);
 	self->priv->attributes = g_list_concat (link, attrs);
+
+	e_vcard_clear_index (self);
 }
 
 /**
@@ -3196,6 +4008,10 @@ e_vcard_add_attribute (EVCard *evc,
 	} else {
 		evc->priv->attributes = g_list_prepend (e_vcard_ensure_attributes (evc), attr);
 		cache_version_from_attr (evc, attr);
+
+		/* the added attribute is the first of its name now */
+		if (evc->priv->attributes_index)
+			e_vcard_index_add (evc, attr, TRUE);
 	}
 }
 
@@ -3890,10 +4706,8 @@ e_vcard_get_attributes (EVCard *evcard)
  * other <code>TEL</code> attributes if a contact has multiple telephone
  * numbers), use e_vcard_get_attributes() and iterate over the list searching
  * for matching attributes.</para>
- * <para>This method iterates over all attributes in the #EVCard, so should not
- * be called often. If extracting a large number of attributes from a vCard, it
- * is more efficient to iterate once over the list returned by
- * e_vcard_get_attributes().</para></note>
+ * <para>The first call builds an index of the attributes by their names,
+ * which is used by the next calls, until the attributes of the @evc change.</para></note>
  *
  * Returns: (transfer none) (nullable): An #EVCardAttribute if found, or %NULL.
  **/
@@ -3917,13 +4731,10 @@ e_vcard_get_attribute (EVCard *evc,
 	}
 
 	attrs = e_vcard_ensure_attributes (evc);
-	for (l = attrs; l; l = l->next) {
-		attr = (EVCardAttribute *) l->data;
-		if (g_ascii_strcasecmp (attr->name, name) == 0)
-			return attr;
-	}
+	if (!attrs)
+		return NULL;
 
-	return NULL;
+	return e_vcard_lookup_index (evc, name);
 }
 
 typedef struct _AttrsByNameData {
@@ -4003,6 +4814,9 @@ e_vcard_get_attribute_if_parsed (EVCard *evc,
 	g_return_val_if_fail (E_IS_VCARD (evc), NULL);
 	g_return_val_if_fail (name != NULL, NULL);
 
+	if (!evc->priv->vcard && evc->priv->attributes)
+		return e_vcard_lookup_index (evc, name);
+
 	for (l = evc->priv->attributes; l != NULL; l = l->next) {
 		attr = (EVCardAttribute *) l->data;
 		if (g_ascii_strcasecmp (attr->name, name) == 0)
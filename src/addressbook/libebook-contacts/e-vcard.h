@@ -289,7 +289,12 @@ void		e_vcard_construct_full		(EVCard *evc,
 						 const gchar *str,
 						 gssize len,
 						 const gchar *uid);
+void		e_vcard_construct_serialized	(EVCard *evc,
+						 const gchar *str,
+						 const gchar *serialized,
+						 const gchar *uid);
 gboolean	e_vcard_is_parsed		(EVCard *evc);
+gchar *		e_vcard_serialize		(EVCard *self);
 
 gchar *		e_vcard_to_string		(EVCard *self);
 EVCardVersion	e_vcard_get_version		(EVCard *self);
@@ -86,8 +86,21 @@
 #define EBC_COLUMN_EXTRA	"bdata"
 #define EBC_COLUMN_CUSTOM_FLAGS	"custom_flags"
 
+/* The attributes of the stored vCard, as returned by e_vcard_serialize(),
+   to not need to parse the vCard when constructing an EContact */
+#define EBC_COLUMN_SERIALIZED	"serialized"
+
 #define EBC_TABLE_CATEGORIES	"categories"
 
+/* The full-text index of the fields with the E_BOOK_INDEX_SUBSTRING index;
+   its rowid is the 'id' of the contact in the EBC_TABLE_SUBSTRINGS_UIDS */
+#define EBC_TABLE_SUBSTRINGS		"substrings"
+#define EBC_TABLE_SUBSTRINGS_UIDS	"substrings_uids"
+#define EBC_KEY_SUBSTRING_FIELDS	"substring_fields"
+
+/* Shorter values cannot be searched for with the trigram tokenizer */
+#define EBC_SUBSTRING_MIN_LENGTH	3
+
 typedef struct {
 	EContactField field_id;		/* The EContact field */
 	GType type;			/* The GType (only support string or gboolean) */
@@ -119,6 +132,8 @@ struct _EBookCachePrivate {
 	ECollator *collator;		/* The ECollator to create sort keys for any sortable fields */
 
 	ECacheKeys *categories_table;
+
+	gboolean substrings_enabled;	/* Whether the EBC_TABLE_SUBSTRINGS is used */
 };
 
 enum {
@@ -566,6 +581,47 @@ ebc_regexp (sqlite3_context *context,
 	}
 }
 
+/* The @serialized can be NULL, like for the rows stored before the column was added */
+static EContact *
+ebc_new_contact (EBookCache *book_cache,
+		 const gchar *vcard,
+		 const gchar *serialized,
+		 const gchar *uid)
+{
+	EContact *contact;
+	gchar *decompressed = NULL;
+
+	if (e_cache_object_is_compressed (serialized)) {
+		decompressed = e_cache_decompress_object (E_CACHE (book_cache), serialized);
+		serialized = decompressed;
+	}
+
+	contact = e_contact_new ();
+	e_vcard_construct_serialized (E_VCARD (contact), vcard, serialized, uid);
+
+	g_free (decompressed);
+
+	return contact;
+}
+
+/* The serialized attributes are compressed like the vCard itself, the ECache
+   does not know about the column, thus it's decompressed in the ebc_new_contact()
+   and recompressed in the e_book_cache_recompress_columns_locked() */
+static void
+ebc_take_serialized_column (EBookCache *book_cache,
+			    ECacheColumnValues *other_columns,
+			    EContact *contact)
+{
+	gchar *serialized;
+
+	serialized = e_vcard_serialize (E_VCARD (contact));
+
+	e_cache_column_values_take_value (other_columns, EBC_COLUMN_SERIALIZED,
+		e_cache_compress_object (E_CACHE (book_cache), serialized));
+
+	g_free (serialized);
+}
+
 /* Implementation of EBC_FUNC_COMPARE_VCARD (fallback for non-summary queries) */
 static void
 ebc_compare_vcard (sqlite3_context *context,
@@ -573,8 +629,8 @@ ebc_compare_vcard (sqlite3_context *context,
 		   sqlite3_value **argv)
 {
 	EBookBackendSExp *sexp = NULL;
+	EContact *contact;
 	const gchar *text;
-	const gchar *vcard;
 
 	/* Reuse the same sexp for all queries with the same search expression */
 	sexp = sqlite3_get_auxdata (context, 0);
@@ -598,25 +654,28 @@ ebc_compare_vcard (sqlite3_context *context,
 
 	}
 
-	/* Reuse the same vcard as much as possible (it can be referred to more than
+	/* Reuse the same contact as much as possible (it can be referred to more than
 	 * once in the query, so it can be reused for multiple comparisons on the same row)
 	 */
-	vcard = sqlite3_get_auxdata (context, 1);
-	if (!vcard) {
+	contact = sqlite3_get_auxdata (context, 1);
+	if (!contact) {
+		const gchar *vcard;
+
 		vcard = (const gchar *) sqlite3_value_text (argv[1]);
 
-		if (vcard)
-			sqlite3_set_auxdata (context, 1, g_strdup (vcard), g_free);
-	}
+		/* A NULL vcard can never match */
+		if (!vcard || !*vcard) {
+			sqlite3_result_int (context, 0);
+			return;
+		}
 
-	/* A NULL vcard can never match */
-	if (!vcard || !*vcard) {
-		sqlite3_result_int (context, 0);
-		return;
+		contact = ebc_new_contact (sqlite3_user_data (context), vcard, (const gchar *) sqlite3_value_text (argv[2]), NULL);
+
+		sqlite3_set_auxdata (context, 1, contact, g_object_unref);
 	}
 
-	/* Compare this vcard */
-	if (e_book_backend_sexp_match_vcard (sexp, vcard))
+	/* Compare this contact */
+	if (e_book_backend_sexp_match_contact (sexp, contact))
 		sqlite3_result_int (context, 1);
 	else
 		sqlite3_result_int (context, 0);
@@ -747,7 +806,7 @@ typedef struct {
 
 static EBCCustomFuncTab ebc_custom_functions[] = {
 	{ "regexp",                  ebc_regexp,           2 }, /* regexp (expression, column_data) */
-	{ EBC_FUNC_COMPARE_VCARD,    ebc_compare_vcard,    2 }, /* compare_vcard (sexp, vcard) */
+	{ EBC_FUNC_COMPARE_VCARD,    ebc_compare_vcard,    3 }, /* compare_vcard (sexp, vcard, serialized) */
 	{ EBC_FUNC_EQPHONE_EXACT,    ebc_eqphone_exact,    2 }, /* eqphone_exact (search_input, column_data) */
 	{ EBC_FUNC_EQPHONE_NATIONAL, ebc_eqphone_national, 2 }, /* eqphone_national (search_input, column_data) */
 	{ EBC_FUNC_EQPHONE_SHORT,    ebc_eqphone_short,    2 }, /* eqphone_short (search_input, column_data) */
@@ -1046,68 +1105,77 @@ ebc_run_multi_insert_one (ECache *cache,
 			  GCancellable *cancellable,
                           GError **error)
 {
-	GString *stmt, *values;
-	gchar *normal;
-	gboolean success;
+	GString *stmt, *params;
+	ECacheStmt *prepared;
+	gchar *normal, *reverse = NULL, *phone = NULL;
+	gint country_code = 0;
+	gboolean success = FALSE;
 
 	g_return_val_if_fail (E_IS_BOOK_CACHE (cache), FALSE);
 	g_return_val_if_fail (field != NULL, FALSE);
 	g_return_val_if_fail (uid != NULL, FALSE);
 
 	stmt = g_string_sized_new (INSERT_MULTI_STMT_BYTES);
-	values = g_string_sized_new (INSERT_MULTI_STMT_BYTES);
+	params = g_string_sized_new (INSERT_MULTI_STMT_BYTES);
 
 	normal = e_util_utf8_normalize (value);
 
+	/* The values are bound as parameters, thus the statement is prepared
+	   only once for each auxiliary table */
 	e_cache_sqlite_stmt_append_printf (stmt, "INSERT INTO %Q (uid, value", field->aux_table);
+	g_string_append (params, "?, ?");
 
 	if ((field->index & INDEX_FLAG (SUFFIX)) != 0) {
 		g_string_append (stmt, ", value_" EBC_SUFFIX_REVERSE);
+		g_string_append (params, ", ?");
 
-		if (normal) {
-			gchar *str;
-
-			str = g_utf8_strreverse (normal, -1);
-
-			e_cache_sqlite_stmt_append_printf (values, ", %Q", str);
-
-			g_free (str);
-		} else {
-			g_string_append (values, ", NULL");
-		}
+		if (normal)
+			reverse = g_utf8_strreverse (normal, -1);
 	}
 
 	if ((field->index & INDEX_FLAG (PHONE)) != 0) {
 		EBookCache *book_cache;
-		gint country_code = 0;
-		gchar *str;
 
 		g_string_append (stmt, ", value_" EBC_SUFFIX_PHONE);
 		g_string_append (stmt, ", value_" EBC_SUFFIX_COUNTRY);
+		g_string_append (params, ", ?, ?");
 
 		book_cache = E_BOOK_CACHE (cache);
-		str = convert_phone (normal, book_cache->priv->region_code, &country_code);
-		str = remove_leading_zeros (str);
+		phone = convert_phone (normal, book_cache->priv->region_code, &country_code);
+		phone = remove_leading_zeros (phone);
+	}
 
-		if (str) {
-			e_cache_sqlite_stmt_append_printf (values, ", %Q", str);
-		} else {
-			g_string_append (values, ",NULL");
-		}
+	g_string_append (stmt, ") VALUES (");
+	g_string_append (stmt, params->str);
+	g_string_append_c (stmt, ')');
 
-		g_string_append_printf (values, ",%d", country_code);
-	}
+	e_cache_lock (cache, E_CACHE_LOCK_WRITE);
 
-	e_cache_sqlite_stmt_append_printf (stmt, ") VALUES (%Q, %Q", uid, normal);
-	g_free (normal);
+	prepared = e_cache_stmt_prepare (cache, stmt->str, error);
+	if (prepared) {
+		gint index = 1;
 
-	g_string_append (stmt, values->str);
-	g_string_append_c (stmt, ')');
+		e_cache_stmt_bind_text (prepared, index++, uid);
+		e_cache_stmt_bind_text (prepared, index++, normal);
+
+		if ((field->index & INDEX_FLAG (SUFFIX)) != 0)
+			e_cache_stmt_bind_text (prepared, index++, reverse);
 
-	success = e_cache_sqlite_exec (cache, stmt->str, cancellable, error);
+		if ((field->index & INDEX_FLAG (PHONE)) != 0) {
+			e_cache_stmt_bind_text (prepared, index++, phone);
+			e_cache_stmt_bind_int (prepared, index++, country_code);
+		}
+
+		success = e_cache_stmt_exec (cache, prepared, cancellable, error);
+	}
+
+	e_cache_unlock (cache, success ? E_CACHE_UNLOCK_COMMIT : E_CACHE_UNLOCK_ROLLBACK);
 
 	g_string_free (stmt, TRUE);
-	g_string_free (values, TRUE);
+	g_string_free (params, TRUE);
+	g_free (normal);
+	g_free (reverse);
+	g_free (phone);
 
 	return success;
 }
@@ -1149,6 +1217,7 @@ ebc_run_multi_delete (ECache *cache,
 		      GCancellable *cancellable,
 		      GError **error)
 {
+	ECacheStmt *prepared;
 	gchar *stmt;
 	gboolean success;
 
@@ -1156,13 +1225,314 @@ ebc_run_multi_delete (ECache *cache,
 	g_return_val_if_fail (field != NULL, FALSE);
 	g_return_val_if_fail (uid != NULL, FALSE);
 
-	stmt = e_cache_sqlite_stmt_printf ("DELETE FROM %Q WHERE uid=%Q", field->aux_table, uid);
-	success = e_cache_sqlite_exec (cache, stmt, cancellable, error);
+	stmt = e_cache_sqlite_stmt_printf ("DELETE FROM %Q WHERE uid=?", field->aux_table);
+
+	e_cache_lock (cache, E_CACHE_LOCK_WRITE);
+
+	prepared = e_cache_stmt_prepare (cache, stmt, error);
+	success = prepared != NULL;
+
+	if (success) {
+		e_cache_stmt_bind_text (prepared, 1, uid);
+		success = e_cache_stmt_exec (cache, prepared, cancellable, error);
+	}
+
+	e_cache_unlock (cache, success ? E_CACHE_UNLOCK_COMMIT : E_CACHE_UNLOCK_ROLLBACK);
+
 	e_cache_sqlite_stmt_free (stmt);
 
 	return success;
 }
 
+static gboolean
+ebc_field_has_substring_index (SummaryField *field)
+{
+	return (field->index & INDEX_FLAG (SUBSTRING)) != 0 &&
+		(field->type == G_TYPE_STRING || field->type == E_TYPE_CONTACT_ATTR_LIST);
+}
+
+/* Returns comma-separated column names of the EBC_TABLE_SUBSTRINGS,
+   or %NULL, when no field has the substring index */
+static gchar *
+ebc_dup_substring_columns (EBookCache *book_cache)
+{
+	GString *columns = NULL;
+	gint ii;
+
+	for (ii = 0; ii < book_cache->priv->n_summary_fields; ii++) {
+		SummaryField *field = &(book_cache->priv->summary_fields[ii]);
+
+		if (!ebc_field_has_substring_index (field))
+			continue;
+
+		if (columns)
+			g_string_append_c (columns, ',');
+		else
+			columns = g_string_new ("");
+
+		g_string_append (columns, field->dbname);
+	}
+
+	return columns ? g_string_free (columns, FALSE) : NULL;
+}
+
+static gboolean
+ebc_substrings_remove (ECache *cache,
+		       const gchar *uid,
+		       GCancellable *cancellable,
+		       GError **error)
+{
+	ECacheStmt *prepared;
+	gboolean success = TRUE;
+
+	e_cache_lock (cache, E_CACHE_LOCK_WRITE);
+
+	prepared = e_cache_stmt_prepare (cache, "DELETE FROM " EBC_TABLE_SUBSTRINGS " WHERE rowid IN ("
+		"SELECT id FROM " EBC_TABLE_SUBSTRINGS_UIDS " WHERE uid=?)", error);
+	if (prepared) {
+		e_cache_stmt_bind_text (prepared, 1, uid);
+		success = e_cache_stmt_exec (cache, prepared, cancellable, error);
+	} else {
+		success = FALSE;
+	}
+
+	if (success) {
+		prepared = e_cache_stmt_prepare (cache, "DELETE FROM " EBC_TABLE_SUBSTRINGS_UIDS " WHERE uid=?", error);
+		if (prepared) {
+			e_cache_stmt_bind_text (prepared, 1, uid);
+			success = e_cache_stmt_exec (cache, prepared, cancellable, error);
+		} else {
+			success = FALSE;
+		}
+	}
+
+	e_cache_unlock (cache, success ? E_CACHE_UNLOCK_COMMIT : E_CACHE_UNLOCK_ROLLBACK);
+
+	return success;
+}
+
+static gboolean
+ebc_substrings_put (ECache *cache,
+		    const gchar *uid,
+		    EContact *contact,
+		    GCancellable *cancellable,
+		    GError **error)
+{
+	EBookCache *book_cache;
+	ECacheStmt *prepared;
+	GPtrArray *values;
+	GString *stmt, *params;
+	gboolean success;
+	gint ii;
+
+	book_cache = E_BOOK_CACHE (cache);
+
+	values = g_ptr_array_new_with_free_func (g_free);
+	stmt = g_string_sized_new (INSERT_MULTI_STMT_BYTES);
+	params = g_string_sized_new (INSERT_MULTI_STMT_BYTES);
+
+	g_string_append (stmt, "INSERT INTO " EBC_TABLE_SUBSTRINGS " (rowid");
+
+	for (ii = 0; ii < book_cache->priv->n_summary_fields; ii++) {
+		SummaryField *field = &(book_cache->priv->summary_fields[ii]);
+
+		if (!ebc_field_has_substring_index (field))
+			continue;
+
+		g_string_append_c (stmt, ',');
+		g_string_append (stmt, field->dbname);
+		g_string_append (params, ",?");
+
+		if (field->type == E_TYPE_CONTACT_ATTR_LIST) {
+			GList *attr_values, *link;
+			GString *joined = NULL;
+
+			attr_values = e_contact_get (contact, field->field_id);
+
+			for (link = attr_values; link; link = g_list_next (link)) {
+				gchar *normal = e_util_utf8_normalize (link->data);
+
+				if (!normal || !*normal) {
+					g_free (normal);
+					continue;
+				}
+
+				if (joined) {
+					g_string_append_c (joined, '\n');
+					g_string_append (joined, normal);
+				} else {
+					joined = g_string_new (normal);
+				}
+
+				g_free (normal);
+			}
+
+			e_contact_attr_list_free (attr_values);
+
+			g_ptr_array_add (values, joined ? g_string_free (joined, FALSE) : NULL);
+		} else {
+			gchar *val = e_contact_get (contact, field->field_id);
+
+			g_ptr_array_add (values, e_util_utf8_normalize (val));
+
+			g_free (val);
+		}
+	}
+
+	g_string_append (stmt, ") SELECT id");
+	g_string_append (stmt, params->str);
+	g_string_append (stmt, " FROM " EBC_TABLE_SUBSTRINGS_UIDS " WHERE uid=?");
+
+	e_cache_lock (cache, E_CACHE_LOCK_WRITE);
+
+	prepared = e_cache_stmt_prepare (cache, "DELETE FROM " EBC_TABLE_SUBSTRINGS " WHERE rowid IN ("
+		"SELECT id FROM " EBC_TABLE_SUBSTRINGS_UIDS " WHERE uid=?)", error);
+	if (prepared) {
+		e_cache_stmt_bind_text (prepared, 1, uid);
+		success = e_cache_stmt_exec (cache, prepared, cancellable, error);
+	} else {
+		success = FALSE;
+	}
+
+	/* The id is kept for the existing uid */
+	if (success) {
+		prepared = e_cache_stmt_prepare (cache, "INSERT OR IGNORE INTO " EBC_TABLE_SUBSTRINGS_UIDS " (uid) VALUES (?)", error);
+		if (prepared) {
+			e_cache_stmt_bind_text (prepared, 1, uid);
+			success = e_cache_stmt_exec (cache, prepared, cancellable, error);
+		} else {
+			success = FALSE;
+		}
+	}
+
+	if (success) {
+		prepared = e_cache_stmt_prepare (cache, stmt->str, error);
+		if (prepared) {
+			guint jj;
+
+			for (jj = 0; jj < values->len; jj++) {
+				e_cache_stmt_bind_text (prepared, jj + 1, values->pdata[jj]);
+			}
+
+			e_cache_stmt_bind_text (prepared, jj + 1, uid);
+
+			success = e_cache_stmt_exec (cache, prepared, cancellable, error);
+		} else {
+			success = FALSE;
+		}
+	}
+
+	e_cache_unlock (cache, success ? E_CACHE_UNLOCK_COMMIT : E_CACHE_UNLOCK_ROLLBACK);
+
+	g_ptr_array_unref (values);
+	g_string_free (stmt, TRUE);
+	g_string_free (params, TRUE);
+
+	return success;
+}
+
+typedef struct _SubstringsPopulateData {
+	GCancellable *cancellable;
+	GError **error;
+	gboolean success;
+} SubstringsPopulateData;
+
+static gboolean
+ebc_substrings_populate_cb (ECache *cache,
+			    const gchar *uid,
+			    const gchar *revision,
+			    const gchar *object,
+			    EOfflineState offline_state,
+			    gint ncols,
+			    const gchar *column_names[],
+			    const gchar *column_values[],
+			    gpointer user_data)
+{
+	SubstringsPopulateData *spd = user_data;
+	EContact *contact;
+
+	contact = e_contact_new_from_vcard_with_uid (object, uid);
+
+	/* Ignore broken rows */
+	if (!contact)
+		return TRUE;
+
+	spd->success = ebc_substrings_put (cache, uid, contact, spd->cancellable, spd->error);
+
+	g_object_unref (contact);
+
+	return spd->success;
+}
+
+/* Called with the lock held and inside a transaction */
+static gboolean
+ebc_init_substrings (EBookCache *book_cache,
+		     GCancellable *cancellable,
+		     GError **error)
+{
+	ECache *cache = E_CACHE (book_cache);
+	gchar *columns, *stored_columns;
+	gboolean success = TRUE;
+
+	columns = ebc_dup_substring_columns (book_cache);
+	stored_columns = e_cache_dup_key (cache, EBC_KEY_SUBSTRING_FIELDS, NULL);
+
+	if (stored_columns && !*stored_columns)
+		g_clear_pointer (&stored_columns, g_free);
+
+	if (g_strcmp0 (columns, stored_columns) != 0) {
+		/* The set of the indexed fields changed, build the index from scratch */
+		success = e_cache_sqlite_exec (cache, "DROP TABLE IF EXISTS " EBC_TABLE_SUBSTRINGS, cancellable, error) &&
+			e_cache_sqlite_exec (cache, "DROP TABLE IF EXISTS " EBC_TABLE_SUBSTRINGS_UIDS, cancellable, error) &&
+			e_cache_set_key (cache, EBC_KEY_SUBSTRING_FIELDS, NULL, error);
+
+		if (success && columns) {
+			GError *local_error = NULL;
+			gchar *stmt;
+
+			/* The values are normalized, thus the case sensitive search gives
+			   the same results as the LIKE on the summary columns */
+			stmt = e_cache_sqlite_stmt_printf ("CREATE VIRTUAL TABLE " EBC_TABLE_SUBSTRINGS
+				" USING fts5 (%s, tokenize='trigram case_sensitive 1')", columns);
+
+			if (e_cache_sqlite_exec (cache, stmt, cancellable, &local_error)) {
+				SubstringsPopulateData spd;
+
+				success = e_cache_sqlite_exec (cache, "CREATE TABLE " EBC_TABLE_SUBSTRINGS_UIDS
+					" (id INTEGER PRIMARY KEY, uid TEXT NOT NULL UNIQUE)", cancellable, error);
+
+				spd.cancellable = cancellable;
+				spd.error = error;
+				spd.success = TRUE;
+
+				book_cache->priv->substrings_enabled = success;
+
+				success = success && e_cache_foreach (cache, E_CACHE_EXCLUDE_DELETED, NULL,
+					ebc_substrings_populate_cb, &spd, cancellable, error) && spd.success;
+
+				success = success && e_cache_set_key (cache, EBC_KEY_SUBSTRING_FIELDS, columns, error);
+			} else {
+				/* Older SQLite or one without FTS5; the contains queries use LIKE then */
+				g_warning ("%s: Cannot create substring index for '%s', using slower search instead: %s",
+					G_STRFUNC, e_cache_get_filename (cache), local_error ? local_error->message : "Unknown error");
+				g_clear_error (&local_error);
+			}
+
+			e_cache_sqlite_stmt_free (stmt);
+		}
+	} else if (columns) {
+		book_cache->priv->substrings_enabled = TRUE;
+	}
+
+	if (!success)
+		book_cache->priv->substrings_enabled = FALSE;
+
+	g_free (stored_columns);
+	g_free (columns);
+
+	return success;
+}
+
 static gboolean
 ebc_update_aux_tables (ECache *cache,
 		       const gchar *uid,
@@ -1195,6 +1565,15 @@ ebc_update_aux_tables (ECache *cache,
 		success = success && ebc_run_multi_insert (cache, field, uid, contact, cancellable, error);
 	}
 
+	if (success && book_cache->priv->substrings_enabled) {
+		if (!contact) {
+			contact = e_contact_new_from_vcard_with_uid (object, uid);
+			success = contact != NULL;
+		}
+
+		success = success && ebc_substrings_put (cache, uid, contact, cancellable, error);
+	}
+
 	g_clear_object (&contact);
 
 	return success;
@@ -1224,6 +1603,9 @@ ebc_delete_from_aux_tables (ECache *cache,
 		success = success && ebc_run_multi_delete (cache, field, uid, cancellable, error);
 	}
 
+	if (success && book_cache->priv->substrings_enabled)
+		success = ebc_substrings_remove (cache, uid, cancellable, error);
+
 	return success;
 }
 
@@ -1257,6 +1639,31 @@ ebc_delete_from_aux_tables_offline_deleted (ECache *cache,
 		e_cache_sqlite_stmt_free (stmt);
 	}
 
+	if (success && book_cache->priv->substrings_enabled) {
+		gchar *stmt;
+
+		stmt = e_cache_sqlite_stmt_printf ("DELETE FROM " EBC_TABLE_SUBSTRINGS " WHERE rowid IN ("
+			"SELECT id FROM " EBC_TABLE_SUBSTRINGS_UIDS " WHERE uid IN ("
+			"SELECT " E_CACHE_COLUMN_UID " FROM " E_CACHE_TABLE_OBJECTS
+			" WHERE " E_CACHE_COLUMN_STATE "=%d))",
+			E_OFFLINE_STATE_LOCALLY_DELETED);
+
+		success = e_cache_sqlite_exec (cache, stmt, cancellable, error);
+
+		e_cache_sqlite_stmt_free (stmt);
+
+		if (success) {
+			stmt = e_cache_sqlite_stmt_printf ("DELETE FROM " EBC_TABLE_SUBSTRINGS_UIDS " WHERE uid IN ("
+				"SELECT " E_CACHE_COLUMN_UID " FROM " E_CACHE_TABLE_OBJECTS
+				" WHERE " E_CACHE_COLUMN_STATE "=%d)",
+				E_OFFLINE_STATE_LOCALLY_DELETED);
+
+			success = e_cache_sqlite_exec (cache, stmt, cancellable, error);
+
+			e_cache_sqlite_stmt_free (stmt);
+		}
+	}
+
 	return success;
 }
 
@@ -1285,6 +1692,11 @@ ebc_empty_aux_tables (ECache *cache,
 		e_cache_sqlite_stmt_free (stmt);
 	}
 
+	if (success && book_cache->priv->substrings_enabled) {
+		success = e_cache_sqlite_exec (cache, "DELETE FROM " EBC_TABLE_SUBSTRINGS, cancellable, error) &&
+			e_cache_sqlite_exec (cache, "DELETE FROM " EBC_TABLE_SUBSTRINGS_UIDS, cancellable, error);
+	}
+
 	if (success)
 		success = e_cache_keys_remove_all_sync (book_cache->priv->categories_table, cancellable, error);
 
@@ -1320,6 +1732,7 @@ ebc_upgrade_cb (ECache *cache,
 	other_columns = e_cache_column_values_new ();
 
 	ebc_fill_other_columns (E_BOOK_CACHE (cache), contact, other_columns);
+	ebc_take_serialized_column (E_BOOK_CACHE (cache), other_columns, contact);
 
 	g_clear_object (&contact);
 
@@ -2684,6 +3097,40 @@ field_test_query_contains (EBookCache *book_cache,
 		return;
 	}
 
+	if (book_cache->priv->substrings_enabled && ebc_field_has_substring_index (field)) {
+		gchar *normal;
+
+		normal = e_util_utf8_normalize (test->value);
+
+		if (normal && g_utf8_strlen (normal, -1) >= EBC_SUBSTRING_MIN_LENGTH) {
+			GString *phrase;
+			const gchar *ptr;
+
+			/* Search for the value as an FTS5 phrase, which
+			   matches it as a substring with the trigram tokenizer */
+			phrase = g_string_sized_new (strlen (normal) + 2);
+			g_string_append_c (phrase, '\"');
+			for (ptr = normal; *ptr; ptr++) {
+				if (*ptr == '\"')
+					g_string_append_c (phrase, '\"');
+				g_string_append_c (phrase, *ptr);
+			}
+			g_string_append_c (phrase, '\"');
+
+			e_cache_sqlite_stmt_append_printf (string,
+				"summary." E_CACHE_COLUMN_UID " IN (SELECT uid FROM " EBC_TABLE_SUBSTRINGS_UIDS
+				" WHERE id IN (SELECT rowid FROM " EBC_TABLE_SUBSTRINGS " WHERE " EBC_TABLE_SUBSTRINGS ".%s MATCH %Q))",
+				field->dbname, phrase->str);
+
+			g_string_free (phrase, TRUE);
+			g_free (normal);
+
+			return;
+		}
+
+		g_free (normal);
+	}
+
 	escaped = ebc_normalize_for_like (test, FALSE, &need_escape);
 
 	g_string_append_c (string, '(');
@@ -2955,7 +3402,7 @@ ebc_generate_constraints (EBookCache *book_cache,
 	if (constraints == NULL) {
 		e_cache_sqlite_stmt_append_printf (
 			string,
-			EBC_FUNC_COMPARE_VCARD " (%Q,summary." E_CACHE_COLUMN_OBJECT ")",
+			EBC_FUNC_COMPARE_VCARD " (%Q," E_CACHE_FUNC_OBJECT "(summary." E_CACHE_COLUMN_OBJECT "),summary." EBC_COLUMN_SERIALIZED ")",
 			sexp);
 		return;
 	}
@@ -3894,7 +4341,7 @@ ebc_cursor_format_equality (EBookCache *book_cache,
 
 		e_cache_sqlite_stmt_append_printf (string, "%c %Q", equality, value);
 	} else {
-		e_cache_sqlite_stmt_append_printf (string, "(summary." E_CACHE_COLUMN_OBJECT " %c %Q ", equality, value);
+		e_cache_sqlite_stmt_append_printf (string, "(" E_CACHE_FUNC_OBJECT "(summary." E_CACHE_COLUMN_OBJECT ") %c %Q ", equality, value);
 
 		g_string_append (string, "COLLATE " EBC_COLLATE_PREFIX);
 		g_string_append (string, e_contact_field_name (field_id));
@@ -4696,6 +5143,7 @@ e_book_cache_populate_other_columns (EBookCache *book_cache,
 
 	add_column (EBC_COLUMN_EXTRA, "TEXT", NULL);
 	add_column (EBC_COLUMN_CUSTOM_FLAGS, "INTEGER", NULL);
+	add_column (EBC_COLUMN_SERIALIZED, "TEXT", NULL);
 
 	use_default = !setup;
 
@@ -4798,6 +5246,58 @@ e_book_cache_populate_other_columns (EBookCache *book_cache,
 	return success;
 }
 
+static gint
+ebc_init_sqlite_functions (EBookCache *book_cache,
+			   sqlite3 *db)
+{
+	gint ii, sqret = SQLITE_OK;
+
+	/* Install our custom functions */
+	for (ii = 0; sqret == SQLITE_OK && ii < G_N_ELEMENTS (ebc_custom_functions); ii++) {
+		sqret = sqlite3_create_function (
+			db,
+			ebc_custom_functions[ii].name,
+			ebc_custom_functions[ii].arguments,
+			SQLITE_UTF8, book_cache,
+			ebc_custom_functions[ii].func,
+			NULL, NULL);
+	}
+
+	/* Fallback COLLATE implementations generated on demand */
+	if (sqret == SQLITE_OK)
+		sqret = sqlite3_collation_needed (db, book_cache, ebc_generate_collator);
+
+	return sqret;
+}
+
+static gboolean
+e_book_cache_init_connection (ECache *cache,
+			      gpointer sqlitedb,
+			      GError **error)
+{
+	gint sqret;
+
+	sqret = ebc_init_sqlite_functions (E_BOOK_CACHE (cache), sqlitedb);
+
+	if (sqret != SQLITE_OK) {
+		g_set_error (error, E_CACHE_ERROR, E_CACHE_ERROR_ENGINE,
+			_("Can’t open database %s: %s"), e_cache_get_filename (cache), sqlite3_errmsg (sqlitedb));
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+e_book_cache_recompress_columns_locked (ECache *cache,
+					gboolean compress,
+					GCancellable *cancellable,
+					GError **error)
+{
+	return e_cache_recompress_column_sync (cache, EBC_COLUMN_SERIALIZED, compress, cancellable, error);
+}
+
 static gboolean
 e_book_cache_initialize (EBookCache *book_cache,
 			 const gchar *filename,
@@ -4809,7 +5309,7 @@ e_book_cache_initialize (EBookCache *book_cache,
 	ECache *cache;
 	GSList *other_columns = NULL;
 	sqlite3 *db;
-	gint ii, sqret;
+	gint sqret;
 	gboolean success;
 
 	g_return_val_if_fail (E_IS_BOOK_CACHE (book_cache), FALSE);
@@ -4837,22 +5337,7 @@ e_book_cache_initialize (EBookCache *book_cache,
 	e_cache_lock (cache, E_CACHE_LOCK_WRITE);
 
 	db = e_cache_get_sqlitedb (cache);
-	sqret = SQLITE_OK;
-
-	/* Install our custom functions */
-	for (ii = 0; sqret == SQLITE_OK && ii < G_N_ELEMENTS (ebc_custom_functions); ii++) {
-		sqret = sqlite3_create_function (
-			db,
-			ebc_custom_functions[ii].name,
-			ebc_custom_functions[ii].arguments,
-			SQLITE_UTF8, book_cache,
-			ebc_custom_functions[ii].func,
-			NULL, NULL);
-	}
-
-	/* Fallback COLLATE implementations generated on demand */
-	if (sqret == SQLITE_OK)
-		sqret = sqlite3_collation_needed (db, book_cache, ebc_generate_collator);
+	sqret = ebc_init_sqlite_functions (book_cache, db);
 
 	if (sqret != SQLITE_OK) {
 		if (!db) {
@@ -4870,6 +5355,8 @@ e_book_cache_initialize (EBookCache *book_cache,
 
 	success = success && ebc_init_aux_tables (book_cache, cancellable, error);
 
+	success = success && ebc_init_substrings (book_cache, cancellable, error);
+
 	/* Check for data migration */
 	success = success && e_book_cache_migrate (cache, e_cache_get_version (cache), cancellable, error);
 
@@ -5234,7 +5721,7 @@ e_book_cache_put_contacts (EBookCache *book_cache,
 	const GSList *clink, *elink, *flink;
 	ECache *cache;
 	ECacheColumnValues *other_columns;
-	gboolean success;
+	gboolean success = TRUE;
 
 	g_return_val_if_fail (E_IS_BOOK_CACHE (book_cache), FALSE);
 	g_return_val_if_fail (contacts != NULL, FALSE);
@@ -5244,21 +5731,31 @@ e_book_cache_put_contacts (EBookCache *book_cache,
 	cache = E_CACHE (book_cache);
 	other_columns = e_cache_column_values_new ();
 
+	/* Each vCard is stored right after it's made, thus only one of them
+	   is held in memory at a time; the statements are prepared only once
+	   and the revision is changed only once for all the contacts */
 	e_cache_lock (cache, E_CACHE_LOCK_WRITE);
 	e_cache_freeze_revision_change (cache);
 
 	for (clink = contacts, elink = extras, flink = custom_flags;
-	     clink;
+	     clink && success;
 	     (clink = g_slist_next (clink)), (elink = g_slist_next (elink)), (flink = g_slist_next (flink))) {
 		EContact *contact = clink->data;
 		const gchar *extra = elink ? elink->data : NULL;
 		guint32 custom_flags_val = flink ? GPOINTER_TO_UINT (flink->data) : 0;
 		gchar *uid, *rev, *vcard;
 
-		g_return_val_if_fail (E_IS_CONTACT (contact), FALSE);
+		if (!E_IS_CONTACT (contact) || !(vcard = e_vcard_to_string (E_VCARD (contact)))) {
+			g_warn_if_reached ();
+			success = FALSE;
+			break;
+		}
 
-		vcard = e_vcard_to_string (E_VCARD (contact));
-		g_return_val_if_fail (vcard != NULL, FALSE);
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			g_free (vcard);
+			success = FALSE;
+			break;
+		}
 
 		e_cache_column_values_remove_all (other_columns);
 
@@ -5276,9 +5773,6 @@ e_book_cache_put_contacts (EBookCache *book_cache,
 		g_free (vcard);
 		g_free (rev);
 		g_free (uid);
-
-		if (!success)
-			break;
 	}
 
 	e_cache_thaw_revision_change (cache);
@@ -5414,6 +5908,7 @@ e_book_cache_get_contact (EBookCache *book_cache,
 			  GCancellable *cancellable,
 			  GError **error)
 {
+	ECacheColumnValues *other_columns = NULL;
 	gchar *vcard = NULL;
 
 	g_return_val_if_fail (E_IS_BOOK_CACHE (book_cache), FALSE);
@@ -5422,13 +5917,20 @@ e_book_cache_get_contact (EBookCache *book_cache,
 
 	*out_contact = NULL;
 
-	if (!e_book_cache_get_vcard (book_cache, uid, meta_contact, &vcard, cancellable, error) ||
-	    !vcard) {
-		return FALSE;
+	if (meta_contact) {
+		if (!e_book_cache_get_vcard (book_cache, uid, meta_contact, &vcard, cancellable, error) ||
+		    !vcard) {
+			return FALSE;
+		}
+	} else {
+		vcard = e_cache_get (E_CACHE (book_cache), uid, NULL, &other_columns, cancellable, error);
+		if (!vcard)
+			return FALSE;
 	}
 
-	*out_contact = e_contact_new_from_vcard_with_uid (vcard, uid);
+	*out_contact = ebc_new_contact (book_cache, vcard, other_columns ? e_cache_column_values_lookup (other_columns, EBC_COLUMN_SERIALIZED) : NULL, uid);
 
+	e_cache_column_values_free (other_columns);
 	g_free (vcard);
 
 	return TRUE;
@@ -6630,8 +7132,17 @@ e_book_cache_put_locked (ECache *cache,
 	e164_changed = update_e164_attribute_params (book_cache, contact, book_cache->priv->region_code);
 
 	if (e164_changed) {
+		EContact *updated_contact;
+
 		updated_vcard = e_vcard_to_string (E_VCARD (contact));
 		object = updated_vcard;
+
+		/* the serialized attributes should match the stored vCard */
+		updated_contact = e_contact_new_from_vcard_with_uid (object, uid);
+		ebc_take_serialized_column (book_cache, other_columns, updated_contact);
+		g_object_unref (updated_contact);
+	} else {
+		ebc_take_serialized_column (book_cache, other_columns, contact);
 	}
 
 	if (!book_cache->priv->initializing && is_replace) {
@@ -6779,6 +7290,8 @@ e_book_cache_class_init (EBookCacheClass *klass)
 	cache_class->remove_locked = e_book_cache_remove_locked;
 	cache_class->remove_all_locked = e_book_cache_remove_all_locked;
 	cache_class->clear_offline_changes_locked = e_book_cache_clear_offline_changes_locked;
+	cache_class->init_connection = e_book_cache_init_connection;
+	cache_class->recompress_columns_locked = e_book_cache_recompress_columns_locked;
 
 	klass->dup_contact_revision = ebc_dup_contact_revision;
 
@@ -7105,17 +7618,18 @@ ebc_get_query_contacts_cb (ECache *cache,
 			   gpointer user_data)
 {
 	GPtrArray *contacts = user_data;
-	const gchar *uid, *vcard;
+	const gchar *uid, *vcard, *serialized;
 
-	if (ncols != 2) {
+	if (ncols != 3) {
 		g_warn_if_reached ();
 		return FALSE;
 	}
 
 	uid = column_values[0];
 	vcard = column_values[1];
+	serialized = column_values[2];
 
-	g_ptr_array_add (contacts, e_contact_new_from_vcard_with_uid (vcard, uid));
+	g_ptr_array_add (contacts, ebc_new_contact (E_BOOK_CACHE (cache), vcard, serialized, uid));
 
 	return TRUE;
 }
@@ -7161,7 +7675,8 @@ e_book_cache_dup_query_contacts (EBookCache *book_cache,
 
 	e_cache_lock (E_CACHE (book_cache), E_CACHE_LOCK_READ);
 
-	stmt = ebc_prepare_ordered_stmt (book_cache, "summary." E_CACHE_COLUMN_OBJECT, sexp, sort_field, sort_type, n_offset, n_limit, error);
+	stmt = ebc_prepare_ordered_stmt (book_cache, "summary." E_CACHE_COLUMN_OBJECT ",summary." EBC_COLUMN_SERIALIZED,
+		sexp, sort_field, sort_type, n_offset, n_limit, error);
 	if (stmt) {
 		GPtrArray *contacts;
 
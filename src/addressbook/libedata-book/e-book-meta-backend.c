@@ -130,6 +130,29 @@ static gboolean ebmb_maybe_remove_from_cache (EBookMetaBackend *meta_backend,
 					      GCancellable *cancellable,
 					      GError **error);
 
+/* The read-only connections are opened only when asked for in the GSettings,
+   because the write-ahead log weakens the durability of the cache */
+static void
+ebmb_maybe_enable_cache_readers (EBookCache *cache)
+{
+	GSettings *settings;
+	gint n_readers;
+
+	settings = g_settings_new ("org.gnome.evolution-data-server");
+	n_readers = g_settings_get_int (settings, "cache-read-connections");
+	g_clear_object (&settings);
+
+	if (n_readers > 0) {
+		GError *local_error = NULL;
+
+		if (!e_cache_enable_wal_sync (E_CACHE (cache), n_readers, NULL, &local_error)) {
+			g_warning ("%s: Failed to enable the write-ahead log for '%s', the searches will wait for the writes: %s",
+				G_STRFUNC, e_cache_get_filename (E_CACHE (cache)), local_error ? local_error->message : "Unknown error");
+			g_clear_error (&local_error);
+		}
+	}
+}
+
 static gboolean
 ebmb_is_power_saver_enabled (void)
 {
@@ -3009,6 +3032,10 @@ ebmb_cache_categories_changed_cb (EBookCache *book_cache,
  *
  * Note the @meta_backend adds its own reference to the @cache.
  *
+ * When the "cache-read-connections" GSettings key is larger than zero,
+ * the @cache is switched to the write-ahead log with that many read-only
+ * connections, see e_cache_enable_wal_sync().
+ *
  * Since: 3.26
  **/
 void
@@ -3044,6 +3071,8 @@ e_book_meta_backend_set_cache (EBookMetaBackend *meta_backend,
 
 	g_mutex_unlock (&meta_backend->priv->property_lock);
 
+	ebmb_maybe_enable_cache_readers (cache);
+
 	g_object_notify_by_pspec (G_OBJECT (meta_backend), properties[PROP_CACHE]);
 }
 
@@ -59,6 +59,66 @@
 #define ECC_COLUMN_EXTRA		"bdata"
 #define ECC_COLUMN_CUSTOM_FLAGS		"custom_flags"
 
+/* The full-text index of the text columns; its rowid is the 'id'
+   of the component in the ECC_TABLE_TEXTS_UIDS */
+#define ECC_TABLE_TEXTS			"texts"
+#define ECC_TABLE_TEXTS_UIDS		"texts_uids"
+#define ECC_TEXTS_COLUMNS		ECC_COLUMN_SUMMARY "," \
+					ECC_COLUMN_COMMENT "," \
+					ECC_COLUMN_DESCRIPTION "," \
+					ECC_COLUMN_LOCATION "," \
+					ECC_COLUMN_ATTENDEES "," \
+					ECC_COLUMN_ORGANIZER
+
+/* Shorter values cannot be searched for with the trigram tokenizer */
+#define ECC_TEXTS_MIN_LENGTH		3
+
+/* The default count of the parsed components kept in memory */
+#define ECC_COMPONENTS_CACHE_SIZE	1024
+
+/* The expanded instances of the components, for the time range (the horizon)
+   stored in the ECC_KEY_OCCURRENCES_START and ECC_KEY_OCCURRENCES_END keys */
+#define ECC_TABLE_OCCURRENCES		"occurrences"
+#define ECC_KEY_OCCURRENCES_START	"occurrences_start"
+#define ECC_KEY_OCCURRENCES_END		"occurrences_end"
+
+#define ECC_DAY_SECONDS			(24 * 60 * 60)
+/* The horizon covers at least this many days around the current time */
+#define ECC_OCCURRENCES_PAST_DAYS	366
+#define ECC_OCCURRENCES_FUTURE_DAYS	(2 * 366)
+/* The horizon is extended by this many days over the searched range */
+#define ECC_OCCURRENCES_STEP_DAYS	92
+/* The horizon is rolled with the current time when it is off by this many days */
+#define ECC_OCCURRENCES_ROLL_DAYS	31
+/* The horizon is never longer than this; the searches outside of it
+   are done the slower way */
+#define ECC_OCCURRENCES_MAX_DAYS	(20 * 366)
+/* The components with more instances in the horizon are not expanded */
+#define ECC_OCCURRENCES_MAX_INSTANCES	10000
+/* The instances longer than this are looked for separately */
+#define ECC_OCCURRENCES_SHORT_SECONDS	(7 * ECC_DAY_SECONDS)
+/* More than the largest time zone offset difference */
+#define ECC_OCCURRENCES_FLOATING_PAD	(2 * ECC_DAY_SECONDS)
+
+/* The instances do not depend on the default time zone */
+#define ECC_OCCURRENCE_EXACT		0
+/* The instances use floating times or dates, expanded in UTC */
+#define ECC_OCCURRENCE_FLOATING		1
+/* The component could not be expanded; one instance covers the whole horizon */
+#define ECC_OCCURRENCE_UNKNOWN		2
+
+/* The entries are validated by the iCalendar string the component was parsed
+   from, not by the revision, which does not always change with the content;
+   a reader on an older snapshot can also put back a component parsed from
+   a string which had been replaced meanwhile */
+typedef struct _ComponentsCacheEntry {
+	gchar *id; /* as stored in the E_CACHE_COLUMN_UID */
+	gchar *object; /* the iCalendar string the comp was parsed from */
+	guint object_hash; /* g_str_hash() of the object, to skip most of the string comparisons */
+	ECalComponent *comp;
+	GList link; /* in priv->comps_lru, with data pointing to the entry */
+} ComponentsCacheEntry;
+
 struct _ECalCachePrivate {
 	gboolean initializing;
 
@@ -68,6 +128,20 @@ struct _ECalCachePrivate {
 
 	GHashTable *sexps; /* gint ~> ECalBackendSExp * */
 	GMutex sexps_lock;
+
+	gboolean texts_enabled; /* Whether the ECC_TABLE_TEXTS is used */
+
+	GMutex comps_lock;
+	GHashTable *comps; /* gchar *id ~> ComponentsCacheEntry * */
+	GQueue comps_lru; /* ComponentsCacheEntry *, the most recently used first */
+	guint comps_max;
+	guint64 comps_hits;
+	guint64 comps_misses;
+
+	GMutex occurrences_lock;
+	gint64 occurrences_start; /* the horizon of the ECC_TABLE_OCCURRENCES; */
+	gint64 occurrences_end; /* both are 0 when it is not used */
+	GSList *replaced_timezones; /* ICalTimezone *, replaced in the loaded_timezones */
 };
 
 enum {
@@ -299,7 +373,158 @@ ecc_ref_sexp_object (ECalCache *cal_cache,
 	return sexp;
 }
 
-/* check_sexp(sexp_id, icalstring) */
+static void
+components_cache_entry_free (gpointer ptr)
+{
+	ComponentsCacheEntry *entry = ptr;
+
+	if (entry) {
+		g_free (entry->id);
+		g_free (entry->object);
+		g_clear_object (&entry->comp);
+		g_slice_free (ComponentsCacheEntry, entry);
+	}
+}
+
+/* Called with the priv->comps_lock held */
+static void
+ecc_components_cache_remove_entry (ECalCache *cal_cache,
+				   ComponentsCacheEntry *entry)
+{
+	g_queue_unlink (&cal_cache->priv->comps_lru, &entry->link);
+	g_hash_table_remove (cal_cache->priv->comps, entry->id);
+}
+
+/* Called with the priv->comps_lock held */
+static void
+ecc_components_cache_shrink (ECalCache *cal_cache)
+{
+	while (cal_cache->priv->comps_lru.length > cal_cache->priv->comps_max)
+		ecc_components_cache_remove_entry (cal_cache, cal_cache->priv->comps_lru.tail->data);
+}
+
+/* Takes the component parsed from the @object out of the cache, thus
+   the caller can use it exclusively; return it back with ecc_components_cache_put() */
+static ECalComponent *
+ecc_components_cache_take (ECalCache *cal_cache,
+			   const gchar *id,
+			   const gchar *object)
+{
+	ComponentsCacheEntry *entry;
+	ECalComponent *comp = NULL;
+
+	if (!id || !object)
+		return NULL;
+
+	g_mutex_lock (&cal_cache->priv->comps_lock);
+
+	entry = g_hash_table_lookup (cal_cache->priv->comps, id);
+
+	if (entry && entry->comp &&
+	    entry->object_hash == g_str_hash (object) &&
+	    g_strcmp0 (entry->object, object) == 0) {
+		comp = g_steal_pointer (&entry->comp);
+		cal_cache->priv->comps_hits++;
+	} else {
+		cal_cache->priv->comps_misses++;
+	}
+
+	/* also drop an outdated entry */
+	if (entry)
+		ecc_components_cache_remove_entry (cal_cache, entry);
+
+	g_mutex_unlock (&cal_cache->priv->comps_lock);
+
+	return comp;
+}
+
+/* Adds the @comp, parsed from the @object, as the most recently used;
+   it should not be modified by the caller after this call */
+static void
+ecc_components_cache_put (ECalCache *cal_cache,
+			  const gchar *id,
+			  const gchar *object,
+			  ECalComponent *comp)
+{
+	ComponentsCacheEntry *entry;
+
+	if (!id || !object || !comp)
+		return;
+
+	g_mutex_lock (&cal_cache->priv->comps_lock);
+
+	if (cal_cache->priv->comps_max > 0) {
+		entry = g_hash_table_lookup (cal_cache->priv->comps, id);
+		if (entry)
+			ecc_components_cache_remove_entry (cal_cache, entry);
+
+		entry = g_slice_new0 (ComponentsCacheEntry);
+		entry->id = g_strdup (id);
+		entry->object = g_strdup (object);
+		entry->object_hash = g_str_hash (entry->object);
+		entry->comp = g_object_ref (comp);
+		entry->link.data = entry;
+
+		g_hash_table_insert (cal_cache->priv->comps, entry->id, entry);
+		g_queue_push_head_link (&cal_cache->priv->comps_lru, &entry->link);
+
+		ecc_components_cache_shrink (cal_cache);
+	}
+
+	g_mutex_unlock (&cal_cache->priv->comps_lock);
+}
+
+static void
+ecc_components_cache_remove (ECalCache *cal_cache,
+			     const gchar *id)
+{
+	ComponentsCacheEntry *entry;
+
+	g_mutex_lock (&cal_cache->priv->comps_lock);
+
+	entry = g_hash_table_lookup (cal_cache->priv->comps, id);
+	if (entry)
+		ecc_components_cache_remove_entry (cal_cache, entry);
+
+	g_mutex_unlock (&cal_cache->priv->comps_lock);
+}
+
+static void
+ecc_components_cache_remove_all (ECalCache *cal_cache)
+{
+	g_mutex_lock (&cal_cache->priv->comps_lock);
+
+	g_queue_init (&cal_cache->priv->comps_lru);
+	g_hash_table_remove_all (cal_cache->priv->comps);
+
+	g_mutex_unlock (&cal_cache->priv->comps_lock);
+}
+
+/* Returns a new component, which can be modified by the caller */
+static ECalComponent *
+ecc_components_cache_dup_component (ECalCache *cal_cache,
+				    const gchar *id,
+				    const gchar *object)
+{
+	ECalComponent *comp, *copy;
+
+	comp = ecc_components_cache_take (cal_cache, id, object);
+	if (!comp) {
+		comp = e_cal_component_new_from_string (object);
+		if (!comp)
+			return NULL;
+	}
+
+	copy = e_cal_component_clone (comp);
+
+	ecc_components_cache_put (cal_cache, id, object, comp);
+
+	g_object_unref (comp);
+
+	return copy;
+}
+
+/* check_sexp(sexp_id, id, icalstring) */
 static void
 ecc_check_sexp_func (sqlite3_context *context,
 		     gint argc,
@@ -307,15 +532,18 @@ ecc_check_sexp_func (sqlite3_context *context,
 {
 	ECalCache *cal_cache;
 	ECalBackendSExp *sexp_obj;
+	ECalComponent *comp;
 	gint sexp_id;
-	const gchar *icalstring;
+	const gchar *id, *icalstring;
+	gchar *decompressed = NULL;
 
 	g_return_if_fail (context != NULL);
-	g_return_if_fail (argc == 2);
+	g_return_if_fail (argc == 3);
 
 	cal_cache = sqlite3_user_data (context);
 	sexp_id = sqlite3_value_int (argv[0]);
-	icalstring = (const gchar *) sqlite3_value_text (argv[1]);
+	id = (const gchar *) sqlite3_value_text (argv[1]);
+	icalstring = (const gchar *) sqlite3_value_text (argv[2]);
 
 	if (!E_IS_CAL_CACHE (cal_cache) || !icalstring || !*icalstring) {
 		sqlite3_result_int (context, 0);
@@ -328,12 +556,37 @@ ecc_check_sexp_func (sqlite3_context *context,
 		return;
 	}
 
-	if (e_cal_backend_sexp_match_object (sexp_obj, icalstring, E_TIMEZONE_CACHE (cal_cache)))
+	/* The cached components are matched by the uncompressed string,
+	   the same as the search callbacks get it */
+	if (e_cache_object_is_compressed (icalstring)) {
+		decompressed = e_cache_decompress_object (E_CACHE (cal_cache), icalstring);
+		if (!decompressed) {
+			sqlite3_result_int (context, 0);
+			g_object_unref (sexp_obj);
+			return;
+		}
+
+		icalstring = decompressed;
+	}
+
+	/* The same components are checked repeatedly, for example
+	   by the views with the occur-in-time-range? on recurring events */
+	comp = ecc_components_cache_take (cal_cache, id, icalstring);
+	if (!comp)
+		comp = e_cal_component_new_from_string (icalstring);
+
+	if (comp && e_cal_backend_sexp_match_comp (sexp_obj, comp, E_TIMEZONE_CACHE (cal_cache)))
 		sqlite3_result_int (context, 1);
 	else
 		sqlite3_result_int (context, 0);
 
+	if (comp) {
+		ecc_components_cache_put (cal_cache, id, icalstring, comp);
+		g_object_unref (comp);
+	}
+
 	g_object_unref (sexp_obj);
+	g_free (decompressed);
 }
 
 /* negate(x) */
@@ -955,6 +1208,509 @@ ecc_fill_other_columns (ECalCache *cal_cache,
 	add_value (ECC_COLUMN_CATEGORIES, ecc_extract_categories (comp));
 }
 
+static gboolean
+ecc_occurrences_get_horizon (ECalCache *cal_cache,
+			     gint64 *out_start,
+			     gint64 *out_end)
+{
+	g_mutex_lock (&cal_cache->priv->occurrences_lock);
+
+	*out_start = cal_cache->priv->occurrences_start;
+	*out_end = cal_cache->priv->occurrences_end;
+
+	g_mutex_unlock (&cal_cache->priv->occurrences_lock);
+
+	return *out_start < *out_end;
+}
+
+static void
+ecc_occurrences_set_horizon (ECalCache *cal_cache,
+			     gint64 start,
+			     gint64 end)
+{
+	g_mutex_lock (&cal_cache->priv->occurrences_lock);
+
+	cal_cache->priv->occurrences_start = start;
+	cal_cache->priv->occurrences_end = end;
+
+	g_mutex_unlock (&cal_cache->priv->occurrences_lock);
+}
+
+static gint64
+ecc_occurrences_dup_key (ECalCache *cal_cache,
+			 const gchar *key)
+{
+	gchar *value;
+	gint64 res;
+
+	value = e_cache_dup_key (E_CACHE (cal_cache), key, NULL);
+	res = value ? g_ascii_strtoll (value, NULL, 10) : 0;
+
+	g_free (value);
+
+	return res;
+}
+
+static gboolean
+ecc_occurrences_set_key (ECalCache *cal_cache,
+			 const gchar *key,
+			 gint64 value,
+			 GError **error)
+{
+	gchar *str;
+	gboolean success;
+
+	str = g_strdup_printf ("%" G_GINT64_FORMAT, value);
+	success = e_cache_set_key (E_CACHE (cal_cache), key, str, error);
+
+	g_free (str);
+
+	return success;
+}
+
+typedef struct _OccurrencesData {
+	ECalCache *cal_cache;
+	GArray *instances; /* gint64 start and end pairs */
+	gboolean unresolved_tzid;
+	gboolean too_many;
+} OccurrencesData;
+
+/* The same as the ECalBackendSExp does */
+static ICalTimezone *
+ecc_occurrences_resolve_tzid_cb (const gchar *tzid,
+				 gpointer user_data,
+				 GCancellable *cancellable,
+				 GError **error)
+{
+	OccurrencesData *od = user_data;
+	ICalTimezone *zone;
+
+	if (!tzid || !*tzid)
+		return NULL;
+
+	zone = e_timezone_cache_get_timezone (E_TIMEZONE_CACHE (od->cal_cache), tzid);
+
+	/* The default zone is used instead, which differs between the searches */
+	if (!zone)
+		od->unresolved_tzid = TRUE;
+
+	return zone;
+}
+
+static gboolean
+ecc_occurrences_instance_cb (ICalComponent *icomp,
+			     ICalTime *instance_start,
+			     ICalTime *instance_end,
+			     gpointer user_data,
+			     GCancellable *cancellable,
+			     GError **error)
+{
+	OccurrencesData *od = user_data;
+	gint64 times[2];
+
+	if (od->instances->len >= 2 * ECC_OCCURRENCES_MAX_INSTANCES) {
+		od->too_many = TRUE;
+		return FALSE;
+	}
+
+	times[0] = (gint64) i_cal_time_as_timet_with_zone (instance_start, i_cal_time_get_timezone (instance_start));
+	times[1] = (gint64) i_cal_time_as_timet_with_zone (instance_end, i_cal_time_get_timezone (instance_end));
+
+	g_array_append_vals (od->instances, times, 2);
+
+	return TRUE;
+}
+
+static gboolean
+ecc_datetime_is_floating (ECalComponentDateTime *dt)
+{
+	ICalTime *value;
+
+	if (!dt)
+		return FALSE;
+
+	value = e_cal_component_datetime_get_value (dt);
+
+	return value && !i_cal_time_is_null_time (value) && !i_cal_time_is_utc (value) &&
+		!e_cal_component_datetime_get_tzid (dt);
+}
+
+static gboolean
+ecc_component_uses_floating_time (ECalComponent *comp)
+{
+	ECalComponentDateTime *dt;
+	gboolean floating;
+
+	dt = e_cal_component_get_dtstart (comp);
+	floating = ecc_datetime_is_floating (dt);
+	e_cal_component_datetime_free (dt);
+
+	if (!floating) {
+		dt = e_cal_component_get_dtend (comp);
+		floating = ecc_datetime_is_floating (dt);
+		e_cal_component_datetime_free (dt);
+	}
+
+	if (!floating) {
+		dt = e_cal_component_get_due (comp);
+		floating = ecc_datetime_is_floating (dt);
+		e_cal_component_datetime_free (dt);
+	}
+
+	return floating;
+}
+
+/* Called with the lock held */
+static gboolean
+ecc_occurrences_remove (ECalCache *cal_cache,
+			const gchar *id,
+			GCancellable *cancellable,
+			GError **error)
+{
+	ECacheStmt *prepared;
+
+	prepared = e_cache_stmt_prepare (E_CACHE (cal_cache),
+		"DELETE FROM " ECC_TABLE_OCCURRENCES " WHERE uid=?", error);
+	if (!prepared)
+		return FALSE;
+
+	e_cache_stmt_bind_text (prepared, 1, id);
+
+	return e_cache_stmt_exec (E_CACHE (cal_cache), prepared, cancellable, error);
+}
+
+/* Called with the lock held; replaces the stored instances of the component
+   with the given id (as stored in the E_CACHE_COLUMN_UID) */
+static gboolean
+ecc_occurrences_put (ECalCache *cal_cache,
+		     const gchar *id,
+		     ECalComponent *comp,
+		     gint64 horizon_start,
+		     gint64 horizon_end,
+		     GCancellable *cancellable,
+		     GError **error)
+{
+	ECacheStmt *prepared;
+	ICalTimezone *utc_zone;
+	ICalTime *itt_start, *itt_end;
+	OccurrencesData od;
+	gboolean success;
+	gint kind;
+	guint ii;
+
+	if (!ecc_occurrences_remove (cal_cache, id, cancellable, error))
+		return FALSE;
+
+	od.cal_cache = cal_cache;
+	od.instances = g_array_new (FALSE, FALSE, sizeof (gint64));
+	od.unresolved_tzid = FALSE;
+	od.too_many = FALSE;
+
+	utc_zone = i_cal_timezone_get_utc_timezone ();
+	itt_start = i_cal_time_new_from_timet_with_zone ((time_t) horizon_start, FALSE, utc_zone);
+	itt_end = i_cal_time_new_from_timet_with_zone ((time_t) horizon_end, FALSE, utc_zone);
+
+	/* Expanded in UTC, like the occur-in-time-range? without the time zone argument does */
+	success = e_cal_recur_generate_instances_sync (e_cal_component_get_icalcomponent (comp),
+		itt_start, itt_end, ecc_occurrences_instance_cb, &od,
+		ecc_occurrences_resolve_tzid_cb, &od, utc_zone, cancellable, NULL);
+
+	g_clear_object (&itt_start);
+	g_clear_object (&itt_end);
+
+	if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+		g_array_unref (od.instances);
+		return FALSE;
+	}
+
+	if (!success || od.too_many || od.unresolved_tzid) {
+		gint64 times[2] = { horizon_start, horizon_end };
+
+		/* Leave the decision on the search expression */
+		kind = ECC_OCCURRENCE_UNKNOWN;
+
+		g_array_set_size (od.instances, 0);
+		g_array_append_vals (od.instances, times, 2);
+	} else if (ecc_component_uses_floating_time (comp)) {
+		kind = ECC_OCCURRENCE_FLOATING;
+	} else {
+		kind = ECC_OCCURRENCE_EXACT;
+	}
+
+	success = TRUE;
+
+	for (ii = 0; success && ii + 1 < od.instances->len; ii += 2) {
+		gint64 instance_start = g_array_index (od.instances, gint64, ii);
+		gint64 instance_end = g_array_index (od.instances, gint64, ii + 1);
+
+		prepared = e_cache_stmt_prepare (E_CACHE (cal_cache),
+			"INSERT INTO " ECC_TABLE_OCCURRENCES " (uid,instance_start,instance_end,kind,is_long)"
+			" VALUES (?,?,?,?,?)", error);
+		if (!prepared) {
+			success = FALSE;
+			break;
+		}
+
+		e_cache_stmt_bind_text (prepared, 1, id);
+		e_cache_stmt_bind_int64 (prepared, 2, instance_start);
+		e_cache_stmt_bind_int64 (prepared, 3, instance_end);
+		e_cache_stmt_bind_int (prepared, 4, kind);
+		e_cache_stmt_bind_int (prepared, 5, kind == ECC_OCCURRENCE_UNKNOWN ||
+			instance_end - instance_start > ECC_OCCURRENCES_SHORT_SECONDS);
+
+		success = e_cache_stmt_exec (E_CACHE (cal_cache), prepared, cancellable, error);
+	}
+
+	g_array_unref (od.instances);
+
+	return success;
+}
+
+/* Called with the lock held and inside a transaction; expands again
+   the components matching the where_clause, or all when it is NULL */
+static gboolean
+ecc_occurrences_put_where (ECalCache *cal_cache,
+			   const gchar *where_clause,
+			   gint64 horizon_start,
+			   gint64 horizon_end,
+			   GCancellable *cancellable,
+			   GError **error)
+{
+	ECache *cache = E_CACHE (cal_cache);
+	GSList *ids = NULL, *link;
+	gchar *stmt;
+	gboolean success;
+
+	if (where_clause)
+		stmt = g_strconcat ("SELECT " E_CACHE_COLUMN_UID " FROM " E_CACHE_TABLE_OBJECTS " WHERE ", where_clause, NULL);
+	else
+		stmt = g_strdup ("SELECT " E_CACHE_COLUMN_UID " FROM " E_CACHE_TABLE_OBJECTS);
+
+	success = e_cache_sqlite_select (cache, stmt, e_cal_cache_get_strings, &ids, cancellable, error);
+
+	for (link = ids; success && link; link = g_slist_next (link)) {
+		const gchar *id = link->data;
+		ECalComponent *comp;
+		gchar *object;
+
+		object = e_cache_get_object_include_deleted (cache, id, NULL, NULL, cancellable, error);
+		if (!object) {
+			success = FALSE;
+			break;
+		}
+
+		comp = e_cal_component_new_from_string (object);
+		if (comp)
+			success = ecc_occurrences_put (cal_cache, id, comp, horizon_start, horizon_end, cancellable, error);
+		else
+			success = ecc_occurrences_remove (cal_cache, id, cancellable, error);
+
+		g_clear_object (&comp);
+		g_free (object);
+	}
+
+	g_slist_free_full (ids, g_free);
+	g_free (stmt);
+
+	return success;
+}
+
+/* Called with the lock held and inside a transaction; the priv members
+   are updated by the caller, in the same transaction */
+static gboolean
+ecc_occurrences_change_horizon (ECalCache *cal_cache,
+				gint64 old_start,
+				gint64 old_end,
+				gint64 new_start,
+				gint64 new_end,
+				GCancellable *cancellable,
+				GError **error)
+{
+	gboolean success = TRUE;
+
+	if (old_start < old_end && new_start < old_end && new_end > old_start) {
+		if (new_start == old_start && new_end == old_end)
+			return TRUE;
+
+		/* The components without recurrences, which occur in the old horizon,
+		   do not need to be expanded again; nothing is expanded when
+		   the horizon only shrinks */
+		if (new_start < old_start || new_end > old_end) {
+			success = ecc_occurrences_put_where (cal_cache,
+				ECC_COLUMN_HAS_RECURRENCES "=1 OR " E_CACHE_COLUMN_UID " NOT IN ("
+				"SELECT uid FROM " ECC_TABLE_OCCURRENCES " WHERE kind<>" G_STRINGIFY (ECC_OCCURRENCE_UNKNOWN) ")",
+				new_start, new_end, cancellable, error);
+		}
+
+		/* Drop the instances, which are not in the new horizon anymore */
+		if (success && (new_start > old_start || new_end < old_end)) {
+			gchar *stmt;
+
+			stmt = g_strdup_printf ("DELETE FROM " ECC_TABLE_OCCURRENCES
+				" WHERE kind<>" G_STRINGIFY (ECC_OCCURRENCE_UNKNOWN)
+				" AND (instance_end<%" G_GINT64_FORMAT " OR instance_start>=%" G_GINT64_FORMAT ")",
+				new_start, new_end);
+
+			success = e_cache_sqlite_exec (E_CACHE (cal_cache), stmt, cancellable, error);
+
+			g_free (stmt);
+		}
+	} else {
+		success = e_cache_sqlite_exec (E_CACHE (cal_cache), "DELETE FROM " ECC_TABLE_OCCURRENCES, cancellable, error) &&
+			ecc_occurrences_put_where (cal_cache, NULL, new_start, new_end, cancellable, error);
+	}
+
+	return success &&
+		ecc_occurrences_set_key (cal_cache, ECC_KEY_OCCURRENCES_START, new_start, error) &&
+		ecc_occurrences_set_key (cal_cache, ECC_KEY_OCCURRENCES_END, new_end, error);
+}
+
+/* Extends the horizon to contain the range; returns whether it changed */
+static gboolean
+ecc_occurrences_extend (ECalCache *cal_cache,
+			gint64 range_start,
+			gint64 range_end,
+			GCancellable *cancellable)
+{
+	gint64 old_start, old_end, new_start, new_end;
+	gboolean changed = FALSE;
+	GError *local_error = NULL;
+
+	/* Do not lock for ranges, which can never be covered */
+	if (!ecc_occurrences_get_horizon (cal_cache, &old_start, &old_end) ||
+	    MAX (old_end, range_end) - MIN (old_start, range_start) > ((gint64) ECC_OCCURRENCES_MAX_DAYS) * ECC_DAY_SECONDS)
+		return FALSE;
+
+	/* The horizon is changed only in its own transaction, which cannot
+	   be rolled back by the caller after the priv members are updated.
+	   When this thread is in a transaction already, the search is done
+	   the slower way. Another thread's transaction can only make this
+	   give up needlessly, it's finished before the lock below is acquired. */
+	if (!sqlite3_get_autocommit (e_cache_get_sqlitedb (E_CACHE (cal_cache))))
+		return FALSE;
+
+	e_cache_lock (E_CACHE (cal_cache), E_CACHE_LOCK_WRITE);
+
+	if (ecc_occurrences_get_horizon (cal_cache, &old_start, &old_end)) {
+		new_start = MIN (old_start, range_start - ECC_OCCURRENCES_STEP_DAYS * ECC_DAY_SECONDS);
+		new_end = MAX (old_end, range_end + ECC_OCCURRENCES_STEP_DAYS * ECC_DAY_SECONDS);
+
+		if (range_start >= old_start)
+			new_start = old_start;
+		if (range_end <= old_end)
+			new_end = old_end;
+
+		if ((new_start != old_start || new_end != old_end) &&
+		    new_end - new_start <= ((gint64) ECC_OCCURRENCES_MAX_DAYS) * ECC_DAY_SECONDS) {
+			changed = ecc_occurrences_change_horizon (cal_cache, old_start, old_end,
+				new_start, new_end, cancellable, &local_error);
+
+			/* This is the outermost transaction, thus it's committed below;
+			   the horizon is set while still holding the lock, thus no other
+			   writer can store a component for the old horizon meanwhile */
+			if (changed)
+				ecc_occurrences_set_horizon (cal_cache, new_start, new_end);
+		}
+	}
+
+	e_cache_unlock (E_CACHE (cal_cache), local_error ? E_CACHE_UNLOCK_ROLLBACK : E_CACHE_UNLOCK_COMMIT);
+
+	if (local_error) {
+		if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("%s: Failed to extend occurrences of '%s': %s", G_STRFUNC,
+				e_cache_get_filename (E_CACHE (cal_cache)), local_error->message);
+
+		g_clear_error (&local_error);
+	}
+
+	return changed;
+}
+
+/* Returns the instance ids of the components of the kind, which overlap
+   the <range_start, range_end) in the same way as the e_cal_recur_generate_instances_sync() checks it */
+static gchar *
+ecc_occurrences_overlap_stmt (const gchar *kind_condition,
+			      gint64 range_start,
+			      gint64 range_end)
+{
+	gchar *overlap, *stmt;
+
+	overlap = g_strdup_printf ("(instance_end>%" G_GINT64_FORMAT
+		" OR (instance_end=instance_start AND instance_start>=%" G_GINT64_FORMAT "))",
+		range_start, range_start);
+
+	stmt = g_strdup_printf (
+		"SELECT uid FROM " ECC_TABLE_OCCURRENCES " WHERE %s AND instance_start>=%" G_GINT64_FORMAT
+		" AND instance_start<%" G_GINT64_FORMAT " AND %s"
+		" UNION ALL "
+		"SELECT uid FROM " ECC_TABLE_OCCURRENCES " WHERE is_long=1 AND %s AND instance_start<%" G_GINT64_FORMAT " AND %s",
+		kind_condition, range_start - ECC_OCCURRENCES_SHORT_SECONDS, range_end, overlap,
+		kind_condition, range_end, overlap);
+
+	g_free (overlap);
+
+	return stmt;
+}
+
+/* Called with the lock held and inside a transaction */
+static gboolean
+ecc_init_occurrences (ECalCache *cal_cache,
+		      GCancellable *cancellable,
+		      GError **error)
+{
+	ECache *cache = E_CACHE (cal_cache);
+	gint64 now, old_start, old_end, new_start, new_end, wanted_start, wanted_end;
+
+	if (!e_cache_sqlite_exec (cache, "CREATE TABLE IF NOT EXISTS " ECC_TABLE_OCCURRENCES " ("
+		"uid TEXT NOT NULL, "
+		"instance_start INTEGER NOT NULL, "
+		"instance_end INTEGER NOT NULL, "
+		"kind INTEGER NOT NULL, "
+		"is_long INTEGER NOT NULL)", cancellable, error) ||
+	    !e_cache_sqlite_exec (cache, "CREATE INDEX IF NOT EXISTS IDX_OCCURRENCES_START ON "
+		ECC_TABLE_OCCURRENCES " (instance_start)", cancellable, error) ||
+	    !e_cache_sqlite_exec (cache, "CREATE INDEX IF NOT EXISTS IDX_OCCURRENCES_LONG ON "
+		ECC_TABLE_OCCURRENCES " (is_long, instance_start)", cancellable, error) ||
+	    !e_cache_sqlite_exec (cache, "CREATE INDEX IF NOT EXISTS IDX_OCCURRENCES_UID ON "
+		ECC_TABLE_OCCURRENCES " (uid)", cancellable, error) ||
+	    !e_cache_sqlite_exec (cache, "CREATE INDEX IF NOT EXISTS IDX_OCCURRENCES_KIND ON "
+		ECC_TABLE_OCCURRENCES " (kind)", cancellable, error))
+		return FALSE;
+
+	now = (gint64) time (NULL);
+	wanted_start = now - ECC_OCCURRENCES_PAST_DAYS * ECC_DAY_SECONDS;
+	wanted_end = now + ECC_OCCURRENCES_FUTURE_DAYS * ECC_DAY_SECONDS;
+
+	old_start = ecc_occurrences_dup_key (cal_cache, ECC_KEY_OCCURRENCES_START);
+	old_end = ecc_occurrences_dup_key (cal_cache, ECC_KEY_OCCURRENCES_END);
+
+	new_start = old_start;
+	new_end = old_end;
+
+	/* Roll both ends of the horizon with the current time, but only when
+	   they are off by a step, thus the recurring components are not expanded
+	   again on each open; the end extended by the searches is kept */
+	if (ABS (wanted_start - old_start) >= ((gint64) ECC_OCCURRENCES_ROLL_DAYS) * ECC_DAY_SECONDS)
+		new_start = wanted_start;
+
+	if (wanted_end - old_end >= ((gint64) ECC_OCCURRENCES_ROLL_DAYS) * ECC_DAY_SECONDS)
+		new_end = wanted_end;
+
+	/* Start over when the horizon is not used yet or when it would be too long */
+	if (old_start >= old_end || new_start >= new_end ||
+	    new_end - new_start > ((gint64) ECC_OCCURRENCES_MAX_DAYS) * ECC_DAY_SECONDS) {
+		new_start = wanted_start;
+		new_end = wanted_end;
+	}
+
+	if (!ecc_occurrences_change_horizon (cal_cache, old_start, old_end, new_start, new_end, cancellable, error))
+		return FALSE;
+
+	ecc_occurrences_set_horizon (cal_cache, new_start, new_end);
+
+	return TRUE;
+}
+
 static gchar *
 ecc_range_as_where_clause (const gchar *start_str,
 			   const gchar *end_str)
@@ -991,8 +1747,11 @@ ecc_range_as_where_clause (const gchar *start_str,
 
 typedef struct _SExpToSqlContext {
 	ECalCache *cal_cache;
+	gint sexp_id;
 	guint not_level;
 	gboolean requires_check_sexp;
+	gint64 wanted_start; /* the range of the occur-in-time-range? */
+	gint64 wanted_end; /* outside of the occurrences horizon */
 } SExpToSqlContext;
 
 static ESExpResult *
@@ -1128,6 +1887,54 @@ ecc_sexp_func_uid (ESExp *esexp,
 	return result;
 }
 
+/* Returns a condition for the occur-in-time-range? using the ECC_TABLE_OCCURRENCES,
+   or NULL, when the range is not covered by it */
+static gchar *
+ecc_occurrences_range_condition (SExpToSqlContext *ctx,
+				 gint64 range_start,
+				 gint64 range_end,
+				 gboolean with_zone)
+{
+	gint64 horizon_start, horizon_end, pad;
+	gchar *exact_stmt, *check_stmt, *res;
+
+	if (!ecc_occurrences_get_horizon (ctx->cal_cache, &horizon_start, &horizon_end))
+		return NULL;
+
+	/* The floating times are shifted by the time zone argument */
+	pad = with_zone ? ECC_OCCURRENCES_FLOATING_PAD : 0;
+
+	if (range_start - pad < horizon_start || range_end + pad > horizon_end) {
+		ctx->wanted_start = MIN (ctx->wanted_start, range_start - pad);
+		ctx->wanted_end = MAX (ctx->wanted_end, range_end + pad);
+
+		return NULL;
+	}
+
+	/* The check_sexp() evaluates the whole expression, which gives the right
+	   result in any and/or context, because the 'not' is not used here */
+	if (with_zone) {
+		exact_stmt = ecc_occurrences_overlap_stmt ("kind=" G_STRINGIFY (ECC_OCCURRENCE_EXACT),
+			range_start, range_end);
+		check_stmt = ecc_occurrences_overlap_stmt ("kind<>" G_STRINGIFY (ECC_OCCURRENCE_EXACT),
+			range_start - pad, range_end + pad);
+	} else {
+		exact_stmt = ecc_occurrences_overlap_stmt ("kind<>" G_STRINGIFY (ECC_OCCURRENCE_UNKNOWN),
+			range_start, range_end);
+		check_stmt = ecc_occurrences_overlap_stmt ("kind=" G_STRINGIFY (ECC_OCCURRENCE_UNKNOWN),
+			range_start, range_end);
+	}
+
+	res = g_strdup_printf ("(" E_CACHE_COLUMN_UID " IN (%s) OR (" E_CACHE_COLUMN_UID " IN (%s) AND check_sexp(%d,%s,%s)))",
+		exact_stmt, check_stmt, ctx->sexp_id,
+		E_CACHE_COLUMN_UID, E_CACHE_COLUMN_OBJECT);
+
+	g_free (exact_stmt);
+	g_free (check_stmt);
+
+	return res;
+}
+
 static ESExpResult *
 ecc_sexp_func_occur_in_time_range (ESExp *esexp,
 				   gint argc,
@@ -1146,7 +1953,16 @@ ecc_sexp_func_occur_in_time_range (ESExp *esexp,
 		return NULL;
 	}
 
-	result = e_sexp_result_new (esexp, ESEXP_RES_STRING);
+	result = e_sexp_result_new (esexp, ESEXP_RES_STRING);
+
+	if (!ctx->not_level) {
+		result->value.string = ecc_occurrences_range_condition (ctx,
+			argv[0]->value.time, argv[1]->value.time, argc == 3);
+
+		/* The check_sexp() is part of the condition */
+		if (result->value.string)
+			return result;
+	}
 
 	if (!ctx->not_level) {
 		ICalTime *itt_start, *itt_end;
@@ -1209,6 +2025,43 @@ ecc_sexp_func_due_in_time_range (ESExp *esexp,
 	return result;
 }
 
+/* Returns an SQL condition matching the components whose @columns
+   contain the @str, using the ECC_TABLE_TEXTS, or %NULL, when
+   the full-text index cannot be used for the @str */
+static gchar *
+ecc_texts_match_condition (ECalCache *cal_cache,
+			   const gchar *columns,
+			   const gchar *str)
+{
+	GString *query;
+	const gchar *ptr;
+	gchar *stmt;
+
+	if (!cal_cache->priv->texts_enabled ||
+	    g_utf8_strlen (str, -1) < ECC_TEXTS_MIN_LENGTH)
+		return NULL;
+
+	/* Search for the value as an FTS5 phrase, which matches
+	   it as a substring with the trigram tokenizer */
+	query = g_string_sized_new (strlen (columns) + strlen (str) + 8);
+	g_string_append_printf (query, "{%s} : \"", columns);
+	for (ptr = str; *ptr; ptr++) {
+		if (*ptr == '\"')
+			g_string_append_c (query, '\"');
+		g_string_append_c (query, *ptr);
+	}
+	g_string_append_c (query, '\"');
+
+	stmt = e_cache_sqlite_stmt_printf (
+		E_CACHE_COLUMN_UID " IN (SELECT uid FROM " ECC_TABLE_TEXTS_UIDS
+		" WHERE id IN (SELECT rowid FROM " ECC_TABLE_TEXTS " WHERE " ECC_TABLE_TEXTS " MATCH %Q))",
+		query->str);
+
+	g_string_free (query, TRUE);
+
+	return stmt;
+}
+
 static ESExpResult *
 ecc_sexp_func_contains (ESExp *esexp,
 			gint argc,
@@ -1273,21 +2126,33 @@ ecc_sexp_func_contains (ESExp *esexp,
 			   g_str_equal (column, ECC_COLUMN_STATUS)) {
 			stmt = e_cache_sqlite_stmt_printf ("%s='%q'", column, str);
 		} else {
-			stmt = e_cache_sqlite_stmt_printf ("%s LIKE '%%%q%%'", column, str);
+			stmt = ecc_texts_match_condition (ctx->cal_cache, column, str);
+			if (!stmt)
+				stmt = e_cache_sqlite_stmt_printf ("%s LIKE '%%%q%%'", column, str);
 		}
 		result->value.string = g_strdup (stmt);
 		e_cache_sqlite_stmt_free (stmt);
 	} else if (g_str_equal (field, "any")) {
-		GString *stmt;
+		gchar *match;
 
-		stmt = g_string_new ("");
+		match = ecc_texts_match_condition (ctx->cal_cache,
+			ECC_COLUMN_COMMENT " " ECC_COLUMN_DESCRIPTION " " ECC_COLUMN_SUMMARY " " ECC_COLUMN_LOCATION, str);
 
-		e_cache_sqlite_stmt_append_printf (stmt, "(%s LIKE '%%%q%%'", ECC_COLUMN_COMMENT, str);
-		e_cache_sqlite_stmt_append_printf (stmt, " OR %s LIKE '%%%q%%'", ECC_COLUMN_DESCRIPTION, str);
-		e_cache_sqlite_stmt_append_printf (stmt, " OR %s LIKE '%%%q%%'", ECC_COLUMN_SUMMARY, str);
-		e_cache_sqlite_stmt_append_printf (stmt, " OR %s LIKE '%%%q%%')", ECC_COLUMN_LOCATION, str);
+		if (match) {
+			result->value.string = g_strdup (match);
+			e_cache_sqlite_stmt_free (match);
+		} else {
+			GString *stmt;
+
+			stmt = g_string_new ("");
 
-		result->value.string = g_string_free (stmt, FALSE);
+			e_cache_sqlite_stmt_append_printf (stmt, "(%s LIKE '%%%q%%'", ECC_COLUMN_COMMENT, str);
+			e_cache_sqlite_stmt_append_printf (stmt, " OR %s LIKE '%%%q%%'", ECC_COLUMN_DESCRIPTION, str);
+			e_cache_sqlite_stmt_append_printf (stmt, " OR %s LIKE '%%%q%%'", ECC_COLUMN_SUMMARY, str);
+			e_cache_sqlite_stmt_append_printf (stmt, " OR %s LIKE '%%%q%%')", ECC_COLUMN_LOCATION, str);
+
+			result->value.string = g_string_free (stmt, FALSE);
+		}
 	} else {
 		ctx->requires_check_sexp = TRUE;
 	}
@@ -1507,7 +2372,7 @@ ecc_sexp_func_percent_complete (ESExp *esexp,
 	return result;
 }
 
-/* check_sexp(sexp_id, icalstring); that's a fallback for anything
+/* check_sexp(sexp_id, id, icalstring); that's a fallback for anything
    not being part of the summary */
 static ESExpResult *
 ecc_sexp_func_check_sexp (ESExp *esexp,
@@ -1626,6 +2491,8 @@ ecc_convert_sexp_to_sql (ECalCache *cal_cache,
 			 const gchar *sexp_str,
 			 gint sexp_id,
 			 gchar **out_where_clause,
+			 gint64 *out_wanted_start,
+			 gint64 *out_wanted_end,
 			 GCancellable *cancellable,
 			 GError **error)
 {
@@ -1643,8 +2510,11 @@ ecc_convert_sexp_to_sql (ECalCache *cal_cache,
 		return TRUE;
 
 	ctx.cal_cache = cal_cache;
+	ctx.sexp_id = sexp_id;
 	ctx.not_level = 0;
 	ctx.requires_check_sexp = FALSE;
+	ctx.wanted_start = G_MAXINT64;
+	ctx.wanted_end = G_MININT64;
 
 	sexp_parser = e_sexp_new ();
 
@@ -1668,11 +2538,12 @@ ecc_convert_sexp_to_sql (ECalCache *cal_cache,
 			if (result->type == ESEXP_RES_STRING) {
 				if (ctx.requires_check_sexp) {
 					if (result->value.string) {
-						*out_where_clause = g_strdup_printf ("((%s) AND check_sexp(%d,%s))",
-							result->value.string, sexp_id, E_CACHE_COLUMN_OBJECT);
+						*out_where_clause = g_strdup_printf ("((%s) AND check_sexp(%d,%s,%s))",
+							result->value.string, sexp_id,
+							E_CACHE_COLUMN_UID, E_CACHE_COLUMN_OBJECT);
 					} else {
-						*out_where_clause = g_strdup_printf ("check_sexp(%d,%s)",
-							sexp_id, E_CACHE_COLUMN_OBJECT);
+						*out_where_clause = g_strdup_printf ("check_sexp(%d,%s,%s)",
+							sexp_id, E_CACHE_COLUMN_UID, E_CACHE_COLUMN_OBJECT);
 					}
 				} else {
 					/* Just steal the string from the ESExpResult */
@@ -1691,6 +2562,11 @@ ecc_convert_sexp_to_sql (ECalCache *cal_cache,
 	if (!success) {
 		g_set_error (error, E_CACHE_ERROR, E_CACHE_ERROR_INVALID_QUERY,
 			_("Invalid query: %s"), sexp_str);
+	} else if (ctx.wanted_start < ctx.wanted_end) {
+		if (out_wanted_start)
+			*out_wanted_start = ctx.wanted_start;
+		if (out_wanted_end)
+			*out_wanted_end = ctx.wanted_end;
 	}
 
 	return success;
@@ -1763,13 +2639,22 @@ ecc_search_internal (ECalCache *cal_cache,
 		     GError **error)
 {
 	gchar *where_clause = NULL;
+	gint64 wanted_start = 0, wanted_end = 0;
 	SearchContext ctx;
 	gboolean success;
 
-	if (!ecc_convert_sexp_to_sql (cal_cache, sexp_str, sexp_id, &where_clause, cancellable, error)) {
+	if (!ecc_convert_sexp_to_sql (cal_cache, sexp_str, sexp_id, &where_clause, &wanted_start, &wanted_end, cancellable, error)) {
 		return FALSE;
 	}
 
+	/* The searched range is not covered by the occurrences yet */
+	if (wanted_start < wanted_end && ecc_occurrences_extend (cal_cache, wanted_start, wanted_end, cancellable)) {
+		g_clear_pointer (&where_clause, g_free);
+
+		if (!ecc_convert_sexp_to_sql (cal_cache, sexp_str, sexp_id, &where_clause, NULL, NULL, cancellable, error))
+			return FALSE;
+	}
+
 	ctx.extra_idx = -1;
 	ctx.custom_flags_idx = -1;
 	ctx.func = func;
@@ -1792,22 +2677,132 @@ ecc_init_aux_tables (ECalCache *cal_cache,
 	return e_cache_keys_init_table_sync (cal_cache->priv->timezones_table, cancellable, error);
 }
 
+static gboolean
+ecc_texts_exec_with_uid (ECalCache *cal_cache,
+			 const gchar *stmt,
+			 const gchar *uid,
+			 GCancellable *cancellable,
+			 GError **error)
+{
+	ECacheStmt *prepared;
+
+	prepared = e_cache_stmt_prepare (E_CACHE (cal_cache), stmt, error);
+	if (!prepared)
+		return FALSE;
+
+	e_cache_stmt_bind_text (prepared, 1, uid);
+
+	return e_cache_stmt_exec (E_CACHE (cal_cache), prepared, cancellable, error);
+}
+
+/* Called with the lock held, after the component had been stored */
+static gboolean
+ecc_texts_put (ECalCache *cal_cache,
+	       const gchar *uid,
+	       GCancellable *cancellable,
+	       GError **error)
+{
+	/* The id is kept for the existing uid */
+	return ecc_texts_exec_with_uid (cal_cache,
+		"DELETE FROM " ECC_TABLE_TEXTS " WHERE rowid IN ("
+		"SELECT id FROM " ECC_TABLE_TEXTS_UIDS " WHERE uid=?)",
+		uid, cancellable, error) &&
+		ecc_texts_exec_with_uid (cal_cache,
+		"INSERT OR IGNORE INTO " ECC_TABLE_TEXTS_UIDS " (uid) VALUES (?)",
+		uid, cancellable, error) &&
+		ecc_texts_exec_with_uid (cal_cache,
+		"INSERT INTO " ECC_TABLE_TEXTS " (rowid," ECC_TEXTS_COLUMNS ")"
+		" SELECT " ECC_TABLE_TEXTS_UIDS ".id," ECC_TEXTS_COLUMNS
+		" FROM " ECC_TABLE_TEXTS_UIDS " JOIN " E_CACHE_TABLE_OBJECTS
+		" ON " E_CACHE_COLUMN_UID "=" ECC_TABLE_TEXTS_UIDS ".uid"
+		" WHERE " ECC_TABLE_TEXTS_UIDS ".uid=?",
+		uid, cancellable, error);
+}
+
+/* Called with the lock held */
+static gboolean
+ecc_texts_remove (ECalCache *cal_cache,
+		  const gchar *uid,
+		  GCancellable *cancellable,
+		  GError **error)
+{
+	return ecc_texts_exec_with_uid (cal_cache,
+		"DELETE FROM " ECC_TABLE_TEXTS " WHERE rowid IN ("
+		"SELECT id FROM " ECC_TABLE_TEXTS_UIDS " WHERE uid=?)",
+		uid, cancellable, error) &&
+		ecc_texts_exec_with_uid (cal_cache,
+		"DELETE FROM " ECC_TABLE_TEXTS_UIDS " WHERE uid=?",
+		uid, cancellable, error);
+}
+
+/* Called with the lock held and inside a transaction */
+static gboolean
+ecc_init_texts (ECalCache *cal_cache,
+		GCancellable *cancellable,
+		GError **error)
+{
+	ECache *cache = E_CACHE (cal_cache);
+	GError *local_error = NULL;
+	guint64 n_tables = 0;
+	gboolean success;
+
+	success = e_cache_sqlite_select (cache,
+		"SELECT COUNT(*) FROM sqlite_master WHERE type='table' AND name IN"
+		" ('" ECC_TABLE_TEXTS "','" ECC_TABLE_TEXTS_UIDS "')",
+		e_cal_cache_get_uint64_cb, &n_tables, cancellable, error);
+
+	if (!success)
+		return FALSE;
+
+	if (n_tables == 2) {
+		cal_cache->priv->texts_enabled = TRUE;
+		return TRUE;
+	}
+
+	/* The values are decomposed to lower case, thus the case sensitive
+	   search gives the same results as the LIKE on the text columns */
+	if (!e_cache_sqlite_exec (cache, "DROP TABLE IF EXISTS " ECC_TABLE_TEXTS, cancellable, error) ||
+	    !e_cache_sqlite_exec (cache, "DROP TABLE IF EXISTS " ECC_TABLE_TEXTS_UIDS, cancellable, error))
+		return FALSE;
+
+	if (!e_cache_sqlite_exec (cache, "CREATE VIRTUAL TABLE " ECC_TABLE_TEXTS " USING fts5 ("
+		ECC_TEXTS_COLUMNS ", tokenize='trigram case_sensitive 1')", cancellable, &local_error)) {
+		/* Older SQLite or one without FTS5; the contains? searches use LIKE then */
+		g_warning ("%s: Cannot create text index for '%s', using slower search instead: %s",
+			G_STRFUNC, e_cache_get_filename (cache), local_error ? local_error->message : "Unknown error");
+		g_clear_error (&local_error);
+
+		return TRUE;
+	}
+
+	/* Index the already stored components */
+	success = e_cache_sqlite_exec (cache, "CREATE TABLE " ECC_TABLE_TEXTS_UIDS
+		" (id INTEGER PRIMARY KEY, uid TEXT NOT NULL UNIQUE)", cancellable, error) &&
+		e_cache_sqlite_exec (cache, "INSERT INTO " ECC_TABLE_TEXTS_UIDS " (uid)"
+		" SELECT " E_CACHE_COLUMN_UID " FROM " E_CACHE_TABLE_OBJECTS, cancellable, error) &&
+		e_cache_sqlite_exec (cache, "INSERT INTO " ECC_TABLE_TEXTS " (rowid," ECC_TEXTS_COLUMNS ")"
+		" SELECT " ECC_TABLE_TEXTS_UIDS ".id," ECC_TEXTS_COLUMNS
+		" FROM " ECC_TABLE_TEXTS_UIDS " JOIN " E_CACHE_TABLE_OBJECTS
+		" ON " E_CACHE_COLUMN_UID "=" ECC_TABLE_TEXTS_UIDS ".uid", cancellable, error);
+
+	cal_cache->priv->texts_enabled = success;
+
+	return success;
+}
+
 static gboolean
 ecc_init_sqlite_functions (ECalCache *cal_cache,
-			   GCancellable *cancellable,
+			   gpointer sqlitedb,
 			   GError **error)
 {
 	gint ret;
-	gpointer sqlitedb;
 
 	g_return_val_if_fail (E_IS_CAL_CACHE (cal_cache), FALSE);
-
-	sqlitedb = e_cache_get_sqlitedb (E_CACHE (cal_cache));
 	g_return_val_if_fail (sqlitedb != NULL, FALSE);
 
-	/* check_sexp(sexp_id, icalstring) */
+	/* check_sexp(sexp_id, id, icalstring) */
 	ret = sqlite3_create_function (sqlitedb,
-		"check_sexp", 2, SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+		"check_sexp", 3, SQLITE_UTF8 | SQLITE_DETERMINISTIC,
 		cal_cache, ecc_check_sexp_func,
 		NULL, NULL);
 
@@ -1832,6 +2827,14 @@ ecc_init_sqlite_functions (ECalCache *cal_cache,
 	return TRUE;
 }
 
+static gboolean
+e_cal_cache_init_connection (ECache *cache,
+			     gpointer sqlitedb,
+			     GError **error)
+{
+	return ecc_init_sqlite_functions (E_CAL_CACHE (cache), sqlitedb, error);
+}
+
 typedef struct _ComponentInfo {
 	GSList *online_comps; /* ECalComponent * */
 	GSList *online_extras; /* gchar * */
@@ -2322,15 +3325,22 @@ e_cal_cache_initialize (ECalCache *cal_cache,
 
 	success = success && ecc_init_aux_tables (cal_cache, cancellable, error);
 
-	success = success && ecc_init_sqlite_functions (cal_cache, cancellable, error);
+	success = success && ecc_init_texts (cal_cache, cancellable, error);
+
+	success = success && ecc_init_occurrences (cal_cache, cancellable, error);
+
+	success = success && ecc_init_sqlite_functions (cal_cache, e_cache_get_sqlitedb (cache), error);
 
 	/* Check for data migration */
 	success = success && e_cal_cache_migrate (cache, e_cache_get_version (cache), cancellable, error);
 
 	e_cache_unlock (cache, success ? E_CACHE_UNLOCK_COMMIT : E_CACHE_UNLOCK_ROLLBACK);
 
-	if (!success)
+	if (!success) {
+		/* the occurrences table is rolled back, thus do not pretend it's usable */
+		ecc_occurrences_set_horizon (cal_cache, 0, 0);
 		goto exit;
+	}
 
 	if (e_cache_get_version (cache) != E_CAL_CACHE_VERSION)
 		e_cache_set_version (cache, E_CAL_CACHE_VERSION);
@@ -2525,14 +3535,19 @@ e_cal_cache_put_components (ECalCache *cal_cache,
 	g_return_val_if_fail (extras == NULL || g_slist_length ((GSList *) components) == g_slist_length ((GSList *) extras), FALSE);
 	g_return_val_if_fail (custom_flags == NULL || g_slist_length ((GSList *) components) == g_slist_length ((GSList *) custom_flags), FALSE);
 
+	if (!components)
+		return TRUE;
+
 	cache = E_CACHE (cal_cache);
 	other_columns = e_cache_column_values_new ();
 
+	/* Each component is stored right after it's converted to a string,
+	   thus only one of them is held in memory at a time */
 	e_cache_lock (cache, E_CACHE_LOCK_WRITE);
 	e_cache_freeze_revision_change (cache);
 
 	for (clink = components, elink = extras, flink = custom_flags;
-	     clink;
+	     clink && success;
 	     (clink = g_slist_next (clink)), (elink = g_slist_next (elink)), (flink = g_slist_next (flink))) {
 		ECalComponent *component = clink->data;
 		const gchar *extra = elink ? elink->data : NULL;
@@ -2540,10 +3555,17 @@ e_cal_cache_put_components (ECalCache *cal_cache,
 		ECalComponentId *id;
 		gchar *uid, *rev, *icalstring;
 
-		g_return_val_if_fail (E_IS_CAL_COMPONENT (component), FALSE);
+		if (!E_IS_CAL_COMPONENT (component) || !(icalstring = e_cal_component_get_as_string (component))) {
+			g_warn_if_reached ();
+			success = FALSE;
+			break;
+		}
 
-		icalstring = e_cal_component_get_as_string (component);
-		g_return_val_if_fail (icalstring != NULL, FALSE);
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			g_free (icalstring);
+			success = FALSE;
+			break;
+		}
 
 		e_cache_column_values_remove_all (other_columns);
 
@@ -2567,9 +3589,6 @@ e_cal_cache_put_components (ECalCache *cal_cache,
 		g_free (icalstring);
 		g_free (rev);
 		g_free (uid);
-
-		if (!success)
-			break;
 	}
 
 	e_cache_thaw_revision_change (cache);
@@ -3178,6 +4197,65 @@ e_cal_cache_get_components_by_uid_as_string (ECalCache *cal_cache,
 	return success;
 }
 
+static gchar *
+ecc_dup_range_sexp (time_t range_start,
+		    time_t range_end)
+{
+	ICalTime *itt_start, *itt_end;
+	gchar *sexp;
+
+	itt_start = i_cal_time_new_from_timet_with_zone (range_start, FALSE, NULL);
+	itt_end = i_cal_time_new_from_timet_with_zone (range_end, FALSE, NULL);
+
+	sexp = g_strdup_printf ("(occur-in-time-range? (make-time \"%04d%02d%02dT%02d%02d%02dZ\") (make-time \"%04d%02d%02dT%02d%02d%02dZ\"))",
+		i_cal_time_get_year (itt_start),
+		i_cal_time_get_month (itt_start),
+		i_cal_time_get_day (itt_start),
+		i_cal_time_get_hour (itt_start),
+		i_cal_time_get_minute (itt_start),
+		i_cal_time_get_second (itt_start),
+		i_cal_time_get_year (itt_end),
+		i_cal_time_get_month (itt_end),
+		i_cal_time_get_day (itt_end),
+		i_cal_time_get_hour (itt_end),
+		i_cal_time_get_minute (itt_end),
+		i_cal_time_get_second (itt_end));
+
+	g_clear_object (&itt_start);
+	g_clear_object (&itt_end);
+
+	return sexp;
+}
+
+static gboolean
+ecc_search_components_cb (ECalCache *cal_cache,
+			  const gchar *uid,
+			  const gchar *rid,
+			  const gchar *revision,
+			  const gchar *object,
+			  const gchar *extra,
+			  guint32 custom_flags,
+			  EOfflineState offline_state,
+			  gpointer user_data)
+{
+	GSList **out_components = user_data;
+	ECalComponent *comp;
+	gchar *id;
+
+	g_return_val_if_fail (out_components != NULL, FALSE);
+	g_return_val_if_fail (object != NULL, FALSE);
+
+	/* The components were most likely just parsed by the check_sexp() */
+	id = ecc_encode_id_sql (uid, rid);
+	comp = ecc_components_cache_dup_component (cal_cache, id, object);
+	g_free (id);
+
+	if (comp)
+		*out_components = g_slist_prepend (*out_components, comp);
+
+	return TRUE;
+}
+
 /**
  * e_cal_cache_get_components_in_range:
  * @cal_cache: an #ECalCache
@@ -3202,15 +4280,27 @@ e_cal_cache_get_components_in_range (ECalCache *cal_cache,
 				     GCancellable *cancellable,
 				     GError **error)
 {
-	GSList *icalstrings = NULL;
+	gchar *sexp;
 	gboolean success;
 
 	g_return_val_if_fail (E_IS_CAL_CACHE (cal_cache), FALSE);
 	g_return_val_if_fail (out_components != NULL, FALSE);
 
-	success = e_cal_cache_get_components_in_range_as_strings (cal_cache, range_start, range_end, &icalstrings, cancellable, error);
-	if (success)
-		*out_components = ecc_icalstrings_to_components (icalstrings);
+	*out_components = NULL;
+
+	sexp = ecc_dup_range_sexp (range_start, range_end);
+
+	success = e_cal_cache_search_with_callback (cal_cache, sexp, ecc_search_components_cb,
+		out_components, cancellable, error);
+
+	g_free (sexp);
+
+	if (success) {
+		*out_components = g_slist_reverse (*out_components);
+	} else {
+		g_slist_free_full (*out_components, g_object_unref);
+		*out_components = NULL;
+	}
 
 	return success;
 }
@@ -3260,7 +4350,6 @@ e_cal_cache_get_components_in_range_as_strings (ECalCache *cal_cache,
 						GError **error)
 {
 	gchar *sexp;
-	ICalTime *itt_start, *itt_end;
 	gboolean success;
 
 	g_return_val_if_fail (E_IS_CAL_CACHE (cal_cache), FALSE);
@@ -3268,25 +4357,7 @@ e_cal_cache_get_components_in_range_as_strings (ECalCache *cal_cache,
 
 	*out_icalstrings = NULL;
 
-	itt_start = i_cal_time_new_from_timet_with_zone (range_start, FALSE, NULL);
-	itt_end = i_cal_time_new_from_timet_with_zone (range_end, FALSE, NULL);
-
-	sexp = g_strdup_printf ("(occur-in-time-range? (make-time \"%04d%02d%02dT%02d%02d%02dZ\") (make-time \"%04d%02d%02dT%02d%02d%02dZ\"))",
-		i_cal_time_get_year (itt_start),
-		i_cal_time_get_month (itt_start),
-		i_cal_time_get_day (itt_start),
-		i_cal_time_get_hour (itt_start),
-		i_cal_time_get_minute (itt_start),
-		i_cal_time_get_second (itt_start),
-		i_cal_time_get_year (itt_end),
-		i_cal_time_get_month (itt_end),
-		i_cal_time_get_day (itt_end),
-		i_cal_time_get_hour (itt_end),
-		i_cal_time_get_minute (itt_end),
-		i_cal_time_get_second (itt_end));
-
-	g_clear_object (&itt_start);
-	g_clear_object (&itt_end);
+	sexp = ecc_dup_range_sexp (range_start, range_end);
 
 	success = e_cal_cache_search_with_callback (cal_cache, sexp, ecc_search_icalstrings_cb,
 		out_icalstrings, cancellable, error);
@@ -3719,6 +4790,130 @@ e_cal_cache_delete_attachments (ECalCache *cal_cache,
 	return TRUE;
 }
 
+/**
+ * e_cal_cache_set_components_cache_size:
+ * @cal_cache: an #ECalCache
+ * @n_components: how many parsed components to keep in memory, or 0 to not keep any
+ *
+ * Sets how many recently used parsed components the @cal_cache keeps
+ * in memory, to not parse them again when checking them against
+ * the search expressions, which cannot be converted to SQL, or when
+ * returning them from e_cal_cache_get_components_in_range().
+ * The default is 1024 components.
+ *
+ * Since: 3.62
+ **/
+void
+e_cal_cache_set_components_cache_size (ECalCache *cal_cache,
+				       guint n_components)
+{
+	g_return_if_fail (E_IS_CAL_CACHE (cal_cache));
+
+	g_mutex_lock (&cal_cache->priv->comps_lock);
+
+	cal_cache->priv->comps_max = n_components;
+	ecc_components_cache_shrink (cal_cache);
+
+	g_mutex_unlock (&cal_cache->priv->comps_lock);
+}
+
+/**
+ * e_cal_cache_get_components_cache_size:
+ * @cal_cache: an #ECalCache
+ *
+ * Returns: how many parsed components the @cal_cache can keep in memory,
+ *    as set by e_cal_cache_set_components_cache_size()
+ *
+ * Since: 3.62
+ **/
+guint
+e_cal_cache_get_components_cache_size (ECalCache *cal_cache)
+{
+	guint n_components;
+
+	g_return_val_if_fail (E_IS_CAL_CACHE (cal_cache), 0);
+
+	g_mutex_lock (&cal_cache->priv->comps_lock);
+	n_components = cal_cache->priv->comps_max;
+	g_mutex_unlock (&cal_cache->priv->comps_lock);
+
+	return n_components;
+}
+
+/**
+ * e_cal_cache_get_components_cache_stats:
+ * @cal_cache: an #ECalCache
+ * @out_hits: (out) (optional): return location for the count of the cache hits, or %NULL
+ * @out_misses: (out) (optional): return location for the count of the cache misses, or %NULL
+ *
+ * Returns how many times a parsed component had been found in the cache
+ * of the parsed components and how many times it had to be parsed,
+ * since the @cal_cache had been created.
+ *
+ * Since: 3.62
+ **/
+void
+e_cal_cache_get_components_cache_stats (ECalCache *cal_cache,
+					guint64 *out_hits,
+					guint64 *out_misses)
+{
+	g_return_if_fail (E_IS_CAL_CACHE (cal_cache));
+
+	g_mutex_lock (&cal_cache->priv->comps_lock);
+
+	if (out_hits)
+		*out_hits = cal_cache->priv->comps_hits;
+	if (out_misses)
+		*out_misses = cal_cache->priv->comps_misses;
+
+	g_mutex_unlock (&cal_cache->priv->comps_lock);
+}
+
+/* Expands again the components, which use the time zone */
+static gboolean
+ecc_occurrences_timezone_changed (ECalCache *cal_cache,
+				  const gchar *tzid,
+				  gboolean is_replace,
+				  GCancellable *cancellable,
+				  GError **error)
+{
+	ECache *cache = E_CACHE (cal_cache);
+	gint64 horizon_start, horizon_end;
+	gchar *where_clause;
+	gboolean success;
+
+	if (!ecc_occurrences_get_horizon (cal_cache, &horizon_start, &horizon_end))
+		return TRUE;
+
+	e_cache_lock (cache, E_CACHE_LOCK_WRITE);
+
+	if (is_replace) {
+		ICalTimezone *zone = NULL;
+		gchar *key = NULL;
+
+		/* Cannot free the previously loaded zone, because it can be used anywhere */
+		if (g_hash_table_steal_extended (cal_cache->priv->loaded_timezones, tzid, (gpointer *) &key, (gpointer *) &zone)) {
+			cal_cache->priv->replaced_timezones = g_slist_prepend (cal_cache->priv->replaced_timezones, zone);
+			g_free (key);
+		}
+
+		where_clause = e_cache_sqlite_stmt_printf (E_CACHE_FUNC_OBJECT "(" E_CACHE_COLUMN_OBJECT ") LIKE '%%%q%%'", tzid);
+	} else {
+		/* Only the components, which could not resolve it before */
+		where_clause = e_cache_sqlite_stmt_printf (E_CACHE_COLUMN_UID " IN ("
+			"SELECT uid FROM " ECC_TABLE_OCCURRENCES " WHERE kind=" G_STRINGIFY (ECC_OCCURRENCE_UNKNOWN) ")"
+			" AND " E_CACHE_FUNC_OBJECT "(" E_CACHE_COLUMN_OBJECT ") LIKE '%%%q%%'", tzid);
+	}
+
+	success = ecc_occurrences_put_where (cal_cache, where_clause, horizon_start, horizon_end, cancellable, error);
+
+	e_cache_unlock (cache, success ? E_CACHE_UNLOCK_COMMIT : E_CACHE_UNLOCK_ROLLBACK);
+
+	e_cache_sqlite_stmt_free (where_clause);
+
+	return success;
+}
+
 /**
  * e_cal_cache_put_timezone:
  * @cal_cache: an #ECalCache
@@ -3746,7 +4941,7 @@ e_cal_cache_put_timezone (ECalCache *cal_cache,
 {
 	gboolean success;
 	const gchar *tzid;
-	gchar *component_str;
+	gchar *component_str, *old_component_str = NULL;
 	ICalComponent *component;
 
 	g_return_val_if_fail (E_IS_CAL_CACHE (cal_cache), FALSE);
@@ -3775,9 +4970,16 @@ e_cal_cache_put_timezone (ECalCache *cal_cache,
 		return FALSE;
 	}
 
+	if (!e_cal_cache_dup_timezone_as_string (cal_cache, tzid, &old_component_str, cancellable, NULL))
+		g_clear_pointer (&old_component_str, g_free);
+
 	success = e_cache_keys_put_sync (cal_cache->priv->timezones_table,
 		tzid, component_str, inc_ref_counts, cancellable, error);
 
+	if (success && g_strcmp0 (old_component_str, component_str) != 0)
+		success = ecc_occurrences_timezone_changed (cal_cache, tzid, old_component_str != NULL, cancellable, error);
+
+	g_free (old_component_str);
 	g_free (component_str);
 
 	return success;
@@ -4113,6 +5315,14 @@ ecc_empty_aux_tables (ECache *cache,
 
 	cal_cache = E_CAL_CACHE (cache);
 
+	if (cal_cache->priv->texts_enabled &&
+	    (!e_cache_sqlite_exec (cache, "DELETE FROM " ECC_TABLE_TEXTS, cancellable, error) ||
+	     !e_cache_sqlite_exec (cache, "DELETE FROM " ECC_TABLE_TEXTS_UIDS, cancellable, error)))
+		return FALSE;
+
+	if (!e_cache_sqlite_exec (cache, "DELETE FROM " ECC_TABLE_OCCURRENCES, cancellable, error))
+		return FALSE;
+
 	return e_cache_keys_remove_all_sync (cal_cache->priv->timezones_table, cancellable, error);
 }
 
@@ -4185,6 +5395,7 @@ e_cal_cache_put_locked (ECache *cache,
 	GHashTable *timezones = NULL; /* gchar *tzid ~> TimezoneMigrationData * */
 	ECalCache *cal_cache;
 	ECalComponent *comp;
+	gint64 horizon_start, horizon_end;
 	gboolean success;
 
 	g_return_val_if_fail (E_IS_CAL_CACHE (cache), FALSE);
@@ -4210,9 +5421,18 @@ e_cal_cache_put_locked (ECache *cache,
 	success = E_CACHE_CLASS (e_cal_cache_parent_class)->put_locked (cache, uid, revision, object, other_columns, offline_state,
 		is_replace, cancellable, error);
 
+	ecc_components_cache_remove (cal_cache, uid);
+
+	if (success && cal_cache->priv->texts_enabled)
+		success = ecc_texts_put (cal_cache, uid, cancellable, error);
+
 	if (success && timezones)
 		success = ecc_update_timezones_table (cal_cache, timezones, cancellable, error);
 
+	/* After the time zones are stored, to be able to resolve them */
+	if (success && ecc_occurrences_get_horizon (cal_cache, &horizon_start, &horizon_end))
+		success = ecc_occurrences_put (cal_cache, uid, comp, horizon_start, horizon_end, cancellable, error);
+
 	if (timezones)
 		g_hash_table_destroy (timezones);
 
@@ -4244,6 +5464,14 @@ e_cal_cache_remove_locked (ECache *cache,
 
 	success = E_CACHE_CLASS (e_cal_cache_parent_class)->remove_locked (cache, uid, cancellable, error);
 
+	ecc_components_cache_remove (cal_cache, uid);
+
+	if (success && cal_cache->priv->texts_enabled)
+		success = ecc_texts_remove (cal_cache, uid, cancellable, error);
+
+	if (success)
+		success = ecc_occurrences_remove (cal_cache, uid, cancellable, error);
+
 	if (success && timezones)
 		success = ecc_update_timezones_table (cal_cache, timezones, cancellable, error);
 
@@ -4272,6 +5500,8 @@ e_cal_cache_remove_all_locked (ECache *cache,
 
 	success = success && E_CACHE_CLASS (e_cal_cache_parent_class)->remove_all_locked (cache, uids, cancellable, error);
 
+	ecc_components_cache_remove_all (E_CAL_CACHE (cache));
+
 	return success;
 }
 
@@ -4400,8 +5630,12 @@ e_cal_cache_finalize (GObject *object)
 	g_hash_table_destroy (cal_cache->priv->loaded_timezones);
 	g_hash_table_destroy (cal_cache->priv->modified_timezones);
 	g_hash_table_destroy (cal_cache->priv->sexps);
+	g_hash_table_destroy (cal_cache->priv->comps);
+	g_slist_free_full (cal_cache->priv->replaced_timezones, cal_cache_free_zone);
 
 	g_mutex_clear (&cal_cache->priv->sexps_lock);
+	g_mutex_clear (&cal_cache->priv->comps_lock);
+	g_mutex_clear (&cal_cache->priv->occurrences_lock);
 
 	/* Chain up to parent's method. */
 	G_OBJECT_CLASS (e_cal_cache_parent_class)->finalize (object);
@@ -4420,6 +5654,7 @@ e_cal_cache_class_init (ECalCacheClass *klass)
 	cache_class->put_locked = e_cal_cache_put_locked;
 	cache_class->remove_locked = e_cal_cache_remove_locked;
 	cache_class->remove_all_locked = e_cal_cache_remove_all_locked;
+	cache_class->init_connection = e_cal_cache_init_connection;
 
 	klass->dup_component_revision = ecc_dup_component_revision;
 
@@ -4491,4 +5726,10 @@ e_cal_cache_init (ECalCache *cal_cache)
 	cal_cache->priv->sexps = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_object_unref);
 
 	g_mutex_init (&cal_cache->priv->sexps_lock);
+
+	cal_cache->priv->comps = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, components_cache_entry_free);
+	cal_cache->priv->comps_max = ECC_COMPONENTS_CACHE_SIZE;
+
+	g_mutex_init (&cal_cache->priv->comps_lock);
+	g_mutex_init (&cal_cache->priv->occurrences_lock);
 }
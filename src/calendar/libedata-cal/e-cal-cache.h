@@ -317,6 +317,15 @@ gboolean	e_cal_cache_delete_attachments	(ECalCache *cal_cache,
 						 ICalComponent *component,
 						 GCancellable *cancellable,
 						 GError **error);
+void		e_cal_cache_set_components_cache_size
+						(ECalCache *cal_cache,
+						 guint n_components);
+guint		e_cal_cache_get_components_cache_size
+						(ECalCache *cal_cache);
+void		e_cal_cache_get_components_cache_stats
+						(ECalCache *cal_cache,
+						 guint64 *out_hits,
+						 guint64 *out_misses);
 
 gboolean	e_cal_cache_put_timezone	(ECalCache *cal_cache,
 						 const ICalTimezone *zone,
@@ -142,6 +142,29 @@ static gboolean ecmb_save_component_wrapper_sync (ECalMetaBackend *meta_backend,
 						  GCancellable *cancellable,
 						  GError **error);
 
+/* The read-only connections are opened only when asked for in the GSettings,
+   because the write-ahead log weakens the durability of the cache */
+static void
+ecmb_maybe_enable_cache_readers (ECalCache *cache)
+{
+	GSettings *settings;
+	gint n_readers;
+
+	settings = g_settings_new ("org.gnome.evolution-data-server");
+	n_readers = g_settings_get_int (settings, "cache-read-connections");
+	g_clear_object (&settings);
+
+	if (n_readers > 0) {
+		GError *local_error = NULL;
+
+		if (!e_cache_enable_wal_sync (E_CACHE (cache), n_readers, NULL, &local_error)) {
+			g_warning ("%s: Failed to enable the write-ahead log for '%s', the searches will wait for the writes: %s",
+				G_STRFUNC, e_cache_get_filename (E_CACHE (cache)), local_error ? local_error->message : "Unknown error");
+			g_clear_error (&local_error);
+		}
+	}
+}
+
 static gboolean
 ecmb_is_power_saver_enabled (void)
 {
@@ -3900,6 +3923,10 @@ ecmb_cache_get_timezone_cb (ECalCache *cal_cache,
  *
  * Note the @meta_backend adds its own reference to the @cache.
  *
+ * When the "cache-read-connections" GSettings key is larger than zero,
+ * the @cache is switched to the write-ahead log with that many read-only
+ * connections, see e_cache_enable_wal_sync().
+ *
  * Since: 3.26
  **/
 void
@@ -3936,6 +3963,8 @@ e_cal_meta_backend_set_cache (ECalMetaBackend *meta_backend,
 
 	g_mutex_unlock (&meta_backend->priv->property_lock);
 
+	ecmb_maybe_enable_cache_readers (cache);
+
 	g_object_notify_by_pspec (G_OBJECT (meta_backend), properties[PROP_CACHE]);
 }
 
@@ -14,6 +14,10 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 #include <glib/gstdio.h>
 
 #include "camel-block-file.h"
@@ -47,6 +51,15 @@ struct _CamelBlockFilePrivate {
 	gint block_cache_count;
 	GQueue block_cache;
 	GHashTable *blocks;
+
+	/* read-only shared mapping of the file, reads of blocks not in
+	 * the cache are served from it, without a need to have an fd open */
+	gboolean use_mmap;
+	gpointer map;
+	gsize map_size;
+
+	guint n_opens;
+	CamelBlockFileStats stats;
 };
 
 #define CAMEL_BLOCK_FILE_LOCK(kf, lock) (g_mutex_lock(&(kf)->priv->lock))
@@ -65,8 +78,21 @@ static GQueue block_file_active_list = G_QUEUE_INIT;
 static gint block_file_count = 0;
 static gint block_file_threshhold = 10;
 
+/* count of blocks cached by all block files, and how many of them can be cached
+ * over the per-file limits; see camel_block_file_set_shared_cache_limit() */
+static gint block_cache_shared_count = 0;
+static gint block_cache_shared_limit = 4096;
+
+/* at most this many adjacent dirty blocks are written with a single write() */
+#define SYNC_BATCH_BLOCKS (64)
+
+/* the file is mapped again only when it grew at least by this many bytes,
+ * reads of the blocks after the mapped part use the fd until then */
+#define REMAP_MIN_GROWTH (256 * CAMEL_BLOCK_SIZE)
+
 static gint sync_nolock (CamelBlockFile *bs);
 static gint sync_block_nolock (CamelBlockFile *bs, CamelBlock *bl);
+static gint sync_blocks_nolock (CamelBlockFile *bs, GPtrArray *blocks);
 
 G_DEFINE_TYPE_WITH_PRIVATE (CamelBlockFile, camel_block_file, G_TYPE_OBJECT)
 
@@ -135,6 +161,67 @@ block_file_init_root (CamelBlockFile *bs)
 	return 0;
 }
 
+/* call with io_lock held */
+static void
+block_file_unmap_nolock (CamelBlockFile *bs)
+{
+#ifdef HAVE_SYS_MMAN_H
+	if (bs->priv->map) {
+		munmap (bs->priv->map, bs->priv->map_size);
+		bs->priv->map = NULL;
+		bs->priv->map_size = 0;
+	}
+#endif
+}
+
+/* call with io_lock held and the fd opened; maps the file again,
+ * when the block @id is beyond the mapped part and the file grew enough */
+static void
+block_file_map_nolock (CamelBlockFile *bs,
+                       camel_block_t id)
+{
+#ifdef HAVE_SYS_MMAN_H
+	struct stat st;
+	gpointer map;
+
+	if (!bs->priv->use_mmap || bs->priv->fd == -1 ||
+	    (gsize) id + CAMEL_BLOCK_SIZE <= bs->priv->map_size ||
+	    fstat (bs->priv->fd, &st) == -1 ||
+	    (goffset) st.st_size < (goffset) id + CAMEL_BLOCK_SIZE ||
+	    (bs->priv->map && st.st_size - bs->priv->map_size < REMAP_MIN_GROWTH) ||
+	    (guint64) st.st_size > G_MAXSIZE)
+		return;
+
+	block_file_unmap_nolock (bs);
+
+	map = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, bs->priv->fd, 0);
+	if (map == MAP_FAILED) {
+		d (printf ("Cannot map '%s': %s\n", bs->priv->path, g_strerror (errno)));
+		/* do not try again */
+		bs->priv->use_mmap = FALSE;
+		return;
+	}
+
+	bs->priv->map = map;
+	bs->priv->map_size = st.st_size;
+	bs->priv->stats.remaps++;
+#endif
+}
+
+/* call with io_lock held; returns whether the block had been read from the mapping */
+static gboolean
+block_file_read_mapped_nolock (CamelBlockFile *bs,
+                               CamelBlock *bl)
+{
+	if (!bs->priv->map || (gsize) bl->id + CAMEL_BLOCK_SIZE > bs->priv->map_size)
+		return FALSE;
+
+	memcpy (bl->data, ((const guchar *) bs->priv->map) + bl->id, CAMEL_BLOCK_SIZE);
+	bs->priv->stats.mapped_reads++;
+
+	return TRUE;
+}
+
 static void
 block_file_finalize (GObject *object)
 {
@@ -164,6 +251,9 @@ block_file_finalize (GObject *object)
 		g_free (bl);
 	}
 
+	g_atomic_int_add (&block_cache_shared_count, -bs->priv->block_cache_count);
+	block_file_unmap_nolock (bs);
+
 	g_hash_table_destroy (bs->priv->blocks);
 
 	if (bs->priv->root_block)
@@ -210,6 +300,9 @@ camel_block_file_init (CamelBlockFile *bs)
 	/* this cache size and the text index size have been tuned for about the best
 	 * with moderate memory usage.  Doubling the memory usage barely affects performance. */
 	bs->priv->block_cache_limit = 256;
+#ifdef HAVE_SYS_MMAN_H
+	bs->priv->use_mmap = TRUE;
+#endif
 
 	bs->priv->base = bs;
 
@@ -259,6 +352,9 @@ block_file_use (CamelBlockFile *bs)
 		return -1;
 	}
 
+	if (bs->priv->n_opens++ > 0)
+		bs->priv->stats.fd_reopens++;
+
 	LOCK (block_file_lock);
 
 	link = g_queue_find (&block_file_list, bs->priv);
@@ -378,6 +474,8 @@ camel_block_file_new (const gchar *path,
 			g_object_unref (bs);
 			return NULL;
 		}
+		/* the file can shrink, which the mapping cannot cover */
+		block_file_unmap_nolock (bs);
 		if (sync_block_nolock (bs, bs->priv->root_block) == -1
 		    || ftruncate (bs->priv->fd, bs->priv->root->last) == -1) {
 			block_file_unuse (bs);
@@ -456,6 +554,121 @@ camel_block_file_set_cache_limit (CamelBlockFile *bs,
 	bs->priv->block_cache_limit = block_cache_limit;
 }
 
+/**
+ * camel_block_file_get_shared_cache_limit:
+ *
+ * Returns: How many blocks can be cached by all the #CamelBlockFile-s together,
+ *    see camel_block_file_set_shared_cache_limit()
+ *
+ * Since: 3.62
+ **/
+gint
+camel_block_file_get_shared_cache_limit (void)
+{
+	return g_atomic_int_get (&block_cache_shared_limit);
+}
+
+/**
+ * camel_block_file_set_shared_cache_limit:
+ * @block_cache_limit: a new shared block cache limit to set
+ *
+ * Sets how many blocks can be cached by all the #CamelBlockFile-s together.
+ * Each block file can always cache as many blocks as its own limit, set by
+ * camel_block_file_set_cache_limit(), and it can cache more, while the count
+ * of all the cached blocks is below the shared limit. Thus the files being
+ * used the most can use the cache space not needed by the others.
+ *
+ * Use 0 to limit each block file only by its own limit.
+ *
+ * Since: 3.62
+ **/
+void
+camel_block_file_set_shared_cache_limit (gint block_cache_limit)
+{
+	g_atomic_int_set (&block_cache_shared_limit, MAX (block_cache_limit, 0));
+}
+
+/**
+ * camel_block_file_get_use_mmap:
+ * @bs: a #CamelBlockFile
+ *
+ * Returns: Whether the blocks of @bs are read from a memory mapping of the file,
+ *    see camel_block_file_set_use_mmap()
+ *
+ * Since: 3.62
+ **/
+gboolean
+camel_block_file_get_use_mmap (CamelBlockFile *bs)
+{
+	gboolean use_mmap;
+
+	g_return_val_if_fail (CAMEL_IS_BLOCK_FILE (bs), FALSE);
+
+	CAMEL_BLOCK_FILE_LOCK (bs, io_lock);
+	use_mmap = bs->priv->use_mmap;
+	CAMEL_BLOCK_FILE_UNLOCK (bs, io_lock);
+
+	return use_mmap;
+}
+
+/**
+ * camel_block_file_set_use_mmap:
+ * @bs: a #CamelBlockFile
+ * @use_mmap: whether to use the memory mapping
+ *
+ * Sets whether the blocks not found in the cache are read from a read-only
+ * memory mapping of the file, instead of reading them from the file. The mapping
+ * does not need an open file descriptor, thus it is not affected by closing
+ * the file when too many block files are in use. The blocks are always written
+ * with the file descriptor.
+ *
+ * The memory mapping is used by default, where it is supported.
+ *
+ * Since: 3.62
+ **/
+void
+camel_block_file_set_use_mmap (CamelBlockFile *bs,
+                               gboolean use_mmap)
+{
+	g_return_if_fail (CAMEL_IS_BLOCK_FILE (bs));
+
+	CAMEL_BLOCK_FILE_LOCK (bs, io_lock);
+
+#ifdef HAVE_SYS_MMAN_H
+	bs->priv->use_mmap = use_mmap;
+#endif
+
+	if (!bs->priv->use_mmap)
+		block_file_unmap_nolock (bs);
+
+	CAMEL_BLOCK_FILE_UNLOCK (bs, io_lock);
+}
+
+/**
+ * camel_block_file_get_stats:
+ * @bs: a #CamelBlockFile
+ * @out_stats: (out caller-allocates): a #CamelBlockFileStats to fill
+ *
+ * Fills @out_stats with the I/O counters of @bs, for diagnostics.
+ *
+ * Since: 3.62
+ **/
+void
+camel_block_file_get_stats (CamelBlockFile *bs,
+                            CamelBlockFileStats *out_stats)
+{
+	g_return_if_fail (CAMEL_IS_BLOCK_FILE (bs));
+	g_return_if_fail (out_stats != NULL);
+
+	CAMEL_BLOCK_FILE_LOCK (bs, cache_lock);
+	CAMEL_BLOCK_FILE_LOCK (bs, io_lock);
+
+	*out_stats = bs->priv->stats;
+
+	CAMEL_BLOCK_FILE_UNLOCK (bs, io_lock);
+	CAMEL_BLOCK_FILE_UNLOCK (bs, cache_lock);
+}
+
 /**
  * camel_block_file_rename:
  * @bs: a #CamelBlockFile
@@ -524,6 +737,8 @@ camel_block_file_delete (CamelBlockFile *bs)
 		bs->priv->fd = -1;
 	}
 
+	block_file_unmap_nolock (bs);
+
 	bs->priv->deleted = TRUE;
 	ret = g_unlink (bs->priv->path);
 
@@ -605,6 +820,23 @@ camel_block_file_free_block (CamelBlockFile *bs,
 	return 0;
 }
 
+/* call with cache_lock held; whether the cache should shrink,
+ * after @n_evict more blocks had been evicted */
+static gboolean
+block_file_cache_is_over_limit (CamelBlockFile *bs,
+                                gint n_evict)
+{
+	gint shared_limit;
+
+	if (bs->priv->block_cache_count - n_evict <= bs->priv->block_cache_limit)
+		return FALSE;
+
+	/* a busy file can use the cache space left by the others */
+	shared_limit = g_atomic_int_get (&block_cache_shared_limit);
+
+	return shared_limit <= 0 || g_atomic_int_get (&block_cache_shared_count) - n_evict > shared_limit;
+}
+
 /**
  * camel_block_file_get_block: (skip)
  * @bs: a #CamelBlockFile
@@ -640,53 +872,94 @@ camel_block_file_get_block (CamelBlockFile *bs,
 
 	if (bl == NULL) {
 		GQueue trash = G_QUEUE_INIT;
+		GPtrArray *dirty = NULL;
 		GList *link;
+		gboolean mapped;
+		gint n_evict = 0;
 
-		/* LOCK io_lock */
-		if (block_file_use (bs) == -1) {
-			CAMEL_BLOCK_FILE_UNLOCK (bs, cache_lock);
-			return NULL;
-		}
+		bs->priv->stats.cache_misses++;
 
 		bl = g_malloc0 (sizeof (*bl));
 		bl->id = id;
-		if (lseek (bs->priv->fd, id, SEEK_SET) == -1 ||
-		    camel_read (bs->priv->fd, (gchar *) bl->data, CAMEL_BLOCK_SIZE, NULL, NULL) == -1) {
+
+		/* the mapping does not need the fd opened */
+		CAMEL_BLOCK_FILE_LOCK (bs, io_lock);
+		mapped = block_file_read_mapped_nolock (bs, bl);
+		CAMEL_BLOCK_FILE_UNLOCK (bs, io_lock);
+
+		if (!mapped) {
+			/* LOCK io_lock */
+			if (block_file_use (bs) == -1) {
+				CAMEL_BLOCK_FILE_UNLOCK (bs, cache_lock);
+				g_free (bl);
+				return NULL;
+			}
+
+			block_file_map_nolock (bs, id);
+
+			if (!block_file_read_mapped_nolock (bs, bl) &&
+			    (lseek (bs->priv->fd, id, SEEK_SET) == -1 ||
+			    camel_read (bs->priv->fd, (gchar *) bl->data, CAMEL_BLOCK_SIZE, NULL, NULL) == -1)) {
+				block_file_unuse (bs);
+				CAMEL_BLOCK_FILE_UNLOCK (bs, cache_lock);
+				g_free (bl);
+				return NULL;
+			}
+
+			/* UNLOCK io_lock */
 			block_file_unuse (bs);
-			CAMEL_BLOCK_FILE_UNLOCK (bs, cache_lock);
-			g_free (bl);
-			return NULL;
 		}
 
 		bs->priv->block_cache_count++;
+		g_atomic_int_inc (&block_cache_shared_count);
 		g_hash_table_insert (bs->priv->blocks, GUINT_TO_POINTER (bl->id), bl);
 
-		/* flush old blocks */
+		/* pick old blocks to flush */
 		link = g_queue_peek_tail_link (&bs->priv->block_cache);
 
-		while (link != NULL && bs->priv->block_cache_count > bs->priv->block_cache_limit) {
+		while (link != NULL && block_file_cache_is_over_limit (bs, n_evict)) {
 			CamelBlock *flush = link->data;
 
 			if (flush->refcount == 0) {
-				if (sync_block_nolock (bs, flush) != -1) {
-					g_hash_table_remove (bs->priv->blocks, GUINT_TO_POINTER (flush->id));
-					g_queue_push_tail (&trash, link);
-					link->data = NULL;
-					g_free (flush);
-					bs->priv->block_cache_count--;
+				if (flush->flags & CAMEL_BLOCK_DIRTY) {
+					if (!dirty)
+						dirty = g_ptr_array_new ();
+					g_ptr_array_add (dirty, flush);
 				}
+
+				g_queue_push_tail (&trash, link);
+				n_evict++;
 			}
 
 			link = g_list_previous (link);
 		}
 
-		/* Remove deleted blocks from the cache. */
-		while ((link = g_queue_pop_head (&trash)) != NULL)
-			g_queue_delete_link (&bs->priv->block_cache, link);
+		/* write the dirty ones at once, in the file order */
+		if (dirty) {
+			/* LOCK io_lock */
+			if (block_file_use (bs) != -1) {
+				sync_blocks_nolock (bs, dirty);
+				block_file_unuse (bs);
+			}
 
-		/* UNLOCK io_lock */
-		block_file_unuse (bs);
+			g_ptr_array_unref (dirty);
+		}
+
+		/* Remove flushed blocks from the cache; those failed to write are kept. */
+		while ((link = g_queue_pop_head (&trash)) != NULL) {
+			CamelBlock *flush = link->data;
+
+			if (flush->flags & CAMEL_BLOCK_DIRTY)
+				continue;
+
+			g_hash_table_remove (bs->priv->blocks, GUINT_TO_POINTER (flush->id));
+			g_queue_delete_link (&bs->priv->block_cache, link);
+			g_free (flush);
+			bs->priv->block_cache_count--;
+			g_atomic_int_add (&block_cache_shared_count, -1);
+		}
 	} else {
+		bs->priv->stats.cache_hits++;
 		g_queue_remove (&bs->priv->block_cache, bl);
 	}
 
@@ -820,14 +1093,88 @@ sync_block_nolock (CamelBlockFile *bs,
 			return -1;
 		}
 		bl->flags &= ~CAMEL_BLOCK_DIRTY;
+		bs->priv->stats.blocks_written++;
+		bs->priv->stats.write_batches++;
 	}
 
 	return 0;
 }
 
+static gint
+block_compare_id (gconstpointer a,
+                  gconstpointer b)
+{
+	const CamelBlock *bl1 = *((const CamelBlock **) a);
+	const CamelBlock *bl2 = *((const CamelBlock **) b);
+
+	return bl1->id < bl2->id ? -1 : bl1->id > bl2->id ? 1 : 0;
+}
+
+/* Writes dirty @blocks, adjacent blocks with a single write () */
+static gint
+sync_blocks_nolock (CamelBlockFile *bs,
+                    GPtrArray *blocks)
+{
+	guchar *buffer = NULL;
+	guint ii, jj, kk;
+	gint ret = 0;
+
+	g_ptr_array_sort (blocks, block_compare_id);
+
+	for (ii = 0; ii < blocks->len && ret == 0; ii = jj) {
+		CamelBlock *first = blocks->pdata[ii];
+		gsize len;
+
+		for (jj = ii + 1; jj < blocks->len && jj - ii < SYNC_BATCH_BLOCKS; jj++) {
+			CamelBlock *bl = blocks->pdata[jj];
+
+			if (bl->id != first->id + (jj - ii) * CAMEL_BLOCK_SIZE)
+				break;
+		}
+
+		if (jj - ii == 1) {
+			ret = sync_block_nolock (bs, first);
+			continue;
+		}
+
+		if (!buffer)
+			buffer = g_malloc (SYNC_BATCH_BLOCKS * CAMEL_BLOCK_SIZE);
+
+		for (kk = ii; kk < jj; kk++) {
+			CamelBlock *bl = blocks->pdata[kk];
+
+			memcpy (buffer + (kk - ii) * CAMEL_BLOCK_SIZE, bl->data, CAMEL_BLOCK_SIZE);
+		}
+
+		len = (jj - ii) * CAMEL_BLOCK_SIZE;
+
+		d (printf ("Sync %u blocks from %08x\n", jj - ii, first->id));
+
+		if (lseek (bs->priv->fd, first->id, SEEK_SET) == -1
+		    || write (bs->priv->fd, buffer, len) != (gssize) len) {
+			ret = -1;
+			break;
+		}
+
+		for (kk = ii; kk < jj; kk++) {
+			CamelBlock *bl = blocks->pdata[kk];
+
+			bl->flags &= ~CAMEL_BLOCK_DIRTY;
+		}
+
+		bs->priv->stats.blocks_written += jj - ii;
+		bs->priv->stats.write_batches++;
+	}
+
+	g_free (buffer);
+
+	return ret;
+}
+
 static gint
 sync_nolock (CamelBlockFile *bs)
 {
+	GPtrArray *dirty = NULL;
 	GList *head, *link;
 	gint work = FALSE;
 
@@ -837,12 +1184,23 @@ sync_nolock (CamelBlockFile *bs)
 		CamelBlock *bl = link->data;
 
 		if (bl->flags & CAMEL_BLOCK_DIRTY) {
-			work = TRUE;
-			if (sync_block_nolock (bs, bl) == -1)
-				return -1;
+			if (!dirty)
+				dirty = g_ptr_array_new ();
+			g_ptr_array_add (dirty, bl);
 		}
 	}
 
+	if (dirty) {
+		gint ret;
+
+		work = TRUE;
+		ret = sync_blocks_nolock (bs, dirty);
+		g_ptr_array_unref (dirty);
+
+		if (ret == -1)
+			return -1;
+	}
+
 	if (!work
 	    && (bs->priv->root_block->flags & CAMEL_BLOCK_DIRTY) == 0
 	    && (bs->priv->root->flags & CAMEL_BLOCK_FILE_SYNC) != 0)
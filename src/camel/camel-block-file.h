@@ -97,6 +97,31 @@ struct _CamelBlock {
 	guchar data[CAMEL_BLOCK_SIZE];
 };
 
+/**
+ * CamelBlockFileStats:
+ * @cache_hits: count of blocks found in the block cache
+ * @cache_misses: count of blocks, which had to be read
+ * @mapped_reads: count of blocks read from the memory mapping of the file
+ * @remaps: how many times the file had been memory mapped
+ * @fd_reopens: how many times the file had been opened again, after being
+ *    closed due to too many block files in use
+ * @blocks_written: count of written blocks
+ * @write_batches: count of writes done, each can write more adjacent blocks
+ *
+ * I/O counters of a #CamelBlockFile, for diagnostics.
+ *
+ * Since: 3.62
+ **/
+typedef struct _CamelBlockFileStats {
+	guint64 cache_hits;
+	guint64 cache_misses;
+	guint64 mapped_reads;
+	guint64 remaps;
+	guint64 fd_reopens;
+	guint64 blocks_written;
+	guint64 write_batches;
+} CamelBlockFileStats;
+
 struct _CamelBlockFile {
 	GObject parent;
 	CamelBlockFilePrivate *priv;
@@ -122,6 +147,15 @@ CamelBlock *	camel_block_file_get_root_block	(CamelBlockFile *bs);
 gint		camel_block_file_get_cache_limit(CamelBlockFile *bs);
 void		camel_block_file_set_cache_limit(CamelBlockFile *bs,
 						 gint block_cache_limit);
+gint		camel_block_file_get_shared_cache_limit
+						(void);
+void		camel_block_file_set_shared_cache_limit
+						(gint block_cache_limit);
+gboolean	camel_block_file_get_use_mmap	(CamelBlockFile *bs);
+void		camel_block_file_set_use_mmap	(CamelBlockFile *bs,
+						 gboolean use_mmap);
+void		camel_block_file_get_stats	(CamelBlockFile *bs,
+						 CamelBlockFileStats *out_stats);
 gint		camel_block_file_rename		(CamelBlockFile *bs,
 						 const gchar *path);
 gint		camel_block_file_delete		(CamelBlockFile *bs);
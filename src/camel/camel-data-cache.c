@@ -70,6 +70,16 @@
  * once an hour should be enough */
 #define CAMEL_DATA_CACHE_CYCLE_TIME (60*60)
 
+/* when the size limit is reached, expire down to this percentage of it,
+ * to not run the expiry on each added item */
+#define CAMEL_DATA_CACHE_SIZE_LOW_WATERMARK (90)
+
+typedef struct _DataCacheIndexItem {
+	GList link; /* in CamelDataCachePrivate::index_lru, data points to self */
+	gchar *filename;
+	goffset size;
+} DataCacheIndexItem;
+
 struct _CamelDataCachePrivate {
 	CamelObjectBag *busy_bag;
 
@@ -78,8 +88,16 @@ struct _CamelDataCachePrivate {
 	gboolean expire_enabled;
 	time_t expire_age;
 	time_t expire_access;
+	goffset expire_size;
 
 	time_t expire_last[1 << CAMEL_DATA_CACHE_BITS];
+
+	/* used only for the size-based expiry */
+	GMutex index_lock;
+	GHashTable *index; /* gchar *filename ~> DataCacheIndexItem * */
+	gboolean index_scanned; /* whether the existing files had been read into the index */
+	GQueue index_lru; /* DataCacheIndexItem *, the most recently used at the head */
+	goffset index_total_size;
 };
 
 enum {
@@ -93,6 +111,313 @@ static GParamSpec *properties[N_PROPS] = { NULL, };
 
 G_DEFINE_TYPE_WITH_PRIVATE (CamelDataCache, camel_data_cache, G_TYPE_OBJECT)
 
+static void
+data_cache_index_item_free (gpointer ptr)
+{
+	DataCacheIndexItem *item = ptr;
+
+	if (item) {
+		g_free (item->filename);
+		g_free (item);
+	}
+}
+
+/* call with the index_lock held */
+static void
+data_cache_index_clear_locked (CamelDataCache *cdc)
+{
+	g_queue_init (&cdc->priv->index_lru);
+	g_hash_table_remove_all (cdc->priv->index);
+	cdc->priv->index_scanned = FALSE;
+	cdc->priv->index_total_size = 0;
+}
+
+/* call with the index_lock held */
+static void
+data_cache_index_remove_locked (CamelDataCache *cdc,
+				const gchar *filename)
+{
+	DataCacheIndexItem *item;
+
+	item = g_hash_table_lookup (cdc->priv->index, filename);
+	if (item) {
+		g_queue_unlink (&cdc->priv->index_lru, &item->link);
+		cdc->priv->index_total_size -= item->size;
+		g_hash_table_remove (cdc->priv->index, filename);
+	}
+}
+
+static void
+data_cache_index_remove (CamelDataCache *cdc,
+			 const gchar *filename)
+{
+	g_mutex_lock (&cdc->priv->index_lock);
+	data_cache_index_remove_locked (cdc, filename);
+	g_mutex_unlock (&cdc->priv->index_lock);
+}
+
+/* call with the index_lock held; moves the item to the head of the LRU
+ * queue, creating it when needed; the @size can be -1 to keep the size
+ * of the already known item or to read it from the disk */
+static DataCacheIndexItem *
+data_cache_index_touch_locked (CamelDataCache *cdc,
+			       const gchar *filename,
+			       goffset size)
+{
+	DataCacheIndexItem *item;
+
+	if (size < 0) {
+		item = g_hash_table_lookup (cdc->priv->index, filename);
+
+		if (item) {
+			size = item->size;
+		} else {
+			struct stat st;
+
+			if (g_stat (filename, &st) != 0 || !S_ISREG (st.st_mode))
+				return NULL;
+
+			size = st.st_size;
+		}
+	}
+
+	item = g_hash_table_lookup (cdc->priv->index, filename);
+	if (item) {
+		g_queue_unlink (&cdc->priv->index_lru, &item->link);
+		cdc->priv->index_total_size -= item->size;
+	} else {
+		item = g_new0 (DataCacheIndexItem, 1);
+		item->link.data = item;
+		item->filename = g_strdup (filename);
+
+		g_hash_table_insert (cdc->priv->index, item->filename, item);
+	}
+
+	item->size = size;
+	cdc->priv->index_total_size += size;
+
+	g_queue_push_head_link (&cdc->priv->index_lru, &item->link);
+
+	return item;
+}
+
+typedef struct _ScannedFile {
+	gchar *filename;
+	goffset size;
+	time_t atime;
+} ScannedFile;
+
+static gint
+data_cache_compare_scanned_files (gconstpointer ptr1,
+				  gconstpointer ptr2)
+{
+	const ScannedFile *sf1 = ptr1, *sf2 = ptr2;
+
+	if (sf1->atime == sf2->atime)
+		return 0;
+
+	return sf1->atime < sf2->atime ? -1 : 1;
+}
+
+/* the hash directories are named by data_cache_build_dir() */
+static gboolean
+data_cache_is_hash_dir_name (const gchar *name)
+{
+	return g_ascii_isxdigit (name[0]) && !g_ascii_isupper (name[0]) &&
+		g_ascii_isxdigit (name[1]) && !g_ascii_isupper (name[1]) && !name[2] &&
+		((g_ascii_xdigit_value (name[0]) << 4) | g_ascii_xdigit_value (name[1])) <= CAMEL_DATA_CACHE_MASK;
+}
+
+/* reads the regular files of the hash directory @dpath into @files */
+static void
+data_cache_scan_hash_dir (const gchar *dpath,
+			  GArray *files)
+{
+	const gchar *fname;
+	GDir *dir;
+
+	dir = g_dir_open (dpath, 0, NULL);
+	if (!dir)
+		return;
+
+	while ((fname = g_dir_read_name (dir))) {
+		gchar *filename;
+		struct stat st;
+
+		filename = g_build_filename (dpath, fname, NULL);
+
+		if (g_stat (filename, &st) == 0 && S_ISREG (st.st_mode)) {
+			ScannedFile sf;
+
+			sf.filename = filename;
+			sf.size = st.st_size;
+			sf.atime = MAX (st.st_atime, st.st_mtime);
+
+			g_array_append_val (files, sf);
+		} else {
+			g_free (filename);
+		}
+	}
+
+	g_dir_close (dir);
+}
+
+/* reads the files of the sub-cache directory @base_path into @files; returns
+ * FALSE and leaves @files untouched, when the directory does not look like
+ * a sub-cache, like when other data is stored beside the cache */
+static gboolean
+data_cache_scan_sub_cache (const gchar *base_path,
+			   GArray *files)
+{
+	GPtrArray *hash_dirs;
+	const gchar *dname;
+	GDir *base_dir;
+	gboolean is_sub_cache = TRUE;
+	guint ii;
+
+	base_dir = g_dir_open (base_path, 0, NULL);
+	if (!base_dir)
+		return FALSE;
+
+	hash_dirs = g_ptr_array_new_with_free_func (g_free);
+
+	while (is_sub_cache && (dname = g_dir_read_name (base_dir))) {
+		gchar *dpath;
+
+		dpath = g_build_filename (base_path, dname, NULL);
+
+		if (data_cache_is_hash_dir_name (dname) && g_file_test (dpath, G_FILE_TEST_IS_DIR)) {
+			g_ptr_array_add (hash_dirs, dpath);
+		} else {
+			is_sub_cache = FALSE;
+			g_free (dpath);
+		}
+	}
+
+	g_dir_close (base_dir);
+
+	for (ii = 0; is_sub_cache && ii < hash_dirs->len; ii++) {
+		data_cache_scan_hash_dir (hash_dirs->pdata[ii], files);
+	}
+
+	g_ptr_array_unref (hash_dirs);
+
+	return is_sub_cache;
+}
+
+/* call with the index_lock held; reads existing files of all the sub-caches
+ * into the index, which is done only once, then the index is kept up to date
+ * by the cache operations */
+static void
+data_cache_index_scan_locked (CamelDataCache *cdc)
+{
+	GArray *files;
+	GDir *dir;
+	const gchar *dname;
+	guint ii;
+
+	if (cdc->priv->index_scanned)
+		return;
+
+	cdc->priv->index_scanned = TRUE;
+
+	dir = g_dir_open (cdc->priv->path, 0, NULL);
+	if (!dir)
+		return;
+
+	files = g_array_new (FALSE, FALSE, sizeof (ScannedFile));
+
+	while ((dname = g_dir_read_name (dir))) {
+		gchar *base_path;
+
+		base_path = g_build_filename (cdc->priv->path, dname, NULL);
+		data_cache_scan_sub_cache (base_path, files);
+		g_free (base_path);
+	}
+
+	g_dir_close (dir);
+
+	/* the most recently accessed files are added as the last,
+	 * thus they end at the head of the LRU queue */
+	g_array_sort (files, data_cache_compare_scanned_files);
+
+	for (ii = 0; ii < files->len; ii++) {
+		ScannedFile *sf = &g_array_index (files, ScannedFile, ii);
+
+		/* do not override what had been touched in the meantime */
+		if (!g_hash_table_contains (cdc->priv->index, sf->filename))
+			data_cache_index_touch_locked (cdc, sf->filename, sf->size);
+
+		g_free (sf->filename);
+	}
+
+	g_array_unref (files);
+}
+
+/* Records an access to the @filename and expires the least recently
+ * used items, when the size limit is exceeded. */
+static void
+data_cache_index_touch (CamelDataCache *cdc,
+			const gchar *filename,
+			goffset size)
+{
+	DataCacheIndexItem *touched;
+	GSList *expired = NULL, *link;
+	goffset expire_to;
+
+	if (!cdc->priv->expire_enabled || cdc->priv->expire_size < 0)
+		return;
+
+	g_mutex_lock (&cdc->priv->index_lock);
+
+	data_cache_index_scan_locked (cdc);
+
+	touched = data_cache_index_touch_locked (cdc, filename, size);
+
+	if (cdc->priv->index_total_size > cdc->priv->expire_size) {
+		expire_to = cdc->priv->expire_size * CAMEL_DATA_CACHE_SIZE_LOW_WATERMARK / 100;
+
+		while (cdc->priv->index_total_size > expire_to) {
+			DataCacheIndexItem *item;
+			GList *lru_link;
+
+			lru_link = g_queue_peek_tail_link (&cdc->priv->index_lru);
+			if (!lru_link)
+				break;
+
+			item = lru_link->data;
+
+			/* never expire what had been just added or read */
+			if (item == touched)
+				break;
+
+			d (printf ("Expiring '%s' of size %" G_GOFFSET_FORMAT " due to size limit\n", item->filename, item->size));
+
+			expired = g_slist_prepend (expired, g_strdup (item->filename));
+
+			data_cache_index_remove_locked (cdc, item->filename);
+		}
+	}
+
+	g_mutex_unlock (&cdc->priv->index_lock);
+
+	/* the busy bag can block on a pending reservation, thus do not hold the index lock here */
+	for (link = expired; link; link = g_slist_next (link)) {
+		const gchar *expired_filename = link->data;
+		GIOStream *stream;
+
+		g_unlink (expired_filename);
+
+		stream = camel_object_bag_get (cdc->priv->busy_bag, expired_filename);
+		if (stream) {
+			camel_object_bag_remove (cdc->priv->busy_bag, stream);
+			g_object_unref (stream);
+		}
+	}
+
+	g_slist_free_full (expired, g_free);
+}
+
 static void
 data_cache_set_property (GObject *object,
                          guint property_id,
@@ -149,6 +474,10 @@ data_cache_finalize (GObject *object)
 	camel_object_bag_destroy (priv->busy_bag);
 	g_free (priv->path);
 
+	g_queue_init (&priv->index_lru);
+	g_hash_table_destroy (priv->index);
+	g_mutex_clear (&priv->index_lock);
+
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (camel_data_cache_parent_class)->finalize (object);
 }
@@ -209,6 +538,11 @@ camel_data_cache_init (CamelDataCache *data_cache)
 	data_cache->priv->expire_enabled = TRUE;
 	data_cache->priv->expire_age = -1;
 	data_cache->priv->expire_access = -1;
+	data_cache->priv->expire_size = -1;
+
+	g_mutex_init (&data_cache->priv->index_lock);
+	g_queue_init (&data_cache->priv->index_lru);
+	data_cache->priv->index = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, data_cache_index_item_free);
 }
 
 /**
@@ -277,6 +611,10 @@ camel_data_cache_set_path (CamelDataCache *cdc,
 	g_free (cdc->priv->path);
 	cdc->priv->path = g_strdup (path);
 
+	g_mutex_lock (&cdc->priv->index_lock);
+	data_cache_index_clear_locked (cdc);
+	g_mutex_unlock (&cdc->priv->index_lock);
+
 	g_object_notify_by_pspec (G_OBJECT (cdc), properties[PROP_PATH]);
 }
 
@@ -379,6 +717,63 @@ camel_data_cache_set_expire_access (CamelDataCache *cdc,
 	cdc->priv->expire_access = when;
 }
 
+/**
+ * camel_data_cache_set_expire_size:
+ * @cdc: A #CamelDataCache
+ * @max_size: maximum size of the cache, in bytes, or -1 to disable size expiry
+ *
+ * Set the cache expiration policy for the total size of the cache.
+ *
+ * When the cached items take more than @max_size bytes, then the least
+ * recently used items are removed, until the cache is below the limit
+ * again. Unlike the age and access expiry, the size expiry is done
+ * immediately, when an item is added to or read from the cache, using
+ * an in-memory index of the items, which is populated only once, from all
+ * the sub-caches, thus the cache directories are not traversed repeatedly.
+ *
+ * The size expiry works together with the age and access limits.
+ *
+ * Since: 3.62
+ **/
+void
+camel_data_cache_set_expire_size (CamelDataCache *cdc,
+				  goffset max_size)
+{
+	g_return_if_fail (CAMEL_IS_DATA_CACHE (cdc));
+
+	if (max_size < 0)
+		max_size = -1;
+
+	g_mutex_lock (&cdc->priv->index_lock);
+
+	if (cdc->priv->expire_size != max_size) {
+		cdc->priv->expire_size = max_size;
+
+		/* start from scratch next time, to not work with stale data */
+		data_cache_index_clear_locked (cdc);
+	}
+
+	g_mutex_unlock (&cdc->priv->index_lock);
+}
+
+/**
+ * camel_data_cache_get_expire_size:
+ * @cdc: A #CamelDataCache
+ *
+ * Returns the maximum size of the cache, as set by camel_data_cache_set_expire_size().
+ *
+ * Returns: maximum size of the cache, in bytes, or -1, when the size expiry is disabled
+ *
+ * Since: 3.62
+ **/
+goffset
+camel_data_cache_get_expire_size (CamelDataCache *cdc)
+{
+	g_return_val_if_fail (CAMEL_IS_DATA_CACHE (cdc), -1);
+
+	return cdc->priv->expire_size;
+}
+
 static void
 data_cache_expire (CamelDataCache *cdc,
                    const gchar *path,
@@ -409,6 +804,7 @@ data_cache_expire (CamelDataCache *cdc,
 			|| (cdc->priv->expire_age != -1 && st.st_mtime + cdc->priv->expire_age < now)
 			|| (cdc->priv->expire_access != -1 && st.st_atime + cdc->priv->expire_access < now))) {
 			g_unlink (dpath);
+			data_cache_index_remove (cdc, dpath);
 			stream = camel_object_bag_get (cdc->priv->busy_bag, dpath);
 			if (stream) {
 				camel_object_bag_remove (cdc->priv->busy_bag, stream);
@@ -421,6 +817,21 @@ data_cache_expire (CamelDataCache *cdc,
 	g_dir_close (dir);
 }
 
+/* All the file names in the cache are built with g_build_filename(), thus
+ * they can be used as the keys of the busy bag and of the index, regardless
+ * whether they come from data_cache_path() or from a directory traversal. */
+static gchar *
+data_cache_build_dir (CamelDataCache *cdc,
+		      const gchar *path,
+		      guint32 hash)
+{
+	gchar hash_name[8];
+
+	g_snprintf (hash_name, sizeof (hash_name), "%02x", hash);
+
+	return g_build_filename (cdc->priv->path, path, hash_name, NULL);
+}
+
 /* Since we have to stat the directory anyway, we use this opportunity to
  * lazily expire old data.
  * If it is this directories 'turn', and we haven't done it for CYCLE_TIME seconds,
@@ -432,14 +843,11 @@ data_cache_path (CamelDataCache *cdc,
                  const gchar *key)
 {
 	gchar *dir, *real, *tmp;
-	gsize dir_len;
 	guint32 hash;
 
 	hash = g_str_hash (key);
 	hash = (hash >> 5) &CAMEL_DATA_CACHE_MASK;
-	dir_len = strlen (cdc->priv->path) + strlen (path) + 8;
-	dir = alloca (dir_len);
-	g_snprintf (dir, dir_len, "%s/%s/%02x", cdc->priv->path, path, hash);
+	dir = data_cache_build_dir (cdc, path, hash);
 
 	if (g_access (dir, F_OK) == -1) {
 		if (create)
@@ -456,8 +864,9 @@ data_cache_path (CamelDataCache *cdc,
 	}
 
 	tmp = camel_file_util_safe_filename (key);
-	real = g_strdup_printf ("%s/%s", dir, tmp);
+	real = g_build_filename (dir, tmp, NULL);
 	g_free (tmp);
+	g_free (dir);
 
 	return real;
 }
@@ -621,6 +1030,9 @@ camel_data_cache_commit_atomic (CamelDataCache *cdc,
 	else
 		camel_object_bag_abort (cdc->priv->busy_bag, adata->final_path);
 
+	if (result != NULL)
+		data_cache_index_touch (cdc, adata->final_path, -1);
+
 	camel_dc_atomic_data_free (adata);
 
 	return result ? G_IO_STREAM (result) : NULL;
@@ -685,6 +1097,7 @@ camel_data_cache_get (CamelDataCache *cdc,
 	GFile *file;
 	struct stat st;
 	gchar *real;
+	goffset size = -1;
 
 	g_return_val_if_fail (CAMEL_IS_DATA_CACHE (cdc), NULL);
 
@@ -694,7 +1107,7 @@ camel_data_cache_get (CamelDataCache *cdc,
 		goto exit;
 
 	/* An empty cache file is useless.  Return an error. */
-	if (g_stat (real, &st) == 0 && st.st_size == 0) {
+	if (g_stat (real, &st) == 0 && (size = st.st_size) == 0) {
 		g_set_error (
 			error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
 			_("Cache file “%s” is empty"), real);
@@ -712,6 +1125,9 @@ camel_data_cache_get (CamelDataCache *cdc,
 		camel_object_bag_abort (cdc->priv->busy_bag, real);
 
 exit:
+	if (stream != NULL)
+		data_cache_index_touch (cdc, real, size);
+
 	g_free (real);
 
 	return stream ? G_IO_STREAM (stream) : NULL;
@@ -769,6 +1185,8 @@ camel_data_cache_remove (CamelDataCache *cdc,
 		g_object_unref (stream);
 	}
 
+	data_cache_index_remove (cdc, real);
+
 	/* maybe we were a mem stream */
 	if (g_unlink (real) == -1 && errno != ENOENT) {
 		g_set_error (
@@ -858,6 +1276,7 @@ data_cache_foreach_remove (CamelDataCache *cdc,
 		    && S_ISREG (st.st_mode)
 		    && func (cdc, filename, user_data)) {
 			g_unlink (filename);
+			data_cache_index_remove (cdc, filename);
 			stream = camel_object_bag_get (cdc->priv->busy_bag, filename);
 			if (stream) {
 				camel_object_bag_remove (cdc->priv->busy_bag, stream);
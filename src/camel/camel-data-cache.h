@@ -84,6 +84,11 @@ void		camel_data_cache_set_expire_age	(CamelDataCache *cdc,
 void		camel_data_cache_set_expire_access
 						(CamelDataCache *cdc,
 						 time_t when);
+void		camel_data_cache_set_expire_size
+						(CamelDataCache *cdc,
+						 goffset max_size);
+goffset		camel_data_cache_get_expire_size
+						(CamelDataCache *cdc);
 GIOStream *	camel_data_cache_get		(CamelDataCache *cdc,
 						 const gchar *path,
 						 const gchar *key,
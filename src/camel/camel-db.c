@@ -33,6 +33,9 @@
 #define CAMEL_DB_FREE_CACHE_SIZE 2 * 1024 * 1024
 #define CAMEL_DB_SLEEP_INTERVAL 1 * 10 * 10
 
+/* how many free pages one incremental vacuum step releases */
+#define CAMEL_DB_VACUUM_STEP_PAGES 256
+
 G_DEFINE_QUARK (camel-db-error-quark, camel_db_error)
 
 static sqlite3_vfs *old_vfs = NULL;
@@ -488,8 +491,19 @@ struct _CamelDBPrivate {
 	GThread *transaction_thread;
 	guint32 transaction_level;
 	gboolean is_foldersdb;
+	gint64 last_access_time; /* guarded by transaction_lock */
+
+	GMutex maintenance_lock;
+	guint maintenance_phase; /* CamelDBMaintenancePhase */
+	guint64 maintenance_freelist_count; /* free pages at the start of the vacuum phase */
 };
 
+typedef enum {
+	CAMEL_DB_MAINTENANCE_PHASE_VACUUM = 0,
+	CAMEL_DB_MAINTENANCE_PHASE_ANALYZE,
+	CAMEL_DB_MAINTENANCE_PHASE_DONE
+} CamelDBMaintenancePhase;
+
 G_DEFINE_TYPE_WITH_PRIVATE (CamelDB, camel_db, G_TYPE_OBJECT)
 
 static void
@@ -500,6 +514,7 @@ camel_db_finalize (GObject *object)
 	sqlite3_close (cdb->priv->db);
 	g_rw_lock_clear (&cdb->priv->rwlock);
 	g_mutex_clear (&cdb->priv->transaction_lock);
+	g_mutex_clear (&cdb->priv->maintenance_lock);
 	g_free (cdb->priv->filename);
 
 	d (g_print ("\nDatabase successfully closed \n"));
@@ -524,9 +539,12 @@ camel_db_init (CamelDB *cdb)
 
 	g_rw_lock_init (&cdb->priv->rwlock);
 	g_mutex_init (&cdb->priv->transaction_lock);
+	g_mutex_init (&cdb->priv->maintenance_lock);
 	cdb->priv->transaction_thread = NULL;
 	cdb->priv->transaction_level = 0;
 	cdb->priv->timer = NULL;
+	cdb->priv->last_access_time = g_get_monotonic_time ();
+	cdb->priv->maintenance_phase = CAMEL_DB_MAINTENANCE_PHASE_VACUUM;
 }
 
 /*
@@ -645,6 +663,7 @@ camel_db_writer_lock (CamelDB *cdb)
 	}
 
 	cdb->priv->transaction_level++;
+	cdb->priv->last_access_time = g_get_monotonic_time ();
 
 	g_mutex_unlock (&cdb->priv->transaction_lock);
 }
@@ -669,6 +688,7 @@ camel_db_writer_unlock (CamelDB *cdb)
 	g_warn_if_fail (cdb->priv->transaction_level > 0);
 
 	cdb->priv->transaction_level--;
+	cdb->priv->last_access_time = g_get_monotonic_time ();
 
 	if (!cdb->priv->transaction_level) {
 		cdb->priv->transaction_thread = NULL;
@@ -697,6 +717,7 @@ camel_db_reader_lock (CamelDB *cdb)
 	g_return_if_fail (cdb != NULL);
 
 	g_mutex_lock (&cdb->priv->transaction_lock);
+	cdb->priv->last_access_time = g_get_monotonic_time ();
 	if (cdb->priv->transaction_thread == g_thread_self ()) {
 		/* already holding write lock */
 		g_mutex_unlock (&cdb->priv->transaction_lock);
@@ -722,6 +743,7 @@ camel_db_reader_unlock (CamelDB *cdb)
 	g_return_if_fail (cdb != NULL);
 
 	g_mutex_lock (&cdb->priv->transaction_lock);
+	cdb->priv->last_access_time = g_get_monotonic_time ();
 	if (cdb->priv->transaction_thread == g_thread_self ()) {
 		/* already holding write lock */
 		g_mutex_unlock (&cdb->priv->transaction_lock);
@@ -873,6 +895,12 @@ camel_db_open (CamelDB *cdb,
 	if (cdb_sqlite_error_code == SQLITE_OK)
 		camel_db_command_internal (cdb, "ATTACH DATABASE ':memory:' AS mem", &cdb_sqlite_error_code, &local_error);
 
+	/* Lets the free pages be released in small steps by camel_db_run_maintenance_slice().
+	   It takes effect immediately only for new files, existing files are converted
+	   by the first maintenance, with a full VACUUM. */
+	if (cdb_sqlite_error_code == SQLITE_OK)
+		camel_db_command_internal (cdb, "PRAGMA main.auto_vacuum = INCREMENTAL", &cdb_sqlite_error_code, &local_error);
+
 	if (cdb_sqlite_error_code == SQLITE_OK && g_getenv ("CAMEL_SQLITE_IN_MEMORY") != NULL) {
 		/* Optionally turn off Journaling, this gets over fsync issues, but could be risky */
 		camel_db_command_internal (cdb, "PRAGMA main.journal_mode = off", &cdb_sqlite_error_code, &local_error);
@@ -1369,6 +1397,17 @@ get_number_cb (gpointer data,
 	return 0;
 }
 
+static gboolean
+cdb_read_number (CamelDB *cdb,
+		 const gchar *stmt,
+		 guint64 *out_value,
+		 GError **error)
+{
+	*out_value = 0;
+
+	return cdb_sql_exec (cdb, stmt, get_number_cb, out_value, NULL, error);
+}
+
 /**
  * camel_db_maybe_run_maintenance:
  * @cdb: a #CamelDB
@@ -1376,6 +1415,11 @@ get_number_cb (gpointer data,
  *
  * Runs a @cdb maintenance, which includes vacuum, if necessary.
  *
+ * When the file uses incremental auto-vacuum all its free pages are
+ * released, otherwise a full VACUUM is done, which also converts the file
+ * to the incremental auto-vacuum. The full VACUUM can take a long time on
+ * large files, consider camel_db_run_maintenance_slice() instead.
+ *
  * Returns: Whether succeeded.
  *
  * Since: 3.16
@@ -1385,7 +1429,7 @@ camel_db_maybe_run_maintenance (CamelDB *cdb,
 				GError **error)
 {
 	GError *local_error = NULL;
-	guint64 page_count = 0, page_size = 0, freelist_count = 0;
+	guint64 page_count = 0, page_size = 0, freelist_count = 0, auto_vacuum = 0;
 	gboolean success = TRUE;
 
 	g_return_val_if_fail (CAMEL_IS_DB (cdb), FALSE);
@@ -1394,12 +1438,18 @@ camel_db_maybe_run_maintenance (CamelDB *cdb,
 	   the VACUUM cannot run in the transaction. */
 	g_rw_lock_writer_lock (&cdb->priv->rwlock);
 
-	if (cdb_sql_exec (cdb, "PRAGMA page_count;", get_number_cb, &page_count, NULL, &local_error) == SQLITE_OK &&
-	    cdb_sql_exec (cdb, "PRAGMA page_size;", get_number_cb, &page_size, NULL, &local_error) == SQLITE_OK &&
-	    cdb_sql_exec (cdb, "PRAGMA freelist_count;", get_number_cb, &freelist_count, NULL, &local_error) == SQLITE_OK) {
+	if (cdb_read_number (cdb, "PRAGMA page_count;", &page_count, &local_error) &&
+	    cdb_read_number (cdb, "PRAGMA page_size;", &page_size, &local_error) &&
+	    cdb_read_number (cdb, "PRAGMA freelist_count;", &freelist_count, &local_error) &&
+	    cdb_read_number (cdb, "PRAGMA auto_vacuum;", &auto_vacuum, &local_error)) {
 		/* Vacuum, if there's more than 5% of the free pages, or when free pages use more than 10MB */
-		success = !page_count || !freelist_count || (freelist_count * page_size < 1024 * 1024 * 10 && freelist_count * 1000 / page_count <= 50) ||
-		    cdb_sql_exec (cdb, "vacuum;", NULL, NULL, NULL, &local_error) == SQLITE_OK;
+		if (!page_count || !freelist_count || (freelist_count * page_size < 1024 * 1024 * 10 && freelist_count * 1000 / page_count <= 50))
+			success = TRUE;
+		else if (auto_vacuum == 2 /* INCREMENTAL */)
+			success = cdb_sql_exec (cdb, "PRAGMA incremental_vacuum;", NULL, NULL, NULL, &local_error);
+		else
+			success = cdb_sql_exec (cdb, "PRAGMA auto_vacuum = INCREMENTAL;", NULL, NULL, NULL, &local_error) &&
+				cdb_sql_exec (cdb, "vacuum;", NULL, NULL, NULL, &local_error);
 	}
 
 	/* Do not call camel_db_writer_unlock() here, because ... see above */
@@ -1413,6 +1463,212 @@ camel_db_maybe_run_maintenance (CamelDB *cdb,
 	return success;
 }
 
+/**
+ * camel_db_get_idle_time:
+ * @cdb: a #CamelDB
+ *
+ * Returns how long the @cdb had not been used, in microseconds. It's zero
+ * while a transaction is in progress. Maintenance done by
+ * camel_db_run_maintenance_slice() does not count as a use.
+ *
+ * Returns: for how many microseconds the @cdb had not been used
+ *
+ * Since: 3.62
+ **/
+gint64
+camel_db_get_idle_time (CamelDB *cdb)
+{
+	gint64 idle_time;
+
+	g_return_val_if_fail (CAMEL_IS_DB (cdb), 0);
+
+	g_mutex_lock (&cdb->priv->transaction_lock);
+
+	if (cdb->priv->transaction_thread)
+		idle_time = 0;
+	else
+		idle_time = MAX (g_get_monotonic_time () - cdb->priv->last_access_time, 0);
+
+	g_mutex_unlock (&cdb->priv->transaction_lock);
+
+	return idle_time;
+}
+
+/* Runs one step of the current maintenance phase; the caller holds the writer lock */
+static gboolean
+cdb_maintenance_step (CamelDB *cdb,
+		      guint64 *inout_reclaimed_bytes,
+		      GError **error)
+{
+	guint64 page_size = 0, freelist_count = 0, auto_vacuum = 0;
+
+	switch (cdb->priv->maintenance_phase) {
+	case CAMEL_DB_MAINTENANCE_PHASE_VACUUM:
+		if (!cdb_read_number (cdb, "PRAGMA auto_vacuum;", &auto_vacuum, error) ||
+		    !cdb_read_number (cdb, "PRAGMA freelist_count;", &freelist_count, error))
+			return FALSE;
+
+		/* Files created before the incremental auto-vacuum was enabled are
+		   converted once; it requires a full VACUUM, which cannot be split */
+		if (auto_vacuum != 2 /* INCREMENTAL */) {
+			guint64 page_count_before = 0, page_count_after = 0;
+
+			if (!cdb_read_number (cdb, "PRAGMA page_size;", &page_size, error) ||
+			    !cdb_read_number (cdb, "PRAGMA page_count;", &page_count_before, error) ||
+			    !cdb_sql_exec (cdb, "PRAGMA auto_vacuum = INCREMENTAL;", NULL, NULL, NULL, error) ||
+			    !cdb_sql_exec (cdb, "vacuum;", NULL, NULL, NULL, error) ||
+			    !cdb_read_number (cdb, "PRAGMA page_count;", &page_count_after, error))
+				return FALSE;
+
+			if (page_count_after < page_count_before)
+				*inout_reclaimed_bytes += (page_count_before - page_count_after) * page_size;
+
+			/* the VACUUM released all the free pages */
+			cdb->priv->maintenance_phase = CAMEL_DB_MAINTENANCE_PHASE_ANALYZE;
+			break;
+		}
+
+		if (freelist_count > 0) {
+			guint64 freelist_after = 0;
+			gchar *stmt;
+			gboolean success;
+
+			if (!cdb_read_number (cdb, "PRAGMA page_size;", &page_size, error))
+				return FALSE;
+
+			if (cdb->priv->maintenance_freelist_count < freelist_count)
+				cdb->priv->maintenance_freelist_count = freelist_count;
+
+			stmt = g_strdup_printf ("PRAGMA incremental_vacuum(%d);", CAMEL_DB_VACUUM_STEP_PAGES);
+			success = cdb_sql_exec (cdb, stmt, NULL, NULL, NULL, error) &&
+				cdb_read_number (cdb, "PRAGMA freelist_count;", &freelist_after, error);
+			g_free (stmt);
+
+			if (!success)
+				return FALSE;
+
+			if (freelist_after < freelist_count)
+				*inout_reclaimed_bytes += (freelist_count - freelist_after) * page_size;
+
+			if (freelist_after > 0)
+				break;
+		}
+
+		cdb->priv->maintenance_phase = CAMEL_DB_MAINTENANCE_PHASE_ANALYZE;
+		break;
+	case CAMEL_DB_MAINTENANCE_PHASE_ANALYZE:
+		/* Refreshes the statistics of the tables and indexes, which changed
+		   enough since the last run; the analysis_limit bounds the time of it */
+		if (!cdb_sql_exec (cdb, "PRAGMA analysis_limit = 1000; PRAGMA optimize;", NULL, NULL, NULL, error))
+			return FALSE;
+
+		cdb->priv->maintenance_phase = CAMEL_DB_MAINTENANCE_PHASE_DONE;
+		break;
+	default:
+		break;
+	}
+
+	return TRUE;
+}
+
+/**
+ * camel_db_run_maintenance_slice:
+ * @cdb: a #CamelDB
+ * @max_usec: how long the slice can take, in microseconds
+ * @out_finished: (out) (optional): set to %TRUE, when the whole maintenance is done
+ * @out_percent: (out) (optional): set to the overall progress of the maintenance, in percents
+ * @out_reclaimed_bytes: (out) (optional): set to how many bytes the slice released from the file
+ * @error: a #GError or %NULL
+ *
+ * Runs a part of the @cdb maintenance, which takes about @max_usec
+ * microseconds. The maintenance releases the free pages from the file with
+ * the incremental vacuum and then refreshes the statistics used by the query
+ * planner. The work is done in small steps and the @cdb is unlocked between
+ * them, thus other users of the @cdb are not blocked for long.
+ *
+ * A file, which does not use the incremental auto-vacuum yet, is converted
+ * to it by the first maintenance. The conversion is a full VACUUM, which is
+ * done at once and can take longer than @max_usec, but only once per file.
+ *
+ * Call the function repeatedly, until the @out_finished is set to %TRUE;
+ * the next call after that starts a new maintenance.
+ *
+ * Returns: Whether succeeded.
+ *
+ * Since: 3.62
+ **/
+gboolean
+camel_db_run_maintenance_slice (CamelDB *cdb,
+				gint64 max_usec,
+				gboolean *out_finished,
+				gint *out_percent,
+				guint64 *out_reclaimed_bytes,
+				GError **error)
+{
+	guint64 reclaimed_bytes = 0;
+	gint64 deadline;
+	gboolean success = TRUE;
+	gint percent;
+
+	g_return_val_if_fail (CAMEL_IS_DB (cdb), FALSE);
+
+	deadline = g_get_monotonic_time () + MAX (max_usec, 0);
+
+	g_mutex_lock (&cdb->priv->maintenance_lock);
+
+	while (success && cdb->priv->maintenance_phase != CAMEL_DB_MAINTENANCE_PHASE_DONE) {
+		/* The incremental vacuum cannot run in the transaction,
+		   thus do not call camel_db_writer_lock() here */
+		g_rw_lock_writer_lock (&cdb->priv->rwlock);
+		success = cdb_maintenance_step (cdb, &reclaimed_bytes, error);
+		g_rw_lock_writer_unlock (&cdb->priv->rwlock);
+
+		if (g_get_monotonic_time () >= deadline)
+			break;
+	}
+
+	if (!success || cdb->priv->maintenance_phase == CAMEL_DB_MAINTENANCE_PHASE_DONE) {
+		if (out_finished)
+			*out_finished = success;
+
+		percent = 100;
+
+		/* start from the beginning the next time */
+		cdb->priv->maintenance_phase = CAMEL_DB_MAINTENANCE_PHASE_VACUUM;
+		cdb->priv->maintenance_freelist_count = 0;
+	} else {
+		if (out_finished)
+			*out_finished = FALSE;
+
+		if (cdb->priv->maintenance_phase == CAMEL_DB_MAINTENANCE_PHASE_ANALYZE) {
+			percent = 90;
+		} else {
+			guint64 freelist_count = 0;
+
+			/* not camel_db_reader_lock(), the maintenance does not count as a use */
+			g_rw_lock_reader_lock (&cdb->priv->rwlock);
+			/* the vacuum is the longest part, use 90% of the progress for it */
+			if (cdb->priv->maintenance_freelist_count > 0 &&
+			    cdb_read_number (cdb, "PRAGMA freelist_count;", &freelist_count, NULL) &&
+			    freelist_count <= cdb->priv->maintenance_freelist_count)
+				percent = 90 * (cdb->priv->maintenance_freelist_count - freelist_count) / cdb->priv->maintenance_freelist_count;
+			else
+				percent = 0;
+			g_rw_lock_reader_unlock (&cdb->priv->rwlock);
+		}
+	}
+
+	g_mutex_unlock (&cdb->priv->maintenance_lock);
+
+	if (out_percent)
+		*out_percent = percent;
+
+	if (out_reclaimed_bytes)
+		*out_reclaimed_bytes = reclaimed_bytes;
+
+	return success;
+}
+
 /**
  * camel_db_release_cache_memory:
  *
@@ -150,6 +150,13 @@ gboolean	camel_db_set_collate		(CamelDB *cdb,
 						 CamelDBCollate func);
 gboolean	camel_db_maybe_run_maintenance	(CamelDB *cdb,
 						 GError **error);
+gint64		camel_db_get_idle_time		(CamelDB *cdb);
+gboolean	camel_db_run_maintenance_slice	(CamelDB *cdb,
+						 gint64 max_usec,
+						 gboolean *out_finished,
+						 gint *out_percent,
+						 guint64 *out_reclaimed_bytes,
+						 GError **error);
 
 void		camel_db_release_cache_memory	(void);
 
@@ -79,6 +79,7 @@ struct _filter_rule {
 	gchar *match;
 	gchar *action;
 	gchar *name;
+	CamelSExp *action_sexp; /* parsed action, created on demand */
 };
 
 struct _CamelFilterDriverPrivate {
@@ -347,6 +348,44 @@ filter_rule_compare_by_name (struct _filter_rule *rule,
 	return g_strcmp0 (rule->name, name);
 }
 
+static void
+filter_rule_free (struct _filter_rule *rule)
+{
+	if (rule) {
+		g_clear_object (&rule->action_sexp);
+		g_free (rule->match);
+		g_free (rule->action);
+		g_free (rule->name);
+		g_free (rule);
+	}
+}
+
+static CamelSExp *
+filter_driver_new_action_sexp (CamelFilterDriver *driver)
+{
+	CamelSExp *sexp;
+	gint ii;
+
+	sexp = camel_sexp_new ();
+
+	/* Load in builtin symbols */
+	for (ii = 0; ii < G_N_ELEMENTS (symbols); ii++) {
+		if (symbols[ii].type == 1) {
+			camel_sexp_add_ifunction (
+				sexp, 0,
+				symbols[ii].name, (CamelSExpIFunc)
+				symbols[ii].func, driver);
+		} else {
+			camel_sexp_add_function (
+				sexp, 0,
+				symbols[ii].name, symbols[ii].func,
+				driver);
+		}
+	}
+
+	return sexp;
+}
+
 static void
 filter_driver_dispose (GObject *object)
 {
@@ -388,10 +427,7 @@ filter_driver_finalize (GObject *object)
 	g_object_unref (priv->eval);
 
 	while ((node = g_queue_pop_head (&priv->rules)) != NULL) {
-		g_free (node->match);
-		g_free (node->action);
-		g_free (node->name);
-		g_free (node);
+		filter_rule_free (node);
 	}
 
 	/* Chain up to parent's finalize() method. */
@@ -411,28 +447,12 @@ camel_filter_driver_class_init (CamelFilterDriverClass *class)
 static void
 camel_filter_driver_init (CamelFilterDriver *filter_driver)
 {
-	gint ii;
 
 	filter_driver->priv = camel_filter_driver_get_instance_private (filter_driver);
 
 	g_queue_init (&filter_driver->priv->rules);
 
-	filter_driver->priv->eval = camel_sexp_new ();
-
-	/* Load in builtin symbols */
-	for (ii = 0; ii < G_N_ELEMENTS (symbols); ii++) {
-		if (symbols[ii].type == 1) {
-			camel_sexp_add_ifunction (
-				filter_driver->priv->eval, 0,
-				symbols[ii].name, (CamelSExpIFunc)
-				symbols[ii].func, filter_driver);
-		} else {
-			camel_sexp_add_function (
-				filter_driver->priv->eval, 0,
-				symbols[ii].name, symbols[ii].func,
-				filter_driver);
-		}
-	}
+	filter_driver->priv->eval = filter_driver_new_action_sexp (filter_driver);
 
 	filter_driver->priv->folders =
 		g_hash_table_new (g_str_hash, g_str_equal);
@@ -603,7 +623,7 @@ camel_filter_driver_add_rule (CamelFilterDriver *d,
 {
 	struct _filter_rule *node;
 
-	node = g_malloc (sizeof (*node));
+	node = g_new0 (struct _filter_rule, 1);
 	node->match = g_strdup (match);
 	node->action = g_strdup (action);
 	node->name = g_strdup (name);
@@ -635,10 +655,7 @@ camel_filter_driver_remove_rule_by_name (CamelFilterDriver *d,
 
 		g_queue_delete_link (&d->priv->rules, link);
 
-		g_free (rule->match);
-		g_free (rule->action);
-		g_free (rule->name);
-		g_free (rule);
+		filter_rule_free (rule);
 
 		return TRUE;
 	}
@@ -2172,22 +2189,30 @@ filter_driver_filter_message_internal (CamelFilterDriver *driver,
 		case CAMEL_SEARCH_MATCHED:
 			camel_filter_driver_log (driver, FILTER_LOG_INFO, "   Filter '%s' matched\n", rule->name);
 
-			/* perform necessary filtering actions */
-			camel_sexp_input_text (
-				driver->priv->eval,
-				rule->action, strlen (rule->action));
-			if (camel_sexp_parse (driver->priv->eval) == -1) {
-				g_set_error (
-					error, CAMEL_ERROR,
-					CAMEL_ERROR_GENERIC,
-					_("Error parsing filter “%s”: %s: %s"),
-					rule->name,
-					camel_sexp_error (driver->priv->eval),
-					rule->action);
-				goto error;
+			/* perform necessary filtering actions; the action is parsed
+			   only once, because it can match many messages in a row */
+			if (!rule->action_sexp) {
+				rule->action_sexp = filter_driver_new_action_sexp (driver);
+
+				camel_sexp_input_text (
+					rule->action_sexp,
+					rule->action, strlen (rule->action));
+				if (camel_sexp_parse (rule->action_sexp) == -1) {
+					g_set_error (
+						error, CAMEL_ERROR,
+						CAMEL_ERROR_GENERIC,
+						_("Error parsing filter “%s”: %s: %s"),
+						rule->name,
+						camel_sexp_error (rule->action_sexp),
+						rule->action);
+					g_clear_object (&rule->action_sexp);
+					goto error;
+				}
 			}
-			r = camel_sexp_eval (driver->priv->eval);
+			r = camel_sexp_eval (rule->action_sexp);
 			if (driver->priv->error != NULL) {
+				if (r)
+					camel_sexp_result_free (rule->action_sexp, r);
 				g_prefix_error (
 					&driver->priv->error,
 					_("Execution of filter “%s” failed: "),
@@ -2201,11 +2226,12 @@ filter_driver_filter_message_internal (CamelFilterDriver *driver,
 					CAMEL_ERROR_GENERIC,
 					_("Error executing filter “%s”: %s: %s"),
 					rule->name,
-					camel_sexp_error (driver->priv->eval),
+					camel_sexp_error (rule->action_sexp),
 					rule->action);
+				g_clear_object (&rule->action_sexp);
 				goto error;
 			}
-			camel_sexp_result_free (driver->priv->eval, r);
+			camel_sexp_result_free (rule->action_sexp, r);
 			break;
 		case CAMEL_SEARCH_NOMATCH:
 			camel_filter_driver_log (driver, FILTER_LOG_INFO, "   Filter '%s' did not match\n", rule->name);
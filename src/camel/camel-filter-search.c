@@ -1337,6 +1337,157 @@ addressbook_contains_func (CamelSExp *sexp,
 	return res;
 }
 
+/* Filtering a folder evaluates the same few rule expressions for each
+ * message, thus the parsed expressions are kept for reuse, instead of
+ * creating and parsing a new CamelSExp for every message and rule. There
+ * can be more parsed instances of the same expression, when it's used
+ * by multiple threads at once. The least recently used expressions are
+ * evicted, like those of the edited or removed rules. */
+#define FILTER_SEARCH_CACHE_MAX_EXPRESSIONS 512
+
+typedef struct _FilterSearchCompiled {
+	CamelSExp *sexp;
+	FilterMessageSearch *fms; /* bound to the sexp functions */
+} FilterSearchCompiled;
+
+typedef struct _FilterSearchCacheEntry {
+	gchar *expression; /* the key in the filter_search_cache */
+	GSList *unused; /* FilterSearchCompiled * */
+	GList *lru_link; /* in the filter_search_cache_lru, the data is the entry itself */
+} FilterSearchCacheEntry;
+
+G_LOCK_DEFINE_STATIC (filter_search_cache);
+static GHashTable *filter_search_cache = NULL; /* gchar *expression ~> FilterSearchCacheEntry * */
+static GQueue filter_search_cache_lru = G_QUEUE_INIT; /* the most recently used first */
+
+static void
+filter_search_compiled_free (gpointer ptr)
+{
+	FilterSearchCompiled *compiled = ptr;
+
+	if (compiled) {
+		g_clear_object (&compiled->sexp);
+		g_free (compiled->fms);
+		g_free (compiled);
+	}
+}
+
+static void
+filter_search_cache_entry_free (gpointer ptr)
+{
+	FilterSearchCacheEntry *entry = ptr;
+
+	if (entry) {
+		g_slist_free_full (entry->unused, filter_search_compiled_free);
+		g_free (entry->expression);
+		g_free (entry);
+	}
+}
+
+static FilterSearchCompiled *
+filter_search_compiled_new (const gchar *expression,
+			    GError **error)
+{
+	FilterSearchCompiled *compiled;
+	gint i;
+
+	compiled = g_new0 (FilterSearchCompiled, 1);
+	compiled->fms = g_new0 (FilterMessageSearch, 1);
+	compiled->sexp = camel_sexp_new ();
+
+	for (i = 0; i < G_N_ELEMENTS (symbols); i++) {
+		if (symbols[i].type == 1)
+			camel_sexp_add_ifunction (compiled->sexp, 0, symbols[i].name, (CamelSExpIFunc) symbols[i].func, compiled->fms);
+		else
+			camel_sexp_add_function (compiled->sexp, 0, symbols[i].name, symbols[i].func, compiled->fms);
+	}
+
+	camel_sexp_input_text (compiled->sexp, expression, strlen (expression));
+	if (camel_sexp_parse (compiled->sexp) == -1) {
+		/* A filter search is a search through your filters,
+		 * ie. your filters is the corpus being searched thru. */
+		g_set_error (
+			error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
+			_("Error executing filter search: %s: %s"),
+			camel_sexp_error (compiled->sexp), expression);
+
+		filter_search_compiled_free (compiled);
+
+		return NULL;
+	}
+
+	return compiled;
+}
+
+static FilterSearchCompiled *
+filter_search_cache_take (const gchar *expression,
+			  GError **error)
+{
+	FilterSearchCompiled *compiled = NULL;
+	FilterSearchCacheEntry *entry;
+
+	G_LOCK (filter_search_cache);
+
+	entry = filter_search_cache ? g_hash_table_lookup (filter_search_cache, expression) : NULL;
+
+	if (entry && entry->unused) {
+		compiled = entry->unused->data;
+		entry->unused = g_slist_delete_link (entry->unused, entry->unused);
+
+		g_queue_unlink (&filter_search_cache_lru, entry->lru_link);
+		g_queue_push_head_link (&filter_search_cache_lru, entry->lru_link);
+	}
+
+	G_UNLOCK (filter_search_cache);
+
+	if (!compiled)
+		compiled = filter_search_compiled_new (expression, error);
+
+	return compiled;
+}
+
+/* the @compiled is consumed */
+static void
+filter_search_cache_give_back (const gchar *expression,
+			       FilterSearchCompiled *compiled)
+{
+	FilterSearchCacheEntry *entry;
+
+	/* do not keep references to the last searched message */
+	memset (compiled->fms, 0, sizeof (FilterMessageSearch));
+
+	G_LOCK (filter_search_cache);
+
+	if (!filter_search_cache)
+		filter_search_cache = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, filter_search_cache_entry_free);
+
+	entry = g_hash_table_lookup (filter_search_cache, expression);
+
+	if (entry) {
+		g_queue_unlink (&filter_search_cache_lru, entry->lru_link);
+		g_queue_push_head_link (&filter_search_cache_lru, entry->lru_link);
+	} else {
+		entry = g_new0 (FilterSearchCacheEntry, 1);
+		entry->expression = g_strdup (expression);
+
+		g_queue_push_head (&filter_search_cache_lru, entry);
+		entry->lru_link = g_queue_peek_head_link (&filter_search_cache_lru);
+
+		g_hash_table_insert (filter_search_cache, entry->expression, entry);
+
+		while (g_hash_table_size (filter_search_cache) > FILTER_SEARCH_CACHE_MAX_EXPRESSIONS) {
+			FilterSearchCacheEntry *oldest = g_queue_pop_tail (&filter_search_cache_lru);
+
+			/* the instances of it in use are cached again, when given back */
+			g_hash_table_remove (filter_search_cache, oldest->expression);
+		}
+	}
+
+	entry->unused = g_slist_prepend (entry->unused, compiled);
+
+	G_UNLOCK (filter_search_cache);
+}
+
 static const gchar *
 camel_search_result_to_string (gint value)
 {
@@ -1375,58 +1526,56 @@ camel_filter_search_match_with_log (CamelSession *session,
 				    GCancellable *cancellable,
 				    GError **error)
 {
-	FilterMessageSearch fms;
-	CamelSExp *sexp;
+	FilterSearchCompiled *compiled;
+	FilterMessageSearch *fms;
 	CamelSExpResult *result;
 	gint retval;
 	GError *local_error = NULL;
-	gint i;
-
-	fms.session = session;
-	fms.get_message = get_message;
-	fms.get_message_data = user_data;
-	fms.message = NULL;
-	fms.info = info;
-	fms.source = source;
-	fms.folder = folder;
-	fms.logfile = logfile;
-	fms.cancellable = cancellable;
-	fms.error = &local_error;
 
-	sexp = camel_sexp_new ();
+	compiled = filter_search_cache_take (expression, &local_error);
+	if (!compiled) {
+		if (logfile) {
+			FilterMessageSearch tmp_fms = { 0, };
 
-	for (i = 0; i < G_N_ELEMENTS (symbols); i++) {
-		if (symbols[i].type == 1)
-			camel_sexp_add_ifunction (sexp, 0, symbols[i].name, (CamelSExpIFunc) symbols[i].func, &fms);
-		else
-			camel_sexp_add_function (sexp, 0, symbols[i].name, symbols[i].func, &fms);
-	}
+			tmp_fms.logfile = logfile;
 
-	camel_sexp_input_text (sexp, expression, strlen (expression));
-	if (camel_sexp_parse (sexp) == -1) {
-		if (!local_error) {
-			/* A filter search is a search through your filters,
-			 * ie. your filters is the corpus being searched thru. */
-			g_set_error (
-				&local_error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
-				_("Error executing filter search: %s: %s"),
-				camel_sexp_error (sexp), expression);
+			camel_filter_search_log (&tmp_fms, "Finished test of message uid:%s subject:'%s' from '%s : %s' as ERROR: '%s'",
+				camel_message_info_get_uid (info), camel_message_info_get_subject (info),
+				folder ? camel_service_get_display_name (CAMEL_SERVICE (camel_folder_get_parent_store (folder))) : "NULL",
+				folder ? camel_folder_get_full_name (folder) : "NULL",
+				local_error ? local_error->message : "Unknown error");
 		}
-		goto error;
+
+		if (local_error)
+			g_propagate_error (error, local_error);
+
+		return CAMEL_SEARCH_ERROR;
 	}
 
-	result = camel_sexp_eval (sexp);
+	fms = compiled->fms;
+	fms->session = session;
+	fms->get_message = get_message;
+	fms->get_message_data = user_data;
+	fms->message = NULL;
+	fms->info = info;
+	fms->source = source;
+	fms->folder = folder;
+	fms->logfile = logfile;
+	fms->cancellable = cancellable;
+	fms->error = &local_error;
+
+	result = camel_sexp_eval (compiled->sexp);
 	if (result == NULL) {
 		if (!local_error)
 			g_set_error (
 				&local_error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
 				_("Error executing filter search: %s: %s"),
-				camel_sexp_error (sexp), expression);
+				camel_sexp_error (compiled->sexp), expression);
 		goto error;
 	}
 
 	if (local_error) {
-		camel_sexp_result_free (sexp, result);
+		camel_sexp_result_free (compiled->sexp, result);
 		goto error;
 	}
 
@@ -1435,36 +1584,38 @@ camel_filter_search_match_with_log (CamelSession *session,
 	else
 		retval = CAMEL_SEARCH_NOMATCH;
 
-	camel_sexp_result_free (sexp, result);
-	g_object_unref (sexp);
+	camel_sexp_result_free (compiled->sexp, result);
 
-	if (fms.message)
-		g_object_unref (fms.message);
+	if (fms->message)
+		g_object_unref (fms->message);
 
 	if (logfile) {
-		camel_filter_search_log (&fms, "Finished test of message uid:%s subject:'%s' from '%s : %s' as %s",
+		camel_filter_search_log (fms, "Finished test of message uid:%s subject:'%s' from '%s : %s' as %s",
 			camel_message_info_get_uid (info), camel_message_info_get_subject (info),
 			folder ? camel_service_get_display_name (CAMEL_SERVICE (camel_folder_get_parent_store (folder))) : "NULL",
 			folder ? camel_folder_get_full_name (folder) : "NULL",
 			camel_search_result_to_string (retval));
 	}
 
+	filter_search_cache_give_back (expression, compiled);
+
 	return retval;
 
  error:
-	if (fms.message)
-		g_object_unref (fms.message);
-
-	g_object_unref (sexp);
+	if (fms->message)
+		g_object_unref (fms->message);
 
 	if (logfile) {
-		camel_filter_search_log (&fms, "Finished test of message uid:%s subject:'%s' from '%s : %s' as ERROR: '%s'",
+		camel_filter_search_log (fms, "Finished test of message uid:%s subject:'%s' from '%s : %s' as ERROR: '%s'",
 			camel_message_info_get_uid (info), camel_message_info_get_subject (info),
 			folder ? camel_service_get_display_name (CAMEL_SERVICE (camel_folder_get_parent_store (folder))) : "NULL",
 			folder ? camel_folder_get_full_name (folder) : "NULL",
 			local_error ? local_error->message : "Unknown error");
 	}
 
+	/* the evaluation failed, do not reuse the instance, its error state is set */
+	filter_search_compiled_free (compiled);
+
 	if (local_error)
 		g_propagate_error (error, local_error);
 
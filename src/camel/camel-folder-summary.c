@@ -2456,6 +2456,7 @@ camel_folder_summary_info_new_from_parser (CamelFolderSummary *summary,
 	gsize len;
 	goffset start;
 	CamelIndexName *name = NULL;
+	gboolean with_index;
 
 	g_return_val_if_fail (CAMEL_IS_FOLDER_SUMMARY (summary), NULL);
 	g_return_val_if_fail (CAMEL_IS_MIME_PARSER (mp), NULL);
@@ -2477,7 +2478,12 @@ camel_folder_summary_info_new_from_parser (CamelFolderSummary *summary,
 		if (summary->priv->index)
 			summary_assign_uid (summary, info);
 
-		g_rec_mutex_lock (&summary->priv->filter_lock);
+		/* the filters are shared, but they are used only for the indexing,
+		   thus the summaries without index can be filled from more threads */
+		with_index = summary->priv->index != NULL;
+
+		if (with_index)
+			g_rec_mutex_lock (&summary->priv->filter_lock);
 
 		if (summary->priv->index) {
 			if (!summary->priv->filter_index)
@@ -2496,7 +2502,8 @@ camel_folder_summary_info_new_from_parser (CamelFolderSummary *summary,
 			camel_mime_filter_index_set_name (CAMEL_MIME_FILTER_INDEX (summary->priv->filter_index), NULL);
 		}
 
-		g_rec_mutex_unlock (&summary->priv->filter_lock);
+		if (with_index)
+			g_rec_mutex_unlock (&summary->priv->filter_lock);
 
 		camel_message_info_set_size (info, camel_mime_parser_tell (mp) - start);
 	}
@@ -2894,6 +2901,20 @@ summary_format_address (const CamelNameValueArray *headers,
 	return str;
 }
 
+/* Whether the @text is 7bit without any encoded-word, thus there's nothing to decode */
+static gboolean
+summary_header_is_plain (const gchar *text)
+{
+	const guchar *ptr;
+
+	for (ptr = (const guchar *) text; *ptr; ptr++) {
+		if (*ptr >= 128 || (*ptr == '=' && ptr[1] == '?'))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 static gchar *
 summary_format_string (const CamelNameValueArray *headers,
                        const gchar *name,
@@ -2910,6 +2931,13 @@ summary_format_string (const CamelNameValueArray *headers,
 		value++;
 
 	text = camel_header_unfold (value);
+
+	/* the plain headers are used as they are, the others are decoded only once,
+	   because the decoded value can be longer than the text, thus it cannot be
+	   decoded in place with camel_header_decode_string_into() */
+	if (summary_header_is_plain (text))
+		return text;
+
 	str = camel_header_decode_string (text, charset);
 	g_free (text);
 
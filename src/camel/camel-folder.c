@@ -4424,6 +4424,36 @@ uid_index_pair_free (gpointer ptr)
 	}
 }
 
+/* The folders of the local providers can read each other's files, thus
+   the destination can transfer the messages from a local source of another
+   store, like from an mbox into a maildir, without parsing them. Other
+   destinations expect the source from the same store. */
+static CamelFolderClass *
+folder_get_local_transfer_class (CamelFolder *source,
+                                 CamelFolder *destination)
+{
+	CamelProvider *source_provider, *destination_provider;
+	CamelFolderClass *class;
+
+	if (CAMEL_IS_VEE_FOLDER (source) || CAMEL_IS_VEE_FOLDER (destination))
+		return NULL;
+
+	source_provider = camel_service_get_provider (CAMEL_SERVICE (camel_folder_get_parent_store (source)));
+	destination_provider = camel_service_get_provider (CAMEL_SERVICE (camel_folder_get_parent_store (destination)));
+
+	if (!source_provider || !destination_provider ||
+	    (source_provider->flags & CAMEL_PROVIDER_IS_LOCAL) == 0 ||
+	    (destination_provider->flags & CAMEL_PROVIDER_IS_LOCAL) == 0)
+		return NULL;
+
+	class = CAMEL_FOLDER_GET_CLASS (destination);
+
+	if (!class || class->transfer_messages_to_sync == folder_transfer_messages_to_sync)
+		return NULL;
+
+	return class;
+}
+
 /**
  * camel_folder_transfer_messages_to_sync:
  * @source: the source #CamelFolder
@@ -4439,6 +4469,8 @@ uid_index_pair_free (gpointer ptr)
  * Copies or moves messages from one folder to another.  If the
  * @source and @destination folders have the same parent_store, this
  * may be more efficient than using camel_folder_append_message_sync().
+ * The same applies to the folders of the local providers, which can
+ * be transferred between different stores without parsing the messages.
  *
  * Returns: %TRUE on success, %FALSE on failure
  *
@@ -4598,9 +4630,17 @@ camel_folder_transfer_messages_to_sync (CamelFolder *source,
 	}
 
 	if (!done) {
-		success = folder_transfer_messages_to_sync (
-			source, message_uids, destination, delete_originals,
-			transferred_uids, cancellable, error);
+		class = folder_get_local_transfer_class (source, destination);
+
+		if (class) {
+			success = class->transfer_messages_to_sync (
+				source, message_uids, destination, delete_originals,
+				transferred_uids, cancellable, error);
+		} else {
+			success = folder_transfer_messages_to_sync (
+				source, message_uids, destination, delete_originals,
+				transferred_uids, cancellable, error);
+		}
 	}
 
 	return success;
@@ -2688,6 +2688,243 @@ fail:
 	return success;
 }
 
+/* Verification results are cached process-wide, because the cipher contexts
+ * are usually short-lived, while the same signed messages are verified again
+ * and again, when previewing or searching a folder. The key is a digest of
+ * the signed data, the signature, the relevant options and the state of
+ * the keyring files, thus any change in the keyring or in the trust database
+ * invalidates the previous results. */
+#define GPG_VERIFY_CACHE_MAX_ITEMS 256
+#define GPG_VERIFY_CACHE_TIMEOUT_SECS (10 * 60)
+
+typedef struct _GpgVerifyCacheItem {
+	gchar *key;
+	CamelCipherValidity *validity;
+	gint64 created; /* in g_get_monotonic_time() units */
+	GList *link; /* in gpg_verify_cache_lru */
+} GpgVerifyCacheItem;
+
+G_LOCK_DEFINE_STATIC (gpg_verify_cache);
+static GHashTable *gpg_verify_cache = NULL; /* gchar *key ~> GpgVerifyCacheItem * */
+static GQueue gpg_verify_cache_lru = G_QUEUE_INIT; /* GpgVerifyCacheItem *, the most recently used at the head */
+static guint64 gpg_verify_cache_hits = 0;
+static guint64 gpg_verify_cache_misses = 0;
+
+static void
+gpg_verify_cache_item_free (gpointer ptr)
+{
+	GpgVerifyCacheItem *item = ptr;
+
+	if (item) {
+		camel_cipher_validity_free (item->validity);
+		g_free (item->key);
+		g_free (item);
+	}
+}
+
+static void
+gpg_verify_cache_clear (void)
+{
+	G_LOCK (gpg_verify_cache);
+
+	g_queue_clear (&gpg_verify_cache_lru);
+	g_clear_pointer (&gpg_verify_cache, g_hash_table_destroy);
+
+	G_UNLOCK (gpg_verify_cache);
+}
+
+static void
+gpg_verify_cache_add_file_stamp (GChecksum *checksum,
+				 const gchar *gnupg_home,
+				 const gchar *filename)
+{
+	GFileInfo *info;
+	GFile *file;
+	gchar *path;
+
+	path = g_build_filename (gnupg_home, filename, NULL);
+	file = g_file_new_for_path (path);
+	info = g_file_query_info (file,
+		G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+		G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+		G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+		G_FILE_QUERY_INFO_NONE, NULL, NULL);
+
+	if (info) {
+		gchar *stamp;
+
+		stamp = g_strdup_printf ("%s:%" G_GUINT64_FORMAT ":%" G_GUINT64_FORMAT ":%u\n", filename,
+			(guint64) g_file_info_get_size (info),
+			g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED),
+			g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC));
+
+		g_checksum_update (checksum, (const guchar *) stamp, -1);
+
+		g_object_unref (info);
+		g_free (stamp);
+	}
+
+	g_object_unref (file);
+	g_free (path);
+}
+
+static gchar *
+gpg_verify_cache_dup_key (CamelGpgContext *context,
+			  CamelStream *istream,
+			  CamelMimePart *sigpart,
+			  gboolean load_photos,
+			  GCancellable *cancellable)
+{
+	const gchar *gnupg_home_env;
+	gchar *gnupg_home, *key;
+	gchar buffer[4096];
+	gssize nread;
+	GChecksum *checksum;
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA256);
+
+	gnupg_home_env = g_getenv ("GNUPGHOME");
+	if (gnupg_home_env && *gnupg_home_env)
+		gnupg_home = g_strdup (gnupg_home_env);
+	else
+		gnupg_home = g_build_filename (g_get_home_dir (), ".gnupg", NULL);
+
+	g_checksum_update (checksum, (const guchar *) gnupg_home, -1);
+	g_checksum_update (checksum, (const guchar *) "\n", 1);
+	gpg_verify_cache_add_file_stamp (checksum, gnupg_home, "pubring.kbx");
+	gpg_verify_cache_add_file_stamp (checksum, gnupg_home, "pubring.gpg");
+	gpg_verify_cache_add_file_stamp (checksum, gnupg_home, "trustdb.gpg");
+	gpg_verify_cache_add_file_stamp (checksum, gnupg_home, "tofu.db");
+	/* the keyboxd stores the keys in an SQLite database */
+	gpg_verify_cache_add_file_stamp (checksum, gnupg_home, "public-keys.d" G_DIR_SEPARATOR_S "pubring.db");
+	gpg_verify_cache_add_file_stamp (checksum, gnupg_home, "public-keys.d" G_DIR_SEPARATOR_S "pubring.db-wal");
+
+	g_free (gnupg_home);
+
+	buffer[0] = context->priv->always_trust ? 'T' : 't';
+	buffer[1] = load_photos ? 'P' : 'p';
+	g_checksum_update (checksum, (const guchar *) buffer, 2);
+
+	g_seekable_seek (G_SEEKABLE (istream), 0, G_SEEK_SET, NULL, NULL);
+
+	do {
+		nread = camel_stream_read (istream, buffer, sizeof (buffer), cancellable, NULL);
+		if (nread > 0)
+			g_checksum_update (checksum, (const guchar *) buffer, nread);
+	} while (nread > 0);
+
+	g_seekable_seek (G_SEEKABLE (istream), 0, G_SEEK_SET, NULL, NULL);
+
+	if (nread < 0) {
+		g_checksum_free (checksum);
+		return NULL;
+	}
+
+	if (sigpart) {
+		CamelDataWrapper *wrapper;
+		CamelStream *sigstream;
+		GByteArray *bytes;
+
+		wrapper = camel_medium_get_content (CAMEL_MEDIUM (sigpart));
+		if (!wrapper)
+			wrapper = CAMEL_DATA_WRAPPER (sigpart);
+
+		sigstream = camel_stream_mem_new ();
+
+		if (camel_data_wrapper_decode_to_stream_sync (wrapper, sigstream, cancellable, NULL) == -1) {
+			g_object_unref (sigstream);
+			g_checksum_free (checksum);
+			return NULL;
+		}
+
+		bytes = camel_stream_mem_get_byte_array (CAMEL_STREAM_MEM (sigstream));
+
+		g_checksum_update (checksum, (const guchar *) "\nsig:", 5);
+		g_checksum_update (checksum, bytes->data, bytes->len);
+
+		g_object_unref (sigstream);
+	}
+
+	key = g_strdup (g_checksum_get_string (checksum));
+
+	g_checksum_free (checksum);
+
+	return key;
+}
+
+static CamelCipherValidity *
+gpg_verify_cache_lookup (const gchar *key)
+{
+	GpgVerifyCacheItem *item;
+	CamelCipherValidity *validity = NULL;
+
+	if (!key)
+		return NULL;
+
+	G_LOCK (gpg_verify_cache);
+
+	item = gpg_verify_cache ? g_hash_table_lookup (gpg_verify_cache, key) : NULL;
+	if (item) {
+		if (g_get_monotonic_time () - item->created > ((gint64) GPG_VERIFY_CACHE_TIMEOUT_SECS) * G_USEC_PER_SEC) {
+			g_queue_delete_link (&gpg_verify_cache_lru, item->link);
+			g_hash_table_remove (gpg_verify_cache, key);
+		} else {
+			g_queue_unlink (&gpg_verify_cache_lru, item->link);
+			g_queue_push_head_link (&gpg_verify_cache_lru, item->link);
+
+			validity = camel_cipher_validity_clone (item->validity);
+		}
+	}
+
+	if (validity)
+		gpg_verify_cache_hits++;
+	else
+		gpg_verify_cache_misses++;
+
+	G_UNLOCK (gpg_verify_cache);
+
+	return validity;
+}
+
+static void
+gpg_verify_cache_add (const gchar *key,
+		      CamelCipherValidity *validity)
+{
+	GpgVerifyCacheItem *item;
+
+	if (!key || !validity)
+		return;
+
+	G_LOCK (gpg_verify_cache);
+
+	if (!gpg_verify_cache)
+		gpg_verify_cache = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, gpg_verify_cache_item_free);
+
+	item = g_hash_table_lookup (gpg_verify_cache, key);
+	if (item) {
+		g_queue_delete_link (&gpg_verify_cache_lru, item->link);
+		g_hash_table_remove (gpg_verify_cache, key);
+	}
+
+	while (g_queue_get_length (&gpg_verify_cache_lru) >= GPG_VERIFY_CACHE_MAX_ITEMS) {
+		GpgVerifyCacheItem *oldest = g_queue_pop_tail (&gpg_verify_cache_lru);
+
+		g_hash_table_remove (gpg_verify_cache, oldest->key);
+	}
+
+	item = g_new0 (GpgVerifyCacheItem, 1);
+	item->key = g_strdup (key);
+	item->validity = camel_cipher_validity_clone (validity);
+	item->created = g_get_monotonic_time ();
+
+	g_queue_push_head (&gpg_verify_cache_lru, item);
+	item->link = g_queue_peek_head_link (&gpg_verify_cache_lru);
+
+	g_hash_table_insert (gpg_verify_cache, item->key, item);
+
+	G_UNLOCK (gpg_verify_cache);
+}
+
 static CamelCipherValidity *
 gpg_verify_sync (CamelCipherContext *context,
                  CamelMimePart *ipart,
@@ -2706,6 +2943,7 @@ gpg_verify_sync (CamelCipherContext *context,
 	CamelStream *filter;
 	CamelMimeFilter *canon;
 	gboolean is_retry = FALSE, is_photo_retry = FALSE;
+	gchar *cache_key = NULL;
 
 	class = CAMEL_CIPHER_CONTEXT_GET_CLASS (context);
 
@@ -2801,6 +3039,17 @@ gpg_verify_sync (CamelCipherContext *context,
 	}
 #endif
 
+	cache_key = gpg_verify_cache_dup_key (CAMEL_GPG_CONTEXT (context), istream, sigpart,
+		glob_gpg_ctx_can_load_photos && camel_cipher_can_load_photos (), cancellable);
+
+	validity = gpg_verify_cache_lookup (cache_key);
+	if (validity) {
+		g_clear_object (&istream);
+		g_free (cache_key);
+
+		return validity;
+	}
+
 	if (sigpart) {
 		sigfile = swrite (sigpart, cancellable, error);
 		if (sigfile == NULL) {
@@ -2896,6 +3145,10 @@ gpg_verify_sync (CamelCipherContext *context,
 
 	add_signers (validity, diagnostics, gpg->signers, gpg->signers_keyid, gpg->photos_filename);
 
+	/* the photo retry could change whether the photos are loaded, which is part of the key */
+	if (!is_photo_retry)
+		gpg_verify_cache_add (cache_key, validity);
+
 	gpg_ctx_free (gpg);
 
 	if (sigfile) {
@@ -2905,6 +3158,7 @@ gpg_verify_sync (CamelCipherContext *context,
 
 	g_object_unref (canon_stream);
 	g_clear_object (&istream);
+	g_free (cache_key);
 
 	return validity;
 
@@ -2921,6 +3175,8 @@ gpg_verify_sync (CamelCipherContext *context,
 		g_free (sigfile);
 	}
 
+	g_free (cache_key);
+
 	return NULL;
 }
 
@@ -4144,6 +4400,9 @@ camel_gpg_context_set_key_trust_sync (CamelGpgContext *context,
 		success = FALSE;
 	}
 
+	if (success)
+		gpg_verify_cache_clear ();
+
 	g_clear_pointer (&gpg, gpg_ctx_free);
 	g_free (tmp_keyid);
 
@@ -4211,8 +4470,37 @@ camel_gpg_context_import_key_sync (CamelGpgContext *context,
 		success = FALSE;
 	}
 
+	if (success)
+		gpg_verify_cache_clear ();
+
 	g_clear_pointer (&gpg, gpg_ctx_free);
 	g_clear_object (&istream);
 
 	return success;
 }
+
+/**
+ * camel_gpg_context_get_verify_cache_stats:
+ * @out_hits: (out) (optional): return location for the count of cache hits, or %NULL
+ * @out_misses: (out) (optional): return location for the count of cache misses, or %NULL
+ *
+ * Returns how many signature verifications had been answered from
+ * the process-wide cache of the verification results and how many
+ * had to run gpg, for diagnostics.
+ *
+ * Since: 3.62
+ **/
+void
+camel_gpg_context_get_verify_cache_stats (guint64 *out_hits,
+					  guint64 *out_misses)
+{
+	G_LOCK (gpg_verify_cache);
+
+	if (out_hits)
+		*out_hits = gpg_verify_cache_hits;
+
+	if (out_misses)
+		*out_misses = gpg_verify_cache_misses;
+
+	G_UNLOCK (gpg_verify_cache);
+}
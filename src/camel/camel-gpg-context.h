@@ -128,6 +128,9 @@ gboolean	camel_gpg_context_import_key_sync
 						 guint32 flags,
 						 GCancellable *cancellable,
 						 GError **error);
+void		camel_gpg_context_get_verify_cache_stats
+						(guint64 *out_hits,
+						 guint64 *out_misses);
 
 G_END_DECLS
 
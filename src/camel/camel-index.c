@@ -14,8 +14,10 @@
  * message content, enabling fast body-text searches without re-scanning
  * message files.
  *
- * The concrete implementation is #CamelTextIndex, which stores the index
- * on disk using a partition-table and block-file based format.
+ * The local providers use #CamelPostingsIndex, which stores compressed
+ * postings in memory-mapped segment files. The older #CamelTextIndex stores
+ * the index using a partition-table and block-file based format; it is
+ * still readable and gets converted into a #CamelPostingsIndex on open.
  *
  * When a #CamelIndex is attached to a #CamelFolderSummary (via
  * camel_folder_summary_set_index()), summary generation will automatically
@@ -1322,6 +1322,36 @@ append_quoted_pair (GString *str,
 	return str;
 }
 
+/* Checks whether the text can be used as is, without running it through
+ * the rfc2047 tokenizer, which is the case for the vast majority of the headers:
+ * pure 7bit text without any encoded-word introducer and, for ctext, without
+ * any quoted pair. Sets @out_len to the length of the @in on success. */
+static gboolean
+header_text_is_plain (const gchar *in,
+                      gint ctext,
+                      gsize *out_len)
+{
+	register const guchar *inptr = (const guchar *) in;
+
+	while (*inptr) {
+		if (*inptr >= 128)
+			return FALSE;
+
+		if (*inptr == '=' && inptr[1] == '?')
+			return FALSE;
+
+		if (ctext && *inptr == '\\')
+			return FALSE;
+
+		inptr++;
+	}
+
+	if (out_len)
+		*out_len = (gsize) (inptr - (const guchar *) in);
+
+	return TRUE;
+}
+
 /* decodes a simple text, rfc822 + rfc2047 */
 static gchar *
 header_decode_text (const gchar *in,
@@ -1339,6 +1369,9 @@ header_decode_text (const gchar *in,
 	if (in == NULL)
 		return g_strdup ("");
 
+	if (header_text_is_plain (in, ctext, &n))
+		return g_strndup (in, n);
+
 	out = g_string_sized_new (strlen (in) + 1);
 
 	while (*inptr != '\0') {
@@ -1451,10 +1484,15 @@ camel_header_decode_string (const gchar *in,
                             const gchar *default_charset)
 {
 	gchar *res;
+	gsize len;
 
 	if (in == NULL)
 		return NULL;
 
+	/* nothing to decode and nothing to validate, the 7bit text is valid UTF-8 */
+	if (header_text_is_plain (in, FALSE, &len))
+		return g_strndup (in, len);
+
 	res = header_decode_text (in, FALSE, default_charset);
 
 	if (res)
@@ -1463,6 +1501,61 @@ camel_header_decode_string (const gchar *in,
 	return res;
 }
 
+/**
+ * camel_header_decode_string_into:
+ * @in: input header value string
+ * @default_charset: (nullable): default charset to use if improperly encoded
+ * @buffer: (out caller-allocates) (array length=buffer_len) (nullable): buffer to write the result to
+ * @buffer_len: size of the @buffer, in bytes
+ *
+ * Decodes rfc2047 encoded-word tokens, the same way as camel_header_decode_string()
+ * does, only the result is written into the caller-provided @buffer, including
+ * the trailing NUL byte. The @buffer is left untouched when the result does not
+ * fit into it. The @buffer can be the same as the @in.
+ *
+ * Headers without any encoded-word and with 7bit text only, which is the most
+ * common case, are copied without any memory allocation. The other headers
+ * are decoded with camel_header_decode_string() and the result is copied
+ * into the @buffer, thus they are not decoded without allocations. When
+ * the result does not fit, the decoded value is thrown away; use
+ * camel_header_decode_string() directly when the value can be longer
+ * than the @buffer.
+ *
+ * Returns: length of the decoded string, without the trailing NUL byte; when it's
+ *    equal to or larger than the @buffer_len, then the @buffer had not been written
+ *
+ * Since: 3.62
+ **/
+gsize
+camel_header_decode_string_into (const gchar *in,
+                                 const gchar *default_charset,
+                                 gchar *buffer,
+                                 gsize buffer_len)
+{
+	gchar *res;
+	gsize len;
+
+	if (!in)
+		in = "";
+
+	if (header_text_is_plain (in, FALSE, &len)) {
+		if (buffer && len < buffer_len && buffer != in)
+			memmove (buffer, in, len + 1);
+
+		return len;
+	}
+
+	res = camel_header_decode_string (in, default_charset);
+	len = strlen (res);
+
+	if (buffer && len < buffer_len)
+		memcpy (buffer, res, len + 1);
+
+	g_free (res);
+
+	return len;
+}
+
 /**
  * camel_header_format_ctext:
  * @in: input header value string
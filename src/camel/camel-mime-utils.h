@@ -150,6 +150,7 @@ gint camel_header_decode_int (const gchar **in);
 
 /* decode/encode a string type, like a subject line */
 gchar *camel_header_decode_string (const gchar *in, const gchar *default_charset);
+gsize camel_header_decode_string_into (const gchar *in, const gchar *default_charset, gchar *buffer, gsize buffer_len);
 gchar *camel_header_encode_string (const guchar *in);
 
 /* decode (text | comment) - a one-way op */
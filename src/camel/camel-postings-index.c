@@ -0,0 +1,2352 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+/**
+ * CamelPostingsIndex:
+ *
+ * A #CamelIndex storing the word postings in immutable segment files.
+ *
+ * The index consists of a small manifest file, named after the index path
+ * with a ".postings" suffix, and of a list of segment files. Each segment
+ * contains a sorted table of names, a sorted table of words and, for each
+ * word, the list of the names containing it, delta and varint encoded.
+ * The segments are memory mapped and never modified once written, thus
+ * the queries read the postings directly from the mapped memory.
+ *
+ * Newly added names are collected in memory and written as a new segment
+ * on sync. Deleted names are recorded in the manifest and filtered out
+ * of the query results, until the segments are merged. The merge runs in
+ * a background thread once there are too many segments, or synchronously
+ * on camel_index_compress().
+ *
+ * An existing #CamelTextIndex at the same path is converted into the new
+ * format the first time the index is opened for writing.
+ **/
+
+#include "evolution-data-server-config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include "camel-text-index.h"
+#include "camel-utf8.h"
+#include "camel-postings-index.h"
+
+#define d(x)
+
+#define CAMEL_POSTINGS_INDEX_VERSION "CPIX.000"
+#define CAMEL_POSTINGS_SEGMENT_VERSION "CPIS.000"
+#define CAMEL_POSTINGS_INDEX_SUFFIX ".postings"
+
+#define CAMEL_POSTINGS_INDEX_MAX_WORDLEN (128)
+
+/* How many names are collected in memory before they are written as a new segment */
+#define CAMEL_POSTINGS_INDEX_FLUSH_NAMES (8192)
+
+/* When there are more segments than this, they are merged in a background thread */
+#define CAMEL_POSTINGS_INDEX_MAX_SEGMENTS (8)
+
+/* Segment file layout, all numbers are little endian:
+ *
+ *   header:  "CPIS.000", guint32 n_names, guint32 n_words,
+ *            guint64 names table offset, guint64 words table offset
+ *   data:    NUL-terminated names; NUL-terminated words, each followed
+ *            by its postings
+ *   names:   n_names x guint64 name offset, sorted by the name
+ *   words:   n_words x { guint64 word offset, guint64 postings offset,
+ *            guint32 postings count, guint32 postings length }, sorted by the word
+ *   '\0'     thus any string in the file is terminated
+ *
+ * The postings are indexes into the names table, in ascending order, each
+ * stored as a varint difference from the previous one. */
+#define SEGMENT_HEADER_SIZE (32)
+#define SEGMENT_NAME_ENTRY_SIZE (8)
+#define SEGMENT_WORD_ENTRY_SIZE (24)
+
+typedef struct _PostingsSegment {
+	gint ref_count;
+	guint32 generation;	/* names deleted before this generation do not apply to the segment */
+	guint32 file_id;
+	gchar *filename;
+	GMappedFile *mapped;
+	const gchar *data;
+	gsize size;
+	guint32 n_names;
+	guint32 n_words;
+	const gchar *names_table;
+	const gchar *words_table;
+	gboolean obsolete;	/* the file is removed with the last reference */
+} PostingsSegment;
+
+struct _CamelPostingsIndexPrivate {
+	GMutex lock;
+	GCond merge_cond;
+
+	gchar *base_path;
+	gboolean writable;
+
+	guint32 next_generation;
+	guint32 next_file_id;
+	GPtrArray *segments;		/* PostingsSegment *, ordered by generation */
+	GHashTable *tombstones;		/* gchar *name ~> generation of the delete */
+	gboolean manifest_dirty;
+	gboolean merge_running;
+
+	/* Names and words not written into a segment yet */
+	GStringChunk *pending_strings;
+	GPtrArray *pending_names;	/* const gchar *, NULL when deleted */
+	GHashTable *pending_by_name;	/* const gchar *name ~> index + 1 */
+	GHashTable *pending_words;	/* const gchar *word ~> GArray { guint32 index } */
+	GHashTable *open_names;		/* gchar *name ~> count of added, but not written names */
+};
+
+/* ********************************************************************** */
+
+typedef struct _CamelPostingsIndexName {
+	CamelIndexName parent;
+
+	GString *buffer;
+	GStringChunk *strings;
+} CamelPostingsIndexName;
+
+typedef struct _CamelPostingsIndexNameClass {
+	CamelIndexNameClass parent_class;
+} CamelPostingsIndexNameClass;
+
+GType camel_postings_index_name_get_type (void);
+
+G_DEFINE_TYPE (CamelPostingsIndexName, camel_postings_index_name, CAMEL_TYPE_INDEX_NAME)
+
+/* ****************************** */
+
+/* Cursor over the names of a single word */
+typedef struct _CamelPostingsIndexCursor {
+	CamelIndexCursor parent;
+
+	GPtrArray *segments;	/* PostingsSegment *, the values point into */
+	GStringChunk *strings;	/* copies of the values not stored in the segments */
+	GPtrArray *values;	/* const gchar * */
+	guint index;
+} CamelPostingsIndexCursor;
+
+typedef struct _CamelPostingsIndexCursorClass {
+	CamelIndexCursorClass parent_class;
+} CamelPostingsIndexCursorClass;
+
+GType camel_postings_index_cursor_get_type (void);
+
+G_DEFINE_TYPE (CamelPostingsIndexCursor, camel_postings_index_cursor, CAMEL_TYPE_INDEX_CURSOR)
+
+/* ****************************** */
+
+/* Cursor over all the words, read lazily from the segments */
+typedef struct _CamelPostingsIndexWordsCursor {
+	CamelIndexCursor parent;
+
+	GPtrArray *segments;	/* PostingsSegment * */
+	GStringChunk *strings;
+	GPtrArray *pending;	/* const gchar *, words not written into a segment */
+	GHashTable *seen;	/* const gchar *word, already returned */
+	guint pending_index;
+	guint segment_index;
+	guint32 word_index;
+} CamelPostingsIndexWordsCursor;
+
+typedef struct _CamelPostingsIndexWordsCursorClass {
+	CamelIndexCursorClass parent_class;
+} CamelPostingsIndexWordsCursorClass;
+
+GType camel_postings_index_words_cursor_get_type (void);
+
+G_DEFINE_TYPE (CamelPostingsIndexWordsCursor, camel_postings_index_words_cursor, CAMEL_TYPE_INDEX_CURSOR)
+
+G_DEFINE_TYPE_WITH_PRIVATE (CamelPostingsIndex, camel_postings_index, CAMEL_TYPE_INDEX)
+
+/* ********************************************************************** */
+/* Encoding helpers */
+/* ********************************************************************** */
+
+static inline guint32
+postings_read_u32 (const gchar *data)
+{
+	guint32 value;
+
+	memcpy (&value, data, sizeof (value));
+
+	return GUINT32_FROM_LE (value);
+}
+
+static inline guint64
+postings_read_u64 (const gchar *data)
+{
+	guint64 value;
+
+	memcpy (&value, data, sizeof (value));
+
+	return GUINT64_FROM_LE (value);
+}
+
+static void
+postings_append_u32 (GByteArray *bytes,
+                     guint32 value)
+{
+	value = GUINT32_TO_LE (value);
+	g_byte_array_append (bytes, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+postings_append_u64 (GByteArray *bytes,
+                     guint64 value)
+{
+	value = GUINT64_TO_LE (value);
+	g_byte_array_append (bytes, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+postings_append_varint (GByteArray *bytes,
+                        guint32 value)
+{
+	guint8 byte;
+
+	while (value >= 0x80) {
+		byte = (value & 0x7f) | 0x80;
+		g_byte_array_append (bytes, &byte, 1);
+		value >>= 7;
+	}
+
+	byte = value;
+	g_byte_array_append (bytes, &byte, 1);
+}
+
+static gboolean
+postings_read_varint (const guchar **ptr,
+                      const guchar *end,
+                      guint32 *out_value)
+{
+	const guchar *p = *ptr;
+	guint32 value = 0;
+	guint shift = 0;
+
+	while (p < end && shift < 35) {
+		guchar byte = *p++;
+
+		value |= ((guint32) (byte & 0x7f)) << shift;
+		if ((byte & 0x80) == 0) {
+			*ptr = p;
+			*out_value = value;
+			return TRUE;
+		}
+
+		shift += 7;
+	}
+
+	return FALSE;
+}
+
+static gint
+postings_compare_strings (gconstpointer a,
+                          gconstpointer b)
+{
+	return strcmp (*((const gchar **) a), *((const gchar **) b));
+}
+
+static gint
+postings_compare_u32 (gconstpointer a,
+                      gconstpointer b)
+{
+	guint32 aa = *((const guint32 *) a), bb = *((const guint32 *) b);
+
+	return aa < bb ? -1 : aa > bb ? 1 : 0;
+}
+
+/* ********************************************************************** */
+/* File names */
+/* ********************************************************************** */
+
+static gchar *
+postings_index_manifest_path (const gchar *path)
+{
+	return g_strconcat (path, CAMEL_POSTINGS_INDEX_SUFFIX, NULL);
+}
+
+static gchar *
+postings_index_segment_path (const gchar *path,
+                             guint32 file_id)
+{
+	return g_strdup_printf ("%s.%08x" CAMEL_POSTINGS_INDEX_SUFFIX, path, file_id);
+}
+
+/* Removes segment files of the index at @path, which are not
+ * in the @keep_file_ids set; all of them, when it's %NULL. */
+static void
+postings_index_remove_segment_files (const gchar *path,
+                                     GHashTable *keep_file_ids)
+{
+	GDir *dir;
+	gchar *dirname, *basename;
+	const gchar *name;
+	gsize basename_len;
+
+	dirname = g_path_get_dirname (path);
+	basename = g_path_get_basename (path);
+	basename_len = strlen (basename);
+
+	dir = g_dir_open (dirname, 0, NULL);
+	while (dir && (name = g_dir_read_name (dir)) != NULL) {
+		const gchar *tail;
+		gchar *filename;
+		guint32 file_id;
+		gint ii;
+
+		if (strncmp (name, basename, basename_len) != 0 || name[basename_len] != '.')
+			continue;
+
+		tail = name + basename_len + 1;
+		for (ii = 0; ii < 8 && g_ascii_isxdigit (tail[ii]); ii++) {
+			/* just skip the hex digits */
+		}
+
+		if (ii != 8)
+			continue;
+
+		file_id = strtoul (tail, NULL, 16);
+		tail += 8;
+
+		if (g_strcmp0 (tail, CAMEL_POSTINGS_INDEX_SUFFIX) == 0) {
+			if (keep_file_ids && g_hash_table_contains (keep_file_ids, GUINT_TO_POINTER (file_id)))
+				continue;
+		} else if (g_strcmp0 (tail, CAMEL_POSTINGS_INDEX_SUFFIX ".tmp") != 0) {
+			continue;
+		}
+
+		filename = g_build_filename (dirname, name, NULL);
+		d (printf ("Removing unused segment '%s'\n", filename));
+		g_unlink (filename);
+		g_free (filename);
+	}
+
+	if (dir)
+		g_dir_close (dir);
+
+	g_free (dirname);
+	g_free (basename);
+}
+
+/* ********************************************************************** */
+/* Segments */
+/* ********************************************************************** */
+
+static PostingsSegment *
+postings_segment_open (const gchar *filename,
+                       guint32 generation,
+                       guint32 file_id)
+{
+	PostingsSegment *seg;
+	GMappedFile *mapped;
+	GError *local_error = NULL;
+	const gchar *data;
+	guint64 names_offset, words_offset;
+	guint32 n_names, n_words;
+	gsize size;
+
+	mapped = g_mapped_file_new (filename, FALSE, &local_error);
+	if (!mapped) {
+		d (printf ("Cannot map segment '%s': %s\n", filename, local_error ? local_error->message : "Unknown error"));
+		errno = g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT) ? ENOENT : EINVAL;
+		g_clear_error (&local_error);
+		return NULL;
+	}
+
+	data = g_mapped_file_get_contents (mapped);
+	size = g_mapped_file_get_length (mapped);
+
+	if (!data || size < SEGMENT_HEADER_SIZE + 1 ||
+	    memcmp (data, CAMEL_POSTINGS_SEGMENT_VERSION, 8) != 0 ||
+	    data[size - 1] != '\0')
+		goto invalid;
+
+	n_names = postings_read_u32 (data + 8);
+	n_words = postings_read_u32 (data + 12);
+	names_offset = postings_read_u64 (data + 16);
+	words_offset = postings_read_u64 (data + 24);
+
+	if (names_offset > size || (size - names_offset) / SEGMENT_NAME_ENTRY_SIZE < n_names ||
+	    words_offset > size || (size - words_offset) / SEGMENT_WORD_ENTRY_SIZE < n_words)
+		goto invalid;
+
+	seg = g_slice_new0 (PostingsSegment);
+	seg->ref_count = 1;
+	seg->generation = generation;
+	seg->file_id = file_id;
+	seg->filename = g_strdup (filename);
+	seg->mapped = mapped;
+	seg->data = data;
+	seg->size = size;
+	seg->n_names = n_names;
+	seg->n_words = n_words;
+	seg->names_table = data + names_offset;
+	seg->words_table = data + words_offset;
+
+	return seg;
+
+ invalid:
+	g_warning ("%s: Invalid index segment '%s'", G_STRFUNC, filename);
+	g_mapped_file_unref (mapped);
+	errno = EINVAL;
+
+	return NULL;
+}
+
+static PostingsSegment *
+postings_segment_ref (PostingsSegment *seg)
+{
+	g_atomic_int_inc (&seg->ref_count);
+
+	return seg;
+}
+
+static void
+postings_segment_unref (gpointer ptr)
+{
+	PostingsSegment *seg = ptr;
+
+	if (!seg || !g_atomic_int_dec_and_test (&seg->ref_count))
+		return;
+
+	g_mapped_file_unref (seg->mapped);
+
+	if (seg->obsolete) {
+		d (printf ("Removing merged segment '%s'\n", seg->filename));
+		g_unlink (seg->filename);
+	}
+
+	g_free (seg->filename);
+	g_slice_free (PostingsSegment, seg);
+}
+
+static const gchar *
+postings_segment_get_string (PostingsSegment *seg,
+                             guint64 offset)
+{
+	if (offset >= seg->size)
+		return "";
+
+	return seg->data + offset;
+}
+
+static const gchar *
+postings_segment_get_name (PostingsSegment *seg,
+                           guint32 rank)
+{
+	return postings_segment_get_string (seg, postings_read_u64 (seg->names_table + (gsize) rank * SEGMENT_NAME_ENTRY_SIZE));
+}
+
+static const gchar *
+postings_segment_get_word (PostingsSegment *seg,
+                           guint32 word_index)
+{
+	return postings_segment_get_string (seg, postings_read_u64 (seg->words_table + (gsize) word_index * SEGMENT_WORD_ENTRY_SIZE));
+}
+
+/* Returns the rank of the @name, or -1 when not found */
+static gint64
+postings_segment_find_name (PostingsSegment *seg,
+                            const gchar *name)
+{
+	guint32 lo = 0, hi = seg->n_names;
+
+	while (lo < hi) {
+		guint32 mid = lo + (hi - lo) / 2;
+		gint cmp = strcmp (name, postings_segment_get_name (seg, mid));
+
+		if (cmp == 0)
+			return mid;
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return -1;
+}
+
+/* Returns the index of the @word, or -1 when not found */
+static gint64
+postings_segment_find_word (PostingsSegment *seg,
+                            const gchar *word)
+{
+	guint32 lo = 0, hi = seg->n_words;
+
+	while (lo < hi) {
+		guint32 mid = lo + (hi - lo) / 2;
+		gint cmp = strcmp (word, postings_segment_get_word (seg, mid));
+
+		if (cmp == 0)
+			return mid;
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return -1;
+}
+
+/* Appends name ranks of the word at @word_index into the @ranks */
+static void
+postings_segment_read_postings (PostingsSegment *seg,
+                                guint32 word_index,
+                                GArray *ranks)
+{
+	const gchar *entry = seg->words_table + (gsize) word_index * SEGMENT_WORD_ENTRY_SIZE;
+	const guchar *ptr, *end;
+	guint64 offset;
+	guint32 n_postings, len, rank = 0, delta, ii;
+
+	offset = postings_read_u64 (entry + 8);
+	n_postings = postings_read_u32 (entry + 16);
+	len = postings_read_u32 (entry + 20);
+
+	if (offset > seg->size || len > seg->size - offset)
+		return;
+
+	ptr = (const guchar *) seg->data + offset;
+	end = ptr + len;
+
+	for (ii = 0; ii < n_postings && postings_read_varint (&ptr, end, &delta); ii++) {
+		rank += delta;
+		if (rank >= seg->n_names)
+			break;
+		g_array_append_val (ranks, rank);
+	}
+}
+
+static gboolean
+postings_segment_name_is_alive (PostingsSegment *seg,
+                                GHashTable *tombstones,
+                                const gchar *name)
+{
+	guint32 generation;
+
+	if (!tombstones || !g_hash_table_size (tombstones))
+		return TRUE;
+
+	/* a deleted name is kept only in segments written after the delete */
+	generation = GPOINTER_TO_UINT (g_hash_table_lookup (tombstones, name));
+
+	return seg->generation >= generation;
+}
+
+/* ****************************** */
+
+typedef struct _SegmentWriter {
+	FILE *fp;
+	gchar *filename;
+	gchar *tmpname;
+	guint64 offset;
+	guint32 n_names;
+	guint32 n_words;
+	GByteArray *names;	/* the names table */
+	GByteArray *words;	/* the words table */
+	GByteArray *postings;	/* postings of the current word */
+	gboolean failed;
+} SegmentWriter;
+
+static SegmentWriter *
+segment_writer_new (const gchar *filename)
+{
+	SegmentWriter *writer;
+	gchar header[SEGMENT_HEADER_SIZE] = { 0 };
+
+	writer = g_slice_new0 (SegmentWriter);
+	writer->filename = g_strdup (filename);
+	writer->tmpname = g_strconcat (filename, ".tmp", NULL);
+	writer->names = g_byte_array_new ();
+	writer->words = g_byte_array_new ();
+	writer->postings = g_byte_array_new ();
+
+	writer->fp = g_fopen (writer->tmpname, "wb");
+	if (!writer->fp || fwrite (header, 1, sizeof (header), writer->fp) != sizeof (header))
+		writer->failed = TRUE;
+
+	writer->offset = sizeof (header);
+
+	return writer;
+}
+
+static void
+segment_writer_free (SegmentWriter *writer)
+{
+	if (!writer)
+		return;
+
+	if (writer->fp) {
+		fclose (writer->fp);
+		g_unlink (writer->tmpname);
+	}
+
+	g_byte_array_unref (writer->names);
+	g_byte_array_unref (writer->words);
+	g_byte_array_unref (writer->postings);
+	g_free (writer->filename);
+	g_free (writer->tmpname);
+	g_slice_free (SegmentWriter, writer);
+}
+
+static void
+segment_writer_write (SegmentWriter *writer,
+                      gconstpointer data,
+                      gsize len)
+{
+	if (writer->failed || !len)
+		return;
+
+	if (fwrite (data, 1, len, writer->fp) != len)
+		writer->failed = TRUE;
+	else
+		writer->offset += len;
+}
+
+/* The names should be added in the strcmp() order; the first added name has rank 0 */
+static void
+segment_writer_add_name (SegmentWriter *writer,
+                         const gchar *name)
+{
+	postings_append_u64 (writer->names, writer->offset);
+	segment_writer_write (writer, name, strlen (name) + 1);
+	writer->n_names++;
+}
+
+/* The words should be added in the strcmp() order, the @ranks should be ascending */
+static void
+segment_writer_add_word (SegmentWriter *writer,
+                         const gchar *word,
+                         const guint32 *ranks,
+                         guint n_ranks)
+{
+	guint64 word_offset;
+	guint32 last = 0;
+	guint ii;
+
+	if (!n_ranks)
+		return;
+
+	g_byte_array_set_size (writer->postings, 0);
+	for (ii = 0; ii < n_ranks; ii++) {
+		postings_append_varint (writer->postings, ranks[ii] - last);
+		last = ranks[ii];
+	}
+
+	word_offset = writer->offset;
+	segment_writer_write (writer, word, strlen (word) + 1);
+
+	postings_append_u64 (writer->words, word_offset);
+	postings_append_u64 (writer->words, writer->offset);
+	postings_append_u32 (writer->words, n_ranks);
+	postings_append_u32 (writer->words, writer->postings->len);
+
+	segment_writer_write (writer, writer->postings->data, writer->postings->len);
+	writer->n_words++;
+}
+
+static gboolean
+segment_writer_finish (SegmentWriter *writer)
+{
+	GByteArray *header;
+	guint64 names_offset, words_offset;
+	gint err;
+
+	names_offset = writer->offset;
+	segment_writer_write (writer, writer->names->data, writer->names->len);
+	words_offset = writer->offset;
+	segment_writer_write (writer, writer->words->data, writer->words->len);
+	segment_writer_write (writer, "", 1);
+
+	header = g_byte_array_sized_new (SEGMENT_HEADER_SIZE);
+	g_byte_array_append (header, (const guint8 *) CAMEL_POSTINGS_SEGMENT_VERSION, 8);
+	postings_append_u32 (header, writer->n_names);
+	postings_append_u32 (header, writer->n_words);
+	postings_append_u64 (header, names_offset);
+	postings_append_u64 (header, words_offset);
+
+	if (!writer->failed && (fseek (writer->fp, 0, SEEK_SET) != 0 ||
+	    fwrite (header->data, 1, header->len, writer->fp) != header->len ||
+	    fflush (writer->fp) != 0))
+		writer->failed = TRUE;
+
+	g_byte_array_unref (header);
+
+#ifndef G_OS_WIN32
+	if (!writer->failed && fsync (fileno (writer->fp)) == -1)
+		writer->failed = TRUE;
+#endif
+
+	if (fclose (writer->fp) != 0)
+		writer->failed = TRUE;
+	writer->fp = NULL;
+
+	if (!writer->failed && g_rename (writer->tmpname, writer->filename) == -1)
+		writer->failed = TRUE;
+
+	if (writer->failed) {
+		err = errno;
+		g_unlink (writer->tmpname);
+		errno = err;
+	}
+
+	return !writer->failed;
+}
+
+/* ********************************************************************** */
+/* Manifest */
+/* ********************************************************************** */
+
+typedef struct _ManifestSegment {
+	guint32 generation;
+	guint32 file_id;
+} ManifestSegment;
+
+static gboolean
+postings_index_read_manifest (const gchar *path,
+                              guint32 *out_next_generation,
+                              guint32 *out_next_file_id,
+                              GArray **out_segments,
+                              GHashTable **out_tombstones)
+{
+	GArray *segments;
+	GHashTable *tombstones;
+	GError *local_error = NULL;
+	gchar *filename, *contents = NULL;
+	const gchar *ptr, *end;
+	gsize length = 0;
+	guint32 n_segments, n_tombstones, ii;
+
+	filename = postings_index_manifest_path (path);
+
+	if (!g_file_get_contents (filename, &contents, &length, &local_error)) {
+		errno = g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT) ? ENOENT : EINVAL;
+		g_clear_error (&local_error);
+		g_free (filename);
+		return FALSE;
+	}
+
+	g_free (filename);
+
+	ptr = contents;
+	end = contents + length;
+
+	#define need(_n) G_STMT_START { if ((gsize) (end - ptr) < (gsize) (_n)) goto invalid; } G_STMT_END
+
+	need (8 + 3 * 4);
+	if (memcmp (ptr, CAMEL_POSTINGS_INDEX_VERSION, 8) != 0)
+		goto invalid;
+	ptr += 8;
+
+	*out_next_generation = postings_read_u32 (ptr);
+	ptr += 4;
+	*out_next_file_id = postings_read_u32 (ptr);
+	ptr += 4;
+	n_segments = postings_read_u32 (ptr);
+	ptr += 4;
+
+	need ((guint64) n_segments * 8);
+
+	segments = g_array_sized_new (FALSE, FALSE, sizeof (ManifestSegment), n_segments);
+	tombstones = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	for (ii = 0; ii < n_segments; ii++) {
+		ManifestSegment ms;
+
+		ms.generation = postings_read_u32 (ptr);
+		ms.file_id = postings_read_u32 (ptr + 4);
+		ptr += 8;
+
+		g_array_append_val (segments, ms);
+	}
+
+	if ((gsize) (end - ptr) < 4)
+		goto invalid_tables;
+
+	n_tombstones = postings_read_u32 (ptr);
+	ptr += 4;
+
+	for (ii = 0; ii < n_tombstones; ii++) {
+		guint32 generation, len;
+
+		if ((gsize) (end - ptr) < 8)
+			goto invalid_tables;
+
+		generation = postings_read_u32 (ptr);
+		len = postings_read_u32 (ptr + 4);
+		ptr += 8;
+
+		if ((gsize) (end - ptr) < len)
+			goto invalid_tables;
+
+		g_hash_table_insert (tombstones, g_strndup (ptr, len), GUINT_TO_POINTER (generation));
+		ptr += len;
+	}
+
+	#undef need
+
+	g_free (contents);
+
+	*out_segments = segments;
+	if (out_tombstones)
+		*out_tombstones = tombstones;
+	else
+		g_hash_table_unref (tombstones);
+
+	return TRUE;
+
+ invalid_tables:
+	g_array_unref (segments);
+	g_hash_table_unref (tombstones);
+ invalid:
+	g_warning ("%s: Invalid index manifest for '%s'", G_STRFUNC, path);
+	g_free (contents);
+	errno = EINVAL;
+
+	return FALSE;
+}
+
+/* call locked */
+static gboolean
+postings_index_write_manifest_locked (CamelPostingsIndex *idx)
+{
+	CamelPostingsIndexPrivate *priv = idx->priv;
+	GByteArray *bytes;
+	GHashTableIter iter;
+	gpointer key, value;
+	gchar *filename;
+	gboolean success;
+	guint ii;
+
+	bytes = g_byte_array_new ();
+	g_byte_array_append (bytes, (const guint8 *) CAMEL_POSTINGS_INDEX_VERSION, 8);
+	postings_append_u32 (bytes, priv->next_generation);
+	postings_append_u32 (bytes, priv->next_file_id);
+	postings_append_u32 (bytes, priv->segments->len);
+
+	for (ii = 0; ii < priv->segments->len; ii++) {
+		PostingsSegment *seg = g_ptr_array_index (priv->segments, ii);
+
+		postings_append_u32 (bytes, seg->generation);
+		postings_append_u32 (bytes, seg->file_id);
+	}
+
+	postings_append_u32 (bytes, g_hash_table_size (priv->tombstones));
+
+	g_hash_table_iter_init (&iter, priv->tombstones);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		const gchar *name = key;
+		guint32 len = strlen (name);
+
+		postings_append_u32 (bytes, GPOINTER_TO_UINT (value));
+		postings_append_u32 (bytes, len);
+		g_byte_array_append (bytes, (const guint8 *) name, len);
+	}
+
+	filename = postings_index_manifest_path (priv->base_path);
+	success = g_file_set_contents (filename, (const gchar *) bytes->data, bytes->len, NULL);
+	if (success)
+		priv->manifest_dirty = FALSE;
+	else
+		errno = EIO;
+
+	g_byte_array_unref (bytes);
+	g_free (filename);
+
+	return success;
+}
+
+/* ********************************************************************** */
+/* Pending names */
+/* ********************************************************************** */
+
+/* call locked */
+static guint32
+postings_index_pending_add_name_locked (CamelPostingsIndexPrivate *priv,
+                                        const gchar *name)
+{
+	const gchar *stored;
+	guint32 index;
+
+	stored = g_string_chunk_insert (priv->pending_strings, name);
+	index = priv->pending_names->len;
+
+	g_ptr_array_add (priv->pending_names, (gpointer) stored);
+	g_hash_table_insert (priv->pending_by_name, (gpointer) stored, GUINT_TO_POINTER (index + 1));
+
+	return index;
+}
+
+/* call locked */
+static void
+postings_index_pending_add_word_locked (CamelPostingsIndexPrivate *priv,
+                                        const gchar *word,
+                                        guint32 index)
+{
+	GArray *indexes;
+
+	indexes = g_hash_table_lookup (priv->pending_words, word);
+	if (!indexes) {
+		indexes = g_array_new (FALSE, FALSE, sizeof (guint32));
+		g_hash_table_insert (priv->pending_words, g_string_chunk_insert_const (priv->pending_strings, word), indexes);
+	}
+
+	if (!indexes->len || g_array_index (indexes, guint32, indexes->len - 1) != index)
+		g_array_append_val (indexes, index);
+}
+
+/* call locked */
+static void
+postings_index_pending_clear_locked (CamelPostingsIndexPrivate *priv)
+{
+	g_hash_table_remove_all (priv->pending_words);
+	g_hash_table_remove_all (priv->pending_by_name);
+	g_ptr_array_set_size (priv->pending_names, 0);
+	g_string_chunk_clear (priv->pending_strings);
+}
+
+/* call locked */
+static void
+postings_index_delete_name_locked (CamelPostingsIndex *idx,
+                                   const gchar *name)
+{
+	CamelPostingsIndexPrivate *priv = idx->priv;
+	gpointer value = NULL;
+	guint ii;
+
+	g_hash_table_remove (priv->open_names, name);
+
+	if (g_hash_table_lookup_extended (priv->pending_by_name, name, NULL, &value)) {
+		priv->pending_names->pdata[GPOINTER_TO_UINT (value) - 1] = NULL;
+		g_hash_table_remove (priv->pending_by_name, name);
+	}
+
+	for (ii = 0; ii < priv->segments->len; ii++) {
+		PostingsSegment *seg = g_ptr_array_index (priv->segments, ii);
+
+		if (postings_segment_find_name (seg, name) >= 0 &&
+		    postings_segment_name_is_alive (seg, priv->tombstones, name)) {
+			/* hides the name in all segments written so far */
+			g_hash_table_insert (priv->tombstones, g_strdup (name), GUINT_TO_POINTER (priv->next_generation));
+			priv->manifest_dirty = TRUE;
+			break;
+		}
+	}
+}
+
+/* ********************************************************************** */
+/* Merging */
+/* ********************************************************************** */
+
+typedef struct _MergeName {
+	const gchar *name;
+	guint source;
+	guint32 rank;
+} MergeName;
+
+static gint
+postings_compare_merge_names (gconstpointer a,
+                              gconstpointer b)
+{
+	const MergeName *aa = a, *bb = b;
+	gint cmp;
+
+	cmp = strcmp (aa->name, bb->name);
+	if (!cmp)
+		cmp = aa->source < bb->source ? -1 : aa->source > bb->source ? 1 : 0;
+
+	return cmp;
+}
+
+/* Writes all alive names of the @segments into a single new segment. The @segments
+ * are ordered by their generation, the result uses the generation of the last. */
+static PostingsSegment *
+postings_index_merge_segments (GPtrArray *segments,
+                               GHashTable *tombstones,
+                               const gchar *filename,
+                               guint32 file_id)
+{
+	PostingsSegment *merged = NULL;
+	SegmentWriter *writer;
+	GArray *names, *ranks, *raw;
+	guint32 **maps, *word_indexes, new_rank = 0;
+	guint ii, jj;
+
+	g_return_val_if_fail (segments->len > 0, NULL);
+
+	maps = g_new0 (guint32 *, segments->len);
+	word_indexes = g_new0 (guint32, segments->len);
+	names = g_array_new (FALSE, FALSE, sizeof (MergeName));
+
+	for (ii = 0; ii < segments->len; ii++) {
+		PostingsSegment *seg = g_ptr_array_index (segments, ii);
+		guint32 rank;
+
+		maps[ii] = g_new (guint32, MAX (seg->n_names, 1));
+		memset (maps[ii], 0xff, sizeof (guint32) * MAX (seg->n_names, 1));
+
+		for (rank = 0; rank < seg->n_names; rank++) {
+			MergeName mn;
+
+			mn.name = postings_segment_get_name (seg, rank);
+			mn.source = ii;
+			mn.rank = rank;
+
+			if (postings_segment_name_is_alive (seg, tombstones, mn.name))
+				g_array_append_val (names, mn);
+		}
+	}
+
+	g_array_sort (names, postings_compare_merge_names);
+
+	writer = segment_writer_new (filename);
+
+	for (ii = 0; ii < names->len; ii++) {
+		MergeName *mn = &g_array_index (names, MergeName, ii);
+
+		/* the same name in a newer segment wins */
+		if (ii + 1 < names->len && strcmp (mn->name, g_array_index (names, MergeName, ii + 1).name) == 0)
+			continue;
+
+		segment_writer_add_name (writer, mn->name);
+		maps[mn->source][mn->rank] = new_rank++;
+	}
+
+	ranks = g_array_new (FALSE, FALSE, sizeof (guint32));
+	raw = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+	/* merge the sorted word tables */
+	while (!writer->failed) {
+		const gchar *word = NULL;
+
+		for (ii = 0; ii < segments->len; ii++) {
+			PostingsSegment *seg = g_ptr_array_index (segments, ii);
+
+			if (word_indexes[ii] < seg->n_words) {
+				const gchar *candidate = postings_segment_get_word (seg, word_indexes[ii]);
+
+				if (!word || strcmp (candidate, word) < 0)
+					word = candidate;
+			}
+		}
+
+		if (!word)
+			break;
+
+		g_array_set_size (ranks, 0);
+
+		for (ii = 0; ii < segments->len; ii++) {
+			PostingsSegment *seg = g_ptr_array_index (segments, ii);
+
+			if (word_indexes[ii] >= seg->n_words ||
+			    strcmp (word, postings_segment_get_word (seg, word_indexes[ii])) != 0)
+				continue;
+
+			g_array_set_size (raw, 0);
+			postings_segment_read_postings (seg, word_indexes[ii], raw);
+
+			for (jj = 0; jj < raw->len; jj++) {
+				guint32 rank = maps[ii][g_array_index (raw, guint32, jj)];
+
+				if (rank != G_MAXUINT32)
+					g_array_append_val (ranks, rank);
+			}
+
+			word_indexes[ii]++;
+		}
+
+		if (ranks->len) {
+			g_array_sort (ranks, postings_compare_u32);
+			segment_writer_add_word (writer, word, (const guint32 *) ranks->data, ranks->len);
+		}
+	}
+
+	if (segment_writer_finish (writer)) {
+		PostingsSegment *last = g_ptr_array_index (segments, segments->len - 1);
+
+		merged = postings_segment_open (filename, last->generation, file_id);
+	}
+
+	segment_writer_free (writer);
+	g_array_unref (ranks);
+	g_array_unref (raw);
+	g_array_unref (names);
+
+	for (ii = 0; ii < segments->len; ii++)
+		g_free (maps[ii]);
+	g_free (maps);
+	g_free (word_indexes);
+
+	return merged;
+}
+
+typedef struct _MergeData {
+	CamelPostingsIndex *idx;
+	GPtrArray *segments;	/* PostingsSegment * */
+	GHashTable *tombstones;
+	gchar *filename;
+	guint32 file_id;
+} MergeData;
+
+static void
+merge_data_free (MergeData *md)
+{
+	if (md) {
+		g_ptr_array_unref (md->segments);
+		g_hash_table_unref (md->tombstones);
+		g_free (md->filename);
+		g_clear_object (&md->idx);
+		g_slice_free (MergeData, md);
+	}
+}
+
+/* call locked; takes a snapshot of the current segments for the merge */
+static MergeData *
+postings_index_prepare_merge_locked (CamelPostingsIndex *idx)
+{
+	CamelPostingsIndexPrivate *priv = idx->priv;
+	GHashTableIter iter;
+	gpointer key, value;
+	MergeData *md;
+	guint ii;
+
+	md = g_slice_new0 (MergeData);
+	md->idx = g_object_ref (idx);
+	md->segments = g_ptr_array_new_full (priv->segments->len, postings_segment_unref);
+	md->tombstones = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	md->file_id = priv->next_file_id++;
+	md->filename = postings_index_segment_path (priv->base_path, md->file_id);
+
+	for (ii = 0; ii < priv->segments->len; ii++)
+		g_ptr_array_add (md->segments, postings_segment_ref (g_ptr_array_index (priv->segments, ii)));
+
+	g_hash_table_iter_init (&iter, priv->tombstones);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_hash_table_insert (md->tombstones, g_strdup (key), value);
+
+	priv->merge_running = TRUE;
+
+	return md;
+}
+
+/* call locked; replaces the merged segments with the @merged */
+static gboolean
+postings_index_finish_merge_locked (CamelPostingsIndex *idx,
+                                    MergeData *md,
+                                    PostingsSegment *merged)
+{
+	CamelPostingsIndexPrivate *priv = idx->priv;
+	GPtrArray *segments;
+	GHashTableIter iter;
+	gpointer key, value;
+	gboolean success = TRUE;
+	guint ii;
+
+	priv->merge_running = FALSE;
+	g_cond_broadcast (&priv->merge_cond);
+
+	if (!merged)
+		return FALSE;
+
+	segments = g_ptr_array_new_full (priv->segments->len, postings_segment_unref);
+	g_ptr_array_add (segments, merged);
+
+	for (ii = 0; ii < priv->segments->len; ii++) {
+		PostingsSegment *seg = g_ptr_array_index (priv->segments, ii);
+
+		if (g_ptr_array_find (md->segments, seg, NULL))
+			seg->obsolete = TRUE;
+		else
+			g_ptr_array_add (segments, postings_segment_ref (seg));
+	}
+
+	g_ptr_array_unref (priv->segments);
+	priv->segments = segments;
+
+	/* All segments a delete applied to, when it was known to the merge,
+	 * had been merged, thus the delete does not hide anything anymore.
+	 * The name could be deleted again meanwhile, with a new generation. */
+	g_hash_table_iter_init (&iter, priv->tombstones);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		gpointer merged_value = NULL;
+
+		if (g_hash_table_lookup_extended (md->tombstones, key, NULL, &merged_value) && merged_value == value)
+			g_hash_table_iter_remove (&iter);
+	}
+
+	if (!postings_index_write_manifest_locked (idx)) {
+		g_warning ("%s: Failed to write index manifest of '%s'", G_STRFUNC, priv->base_path);
+		success = FALSE;
+	}
+
+	return success;
+}
+
+static gpointer
+postings_index_merge_thread (gpointer user_data)
+{
+	MergeData *md = user_data;
+	PostingsSegment *merged;
+
+	merged = postings_index_merge_segments (md->segments, md->tombstones, md->filename, md->file_id);
+
+	g_mutex_lock (&md->idx->priv->lock);
+	postings_index_finish_merge_locked (md->idx, md, merged);
+	g_mutex_unlock (&md->idx->priv->lock);
+
+	merge_data_free (md);
+
+	return NULL;
+}
+
+/* call locked */
+static void
+postings_index_wait_merge_locked (CamelPostingsIndex *idx)
+{
+	while (idx->priv->merge_running)
+		g_cond_wait (&idx->priv->merge_cond, &idx->priv->lock);
+}
+
+/* call locked */
+static void
+postings_index_maybe_merge_locked (CamelPostingsIndex *idx)
+{
+	CamelPostingsIndexPrivate *priv = idx->priv;
+	MergeData *md;
+	GThread *thread;
+
+	if (priv->merge_running || priv->segments->len <= CAMEL_POSTINGS_INDEX_MAX_SEGMENTS)
+		return;
+
+	md = postings_index_prepare_merge_locked (idx);
+
+	thread = g_thread_try_new ("camel-postings-index-merge", postings_index_merge_thread, md, NULL);
+	if (thread) {
+		g_thread_unref (thread);
+	} else {
+		priv->merge_running = FALSE;
+		merge_data_free (md);
+	}
+}
+
+/* ********************************************************************** */
+/* CamelPostingsIndex */
+/* ********************************************************************** */
+
+/* call locked; writes the pending names into a new segment */
+static gint
+postings_index_flush_locked (CamelPostingsIndex *idx)
+{
+	CamelPostingsIndexPrivate *priv = idx->priv;
+	GArray *live, *ranks;
+	GPtrArray *words;
+	GHashTableIter iter;
+	gpointer key;
+	guint32 *map;
+	guint ii, jj;
+	gint ret = 0;
+
+	if (!priv->writable)
+		return 0;
+
+	live = g_array_new (FALSE, FALSE, sizeof (const gchar *));
+	for (ii = 0; ii < priv->pending_names->len; ii++) {
+		const gchar *name = g_ptr_array_index (priv->pending_names, ii);
+
+		if (name)
+			g_array_append_val (live, name);
+	}
+
+	if (live->len) {
+		PostingsSegment *seg = NULL;
+		SegmentWriter *writer;
+		gchar *filename;
+		guint32 generation, file_id;
+
+		g_array_sort (live, postings_compare_strings);
+
+		generation = priv->next_generation++;
+		file_id = priv->next_file_id++;
+		filename = postings_index_segment_path (priv->base_path, file_id);
+
+		d (printf ("Writing %u names into segment '%s'\n", live->len, filename));
+
+		/* pending index ~> rank in the new segment */
+		map = g_new (guint32, priv->pending_names->len);
+		memset (map, 0xff, sizeof (guint32) * priv->pending_names->len);
+
+		writer = segment_writer_new (filename);
+
+		for (ii = 0; ii < live->len; ii++) {
+			const gchar *name = g_array_index (live, const gchar *, ii);
+			gpointer value = g_hash_table_lookup (priv->pending_by_name, name);
+
+			segment_writer_add_name (writer, name);
+			map[GPOINTER_TO_UINT (value) - 1] = ii;
+		}
+
+		words = g_ptr_array_sized_new (g_hash_table_size (priv->pending_words));
+		g_hash_table_iter_init (&iter, priv->pending_words);
+		while (g_hash_table_iter_next (&iter, &key, NULL))
+			g_ptr_array_add (words, key);
+
+		g_ptr_array_sort (words, postings_compare_strings);
+
+		ranks = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+		for (ii = 0; ii < words->len && !writer->failed; ii++) {
+			const gchar *word = g_ptr_array_index (words, ii);
+			GArray *indexes = g_hash_table_lookup (priv->pending_words, word);
+
+			g_array_set_size (ranks, 0);
+			for (jj = 0; jj < indexes->len; jj++) {
+				guint32 rank = map[g_array_index (indexes, guint32, jj)];
+
+				if (rank != G_MAXUINT32)
+					g_array_append_val (ranks, rank);
+			}
+
+			g_array_sort (ranks, postings_compare_u32);
+			segment_writer_add_word (writer, word, (const guint32 *) ranks->data, ranks->len);
+		}
+
+		if (segment_writer_finish (writer))
+			seg = postings_segment_open (filename, generation, file_id);
+
+		if (seg) {
+			g_ptr_array_add (priv->segments, seg);
+			priv->manifest_dirty = TRUE;
+		} else {
+			g_warning ("%s: Failed to write index segment '%s': %s", G_STRFUNC, filename, g_strerror (errno));
+			ret = -1;
+		}
+
+		segment_writer_free (writer);
+		g_array_unref (ranks);
+		g_ptr_array_unref (words);
+		g_free (filename);
+		g_free (map);
+	}
+
+	g_array_unref (live);
+
+	if (ret == 0)
+		postings_index_pending_clear_locked (priv);
+
+	if (priv->manifest_dirty && !postings_index_write_manifest_locked (idx))
+		ret = -1;
+
+	postings_index_maybe_merge_locked (idx);
+
+	return ret;
+}
+
+static gboolean
+postings_index_import_text_index (CamelPostingsIndex *idx,
+                                  const gchar *path)
+{
+	CamelPostingsIndexPrivate *priv = idx->priv;
+	CamelTextIndex *text_index;
+	CamelIndexCursor *words;
+	const gchar *word;
+	gint ret;
+
+	text_index = camel_text_index_new (path, O_RDONLY);
+	if (!text_index)
+		return FALSE;
+
+	d (printf ("Converting text index '%s'\n", path));
+
+	g_mutex_lock (&priv->lock);
+
+	words = camel_index_words (CAMEL_INDEX (text_index));
+	while (words && (word = camel_index_cursor_next (words)) != NULL) {
+		CamelIndexCursor *names;
+		const gchar *name;
+
+		names = camel_index_find (CAMEL_INDEX (text_index), word);
+		while (names && (name = camel_index_cursor_next (names)) != NULL) {
+			gpointer value = g_hash_table_lookup (priv->pending_by_name, name);
+			guint32 index;
+
+			if (value)
+				index = GPOINTER_TO_UINT (value) - 1;
+			else
+				index = postings_index_pending_add_name_locked (priv, name);
+
+			postings_index_pending_add_word_locked (priv, word, index);
+		}
+
+		g_clear_object (&names);
+	}
+
+	g_clear_object (&words);
+
+	ret = postings_index_flush_locked (idx);
+
+	g_mutex_unlock (&priv->lock);
+
+	g_object_unref (text_index);
+
+	if (ret == 0)
+		camel_text_index_remove (path);
+
+	return ret == 0;
+}
+
+static void
+postings_index_dispose (GObject *object)
+{
+	CamelPostingsIndexPrivate *priv = CAMEL_POSTINGS_INDEX (object)->priv;
+
+	g_mutex_lock (&priv->lock);
+
+	postings_index_wait_merge_locked (CAMEL_POSTINGS_INDEX (object));
+
+	/* Only run this the first time. */
+	if (priv->segments && (CAMEL_INDEX (object)->state & CAMEL_INDEX_DELETED) == 0 &&
+	    (priv->pending_names->len || priv->manifest_dirty)) {
+		postings_index_flush_locked (CAMEL_POSTINGS_INDEX (object));
+
+		/* the flush could start a merge */
+		postings_index_wait_merge_locked (CAMEL_POSTINGS_INDEX (object));
+	}
+
+	g_mutex_unlock (&priv->lock);
+
+	/* Chain up to parent's dispose () method. */
+	G_OBJECT_CLASS (camel_postings_index_parent_class)->dispose (object);
+}
+
+static void
+postings_index_finalize (GObject *object)
+{
+	CamelPostingsIndexPrivate *priv = CAMEL_POSTINGS_INDEX (object)->priv;
+
+	g_ptr_array_unref (priv->segments);
+	g_hash_table_destroy (priv->tombstones);
+	g_hash_table_destroy (priv->pending_words);
+	g_hash_table_destroy (priv->pending_by_name);
+	g_hash_table_destroy (priv->open_names);
+	g_ptr_array_unref (priv->pending_names);
+	g_string_chunk_free (priv->pending_strings);
+	g_free (priv->base_path);
+
+	g_mutex_clear (&priv->lock);
+	g_cond_clear (&priv->merge_cond);
+
+	/* Chain up to parent's finalize () method. */
+	G_OBJECT_CLASS (camel_postings_index_parent_class)->finalize (object);
+}
+
+static gint
+postings_index_sync (CamelIndex *idx)
+{
+	CamelPostingsIndexPrivate *priv = CAMEL_POSTINGS_INDEX (idx)->priv;
+	gint ret;
+
+	g_mutex_lock (&priv->lock);
+	ret = postings_index_flush_locked (CAMEL_POSTINGS_INDEX (idx));
+	g_mutex_unlock (&priv->lock);
+
+	return ret;
+}
+
+static gint
+postings_index_compress (CamelIndex *idx)
+{
+	CamelPostingsIndexPrivate *priv = CAMEL_POSTINGS_INDEX (idx)->priv;
+	MergeData *md = NULL;
+	gint ret;
+
+	g_mutex_lock (&priv->lock);
+
+	postings_index_wait_merge_locked (CAMEL_POSTINGS_INDEX (idx));
+
+	ret = postings_index_flush_locked (CAMEL_POSTINGS_INDEX (idx));
+
+	/* the flush could start a background merge */
+	postings_index_wait_merge_locked (CAMEL_POSTINGS_INDEX (idx));
+
+	if (ret == 0 && priv->writable && (priv->segments->len > 1 ||
+	    (priv->segments->len == 1 && g_hash_table_size (priv->tombstones) > 0)))
+		md = postings_index_prepare_merge_locked (CAMEL_POSTINGS_INDEX (idx));
+
+	g_mutex_unlock (&priv->lock);
+
+	if (md) {
+		PostingsSegment *merged;
+
+		merged = postings_index_merge_segments (md->segments, md->tombstones, md->filename, md->file_id);
+
+		g_mutex_lock (&priv->lock);
+		if (!postings_index_finish_merge_locked (CAMEL_POSTINGS_INDEX (idx), md, merged))
+			ret = -1;
+		g_mutex_unlock (&priv->lock);
+
+		merge_data_free (md);
+	}
+
+	return ret;
+}
+
+static gint
+postings_index_delete (CamelIndex *idx)
+{
+	CamelPostingsIndexPrivate *priv = CAMEL_POSTINGS_INDEX (idx)->priv;
+	gint ret;
+
+	g_mutex_lock (&priv->lock);
+
+	postings_index_wait_merge_locked (CAMEL_POSTINGS_INDEX (idx));
+
+	g_ptr_array_set_size (priv->segments, 0);
+	g_hash_table_remove_all (priv->tombstones);
+	g_hash_table_remove_all (priv->open_names);
+	postings_index_pending_clear_locked (priv);
+	priv->manifest_dirty = FALSE;
+
+	ret = camel_postings_index_remove (priv->base_path);
+
+	g_mutex_unlock (&priv->lock);
+
+	return ret;
+}
+
+static gint
+postings_index_rename (CamelIndex *idx,
+                       const gchar *path)
+{
+	CamelPostingsIndexPrivate *priv = CAMEL_POSTINGS_INDEX (idx)->priv;
+	gchar *oldname, *newname;
+	guint ii;
+	gint err;
+
+	g_mutex_lock (&priv->lock);
+
+	postings_index_wait_merge_locked (CAMEL_POSTINGS_INDEX (idx));
+
+	for (ii = 0; ii < priv->segments->len; ii++) {
+		PostingsSegment *seg = g_ptr_array_index (priv->segments, ii);
+
+		newname = postings_index_segment_path (path, seg->file_id);
+		if (g_rename (seg->filename, newname) == -1) {
+			err = errno;
+			g_free (newname);
+			goto rollback;
+		}
+
+		g_free (seg->filename);
+		seg->filename = newname;
+	}
+
+	oldname = postings_index_manifest_path (priv->base_path);
+	newname = postings_index_manifest_path (path);
+
+	if (g_rename (oldname, newname) == -1 && (errno != ENOENT || priv->segments->len > 0)) {
+		err = errno;
+		g_free (oldname);
+		g_free (newname);
+		goto rollback;
+	}
+
+	g_free (oldname);
+
+	g_free (priv->base_path);
+	priv->base_path = g_strdup (path);
+
+	g_free (idx->path);
+	idx->path = newname;
+
+	g_mutex_unlock (&priv->lock);
+
+	return 0;
+
+ rollback:
+	while (ii > 0) {
+		PostingsSegment *seg = g_ptr_array_index (priv->segments, ii - 1);
+
+		oldname = postings_index_segment_path (priv->base_path, seg->file_id);
+		if (g_rename (seg->filename, oldname) == -1) {
+			g_warning (
+				"%s: Failed to rename '%s' to '%s': %s",
+				G_STRFUNC, seg->filename, oldname, g_strerror (errno));
+		}
+
+		g_free (seg->filename);
+		seg->filename = oldname;
+		ii--;
+	}
+
+	g_mutex_unlock (&priv->lock);
+
+	errno = err;
+
+	return -1;
+}
+
+/* call locked */
+static gboolean
+postings_index_has_name_locked (CamelPostingsIndex *idx,
+                                const gchar *name)
+{
+	CamelPostingsIndexPrivate *priv = idx->priv;
+	guint ii;
+
+	if (g_hash_table_contains (priv->open_names, name) ||
+	    g_hash_table_contains (priv->pending_by_name, name))
+		return TRUE;
+
+	for (ii = priv->segments->len; ii > 0; ii--) {
+		PostingsSegment *seg = g_ptr_array_index (priv->segments, ii - 1);
+
+		if (postings_segment_find_name (seg, name) >= 0 &&
+		    postings_segment_name_is_alive (seg, priv->tombstones, name))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gint
+postings_index_has_name (CamelIndex *idx,
+                         const gchar *name)
+{
+	CamelPostingsIndexPrivate *priv = CAMEL_POSTINGS_INDEX (idx)->priv;
+	gboolean has;
+
+	g_mutex_lock (&priv->lock);
+	has = postings_index_has_name_locked (CAMEL_POSTINGS_INDEX (idx), name);
+	g_mutex_unlock (&priv->lock);
+
+	return has;
+}
+
+static CamelIndexName *
+postings_index_add_name (CamelIndex *idx,
+                         const gchar *name)
+{
+	CamelPostingsIndexPrivate *priv = CAMEL_POSTINGS_INDEX (idx)->priv;
+	CamelPostingsIndexName *idn;
+	gpointer value;
+
+	g_mutex_lock (&priv->lock);
+
+	/* If we have it already replace it */
+	postings_index_delete_name_locked (CAMEL_POSTINGS_INDEX (idx), name);
+
+	/* the name is stored with its words in camel_index_write_name() */
+	value = g_hash_table_lookup (priv->open_names, name);
+	g_hash_table_insert (priv->open_names, g_strdup (name), GUINT_TO_POINTER (GPOINTER_TO_UINT (value) + 1));
+
+	g_mutex_unlock (&priv->lock);
+
+	idn = g_object_new (camel_postings_index_name_get_type (), NULL);
+	idn->parent.index = CAMEL_INDEX (g_object_ref (idx));
+	idn->parent.name = g_string_chunk_insert (idn->strings, name);
+
+	return CAMEL_INDEX_NAME (idn);
+}
+
+static gint
+postings_index_write_name (CamelIndex *idx,
+                           CamelIndexName *idn)
+{
+	CamelPostingsIndexPrivate *priv = CAMEL_POSTINGS_INDEX (idx)->priv;
+	GHashTableIter iter;
+	gpointer key, value;
+	gint ret = 0;
+
+	/* force 'flush' of any outstanding data */
+	camel_index_name_add_buffer (idn, NULL, 0);
+
+	g_mutex_lock (&priv->lock);
+
+	/* the name could be deleted meanwhile */
+	value = g_hash_table_lookup (priv->open_names, idn->name);
+	if (value) {
+		guint32 index;
+
+		if (GPOINTER_TO_UINT (value) > 1)
+			g_hash_table_insert (priv->open_names, g_strdup (idn->name), GUINT_TO_POINTER (GPOINTER_TO_UINT (value) - 1));
+		else
+			g_hash_table_remove (priv->open_names, idn->name);
+
+		index = postings_index_pending_add_name_locked (priv, idn->name);
+
+		g_hash_table_iter_init (&iter, idn->words);
+		while (g_hash_table_iter_next (&iter, &key, NULL))
+			postings_index_pending_add_word_locked (priv, key, index);
+
+		if (priv->pending_names->len >= CAMEL_POSTINGS_INDEX_FLUSH_NAMES)
+			ret = postings_index_flush_locked (CAMEL_POSTINGS_INDEX (idx));
+	}
+
+	g_mutex_unlock (&priv->lock);
+
+	return ret;
+}
+
+static CamelIndexCursor *
+postings_index_find_name (CamelIndex *idx,
+                          const gchar *name)
+{
+	/* not used, the same as with the CamelTextIndex */
+	return NULL;
+}
+
+static void
+postings_index_delete_name (CamelIndex *idx,
+                            const gchar *name)
+{
+	CamelPostingsIndexPrivate *priv = CAMEL_POSTINGS_INDEX (idx)->priv;
+
+	d (printf ("Delete name: %s\n", name));
+
+	g_mutex_lock (&priv->lock);
+	postings_index_delete_name_locked (CAMEL_POSTINGS_INDEX (idx), name);
+	g_mutex_unlock (&priv->lock);
+}
+
+static CamelIndexCursor *
+postings_index_find (CamelIndex *idx,
+                     const gchar *word)
+{
+	CamelPostingsIndexPrivate *priv = CAMEL_POSTINGS_INDEX (idx)->priv;
+	CamelPostingsIndexCursor *idc;
+	GArray *ranks, *indexes;
+	guint ii, jj;
+
+	idc = g_object_new (camel_postings_index_cursor_get_type (), NULL);
+	idc->parent.index = CAMEL_INDEX (g_object_ref (idx));
+
+	ranks = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+	g_mutex_lock (&priv->lock);
+
+	for (ii = 0; ii < priv->segments->len; ii++) {
+		PostingsSegment *seg = g_ptr_array_index (priv->segments, ii);
+		gint64 word_index;
+		guint n_values = idc->values->len;
+
+		word_index = postings_segment_find_word (seg, word);
+		if (word_index < 0)
+			continue;
+
+		g_array_set_size (ranks, 0);
+		postings_segment_read_postings (seg, word_index, ranks);
+
+		for (jj = 0; jj < ranks->len; jj++) {
+			const gchar *name = postings_segment_get_name (seg, g_array_index (ranks, guint32, jj));
+
+			if (postings_segment_name_is_alive (seg, priv->tombstones, name))
+				g_ptr_array_add (idc->values, (gpointer) name);
+		}
+
+		if (idc->values->len != n_values)
+			g_ptr_array_add (idc->segments, postings_segment_ref (seg));
+	}
+
+	indexes = g_hash_table_lookup (priv->pending_words, word);
+	for (ii = 0; indexes && ii < indexes->len; ii++) {
+		const gchar *name = g_ptr_array_index (priv->pending_names, g_array_index (indexes, guint32, ii));
+
+		if (name)
+			g_ptr_array_add (idc->values, g_string_chunk_insert (idc->strings, name));
+	}
+
+	g_mutex_unlock (&priv->lock);
+
+	g_array_unref (ranks);
+
+	return CAMEL_INDEX_CURSOR (idc);
+}
+
+static CamelIndexCursor *
+postings_index_words (CamelIndex *idx)
+{
+	CamelPostingsIndexPrivate *priv = CAMEL_POSTINGS_INDEX (idx)->priv;
+	CamelPostingsIndexWordsCursor *idc;
+	GHashTableIter iter;
+	gpointer key;
+	guint ii;
+
+	idc = g_object_new (camel_postings_index_words_cursor_get_type (), NULL);
+	idc->parent.index = CAMEL_INDEX (g_object_ref (idx));
+
+	g_mutex_lock (&priv->lock);
+
+	for (ii = 0; ii < priv->segments->len; ii++)
+		g_ptr_array_add (idc->segments, postings_segment_ref (g_ptr_array_index (priv->segments, ii)));
+
+	g_hash_table_iter_init (&iter, priv->pending_words);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		g_ptr_array_add (idc->pending, g_string_chunk_insert (idc->strings, key));
+
+	g_mutex_unlock (&priv->lock);
+
+	return CAMEL_INDEX_CURSOR (idc);
+}
+
+static void
+camel_postings_index_class_init (CamelPostingsIndexClass *class)
+{
+	GObjectClass *object_class;
+	CamelIndexClass *index_class;
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->dispose = postings_index_dispose;
+	object_class->finalize = postings_index_finalize;
+
+	index_class = CAMEL_INDEX_CLASS (class);
+	index_class->sync = postings_index_sync;
+	index_class->compress = postings_index_compress;
+	index_class->delete_ = postings_index_delete;
+	index_class->rename = postings_index_rename;
+	index_class->has_name = postings_index_has_name;
+	index_class->add_name = postings_index_add_name;
+	index_class->write_name = postings_index_write_name;
+	index_class->find_name = postings_index_find_name;
+	index_class->delete_name = postings_index_delete_name;
+	index_class->find = postings_index_find;
+	index_class->words = postings_index_words;
+}
+
+static void
+camel_postings_index_init (CamelPostingsIndex *postings_index)
+{
+	CamelPostingsIndexPrivate *priv;
+
+	postings_index->priv = camel_postings_index_get_instance_private (postings_index);
+	priv = postings_index->priv;
+
+	g_mutex_init (&priv->lock);
+	g_cond_init (&priv->merge_cond);
+
+	priv->next_generation = 1;
+	priv->next_file_id = 1;
+	priv->segments = g_ptr_array_new_with_free_func (postings_segment_unref);
+	priv->tombstones = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->pending_strings = g_string_chunk_new (65536);
+	priv->pending_names = g_ptr_array_new ();
+	priv->pending_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->pending_words = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) g_array_unref);
+	priv->open_names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
+
+static gchar *
+postings_index_normalize (CamelIndex *idx,
+                          const gchar *in,
+                          gpointer data)
+{
+	return g_utf8_strdown (in, -1);
+}
+
+/**
+ * camel_postings_index_new:
+ * @path: base path of the index files
+ * @flags: open flags, like O_RDWR, O_CREAT, O_TRUNC
+ *
+ * Opens or creates a #CamelPostingsIndex at @path. When the index does not
+ * exist yet, but there is a #CamelTextIndex at the same @path, then its
+ * content is converted into the new index and the old files are removed.
+ *
+ * Returns: (transfer full) (nullable): a new #CamelPostingsIndex, or %NULL
+ *    on error, with errno set
+ *
+ * Since: 3.62
+ **/
+CamelPostingsIndex *
+camel_postings_index_new (const gchar *path,
+                          gint flags)
+{
+	CamelPostingsIndex *idx;
+	CamelPostingsIndexPrivate *priv;
+	GArray *manifest_segments = NULL;
+	GHashTable *tombstones = NULL;
+	guint32 next_generation = 1, next_file_id = 1;
+	gboolean convert = FALSE;
+	guint ii;
+
+	g_return_val_if_fail (path != NULL, NULL);
+
+	idx = g_object_new (CAMEL_TYPE_POSTINGS_INDEX, NULL);
+	priv = idx->priv;
+
+	camel_index_construct (CAMEL_INDEX (idx), path, flags);
+	camel_index_set_normalize (CAMEL_INDEX (idx), postings_index_normalize, NULL);
+
+	g_free (idx->parent.path);
+	idx->parent.path = postings_index_manifest_path (path);
+
+	priv->base_path = g_strdup (path);
+	priv->writable = (flags & (O_WRONLY | O_RDWR)) != 0;
+
+	if (priv->writable && (flags & O_TRUNC) != 0)
+		camel_postings_index_remove (path);
+
+	if (postings_index_read_manifest (path, &next_generation, &next_file_id, &manifest_segments, &tombstones)) {
+		for (ii = 0; ii < manifest_segments->len; ii++) {
+			ManifestSegment *ms = &g_array_index (manifest_segments, ManifestSegment, ii);
+			PostingsSegment *seg;
+			gchar *filename;
+
+			filename = postings_index_segment_path (path, ms->file_id);
+			seg = postings_segment_open (filename, ms->generation, ms->file_id);
+			g_free (filename);
+
+			if (!seg) {
+				g_array_unref (manifest_segments);
+				g_hash_table_unref (tombstones);
+				goto fail;
+			}
+
+			g_ptr_array_add (priv->segments, seg);
+		}
+
+		g_hash_table_unref (priv->tombstones);
+		priv->tombstones = tombstones;
+		priv->next_generation = next_generation;
+		priv->next_file_id = next_file_id;
+
+		g_array_unref (manifest_segments);
+	} else if (errno == ENOENT && (flags & O_CREAT) != 0 && priv->writable) {
+		convert = (flags & O_TRUNC) == 0 && camel_text_index_check (path) == 0;
+		priv->manifest_dirty = TRUE;
+	} else {
+		goto fail;
+	}
+
+	if (priv->writable) {
+		GHashTable *keep_file_ids;
+
+		/* leftovers of an interrupted merge or sync */
+		keep_file_ids = g_hash_table_new (g_direct_hash, g_direct_equal);
+		for (ii = 0; ii < priv->segments->len; ii++) {
+			PostingsSegment *seg = g_ptr_array_index (priv->segments, ii);
+
+			g_hash_table_add (keep_file_ids, GUINT_TO_POINTER (seg->file_id));
+		}
+
+		postings_index_remove_segment_files (path, keep_file_ids);
+
+		g_hash_table_unref (keep_file_ids);
+	}
+
+	if (convert && !postings_index_import_text_index (idx, path))
+		g_warning ("%s: Failed to convert text index '%s'", G_STRFUNC, path);
+
+	if (priv->manifest_dirty) {
+		g_mutex_lock (&priv->lock);
+		if (!postings_index_write_manifest_locked (idx)) {
+			g_mutex_unlock (&priv->lock);
+			goto fail;
+		}
+		g_mutex_unlock (&priv->lock);
+	}
+
+	return idx;
+
+ fail:
+	/* do not write anything on dispose */
+	CAMEL_INDEX (idx)->state |= CAMEL_INDEX_DELETED;
+	g_object_unref (idx);
+
+	return NULL;
+}
+
+/**
+ * camel_postings_index_get_n_segments:
+ * @idx: a #CamelPostingsIndex
+ *
+ * Returns how many segment files the index currently consists of. The names
+ * not written by camel_index_sync() yet are not counted.
+ *
+ * Returns: count of the segments
+ *
+ * Since: 3.62
+ **/
+guint
+camel_postings_index_get_n_segments (CamelPostingsIndex *idx)
+{
+	guint n_segments;
+
+	g_return_val_if_fail (CAMEL_IS_POSTINGS_INDEX (idx), 0);
+
+	g_mutex_lock (&idx->priv->lock);
+	n_segments = idx->priv->segments->len;
+	g_mutex_unlock (&idx->priv->lock);
+
+	return n_segments;
+}
+
+/**
+ * camel_postings_index_check:
+ * @path: base path of the index files
+ *
+ * Checks whether a valid #CamelPostingsIndex exists at @path.
+ *
+ * Returns: 0 if the index exists and is valid, -1 otherwise
+ *
+ * Since: 3.62
+ **/
+gint
+camel_postings_index_check (const gchar *path)
+{
+	GArray *segments = NULL;
+	guint32 next_generation, next_file_id;
+	guint ii;
+	gint ret = 0;
+
+	g_return_val_if_fail (path != NULL, -1);
+
+	if (!postings_index_read_manifest (path, &next_generation, &next_file_id, &segments, NULL))
+		return -1;
+
+	for (ii = 0; ii < segments->len && ret == 0; ii++) {
+		ManifestSegment *ms = &g_array_index (segments, ManifestSegment, ii);
+		gchar *filename;
+
+		filename = postings_index_segment_path (path, ms->file_id);
+		if (!g_file_test (filename, G_FILE_TEST_IS_REGULAR))
+			ret = -1;
+		g_free (filename);
+	}
+
+	g_array_unref (segments);
+
+	return ret;
+}
+
+/**
+ * camel_postings_index_rename:
+ * @old: base path of an existing index
+ * @new_: the new base path
+ *
+ * Renames files of a #CamelPostingsIndex, which is not opened.
+ *
+ * Returns: 0 on success, -1 on error with errno set
+ *
+ * Since: 3.62
+ **/
+gint
+camel_postings_index_rename (const gchar *old,
+                             const gchar *new_)
+{
+	GArray *segments = NULL;
+	gchar *oldname, *newname;
+	guint32 next_generation, next_file_id;
+	guint ii;
+	gint err;
+
+	g_return_val_if_fail (old != NULL, -1);
+	g_return_val_if_fail (new_ != NULL, -1);
+
+	if (!postings_index_read_manifest (old, &next_generation, &next_file_id, &segments, NULL))
+		return -1;
+
+	for (ii = 0; ii < segments->len; ii++) {
+		ManifestSegment *ms = &g_array_index (segments, ManifestSegment, ii);
+
+		oldname = postings_index_segment_path (old, ms->file_id);
+		newname = postings_index_segment_path (new_, ms->file_id);
+
+		if (g_rename (oldname, newname) == -1) {
+			err = errno;
+			g_free (oldname);
+			g_free (newname);
+			goto rollback;
+		}
+
+		g_free (oldname);
+		g_free (newname);
+	}
+
+	oldname = postings_index_manifest_path (old);
+	newname = postings_index_manifest_path (new_);
+
+	if (g_rename (oldname, newname) == -1) {
+		err = errno;
+		g_free (oldname);
+		g_free (newname);
+		goto rollback;
+	}
+
+	g_free (oldname);
+	g_free (newname);
+	g_array_unref (segments);
+
+	return 0;
+
+ rollback:
+	while (ii > 0) {
+		ManifestSegment *ms = &g_array_index (segments, ManifestSegment, ii - 1);
+
+		oldname = postings_index_segment_path (old, ms->file_id);
+		newname = postings_index_segment_path (new_, ms->file_id);
+
+		if (g_rename (newname, oldname) == -1) {
+			g_warning (
+				"%s: Failed to rename '%s' to '%s': %s",
+				G_STRFUNC, newname, oldname, g_strerror (errno));
+		}
+
+		g_free (oldname);
+		g_free (newname);
+		ii--;
+	}
+
+	g_array_unref (segments);
+	errno = err;
+
+	return -1;
+}
+
+/**
+ * camel_postings_index_remove:
+ * @old: base path of an index
+ *
+ * Removes all files of a #CamelPostingsIndex at @old.
+ *
+ * Returns: 0 on success, -1 on error with errno set
+ *
+ * Since: 3.62
+ **/
+gint
+camel_postings_index_remove (const gchar *old)
+{
+	gchar *filename;
+	gint ret = 0;
+
+	g_return_val_if_fail (old != NULL, -1);
+
+	postings_index_remove_segment_files (old, NULL);
+
+	filename = postings_index_manifest_path (old);
+	if (g_unlink (filename) == -1 && errno != ENOENT && errno != ENOTDIR)
+		ret = -1;
+	g_free (filename);
+
+	if (ret == 0)
+		errno = 0;
+
+	return ret;
+}
+
+/* ********************************************************************** */
+/* CamelPostingsIndexName */
+/* ********************************************************************** */
+
+static void
+postings_index_name_finalize (GObject *object)
+{
+	CamelPostingsIndexName *idn = (CamelPostingsIndexName *) object;
+
+	g_hash_table_destroy (idn->parent.words);
+	g_string_free (idn->buffer, TRUE);
+	g_string_chunk_free (idn->strings);
+
+	/* Chain up to parent's finalize() method. */
+	G_OBJECT_CLASS (camel_postings_index_name_parent_class)->finalize (object);
+}
+
+static void
+postings_index_name_add_word (CamelIndexName *idn,
+                              const gchar *word)
+{
+	CamelPostingsIndexName *pin = (CamelPostingsIndexName *) idn;
+
+	if (!g_hash_table_contains (idn->words, word))
+		g_hash_table_add (idn->words, g_string_chunk_insert (pin->strings, word));
+}
+
+static gsize
+postings_index_name_add_buffer (CamelIndexName *idn,
+                                const gchar *buffer,
+                                gsize len)
+{
+	CamelPostingsIndexName *pin = (CamelPostingsIndexName *) idn;
+	const guchar *ptr, *ptrend;
+	guint32 c;
+
+	if (buffer == NULL) {
+		if (pin->buffer->len) {
+			camel_index_name_add_word (idn, pin->buffer->str);
+			g_string_truncate (pin->buffer, 0);
+		}
+		return 0;
+	}
+
+	ptr = (const guchar *) buffer;
+	ptrend = (const guchar *) buffer + len;
+	while (ptr < ptrend && (c = camel_utf8_getc_limit (&ptr, ptrend)) != 0xffff) {
+		if (g_unichar_isalnum (c)) {
+			g_string_append_unichar (pin->buffer, g_unichar_tolower (c));
+		} else {
+			if (pin->buffer->len > 0 && pin->buffer->len <= CAMEL_POSTINGS_INDEX_MAX_WORDLEN)
+				postings_index_name_add_word (idn, pin->buffer->str);
+
+			g_string_truncate (pin->buffer, 0);
+		}
+	}
+
+	return 0;
+}
+
+static void
+camel_postings_index_name_class_init (CamelPostingsIndexNameClass *class)
+{
+	GObjectClass *object_class;
+	CamelIndexNameClass *index_name_class;
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = postings_index_name_finalize;
+
+	index_name_class = CAMEL_INDEX_NAME_CLASS (class);
+	index_name_class->add_word = postings_index_name_add_word;
+	index_name_class->add_buffer = postings_index_name_add_buffer;
+}
+
+static void
+camel_postings_index_name_init (CamelPostingsIndexName *idn)
+{
+	idn->parent.words = g_hash_table_new (g_str_hash, g_str_equal);
+	idn->buffer = g_string_new ("");
+	idn->strings = g_string_chunk_new (1024);
+}
+
+/* ********************************************************************** */
+/* CamelPostingsIndexCursor */
+/* ********************************************************************** */
+
+static void
+postings_index_cursor_finalize (GObject *object)
+{
+	CamelPostingsIndexCursor *idc = (CamelPostingsIndexCursor *) object;
+
+	g_ptr_array_unref (idc->values);
+	g_ptr_array_unref (idc->segments);
+	g_string_chunk_free (idc->strings);
+
+	/* Chain up to parent's finalize() method. */
+	G_OBJECT_CLASS (camel_postings_index_cursor_parent_class)->finalize (object);
+}
+
+static const gchar *
+postings_index_cursor_next (CamelIndexCursor *cursor)
+{
+	CamelPostingsIndexCursor *idc = (CamelPostingsIndexCursor *) cursor;
+
+	if (idc->index >= idc->values->len)
+		return NULL;
+
+	return g_ptr_array_index (idc->values, idc->index++);
+}
+
+static void
+camel_postings_index_cursor_class_init (CamelPostingsIndexCursorClass *class)
+{
+	GObjectClass *object_class;
+	CamelIndexCursorClass *index_cursor_class;
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = postings_index_cursor_finalize;
+
+	index_cursor_class = CAMEL_INDEX_CURSOR_CLASS (class);
+	index_cursor_class->next = postings_index_cursor_next;
+}
+
+static void
+camel_postings_index_cursor_init (CamelPostingsIndexCursor *idc)
+{
+	idc->segments = g_ptr_array_new_with_free_func (postings_segment_unref);
+	idc->strings = g_string_chunk_new (256);
+	idc->values = g_ptr_array_new ();
+}
+
+/* ********************************************************************** */
+/* CamelPostingsIndexWordsCursor */
+/* ********************************************************************** */
+
+static void
+postings_index_words_cursor_finalize (GObject *object)
+{
+	CamelPostingsIndexWordsCursor *idc = (CamelPostingsIndexWordsCursor *) object;
+
+	g_hash_table_destroy (idc->seen);
+	g_ptr_array_unref (idc->pending);
+	g_ptr_array_unref (idc->segments);
+	g_string_chunk_free (idc->strings);
+
+	/* Chain up to parent's finalize() method. */
+	G_OBJECT_CLASS (camel_postings_index_words_cursor_parent_class)->finalize (object);
+}
+
+static const gchar *
+postings_index_words_cursor_next (CamelIndexCursor *cursor)
+{
+	CamelPostingsIndexWordsCursor *idc = (CamelPostingsIndexWordsCursor *) cursor;
+
+	if (idc->pending_index < idc->pending->len) {
+		const gchar *word = g_ptr_array_index (idc->pending, idc->pending_index++);
+
+		g_hash_table_add (idc->seen, (gpointer) word);
+
+		return word;
+	}
+
+	while (idc->segment_index < idc->segments->len) {
+		PostingsSegment *seg = g_ptr_array_index (idc->segments, idc->segment_index);
+
+		while (idc->word_index < seg->n_words) {
+			const gchar *word = postings_segment_get_word (seg, idc->word_index++);
+
+			if (!g_hash_table_contains (idc->seen, word)) {
+				/* only a single segment can be left, no need to remember its words */
+				if (idc->segment_index + 1 < idc->segments->len)
+					g_hash_table_add (idc->seen, (gpointer) word);
+
+				return word;
+			}
+		}
+
+		idc->segment_index++;
+		idc->word_index = 0;
+	}
+
+	return NULL;
+}
+
+static void
+camel_postings_index_words_cursor_class_init (CamelPostingsIndexWordsCursorClass *class)
+{
+	GObjectClass *object_class;
+	CamelIndexCursorClass *index_cursor_class;
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = postings_index_words_cursor_finalize;
+
+	index_cursor_class = CAMEL_INDEX_CURSOR_CLASS (class);
+	index_cursor_class->next = postings_index_words_cursor_next;
+}
+
+static void
+camel_postings_index_words_cursor_init (CamelPostingsIndexWordsCursor *idc)
+{
+	idc->segments = g_ptr_array_new_with_free_func (postings_segment_unref);
+	idc->strings = g_string_chunk_new (4096);
+	idc->pending = g_ptr_array_new ();
+	idc->seen = g_hash_table_new (g_str_hash, g_str_equal);
+}
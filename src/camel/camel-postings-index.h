@@ -0,0 +1,67 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#if !defined (__CAMEL_H_INSIDE__) && !defined (CAMEL_COMPILATION)
+#error "Only <camel/camel.h> can be included directly."
+#endif
+
+#ifndef CAMEL_POSTINGS_INDEX_H
+#define CAMEL_POSTINGS_INDEX_H
+
+#include <camel/camel-index.h>
+
+/* Standard GObject macros */
+#define CAMEL_TYPE_POSTINGS_INDEX \
+	(camel_postings_index_get_type ())
+#define CAMEL_POSTINGS_INDEX(obj) \
+	(G_TYPE_CHECK_INSTANCE_CAST \
+	((obj), CAMEL_TYPE_POSTINGS_INDEX, CamelPostingsIndex))
+#define CAMEL_POSTINGS_INDEX_CLASS(cls) \
+	(G_TYPE_CHECK_CLASS_CAST \
+	((cls), CAMEL_TYPE_POSTINGS_INDEX, CamelPostingsIndexClass))
+#define CAMEL_IS_POSTINGS_INDEX(obj) \
+	(G_TYPE_CHECK_INSTANCE_TYPE \
+	((obj), CAMEL_TYPE_POSTINGS_INDEX))
+#define CAMEL_IS_POSTINGS_INDEX_CLASS(cls) \
+	(G_TYPE_CHECK_CLASS_TYPE \
+	((cls), CAMEL_TYPE_POSTINGS_INDEX))
+#define CAMEL_POSTINGS_INDEX_GET_CLASS(obj) \
+	(G_TYPE_INSTANCE_GET_CLASS \
+	((obj), CAMEL_TYPE_POSTINGS_INDEX, CamelPostingsIndexClass))
+
+G_BEGIN_DECLS
+
+typedef struct _CamelPostingsIndex CamelPostingsIndex;
+typedef struct _CamelPostingsIndexClass CamelPostingsIndexClass;
+typedef struct _CamelPostingsIndexPrivate CamelPostingsIndexPrivate;
+
+struct _CamelPostingsIndex {
+	CamelIndex parent;
+	CamelPostingsIndexPrivate *priv;
+};
+
+struct _CamelPostingsIndexClass {
+	CamelIndexClass parent_class;
+
+	/* Padding for future expansion */
+	gpointer reserved[20];
+};
+
+GType		camel_postings_index_get_type	(void);
+CamelPostingsIndex *
+		camel_postings_index_new	(const gchar *path,
+						 gint flags);
+guint		camel_postings_index_get_n_segments
+						(CamelPostingsIndex *idx);
+
+/* static utility functions */
+gint		camel_postings_index_check	(const gchar *path);
+gint		camel_postings_index_rename	(const gchar *old,
+						 const gchar *new_);
+gint		camel_postings_index_remove	(const gchar *old);
+
+G_END_DECLS
+
+#endif /* CAMEL_POSTINGS_INDEX_H */
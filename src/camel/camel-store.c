@@ -48,16 +48,23 @@
 #include "camel-folder.h"
 #include "camel-network-service.h"
 #include "camel-offline-store.h"
+#include "camel-operation.h"
 #include "camel-session.h"
 #include "camel-store.h"
 #include "camel-store-db.h"
 #include "camel-store-settings.h"
 #include "camel-subscribable.h"
+#include "camel-utils.h"
 #include "camel-vtrash-folder.h"
 
 #define d(x)
 #define w(x)
 
+/* for how long the folders database should not be used before the maintenance runs */
+#define DB_MAINTENANCE_IDLE_SECONDS 5
+/* how long one part of the maintenance can block the database */
+#define DB_MAINTENANCE_SLICE_USEC (100 * 1000)
+
 typedef struct _AsyncContext AsyncContext;
 typedef struct _SignalClosure SignalClosure;
 
@@ -73,6 +80,8 @@ struct _CamelStorePrivate {
 
 	GMutex lock;
 	guint schedule_vfolder_rebuild_id;
+	guint db_maintenance_id; /* guarded by lock */
+	gboolean db_maintenance_running; /* guarded by lock */
 };
 
 struct _AsyncContext {
@@ -376,6 +385,13 @@ store_dispose (GObject *object)
 		store->priv->schedule_vfolder_rebuild_id = 0;
 	}
 
+	g_mutex_lock (&store->priv->lock);
+	if (store->priv->db_maintenance_id) {
+		g_source_remove (store->priv->db_maintenance_id);
+		store->priv->db_maintenance_id = 0;
+	}
+	g_mutex_unlock (&store->priv->lock);
+
 	g_clear_pointer (&store->priv->folders, camel_object_bag_destroy);
 
 	/* Chain up to parent's method. */
@@ -3433,6 +3449,116 @@ camel_store_initial_setup_finish (CamelStore *store,
 	return g_task_propagate_boolean (G_TASK (result), error);
 }
 
+static gboolean store_db_maintenance_timeout_cb (gpointer user_data);
+
+/* Expects the store->priv->lock being held */
+static void
+store_schedule_db_maintenance_locked (CamelStore *store,
+				      guint seconds)
+{
+	if (!store->priv->db_maintenance_id && !store->priv->db_maintenance_running) {
+		store->priv->db_maintenance_id = g_timeout_add_seconds_full (G_PRIORITY_DEFAULT, seconds,
+			store_db_maintenance_timeout_cb,
+			camel_utils_weak_ref_new (store), (GDestroyNotify) camel_utils_weak_ref_free);
+	}
+}
+
+static gboolean
+store_db_maintenance_is_idle (CamelStore *store,
+			      CamelDB *cdb)
+{
+	return g_atomic_int_get (&store->priv->maintenance_lock) == 0 &&
+		camel_db_get_idle_time (cdb) >= DB_MAINTENANCE_IDLE_SECONDS * G_USEC_PER_SEC;
+}
+
+static void
+store_db_maintenance_job_cb (CamelSession *session,
+			     GCancellable *cancellable,
+			     gpointer user_data,
+			     GError **error)
+{
+	CamelStore *store = user_data;
+	CamelDB *cdb = CAMEL_DB (store->priv->db);
+	guint64 reclaimed_bytes = 0;
+	gboolean finished = FALSE;
+
+	/* Run it in small parts and give up as soon as the database is used
+	   again; it's rescheduled and continues where it stopped. */
+	while (!finished && store_db_maintenance_is_idle (store, cdb) &&
+	       !g_cancellable_is_cancelled (cancellable)) {
+		guint64 slice_reclaimed = 0;
+		gint percent = 0;
+
+		if (!camel_db_run_maintenance_slice (cdb, DB_MAINTENANCE_SLICE_USEC, &finished, &percent, &slice_reclaimed, error))
+			break;
+
+		reclaimed_bytes += slice_reclaimed;
+
+		camel_operation_progress (cancellable, percent);
+
+		/* let the other threads get to the database */
+		if (!finished)
+			g_thread_yield ();
+	}
+
+	if (reclaimed_bytes > 0 && camel_debug ("db")) {
+		gchar *size = g_format_size (reclaimed_bytes);
+		printf ("[%s] %s: reclaimed %s from '%s'%s\n", G_STRFUNC, camel_service_get_display_name (CAMEL_SERVICE (store)),
+			size, camel_db_get_filename (cdb), finished ? "" : " (interrupted)");
+		g_free (size);
+	}
+
+	g_mutex_lock (&store->priv->lock);
+	store->priv->db_maintenance_running = FALSE;
+	if (!finished && !*error && !g_cancellable_is_cancelled (cancellable))
+		store_schedule_db_maintenance_locked (store, DB_MAINTENANCE_IDLE_SECONDS);
+	g_mutex_unlock (&store->priv->lock);
+}
+
+static gboolean
+store_db_maintenance_timeout_cb (gpointer user_data)
+{
+	GWeakRef *weak_ref = user_data;
+	CamelStore *store;
+	CamelSession *session;
+
+	store = g_weak_ref_get (weak_ref);
+	if (!store)
+		return G_SOURCE_REMOVE;
+
+	g_mutex_lock (&store->priv->lock);
+	store->priv->db_maintenance_id = 0;
+
+	session = camel_service_ref_session (CAMEL_SERVICE (store));
+
+	if (!session || !store->priv->db) {
+		/* nothing to do */
+	} else if (!store_db_maintenance_is_idle (store, CAMEL_DB (store->priv->db))) {
+		store_schedule_db_maintenance_locked (store, DB_MAINTENANCE_IDLE_SECONDS);
+	} else {
+		gchar *description;
+
+		store->priv->db_maintenance_running = TRUE;
+
+		/* Translators: The “%s” is replaced with an account name */
+		description = g_strdup_printf (_("Optimizing folder database of “%s”"),
+			camel_service_get_display_name (CAMEL_SERVICE (store)));
+
+		camel_session_submit_job (session, description, store_db_maintenance_job_cb,
+			g_object_ref (store), g_object_unref);
+
+		g_free (description);
+	}
+
+	g_clear_object (&session);
+
+	g_mutex_unlock (&store->priv->lock);
+
+	g_object_unref (store);
+
+	return G_SOURCE_REMOVE;
+}
+
 /**
  * camel_store_maybe_run_db_maintenance:
  * @store: a #CamelStore instance
@@ -3441,6 +3567,10 @@ camel_store_initial_setup_finish (CamelStore *store,
  * Checks the state of the current #CamelStoreDB used for the @store and eventually
  * runs maintenance routines on it.
  *
+ * Since 3.62 the maintenance runs in a session job, in small parts, only
+ * when the database is not used for a while. It's done immediately only
+ * when the @store has no #CamelSession.
+ *
  * Returns: Whether succeeded.
  *
  * Since: 3.16
@@ -3449,6 +3579,8 @@ gboolean
 camel_store_maybe_run_db_maintenance (CamelStore *store,
 				      GError **error)
 {
+	CamelSession *session;
+
 	g_return_val_if_fail (CAMEL_IS_STORE (store), FALSE);
 
 	if (g_atomic_int_get (&store->priv->maintenance_lock) > 0)
@@ -3457,7 +3589,17 @@ camel_store_maybe_run_db_maintenance (CamelStore *store,
 	if (!store->priv->db)
 		return TRUE;
 
-	return camel_db_maybe_run_maintenance (CAMEL_DB (store->priv->db), error);
+	session = camel_service_ref_session (CAMEL_SERVICE (store));
+	if (!session)
+		return camel_db_maybe_run_maintenance (CAMEL_DB (store->priv->db), error);
+
+	g_mutex_lock (&store->priv->lock);
+	store_schedule_db_maintenance_locked (store, DB_MAINTENANCE_IDLE_SECONDS);
+	g_mutex_unlock (&store->priv->lock);
+
+	g_object_unref (session);
+
+	return TRUE;
 }
 
 /**
@@ -22,6 +22,8 @@
 struct _uid_state {
 	gint level;
 	gboolean save;
+	gboolean written;	/* is in the file */
+	gboolean pending;	/* is in cache->pending */
 };
 
 /**
@@ -77,17 +79,28 @@ camel_uid_cache_new (const gchar *filename)
 	cache->expired = 0;
 	cache->size = 0;
 	cache->fd = -1;
+	cache->pending = g_ptr_array_new ();
+
+	/* an interrupted append can leave an incomplete line */
+	cache->needs_rewrite = st.st_size > 0 && buf[st.st_size - 1] != '\n';
 
 	uids = g_strsplit (buf, "\n", 0);
 	g_free (buf);
 	for (i = 0; uids[i]; i++) {
 		struct _uid_state *state;
 
-		state = g_new (struct _uid_state, 1);
+		if (!*uids[i] || g_hash_table_contains (cache->uids, uids[i])) {
+			g_free (uids[i]);
+			continue;
+		}
+
+		state = g_new0 (struct _uid_state, 1);
 		state->level = cache->level;
 		state->save = TRUE;
+		state->written = TRUE;
 
 		g_hash_table_insert (cache->uids, uids[i], state);
+		cache->n_written++;
 	}
 
 	g_free (uids);
@@ -120,16 +133,24 @@ maybe_write_uid (gpointer key,
 	}
 }
 
-/**
- * camel_uid_cache_save:
- * @cache: a CamelUIDCache
- *
- * Attempts to save @cache back to disk.
- *
- * Returns: success or failure
- **/
-gboolean
-camel_uid_cache_save (CamelUIDCache *cache)
+static void
+mark_written_uid (gpointer key,
+                  gpointer value,
+                  gpointer data)
+{
+	CamelUIDCache *cache = data;
+	struct _uid_state *state = value;
+
+	state->written = state->level == cache->level && state->save;
+	state->pending = FALSE;
+
+	if (state->written)
+		cache->n_written++;
+}
+
+/* writes the whole file, without the expired UIDs */
+static gboolean
+uid_cache_rewrite (CamelUIDCache *cache)
 {
 	gchar *filename;
 	gint errnosav;
@@ -158,6 +179,12 @@ camel_uid_cache_save (CamelUIDCache *cache)
 
 	g_free (filename);
 
+	cache->n_written = 0;
+	cache->n_stale = 0;
+	cache->needs_rewrite = FALSE;
+	g_hash_table_foreach (cache->uids, mark_written_uid, cache);
+	g_ptr_array_set_size (cache->pending, 0);
+
 	return TRUE;
 
  exception:
@@ -190,6 +217,8 @@ camel_uid_cache_save (CamelUIDCache *cache)
 				cache->expired = 0;
 				cache->size = 0;
 				cache->fd = -1;
+				/* not everything had been written */
+				cache->needs_rewrite = TRUE;
 
 				return TRUE;
 			}
@@ -210,6 +239,86 @@ camel_uid_cache_save (CamelUIDCache *cache)
 	return FALSE;
 }
 
+/* appends the UIDs marked for saving since the last save */
+static gboolean
+uid_cache_append (CamelUIDCache *cache)
+{
+	GString *buffer;
+	gint fd;
+	guint ii;
+
+	buffer = g_string_new ("");
+
+	for (ii = 0; ii < cache->pending->len; ii++) {
+		const gchar *uid = cache->pending->pdata[ii];
+
+		g_string_append (buffer, uid);
+		g_string_append_c (buffer, '\n');
+	}
+
+	if ((fd = g_open (cache->filename, O_WRONLY | O_APPEND | O_CREAT | O_BINARY, 0666)) == -1) {
+		g_string_free (buffer, TRUE);
+		return FALSE;
+	}
+
+	if (camel_write (fd, buffer->str, buffer->len, NULL, NULL) == -1 || fsync (fd) == -1) {
+		gint errnosav = errno;
+
+		close (fd);
+		g_string_free (buffer, TRUE);
+
+		/* part of the data could be written */
+		cache->needs_rewrite = TRUE;
+		errno = errnosav;
+
+		return FALSE;
+	}
+
+	close (fd);
+	g_string_free (buffer, TRUE);
+
+	for (ii = 0; ii < cache->pending->len; ii++) {
+		struct _uid_state *state;
+
+		state = g_hash_table_lookup (cache->uids, cache->pending->pdata[ii]);
+		state->written = TRUE;
+		state->pending = FALSE;
+
+		cache->n_written++;
+		if (state->level != cache->level)
+			cache->n_stale++;
+	}
+
+	g_ptr_array_set_size (cache->pending, 0);
+
+	return TRUE;
+}
+
+/**
+ * camel_uid_cache_save:
+ * @cache: a CamelUIDCache
+ *
+ * Attempts to save @cache back to disk.
+ *
+ * Only the UIDs marked for saving since the last save are appended
+ * to the file, the whole file is written again only when enough
+ * of the UIDs stored in it expired.
+ *
+ * Returns: success or failure
+ **/
+gboolean
+camel_uid_cache_save (CamelUIDCache *cache)
+{
+	if (cache->needs_rewrite ||
+	    (cache->n_stale > 0 && cache->n_stale >= cache->n_written / 4))
+		return uid_cache_rewrite (cache);
+
+	if (!cache->pending->len)
+		return TRUE;
+
+	return uid_cache_append (cache);
+}
+
 static void
 free_uid (gpointer key,
           gpointer value,
@@ -230,6 +339,7 @@ camel_uid_cache_destroy (CamelUIDCache *cache)
 {
 	g_hash_table_foreach (cache->uids, free_uid, NULL);
 	g_hash_table_destroy (cache->uids);
+	g_ptr_array_free (cache->pending, TRUE);
 	g_free (cache->filename);
 	g_slice_free (CamelUIDCache, cache);
 }
@@ -250,7 +360,7 @@ camel_uid_cache_dup_new_uids (CamelUIDCache *cache,
                               GPtrArray *uids)
 {
 	GPtrArray *new_uids;
-	gpointer old_uid;
+	guint n_written_seen = 0;
 	gchar *uid;
 	gint i;
 
@@ -261,19 +371,23 @@ camel_uid_cache_dup_new_uids (CamelUIDCache *cache,
 		struct _uid_state *state;
 
 		uid = uids->pdata[i];
-		if (g_hash_table_lookup_extended (cache->uids, uid, (gpointer *) &old_uid, (gpointer *) &state)) {
-			g_hash_table_remove (cache->uids, uid);
-			g_free (old_uid);
+		state = g_hash_table_lookup (cache->uids, uid);
+		if (state) {
+			/* count each stored UID only once */
+			if (state->written && state->level != cache->level)
+				n_written_seen++;
 		} else {
 			g_ptr_array_add (new_uids, (gpointer) camel_pstring_strdup (uid));
-			state = g_new (struct _uid_state, 1);
-			state->save = FALSE;
+			state = g_new0 (struct _uid_state, 1);
+			g_hash_table_insert (cache->uids, g_strdup (uid), state);
 		}
 
 		state->level = cache->level;
-		g_hash_table_insert (cache->uids, g_strdup (uid), state);
 	}
 
+	/* the stored UIDs not seen anymore will be left out on the next rewrite */
+	cache->n_stale = cache->n_written - n_written_seen;
+
 	return new_uids;
 }
 
@@ -289,18 +403,27 @@ camel_uid_cache_save_uid (CamelUIDCache *cache,
                           const gchar *uid)
 {
 	struct _uid_state *state;
-	gpointer old_uid;
+	gchar *key = NULL;
 
 	g_return_if_fail (uid != NULL);
 
-	if (g_hash_table_lookup_extended (cache->uids, uid, (gpointer *) &old_uid, (gpointer *) &state)) {
+	if (g_hash_table_lookup_extended (cache->uids, uid, (gpointer *) &key, (gpointer *) &state)) {
+		if (state->written && state->level != cache->level && cache->n_stale > 0)
+			cache->n_stale--;
+
 		state->save = TRUE;
 		state->level = cache->level;
 	} else {
-		state = g_new (struct _uid_state, 1);
+		state = g_new0 (struct _uid_state, 1);
 		state->save = TRUE;
 		state->level = cache->level;
 
-		g_hash_table_insert (cache->uids, g_strdup (uid), state);
+		key = g_strdup (uid);
+		g_hash_table_insert (cache->uids, key, state);
+	}
+
+	if (!state->written && !state->pending) {
+		state->pending = TRUE;
+		g_ptr_array_add (cache->pending, key);
 	}
 }
@@ -25,6 +25,13 @@ typedef struct {
 	gsize expired;
 	gsize size;
 	gint fd;
+
+	/* UIDs marked for saving, but not written into the file yet */
+	GPtrArray *pending;
+	/* count of UIDs in the file, and of those expired among them */
+	guint n_written;
+	guint n_stale;
+	gboolean needs_rewrite;
 } CamelUIDCache;
 
 CamelUIDCache *camel_uid_cache_new (const gchar *filename);
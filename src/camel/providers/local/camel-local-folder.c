@@ -495,14 +495,16 @@ camel_local_folder_construct (CamelLocalFolder *lf,
 	lf->changes = camel_folder_change_info_new ();
 
 	/* if we have no/invalid index file, force it */
-	forceindex = camel_text_index_check (lf->index_path) == -1;
+	forceindex = camel_postings_index_check (lf->index_path) == -1 &&
+		camel_text_index_check (lf->index_path) == -1;
 	if (lf->flags & CAMEL_STORE_FOLDER_BODY_INDEX) {
 		gint flag = O_RDWR | O_CREAT;
 
 		if (forceindex)
 			flag |= O_TRUNC;
 
-		lf->index = (CamelIndex *) camel_text_index_new (lf->index_path, flag);
+		/* converts an existing CamelTextIndex, if any */
+		lf->index = (CamelIndex *) camel_postings_index_new (lf->index_path, flag);
 		if (lf->index == NULL) {
 			/* yes, this isn't fatal at all */
 			g_warning ("Could not open/create index file: %s: indexing not performed", g_strerror (errno));
@@ -512,8 +514,10 @@ camel_local_folder_construct (CamelLocalFolder *lf,
 		}
 	} else {
 		/* if we do have an index file, remove it (?) */
-		if (forceindex == FALSE)
+		if (forceindex == FALSE) {
+			camel_postings_index_remove (lf->index_path);
 			camel_text_index_remove (lf->index_path);
+		}
 		forceindex = FALSE;
 	}
 
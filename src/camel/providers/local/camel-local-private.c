@@ -6,8 +6,11 @@
 
 #include "evolution-data-server-config.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "camel-local-private.h"
 
@@ -47,3 +50,191 @@ camel_local_frompos_sort (gpointer enc,
 
 	return a1 - a2;
 }
+
+/* the file name being summarised by the current thread */
+static GPrivate current_file;
+
+/* Returns the file name being summarised by the current thread, or %NULL */
+const gchar *
+camel_local_summary_get_current_file (void)
+{
+	return g_private_get (&current_file);
+}
+
+/* Sets the file name being summarised by the current thread; the summaries
+   use it to derive the message info UID from it. The @name is not copied. */
+void
+camel_local_summary_set_current_file (const gchar *name)
+{
+	g_private_set (&current_file, (gpointer) name);
+}
+
+/* how many files to parse before merging them into the summary */
+#define ADD_FILES_BATCH_SIZE 1000
+/* minimum number of files to use the worker threads for */
+#define ADD_FILES_PARALLEL_MIN 64
+#define ADD_FILES_MAX_THREADS 16
+
+typedef struct _AddFilesData {
+	CamelLocalSummary *cls;
+	const gchar *dir_path;
+	GPtrArray *names;
+	CamelMessageInfo **infos;
+
+	GMutex lock;
+	GCond cond;
+	guint n_pending;
+} AddFilesData;
+
+static CamelMessageInfo *
+local_summary_info_from_file (CamelLocalSummary *cls,
+			      const gchar *dir_path,
+			      const gchar *name)
+{
+	CamelMessageInfo *info;
+	CamelMimeParser *mp;
+	gchar *filename;
+	gint fd;
+
+	filename = g_strdup_printf ("%s/%s", dir_path, name);
+
+	fd = open (filename, O_RDONLY | O_LARGEFILE);
+	if (fd == -1) {
+		g_warning ("Cannot summarise/index: %s: %s", filename, g_strerror (errno));
+		g_free (filename);
+		return NULL;
+	}
+
+	mp = camel_mime_parser_new ();
+	camel_mime_parser_scan_from (mp, FALSE);
+	camel_mime_parser_init_with_fd (mp, fd);
+
+	camel_local_summary_set_current_file (name);
+	info = camel_folder_summary_info_new_from_parser (CAMEL_FOLDER_SUMMARY (cls), mp);
+	camel_local_summary_set_current_file (NULL);
+
+	g_object_unref (mp);
+	g_free (filename);
+
+	return info;
+}
+
+static void
+local_summary_add_files_thread (gpointer data,
+				gpointer user_data)
+{
+	AddFilesData *afd = user_data;
+	guint index = GPOINTER_TO_UINT (data) - 1;
+
+	afd->infos[index] = local_summary_info_from_file (afd->cls, afd->dir_path, g_ptr_array_index (afd->names, index));
+
+	g_mutex_lock (&afd->lock);
+	afd->n_pending--;
+	if (!afd->n_pending)
+		g_cond_signal (&afd->cond);
+	g_mutex_unlock (&afd->lock);
+}
+
+/* Whether camel_local_summary_add_files() can parse the files in worker threads;
+   the body indexing uses shared state, thus it's possible only without the index. */
+gboolean
+camel_local_summary_can_add_files_parallel (CamelLocalSummary *cls,
+					    guint n_files)
+{
+	g_return_val_if_fail (CAMEL_IS_LOCAL_SUMMARY (cls), FALSE);
+
+	return !cls->index && n_files >= ADD_FILES_PARALLEL_MIN && g_get_num_processors () > 1;
+}
+
+/* Adds the files @names, relative to the @dir_path, to the summary. The headers
+   are parsed in worker threads, when possible, while the message infos are added
+   to the summary in the order of the @names, in batches, each saved at once. */
+void
+camel_local_summary_add_files (CamelLocalSummary *cls,
+			       const gchar *dir_path,
+			       GPtrArray *names,
+			       CamelFolderChangeInfo *changes,
+			       GCancellable *cancellable)
+{
+	CamelFolderSummary *summary;
+	GThreadPool *pool = NULL;
+	AddFilesData afd;
+	guint ii, jj, batch_len;
+
+	g_return_if_fail (CAMEL_IS_LOCAL_SUMMARY (cls));
+	g_return_if_fail (dir_path != NULL);
+	g_return_if_fail (names != NULL);
+
+	if (!names->len)
+		return;
+
+	summary = CAMEL_FOLDER_SUMMARY (cls);
+
+	memset (&afd, 0, sizeof (AddFilesData));
+	afd.cls = cls;
+	afd.dir_path = dir_path;
+	afd.names = names;
+	afd.infos = g_new0 (CamelMessageInfo *, names->len);
+	g_mutex_init (&afd.lock);
+	g_cond_init (&afd.cond);
+
+	if (camel_local_summary_can_add_files_parallel (cls, names->len)) {
+		camel_folder_summary_set_index (summary, NULL);
+
+		pool = g_thread_pool_new (local_summary_add_files_thread, &afd,
+			CLAMP (g_get_num_processors (), 2, ADD_FILES_MAX_THREADS), FALSE, NULL);
+	}
+
+	for (ii = 0; ii < names->len && !g_cancellable_is_cancelled (cancellable); ii += batch_len) {
+		batch_len = MIN (ADD_FILES_BATCH_SIZE, names->len - ii);
+
+		camel_operation_progress (cancellable, ii * 100 / names->len);
+
+		if (pool) {
+			g_mutex_lock (&afd.lock);
+			afd.n_pending = batch_len;
+			g_mutex_unlock (&afd.lock);
+
+			for (jj = 0; jj < batch_len; jj++) {
+				g_thread_pool_push (pool, GUINT_TO_POINTER (ii + jj + 1), NULL);
+			}
+
+			g_mutex_lock (&afd.lock);
+			while (afd.n_pending)
+				g_cond_wait (&afd.cond, &afd.lock);
+			g_mutex_unlock (&afd.lock);
+		} else {
+			for (jj = 0; jj < batch_len; jj++) {
+				afd.infos[ii + jj] = local_summary_info_from_file (cls, dir_path, g_ptr_array_index (names, ii + jj));
+			}
+		}
+
+		/* merge in the order of the names */
+		for (jj = ii; jj < ii + batch_len; jj++) {
+			CamelMessageInfo *info = afd.infos[jj];
+
+			if (!info)
+				continue;
+
+			camel_local_summary_set_current_file (g_ptr_array_index (names, jj));
+			camel_folder_summary_add (summary, info, FALSE);
+			camel_local_summary_set_current_file (NULL);
+
+			if (changes)
+				camel_folder_change_info_add_uid (changes, camel_message_info_get_uid (info));
+
+			g_clear_object (&afd.infos[jj]);
+		}
+
+		/* store the batch in one transaction, which also allows to free the infos from memory */
+		if (names->len > ADD_FILES_BATCH_SIZE)
+			camel_folder_summary_save (summary, NULL);
+	}
+
+	if (pool)
+		g_thread_pool_free (pool, FALSE, TRUE);
+
+	g_mutex_clear (&afd.lock);
+	g_cond_clear (&afd.cond);
+	g_free (afd.infos);
+}
@@ -14,6 +14,8 @@
 
 #include <glib.h>
 
+#include "camel-local-summary.h"
+
 G_BEGIN_DECLS
 
 struct _CamelLocalFolderPrivate {
@@ -31,6 +33,19 @@ gint		camel_local_frompos_sort	(gpointer enc,
 						 gint len2,
 						 gpointer data2);
 
+const gchar *	camel_local_summary_get_current_file
+						(void);
+void		camel_local_summary_set_current_file
+						(const gchar *name);
+gboolean	camel_local_summary_can_add_files_parallel
+						(CamelLocalSummary *cls,
+						 guint n_files);
+void		camel_local_summary_add_files	(CamelLocalSummary *cls,
+						 const gchar *dir_path,
+						 GPtrArray *names,
+						 CamelFolderChangeInfo *changes,
+						 GCancellable *cancellable);
+
 G_END_DECLS
 
 #endif /* CAMEL_LOCAL_PRIVATE_H */
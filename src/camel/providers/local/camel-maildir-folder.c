@@ -21,6 +21,8 @@
 #include "camel-maildir-folder.h"
 #include "camel-maildir-store.h"
 #include "camel-maildir-summary.h"
+#include "camel-mbox-folder.h"
+#include "camel-mbox-message-info.h"
 
 #define d(x) /*(printf("%s(%d): ", __FILE__, __LINE__),(x))*/
 
@@ -298,6 +300,285 @@ maildir_folder_get_message_sync (CamelFolder *folder,
 	return message;
 }
 
+/* Makes the @dest_filename a copy of the @src_filename; it is a hard link
+   on the same file system, otherwise the content is copied through
+   the @tmp_filename */
+static gboolean
+maildir_folder_copy_file (const gchar *src_filename,
+                          const gchar *tmp_filename,
+                          const gchar *dest_filename,
+                          GCancellable *cancellable,
+                          GError **error)
+{
+	GFile *src_file, *tmp_file;
+	gboolean success;
+
+#ifndef G_OS_WIN32
+	/* the maildir files are not modified, thus they can share the content */
+	if (link (src_filename, dest_filename) == 0)
+		return TRUE;
+#endif
+
+	src_file = g_file_new_for_path (src_filename);
+	tmp_file = g_file_new_for_path (tmp_filename);
+
+	/* it uses copy_file_range() or splice() when available */
+	success = g_file_copy (src_file, tmp_file, G_FILE_COPY_NONE, cancellable, NULL, NULL, error);
+
+	g_object_unref (src_file);
+	g_object_unref (tmp_file);
+
+	if (success && g_rename (tmp_filename, dest_filename) == -1) {
+		g_set_error (
+			error, G_IO_ERROR,
+			g_io_error_from_errno (errno),
+			"%s", g_strerror (errno));
+		g_unlink (tmp_filename);
+		success = FALSE;
+	}
+
+	return success;
+}
+
+/* Copies the raw message at the @frompos of the mbox file into the @dest_filename,
+   without the From line and without the X-Evolution header of the mbox folder */
+static gboolean
+maildir_folder_copy_mbox_message (CamelMimeParser *parser,
+                                  goffset frompos,
+                                  const gchar *tmp_filename,
+                                  const gchar *dest_filename,
+                                  GError **error)
+{
+	CamelNameValueArray *headers;
+	gchar *buffer;
+	gsize len;
+	gint fd, written;
+
+	camel_mime_parser_seek (parser, frompos, SEEK_SET);
+	if (camel_mime_parser_step (parser, &buffer, &len) != CAMEL_MIME_PARSER_STATE_FROM ||
+	    camel_mime_parser_tell_start_from (parser) != frompos ||
+	    camel_mime_parser_step (parser, &buffer, &len) == CAMEL_MIME_PARSER_STATE_FROM_END) {
+		g_set_error_literal (
+			error, CAMEL_FOLDER_ERROR, CAMEL_FOLDER_ERROR_INVALID,
+			_("The folder appears to be irrecoverably corrupted."));
+		return FALSE;
+	}
+
+	fd = g_open (tmp_filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0600);
+	if (fd == -1)
+		goto fail;
+
+	headers = camel_mime_parser_dup_headers (parser);
+	written = camel_local_summary_write_headers (fd, headers, NULL, NULL, NULL);
+	camel_name_value_array_free (headers);
+
+	if (written == -1)
+		goto fail;
+
+	camel_mime_parser_drop_step (parser);
+	camel_mime_parser_drop_step (parser);
+
+	/* the body is copied as is, up to the next From line */
+	while (camel_mime_parser_step (parser, &buffer, &len) == CAMEL_MIME_PARSER_STATE_PRE_FROM) {
+		if (write (fd, buffer, len) != (gssize) len)
+			goto fail;
+	}
+
+	if (close (fd) == -1) {
+		fd = -1;
+		goto fail;
+	}
+
+	fd = -1;
+
+	if (g_rename (tmp_filename, dest_filename) == -1)
+		goto fail;
+
+	return TRUE;
+
+ fail:
+	g_set_error (
+		error, G_IO_ERROR,
+		g_io_error_from_errno (errno),
+		"%s", g_strerror (errno));
+
+	if (fd != -1)
+		close (fd);
+	g_unlink (tmp_filename);
+
+	return FALSE;
+}
+
+/* Transfers the messages from a maildir or an mbox folder into the maildir @dest
+   without parsing them. The message infos of the @source are carried over. */
+static gboolean
+maildir_folder_transfer_raw_sync (CamelFolder *source,
+                                  GPtrArray *uids,
+                                  CamelFolder *dest,
+                                  gboolean delete_originals,
+                                  GPtrArray **transferred_uids,
+                                  GCancellable *cancellable,
+                                  GError **error)
+{
+	CamelLocalFolder *lf = (CamelLocalFolder *) source;
+	CamelLocalFolder *df = (CamelLocalFolder *) dest;
+	CamelFolderSummary *source_summary, *dest_summary;
+	CamelMimeParser *parser = NULL;
+	guint32 source_folder_flags;
+	gboolean success = TRUE;
+	guint ii;
+
+	source_summary = camel_folder_get_folder_summary (source);
+	dest_summary = camel_folder_get_folder_summary (dest);
+	source_folder_flags = camel_folder_get_flags (source);
+
+	if (transferred_uids)
+		*transferred_uids = g_ptr_array_new_with_free_func (g_free);
+
+	if (camel_local_folder_lock (lf, CAMEL_LOCK_WRITE, error) == -1)
+		return FALSE;
+
+	if (camel_local_folder_lock (df, CAMEL_LOCK_WRITE, error) == -1) {
+		camel_local_folder_unlock (lf);
+		return FALSE;
+	}
+
+	if (CAMEL_IS_MBOX_FOLDER (source)) {
+		gint fd;
+
+		camel_local_folder_lock_changes (lf);
+
+		/* the offsets need to match the file */
+		if (camel_local_summary_check (CAMEL_LOCAL_SUMMARY (source_summary), lf->changes, cancellable, error) == -1) {
+			camel_local_folder_unlock_changes (lf);
+			success = FALSE;
+			goto exit;
+		}
+
+		camel_local_folder_unlock_changes (lf);
+
+		fd = g_open (lf->folder_path, O_RDONLY | O_BINARY, 0);
+		if (fd == -1) {
+			g_set_error (
+				error, G_IO_ERROR,
+				g_io_error_from_errno (errno),
+				_("Cannot transfer message to destination folder: %s"),
+				g_strerror (errno));
+			success = FALSE;
+			goto exit;
+		}
+
+		parser = camel_mime_parser_new ();
+		camel_mime_parser_scan_from (parser, TRUE);
+		camel_mime_parser_scan_pre_from (parser, TRUE);
+		camel_mime_parser_init_with_fd (parser, fd);
+	}
+
+	camel_operation_push_message (
+		cancellable, delete_originals ? _("Moving messages") : _("Copying messages"));
+
+	camel_folder_freeze (dest);
+	camel_folder_freeze (source);
+
+	for (ii = 0; ii < uids->len && success; ii++) {
+		const gchar *uid = uids->pdata[ii];
+		CamelMessageInfo *info, *clone;
+		gchar *new_uid, *tmp_filename, *dest_filename;
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			success = FALSE;
+			break;
+		}
+
+		info = camel_folder_summary_get (source_summary, uid);
+		if (!info) {
+			set_cannot_get_message_ex (
+				error, CAMEL_FOLDER_ERROR_INVALID_UID,
+				uid, lf->folder_path, _("No such message"));
+			success = FALSE;
+			break;
+		}
+
+		new_uid = camel_folder_summary_next_uid_string (dest_summary);
+
+		clone = camel_message_info_clone (info, dest_summary);
+		camel_message_info_set_abort_notifications (clone, TRUE);
+		camel_message_info_set_uid (clone, new_uid);
+		camel_message_info_set_flags (clone, CAMEL_MESSAGE_FOLDER_NOXEV, 0);
+		/* unset deleted flag when transferring from trash folder */
+		if ((source_folder_flags & CAMEL_FOLDER_IS_TRASH) != 0)
+			camel_message_info_set_flags (clone, CAMEL_MESSAGE_DELETED, 0);
+		/* unset junk flag when transferring from junk folder */
+		if ((source_folder_flags & CAMEL_FOLDER_IS_JUNK) != 0)
+			camel_message_info_set_flags (clone, CAMEL_MESSAGE_JUNK, 0);
+		/* with maildir the received date is part of the uid */
+		if (camel_message_info_get_date_received (clone) <= 0)
+			camel_message_info_set_date_received (clone, strtoul (new_uid, NULL, 10));
+		camel_maildir_message_info_take_filename (CAMEL_MAILDIR_MESSAGE_INFO (clone), camel_maildir_summary_info_to_name (clone));
+		camel_message_info_set_abort_notifications (clone, FALSE);
+
+		tmp_filename = g_strdup_printf ("%s/tmp/%s", df->folder_path, new_uid);
+		dest_filename = g_strdup_printf ("%s/cur/%s", df->folder_path, camel_maildir_message_info_get_filename (CAMEL_MAILDIR_MESSAGE_INFO (clone)));
+
+		if (parser) {
+			success = maildir_folder_copy_mbox_message (
+				parser, camel_mbox_message_info_get_offset (CAMEL_MBOX_MESSAGE_INFO (info)),
+				tmp_filename, dest_filename, error);
+		} else {
+			gchar *src_filename;
+
+			src_filename = maildir_folder_get_filename (source, uid, error);
+			success = src_filename && maildir_folder_copy_file (src_filename, tmp_filename, dest_filename, cancellable, error);
+
+			g_free (src_filename);
+		}
+
+		if (success) {
+			camel_folder_summary_add (dest_summary, clone, FALSE);
+
+			camel_local_folder_lock_changes (df);
+			camel_folder_change_info_add_uid (df->changes, camel_message_info_get_uid (clone));
+			camel_local_folder_unlock_changes (df);
+
+			if (transferred_uids)
+				g_ptr_array_add (*transferred_uids, g_strdup (camel_message_info_get_uid (clone)));
+
+			if (delete_originals)
+				camel_folder_set_message_flags (
+					source, uid, CAMEL_MESSAGE_DELETED |
+					CAMEL_MESSAGE_SEEN, ~0);
+		} else {
+			g_prefix_error (
+				error, _("Cannot transfer message to destination folder: %s: "),
+				uid);
+		}
+
+		camel_operation_progress (cancellable, (ii + 1) * 100 / uids->len);
+
+		g_clear_object (&clone);
+		g_clear_object (&info);
+		g_free (new_uid);
+		g_free (tmp_filename);
+		g_free (dest_filename);
+	}
+
+	camel_folder_thaw (source);
+	camel_folder_thaw (dest);
+
+	camel_operation_pop_message (cancellable);
+
+ exit:
+	g_clear_object (&parser);
+
+	camel_local_folder_unlock (df);
+	camel_local_folder_unlock (lf);
+
+	camel_local_folder_claim_changes (lf);
+	camel_local_folder_claim_changes (df);
+
+	return success;
+}
+
 static gboolean
 maildir_folder_transfer_messages_to_sync (CamelFolder *source,
                                           GPtrArray *uids,
@@ -372,10 +653,10 @@ maildir_folder_transfer_messages_to_sync (CamelFolder *source,
 				camel_maildir_message_info_set_filename (CAMEL_MAILDIR_MESSAGE_INFO (clone), new_filename);
 				/* unset deleted flag when transferring from trash folder */
 				if ((camel_folder_get_flags (source) & CAMEL_FOLDER_IS_TRASH) != 0)
-					camel_message_info_set_flags (info, CAMEL_MESSAGE_DELETED, 0);
+					camel_message_info_set_flags (clone, CAMEL_MESSAGE_DELETED, 0);
 				/* unset junk flag when transferring from junk folder */
 				if ((camel_folder_get_flags (source) & CAMEL_FOLDER_IS_JUNK) != 0)
-					camel_message_info_set_flags (info, CAMEL_MESSAGE_JUNK, 0);
+					camel_message_info_set_flags (clone, CAMEL_MESSAGE_JUNK, 0);
 				camel_folder_summary_add (camel_folder_get_folder_summary (dest), clone, FALSE);
 
 				camel_local_folder_lock_changes (df);
@@ -408,6 +689,13 @@ maildir_folder_transfer_messages_to_sync (CamelFolder *source,
 	} else
 		fallback = TRUE;
 
+	if (fallback && CAMEL_IS_MAILDIR_FOLDER (dest) &&
+	    (CAMEL_IS_MAILDIR_FOLDER (source) || CAMEL_IS_MBOX_FOLDER (source))) {
+		return maildir_folder_transfer_raw_sync (
+			source, uids, dest, delete_originals,
+			transferred_uids, cancellable, error);
+	}
+
 	if (fallback) {
 		CamelFolderClass *folder_class;
 
@@ -24,6 +24,7 @@
 #include <glib/gstdio.h>
 #include <glib/gi18n-lib.h>
 
+#include "camel-local-private.h"
 #include "camel-maildir-message-info.h"
 #include "camel-maildir-store.h"
 #include "camel-maildir-summary.h"
@@ -32,6 +33,14 @@
 
 #define CAMEL_MAILDIR_SUMMARY_VERSION (0x2000)
 
+/* how often to read the whole 'cur' directory, even when it's monitored */
+#define MAILDIR_FULL_CHECK_INTERVAL (15 * 60 * G_USEC_PER_SEC)
+/* how many changed files to remember before falling back to the full check */
+#define MAILDIR_MAX_CHANGED_FILES 10000
+/* how much the 'cur' directory modification time can be after the change time
+   of the last changed file, to be still considered caused by that change */
+#define MAILDIR_MTIME_SLACK (10 * 1000)
+
 static CamelMessageInfo *
 		message_info_new_from_headers	(CamelFolderSummary *,
 						 const CamelNameValueArray *);
@@ -66,23 +75,64 @@ static gchar *	maildir_summary_encode_x_evolution
 typedef struct _CamelMaildirMessageContentInfo CamelMaildirMessageContentInfo;
 
 struct _CamelMaildirSummaryPrivate {
-	gchar *current_file;
 	gchar *hostname;
 	gchar filename_flag_sep;
 
 	GHashTable *load_map;
 	GMutex summary_lock;
+
+	/* directory monitoring, to check only the changed files; guarded by summary_lock */
+	GMainContext *monitor_context;
+	GFileMonitor *cur_monitor;
+	GFileMonitor *new_monitor;
+	GHashTable *changed_cur_files; /* gchar *basename */
+	gboolean new_changed;
+	gboolean monitor_tried;
+	gboolean need_full_check;
+	gint64 last_full_check;
+	guint n_full_checks;
+	gint64 cur_mtime;
+	gint64 new_mtime;
 };
 
 struct _CamelMaildirMessageContentInfo {
 	CamelMessageContentInfo info;
 };
 
+enum {
+	PROP_0,
+	PROP_N_FULL_CHECKS,
+	N_PROPS
+};
+
+static GParamSpec *properties[N_PROPS] = { NULL, };
+
 G_DEFINE_TYPE_WITH_PRIVATE (
 	CamelMaildirSummary,
 	camel_maildir_summary,
 	CAMEL_TYPE_LOCAL_SUMMARY)
 
+static void maildir_summary_stop_monitors (CamelMaildirSummary *mds);
+
+static void
+maildir_summary_get_property (GObject *object,
+			      guint property_id,
+			      GValue *value,
+			      GParamSpec *pspec)
+{
+	CamelMaildirSummary *mds = CAMEL_MAILDIR_SUMMARY (object);
+
+	switch (property_id) {
+		case PROP_N_FULL_CHECKS:
+			g_mutex_lock (&mds->priv->summary_lock);
+			g_value_set_uint (value, mds->priv->n_full_checks);
+			g_mutex_unlock (&mds->priv->summary_lock);
+			return;
+	}
+
+	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+}
+
 static void
 maildir_summary_finalize (GObject *object)
 {
@@ -90,6 +140,8 @@ maildir_summary_finalize (GObject *object)
 
 	priv = CAMEL_MAILDIR_SUMMARY (object)->priv;
 
+	maildir_summary_stop_monitors (CAMEL_MAILDIR_SUMMARY (object));
+
 	g_free (priv->hostname);
 	g_mutex_clear (&priv->summary_lock);
 
@@ -105,6 +157,7 @@ camel_maildir_summary_class_init (CamelMaildirSummaryClass *class)
 	CamelLocalSummaryClass *local_summary_class;
 
 	object_class = G_OBJECT_CLASS (class);
+	object_class->get_property = maildir_summary_get_property;
 	object_class->finalize = maildir_summary_finalize;
 
 	folder_summary_class = CAMEL_FOLDER_SUMMARY_CLASS (class);
@@ -121,6 +174,24 @@ camel_maildir_summary_class_init (CamelMaildirSummaryClass *class)
 	local_summary_class->add = maildir_summary_add;
 	local_summary_class->encode_x_evolution = maildir_summary_encode_x_evolution;
 	local_summary_class->decode_x_evolution = maildir_summary_decode_x_evolution;
+
+	/**
+	 * CamelMaildirSummary:n-full-checks:
+	 *
+	 * How many times the whole 'cur' directory had been read, instead
+	 * of checking only the changes reported by the directory monitors,
+	 * for diagnostics.
+	 *
+	 * Since: 3.62
+	 **/
+	properties[PROP_N_FULL_CHECKS] =
+		g_param_spec_uint (
+			"n-full-checks", NULL, NULL,
+			0, G_MAXUINT, 0,
+			G_PARAM_READABLE |
+			G_PARAM_STATIC_STRINGS);
+
+	g_object_class_install_properties (object_class, N_PROPS, properties);
 }
 
 static void
@@ -142,6 +213,7 @@ camel_maildir_summary_init (CamelMaildirSummary *maildir_summary)
 		maildir_summary->priv->hostname = g_strdup ("localhost");
 	}
 	g_mutex_init (&maildir_summary->priv->summary_lock);
+	maildir_summary->priv->need_full_check = TRUE;
 }
 
 /**
@@ -348,8 +420,7 @@ message_info_new_from_headers (CamelFolderSummary *summary,
 			       const CamelNameValueArray *headers)
 {
 	CamelMessageInfo *mi, *info;
-	CamelMaildirSummary *mds = (CamelMaildirSummary *) summary;
-	const gchar *uid;
+	const gchar *uid, *current_file;
 
 	mi = ((CamelFolderSummaryClass *) camel_maildir_summary_parent_class)->message_info_new_from_headers (summary, headers);
 	/* assign the uid and new filename */
@@ -375,14 +446,15 @@ message_info_new_from_headers (CamelFolderSummary *summary,
 			camel_message_info_set_date_received (mi, strtoul (camel_message_info_get_uid (mi), NULL, 10));
 		}
 
-		if (mds->priv->current_file) {
+		current_file = camel_local_summary_get_current_file ();
+		if (current_file) {
 #if 0
 			gchar *p1, *p2, *p3;
 			gulong uid;
 #endif
 			/* if setting from a file, grab the flags from it */
-			camel_maildir_message_info_take_filename (CAMEL_MAILDIR_MESSAGE_INFO (mi), g_strdup (mds->priv->current_file));
-			camel_maildir_summary_name_to_info (mi, mds->priv->current_file);
+			camel_maildir_message_info_take_filename (CAMEL_MAILDIR_MESSAGE_INFO (mi), g_strdup (current_file));
+			camel_maildir_summary_name_to_info (mi, current_file);
 
 #if 0
 			/* Actually, I don't think all this effort is worth it at all ... */
@@ -414,18 +486,20 @@ static gchar *
 maildir_summary_next_uid_string (CamelFolderSummary *s)
 {
 	CamelMaildirSummary *mds = (CamelMaildirSummary *) s;
+	const gchar *current_file;
 
 	d (printf ("next uid string called?\n"));
 
 	/* if we have a current file, then use that to get the uid */
-	if (mds->priv->current_file) {
+	current_file = camel_local_summary_get_current_file ();
+	if (current_file) {
 		gchar *cln;
 
-		cln = strchr (mds->priv->current_file, mds->priv->filename_flag_sep);
+		cln = strchr (current_file, mds->priv->filename_flag_sep);
 		if (cln)
-			return g_strndup (mds->priv->current_file, cln - mds->priv->current_file);
+			return g_strndup (current_file, cln - current_file);
 		else
-			return g_strdup (mds->priv->current_file);
+			return g_strdup (current_file);
 	} else {
 		/* the first would probably work, but just to be safe, check for collisions */
 #if 0
@@ -528,7 +602,6 @@ camel_maildir_summary_add (CamelLocalSummary *cls,
 {
 	CamelMessageInfo *info;
 	CamelFolderSummary *summary;
-	CamelMaildirSummary *maildirs = (CamelMaildirSummary *) cls;
 	gchar *filename = g_strdup_printf ("%s/cur/%s", cls->folder_path, name);
 	gint fd;
 	CamelMimeParser *mp;
@@ -552,14 +625,14 @@ camel_maildir_summary_add (CamelLocalSummary *cls,
 	} else {
 		camel_folder_summary_set_index (summary, NULL);
 	}
-	maildirs->priv->current_file = (gchar *) name;
+	camel_local_summary_set_current_file (name);
 
 	info = camel_folder_summary_info_new_from_parser (summary, mp);
 	camel_folder_summary_add (summary, info, FALSE);
 	g_clear_object (&info);
 
 	g_object_unref (mp);
-	maildirs->priv->current_file = NULL;
+	camel_local_summary_set_current_file (NULL);
 	camel_folder_summary_set_index (summary, NULL);
 	g_free (filename);
 	return 0;
@@ -586,203 +659,385 @@ remove_summary (const gchar *uid,
 	g_ptr_array_add (rd->removed_uids, (gpointer) uid);
 }
 
-static gint
-maildir_summary_check (CamelLocalSummary *cls,
-                       CamelFolderChangeInfo *changes,
-                       GCancellable *cancellable,
-                       GError **error)
+static gchar *
+maildir_summary_name_to_uid (CamelMaildirSummary *mds,
+			     const gchar *name)
 {
-	DIR *dir;
-	struct dirent *d;
-	gchar *p;
-	CamelFolderSummary *s = (CamelFolderSummary *) cls;
-	CamelMaildirSummary *mds;
-	GHashTable *left;
-	gint i, count, total;
-	gint forceindex;
-	gchar *new, *cur;
-	struct _remove_data rd = { cls, changes, NULL };
-	GPtrArray *known_uids;
+	const gchar *sep;
 
-	mds = CAMEL_MAILDIR_SUMMARY (s);
+	sep = strchr (name, mds->priv->filename_flag_sep);
+	if (sep)
+		return g_strndup (name, sep - name);
 
-	g_mutex_lock (&mds->priv->summary_lock);
+	return g_strdup (name);
+}
 
-	new = g_strdup_printf ("%s/new", cls->folder_path);
-	cur = g_strdup_printf ("%s/cur", cls->folder_path);
+/* microseconds since the epoch of the last directory modification, or -1 on error */
+static gint64
+maildir_summary_get_dir_mtime (const gchar *path)
+{
+	GFile *file;
+	GFileInfo *info;
+	gint64 res = -1;
+
+	file = g_file_new_for_path (path);
+	info = g_file_query_info (file,
+		G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+		G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+		G_FILE_QUERY_INFO_NONE, NULL, NULL);
+
+	if (info) {
+		res = (gint64) g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+			g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+		g_object_unref (info);
+	}
 
-	d (printf ("checking summary ...\n"));
+	g_object_unref (file);
 
-	camel_operation_push_message (
-		cancellable, _("Checking folder consistency"));
+	return res;
+}
 
-	/* scan the directory, check for mail files not in the index, or index entries that
-	 * no longer exist */
-	dir = opendir (cur);
-	if (dir == NULL) {
-		g_set_error (
-			error, G_IO_ERROR,
-			g_io_error_from_errno (errno),
-			_("Cannot open maildir directory path: %s: %s"),
-			cls->folder_path, g_strerror (errno));
-		g_free (cur);
-		g_free (new);
-		camel_operation_pop_message (cancellable);
-		g_mutex_unlock (&mds->priv->summary_lock);
-		return -1;
+static void
+maildir_summary_note_changed_file (CamelMaildirSummary *mds,
+				   GFile *file,
+				   gboolean in_cur)
+{
+	gchar *basename;
+
+	if (!file)
+		return;
+
+	if (!in_cur) {
+		mds->priv->new_changed = TRUE;
+		return;
 	}
 
-	/* keeps track of all uid's that have not been processed */
-	left = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
-	known_uids = camel_folder_summary_dup_uids (s);
-	forceindex = !known_uids || known_uids->len == 0;
-	for (i = 0; known_uids && i < known_uids->len; i++) {
-		const gchar *uid = g_ptr_array_index (known_uids, i);
-		guint32 flags;
+	if (mds->priv->need_full_check)
+		return;
 
-		flags = camel_folder_summary_get_info_flags ((CamelFolderSummary *) cls, uid);
-		if (flags != (~0)) {
-			g_hash_table_insert (left, (gchar *) camel_pstring_strdup (uid), GUINT_TO_POINTER (flags));
+	basename = g_file_get_basename (file);
+
+	if (basename && *basename != '.') {
+		if (g_hash_table_size (mds->priv->changed_cur_files) >= MAILDIR_MAX_CHANGED_FILES) {
+			/* too many changes, it's cheaper to read the whole directory */
+			mds->priv->need_full_check = TRUE;
+			g_hash_table_remove_all (mds->priv->changed_cur_files);
+		} else {
+			g_hash_table_add (mds->priv->changed_cur_files, basename);
+			basename = NULL;
 		}
 	}
 
-	/* joy, use this to pre-count the total, so we can report progress meaningfully */
-	total = 0;
-	count = 0;
-	while (readdir (dir))
-		total++;
-	rewinddir (dir);
+	g_free (basename);
+}
 
-	while ((d = readdir (dir))) {
-		gchar *uid;
-		guint32 stored_flags = 0;
-		gint pc;
+static void
+maildir_summary_monitor_changed_cb (GFileMonitor *monitor,
+				    GFile *file,
+				    GFile *other_file,
+				    GFileMonitorEvent event_type,
+				    gpointer user_data)
+{
+	CamelMaildirSummary *mds = user_data;
+	gboolean in_cur;
+
+	in_cur = monitor == mds->priv->cur_monitor;
+
+	switch (event_type) {
+	case G_FILE_MONITOR_EVENT_CREATED:
+	case G_FILE_MONITOR_EVENT_DELETED:
+	case G_FILE_MONITOR_EVENT_MOVED_IN:
+	case G_FILE_MONITOR_EVENT_MOVED_OUT:
+		maildir_summary_note_changed_file (mds, file, in_cur);
+		break;
+	case G_FILE_MONITOR_EVENT_RENAMED:
+		maildir_summary_note_changed_file (mds, file, in_cur);
+		maildir_summary_note_changed_file (mds, other_file, in_cur);
+		break;
+	case G_FILE_MONITOR_EVENT_UNMOUNTED:
+		mds->priv->need_full_check = TRUE;
+		break;
+	default:
+		break;
+	}
+}
 
-		/* Avoid a potential division by zero if the first loop
-		 * (to calculate total) is executed on an empty
-		 * directory, then the directory is populated before
-		 * this loop is executed. */
-		total = MAX (total, count + 1);
-		pc = (total > 0) ? count * 100 / total : 0;
+/* Starts monitoring of the 'cur' and the 'new' directories, if not tried yet.
+   The events are delivered into a private main context, which is drained
+   during the check, thus it does not depend on any running main loop. */
+static void
+maildir_summary_start_monitors (CamelMaildirSummary *mds,
+				const gchar *cur,
+				const gchar *new)
+{
+	GFile *file;
 
-		camel_operation_progress (cancellable, pc);
-		count++;
+	if (mds->priv->monitor_tried)
+		return;
 
-		/* FIXME: also run stat to check for regular file */
-		p = d->d_name;
-		if (p[0] == '.')
-			continue;
+	mds->priv->monitor_tried = TRUE;
+	mds->priv->monitor_context = g_main_context_new ();
 
-		/* map the filename -> uid */
-		uid = strchr (d->d_name, mds->priv->filename_flag_sep);
-		if (uid)
-			uid = g_strndup (d->d_name, uid - d->d_name);
-		else
-			uid = g_strdup (d->d_name);
+	g_main_context_push_thread_default (mds->priv->monitor_context);
 
-		if (g_hash_table_contains (left, uid)) {
-			stored_flags = GPOINTER_TO_UINT (g_hash_table_lookup (left, uid));
-			g_hash_table_remove (left, uid);
+	file = g_file_new_for_path (cur);
+	mds->priv->cur_monitor = g_file_monitor_directory (file, G_FILE_MONITOR_WATCH_MOVES, NULL, NULL);
+	g_object_unref (file);
+
+	if (mds->priv->cur_monitor) {
+		file = g_file_new_for_path (new);
+		mds->priv->new_monitor = g_file_monitor_directory (file, G_FILE_MONITOR_WATCH_MOVES, NULL, NULL);
+		g_object_unref (file);
+	}
+
+	g_main_context_pop_thread_default (mds->priv->monitor_context);
+
+	if (!mds->priv->cur_monitor || !mds->priv->new_monitor) {
+		d (printf ("cannot monitor '%s', using full checks only\n", cur));
+		g_clear_object (&mds->priv->cur_monitor);
+		g_clear_object (&mds->priv->new_monitor);
+		g_clear_pointer (&mds->priv->monitor_context, g_main_context_unref);
+		return;
+	}
+
+	mds->priv->changed_cur_files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	g_signal_connect (mds->priv->cur_monitor, "changed",
+		G_CALLBACK (maildir_summary_monitor_changed_cb), mds);
+	g_signal_connect (mds->priv->new_monitor, "changed",
+		G_CALLBACK (maildir_summary_monitor_changed_cb), mds);
+}
+
+static void
+maildir_summary_stop_monitors (CamelMaildirSummary *mds)
+{
+	if (mds->priv->cur_monitor) {
+		g_signal_handlers_disconnect_by_data (mds->priv->cur_monitor, mds);
+		g_file_monitor_cancel (mds->priv->cur_monitor);
+		g_clear_object (&mds->priv->cur_monitor);
+	}
+
+	if (mds->priv->new_monitor) {
+		g_signal_handlers_disconnect_by_data (mds->priv->new_monitor, mds);
+		g_file_monitor_cancel (mds->priv->new_monitor);
+		g_clear_object (&mds->priv->new_monitor);
+	}
+
+	g_clear_pointer (&mds->priv->monitor_context, g_main_context_unref);
+	g_clear_pointer (&mds->priv->changed_cur_files, g_hash_table_destroy);
+}
+
+static void
+maildir_summary_drain_monitors (CamelMaildirSummary *mds)
+{
+	if (!mds->priv->monitor_context)
+		return;
+
+	while (g_main_context_iteration (mds->priv->monitor_context, FALSE)) {
+		/* just dispatch all pending events */
+	}
+}
+
+/* microseconds since the epoch of the latest status change of the existing
+   changed files in the 'cur' directory, which is when they had been created
+   or renamed, or -1 when none of them exists */
+static gint64
+maildir_summary_get_changes_ctime (CamelMaildirSummary *mds,
+				   const gchar *cur)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gint64 res = -1;
+
+	g_hash_table_iter_init (&iter, mds->priv->changed_cur_files);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		GFileInfo *info;
+		GFile *file;
+		gchar *filename;
+
+		filename = g_build_filename (cur, key, NULL);
+		file = g_file_new_for_path (filename);
+		info = g_file_query_info (file,
+			G_FILE_ATTRIBUTE_TIME_CHANGED ","
+			G_FILE_ATTRIBUTE_TIME_CHANGED_USEC,
+			G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, NULL, NULL);
+
+		if (info) {
+			gint64 ctime;
+
+			ctime = (gint64) g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_CHANGED) * G_USEC_PER_SEC +
+				g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_CHANGED_USEC);
+
+			res = MAX (res, ctime);
+
+			g_object_unref (info);
 		}
 
-		if (!camel_folder_summary_check_uid ((CamelFolderSummary *) cls, uid)) {
-			/* must be a message incorporated by another client, this is not a 'recent' uid */
-			if (camel_maildir_summary_add (cls, d->d_name, forceindex, cancellable) == 0)
-				if (changes)
-					camel_folder_change_info_add_uid (changes, uid);
-		} else {
-			CamelMaildirMessageInfo *mdi;
-			CamelMessageInfo *info;
-			gchar *expected_filename;
+		g_object_unref (file);
+		g_free (filename);
+	}
 
-			if (cls->index && (!camel_index_has_name (cls->index, uid))) {
-				/* message_info_new will handle duplicates */
-				camel_maildir_summary_add (cls, d->d_name, forceindex, cancellable);
-			}
+	return res;
+}
 
-			info = camel_folder_summary_peek_loaded ((CamelFolderSummary *) cls, uid);
-			mdi = info ? CAMEL_MAILDIR_MESSAGE_INFO (info) : NULL;
+/* Whether only the files reported by the monitors can be checked */
+static gboolean
+maildir_summary_can_check_changes (CamelMaildirSummary *mds,
+				   const gchar *cur,
+				   const gchar *new)
+{
+	gint64 cur_mtime;
 
-			expected_filename = camel_maildir_summary_uid_and_flags_to_name (mds, uid, stored_flags);
-			if ((mdi && !camel_maildir_message_info_get_filename (mdi)) ||
-			    !expected_filename ||
-			    strcmp (expected_filename, d->d_name) != 0) {
-				const gchar *old_filename;
-				gboolean externally_changed;
+	if (!mds->priv->cur_monitor || mds->priv->need_full_check)
+		return FALSE;
 
-				if (!mdi) {
-					g_clear_object (&info);
-					info = camel_folder_summary_get ((CamelFolderSummary *) cls, uid);
-					mdi = info ? CAMEL_MAILDIR_MESSAGE_INFO (info) : NULL;
-				}
+	/* a periodic consistency check, in case any event got lost */
+	if (g_get_monotonic_time () - mds->priv->last_full_check > MAILDIR_FULL_CHECK_INTERVAL)
+		return FALSE;
+
+	cur_mtime = maildir_summary_get_dir_mtime (cur);
 
-				g_warn_if_fail (mdi != NULL);
+	if (cur_mtime != mds->priv->cur_mtime) {
+		/* The directory changed, but no event had been received for it; it can be
+		   a delay in the event delivery or a non-working monitor, thus scan it all. */
+		if (!g_hash_table_size (mds->priv->changed_cur_files))
+			return FALSE;
 
-				old_filename = mdi ? camel_maildir_message_info_get_filename (mdi) : NULL;
-				externally_changed = g_strcmp0 (old_filename, d->d_name) != 0;
+		/* The directory changed after the last reported change, thus some event
+		   could be lost. A removed file cannot tell when it was removed, thus
+		   the full check is done also when the removal was the last change. */
+		if (maildir_summary_get_changes_ctime (mds, cur) + MAILDIR_MTIME_SLACK < cur_mtime)
+			return FALSE;
+	}
 
-				if (mdi)
-					camel_maildir_message_info_set_filename (mdi, d->d_name);
+	if (!mds->priv->new_changed &&
+	    maildir_summary_get_dir_mtime (new) != mds->priv->new_mtime)
+		mds->priv->new_changed = TRUE;
 
-				if (info && externally_changed) {
-					guint32 ondisk_flags = 0;
-					guint32 all_maildir_flags = 0;
-					const gchar *fp;
-					gchar sep_pattern[4];
-					gchar fc;
-					gint fi;
+	return TRUE;
+}
 
-					sep_pattern[0] = mds->priv->filename_flag_sep;
-					sep_pattern[1] = '2';
-					sep_pattern[2] = ',';
-					sep_pattern[3] = '\0';
+static gint
+maildir_summary_compare_names (gconstpointer ptr1,
+			       gconstpointer ptr2)
+{
+	const gchar *name1 = *((const gchar **) ptr1);
+	const gchar *name2 = *((const gchar **) ptr2);
 
-					for (fi = 0; fi < G_N_ELEMENTS (flagbits); fi++) {
-						all_maildir_flags |= flagbits[fi].flagbit;
-					}
+	return g_strcmp0 (name1, name2);
+}
+
+/* Called with a file name existing in the 'cur' directory */
+static void
+maildir_summary_check_cur_file (CamelLocalSummary *cls,
+				CamelFolderChangeInfo *changes,
+				const gchar *name,
+				const gchar *uid,
+				guint32 stored_flags,
+				gint forceindex,
+				GCancellable *cancellable)
+{
+	CamelMaildirSummary *mds = CAMEL_MAILDIR_SUMMARY (cls);
+
+	if (!camel_folder_summary_check_uid ((CamelFolderSummary *) cls, uid)) {
+		/* must be a message incorporated by another client, this is not a 'recent' uid */
+		if (camel_maildir_summary_add (cls, name, forceindex, cancellable) == 0)
+			if (changes)
+				camel_folder_change_info_add_uid (changes, uid);
+	} else {
+		CamelMaildirMessageInfo *mdi;
+		CamelMessageInfo *info;
+		gchar *expected_filename;
+
+		if (cls->index && (!camel_index_has_name (cls->index, uid))) {
+			/* message_info_new will handle duplicates */
+			camel_maildir_summary_add (cls, name, forceindex, cancellable);
+		}
+
+		info = camel_folder_summary_peek_loaded ((CamelFolderSummary *) cls, uid);
+		mdi = info ? CAMEL_MAILDIR_MESSAGE_INFO (info) : NULL;
+
+		expected_filename = camel_maildir_summary_uid_and_flags_to_name (mds, uid, stored_flags);
+		if ((mdi && !camel_maildir_message_info_get_filename (mdi)) ||
+		    !expected_filename ||
+		    strcmp (expected_filename, name) != 0) {
+			const gchar *old_filename;
+			gboolean externally_changed;
+
+			if (!mdi) {
+				g_clear_object (&info);
+				info = camel_folder_summary_get ((CamelFolderSummary *) cls, uid);
+				mdi = info ? CAMEL_MAILDIR_MESSAGE_INFO (info) : NULL;
+			}
+
+			g_warn_if_fail (mdi != NULL);
+
+			old_filename = mdi ? camel_maildir_message_info_get_filename (mdi) : NULL;
+			externally_changed = g_strcmp0 (old_filename, name) != 0;
+
+			if (mdi)
+				camel_maildir_message_info_set_filename (mdi, name);
+
+			if (info && externally_changed) {
+				guint32 ondisk_flags = 0;
+				guint32 all_maildir_flags = 0;
+				const gchar *fp;
+				gchar sep_pattern[4];
+				gchar fc;
+				gint fi;
+
+				sep_pattern[0] = mds->priv->filename_flag_sep;
+				sep_pattern[1] = '2';
+				sep_pattern[2] = ',';
+				sep_pattern[3] = '\0';
+
+				for (fi = 0; fi < G_N_ELEMENTS (flagbits); fi++) {
+					all_maildir_flags |= flagbits[fi].flagbit;
+				}
 
-					fp = strstr (d->d_name, sep_pattern);
-					if (fp) {
-						fp += 3;
-						while ((fc = *fp++)) {
-							for (fi = 0; fi < G_N_ELEMENTS (flagbits); fi++) {
-								if (flagbits[fi].flag == fc) {
-									ondisk_flags |= flagbits[fi].flagbit;
-									break;
-								}
+				fp = strstr (name, sep_pattern);
+				if (fp) {
+					fp += 3;
+					while ((fc = *fp++)) {
+						for (fi = 0; fi < G_N_ELEMENTS (flagbits); fi++) {
+							if (flagbits[fi].flag == fc) {
+								ondisk_flags |= flagbits[fi].flagbit;
+								break;
 							}
 						}
 					}
-
-					camel_message_info_set_flags (info, all_maildir_flags, ondisk_flags);
-					camel_message_info_set_folder_flagged (info, FALSE);
-					if (changes)
-						camel_folder_change_info_change_uid (changes, uid);
 				}
-			}
 
-			g_free (expected_filename);
-			g_clear_object (&info);
+				camel_message_info_set_flags (info, all_maildir_flags, ondisk_flags);
+				camel_message_info_set_folder_flagged (info, FALSE);
+				if (changes)
+					camel_folder_change_info_change_uid (changes, uid);
+			}
 		}
-		g_free (uid);
-	}
-	closedir (dir);
-	g_hash_table_foreach (left, (GHFunc) remove_summary, &rd);
 
-	if (rd.removed_uids) {
-		camel_folder_summary_remove_uids ((CamelFolderSummary *) cls, rd.removed_uids);
-		g_clear_pointer (&rd.removed_uids, g_ptr_array_unref);
+		g_free (expected_filename);
+		g_clear_object (&info);
 	}
+}
 
-	/* Destroy the hash table only after the removed_uids GList is freed, because it has borrowed the UIDs */
-	g_hash_table_destroy (left);
-
-	camel_operation_pop_message (cancellable);
+/* scan 'new' for new messages, and move them to 'cur', and so forth */
+static void
+maildir_summary_check_new (CamelLocalSummary *cls,
+			   CamelFolderChangeInfo *changes,
+			   const gchar *new,
+			   const gchar *cur,
+			   gint forceindex,
+			   GCancellable *cancellable)
+{
+	CamelFolderSummary *s = (CamelFolderSummary *) cls;
+	CamelMaildirSummary *mds = CAMEL_MAILDIR_SUMMARY (cls);
+	DIR *dir;
+	struct dirent *d;
+	gint count, total;
 
 	camel_operation_push_message (
 		cancellable, _("Checking for new messages"));
 
-	/* now, scan new for new messages, and copy them to cur, and so forth */
 	dir = opendir (new);
 	if (dir != NULL) {
 		total = 0;
@@ -847,17 +1102,307 @@ maildir_summary_check (CamelLocalSummary *cls,
 			g_free (dest);
 		}
 
-		camel_operation_pop_message (cancellable);
 		closedir (dir);
 	}
 
+	camel_operation_pop_message (cancellable);
+}
+
+/* Checks only the files reported by the directory monitors since the last check */
+static gint
+maildir_summary_check_changes (CamelLocalSummary *cls,
+			       CamelFolderChangeInfo *changes,
+			       const gchar *cur,
+			       const gchar *new,
+			       GCancellable *cancellable)
+{
+	CamelFolderSummary *s = (CamelFolderSummary *) cls;
+	CamelMaildirSummary *mds = CAMEL_MAILDIR_SUMMARY (cls);
+	GHashTable *seen_uids, *gone_uids;
+	GHashTableIter iter;
+	gpointer key;
+	GPtrArray *removed_uids = NULL;
+	gint forceindex;
+
+	d (printf ("checking %u changed files ...\n", g_hash_table_size (mds->priv->changed_cur_files)));
+
+	forceindex = camel_folder_summary_count (s) == 0;
+	seen_uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	gone_uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	camel_operation_push_message (
+		cancellable, _("Checking folder consistency"));
+
+	g_hash_table_iter_init (&iter, mds->priv->changed_cur_files);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		const gchar *name = key;
+		gchar *filename, *uid;
+
+		uid = maildir_summary_name_to_uid (mds, name);
+		filename = g_strdup_printf ("%s/%s", cur, name);
+
+		if (g_file_test (filename, G_FILE_TEST_IS_REGULAR)) {
+			guint32 stored_flags;
+
+			stored_flags = camel_folder_summary_get_info_flags (s, uid);
+			if (stored_flags == (~0))
+				stored_flags = 0;
+
+			maildir_summary_check_cur_file (cls, changes, name, uid, stored_flags, forceindex, cancellable);
+
+			g_hash_table_add (seen_uids, uid);
+		} else {
+			g_hash_table_add (gone_uids, uid);
+		}
+
+		g_free (filename);
+	}
+
+	g_hash_table_remove_all (mds->priv->changed_cur_files);
+
+	g_hash_table_iter_init (&iter, gone_uids);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		const gchar *uid = key;
+		CamelMessageInfo *info;
+		gboolean exists = FALSE;
+
+		/* renamed to a file name, which had been checked above */
+		if (g_hash_table_contains (seen_uids, uid) ||
+		    !camel_folder_summary_check_uid (s, uid))
+			continue;
+
+		/* the message can still be stored under its known file name */
+		info = camel_folder_summary_get (s, uid);
+		if (info) {
+			const gchar *known_filename;
+
+			known_filename = camel_maildir_message_info_get_filename (CAMEL_MAILDIR_MESSAGE_INFO (info));
+			if (known_filename) {
+				gchar *filename;
+
+				filename = g_strdup_printf ("%s/%s", cur, known_filename);
+				exists = g_file_test (filename, G_FILE_TEST_IS_REGULAR);
+				g_free (filename);
+			}
+
+			g_clear_object (&info);
+		}
+
+		if (exists)
+			continue;
+
+		d (printf ("removing message %s from summary\n", uid));
+		if (cls->index)
+			camel_index_delete_name (cls->index, uid);
+		if (changes)
+			camel_folder_change_info_remove_uid (changes, uid);
+		if (!removed_uids)
+			removed_uids = g_ptr_array_new_with_free_func ((GDestroyNotify) camel_pstring_free);
+		g_ptr_array_add (removed_uids, (gpointer) camel_pstring_strdup (uid));
+	}
+
+	if (removed_uids) {
+		camel_folder_summary_remove_uids (s, removed_uids);
+		g_ptr_array_unref (removed_uids);
+	}
+
+	g_hash_table_destroy (seen_uids);
+	g_hash_table_destroy (gone_uids);
+
+	camel_operation_pop_message (cancellable);
+
+	if (mds->priv->new_changed) {
+		mds->priv->new_changed = FALSE;
+		maildir_summary_check_new (cls, changes, new, cur, forceindex, cancellable);
+	}
+
+	return 0;
+}
+
+/* scan the whole directory, check for mail files not in the index, or index entries that
+ * no longer exist */
+static gint
+maildir_summary_check_full (CamelLocalSummary *cls,
+			    CamelFolderChangeInfo *changes,
+			    const gchar *cur,
+			    const gchar *new,
+			    GCancellable *cancellable,
+			    GError **error)
+{
+	DIR *dir;
+	struct dirent *d;
+	gchar *p;
+	CamelFolderSummary *s = (CamelFolderSummary *) cls;
+	CamelMaildirSummary *mds;
+	GHashTable *left;
+	gint i, count, total;
+	gint forceindex;
+	struct _remove_data rd = { cls, changes, NULL };
+	GPtrArray *known_uids;
+	GPtrArray *to_add = NULL;
+	GHashTable *to_add_uids = NULL;
+
+	mds = CAMEL_MAILDIR_SUMMARY (s);
+
+	d (printf ("checking summary ...\n"));
+
+	/* everything is read now, thus any pending change is not needed */
+	if (mds->priv->changed_cur_files)
+		g_hash_table_remove_all (mds->priv->changed_cur_files);
+	mds->priv->new_changed = FALSE;
+	mds->priv->need_full_check = FALSE;
+	mds->priv->last_full_check = g_get_monotonic_time ();
+	mds->priv->n_full_checks++;
+
+	camel_operation_push_message (
+		cancellable, _("Checking folder consistency"));
+
+	dir = opendir (cur);
+	if (dir == NULL) {
+		g_set_error (
+			error, G_IO_ERROR,
+			g_io_error_from_errno (errno),
+			_("Cannot open maildir directory path: %s: %s"),
+			cls->folder_path, g_strerror (errno));
+		camel_operation_pop_message (cancellable);
+		mds->priv->need_full_check = TRUE;
+		return -1;
+	}
+
+	/* keeps track of all uid's that have not been processed */
+	left = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
+	known_uids = camel_folder_summary_dup_uids (s);
+	forceindex = !known_uids || known_uids->len == 0;
+	for (i = 0; known_uids && i < known_uids->len; i++) {
+		const gchar *uid = g_ptr_array_index (known_uids, i);
+		guint32 flags;
+
+		flags = camel_folder_summary_get_info_flags ((CamelFolderSummary *) cls, uid);
+		if (flags != (~0)) {
+			g_hash_table_insert (left, (gchar *) camel_pstring_strdup (uid), GUINT_TO_POINTER (flags));
+		}
+	}
+
+	/* joy, use this to pre-count the total, so we can report progress meaningfully */
+	total = 0;
+	count = 0;
+	while (readdir (dir))
+		total++;
+	rewinddir (dir);
+
+	/* Messages not known to the summary, like on the initial import, are parsed
+	   in worker threads; the body indexing is not thread safe, thus not with it. */
+	if (camel_local_summary_can_add_files_parallel (cls, MAX (total - (gint) (known_uids ? known_uids->len : 0), 0))) {
+		to_add = g_ptr_array_new_with_free_func (g_free);
+		to_add_uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	}
+
+	while ((d = readdir (dir))) {
+		gchar *uid;
+		guint32 stored_flags = 0;
+		gint pc;
+
+		/* Avoid a potential division by zero if the first loop
+		 * (to calculate total) is executed on an empty
+		 * directory, then the directory is populated before
+		 * this loop is executed. */
+		total = MAX (total, count + 1);
+		pc = (total > 0) ? count * 100 / total : 0;
+
+		camel_operation_progress (cancellable, pc);
+		count++;
+
+		/* FIXME: also run stat to check for regular file */
+		p = d->d_name;
+		if (p[0] == '.')
+			continue;
+
+		/* map the filename -> uid */
+		uid = maildir_summary_name_to_uid (mds, d->d_name);
+
+		if (g_hash_table_contains (left, uid)) {
+			stored_flags = GPOINTER_TO_UINT (g_hash_table_lookup (left, uid));
+			g_hash_table_remove (left, uid);
+		}
+
+		if (to_add && !camel_folder_summary_check_uid (s, uid)) {
+			/* summarise the new files at once, after the directory is read */
+			if (!g_hash_table_contains (to_add_uids, uid)) {
+				g_hash_table_add (to_add_uids, uid);
+				g_ptr_array_add (to_add, g_strdup (d->d_name));
+				continue;
+			}
+		}
+
+		maildir_summary_check_cur_file (cls, changes, d->d_name, uid, stored_flags, forceindex, cancellable);
+
+		g_free (uid);
+	}
+	closedir (dir);
+
+	if (to_add) {
+		/* the UIDs start with the delivery time, thus this adds them in the delivery order */
+		g_ptr_array_sort (to_add, maildir_summary_compare_names);
+		camel_local_summary_add_files (cls, cur, to_add, changes, cancellable);
+
+		g_ptr_array_unref (to_add);
+		g_hash_table_destroy (to_add_uids);
+	}
+	g_hash_table_foreach (left, (GHFunc) remove_summary, &rd);
+
+	if (rd.removed_uids) {
+		camel_folder_summary_remove_uids ((CamelFolderSummary *) cls, rd.removed_uids);
+		g_clear_pointer (&rd.removed_uids, g_ptr_array_unref);
+	}
+
+	/* Destroy the hash table only after the removed_uids GList is freed, because it has borrowed the UIDs */
+	g_hash_table_destroy (left);
+
+	camel_operation_pop_message (cancellable);
+
+	maildir_summary_check_new (cls, changes, new, cur, forceindex, cancellable);
+
+	g_clear_pointer (&known_uids, g_ptr_array_unref);
+
+	return 0;
+}
+
+static gint
+maildir_summary_check (CamelLocalSummary *cls,
+                       CamelFolderChangeInfo *changes,
+                       GCancellable *cancellable,
+                       GError **error)
+{
+	CamelMaildirSummary *mds;
+	gchar *new, *cur;
+	gint res;
+
+	mds = CAMEL_MAILDIR_SUMMARY (cls);
+
+	g_mutex_lock (&mds->priv->summary_lock);
+
+	new = g_strdup_printf ("%s/new", cls->folder_path);
+	cur = g_strdup_printf ("%s/cur", cls->folder_path);
+
+	maildir_summary_start_monitors (mds, cur, new);
+	maildir_summary_drain_monitors (mds);
+
+	if (maildir_summary_can_check_changes (mds, cur, new))
+		res = maildir_summary_check_changes (cls, changes, cur, new, cancellable);
+	else
+		res = maildir_summary_check_full (cls, changes, cur, new, cancellable, error);
+
+	if (mds->priv->cur_monitor) {
+		mds->priv->cur_mtime = maildir_summary_get_dir_mtime (cur);
+		mds->priv->new_mtime = maildir_summary_get_dir_mtime (new);
+	}
+
 	g_free (new);
 	g_free (cur);
 
-	g_clear_pointer (&known_uids, g_ptr_array_unref);
 	g_mutex_unlock (&mds->priv->summary_lock);
 
-	return 0;
+	return res;
 }
 
 /* sync the summary with the ondisk files. */
@@ -967,8 +1512,20 @@ maildir_summary_sync (CamelLocalSummary *cls,
 	}
 
 	if (removed_uids) {
+		CamelMaildirSummary *mds = CAMEL_MAILDIR_SUMMARY (cls);
+
 		camel_folder_summary_remove_uids (CAMEL_FOLDER_SUMMARY (cls), removed_uids);
 		g_ptr_array_unref (removed_uids);
+
+		/* the own removals do not need the full check, which the changed
+		   modification time of the 'cur' directory would cause otherwise */
+		g_mutex_lock (&mds->priv->summary_lock);
+		if (mds->priv->cur_monitor) {
+			name = g_strdup_printf ("%s/cur", cls->folder_path);
+			mds->priv->cur_mtime = maildir_summary_get_dir_mtime (name);
+			g_free (name);
+		}
+		g_mutex_unlock (&mds->priv->summary_lock);
 	}
 
 	g_clear_pointer (&known_uids, g_ptr_array_unref);
@@ -29,6 +29,7 @@ static const gchar *extensions[] = {
 	".ev-summary-meta",
 	".ibex.index",
 	".ibex.index.data",
+	".postings",
 	".cmeta",
 	".lock",
 	".db",
@@ -729,7 +730,8 @@ mbox_store_delete_folder_sync (CamelStore *store,
 
 	path = camel_local_store_get_meta_path (
 		local_store, folder_name, ".ibex");
-	if (camel_text_index_remove (path) == -1 && errno != ENOENT) {
+	if ((camel_postings_index_remove (path) == -1 && errno != ENOENT) ||
+	    (camel_text_index_remove (path) == -1 && errno != ENOENT)) {
 		g_set_error (
 			error, G_IO_ERROR,
 			g_io_error_from_errno (errno),
@@ -835,9 +837,11 @@ mbox_store_rename_folder_sync (CamelStore *store,
 			goto ibex_failed;
 		}
 	} else {
-		/* TODO camel_text_index_rename should find out
+		/* TODO camel_postings_index_rename should find out
 		 *      if we have an active index itself? */
-		if (camel_text_index_rename (oldibex, newibex) == -1 && errno != ENOENT) {
+		if (camel_postings_index_rename (oldibex, newibex) == -1 &&
+		    (errno != ENOENT || camel_text_index_rename (oldibex, newibex) == -1) &&
+		    errno != ENOENT) {
 			errnosav = errno;
 			goto ibex_failed;
 		}
@@ -887,8 +891,9 @@ summary_failed:
 	if (folder) {
 		if (folder->index)
 			camel_index_rename (folder->index, oldibex);
-	} else
+	} else if (camel_postings_index_rename (newibex, oldibex) == -1) {
 		camel_text_index_rename (newibex, oldibex);
+	}
 ibex_failed:
 	if (newdir) {
 		/* newdir is only non-NULL if we needed to mkdir */
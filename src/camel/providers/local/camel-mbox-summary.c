@@ -88,6 +88,7 @@ static gint	mbox_summary_sync_full		(CamelMboxSummary *cls,
 #define STATUS_STATUS (CAMEL_MESSAGE_SEEN)
 
 static void encode_status (guint32 flags, gchar status[8]);
+static void encode_status_padded (guint32 flags, guint32 mask, gchar status[8]);
 static guint32 decode_status (const gchar *status);
 
 G_DEFINE_TYPE (
@@ -708,7 +709,60 @@ cms_sort_frompos (gconstpointer a,
 
 }
 
-/* perform a quick sync - only system flags have changed */
+/* Overwrites value of the header @name of the current message in place;
+ * the @value is padded with spaces to the length of the existing value.
+ * Returns FALSE when the header is missing, is folded, or when the @value
+ * does not fit into it. */
+static gboolean
+mbox_summary_patch_header (CamelMimeParser *mp,
+                           gint fd,
+                           const gchar *name,
+                           const gchar *value)
+{
+	const gchar *raw;
+	gchar *slot;
+	gsize raw_len, value_len, skip = 0;
+	gint offset = -1;
+	goffset lastpos;
+	gssize len;
+
+	raw = camel_mime_parser_header (mp, name, &offset);
+	if (!raw || offset < 0 || strchr (raw, '\n'))
+		return FALSE;
+
+	/* the raw header can contain a leading ' ', keep it */
+	if (*raw == ' ' || *raw == '\t')
+		skip = 1;
+
+	raw_len = strlen (raw) - skip;
+	value_len = strlen (value);
+	if (value_len > raw_len)
+		return FALSE;
+
+	slot = g_alloca (raw_len);
+	memcpy (slot, value, value_len);
+	memset (slot + value_len, ' ', raw_len - value_len);
+
+	lastpos = lseek (fd, 0, SEEK_CUR);
+	if (lseek (fd, (goffset) offset + strlen (name) + 1 + skip, SEEK_SET) == (off_t) -1)
+		return FALSE;
+
+	do {
+		len = write (fd, slot, raw_len);
+	} while (len == -1 && errno == EINTR);
+
+	if (lastpos != -1 && lseek (fd, lastpos, SEEK_SET) == (off_t) -1) {
+		g_warning (
+			"%s: Failed to rewind file to last position: %s",
+			G_STRFUNC, g_strerror (errno));
+	}
+
+	return len == (gssize) raw_len;
+}
+
+/* perform a quick sync - only system flags have changed; the X-Evolution
+ * header and, in the xstatus mode, the Status and X-Status headers are
+ * overwritten in place */
 static gint
 mbox_summary_sync_quick (CamelMboxSummary *mbs,
                          gboolean expunge,
@@ -847,10 +901,28 @@ mbox_summary_sync_quick (CamelMboxSummary *mbs,
 		}
 		g_free (xevnew);
 
+		if (mbs->xstatus && (camel_message_info_get_flags (info) & CAMEL_MESSAGE_FOLDER_XEVCHANGE) != 0) {
+			guint32 info_flags = camel_message_info_get_flags (info);
+			gchar status[8];
+
+			encode_status (info_flags & STATUS_STATUS, status);
+			if (!mbox_summary_patch_header (mp, fd, "Status", status)) {
+				d (printf ("Status header of %s cannot be updated in place\n", camel_message_info_get_uid (info)));
+				goto error;
+			}
+
+			encode_status (info_flags & STATUS_XSTATUS, status);
+			if (!mbox_summary_patch_header (mp, fd, "X-Status", status)) {
+				d (printf ("X-Status header of %s cannot be updated in place\n", camel_message_info_get_uid (info)));
+				goto error;
+			}
+		}
+
 		camel_mime_parser_drop_step (mp);
 		camel_mime_parser_drop_step (mp);
 
-		camel_message_info_set_flags (info, CAMEL_MESSAGE_FOLDER_FLAGGED | 0xffff, camel_message_info_get_flags (info) & (~CAMEL_MESSAGE_FOLDER_FLAGGED));
+		/* do not use the system flags in the mask, it would mark the Status headers as changed again */
+		camel_message_info_set_flags (info, CAMEL_MESSAGE_FOLDER_FLAGGED | CAMEL_MESSAGE_FOLDER_XEVCHANGE, 0);
 		g_clear_object (&info);
 	}
 
@@ -887,6 +959,112 @@ mbox_summary_sync_quick (CamelMboxSummary *mbs,
 	return -1;
 }
 
+/* When all the messages to be expunged are stored at the end of the file,
+ * after all the messages which stay, then the file is only truncated, instead
+ * of being rewritten. Returns 1 when the messages had been expunged this way,
+ * 0 when a full sync is needed and -1 on error. */
+static gint
+mbox_summary_expunge_tail (CamelMboxSummary *mbs,
+                           CamelFolderChangeInfo *changeinfo,
+                           GError **error)
+{
+	CamelLocalSummary *cls = (CamelLocalSummary *) mbs;
+	CamelFolderSummary *s = (CamelFolderSummary *) mbs;
+	CamelMessageInfo *info;
+	GPtrArray *known_uids;
+	GPtrArray *delete_uids;
+	goffset frompos = -1;
+	guint ii, first_deleted = G_MAXUINT;
+	gint fd;
+
+	camel_folder_summary_prepare_fetch_all (s, NULL);
+	known_uids = camel_folder_summary_dup_uids (s);
+	if (!known_uids || !known_uids->len) {
+		g_clear_pointer (&known_uids, g_ptr_array_unref);
+		return 0;
+	}
+
+	g_ptr_array_sort_with_data (known_uids, cms_sort_frompos, mbs);
+
+	for (ii = 0; ii < known_uids->len; ii++) {
+		gboolean deleted;
+
+		info = camel_folder_summary_get (s, g_ptr_array_index (known_uids, ii));
+		if (!info)
+			continue;
+
+		deleted = (camel_message_info_get_flags (info) & CAMEL_MESSAGE_DELETED) != 0;
+		if (deleted && first_deleted == G_MAXUINT) {
+			first_deleted = ii;
+			frompos = camel_mbox_message_info_get_offset (CAMEL_MBOX_MESSAGE_INFO (info));
+		}
+
+		g_clear_object (&info);
+
+		/* a message stays after a deleted message */
+		if (!deleted && first_deleted != G_MAXUINT)
+			break;
+	}
+
+	if (first_deleted == G_MAXUINT || ii < known_uids->len || frompos <= 0) {
+		g_ptr_array_unref (known_uids);
+		return 0;
+	}
+
+	d (printf ("Truncating %s at %" G_GINT64_FORMAT "\n", cls->folder_path, (gint64) frompos));
+
+	fd = g_open (cls->folder_path, O_LARGEFILE | O_RDWR | O_BINARY, 0);
+	if (fd == -1 || ftruncate (fd, frompos) == -1) {
+		g_set_error (
+			error, G_IO_ERROR,
+			g_io_error_from_errno (errno),
+			_("Could not store folder: %s"),
+			g_strerror (errno));
+		if (fd != -1)
+			close (fd);
+		g_ptr_array_unref (known_uids);
+		return -1;
+	}
+
+	close (fd);
+
+	delete_uids = g_ptr_array_new_with_free_func ((GDestroyNotify) camel_pstring_free);
+
+	for (ii = first_deleted; ii < known_uids->len; ii++) {
+		const gchar *uid;
+
+		info = camel_folder_summary_get (s, g_ptr_array_index (known_uids, ii));
+		if (!info)
+			continue;
+
+		uid = camel_message_info_get_uid (info);
+
+		if (cls->index)
+			camel_index_delete_name (cls->index, uid);
+
+		camel_folder_change_info_remove_uid (changeinfo, uid);
+		g_ptr_array_add (delete_uids, (gpointer) camel_pstring_strdup (uid));
+		camel_folder_summary_remove (s, info);
+		g_clear_object (&info);
+	}
+
+	if (delete_uids->len) {
+		CamelStore *parent_store;
+		const gchar *full_name;
+
+		full_name = camel_folder_get_full_name (camel_folder_summary_get_folder (s));
+		parent_store = camel_folder_get_parent_store (camel_folder_summary_get_folder (s));
+		camel_store_db_delete_messages (camel_store_get_db (parent_store), full_name, delete_uids, NULL);
+	}
+
+	g_ptr_array_unref (delete_uids);
+	g_ptr_array_unref (known_uids);
+
+	camel_folder_summary_header_save (s, NULL);
+
+	return 1;
+}
+
 static gint
 mbox_summary_sync (CamelLocalSummary *cls,
                    gboolean expunge,
@@ -901,6 +1079,7 @@ mbox_summary_sync (CamelLocalSummary *cls,
 	const gchar *full_name;
 	gint i;
 	gint quick = TRUE, work = FALSE;
+	gboolean need_expunge = FALSE;
 	gint ret;
 	GPtrArray *summary = NULL;
 
@@ -921,8 +1100,11 @@ mbox_summary_sync (CamelLocalSummary *cls,
 	for (i = 0; i < summary->len; i++) {
 		CamelMessageInfo *info = camel_folder_summary_get (s, summary->pdata[i]);
 
-		if ((expunge && (camel_message_info_get_flags (info) & CAMEL_MESSAGE_DELETED) != 0) ||
-		    (camel_message_info_get_flags (info) & (CAMEL_MESSAGE_FOLDER_NOXEV | CAMEL_MESSAGE_FOLDER_XEVCHANGE)) != 0)
+		/* changed Status and X-Status headers are updated in place by the quick sync,
+		   only missing X-Evolution headers require the file to be rewritten */
+		if (expunge && (camel_message_info_get_flags (info) & CAMEL_MESSAGE_DELETED) != 0)
+			need_expunge = TRUE;
+		else if ((camel_message_info_get_flags (info) & CAMEL_MESSAGE_FOLDER_NOXEV) != 0)
 			quick = FALSE;
 		else
 			work |= camel_message_info_get_folder_flagged (info);
@@ -931,7 +1113,7 @@ mbox_summary_sync (CamelLocalSummary *cls,
 
 	g_ptr_array_free (summary, TRUE);
 
-	if (quick && expunge) {
+	if (quick && expunge && !need_expunge) {
 		guint32 dcount = 0;
 
 		if (!camel_store_db_count_messages (camel_store_get_db (parent_store), full_name, CAMEL_STORE_DB_COUNT_KIND_DELETED, &dcount, error)) {
@@ -939,6 +1121,16 @@ mbox_summary_sync (CamelLocalSummary *cls,
 			return -1;
 		}
 		if (dcount)
+			need_expunge = TRUE;
+	}
+
+	if (quick && need_expunge) {
+		ret = mbox_summary_expunge_tail (mbs, changeinfo, error);
+		if (ret == -1) {
+			camel_folder_summary_unlock (s);
+			return -1;
+		}
+		if (ret == 0)
 			quick = FALSE;
 	}
 
@@ -984,6 +1176,89 @@ mbox_summary_sync (CamelLocalSummary *cls,
 	return ret;
 }
 
+/* Copies @length bytes from the beginning of @fd into @fdout, or everything
+ * when the @length is -1, without parsing the content. */
+static gboolean
+mbox_summary_copy_raw (gint fd,
+                       gint fdout,
+                       goffset length,
+                       GCancellable *cancellable,
+                       GError **error)
+{
+	const gsize buffer_size = 256 * 1024;
+	gchar *buffer;
+	gboolean success = TRUE;
+
+	if (lseek (fd, 0, SEEK_SET) == (off_t) -1) {
+		g_set_error (
+			error, G_IO_ERROR,
+			g_io_error_from_errno (errno),
+			_("Could not store folder: %s"),
+			g_strerror (errno));
+		return FALSE;
+	}
+
+	buffer = g_malloc (buffer_size);
+
+	while (success && length != 0) {
+		gssize n_read, n_written, wrote = 0;
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			success = FALSE;
+			break;
+		}
+
+		do {
+			n_read = read (fd, buffer, length < 0 ? buffer_size : MIN (length, buffer_size));
+		} while (n_read == -1 && errno == EINTR);
+
+		if (n_read == -1) {
+			g_set_error (
+				error, G_IO_ERROR,
+				g_io_error_from_errno (errno),
+				_("Could not store folder: %s"),
+				g_strerror (errno));
+			success = FALSE;
+			break;
+		}
+
+		if (n_read == 0) {
+			if (length > 0) {
+				g_set_error (
+					error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
+					_("Summary and folder mismatch, even after a sync"));
+				success = FALSE;
+			}
+			break;
+		}
+
+		while (wrote < n_read) {
+			do {
+				n_written = write (fdout, buffer + wrote, n_read - wrote);
+			} while (n_written == -1 && errno == EINTR);
+
+			if (n_written <= 0) {
+				g_set_error (
+					error, G_IO_ERROR,
+					g_io_error_from_errno (errno),
+					_("Writing to temporary mailbox failed: %s"),
+					g_strerror (errno));
+				success = FALSE;
+				break;
+			}
+
+			wrote += n_written;
+		}
+
+		if (length > 0)
+			length -= n_read;
+	}
+
+	g_free (buffer);
+
+	return success;
+}
+
 gint
 camel_mbox_summary_sync_mbox (CamelMboxSummary *cls,
                               guint32 flags,
@@ -1006,14 +1281,64 @@ camel_mbox_summary_sync_mbox (CamelMboxSummary *cls,
 	GPtrArray *delete_uids = NULL;
 	GPtrArray *known_uids = NULL;
 	gchar statnew[8], xstatnew[8];
+	goffset unchanged_len = 0;
 
 	d (printf ("performing full summary/sync\n"));
 
 	camel_folder_summary_lock (s);
 
+	camel_folder_summary_prepare_fetch_all (s, NULL);
+	known_uids = camel_folder_summary_dup_uids (s);
+	/* walk them in the same order as stored in the file */
+	if (known_uids && known_uids->len)
+		g_ptr_array_sort_with_data (known_uids, cms_sort_frompos, mbs);
+
+	/* the messages before the first one, which is to be removed or its
+	   headers changed, are copied as they are, without parsing them */
+	for (i = 0; known_uids && i < known_uids->len && lseek (fdout, 0, SEEK_CUR) == 0; i++) {
+		guint32 info_flags;
+
+		info = camel_folder_summary_get (s, g_ptr_array_index (known_uids, i));
+		if (!info)
+			continue;
+
+		info_flags = camel_message_info_get_flags (info);
+		if ((info_flags & (CAMEL_MESSAGE_FOLDER_NOXEV | CAMEL_MESSAGE_FOLDER_FLAGGED)) != 0 ||
+		    ((flags & 1) && (info_flags & CAMEL_MESSAGE_DELETED) != 0)) {
+			unchanged_len = camel_mbox_message_info_get_offset (CAMEL_MBOX_MESSAGE_INFO (info));
+			g_clear_object (&info);
+			break;
+		}
+
+		g_clear_object (&info);
+	}
+
+	if (known_uids && i == known_uids->len && i > 0)
+		unchanged_len = -1;
+
+	if (unchanged_len > 0 || unchanged_len == -1) {
+		d (printf ("copying %" G_GINT64_FORMAT " unchanged bytes\n", (gint64) unchanged_len));
+
+		if (!mbox_summary_copy_raw (fd, fdout, unchanged_len, cancellable, error)) {
+			g_clear_pointer (&known_uids, g_ptr_array_unref);
+			camel_folder_summary_unlock (s);
+			return -1;
+		}
+
+		/* nothing to change, the whole file had been copied */
+		if (unchanged_len == -1) {
+			g_clear_pointer (&known_uids, g_ptr_array_unref);
+			camel_folder_summary_unlock (s);
+			return 0;
+		}
+	} else {
+		i = 0;
+	}
+
 	/* need to dup this because the mime-parser owns the fd after we give it to it */
 	fd = dup (fd);
 	if (fd == -1) {
+		g_clear_pointer (&known_uids, g_ptr_array_unref);
 		camel_folder_summary_unlock (s);
 		g_set_error (
 			error, G_IO_ERROR,
@@ -1027,13 +1352,10 @@ camel_mbox_summary_sync_mbox (CamelMboxSummary *cls,
 	camel_mime_parser_scan_from (mp, TRUE);
 	camel_mime_parser_scan_pre_from (mp, TRUE);
 	camel_mime_parser_init_with_fd (mp, fd);
+	if (unchanged_len > 0)
+		camel_mime_parser_seek (mp, unchanged_len, SEEK_SET);
 
-	camel_folder_summary_prepare_fetch_all (s, NULL);
-	known_uids = camel_folder_summary_dup_uids (s);
-	/* walk them in the same order as stored in the file */
-	if (known_uids && known_uids->len)
-		g_ptr_array_sort_with_data (known_uids, cms_sort_frompos, mbs);
-	for (i = 0; known_uids && i < known_uids->len; i++) {
+	for (; known_uids && i < known_uids->len; i++) {
 		gint pc = (i + 1) * 100 / known_uids->len;
 		goffset frompos;
 
@@ -1122,8 +1444,8 @@ camel_mbox_summary_sync_mbox (CamelMboxSummary *cls,
 			if (mbs->xstatus) {
 				guint32 info_flags = camel_message_info_get_flags (info);
 
-				encode_status (info_flags & STATUS_STATUS, statnew);
-				encode_status (info_flags & STATUS_XSTATUS, xstatnew);
+				encode_status_padded (info_flags, STATUS_STATUS, statnew);
+				encode_status_padded (info_flags, STATUS_XSTATUS, xstatnew);
 
 				len = camel_local_summary_write_headers (fdout, header, xevnew, statnew, xstatnew);
 			} else {
@@ -1245,9 +1567,9 @@ mbox_summary_add (CamelLocalSummary *cls,
 		guint32 flags = camel_message_info_get_flags (mi);
 
 		/* we snoop and add status/x-status headers to suit */
-		encode_status (flags & STATUS_STATUS, status);
+		encode_status_padded (flags, STATUS_STATUS, status);
 		camel_medium_set_header ((CamelMedium *) msg, "Status", status);
-		encode_status (flags & STATUS_XSTATUS, status);
+		encode_status_padded (flags, STATUS_XSTATUS, status);
 		camel_medium_set_header ((CamelMedium *) msg, "X-Status", status);
 	}
 
@@ -1279,6 +1601,28 @@ encode_status (guint32 flags,
 	*p = '\0';
 }
 
+/* Same as encode_status(), but the value is padded with spaces to the widest
+ * value the @mask can produce, thus any later flag change fits into the header
+ * and can be written in place by mbox_summary_sync_quick(). */
+static void
+encode_status_padded (guint32 flags,
+                      guint32 mask,
+                      gchar status[8])
+{
+	gsize i, len, width = 1;
+
+	encode_status (flags & mask, status);
+
+	for (i = 0; i < G_N_ELEMENTS (status_flags); i++)
+		if (status_flags[i].flag & mask)
+			width++;
+
+	len = strlen (status);
+	while (len < width)
+		status[len++] = ' ';
+	status[len] = '\0';
+}
+
 static guint32
 decode_status (const gchar *status)
 {
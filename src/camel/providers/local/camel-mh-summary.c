@@ -33,7 +33,7 @@ static gint mh_summary_decode_x_evolution (CamelLocalSummary *cls, const gchar *
 static gchar *mh_summary_next_uid_string (CamelFolderSummary *s);
 
 struct _CamelMhSummaryPrivate {
-	gchar *current_uid;
+	gint placeholder;  /* allow for future expansion */
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (CamelMhSummary, camel_mh_summary, CAMEL_TYPE_LOCAL_SUMMARY)
@@ -100,16 +100,17 @@ camel_mh_summary_new (CamelFolder *folder,
 static gchar *
 mh_summary_next_uid_string (CamelFolderSummary *s)
 {
-	CamelMhSummary *mhs = (CamelMhSummary *) s;
 	CamelLocalSummary *cls = (CamelLocalSummary *) s;
+	const gchar *current_uid;
 	gint fd = -1;
 	guint32 uid;
 	gchar *name;
 	gchar *uidstr;
 
 	/* if we are working to add an existing file, then use current_uid */
-	if (mhs->priv->current_uid) {
-		uidstr = g_strdup (mhs->priv->current_uid);
+	current_uid = camel_local_summary_get_current_file ();
+	if (current_uid) {
+		uidstr = g_strdup (current_uid);
 		/* tell the summary of this, so we always append numbers to the end */
 		camel_folder_summary_set_next_uid (s, strtoul (uidstr, NULL, 10) + 1);
 	} else {
@@ -139,7 +140,6 @@ camel_mh_summary_add (CamelLocalSummary *cls,
 {
 	CamelMessageInfo *info;
 	CamelFolderSummary *summary;
-	CamelMhSummary *mhs = (CamelMhSummary *) cls;
 	gchar *filename = g_strdup_printf ("%s/%s", cls->folder_path, name);
 	gint fd;
 	CamelMimeParser *mp;
@@ -165,14 +165,14 @@ camel_mh_summary_add (CamelLocalSummary *cls,
 		cls->index_force = FALSE;
 		camel_folder_summary_set_index (summary, NULL);
 	}
-	mhs->priv->current_uid = (gchar *) name;
+	camel_local_summary_set_current_file (name);
 
 	info = camel_folder_summary_info_new_from_parser (summary, mp);
 	camel_folder_summary_add (summary, info, FALSE);
 	g_clear_object (&info);
 
 	g_object_unref (mp);
-	mhs->priv->current_uid = NULL;
+	camel_local_summary_set_current_file (NULL);
 	camel_folder_summary_set_index (summary, NULL);
 	cls->index_force = FALSE;
 	g_free (filename);
@@ -191,6 +191,20 @@ remove_summary (gchar *key,
 	g_clear_object (&info);
 }
 
+static gint
+mh_summary_compare_names (gconstpointer ptr1,
+			  gconstpointer ptr2)
+{
+	const gchar *name1 = *((const gchar **) ptr1);
+	const gchar *name2 = *((const gchar **) ptr2);
+	guint64 uid1, uid2;
+
+	uid1 = g_ascii_strtoull (name1, NULL, 10);
+	uid2 = g_ascii_strtoull (name2, NULL, 10);
+
+	return uid1 < uid2 ? -1 : uid1 > uid2 ? 1 : 0;
+}
+
 static gint
 mh_summary_check (CamelLocalSummary *cls,
                   CamelFolderChangeInfo *changeinfo,
@@ -205,6 +219,7 @@ mh_summary_check (CamelLocalSummary *cls,
 	gint i;
 	gboolean forceindex;
 	GPtrArray *known_uids;
+	GPtrArray *to_add = NULL;
 
 	/* FIXME: Handle changeinfo */
 
@@ -235,6 +250,11 @@ mh_summary_check (CamelLocalSummary *cls,
 	}
 	g_clear_pointer (&known_uids, g_ptr_array_unref);
 
+	/* new messages are summarised at once, after the directory is read,
+	   which can use worker threads, when not indexing the body */
+	if (!cls->index)
+		to_add = g_ptr_array_new_with_free_func (g_free);
+
 	while ((d = readdir (dir))) {
 		/* FIXME: also run stat to check for regular file */
 		p = d->d_name;
@@ -246,6 +266,11 @@ mh_summary_check (CamelLocalSummary *cls,
 			info = camel_folder_summary_get ((CamelFolderSummary *) cls, d->d_name);
 			if (info == NULL || (cls->index && (!camel_index_has_name (cls->index, d->d_name)))) {
 				/* need to add this file to the summary */
+				if (info == NULL && to_add) {
+					g_ptr_array_add (to_add, g_strdup (d->d_name));
+					continue;
+				}
+
 				if (info != NULL) {
 					CamelMessageInfo *old = g_hash_table_lookup (left, camel_message_info_get_uid (info));
 
@@ -271,6 +296,13 @@ mh_summary_check (CamelLocalSummary *cls,
 		}
 	}
 	closedir (dir);
+
+	if (to_add) {
+		g_ptr_array_sort (to_add, mh_summary_compare_names);
+		camel_local_summary_add_files (cls, cls->folder_path, to_add, NULL, cancellable);
+		g_ptr_array_unref (to_add);
+	}
+
 	g_hash_table_foreach (left, (GHFunc) remove_summary, cls);
 	g_hash_table_destroy (left);
 
@@ -339,7 +371,7 @@ mh_summary_decode_x_evolution (CamelLocalSummary *cls,
                                CamelMessageInfo *info)
 {
 	CamelLocalSummaryClass *local_summary_class;
-	CamelMhSummary *mh_summary;
+	const gchar *current_uid;
 	gint ret;
 
 	local_summary_class = CAMEL_LOCAL_SUMMARY_CLASS (camel_mh_summary_parent_class);
@@ -349,9 +381,9 @@ mh_summary_decode_x_evolution (CamelLocalSummary *cls,
 		return ret;
 
 	/* do not use UID from the header, rather use the one provided, if any */
-	mh_summary = CAMEL_MH_SUMMARY (cls);
-	if (mh_summary->priv->current_uid) {
-		camel_message_info_set_uid (info, mh_summary->priv->current_uid);
+	current_uid = camel_local_summary_get_current_file ();
+	if (current_uid) {
+		camel_message_info_set_uid (info, current_uid);
 	}
 
 	return ret;
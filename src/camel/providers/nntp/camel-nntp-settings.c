@@ -12,6 +12,7 @@ struct _CamelNNTPSettingsPrivate {
 	gboolean short_folder_names;
 	gboolean use_limit_latest;
 	guint limit_latest;
+	guint overview_connections;
 };
 
 enum {
@@ -23,6 +24,7 @@ enum {
 	PROP_SHORT_FOLDER_NAMES,
 	PROP_USE_LIMIT_LATEST,
 	PROP_LIMIT_LATEST,
+	PROP_OVERVIEW_CONNECTIONS,
 	N_PROPS,
 
 	PROP_AUTH_MECHANISM,
@@ -97,6 +99,12 @@ nntp_settings_set_property (GObject *object,
 				g_value_get_uint (value));
 			return;
 
+		case PROP_OVERVIEW_CONNECTIONS:
+			camel_nntp_settings_set_overview_connections (
+				CAMEL_NNTP_SETTINGS (object),
+				g_value_get_uint (value));
+			return;
+
 		case PROP_PORT:
 			camel_network_settings_set_port (
 				CAMEL_NETWORK_SETTINGS (object),
@@ -188,6 +196,13 @@ nntp_settings_get_property (GObject *object,
 				CAMEL_NNTP_SETTINGS (object)));
 			return;
 
+		case PROP_OVERVIEW_CONNECTIONS:
+			g_value_set_uint (
+				value,
+				camel_nntp_settings_get_overview_connections (
+				CAMEL_NNTP_SETTINGS (object)));
+			return;
+
 		case PROP_PORT:
 			g_value_set_uint (
 				value,
@@ -288,6 +303,23 @@ camel_nntp_settings_class_init (CamelNNTPSettingsClass *class)
 			G_PARAM_EXPLICIT_NOTIFY |
 			G_PARAM_STATIC_STRINGS);
 
+	/**
+	 * CamelNNTPSettings:overview-connections
+	 *
+	 * How many connections to use to download the article overviews
+	 * of large groups; 1, the default, means to use only the main connection
+	 *
+	 * Since: 3.62
+	 **/
+	properties[PROP_OVERVIEW_CONNECTIONS] =
+		g_param_spec_uint (
+			"overview-connections", NULL, NULL,
+			1, 16, 1,
+			G_PARAM_READWRITE |
+			G_PARAM_CONSTRUCT |
+			G_PARAM_EXPLICIT_NOTIFY |
+			G_PARAM_STATIC_STRINGS);
+
 	/**
 	 * CamelNNTPSettings:short-folder-names
 	 *
@@ -663,3 +695,46 @@ camel_nntp_settings_set_limit_latest (CamelNNTPSettings *settings,
 
 	g_object_notify_by_pspec (G_OBJECT (settings), properties[PROP_LIMIT_LATEST]);
 }
+
+/**
+ * camel_nntp_settings_get_overview_connections:
+ * @settings: a #CamelNNTPSettings
+ *
+ * Returns: How many connections can be used to download the article overviews
+ *
+ * Since: 3.62
+ **/
+guint
+camel_nntp_settings_get_overview_connections (CamelNNTPSettings *settings)
+{
+	g_return_val_if_fail (CAMEL_IS_NNTP_SETTINGS (settings), 1);
+
+	return settings->priv->overview_connections;
+}
+
+/**
+ * camel_nntp_settings_set_overview_connections:
+ * @settings: a #CamelNNTPSettings
+ * @overview_connections: the value to set
+ *
+ * Sets how many connections can be used to download the article overviews
+ * of large groups. The value 1 means to use only the main connection.
+ * The value is clamped to the range from 1 to 16.
+ *
+ * Since: 3.62
+ **/
+void
+camel_nntp_settings_set_overview_connections (CamelNNTPSettings *settings,
+					      guint overview_connections)
+{
+	g_return_if_fail (CAMEL_IS_NNTP_SETTINGS (settings));
+
+	overview_connections = CLAMP (overview_connections, 1, 16);
+
+	if (settings->priv->overview_connections == overview_connections)
+		return;
+
+	settings->priv->overview_connections = overview_connections;
+
+	g_object_notify_by_pspec (G_OBJECT (settings), properties[PROP_OVERVIEW_CONNECTIONS]);
+}
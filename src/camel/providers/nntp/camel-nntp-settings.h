@@ -81,6 +81,11 @@ guint		camel_nntp_settings_get_limit_latest
 void		camel_nntp_settings_set_limit_latest
 					(CamelNNTPSettings *settings,
 					 guint limit_latest);
+guint		camel_nntp_settings_get_overview_connections
+					(CamelNNTPSettings *settings);
+void		camel_nntp_settings_set_overview_connections
+					(CamelNNTPSettings *settings,
+					 guint overview_connections);
 
 G_END_DECLS
 
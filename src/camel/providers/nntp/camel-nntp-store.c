@@ -36,6 +36,9 @@
 #define NNTP_PORT  119
 #define NNTPS_PORT 563
 
+/* the articles can be downloaded again, thus limit how much they can take */
+#define NNTP_CACHE_MAX_SIZE ((goffset) 512 * 1024 * 1024)
+
 #define DUMP_EXTENSIONS
 
 struct _CamelNNTPStorePrivate {
@@ -1500,9 +1503,11 @@ nntp_store_initable_init (GInitable *initable,
 	if (nntp_cache == NULL)
 		return FALSE;
 
-	/* Default cache expiry - 2 weeks old, or not visited in 5 days */
+	/* Default cache expiry - 2 weeks old, or not visited in 5 days,
+	 * or the least recently read articles over the size limit */
 	camel_data_cache_set_expire_age (nntp_cache, 60 * 60 * 24 * 14);
 	camel_data_cache_set_expire_access (nntp_cache, 60 * 60 * 24 * 5);
+	camel_data_cache_set_expire_size (nntp_cache, NNTP_CACHE_MAX_SIZE);
 
 	camel_binding_bind_property (nntp_store, "online",
 		nntp_cache, "expire-enabled",
@@ -2007,16 +2012,14 @@ camel_nntp_store_remove_capabilities (CamelNNTPStore *nntp_store,
 	g_mutex_unlock (&nntp_store->priv->property_lock);
 }
 
-/* Enter owning lock */
-gint
-camel_nntp_raw_commandv (CamelNNTPStore *nntp_store,
-                         GCancellable *cancellable,
-                         GError **error,
-                         gchar **line,
-                         const gchar *fmt,
-                         va_list ap)
+static gint
+nntp_stream_raw_commandv (CamelNNTPStream *nntp_stream,
+                          GCancellable *cancellable,
+                          GError **error,
+                          gchar **line,
+                          const gchar *fmt,
+                          va_list ap)
 {
-	CamelNNTPStream *nntp_stream;
 	GString *buffer;
 	const guchar *p, *ps;
 	guchar c;
@@ -2024,7 +2027,6 @@ camel_nntp_raw_commandv (CamelNNTPStore *nntp_store,
 	gint d;
 	guint u, u2;
 
-	nntp_stream = camel_nntp_store_ref_stream (nntp_store);
 	g_return_val_if_fail (nntp_stream != NULL, -1);
 	g_return_val_if_fail (nntp_stream->mode != CAMEL_NNTP_STREAM_DATA, -1);
 
@@ -2087,7 +2089,8 @@ camel_nntp_raw_commandv (CamelNNTPStore *nntp_store,
 	if (camel_stream_write (
 		CAMEL_STREAM (nntp_stream),
 		buffer->str, buffer->len,
-		cancellable, error) == -1)
+		cancellable, error) == -1 ||
+	    camel_stream_flush (CAMEL_STREAM (nntp_stream), cancellable, error) == -1)
 		goto ioerror;
 
 	if (camel_nntp_stream_line (nntp_stream, (guchar **) line, &u, cancellable, error) == -1)
@@ -2106,12 +2109,33 @@ ioerror:
 	u = -1;
 
 exit:
-	g_clear_object (&nntp_stream);
 	g_string_free (buffer, TRUE);
 
 	return u;
 }
 
+/* Enter owning lock */
+gint
+camel_nntp_raw_commandv (CamelNNTPStore *nntp_store,
+                         GCancellable *cancellable,
+                         GError **error,
+                         gchar **line,
+                         const gchar *fmt,
+                         va_list ap)
+{
+	CamelNNTPStream *nntp_stream;
+	gint ret;
+
+	nntp_stream = camel_nntp_store_ref_stream (nntp_store);
+	g_return_val_if_fail (nntp_stream != NULL, -1);
+
+	ret = nntp_stream_raw_commandv (nntp_stream, cancellable, error, line, fmt, ap);
+
+	g_clear_object (&nntp_stream);
+
+	return ret;
+}
+
 gint
 camel_nntp_raw_command (CamelNNTPStore *nntp_store,
                         GCancellable *cancellable,
@@ -2131,6 +2155,299 @@ camel_nntp_raw_command (CamelNNTPStore *nntp_store,
 	return ret;
 }
 
+/**
+ * camel_nntp_raw_stream_command:
+ * @nntp_stream: a #CamelNNTPStream
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ * @line: (out): return location for the response line
+ * @fmt: a command format
+ * @...: arguments for the @fmt
+ *
+ * The same as camel_nntp_raw_command(), only it runs the command
+ * in the @nntp_stream, which is not the main connection of the store,
+ * like the one returned by camel_nntp_store_open_overview_stream().
+ *
+ * Returns: the response code, or -1 on error
+ *
+ * Since: 3.62
+ **/
+gint
+camel_nntp_raw_stream_command (CamelNNTPStream *nntp_stream,
+                               GCancellable *cancellable,
+                               GError **error,
+                               gchar **line,
+                               const gchar *fmt,
+                               ...)
+{
+	gint ret;
+	va_list ap;
+
+	va_start (ap, fmt);
+	ret = nntp_stream_raw_commandv (
+		nntp_stream, cancellable, error, line, fmt, ap);
+	va_end (ap);
+
+	return ret;
+}
+
+static CamelNNTPStream *
+nntp_store_stream_new (GIOStream *base_stream)
+{
+	CamelNNTPStream *nntp_stream;
+	CamelStream *stream;
+
+	stream = camel_stream_new (base_stream);
+	nntp_stream = camel_nntp_stream_new (stream);
+	g_object_unref (stream);
+
+	return nntp_stream;
+}
+
+/* Wraps the @base_stream into a raw DEFLATE stream, as defined by RFC 8054;
+   the base stream is kept alive by the returned stream. */
+static GIOStream *
+nntp_store_compress_stream_new (GIOStream *base_stream)
+{
+	GZlibCompressor *compressor;
+	GZlibDecompressor *decompressor;
+	GInputStream *input;
+	GOutputStream *output;
+	GIOStream *io_stream;
+
+	compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW, -1);
+	decompressor = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW);
+
+	input = g_converter_input_stream_new (g_io_stream_get_input_stream (base_stream), G_CONVERTER (decompressor));
+	output = g_converter_output_stream_new (g_io_stream_get_output_stream (base_stream), G_CONVERTER (compressor));
+
+	io_stream = g_simple_io_stream_new (input, output);
+	g_object_set_data_full (G_OBJECT (io_stream), "nntp-base-stream", g_object_ref (base_stream), g_object_unref);
+
+	g_object_unref (input);
+	g_object_unref (output);
+	g_object_unref (compressor);
+	g_object_unref (decompressor);
+
+	return io_stream;
+}
+
+static gboolean
+nntp_stream_can_compress (CamelNNTPStream *nntp_stream,
+                          GCancellable *cancellable,
+                          GError **error)
+{
+	gboolean can_compress = FALSE;
+	gchar *line;
+	guint len;
+	gint ret;
+
+	ret = camel_nntp_raw_stream_command (nntp_stream, cancellable, error, &line, "CAPABILITIES");
+	if (ret != 101)
+		return FALSE;
+
+	while ((ret = camel_nntp_stream_line (nntp_stream, (guchar **) &line, &len, cancellable, error)) > 0) {
+		if (len == 1 && *line == '.')
+			break;
+
+		if (g_ascii_strncasecmp (line, "COMPRESS ", 9) == 0) {
+			gchar **algorithms;
+			guint ii;
+
+			algorithms = g_strsplit (line + 9, " ", -1);
+			for (ii = 0; algorithms[ii] && !can_compress; ii++) {
+				can_compress = g_ascii_strcasecmp (algorithms[ii], "DEFLATE") == 0;
+			}
+			g_strfreev (algorithms);
+		}
+	}
+
+	return ret != -1 && can_compress;
+}
+
+/**
+ * camel_nntp_store_open_overview_stream:
+ * @nntp_store: a #CamelNNTPStore
+ * @group: a newsgroup to select
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Opens an additional connection to the server, independent from the main
+ * connection of the @nntp_store, authenticates it when needed and selects
+ * the @group in it. It is used to download article overviews of large groups
+ * in parallel. The DEFLATE compression (RFC 8054) is enabled on the connection
+ * when the server offers it. Run commands in it with camel_nntp_raw_stream_command().
+ *
+ * This can be called from a dedicated thread.
+ *
+ * Returns: (transfer full) (nullable): a new #CamelNNTPStream, or %NULL on error
+ *
+ * Since: 3.62
+ **/
+CamelNNTPStream *
+camel_nntp_store_open_overview_stream (CamelNNTPStore *nntp_store,
+                                       const gchar *group,
+                                       GCancellable *cancellable,
+                                       GError **error)
+{
+	CamelNNTPStream *nntp_stream = NULL;
+	CamelNetworkSettings *network_settings;
+	CamelNetworkSecurityMethod method;
+	CamelSettings *settings;
+	GIOStream *base_stream;
+	gchar *host, *user, *mechanism;
+	gchar *line = NULL;
+	guint len;
+	gint ret;
+
+	g_return_val_if_fail (CAMEL_IS_NNTP_STORE (nntp_store), NULL);
+	g_return_val_if_fail (group != NULL, NULL);
+
+	settings = camel_service_ref_settings (CAMEL_SERVICE (nntp_store));
+
+	network_settings = CAMEL_NETWORK_SETTINGS (settings);
+	host = camel_network_settings_dup_host (network_settings);
+	user = camel_network_settings_dup_user (network_settings);
+	method = camel_network_settings_get_security_method (network_settings);
+	mechanism = camel_network_settings_dup_auth_mechanism (network_settings);
+
+	g_object_unref (settings);
+
+	base_stream = camel_network_service_connect_sync (
+		CAMEL_NETWORK_SERVICE (nntp_store), cancellable, error);
+
+	if (!base_stream)
+		goto exit;
+
+	nntp_stream = nntp_store_stream_new (base_stream);
+
+	if (camel_nntp_stream_line (nntp_stream, (guchar **) &line, &len, cancellable, error) == -1) {
+		g_prefix_error (
+			error, _("Could not read greeting from %s: "), host);
+		goto fail;
+	}
+
+	ret = strtoul (line, &line, 10);
+	if (ret != NNTP_GREETING_POSTING_OK && ret != NNTP_GREETING_NO_POSTING) {
+		while (line && g_ascii_isspace (*line))
+			line++;
+
+		g_set_error (
+			error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
+			_("NNTP server %s returned error code %d: %s"),
+			host, ret, line);
+		goto fail;
+	}
+
+	if (method == CAMEL_NETWORK_SECURITY_METHOD_STARTTLS_ON_STANDARD_PORT) {
+		GIOStream *tls_stream;
+
+		ret = camel_nntp_raw_stream_command (nntp_stream, cancellable, error, &line, "STARTTLS");
+		if (ret == -1) {
+			g_prefix_error (
+				error,
+				_("Failed to issue STARTTLS for NNTP server %s: "),
+				host);
+			goto fail;
+		}
+
+		if (ret != 382) {
+			g_set_error (
+				error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
+				_("NNTP server %s doesn’t support STARTTLS: %s"),
+				host, line);
+			goto fail;
+		}
+
+		tls_stream = camel_network_service_starttls (CAMEL_NETWORK_SERVICE (nntp_store), base_stream, error);
+		if (!tls_stream) {
+			g_prefix_error (
+				error,
+				_("Failed to connect to NNTP server %s in secure mode: "),
+				host);
+			goto fail;
+		}
+
+		g_object_unref (base_stream);
+		base_stream = tls_stream;
+
+		g_object_unref (nntp_stream);
+		nntp_stream = nntp_store_stream_new (base_stream);
+	}
+
+	/* the same condition as in connect_to_server() */
+	if ((user != NULL && *user != '\0' && (!mechanism || !*mechanism)) ||
+	    (mechanism && *mechanism && g_strcmp0 (mechanism, "ANONYMOUS") != 0)) {
+		gchar *password;
+
+		password = camel_service_dup_password (CAMEL_SERVICE (nntp_store));
+
+		ret = camel_nntp_raw_stream_command (nntp_stream, cancellable, error, &line, "authinfo user %s", user ? user : "");
+		if (ret == NNTP_AUTH_CONTINUE && password)
+			ret = camel_nntp_raw_stream_command (nntp_stream, cancellable, error, &line, "authinfo pass %s", password);
+
+		g_free (password);
+
+		if (ret == -1)
+			goto fail;
+
+		if (ret != NNTP_AUTH_ACCEPTED) {
+			g_set_error (
+				error, CAMEL_SERVICE_ERROR,
+				CAMEL_SERVICE_ERROR_CANT_AUTHENTICATE,
+				_("Failed to authenticate to NNTP server %s: %s"),
+				host, line);
+			goto fail;
+		}
+	}
+
+	/* ignore the return code, the same as the main connection does */
+	if (camel_nntp_raw_stream_command (nntp_stream, cancellable, error, &line, "mode reader") == -1)
+		goto fail;
+
+	if (nntp_stream_can_compress (nntp_stream, cancellable, NULL)) {
+		ret = camel_nntp_raw_stream_command (nntp_stream, cancellable, error, &line, "COMPRESS DEFLATE");
+		if (ret == -1)
+			goto fail;
+
+		if (ret == 206) {
+			GIOStream *compress_stream;
+
+			compress_stream = nntp_store_compress_stream_new (base_stream);
+
+			g_object_unref (base_stream);
+			base_stream = compress_stream;
+
+			g_object_unref (nntp_stream);
+			nntp_stream = nntp_store_stream_new (base_stream);
+		}
+	}
+
+	ret = camel_nntp_raw_stream_command (nntp_stream, cancellable, error, &line, "group %s", group);
+	if (ret == -1)
+		goto fail;
+
+	if (ret != NNTP_GROUP_SELECTED) {
+		g_set_error (
+			error, CAMEL_FOLDER_ERROR, CAMEL_FOLDER_ERROR_INVALID,
+			_("Cannot get group: %s"), line);
+		goto fail;
+	}
+
+	goto exit;
+
+fail:
+	g_clear_object (&nntp_stream);
+
+exit:
+	g_clear_object (&base_stream);
+	g_free (host);
+	g_free (user);
+	g_free (mechanism);
+
+	return nntp_stream;
+}
+
 /* use this where you also need auth to be handled, i.e. most cases where you'd try raw command */
 gint
 camel_nntp_raw_command_auth (CamelNNTPStore *nntp_store,
@@ -121,6 +121,18 @@ gint		camel_nntp_command		(CamelNNTPStore *nntp_store,
 						 gchar **line,
 						 const gchar *fmt,
 						 ...);
+gint		camel_nntp_raw_stream_command	(CamelNNTPStream *nntp_stream,
+						 GCancellable *cancellable,
+						 GError **error,
+						 gchar **line,
+						 const gchar *fmt,
+						 ...);
+CamelNNTPStream *
+		camel_nntp_store_open_overview_stream
+						(CamelNNTPStore *nntp_store,
+						 const gchar *group,
+						 GCancellable *cancellable,
+						 GError **error);
 void		camel_nntp_store_maybe_schedule_idle_disconnect
 						(CamelNNTPStore *nntp_store);
 
@@ -205,8 +205,10 @@ nntp_stream_flush (CamelStream *stream,
                    GCancellable *cancellable,
                    GError **error)
 {
-	/* nop? */
-	return 0;
+	CamelNNTPStream *is = (CamelNNTPStream *) stream;
+
+	/* the compressed connections need to flush the pending output */
+	return camel_stream_flush (is->source, cancellable, error);
 }
 
 static gboolean
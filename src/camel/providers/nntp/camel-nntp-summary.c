@@ -16,6 +16,7 @@
 #include <glib/gi18n-lib.h>
 
 #include "camel-nntp-folder.h"
+#include "camel-nntp-resp-codes.h"
 #include "camel-nntp-settings.h"
 #include "camel-nntp-store.h"
 #include "camel-nntp-stream.h"
@@ -42,6 +43,7 @@ struct _CamelNNTPSummaryPrivate {
 #define NNTP_OVER_MAX_RETRIES   3
 #define NNTP_IDLE_TIMEOUT_SECS  30
 #define NNTP_SAVE_INTERVAL_USEC (15 * G_USEC_PER_SEC)
+#define NNTP_OVER_MAX_AHEAD     8 /* how many chunks the workers can fetch ahead of the parsing */
 
 static CamelMessageInfo * message_info_new_from_headers (CamelFolderSummary *, const CamelNameValueArray *);
 static gboolean summary_header_load (CamelFolderSummary *s, CamelStoreDBFolderRecord *record);
@@ -139,6 +141,84 @@ summary_header_save (CamelFolderSummary *s,
 
 /* ********************************************************************** */
 
+/* Parses one line of the OVER/XOVER response, in the store's overview format,
+   and adds a new article from it into the summary; the @line is modified */
+static void
+add_xover_line (CamelNNTPSummary *cns,
+                CamelNNTPStore *nntp_store,
+                gchar *line,
+                CamelNameValueArray *headers,
+                CamelFolderChangeInfo *changes,
+                gboolean folder_filter_recent)
+{
+	CamelFolderSummary *s;
+	gchar *tab;
+	guint n, size;
+	struct _xover_header *xover;
+
+	s = (CamelFolderSummary *) cns;
+
+	n = strtoul (line, &tab, 10);
+	if (*tab != '\t')
+		return;
+	tab++;
+	xover = nntp_store->xover;
+	size = 0;
+	for (; tab[0] && xover; xover = xover->next) {
+		line = tab;
+		tab = strchr (line, '\t');
+		if (tab)
+			*tab++ = 0;
+		else
+			tab = line + strlen (line);
+
+		/* do we care about this column? */
+		if (xover->name) {
+			line += xover->skip;
+			if (line < tab) {
+				camel_name_value_array_append (headers, xover->name, line);
+				switch (xover->type) {
+				case XOVER_STRING:
+					break;
+				case XOVER_MSGID:
+					cns->priv->uid = g_strdup_printf ("%u,%s", n, line);
+					break;
+				case XOVER_SIZE:
+					size = strtoul (line, NULL, 10);
+					break;
+				}
+			}
+		}
+	}
+
+	/* skip headers we don't care about, incase the server doesn't actually send some it said it would. */
+	while (xover && xover->name == NULL)
+		xover = xover->next;
+
+	/* truncated line? ignore? */
+	if (xover == NULL) {
+		if (!camel_folder_summary_check_uid (s, cns->priv->uid)) {
+			CamelMessageInfo *mi;
+
+			mi = camel_folder_summary_info_new_from_headers (s, headers);
+			camel_message_info_set_size (mi, size);
+			camel_folder_summary_add (s, mi, FALSE);
+
+			cns->high = n;
+			camel_folder_change_info_add_uid (changes, camel_message_info_get_uid (mi));
+			if (folder_filter_recent)
+				camel_folder_change_info_recent_uid (changes, camel_message_info_get_uid (mi));
+			g_clear_object (&mi);
+		} else if (cns->high < n) {
+			cns->high = n;
+		}
+	}
+
+	g_clear_pointer (&cns->priv->uid, g_free);
+
+	camel_name_value_array_clear (headers);
+}
+
 /* Note: This will be called from camel_nntp_command, so only use camel_nntp_raw_command */
 static gint
 add_range_xover (CamelNNTPSummary *cns,
@@ -158,14 +238,12 @@ add_range_xover (CamelNNTPSummary *cns,
 	CamelService *service;
 	CamelFolderSummary *s;
 	CamelNameValueArray *headers = NULL;
-	gchar *line, *tab;
+	gchar *line;
 	gchar *host;
 	guint len;
 	gint ret;
-	guint n, size;
 	guint old_timeout;
 	gboolean folder_filter_recent;
-	struct _xover_header *xover;
 
 	s = (CamelFolderSummary *) cns;
 	folder_filter_recent = camel_folder_summary_get_folder (s) &&
@@ -223,65 +301,7 @@ add_range_xover (CamelNNTPSummary *cns,
 		if (progress_total > 0)
 			camel_operation_progress (cancellable, ((*inout_progress_count) * 100) / progress_total);
 		(*inout_progress_count)++;
-		n = strtoul (line, &tab, 10);
-		if (*tab != '\t')
-			continue;
-		tab++;
-		xover = nntp_store->xover;
-		size = 0;
-		for (; tab[0] && xover; xover = xover->next) {
-			line = tab;
-			tab = strchr (line, '\t');
-			if (tab)
-				*tab++ = 0;
-			else
-				tab = line + strlen (line);
-
-			/* do we care about this column? */
-			if (xover->name) {
-				line += xover->skip;
-				if (line < tab) {
-					camel_name_value_array_append (headers, xover->name, line);
-					switch (xover->type) {
-					case XOVER_STRING:
-						break;
-					case XOVER_MSGID:
-						cns->priv->uid = g_strdup_printf ("%u,%s", n, line);
-						break;
-					case XOVER_SIZE:
-						size = strtoul (line, NULL, 10);
-						break;
-					}
-				}
-			}
-		}
-
-		/* skip headers we don't care about, incase the server doesn't actually send some it said it would. */
-		while (xover && xover->name == NULL)
-			xover = xover->next;
-
-		/* truncated line? ignore? */
-		if (xover == NULL) {
-			if (!camel_folder_summary_check_uid (s, cns->priv->uid)) {
-				CamelMessageInfo *mi;
-
-				mi = camel_folder_summary_info_new_from_headers (s, headers);
-				camel_message_info_set_size (mi, size);
-				camel_folder_summary_add (s, mi, FALSE);
-
-				cns->high = n;
-				camel_folder_change_info_add_uid (changes, camel_message_info_get_uid (mi));
-				if (folder_filter_recent)
-					camel_folder_change_info_recent_uid (changes, camel_message_info_get_uid (mi));
-				g_clear_object (&mi);
-			} else if (cns->high < n) {
-				cns->high = n;
-			}
-		}
-
-		g_clear_pointer (&cns->priv->uid, g_free);
-
-		camel_name_value_array_clear (headers);
+		add_xover_line (cns, nntp_store, line, headers, changes, folder_filter_recent);
 	}
 
 	camel_name_value_array_free (headers);
@@ -570,6 +590,306 @@ fetch_articles_chunked (CamelNNTPSummary *cns,
 	return ret;
 }
 
+typedef struct _OverviewChunk {
+	guint low;
+	guint high;
+	GPtrArray *lines;	/* gchar *, the OVER/XOVER response lines */
+	gboolean done;		/* the worker finished it, the lines are NULL on failure */
+} OverviewChunk;
+
+typedef struct _OverviewFetch {
+	GMutex lock;
+	GCond cond;
+
+	CamelNNTPStore *nntp_store;
+	const gchar *group;
+	GCancellable *cancellable;
+
+	OverviewChunk *chunks;
+	guint n_chunks;
+	guint next_chunk;	/* the first chunk not claimed yet */
+	guint n_parsed;		/* how many chunks had been added into the summary */
+} OverviewFetch;
+
+static void
+overview_fetch_cancelled_cb (GCancellable *cancellable,
+                             gpointer user_data)
+{
+	g_cancellable_cancel (user_data);
+}
+
+/* Reads the overviews of the articles between @low and @high in the worker connection */
+static GPtrArray *
+overview_fetch_range (OverviewFetch *fetch,
+                      CamelNNTPStream *nntp_stream,
+                      guint low,
+                      guint high,
+                      gboolean *inout_use_over,
+                      GError **error)
+{
+	GPtrArray *lines;
+	gchar *line = NULL;
+	guint len;
+	gint ret = -1;
+
+	if (*inout_use_over) {
+		ret = camel_nntp_raw_stream_command (
+			nntp_stream, fetch->cancellable, error,
+			&line, "over %r", low, high);
+		if (ret == -1)
+			return NULL;
+		if (ret != NNTP_DATA_FOLLOWS)
+			*inout_use_over = FALSE;
+	}
+
+	if (!*inout_use_over)
+		ret = camel_nntp_raw_stream_command (
+			nntp_stream, fetch->cancellable, error,
+			&line, "xover %r", low, high);
+
+	if (ret != NNTP_DATA_FOLLOWS) {
+		if (ret != -1)
+			g_set_error (
+				error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
+				_("Unexpected server response from xover: %s"), line);
+		return NULL;
+	}
+
+	lines = g_ptr_array_new_with_free_func (g_free);
+
+	while ((ret = camel_nntp_stream_line (nntp_stream, (guchar **) &line, &len, fetch->cancellable, error)) > 0) {
+		g_ptr_array_add (lines, g_strndup (line, len));
+	}
+
+	if (ret == -1)
+		g_clear_pointer (&lines, g_ptr_array_unref);
+
+	return lines;
+}
+
+static gpointer
+overview_fetch_thread (gpointer user_data)
+{
+	OverviewFetch *fetch = user_data;
+	CamelNNTPStream *nntp_stream;
+	GError *local_error = NULL;
+	gboolean use_over;
+
+	use_over = camel_nntp_store_has_capabilities (fetch->nntp_store, CAMEL_NNTP_CAPABILITY_OVER);
+
+	nntp_stream = camel_nntp_store_open_overview_stream (fetch->nntp_store, fetch->group, fetch->cancellable, &local_error);
+	if (nntp_stream) {
+		camel_nntp_stream_set_timeout (nntp_stream, NNTP_IDLE_TIMEOUT_SECS);
+	} else {
+		dd (printf ("%s: failed to open overview connection: %s\n", G_STRFUNC, local_error ? local_error->message : "Unknown error"));
+		g_clear_error (&local_error);
+	}
+
+	while (nntp_stream) {
+		OverviewChunk *chunk;
+		GPtrArray *lines;
+
+		g_mutex_lock (&fetch->lock);
+
+		/* do not get too far ahead, the fetched lines are held in memory */
+		while (fetch->next_chunk < fetch->n_chunks &&
+		       fetch->next_chunk >= fetch->n_parsed + NNTP_OVER_MAX_AHEAD &&
+		       !g_cancellable_is_cancelled (fetch->cancellable)) {
+			g_cond_wait (&fetch->cond, &fetch->lock);
+		}
+
+		if (fetch->next_chunk >= fetch->n_chunks ||
+		    g_cancellable_is_cancelled (fetch->cancellable)) {
+			g_mutex_unlock (&fetch->lock);
+			break;
+		}
+
+		chunk = &fetch->chunks[fetch->next_chunk];
+		fetch->next_chunk++;
+
+		g_mutex_unlock (&fetch->lock);
+
+		lines = overview_fetch_range (fetch, nntp_stream, chunk->low, chunk->high, &use_over, &local_error);
+
+		g_mutex_lock (&fetch->lock);
+		chunk->lines = lines;
+		chunk->done = TRUE;
+		g_cond_broadcast (&fetch->cond);
+		g_mutex_unlock (&fetch->lock);
+
+		/* the connection cannot be trusted after an error; the chunk
+		   is fetched again in the main connection */
+		if (!lines) {
+			dd (printf ("%s: failed to fetch overviews %u-%u: %s\n", G_STRFUNC, chunk->low, chunk->high, local_error ? local_error->message : "Unknown error"));
+			g_clear_error (&local_error);
+			g_clear_object (&nntp_stream);
+		}
+	}
+
+	if (nntp_stream) {
+		gchar *line = NULL;
+
+		camel_nntp_raw_stream_command (nntp_stream, NULL, NULL, &line, "quit");
+		g_clear_object (&nntp_stream);
+	}
+
+	/* to let the main thread claim the chunks this worker left */
+	g_mutex_lock (&fetch->lock);
+	g_cond_broadcast (&fetch->cond);
+	g_mutex_unlock (&fetch->lock);
+
+	return NULL;
+}
+
+/* Downloads the overviews in @n_connections connections: the additional
+   connections fetch the chunks ahead, while the main connection adds them
+   into the summary in the order of the article numbers. Any chunk, which
+   is not claimed by a worker or for which the worker failed, is fetched
+   in the main connection. */
+static gint
+fetch_articles_parallel (CamelNNTPSummary *cns,
+                         CamelNNTPStore *store,
+                         const gchar *full_name,
+                         guint target_high,
+                         guint n_connections,
+                         CamelFolderChangeInfo *changes,
+                         CamelFolderSummary *s,
+                         GCancellable *cancellable,
+                         GError **error)
+{
+	OverviewFetch fetch;
+	CamelNameValueArray *headers;
+	GThread **threads;
+	gboolean folder_filter_recent;
+	gulong cancelled_id = 0;
+	guint ii, n_threads;
+	guint progress_count = 0;
+	guint total_to_fetch;
+	gint64 last_save_time = g_get_monotonic_time ();
+	gint ret = 0;
+
+	folder_filter_recent = camel_folder_summary_get_folder (s) &&
+		(camel_folder_get_flags (camel_folder_summary_get_folder (s)) & CAMEL_FOLDER_FILTER_RECENT) != 0;
+
+	total_to_fetch = target_high - cns->high;
+
+	memset (&fetch, 0, sizeof (OverviewFetch));
+	g_mutex_init (&fetch.lock);
+	g_cond_init (&fetch.cond);
+	fetch.nntp_store = store;
+	fetch.group = full_name;
+	fetch.cancellable = g_cancellable_new ();
+	fetch.n_chunks = (total_to_fetch + NNTP_OVER_CHUNK_SIZE - 1) / NNTP_OVER_CHUNK_SIZE;
+	fetch.chunks = g_new0 (OverviewChunk, fetch.n_chunks);
+
+	for (ii = 0; ii < fetch.n_chunks; ii++) {
+		fetch.chunks[ii].low = cns->high + 1 + ii * NNTP_OVER_CHUNK_SIZE;
+		fetch.chunks[ii].high = MIN (fetch.chunks[ii].low + NNTP_OVER_CHUNK_SIZE - 1, target_high);
+	}
+
+	if (cancellable)
+		cancelled_id = g_cancellable_connect (cancellable, G_CALLBACK (overview_fetch_cancelled_cb), fetch.cancellable, NULL);
+
+	n_threads = MIN (n_connections - 1, fetch.n_chunks - 1);
+	threads = g_new0 (GThread *, n_threads);
+
+	for (ii = 0; ii < n_threads; ii++) {
+		threads[ii] = g_thread_new ("nntp-overview", overview_fetch_thread, &fetch);
+	}
+
+	dd (printf ("%s: fetching %u articles in %u chunks with %u additional connections\n", G_STRFUNC, total_to_fetch, fetch.n_chunks, n_threads));
+
+	headers = camel_name_value_array_new ();
+
+	for (ii = 0; ii < fetch.n_chunks; ii++) {
+		OverviewChunk *chunk = &fetch.chunks[ii];
+		GPtrArray *lines;
+
+		g_mutex_lock (&fetch.lock);
+
+		while (ii < fetch.next_chunk && !chunk->done)
+			g_cond_wait (&fetch.cond, &fetch.lock);
+
+		/* not claimed by any worker yet, fetch it here */
+		if (ii == fetch.next_chunk)
+			fetch.next_chunk++;
+
+		lines = chunk->lines;
+		chunk->lines = NULL;
+
+		g_mutex_unlock (&fetch.lock);
+
+		if (lines) {
+			guint jj;
+
+			for (jj = 0; jj < lines->len; jj++) {
+				camel_operation_progress (cancellable, (progress_count * 100) / total_to_fetch);
+				progress_count++;
+
+				add_xover_line (cns, store, lines->pdata[jj], headers, changes, folder_filter_recent);
+			}
+
+			g_ptr_array_unref (lines);
+		} else {
+			ret = add_range_xover (
+				cns, store, chunk->high, chunk->low,
+				changes, &progress_count, total_to_fetch,
+				cancellable, error);
+			if (ret == -1)
+				break;
+		}
+
+		/* the whole chunk is processed, even when the range is sparse */
+		if (cns->high < chunk->high)
+			cns->high = chunk->high;
+
+		camel_folder_summary_touch (s);
+
+		/* save in batches, not after each chunk */
+		if (g_get_monotonic_time () - last_save_time >= NNTP_SAVE_INTERVAL_USEC) {
+			camel_folder_summary_save (s, NULL);
+			last_save_time = g_get_monotonic_time ();
+		}
+
+		g_mutex_lock (&fetch.lock);
+		fetch.n_parsed = ii + 1;
+		g_cond_broadcast (&fetch.cond);
+		g_mutex_unlock (&fetch.lock);
+
+		if (g_cancellable_is_cancelled (cancellable))
+			break;
+	}
+
+	camel_name_value_array_free (headers);
+
+	/* stop the workers, if anything is left */
+	g_mutex_lock (&fetch.lock);
+	g_cancellable_cancel (fetch.cancellable);
+	g_cond_broadcast (&fetch.cond);
+	g_mutex_unlock (&fetch.lock);
+
+	for (ii = 0; ii < n_threads; ii++) {
+		g_thread_join (threads[ii]);
+	}
+
+	if (cancelled_id)
+		g_cancellable_disconnect (cancellable, cancelled_id);
+
+	for (ii = 0; ii < fetch.n_chunks; ii++) {
+		g_clear_pointer (&fetch.chunks[ii].lines, g_ptr_array_unref);
+	}
+
+	g_free (threads);
+	g_free (fetch.chunks);
+	g_clear_object (&fetch.cancellable);
+	g_mutex_clear (&fetch.lock);
+	g_cond_clear (&fetch.cond);
+
+	camel_folder_summary_save (s, NULL);
+
+	return ret;
+}
+
 /* Assumes we have the stream */
 /* Note: This will be called from camel_nntp_command, so only use camel_nntp_raw_command */
 gint
@@ -584,7 +904,7 @@ camel_nntp_summary_check (CamelNNTPSummary *cns,
 	CamelStoreSummary *store_summary;
 	CamelFolderSummary *s;
 	gint ret = 0, i;
-	guint n, f, l, limit_latest = 0;
+	guint n, f, l, limit_latest = 0, overview_connections = 1;
 	gint count;
 	gchar *folder = NULL;
 	CamelNNTPStoreInfo *si = NULL;
@@ -602,6 +922,7 @@ camel_nntp_summary_check (CamelNNTPSummary *cns,
 	if (settings) {
 		if (camel_nntp_settings_get_use_limit_latest (CAMEL_NNTP_SETTINGS (settings)))
 			limit_latest = camel_nntp_settings_get_limit_latest (CAMEL_NNTP_SETTINGS (settings));
+		overview_connections = camel_nntp_settings_get_overview_connections (CAMEL_NNTP_SETTINGS (settings));
 
 		g_object_unref (settings);
 	}
@@ -689,9 +1010,15 @@ camel_nntp_summary_check (CamelNNTPSummary *cns,
 		if (cns->high < f || limit_latest != cns->priv->last_limit_latest)
 			cns->high = f - 1;
 
-		ret = fetch_articles_chunked (
-			cns, store, full_name, l,
-			changes, s, cancellable, error);
+		/* large ranges are split between more connections */
+		if (store->xover && overview_connections > 1 && l - cns->high > 2 * NNTP_OVER_CHUNK_SIZE)
+			ret = fetch_articles_parallel (
+				cns, store, full_name, l, overview_connections,
+				changes, s, cancellable, error);
+		else
+			ret = fetch_articles_chunked (
+				cns, store, full_name, l,
+				changes, s, cancellable, error);
 	}
 
 	cns->priv->last_limit_latest = limit_latest;
@@ -316,6 +316,7 @@ camel_pop3_engine_iterate (CamelPOP3Engine *pe,
 	guchar *p;
 	guint len;
 	CamelPOP3Command *pc;
+	GString *pending = NULL;
 	GList *link;
 
 	g_return_val_if_fail (pe != NULL, -1);
@@ -386,7 +387,8 @@ camel_pop3_engine_iterate (CamelPOP3Engine *pe,
 	/* Set next command */
 	pe->current = g_queue_pop_head (&pe->active);
 
-	/* Check the queue for any commands we can now send also. */
+	/* Check the queue for any commands we can now send also; with
+	 * pipelining they are sent together, with a single write. */
 	link = g_queue_peek_head_link (&pe->queue);
 
 	while (link != NULL) {
@@ -396,8 +398,11 @@ camel_pop3_engine_iterate (CamelPOP3Engine *pe,
 		    && pe->current != NULL)
 			break;
 
-		if (camel_stream_write ((CamelStream *) pe->stream, pc->data, pc->data ? strlen (pc->data) : 0, cancellable, error) == -1)
-			goto ioerror;
+		if (!pending)
+			pending = g_string_sized_new (CAMEL_POP3_SEND_LIMIT);
+
+		if (pc->data)
+			g_string_append (pending, pc->data);
 
 		pe->sentlen += (pc->data ? strlen (pc->data) : 0);
 		pc->state = CAMEL_POP3_COMMAND_DISPATCHED;
@@ -411,6 +416,17 @@ camel_pop3_engine_iterate (CamelPOP3Engine *pe,
 		link = g_queue_peek_head_link (&pe->queue);
 	}
 
+	if (pending) {
+		gboolean written;
+
+		written = !pending->len || camel_stream_write ((CamelStream *) pe->stream, pending->str, pending->len, cancellable, error) != -1;
+
+		g_string_free (pending, TRUE);
+
+		if (!written)
+			goto ioerror;
+	}
+
 	/* UNLOCK */
 
 	if (pcwait && pcwait->state >= CAMEL_POP3_COMMAND_OK)
@@ -18,6 +18,14 @@
 
 #define d(x) if (camel_debug("pop3")) x;
 
+/* how many bytes of the following messages can be requested ahead, when
+ * the server supports pipelining, and at most how many messages */
+#define POP3_PREFETCH_WINDOW (1024 * 1024)
+#define POP3_PREFETCH_MAX_MESSAGES (64)
+
+/* without pipelining the commands are sent one after another */
+#define POP3_PREFETCH_NO_PIPE_MESSAGES (10)
+
 typedef struct _CamelPOP3FolderInfo CamelPOP3FolderInfo;
 
 struct _CamelPOP3FolderInfo {
@@ -210,6 +218,73 @@ cmd_tocache (CamelPOP3Engine *pe,
 	g_clear_object (&fi->write_stream);
 }
 
+/* Initiates retrieval of the messages following @from_index, assuming they
+ * will be asked for too. With a pipelining server up to POP3_PREFETCH_WINDOW
+ * bytes of them are kept requested ahead, counting those already requested,
+ * thus the next message is usually being received while the previous
+ * is processed, instead of paying a round trip per message. */
+static gboolean
+pop3_folder_prefetch (CamelPOP3Folder *pop3_folder,
+                      CamelPOP3Store *pop3_store,
+                      CamelPOP3Engine *pop3_engine,
+                      guint from_index,
+                      GCancellable *cancellable,
+                      GError **error)
+{
+	guint ii, last, max_messages, n_messages = 0;
+	guint64 n_bytes = 0;
+	gboolean can_pipe;
+
+	can_pipe = (pop3_engine->capa & CAMEL_POP3_CAP_PIPE) != 0;
+	max_messages = can_pipe ? POP3_PREFETCH_MAX_MESSAGES : POP3_PREFETCH_NO_PIPE_MESSAGES;
+
+	/* do not look too far for the uncached messages */
+	last = MIN (from_index + 2 * max_messages, pop3_folder->uids->len);
+
+	for (ii = from_index; ii < last && n_messages < max_messages; ii++) {
+		CamelPOP3FolderInfo *pfi = pop3_folder->uids->pdata[ii];
+		GError *local_error = NULL;
+
+		if (can_pipe && n_bytes >= POP3_PREFETCH_WINDOW)
+			break;
+
+		if (pfi->cmd) {
+			/* still being retrieved */
+			if (pfi->cmd->state < CAMEL_POP3_COMMAND_OK) {
+				n_messages++;
+				n_bytes += pfi->size;
+			}
+			continue;
+		}
+
+		if (!pfi->uid || camel_pop3_store_cache_has (pop3_store, pfi->uid))
+			continue;
+
+		pfi->write_stream = camel_pop3_store_cache_add (
+			pop3_store, pfi->uid, &pfi->cache_stream, NULL);
+		if (pfi->write_stream == NULL)
+			continue;
+
+		pfi->store = pop3_store;
+		pfi->cmd = camel_pop3_engine_command_new (
+			pop3_engine,
+			CAMEL_POP3_COMMAND_MULTI,
+			cmd_tocache, pfi,
+			cancellable, &local_error,
+			"RETR %u\r\n", pfi->id);
+
+		if (local_error) {
+			g_propagate_error (error, local_error);
+			return FALSE;
+		}
+
+		n_messages++;
+		n_bytes += pfi->size;
+	}
+
+	return TRUE;
+}
+
 static void
 pop3_folder_dispose (GObject *object)
 {
@@ -402,7 +477,7 @@ pop3_folder_get_message_internal_sync (CamelFolder *folder,
 	CamelPOP3Engine *pop3_engine;
 	CamelPOP3Command *pcr;
 	CamelPOP3FolderInfo *fi;
-	gint i = -1, last;
+	gint i = -1;
 	CamelStream *stream = NULL;
 	gboolean is_disk_cached = FALSE;
 	CamelService *service;
@@ -459,6 +534,10 @@ pop3_folder_get_message_internal_sync (CamelFolder *folder,
 	 * & then retrieve from cache, otherwise, start a new one, and similar */
 
 	if (fi->cmd != NULL) {
+		/* keep the pipeline full, while waiting for this one */
+		if (auto_fetch)
+			pop3_folder_prefetch (pop3_folder, pop3_store, pop3_engine, fi->index + 1, cancellable, NULL);
+
 		while ((i = camel_pop3_engine_iterate (pop3_engine, fi->cmd, cancellable, error)) > 0)
 			;
 
@@ -508,39 +587,14 @@ pop3_folder_get_message_internal_sync (CamelFolder *folder,
 
 		/* Also initiate retrieval of some of the following
 		 * messages, assume we'll be receiving them. */
-		if (auto_fetch) {
-			/* This should keep track of the last one retrieved,
-			 * also how many are still oustanding incase of random
-			 * access on large folders. */
-			i = fi->index + 1;
-			last = MIN (i + 10, pop3_folder->uids->len);
-			for (; i < last; i++) {
-				CamelPOP3FolderInfo *pfi = pop3_folder->uids->pdata[i];
-
-				if (pfi->uid && !pfi->cmd && !camel_pop3_store_cache_has (pop3_store, pfi->uid)) {
-					pfi->write_stream = camel_pop3_store_cache_add (
-						pop3_store, pfi->uid, &pfi->cache_stream, NULL);
-					if (pfi->write_stream != NULL) {
-						pfi->store = pop3_store;
-						pfi->cmd = camel_pop3_engine_command_new (
-							pop3_engine,
-							CAMEL_POP3_COMMAND_MULTI,
-							cmd_tocache, pfi,
-							cancellable, &local_error,
-							"RETR %u\r\n", pfi->id);
-
-						if (local_error) {
-							if (pcr)
-								camel_pop3_engine_command_free (pop3_engine, pcr);
-
-							g_propagate_error (error, local_error);
-							g_prefix_error (
-								error, _("Cannot get message %s: "), uid);
-							goto done;
-						}
-					}
-				}
-			}
+		if (auto_fetch && !pop3_folder_prefetch (pop3_folder, pop3_store, pop3_engine, fi->index + 1, cancellable, &local_error)) {
+			if (pcr)
+				camel_pop3_engine_command_free (pop3_engine, pcr);
+
+			g_propagate_error (error, local_error);
+			g_prefix_error (
+				error, _("Cannot get message %s: "), uid);
+			goto done;
 		}
 
 		/* now wait for the first one to finish */
@@ -44,6 +44,9 @@
 /* set if we are using authtypes from a broken AUTH= */
 #define CAMEL_SMTP_TRANSPORT_AUTH_EQUAL             (1 << 5)
 
+#define CAMEL_SMTP_TRANSPORT_PIPELINING             (1 << 6) /* RFC 2920 */
+#define CAMEL_SMTP_TRANSPORT_CHUNKING               (1 << 7) /* RFC 3030, the BDAT command */
+
 enum {
 	PROP_0,
 	PROP_CONNECTABLE,
@@ -72,7 +75,7 @@ static gboolean		smtp_mail		(CamelSmtpTransport *transport,
 						 CamelStreamBuffer *istream,
 						 CamelStream *ostream,
 						 const gchar *sender,
-						 gboolean has_8bit_parts,
+						 const gchar *body_type,
 						 gboolean request_dsn,
 						 const gchar *dsn_envid,
 						 GCancellable *cancellable,
@@ -84,6 +87,16 @@ static gboolean		smtp_rcpt		(CamelSmtpTransport *transport,
 						 gboolean request_dsn,
 						 GCancellable *cancellable,
 						 GError **error);
+static gboolean		smtp_envelope_pipelined	(CamelSmtpTransport *transport,
+						 CamelStreamBuffer *istream,
+						 CamelStream *ostream,
+						 const gchar *sender,
+						 const gchar *body_type,
+						 gboolean request_dsn,
+						 const gchar *dsn_envid,
+						 GPtrArray *recipients,
+						 GCancellable *cancellable,
+						 GError **error);
 static gboolean		smtp_data		(CamelSmtpTransport *transport,
 						 CamelStreamBuffer *istream,
 						 CamelStream *ostream,
@@ -939,9 +952,11 @@ smtp_transport_send_to_sync (CamelTransport *transport,
 	CamelInternetAddress *cia;
 	CamelStreamBuffer *istream;
 	CamelStream *ostream;
+	GPtrArray *rcpts;
 	gboolean has_8bit_parts = FALSE;
-	gboolean request_dsn;
-	const gchar *addr, *message_id;
+	gboolean request_dsn, success;
+	const gchar *addr, *message_id, *body_type = NULL;
+	gint64 time_start, time_envelope, time_data;
 	gint i, len;
 
 	smtp_debug_print_server_name (CAMEL_SERVICE (transport), "Sending with");
@@ -968,87 +983,102 @@ smtp_transport_send_to_sync (CamelTransport *transport,
 		return FALSE;
 	}
 
-	camel_operation_push_message (cancellable, _("Sending message"));
-
-	/* find out if the message has 8bit mime parts; quoted-printable are reencoded to 8bit too */
-	camel_mime_message_foreach_part (message, message_has_8bit_or_qp_part_cb, &has_8bit_parts);
-
-	/* If the connection needs a ReSET, then do so */
-	if (smtp_transport->need_rset &&
-	    !smtp_rset (smtp_transport, istream, ostream, cancellable, error)) {
-		camel_operation_pop_message (cancellable);
-		g_clear_object (&istream);
-		g_clear_object (&ostream);
-		return FALSE;
-	}
-	smtp_transport->need_rset = FALSE;
-
-	message_id = camel_mime_message_get_message_id (message);
-	request_dsn = camel_transport_get_request_dsn (CAMEL_TRANSPORT (smtp_transport));
-
-	/* rfc1652 (8BITMIME) requires that you notify the ESMTP daemon that
-	 * you'll be sending an 8bit mime message at "MAIL FROM:" time. */
-	if (!smtp_mail (
-		smtp_transport, istream, ostream, addr, has_8bit_parts, request_dsn, message_id, cancellable, error)) {
-		camel_operation_pop_message (cancellable);
-		g_clear_object (&istream);
-		g_clear_object (&ostream);
-		return FALSE;
-	}
-
 	len = camel_address_length (recipients);
 	if (len == 0) {
+		g_clear_object (&istream);
+		g_clear_object (&ostream);
 		g_set_error (
 			error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
 			_("Cannot send message: no recipients defined."));
-		camel_operation_pop_message (cancellable);
-		smtp_transport->need_rset = TRUE;
-		g_clear_object (&istream);
-		g_clear_object (&ostream);
 		return FALSE;
 	}
 
+	rcpts = g_ptr_array_new_full (len, g_free);
+
 	cia = CAMEL_INTERNET_ADDRESS (recipients);
 	for (i = 0; i < len; i++) {
-		gchar *enc;
+		const gchar *rcpt_addr;
 
-		if (!camel_internet_address_get (cia, i, NULL, &addr)) {
+		if (!camel_internet_address_get (cia, i, NULL, &rcpt_addr)) {
+			g_ptr_array_unref (rcpts);
+			g_clear_object (&istream);
+			g_clear_object (&ostream);
 			g_set_error (
 				error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
 				_("Cannot send message: "
 				"one or more invalid recipients"));
-			camel_operation_pop_message (cancellable);
-			smtp_transport->need_rset = TRUE;
-			g_clear_object (&istream);
-			g_clear_object (&ostream);
 			return FALSE;
 		}
 
-		enc = camel_internet_address_encode_address (NULL, NULL, addr);
-		if (!smtp_rcpt (smtp_transport, istream, ostream, enc, request_dsn, cancellable, error)) {
-			g_free (enc);
-			camel_operation_pop_message (cancellable);
-			smtp_transport->need_rset = TRUE;
-			g_clear_object (&istream);
-			g_clear_object (&ostream);
-			return FALSE;
-		}
-		g_free (enc);
+		g_ptr_array_add (rcpts, camel_internet_address_encode_address (NULL, NULL, rcpt_addr));
 	}
 
-	if (!smtp_data (smtp_transport, istream, ostream, message, cancellable, error)) {
+	camel_operation_push_message (cancellable, _("Sending message"));
+
+	time_start = g_get_monotonic_time ();
+
+	/* find out if the message has 8bit mime parts; quoted-printable are reencoded to 8bit too */
+	camel_mime_message_foreach_part (message, message_has_8bit_or_qp_part_cb, &has_8bit_parts);
+
+	/* rfc1652 (8BITMIME) requires that you notify the ESMTP daemon that
+	 * you'll be sending an 8bit mime message at "MAIL FROM:" time.
+	 * BODY=BINARYMIME (rfc3030) is never declared, because the message
+	 * is always sent through the LF->CRLF conversion, which is not valid
+	 * for binary content. */
+	if (has_8bit_parts && (smtp_transport->flags & CAMEL_SMTP_TRANSPORT_8BITMIME) != 0)
+		body_type = "8BITMIME";
+
+	/* If the connection needs a ReSET, then do so */
+	if (smtp_transport->need_rset &&
+	    !smtp_rset (smtp_transport, istream, ostream, cancellable, error)) {
 		camel_operation_pop_message (cancellable);
-		smtp_transport->need_rset = TRUE;
+		g_ptr_array_unref (rcpts);
 		g_clear_object (&istream);
 		g_clear_object (&ostream);
 		return FALSE;
 	}
+	smtp_transport->need_rset = FALSE;
+
+	message_id = camel_mime_message_get_message_id (message);
+	request_dsn = camel_transport_get_request_dsn (CAMEL_TRANSPORT (smtp_transport));
+
+	if (smtp_transport->flags & CAMEL_SMTP_TRANSPORT_PIPELINING) {
+		success = smtp_envelope_pipelined (
+			smtp_transport, istream, ostream, addr, body_type, request_dsn, message_id,
+			rcpts, cancellable, error);
+	} else {
+		success = smtp_mail (
+			smtp_transport, istream, ostream, addr, body_type, request_dsn, message_id, cancellable, error);
+
+		for (i = 0; success && i < rcpts->len; i++) {
+			success = smtp_rcpt (smtp_transport, istream, ostream, rcpts->pdata[i], request_dsn, cancellable, error);
+		}
+	}
+
+	time_envelope = g_get_monotonic_time ();
+
+	if (success)
+		success = smtp_data (smtp_transport, istream, ostream, message, cancellable, error);
+
+	time_data = g_get_monotonic_time ();
+
+	d (fprintf (stderr, "[SMTP] %s: envelope %.1f ms (%u recipients%s), %s %.1f ms, total %.1f ms\n",
+		success ? "sent" : "failed",
+		(time_envelope - time_start) / 1000.0, rcpts->len,
+		(smtp_transport->flags & CAMEL_SMTP_TRANSPORT_PIPELINING) != 0 ? ", pipelined" : "",
+		(smtp_transport->flags & CAMEL_SMTP_TRANSPORT_CHUNKING) != 0 ? "BDAT" : "DATA",
+		(time_data - time_envelope) / 1000.0,
+		(time_data - time_start) / 1000.0));
+
+	if (!success)
+		smtp_transport->need_rset = TRUE;
 
 	camel_operation_pop_message (cancellable);
+	g_ptr_array_unref (rcpts);
 	g_clear_object (&istream);
 	g_clear_object (&ostream);
 
-	return TRUE;
+	return success;
 }
 
 static const gchar *
@@ -1449,7 +1479,9 @@ smtp_helo (CamelSmtpTransport *transport,
 	transport->flags &= ~(CAMEL_SMTP_TRANSPORT_8BITMIME |
 			      CAMEL_SMTP_TRANSPORT_ENHANCEDSTATUSCODES |
 			      CAMEL_SMTP_TRANSPORT_STARTTLS |
-			      CAMEL_SMTP_TRANSPORT_DSN);
+			      CAMEL_SMTP_TRANSPORT_DSN |
+			      CAMEL_SMTP_TRANSPORT_PIPELINING |
+			      CAMEL_SMTP_TRANSPORT_CHUNKING);
 
 	if (transport->authtypes) {
 		g_hash_table_foreach (transport->authtypes, authtypes_free, NULL);
@@ -1562,6 +1594,10 @@ smtp_helo (CamelSmtpTransport *transport,
 				transport->flags |= CAMEL_SMTP_TRANSPORT_STARTTLS;
 			} else if (!g_ascii_strncasecmp (token, "DSN", 3)) {
 				transport->flags |= CAMEL_SMTP_TRANSPORT_DSN;
+			} else if (!g_ascii_strncasecmp (token, "PIPELINING", 10)) {
+				transport->flags |= CAMEL_SMTP_TRANSPORT_PIPELINING;
+			} else if (!g_ascii_strncasecmp (token, "CHUNKING", 8)) {
+				transport->flags |= CAMEL_SMTP_TRANSPORT_CHUNKING;
 			} else if (!g_ascii_strncasecmp (token, "AUTH", 4)) {
 				if (!transport->authtypes || transport->flags & CAMEL_SMTP_TRANSPORT_AUTH_EQUAL) {
 					/* Don't bother parsing any authtypes if we already have a list.
@@ -1602,25 +1638,19 @@ smtp_helo (CamelSmtpTransport *transport,
 	return TRUE;
 }
 
-static gboolean
-smtp_mail (CamelSmtpTransport *transport,
-	   CamelStreamBuffer *istream,
-	   CamelStream *ostream,
-           const gchar *sender,
-           gboolean has_8bit_parts,
-	   gboolean request_dsn,
-	   const gchar *dsn_envid,
-           GCancellable *cancellable,
-           GError **error)
+static GString *
+smtp_mail_command (CamelSmtpTransport *transport,
+                   const gchar *sender,
+                   const gchar *body_type,
+                   gboolean request_dsn,
+                   const gchar *dsn_envid)
 {
-	/* we gotta tell the smtp server who we are. (our email addy) */
 	GString *cmd;
-	gchar *respbuf = NULL;
 
 	cmd = g_string_new ("MAIL");
 
-	if ((transport->flags & CAMEL_SMTP_TRANSPORT_8BITMIME) && has_8bit_parts)
-		g_string_append_printf (cmd, " FROM:<%s> BODY=8BITMIME", sender);
+	if (body_type)
+		g_string_append_printf (cmd, " FROM:<%s> BODY=%s", sender, body_type);
 	else
 		g_string_append_printf (cmd, " FROM:<%s>", sender);
 
@@ -1646,17 +1676,16 @@ smtp_mail (CamelSmtpTransport *transport,
 
 	g_string_append (cmd, "\r\n");
 
-	d (fprintf (stderr, "[SMTP] sending: %s", cmd->str));
+	return cmd;
+}
 
-	if (camel_stream_write_string (ostream, cmd->str, cancellable, error) == -1) {
-		g_string_free (cmd, TRUE);
-		g_prefix_error (error, _("MAIL FROM command failed: "));
-		camel_service_disconnect_sync (
-			CAMEL_SERVICE (transport),
-			FALSE, cancellable, NULL);
-		return FALSE;
-	}
-	g_string_free (cmd, TRUE);
+static gboolean
+smtp_mail_reply (CamelSmtpTransport *transport,
+		 CamelStreamBuffer *istream,
+		 GCancellable *cancellable,
+		 GError **error)
+{
+	gchar *respbuf = NULL;
 
 	do {
 		/* Check for "250 Sender OK..." or anything starting with "2" */
@@ -1684,18 +1713,42 @@ smtp_mail (CamelSmtpTransport *transport,
 }
 
 static gboolean
-smtp_rcpt (CamelSmtpTransport *transport,
+smtp_mail (CamelSmtpTransport *transport,
 	   CamelStreamBuffer *istream,
 	   CamelStream *ostream,
-           const gchar *recipient,
+           const gchar *sender,
+           const gchar *body_type,
 	   gboolean request_dsn,
+	   const gchar *dsn_envid,
            GCancellable *cancellable,
            GError **error)
 {
-	/* we gotta tell the smtp server who we are going to be sending
-	 * our email to */
+	/* we gotta tell the smtp server who we are. (our email addy) */
+	GString *cmd;
+
+	cmd = smtp_mail_command (transport, sender, body_type, request_dsn, dsn_envid);
+
+	d (fprintf (stderr, "[SMTP] sending: %s", cmd->str));
+
+	if (camel_stream_write_string (ostream, cmd->str, cancellable, error) == -1) {
+		g_string_free (cmd, TRUE);
+		g_prefix_error (error, _("MAIL FROM command failed: "));
+		camel_service_disconnect_sync (
+			CAMEL_SERVICE (transport),
+			FALSE, cancellable, NULL);
+		return FALSE;
+	}
+	g_string_free (cmd, TRUE);
+
+	return smtp_mail_reply (transport, istream, cancellable, error);
+}
+
+static GString *
+smtp_rcpt_command (CamelSmtpTransport *transport,
+                   const gchar *recipient,
+                   gboolean request_dsn)
+{
 	GString *cmd;
-	gchar *respbuf = NULL;
 
 	cmd = g_string_new ("RCPT");
 
@@ -1738,18 +1791,17 @@ smtp_rcpt (CamelSmtpTransport *transport,
 
 	g_string_append (cmd, "\r\n");
 
-	d (fprintf (stderr, "[SMTP] sending: %s", cmd->str));
-
-	if (camel_stream_write_string (ostream, cmd->str, cancellable, error) == -1) {
-		g_string_free (cmd, TRUE);
-		g_prefix_error (error, _("RCPT TO command failed: "));
-		camel_service_disconnect_sync (
-			CAMEL_SERVICE (transport),
-			FALSE, cancellable, NULL);
+	return cmd;
+}
 
-		return FALSE;
-	}
-	g_string_free (cmd, TRUE);
+static gboolean
+smtp_rcpt_reply (CamelSmtpTransport *transport,
+		 CamelStreamBuffer *istream,
+		 const gchar *recipient,
+		 GCancellable *cancellable,
+		 GError **error)
+{
+	gchar *respbuf = NULL;
 
 	do {
 		/* Check for "250 Recipient OK..." */
@@ -1778,6 +1830,103 @@ smtp_rcpt (CamelSmtpTransport *transport,
 	return TRUE;
 }
 
+static gboolean
+smtp_rcpt (CamelSmtpTransport *transport,
+	   CamelStreamBuffer *istream,
+	   CamelStream *ostream,
+           const gchar *recipient,
+	   gboolean request_dsn,
+           GCancellable *cancellable,
+           GError **error)
+{
+	/* we gotta tell the smtp server who we are going to be sending
+	 * our email to */
+	GString *cmd;
+
+	cmd = smtp_rcpt_command (transport, recipient, request_dsn);
+
+	d (fprintf (stderr, "[SMTP] sending: %s", cmd->str));
+
+	if (camel_stream_write_string (ostream, cmd->str, cancellable, error) == -1) {
+		g_string_free (cmd, TRUE);
+		g_prefix_error (error, _("RCPT TO command failed: "));
+		camel_service_disconnect_sync (
+			CAMEL_SERVICE (transport),
+			FALSE, cancellable, NULL);
+
+		return FALSE;
+	}
+	g_string_free (cmd, TRUE);
+
+	return smtp_rcpt_reply (transport, istream, recipient, cancellable, error);
+}
+
+/* Sends the MAIL FROM and all the RCPT TO commands at once and only then
+ * reads their replies, as RFC 2920 allows, thus the envelope costs one
+ * round trip, instead of one per recipient. The DATA or BDAT command is
+ * not part of the group, it is sent only when all the recipients had been
+ * accepted, the same as without pipelining. */
+static gboolean
+smtp_envelope_pipelined (CamelSmtpTransport *transport,
+			 CamelStreamBuffer *istream,
+			 CamelStream *ostream,
+			 const gchar *sender,
+			 const gchar *body_type,
+			 gboolean request_dsn,
+			 const gchar *dsn_envid,
+			 GPtrArray *recipients,
+			 GCancellable *cancellable,
+			 GError **error)
+{
+	GString *cmds;
+	GError *local_error = NULL;
+	guint ii;
+
+	cmds = smtp_mail_command (transport, sender, body_type, request_dsn, dsn_envid);
+
+	for (ii = 0; ii < recipients->len; ii++) {
+		GString *cmd;
+
+		cmd = smtp_rcpt_command (transport, recipients->pdata[ii], request_dsn);
+		g_string_append_len (cmds, cmd->str, cmd->len);
+		g_string_free (cmd, TRUE);
+	}
+
+	d (fprintf (stderr, "[SMTP] sending pipelined:\n%s", cmds->str));
+
+	if (camel_stream_write (ostream, cmds->str, cmds->len, cancellable, error) == -1) {
+		g_string_free (cmds, TRUE);
+		g_prefix_error (error, _("MAIL FROM command failed: "));
+		camel_service_disconnect_sync (
+			CAMEL_SERVICE (transport),
+			FALSE, cancellable, NULL);
+		return FALSE;
+	}
+	g_string_free (cmds, TRUE);
+
+	/* Read all the replies, to keep the connection usable,
+	 * but report only the first failure. */
+	smtp_mail_reply (transport, istream, cancellable, &local_error);
+
+	for (ii = 0; ii < recipients->len && transport->connected; ii++) {
+		if (!local_error) {
+			smtp_rcpt_reply (transport, istream, recipients->pdata[ii], cancellable, &local_error);
+		} else {
+			GError *rcpt_error = NULL;
+
+			if (!smtp_rcpt_reply (transport, istream, recipients->pdata[ii], cancellable, &rcpt_error))
+				g_clear_error (&rcpt_error);
+		}
+	}
+
+	if (local_error) {
+		g_propagate_error (error, local_error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 static void
 smtp_maybe_update_socket_timeout (CamelStream *strm,
 				  gint timeout_seconds)
@@ -1806,6 +1955,56 @@ smtp_maybe_update_socket_timeout (CamelStream *strm,
 	g_clear_object (&base_strm);
 }
 
+/* sets @out_size to how many bytes the message has, when sent with CRLF line endings;
+ * the size is sent to the server in advance, thus any failure needs to be reported */
+static gboolean
+smtp_calculate_crlf_size (CamelMimeMessage *message,
+			  gsize *out_size,
+			  GCancellable *cancellable,
+			  GError **error)
+{
+	CamelStream *null_stream, *filtered_stream;
+	CamelMimeFilter *filter;
+	gboolean success;
+
+	null_stream = camel_stream_null_new ();
+	filtered_stream = camel_stream_filter_new (null_stream);
+
+	filter = camel_mime_filter_crlf_new (
+		CAMEL_MIME_FILTER_CRLF_ENCODE,
+		CAMEL_MIME_FILTER_CRLF_MODE_CRLF_ONLY);
+	camel_mime_filter_crlf_set_ensure_crlf_end (CAMEL_MIME_FILTER_CRLF (filter), TRUE);
+	camel_stream_filter_add (CAMEL_STREAM_FILTER (filtered_stream), filter);
+	g_object_unref (filter);
+
+	success = camel_data_wrapper_write_to_stream_sync (CAMEL_DATA_WRAPPER (message), filtered_stream, cancellable, error) != -1 &&
+		camel_stream_flush (filtered_stream, cancellable, error) != -1;
+
+	*out_size = camel_stream_null_get_bytes_written (CAMEL_STREAM_NULL (null_stream));
+
+	g_object_unref (filtered_stream);
+	g_object_unref (null_stream);
+
+	return success;
+}
+
+/* adds back the Bcc headers from @previous_headers and frees it */
+static void
+smtp_restore_bcc_headers (CamelMimeMessage *message,
+			  CamelNameValueArray *previous_headers)
+{
+	const gchar *header_name = NULL, *header_value = NULL;
+	guint ii;
+
+	for (ii = 0; camel_name_value_array_get (previous_headers, ii, &header_name, &header_value); ii++) {
+		if (!g_ascii_strcasecmp (header_name, "Bcc")) {
+			camel_medium_add_header (CAMEL_MEDIUM (message), header_name, header_value);
+		}
+	}
+
+	camel_name_value_array_free (previous_headers);
+}
+
 static gboolean
 smtp_data (CamelSmtpTransport *transport,
 	   CamelStreamBuffer *istream,
@@ -1816,14 +2015,14 @@ smtp_data (CamelSmtpTransport *transport,
 {
 	CamelSettings *settings;
 	CamelNameValueArray *previous_headers;
-	const gchar *header_name = NULL, *header_value = NULL;
 	CamelStream *filtered_stream;
 	gchar *cmdbuf, *respbuf = NULL;
 	CamelMimeFilter *filter;
+	CamelMimeFilterCRLFMode crlf_mode;
+	const gchar *error_prefix;
 	gsize bytes_written;
-	gboolean reencode_data;
+	gboolean reencode_data, use_bdat;
 	gint ret;
-	guint ii;
 
 	settings = camel_service_ref_settings (CAMEL_SERVICE (transport));
 	reencode_data = camel_smtp_settings_get_reencode_data (CAMEL_SMTP_SETTINGS (settings));
@@ -1844,48 +2043,84 @@ smtp_data (CamelSmtpTransport *transport,
 			message, CAMEL_BESTENC_GET_ENCODING, enctype);
 	}
 
-	cmdbuf = g_strdup ("DATA\r\n");
+	/* rfc3030 (CHUNKING) sends the message as is, with its size in advance,
+	 * instead of escaping the lines beginning with a dot and ending it
+	 * with a line containing only a dot */
+	use_bdat = (transport->flags & CAMEL_SMTP_TRANSPORT_CHUNKING) != 0;
+	crlf_mode = use_bdat ? CAMEL_MIME_FILTER_CRLF_MODE_CRLF_ONLY : CAMEL_MIME_FILTER_CRLF_MODE_CRLF_DOTS;
+	error_prefix = use_bdat ? _("BDAT command failed: ") : _("DATA command failed: ");
 
-	d (fprintf (stderr, "[SMTP] sending: %s", cmdbuf));
+	if (!use_bdat) {
+		cmdbuf = g_strdup ("DATA\r\n");
 
-	if (camel_stream_write_string (ostream, cmdbuf, cancellable, error) == -1) {
+		d (fprintf (stderr, "[SMTP] sending: %s", cmdbuf));
+
+		if (camel_stream_write_string (ostream, cmdbuf, cancellable, error) == -1) {
+			g_free (cmdbuf);
+			g_prefix_error (error, "%s", error_prefix);
+			camel_service_disconnect_sync (
+				CAMEL_SERVICE (transport),
+				FALSE, cancellable, NULL);
+			return FALSE;
+		}
 		g_free (cmdbuf);
-		g_prefix_error (error, _("DATA command failed: "));
-		camel_service_disconnect_sync (
-			CAMEL_SERVICE (transport),
-			FALSE, cancellable, NULL);
-		return FALSE;
-	}
-	g_free (cmdbuf);
 
-	respbuf = camel_stream_buffer_read_line (istream, cancellable, error);
-	d (fprintf (stderr, "[SMTP] received: %s\n", respbuf ? respbuf : "(null)"));
-	if (respbuf == NULL) {
-		g_prefix_error (error, _("DATA command failed: "));
-		camel_service_disconnect_sync (
-			CAMEL_SERVICE (transport),
-			FALSE, cancellable, NULL);
-		return FALSE;
-	}
-	if (strncmp (respbuf, "354", 3) != 0) {
-		/* We should have gotten instructions on how to use the DATA
-		 * command: 354 Enter mail, end with "." on a line by itself
-		 */
-		smtp_set_error (transport, istream, respbuf, cancellable, error);
-		g_prefix_error (error, _("DATA command failed: "));
+		respbuf = camel_stream_buffer_read_line (istream, cancellable, error);
+		d (fprintf (stderr, "[SMTP] received: %s\n", respbuf ? respbuf : "(null)"));
+		if (respbuf == NULL) {
+			g_prefix_error (error, "%s", error_prefix);
+			camel_service_disconnect_sync (
+				CAMEL_SERVICE (transport),
+				FALSE, cancellable, NULL);
+			return FALSE;
+		}
+		if (strncmp (respbuf, "354", 3) != 0) {
+			/* We should have gotten instructions on how to use the DATA
+			 * command: 354 Enter mail, end with "." on a line by itself
+			 */
+			smtp_set_error (transport, istream, respbuf, cancellable, error);
+			g_prefix_error (error, "%s", error_prefix);
+			g_free (respbuf);
+			return FALSE;
+		}
+
 		g_free (respbuf);
-		return FALSE;
+		respbuf = NULL;
 	}
 
-	g_free (respbuf);
-	respbuf = NULL;
-
 	/* unlink the bcc headers and keep a copy of them */
 	previous_headers = camel_medium_dup_headers (CAMEL_MEDIUM (message));
 	camel_medium_remove_header (CAMEL_MEDIUM (message), "Bcc");
 
-	/* find out how large the message is... */
-	bytes_written = camel_data_wrapper_calculate_size_sync (CAMEL_DATA_WRAPPER (message), NULL, NULL);
+	if (use_bdat) {
+		/* the whole message is sent as a single, last chunk,
+		 * which needs to know the exact size being sent */
+		if (!smtp_calculate_crlf_size (message, &bytes_written, cancellable, error)) {
+			/* nothing had been sent yet, the caller resets the connection */
+			smtp_restore_bcc_headers (message, previous_headers);
+			g_prefix_error (error, "%s", error_prefix);
+			return FALSE;
+		}
+
+		cmdbuf = g_strdup_printf ("BDAT %" G_GSIZE_FORMAT " LAST\r\n", bytes_written);
+
+		d (fprintf (stderr, "[SMTP] sending: %s", cmdbuf));
+
+		ret = camel_stream_write_string (ostream, cmdbuf, cancellable, error);
+		g_free (cmdbuf);
+
+		if (ret == -1) {
+			smtp_restore_bcc_headers (message, previous_headers);
+			g_prefix_error (error, "%s", error_prefix);
+			camel_service_disconnect_sync (
+				CAMEL_SERVICE (transport),
+				FALSE, cancellable, NULL);
+			return FALSE;
+		}
+	} else {
+		/* find out how large the message is... */
+		bytes_written = camel_data_wrapper_calculate_size_sync (CAMEL_DATA_WRAPPER (message), NULL, NULL);
+	}
 
 	/* Set the upload timeout to an equal of 512 bytes per second */
 	smtp_maybe_update_socket_timeout (ostream, bytes_written / 512);
@@ -1901,7 +2136,7 @@ smtp_data (CamelSmtpTransport *transport,
 	/* setup LF->CRLF conversion */
 	filter = camel_mime_filter_crlf_new (
 		CAMEL_MIME_FILTER_CRLF_ENCODE,
-		CAMEL_MIME_FILTER_CRLF_MODE_CRLF_DOTS);
+		crlf_mode);
 	camel_mime_filter_crlf_set_ensure_crlf_end (CAMEL_MIME_FILTER_CRLF (filter), TRUE);
 	camel_stream_filter_add (
 		CAMEL_STREAM_FILTER (filtered_stream), filter);
@@ -1921,7 +2156,7 @@ smtp_data (CamelSmtpTransport *transport,
 
 		filter = camel_mime_filter_crlf_new (
 			CAMEL_MIME_FILTER_CRLF_ENCODE,
-			CAMEL_MIME_FILTER_CRLF_MODE_CRLF_DOTS);
+			crlf_mode);
 		camel_mime_filter_crlf_set_ensure_crlf_end (CAMEL_MIME_FILTER_CRLF (filter), TRUE);
 		camel_stream_filter_add (CAMEL_STREAM_FILTER (sec_filtered_stream), filter);
 		g_object_unref (filter);
@@ -1947,17 +2182,10 @@ smtp_data (CamelSmtpTransport *transport,
 		g_clear_error (&local_error);
 	}
 
-	/* restore the bcc headers */
-	for (ii = 0; camel_name_value_array_get (previous_headers, ii, &header_name, &header_value); ii++) {
-		if (!g_ascii_strcasecmp (header_name, "Bcc")) {
-			camel_medium_add_header (CAMEL_MEDIUM (message), header_name, header_value);
-		}
-	}
-
-	camel_name_value_array_free (previous_headers);
+	smtp_restore_bcc_headers (message, previous_headers);
 
 	if (ret == -1) {
-		g_prefix_error (error, _("DATA command failed: "));
+		g_prefix_error (error, "%s", error_prefix);
 
 		g_object_unref (filtered_stream);
 
@@ -1972,14 +2200,16 @@ smtp_data (CamelSmtpTransport *transport,
 
 	/* terminate the message body */
 
-	d (fprintf (stderr, "[SMTP] sending: .\\r\\n\n"));
+	if (!use_bdat) {
+		d (fprintf (stderr, "[SMTP] sending: .\\r\\n\n"));
 
-	if (camel_stream_write (ostream, ".\r\n", 3, cancellable, error) == -1) {
-		g_prefix_error (error, _("DATA command failed: "));
-		camel_service_disconnect_sync (
-			CAMEL_SERVICE (transport),
-			FALSE, cancellable, NULL);
-		return FALSE;
+		if (camel_stream_write (ostream, ".\r\n", 3, cancellable, error) == -1) {
+			g_prefix_error (error, "%s", error_prefix);
+			camel_service_disconnect_sync (
+				CAMEL_SERVICE (transport),
+				FALSE, cancellable, NULL);
+			return FALSE;
+		}
 	}
 
 	do {
@@ -1988,7 +2218,7 @@ smtp_data (CamelSmtpTransport *transport,
 		respbuf = camel_stream_buffer_read_line (istream, cancellable, error);
 		d (fprintf (stderr, "[SMTP] received: %s\n", respbuf ? respbuf : "(null)"));
 		if (respbuf == NULL) {
-			g_prefix_error (error, _("DATA command failed: "));
+			g_prefix_error (error, "%s", error_prefix);
 			camel_service_disconnect_sync (
 				CAMEL_SERVICE (transport),
 				FALSE, cancellable, NULL);
@@ -1996,7 +2226,7 @@ smtp_data (CamelSmtpTransport *transport,
 		}
 		if (strncmp (respbuf, "250", 3) != 0) {
 			smtp_set_error (transport, istream, respbuf, cancellable, error);
-			g_prefix_error (error, _("DATA command failed: "));
+			g_prefix_error (error, "%s", error_prefix);
 			g_free (respbuf);
 			return FALSE;
 		}
@@ -0,0 +1,218 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "evolution-data-server-config.h"
+
+#include <fcntl.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "camel-test.h"
+
+#define N_BLOCKS 600
+
+static void
+fill_block (CamelBlock *bl,
+            guint index)
+{
+	guint ii;
+
+	for (ii = 0; ii < CAMEL_BLOCK_SIZE; ii++)
+		bl->data[ii] = (index * 7 + ii) & 0xff;
+}
+
+static gboolean
+check_block (CamelBlock *bl,
+             guint index)
+{
+	guint ii;
+
+	for (ii = 0; ii < CAMEL_BLOCK_SIZE; ii++) {
+		if (bl->data[ii] != ((index * 7 + ii) & 0xff))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* writes N_BLOCKS blocks and verifies their content, also after reopen */
+static void
+write_and_verify (const gchar *path,
+                  gboolean use_mmap)
+{
+	CamelBlockFileStats stats;
+	CamelBlockFile *bs;
+	camel_block_t ids[N_BLOCKS];
+	gint old_limit;
+	guint ii;
+
+	/* limit the cache only by the per-file limit */
+	old_limit = camel_block_file_get_shared_cache_limit ();
+	camel_block_file_set_shared_cache_limit (0);
+
+	bs = camel_block_file_new (path, O_RDWR | O_CREAT | O_TRUNC, "TESTBLKS", CAMEL_BLOCK_SIZE);
+	g_assert_nonnull (bs);
+	camel_block_file_set_use_mmap (bs, use_mmap);
+	camel_block_file_set_cache_limit (bs, 16);
+
+	for (ii = 0; ii < N_BLOCKS; ii++) {
+		CamelBlock *bl;
+
+		bl = camel_block_file_new_block (bs);
+		g_assert_nonnull (bl);
+		ids[ii] = bl->id;
+		fill_block (bl, ii);
+		camel_block_file_touch_block (bs, bl);
+		camel_block_file_unref_block (bs, bl);
+	}
+
+	/* most of the blocks had been evicted and written meanwhile */
+	for (ii = 0; ii < N_BLOCKS; ii++) {
+		CamelBlock *bl;
+
+		bl = camel_block_file_get_block (bs, ids[ii]);
+		g_assert_nonnull (bl);
+		g_assert_true (check_block (bl, ii));
+		camel_block_file_unref_block (bs, bl);
+	}
+
+	g_assert_cmpint (camel_block_file_sync (bs), ==, 0);
+
+	camel_block_file_get_stats (bs, &stats);
+	g_assert_cmpuint (stats.cache_misses, >, 0);
+	g_assert_cmpuint (stats.blocks_written, >=, N_BLOCKS);
+	/* adjacent evicted blocks are written together */
+	g_assert_cmpuint (stats.write_batches, <, stats.blocks_written);
+	if (!use_mmap)
+		g_assert_cmpuint (stats.mapped_reads, ==, 0);
+
+	g_object_unref (bs);
+
+	bs = camel_block_file_new (path, O_RDWR, "TESTBLKS", CAMEL_BLOCK_SIZE);
+	g_assert_nonnull (bs);
+	camel_block_file_set_use_mmap (bs, use_mmap);
+
+	for (ii = 0; ii < N_BLOCKS; ii++) {
+		CamelBlock *bl;
+
+		bl = camel_block_file_get_block (bs, ids[ii]);
+		g_assert_nonnull (bl);
+		g_assert_true (check_block (bl, ii));
+		camel_block_file_unref_block (bs, bl);
+	}
+
+	/* read the second time from the cache */
+	for (ii = N_BLOCKS - 10; ii < N_BLOCKS; ii++) {
+		CamelBlock *bl;
+
+		bl = camel_block_file_get_block (bs, ids[ii]);
+		g_assert_nonnull (bl);
+		camel_block_file_unref_block (bs, bl);
+	}
+
+	camel_block_file_get_stats (bs, &stats);
+	g_assert_cmpuint (stats.cache_misses, >=, N_BLOCKS);
+	g_assert_cmpuint (stats.cache_hits, >=, 10);
+	if (use_mmap && camel_block_file_get_use_mmap (bs))
+		g_assert_cmpuint (stats.mapped_reads, >, 0);
+
+	g_object_unref (bs);
+
+	camel_block_file_set_shared_cache_limit (old_limit);
+}
+
+static void
+test_read_write (void)
+{
+	gchar *path;
+
+	path = g_build_filename (camel_test_get_dir (), "blocks-fd", NULL);
+	write_and_verify (path, FALSE);
+	g_unlink (path);
+	g_free (path);
+}
+
+static void
+test_read_write_mmap (void)
+{
+	gchar *path;
+
+	path = g_build_filename (camel_test_get_dir (), "blocks-mmap", NULL);
+	write_and_verify (path, TRUE);
+	g_unlink (path);
+	g_free (path);
+}
+
+static void
+test_shared_cache (void)
+{
+	CamelBlockFileStats stats;
+	CamelBlockFile *bs;
+	camel_block_t ids[N_BLOCKS];
+	gchar *path;
+	gint old_limit;
+	guint ii;
+
+	old_limit = camel_block_file_get_shared_cache_limit ();
+	camel_block_file_set_shared_cache_limit (N_BLOCKS * 2);
+	g_assert_cmpint (camel_block_file_get_shared_cache_limit (), ==, N_BLOCKS * 2);
+
+	path = g_build_filename (camel_test_get_dir (), "blocks-shared", NULL);
+	bs = camel_block_file_new (path, O_RDWR | O_CREAT | O_TRUNC, "TESTBLKS", CAMEL_BLOCK_SIZE);
+	g_assert_nonnull (bs);
+	camel_block_file_set_cache_limit (bs, 16);
+
+	for (ii = 0; ii < N_BLOCKS; ii++) {
+		CamelBlock *bl;
+
+		bl = camel_block_file_new_block (bs);
+		g_assert_nonnull (bl);
+		ids[ii] = bl->id;
+		fill_block (bl, ii);
+		camel_block_file_touch_block (bs, bl);
+		camel_block_file_unref_block (bs, bl);
+	}
+
+	/* the file can use the shared cache over its own limit, thus nothing was evicted */
+	camel_block_file_get_stats (bs, &stats);
+	g_assert_cmpuint (stats.blocks_written, <=, 1);
+
+	for (ii = 0; ii < N_BLOCKS; ii++) {
+		CamelBlock *bl;
+
+		bl = camel_block_file_get_block (bs, ids[ii]);
+		g_assert_nonnull (bl);
+		g_assert_true (check_block (bl, ii));
+		camel_block_file_unref_block (bs, bl);
+	}
+
+	g_assert_cmpint (camel_block_file_sync (bs), ==, 0);
+	camel_block_file_get_stats (bs, &stats);
+	g_assert_cmpuint (stats.cache_hits, >=, N_BLOCKS);
+
+	g_object_unref (bs);
+	g_unlink (path);
+	g_free (path);
+
+	camel_block_file_set_shared_cache_limit (old_limit);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	gint ret;
+
+	camel_test_init (&argc, &argv);
+
+	g_test_add_func ("/Camel/BlockFile/read-write", test_read_write);
+	g_test_add_func ("/Camel/BlockFile/read-write-mmap", test_read_write_mmap);
+	g_test_add_func ("/Camel/BlockFile/shared-cache", test_shared_cache);
+
+	ret = g_test_run ();
+	camel_test_shutdown ();
+	return ret;
+}
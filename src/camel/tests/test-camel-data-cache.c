@@ -0,0 +1,239 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "evolution-data-server-config.h"
+
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "camel-test.h"
+
+#define ITEM_SIZE 1000
+
+static CamelDataCache *
+new_data_cache (const gchar *name)
+{
+	CamelDataCache *cdc;
+	GError *error = NULL;
+	gchar *path;
+
+	path = g_build_filename (camel_test_get_dir (), name, NULL);
+	cdc = camel_data_cache_new (path, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (cdc);
+	g_free (path);
+
+	return cdc;
+}
+
+static void
+add_item (CamelDataCache *cdc,
+          const gchar *path,
+          guint index)
+{
+	GIOStream *stream, *committed;
+	GError *error = NULL;
+	gchar data[ITEM_SIZE], key[32];
+
+	g_snprintf (key, sizeof (key), "item-%u", index);
+	memset (data, 'a' + (index % 26), sizeof (data));
+
+	stream = camel_data_cache_add_atomic (cdc, path, key, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (stream);
+
+	g_output_stream_write_all (g_io_stream_get_output_stream (stream), data, sizeof (data), NULL, NULL, &error);
+	g_assert_no_error (error);
+
+	committed = camel_data_cache_commit_atomic (cdc, stream, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (committed);
+	g_object_unref (committed);
+}
+
+static gboolean
+has_item (CamelDataCache *cdc,
+          const gchar *path,
+          guint index)
+{
+	gchar *filename, key[32];
+	gboolean exists;
+
+	g_snprintf (key, sizeof (key), "item-%u", index);
+
+	filename = camel_data_cache_get_filename (cdc, path, key);
+	exists = g_file_test (filename, G_FILE_TEST_IS_REGULAR);
+	g_free (filename);
+
+	return exists;
+}
+
+static guint
+count_items (CamelDataCache *cdc,
+             const gchar *path,
+             guint n_added)
+{
+	guint ii, count = 0;
+
+	for (ii = 0; ii < n_added; ii++) {
+		if (has_item (cdc, path, ii))
+			count++;
+	}
+
+	return count;
+}
+
+static void
+test_expire_size (void)
+{
+	CamelDataCache *cdc;
+	GIOStream *stream;
+	guint ii;
+
+	cdc = new_data_cache ("expire-size");
+	camel_data_cache_set_expire_size (cdc, 10 * ITEM_SIZE);
+	g_assert_cmpint (camel_data_cache_get_expire_size (cdc), ==, 10 * ITEM_SIZE);
+
+	for (ii = 0; ii < 30; ii++) {
+		add_item (cdc, "cur", ii);
+
+		/* keep the first item the most recently used one */
+		stream = camel_data_cache_get (cdc, "cur", "item-0", NULL);
+		g_assert_nonnull (stream);
+		g_object_unref (stream);
+
+		g_assert_cmpuint (count_items (cdc, "cur", ii + 1), <=, 10);
+	}
+
+	g_assert_true (has_item (cdc, "cur", 0));
+	g_assert_true (has_item (cdc, "cur", 29));
+	g_assert_true (has_item (cdc, "cur", 28));
+	g_assert_false (has_item (cdc, "cur", 1));
+	g_assert_false (has_item (cdc, "cur", 2));
+	g_assert_cmpuint (count_items (cdc, "cur", 30), >=, 8);
+
+	/* disabled size limit does not expire anything */
+	camel_data_cache_set_expire_size (cdc, -1);
+
+	for (ii = 30; ii < 45; ii++) {
+		add_item (cdc, "cur", ii);
+	}
+
+	for (ii = 30; ii < 45; ii++) {
+		g_assert_true (has_item (cdc, "cur", ii));
+	}
+
+	camel_data_cache_clear (cdc, "cur");
+	g_object_unref (cdc);
+}
+
+static void
+test_expire_size_existing (void)
+{
+	CamelDataCache *cdc;
+	gchar *other_dir, *other_file, *data;
+	guint ii;
+
+	cdc = new_data_cache ("expire-existing");
+
+	for (ii = 0; ii < 6; ii++) {
+		add_item (cdc, "cur", ii);
+		add_item (cdc, "new", ii);
+	}
+
+	g_object_unref (cdc);
+
+	cdc = new_data_cache ("expire-existing");
+
+	/* other data stored beside the cache is not considered */
+	other_dir = g_build_filename (camel_data_cache_get_path (cdc), "subfolders", "other", NULL);
+	g_assert_cmpint (g_mkdir_with_parents (other_dir, 0700), ==, 0);
+	other_file = g_build_filename (other_dir, "cmeta", NULL);
+	data = g_strnfill (20 * ITEM_SIZE, 'x');
+	g_assert_true (g_file_set_contents (other_file, data, -1, NULL));
+	g_free (data);
+
+	camel_data_cache_set_expire_size (cdc, 10 * ITEM_SIZE);
+
+	/* the items of both sub-caches are counted, not only of the used one */
+	add_item (cdc, "cur", 6);
+
+	g_assert_true (has_item (cdc, "cur", 6));
+	g_assert_cmpuint (count_items (cdc, "cur", 7) + count_items (cdc, "new", 6), <=, 10);
+	g_assert_cmpuint (count_items (cdc, "cur", 7) + count_items (cdc, "new", 6), >=, 8);
+	g_assert_true (g_file_test (other_file, G_FILE_TEST_IS_REGULAR));
+
+	g_unlink (other_file);
+	g_free (other_file);
+	g_free (other_dir);
+
+	camel_data_cache_clear (cdc, "cur");
+	camel_data_cache_clear (cdc, "new");
+	g_object_unref (cdc);
+}
+
+static void
+test_expire_size_remove (void)
+{
+	CamelDataCache *cdc;
+	gchar key[32];
+	guint ii;
+
+	cdc = new_data_cache ("expire-remove");
+	camel_data_cache_set_expire_size (cdc, 10 * ITEM_SIZE);
+
+	for (ii = 0; ii < 9; ii++) {
+		add_item (cdc, "cur", ii);
+	}
+
+	for (ii = 0; ii < 5; ii++) {
+		g_snprintf (key, sizeof (key), "item-%u", ii);
+		g_assert_cmpint (camel_data_cache_remove (cdc, "cur", key, NULL), ==, 0);
+	}
+
+	/* the removed items do not count into the size anymore */
+	for (ii = 9; ii < 14; ii++) {
+		add_item (cdc, "cur", ii);
+	}
+
+	g_assert_cmpuint (count_items (cdc, "cur", 14), ==, 9);
+
+	for (ii = 5; ii < 14; ii++) {
+		g_assert_true (has_item (cdc, "cur", ii));
+	}
+
+	/* neither the cleared */
+	camel_data_cache_clear (cdc, "cur");
+	g_assert_cmpuint (count_items (cdc, "cur", 14), ==, 0);
+
+	for (ii = 20; ii < 29; ii++) {
+		add_item (cdc, "cur", ii);
+	}
+
+	for (ii = 20; ii < 29; ii++) {
+		g_assert_true (has_item (cdc, "cur", ii));
+	}
+
+	camel_data_cache_clear (cdc, "cur");
+	g_object_unref (cdc);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	gint ret;
+
+	camel_test_init (&argc, &argv);
+
+	g_test_add_func ("/Camel/DataCache/expire-size", test_expire_size);
+	g_test_add_func ("/Camel/DataCache/expire-size-existing", test_expire_size_existing);
+	g_test_add_func ("/Camel/DataCache/expire-size-remove", test_expire_size_remove);
+
+	ret = g_test_run ();
+	camel_test_shutdown ();
+	return ret;
+}
@@ -2261,6 +2261,177 @@ test_camel_db_basic (void)
 	g_free (filename);
 }
 
+static gint
+test_camel_db_read_freelist_count (CamelDB *cdb)
+{
+	gint count = -1;
+	gboolean success;
+	GError *error = NULL;
+
+	success = camel_db_exec_select (cdb, "PRAGMA freelist_count", test_read_integer_cb, &count, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+	g_assert_cmpint (count, !=, -1);
+
+	return count;
+}
+
+static void
+test_camel_db_maintenance (void)
+{
+	CamelDB *cdb;
+	GError *error = NULL;
+	gchar *filename;
+	guint64 reclaimed_total = 0;
+	gint last_percent = 0, n_slices = 0, auto_vacuum = -1;
+	gboolean success, finished = FALSE;
+
+	filename = test_create_tmp_file ();
+
+	cdb = camel_db_new (filename, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (cdb);
+
+	/* new files use the incremental auto-vacuum */
+	success = camel_db_exec_select (cdb, "PRAGMA auto_vacuum", test_read_integer_cb, &auto_vacuum, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+	g_assert_cmpint (auto_vacuum, ==, 2);
+
+	success = camel_db_exec_statement (cdb, "CREATE TABLE table1 (column1 INTEGER, columnA BLOB)", &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	success = camel_db_exec_statement (cdb,
+		"WITH RECURSIVE cnt(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM cnt WHERE x < 4000) "
+		"INSERT INTO table1 (column1, columnA) SELECT x, randomblob(1024) FROM cnt", &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	success = camel_db_exec_statement (cdb, "DELETE FROM table1", &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	/* more than one vacuum step is needed */
+	g_assert_cmpint (test_camel_db_read_freelist_count (cdb), >, 256);
+
+	while (!finished) {
+		guint64 reclaimed = 0;
+		gint percent = -1;
+
+		/* zero time means one step per slice */
+		success = camel_db_run_maintenance_slice (cdb, 0, &finished, &percent, &reclaimed, &error);
+		g_assert_no_error (error);
+		g_assert_true (success);
+		g_assert_cmpint (percent, >=, last_percent);
+		g_assert_cmpint (percent, <=, 100);
+
+		last_percent = percent;
+		reclaimed_total += reclaimed;
+		n_slices++;
+
+		g_assert_cmpint (n_slices, <, 1000);
+	}
+
+	g_assert_cmpint (n_slices, >, 2);
+	g_assert_cmpint (last_percent, ==, 100);
+	g_assert_cmpuint (reclaimed_total, >=, 4000 * 1024);
+	g_assert_cmpint (test_camel_db_read_freelist_count (cdb), ==, 0);
+
+	/* nothing left to do, the next maintenance finishes immediately */
+	success = camel_db_run_maintenance_slice (cdb, G_USEC_PER_SEC, &finished, NULL, &reclaimed_total, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+	g_assert_true (finished);
+	g_assert_cmpuint (reclaimed_total, ==, 0);
+
+	success = camel_db_maybe_run_maintenance (cdb, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	g_assert_cmpint (camel_db_get_idle_time (cdb), >=, 0);
+
+	g_object_unref (cdb);
+
+	g_assert_cmpint (g_unlink (filename), ==, 0);
+	g_free (filename);
+}
+
+static void
+test_camel_db_maintenance_convert (void)
+{
+	CamelDB *cdb;
+	GError *error = NULL;
+	gchar *filename;
+	guint64 reclaimed_total = 0;
+	gint n_slices = 0, auto_vacuum = -1;
+	gboolean success, finished = FALSE;
+
+	filename = test_create_tmp_file ();
+
+	cdb = camel_db_new (filename, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (cdb);
+
+	/* make it look like a file created before the incremental auto-vacuum */
+	success = camel_db_exec_statement (cdb, "PRAGMA auto_vacuum = NONE", &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	success = camel_db_exec_statement (cdb, "VACUUM", &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	success = camel_db_exec_statement (cdb, "CREATE TABLE table1 (column1 INTEGER, columnA BLOB)", &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	success = camel_db_exec_select (cdb, "PRAGMA auto_vacuum", test_read_integer_cb, &auto_vacuum, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+	g_assert_cmpint (auto_vacuum, ==, 0);
+
+	success = camel_db_exec_statement (cdb,
+		"WITH RECURSIVE cnt(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM cnt WHERE x < 1000) "
+		"INSERT INTO table1 (column1, columnA) SELECT x, randomblob(1024) FROM cnt", &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	success = camel_db_exec_statement (cdb, "DELETE FROM table1", &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	g_assert_cmpint (test_camel_db_read_freelist_count (cdb), >, 0);
+
+	/* the first maintenance converts the file and releases the free pages */
+	while (!finished) {
+		guint64 reclaimed = 0;
+
+		success = camel_db_run_maintenance_slice (cdb, 0, &finished, NULL, &reclaimed, &error);
+		g_assert_no_error (error);
+		g_assert_true (success);
+
+		reclaimed_total += reclaimed;
+		n_slices++;
+
+		g_assert_cmpint (n_slices, <, 10);
+	}
+
+	auto_vacuum = -1;
+	success = camel_db_exec_select (cdb, "PRAGMA auto_vacuum", test_read_integer_cb, &auto_vacuum, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+	g_assert_cmpint (auto_vacuum, ==, 2);
+
+	g_assert_cmpint (test_camel_db_read_freelist_count (cdb), ==, 0);
+	g_assert_cmpuint (reclaimed_total, >=, 1000 * 1024);
+
+	g_object_unref (cdb);
+
+	g_assert_cmpint (g_unlink (filename), ==, 0);
+	g_free (filename);
+}
+
 static void
 test_camel_store_db_empty (void)
 {
@@ -2636,6 +2807,8 @@ main (gint argc,
 	g_test_bug_base ("https://gitlab.gnome.org/GNOME/evolution-data-server/-/issues/");
 
 	g_test_add_func ("/Camel/CamelDB/Basic", test_camel_db_basic);
+	g_test_add_func ("/Camel/CamelDB/Maintenance", test_camel_db_maintenance);
+	g_test_add_func ("/Camel/CamelDB/MaintenanceConvert", test_camel_db_maintenance_convert);
 	g_test_add_func ("/Camel/CamelStoreDB/Empty", test_camel_store_db_empty);
 	g_test_add_func ("/Camel/CamelStoreDB/Keys", test_camel_store_db_keys);
 	g_test_add_func ("/Camel/CamelStoreDB/FolderOps", test_camel_store_db_folder_ops);
@@ -0,0 +1,167 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "evolution-data-server-config.h"
+
+#include <string.h>
+
+#include "camel-test.h"
+#include "messages.h"
+#include "session.h"
+
+#define N_MESSAGES 15
+
+/* the parsed match expressions and actions are reused between the messages,
+   which should not change any result, even after a failed evaluation */
+static struct {
+	const gchar *name, *match, *action;
+} rules[] = {
+	{ "even", "(header-contains \"subject\" \"even\")", "(set-label \"even\")" },
+	{ "third", "(header-matches \"x-test-third\" \"yes\")", "(adjust-score 3)" },
+	{ "fail", "(and (header-contains \"subject\" \"fail\") (header-regex \"subject\" \"[\"))", "(set-label \"failed\")" },
+	{ "odd", "(not (header-contains \"subject\" \"even\"))", "(set-label \"odd\")" },
+	{ "score", "(header-contains \"subject\" \"message\")", "(adjust-score 1)" }
+};
+
+static CamelMimeMessage *
+test_create_message (guint index)
+{
+	CamelMimeMessage *msg;
+	gchar *subject;
+
+	msg = test_message_create_simple ();
+
+	subject = g_strdup_printf ("Test message %u %s%s", index,
+		(index % 2) == 0 ? "even" : "other",
+		(index % 5) == 4 ? " fail" : "");
+	camel_mime_message_set_subject (msg, subject);
+	g_free (subject);
+
+	if ((index % 3) == 0)
+		camel_medium_set_header (CAMEL_MEDIUM (msg), "X-Test-Third", "yes");
+
+	return msg;
+}
+
+static CamelMimeMessage *
+test_get_message_cb (gpointer user_data,
+		     GCancellable *cancellable,
+		     GError **error)
+{
+	return g_object_ref (user_data);
+}
+
+static void
+test_filter_messages (CamelFilterDriver *driver)
+{
+	guint ii;
+
+	for (ii = 0; ii < N_MESSAGES; ii++) {
+		CamelMimeMessage *msg;
+		CamelMessageInfo *info;
+		GError *error = NULL;
+		gchar expected_score[16];
+		gint res;
+
+		msg = test_create_message (ii);
+		info = camel_message_info_new_from_message (NULL, msg);
+
+		res = camel_filter_driver_filter_message (driver, msg, info, NULL, NULL, NULL, NULL, NULL, &error);
+
+		/* the rules after the failed rule are not applied */
+		if ((ii % 5) == 4) {
+			g_assert_error (error, CAMEL_ERROR, CAMEL_ERROR_GENERIC);
+			g_assert_cmpint (res, ==, -1);
+			g_assert_false (camel_message_info_get_user_flag (info, "odd"));
+			g_assert_cmpstr (camel_message_info_get_user_tag (info, "score"), ==, (ii % 3) == 0 ? "3" : NULL);
+			g_clear_error (&error);
+		} else {
+			g_assert_no_error (error);
+			g_assert_cmpint (res, ==, 0);
+			g_assert_cmpint (camel_message_info_get_user_flag (info, "odd") ? 1 : 0, ==, (ii % 2) == 0 ? 0 : 1);
+
+			g_snprintf (expected_score, sizeof (expected_score), "%d", (ii % 3) == 0 ? 4 : 1);
+			g_assert_cmpstr (camel_message_info_get_user_tag (info, "score"), ==, expected_score);
+		}
+
+		g_assert_cmpint (camel_message_info_get_user_flag (info, "even") ? 1 : 0, ==, (ii % 2) == 0 ? 1 : 0);
+		g_assert_false (camel_message_info_get_user_flag (info, "failed"));
+
+		g_object_unref (info);
+		g_object_unref (msg);
+	}
+}
+
+static void
+test_filter_driver_reuse (void)
+{
+	CamelSession *session;
+	CamelFilterDriver *driver;
+	CamelMimeMessage *msg;
+	CamelMessageInfo *info;
+	guint ii;
+
+	session = camel_test_session_new (camel_test_get_dir ());
+
+	driver = camel_filter_driver_new (session);
+
+	for (ii = 0; ii < G_N_ELEMENTS (rules); ii++) {
+		camel_filter_driver_add_rule (driver, rules[ii].name, rules[ii].match, rules[ii].action);
+	}
+
+	/* the first run parses the expressions, the second reuses them */
+	test_filter_messages (driver);
+	test_filter_messages (driver);
+
+	/* more expressions than are kept, which evicts the rules' expressions */
+	msg = test_create_message (0);
+	info = camel_message_info_new_from_message (NULL, msg);
+
+	for (ii = 0; ii < 600; ii++) {
+		GError *error = NULL;
+		gchar *expression;
+		gint res;
+
+		expression = g_strdup_printf ("(header-contains \"subject\" \"flood%u\")", ii);
+		res = camel_filter_search_match_with_log (session, test_get_message_cb, msg, info,
+			NULL, NULL, expression, NULL, NULL, &error);
+		g_assert_no_error (error);
+		g_assert_cmpint (res, ==, CAMEL_SEARCH_NOMATCH);
+		g_free (expression);
+	}
+
+	g_object_unref (info);
+	g_object_unref (msg);
+
+	test_filter_messages (driver);
+
+	/* a new driver with the same rules */
+	g_object_unref (driver);
+	driver = camel_filter_driver_new (session);
+
+	for (ii = 0; ii < G_N_ELEMENTS (rules); ii++) {
+		camel_filter_driver_add_rule (driver, rules[ii].name, rules[ii].match, rules[ii].action);
+	}
+
+	test_filter_messages (driver);
+
+	g_object_unref (driver);
+	g_object_unref (session);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	gint ret;
+
+	camel_test_init (&argc, &argv);
+
+	g_test_add_func ("/Camel/FilterDriver/reuse", test_filter_driver_reuse);
+
+	ret = g_test_run ();
+	camel_test_shutdown ();
+	return ret;
+}
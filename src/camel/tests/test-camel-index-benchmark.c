@@ -0,0 +1,299 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+/* A benchmark of the body indexes. It indexes a reproducible set of synthetic
+ * messages, with words following a Zipf-like distribution, into
+ * the #CamelTextIndex and into the #CamelPostingsIndex, and reports the build
+ * time, the size on disk and the time of the word lookups.
+ *
+ * Run it in the performance mode, to index a folder of a million messages:
+ *
+ *    test-camel-index-benchmark -m perf [--messages N]
+ */
+
+#include "evolution-data-server-config.h"
+
+#include <fcntl.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "camel-test.h"
+
+#define VOCABULARY_SIZE 60000
+#define N_QUERIES 2000
+
+static guint n_messages = 0;
+static gchar **vocabulary = NULL;
+static gdouble *cumulative = NULL;
+
+typedef CamelIndex * (* BenchmarkOpenFunc) (const gchar *path, gint flags);
+
+static void
+benchmark_build_vocabulary (void)
+{
+	static const gchar *syllables[] = {
+		"ka", "lo", "mi", "ne", "po", "ra", "su", "te", "vi", "za",
+		"bre", "cho", "dri", "fla", "gro", "shi", "tra", "ple", "sto", "qua"
+	};
+	GRand *rnd;
+	gdouble sum = 0.0;
+	guint ii;
+
+	rnd = g_rand_new_with_seed (4);
+
+	vocabulary = g_new0 (gchar *, VOCABULARY_SIZE + 1);
+	cumulative = g_new (gdouble, VOCABULARY_SIZE);
+
+	for (ii = 0; ii < VOCABULARY_SIZE; ii++) {
+		GString *word = g_string_new ("");
+		guint jj, n_syllables = 2 + (ii % 4);
+
+		for (jj = 0; jj < n_syllables; jj++)
+			g_string_append (word, syllables[g_rand_int_range (rnd, 0, G_N_ELEMENTS (syllables))]);
+
+		/* make the words unique */
+		g_string_append_printf (word, "%u", ii);
+
+		vocabulary[ii] = g_string_free (word, FALSE);
+
+		sum += 1.0 / (ii + 1);
+		cumulative[ii] = sum;
+	}
+
+	for (ii = 0; ii < VOCABULARY_SIZE; ii++)
+		cumulative[ii] /= sum;
+
+	g_rand_free (rnd);
+}
+
+static const gchar *
+benchmark_random_word (GRand *rnd)
+{
+	gdouble value = g_rand_double (rnd);
+	guint lo = 0, hi = VOCABULARY_SIZE - 1;
+
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+
+		if (cumulative[mid] < value)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return vocabulary[lo];
+}
+
+static void
+benchmark_gen_body (GString *body,
+                    GRand *rnd)
+{
+	guint ii, n_words = g_rand_int_range (rnd, 40, 400);
+
+	g_string_truncate (body, 0);
+
+	for (ii = 0; ii < n_words; ii++) {
+		if (ii > 0)
+			g_string_append_c (body, (ii % 12) == 0 ? '\n' : ' ');
+		g_string_append (body, benchmark_random_word (rnd));
+	}
+}
+
+static guint64
+benchmark_files_size (const gchar *path)
+{
+	GDir *dir;
+	gchar *dirname, *basename;
+	const gchar *name;
+	guint64 size = 0;
+
+	dirname = g_path_get_dirname (path);
+	basename = g_path_get_basename (path);
+
+	dir = g_dir_open (dirname, 0, NULL);
+	while (dir && (name = g_dir_read_name (dir)) != NULL) {
+		GStatBuf st;
+		gchar *filename;
+
+		if (!g_str_has_prefix (name, basename) || name[strlen (basename)] != '.')
+			continue;
+
+		filename = g_build_filename (dirname, name, NULL);
+		if (g_stat (filename, &st) == 0)
+			size += st.st_size;
+		g_free (filename);
+	}
+
+	if (dir)
+		g_dir_close (dir);
+
+	g_free (dirname);
+	g_free (basename);
+
+	return size;
+}
+
+static void
+benchmark_run (const gchar *label,
+               const gchar *path,
+               BenchmarkOpenFunc open_func)
+{
+	CamelIndex *idx;
+	GString *body;
+	GTimer *timer;
+	GRand *rnd;
+	gdouble build_time, query_time;
+	guint64 n_found = 0;
+	guint ii;
+
+	body = g_string_sized_new (4096);
+	rnd = g_rand_new_with_seed (42);
+
+	idx = open_func (path, O_RDWR | O_CREAT | O_TRUNC);
+	g_assert_nonnull (idx);
+
+	timer = g_timer_new ();
+
+	for (ii = 0; ii < n_messages; ii++) {
+		CamelIndexName *idn;
+		gchar uid[16];
+
+		benchmark_gen_body (body, rnd);
+		g_snprintf (uid, sizeof (uid), "%u", ii + 1);
+
+		/* the same as the folder summary does */
+		idn = camel_index_add_name (idx, uid);
+		camel_index_name_add_buffer (idn, body->str, body->len);
+		camel_index_write_name (idx, idn);
+		g_object_unref (idn);
+	}
+
+	g_assert_cmpint (camel_index_sync (idx), ==, 0);
+	g_object_unref (idx);
+
+	g_timer_stop (timer);
+	build_time = g_timer_elapsed (timer, NULL);
+
+	idx = open_func (path, O_RDONLY);
+	g_assert_nonnull (idx);
+
+	g_timer_start (timer);
+
+	for (ii = 0; ii < N_QUERIES; ii++) {
+		CamelIndexCursor *idc;
+		const gchar *word;
+
+		/* the less frequent words are queried more often, like by a user */
+		word = vocabulary[g_rand_int_range (rnd, 0, VOCABULARY_SIZE)];
+
+		idc = camel_index_find (idx, word);
+		g_assert_nonnull (idc);
+		while (camel_index_cursor_next (idc) != NULL)
+			n_found++;
+		g_object_unref (idc);
+	}
+
+	/* also the most frequent words, with the longest lists */
+	for (ii = 0; ii < 10; ii++) {
+		CamelIndexCursor *idc;
+
+		idc = camel_index_find (idx, vocabulary[ii]);
+		g_assert_nonnull (idc);
+		while (camel_index_cursor_next (idc) != NULL)
+			n_found++;
+		g_object_unref (idc);
+	}
+
+	g_timer_stop (timer);
+	query_time = g_timer_elapsed (timer, NULL);
+
+	g_object_unref (idx);
+
+	g_test_message ("%-16s %8u msgs  build %8.3f s (%10.1f msgs/s)  size %8.2f MB  %u queries %8.3f s (%lu names)",
+		label, n_messages, build_time, build_time > 0.0 ? n_messages / build_time : 0.0,
+		benchmark_files_size (path) / (1024.0 * 1024.0),
+		N_QUERIES + 10, query_time, (gulong) n_found);
+
+	if (g_test_perf ()) {
+		g_test_maximized_result (build_time > 0.0 ? n_messages / build_time : 0.0, "%s build: %.1f msgs/s", label, n_messages / build_time);
+		g_test_minimized_result (query_time, "%s queries: %.3f s", label, query_time);
+	}
+
+	g_assert_cmpuint (n_found, >, 0);
+
+	g_timer_destroy (timer);
+	g_rand_free (rnd);
+	g_string_free (body, TRUE);
+}
+
+static CamelIndex *
+benchmark_open_text_index (const gchar *path,
+                           gint flags)
+{
+	return (CamelIndex *) camel_text_index_new (path, flags);
+}
+
+static CamelIndex *
+benchmark_open_postings_index (const gchar *path,
+                               gint flags)
+{
+	return (CamelIndex *) camel_postings_index_new (path, flags);
+}
+
+static void
+test_benchmark_text_index (void)
+{
+	gchar *path;
+
+	path = g_build_filename (camel_test_get_dir (), "bench-text", NULL);
+	benchmark_run ("text index", path, benchmark_open_text_index);
+	camel_text_index_remove (path);
+	g_free (path);
+}
+
+static void
+test_benchmark_postings_index (void)
+{
+	gchar *path;
+
+	path = g_build_filename (camel_test_get_dir (), "bench-postings", NULL);
+	benchmark_run ("postings index", path, benchmark_open_postings_index);
+	camel_postings_index_remove (path);
+	g_free (path);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	gint ret, ii;
+
+	camel_test_init (&argc, &argv);
+
+	for (ii = 1; ii < argc; ii++) {
+		if (g_strcmp0 (argv[ii], "--messages") == 0 && ii + 1 < argc) {
+			n_messages = (guint) g_ascii_strtoull (argv[ii + 1], NULL, 10);
+			ii++;
+		}
+	}
+
+	if (!n_messages)
+		n_messages = g_test_perf () ? 1000000 : 5000;
+
+	benchmark_build_vocabulary ();
+
+	g_test_add_func ("/Camel/IndexBenchmark/TextIndex", test_benchmark_text_index);
+	g_test_add_func ("/Camel/IndexBenchmark/PostingsIndex", test_benchmark_postings_index);
+
+	ret = g_test_run ();
+
+	g_strfreev (vocabulary);
+	g_free (cumulative);
+
+	camel_test_shutdown ();
+
+	return ret;
+}
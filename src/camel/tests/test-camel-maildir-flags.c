@@ -476,6 +476,571 @@ test_maildir_external_multiple_flags_removed (void)
 	g_clear_object (&session);
 }
 
+static void
+test_maildir_external_changes_while_open (void)
+{
+	CamelSession *session;
+	CamelService *service;
+	CamelStore *store;
+	CamelLocalSettings *local_settings;
+	CamelFolder *folder;
+	CamelMimeMessage *msg;
+	CamelMessageInfo *info;
+	gchar *store_path;
+	gchar *cur_path;
+	gchar *new_path;
+	gchar *path;
+	gchar *uid1 = NULL, *uid2 = NULL, *uid3 = NULL;
+	CamelFolderSummary *summary;
+	guint n_full_checks = 0, n_full_checks2 = 0;
+	GError *error = NULL;
+
+	session = g_object_new (CAMEL_TYPE_TEST_SESSION,
+		"user-data-dir", camel_test_get_dir (),
+		"user-cache-dir", camel_test_get_dir (),
+		NULL);
+
+	store_path = g_build_filename (camel_test_get_dir (), "test-while-open", NULL);
+
+	service = camel_session_add_service (session, "test-while-open", "maildir", CAMEL_PROVIDER_STORE, &error);
+	g_assert_no_error (error);
+	store = CAMEL_STORE (service);
+
+	local_settings = CAMEL_LOCAL_SETTINGS (camel_service_ref_settings (service));
+	camel_local_settings_set_path (local_settings, store_path);
+	g_object_unref (local_settings);
+
+	g_mkdir_with_parents (store_path, 0700);
+
+	folder = camel_store_get_folder_sync (store, "testbox", CAMEL_STORE_FOLDER_CREATE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (folder);
+
+	cur_path = g_build_filename (store_path, ".testbox", "cur", NULL);
+	new_path = g_build_filename (store_path, ".testbox", "new", NULL);
+
+	msg = create_message ("Changed externally");
+	camel_folder_append_message_sync (folder, msg, NULL, &uid1, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (uid1);
+	g_object_unref (msg);
+
+	msg = create_message ("Deleted externally");
+	camel_folder_append_message_sync (folder, msg, NULL, &uid2, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (uid2);
+	g_object_unref (msg);
+
+	msg = create_message ("Deleted externally later");
+	camel_folder_append_message_sync (folder, msg, NULL, &uid3, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (uid3);
+	g_object_unref (msg);
+
+	camel_folder_synchronize_sync (folder, FALSE, NULL, NULL);
+	camel_folder_refresh_info_sync (folder, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (camel_folder_get_message_count (folder), ==, 3);
+
+	summary = camel_folder_get_folder_summary (folder);
+	g_object_get (summary, "n-full-checks", &n_full_checks, NULL);
+	g_assert_cmpuint (n_full_checks, >, 0);
+
+	/* Change the folder content behind the back of the opened folder,
+	   the following refreshes can use only the monitored changes */
+	path = find_message_file_in_cur (cur_path, uid2);
+	g_assert_nonnull (path);
+	g_assert_cmpint (g_unlink (path), ==, 0);
+	g_free (path);
+
+	rename_message_flags (cur_path, uid1, "S");
+
+	path = g_build_filename (new_path, "1234567890.1_1.example.com", NULL);
+	g_assert_true (g_file_set_contents (path,
+		"From: sender@example.com\n"
+		"To: recipient@example.com\n"
+		"Subject: Delivered externally\n"
+		"\n"
+		"Test body\n", -1, NULL));
+	g_free (path);
+
+	camel_folder_refresh_info_sync (folder, NULL, &error);
+	g_assert_no_error (error);
+
+	g_assert_cmpint (camel_folder_get_message_count (folder), ==, 3);
+
+	/* only the reported files had been checked, not the whole directory */
+	g_object_get (summary, "n-full-checks", &n_full_checks2, NULL);
+	g_assert_cmpuint (n_full_checks2, ==, n_full_checks);
+
+	info = camel_folder_get_message_info (folder, uid1);
+	g_assert_nonnull (info);
+	g_assert_true ((camel_message_info_get_flags (info) & CAMEL_MESSAGE_SEEN) != 0);
+	g_clear_object (&info);
+
+	info = camel_folder_get_message_info (folder, uid2);
+	g_assert_null (info);
+
+	info = camel_folder_get_message_info (folder, "1234567890.1_1.example.com");
+	g_assert_nonnull (info);
+	g_assert_cmpstr (camel_message_info_get_subject (info), ==, "Delivered externally");
+	g_clear_object (&info);
+
+	/* Nothing changed, nothing to be found */
+	camel_folder_refresh_info_sync (folder, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (camel_folder_get_message_count (folder), ==, 3);
+
+	g_object_get (summary, "n-full-checks", &n_full_checks2, NULL);
+	g_assert_cmpuint (n_full_checks2, ==, n_full_checks);
+
+	/* The directory changed after the last change, which the events can tell
+	   the time of, thus the modification time makes it read the whole directory,
+	   in case any event had been lost */
+	path = find_message_file_in_cur (cur_path, uid3);
+	g_assert_nonnull (path);
+	g_assert_cmpint (g_unlink (path), ==, 0);
+	g_free (path);
+
+	camel_folder_refresh_info_sync (folder, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (camel_folder_get_message_count (folder), ==, 2);
+
+	info = camel_folder_get_message_info (folder, uid3);
+	g_assert_null (info);
+
+	g_object_get (summary, "n-full-checks", &n_full_checks2, NULL);
+	g_assert_cmpuint (n_full_checks2, ==, n_full_checks + 1);
+
+	g_clear_object (&folder);
+	g_free (uid1);
+	g_free (uid2);
+	g_free (uid3);
+	g_free (cur_path);
+	g_free (new_path);
+	g_object_unref (store);
+	g_free (store_path);
+	g_clear_object (&session);
+}
+
+static void
+test_maildir_import_many (void)
+{
+	CamelSession *session;
+	CamelService *service;
+	CamelStore *store;
+	CamelLocalSettings *local_settings;
+	CamelFolder *folder;
+	CamelMessageInfo *info;
+	gchar *store_path;
+	gchar *cur_path;
+	guint ii, n_messages = 300;
+	GError *error = NULL;
+
+	session = g_object_new (CAMEL_TYPE_TEST_SESSION,
+		"user-data-dir", camel_test_get_dir (),
+		"user-cache-dir", camel_test_get_dir (),
+		NULL);
+
+	store_path = g_build_filename (camel_test_get_dir (), "test-import-many", NULL);
+
+	service = camel_session_add_service (session, "test-import-many", "maildir", CAMEL_PROVIDER_STORE, &error);
+	g_assert_no_error (error);
+	store = CAMEL_STORE (service);
+
+	local_settings = CAMEL_LOCAL_SETTINGS (camel_service_ref_settings (service));
+	camel_local_settings_set_path (local_settings, store_path);
+	g_object_unref (local_settings);
+
+	g_mkdir_with_parents (store_path, 0700);
+
+	folder = camel_store_get_folder_sync (store, "testbox", CAMEL_STORE_FOLDER_CREATE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (folder);
+	g_clear_object (&folder);
+
+	cur_path = g_build_filename (store_path, ".testbox", "cur", NULL);
+
+	/* enough messages to be summarised in the worker threads */
+	for (ii = 0; ii < n_messages; ii++) {
+		gchar *name, *path, *content;
+
+		name = g_strdup_printf ("%u.%u_0.example.com%c2,%s", 1700000000 + ii, ii,
+			CAMEL_MAILDIR_FILENAME_FLAG_SEP, (ii % 2) == 0 ? "S" : "");
+		path = g_build_filename (cur_path, name, NULL);
+		content = g_strdup_printf (
+			"From: sender@example.com\n"
+			"To: recipient@example.com\n"
+			"Subject: Imported message %u\n"
+			"\n"
+			"Body %u\n", ii, ii);
+
+		g_assert_true (g_file_set_contents (path, content, -1, NULL));
+
+		g_free (content);
+		g_free (path);
+		g_free (name);
+	}
+
+	folder = camel_store_get_folder_sync (store, "testbox", 0, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (folder);
+
+	camel_folder_refresh_info_sync (folder, NULL, &error);
+	g_assert_no_error (error);
+
+	g_assert_cmpint (camel_folder_get_message_count (folder), ==, n_messages);
+
+	for (ii = 0; ii < n_messages; ii++) {
+		gchar *uid, *subject;
+
+		uid = g_strdup_printf ("%u.%u_0.example.com", 1700000000 + ii, ii);
+		subject = g_strdup_printf ("Imported message %u", ii);
+
+		info = camel_folder_get_message_info (folder, uid);
+		g_assert_nonnull (info);
+		g_assert_cmpstr (camel_message_info_get_subject (info), ==, subject);
+		g_assert_cmpint ((camel_message_info_get_flags (info) & CAMEL_MESSAGE_SEEN) != 0, ==, (ii % 2) == 0);
+		g_clear_object (&info);
+
+		g_free (subject);
+		g_free (uid);
+	}
+
+	g_clear_object (&folder);
+	g_free (cur_path);
+	g_object_unref (store);
+	g_free (store_path);
+	g_clear_object (&session);
+}
+
+static CamelStore *
+create_local_store (CamelSession *session,
+                    const gchar *uid,
+                    const gchar *protocol)
+{
+	CamelService *service;
+	CamelLocalSettings *local_settings;
+	gchar *store_path;
+	GError *error = NULL;
+
+	store_path = g_build_filename (camel_test_get_dir (), uid, NULL);
+	g_mkdir_with_parents (store_path, 0700);
+
+	service = camel_session_add_service (session, uid, protocol, CAMEL_PROVIDER_STORE, &error);
+	g_assert_no_error (error);
+
+	local_settings = CAMEL_LOCAL_SETTINGS (camel_service_ref_settings (service));
+	camel_local_settings_set_path (local_settings, store_path);
+	g_object_unref (local_settings);
+
+	g_free (store_path);
+
+	return CAMEL_STORE (service);
+}
+
+static void
+check_transferred_messages (CamelFolder *folder,
+                            GPtrArray *transferred_uids,
+                            guint n_messages)
+{
+	guint ii;
+
+	g_assert_nonnull (transferred_uids);
+	g_assert_cmpuint (transferred_uids->len, ==, n_messages);
+	g_assert_cmpint (camel_folder_get_message_count (folder), ==, n_messages);
+
+	for (ii = 0; ii < n_messages; ii++) {
+		CamelMessageInfo *info;
+		CamelMimeMessage *msg;
+		gchar *subject;
+
+		subject = g_strdup_printf ("Transferred message %u", ii);
+
+		info = camel_folder_get_message_info (folder, transferred_uids->pdata[ii]);
+		g_assert_nonnull (info);
+		g_assert_cmpstr (camel_message_info_get_subject (info), ==, subject);
+		g_assert_cmpint ((camel_message_info_get_flags (info) & CAMEL_MESSAGE_SEEN) != 0, ==, (ii % 2) == 0);
+		g_clear_object (&info);
+
+		msg = camel_folder_get_message_sync (folder, transferred_uids->pdata[ii], NULL, NULL);
+		g_assert_nonnull (msg);
+		g_assert_cmpstr (camel_mime_message_get_subject (msg), ==, subject);
+		g_assert_null (camel_medium_get_header (CAMEL_MEDIUM (msg), "X-Evolution"));
+		g_object_unref (msg);
+
+		g_free (subject);
+	}
+}
+
+static gchar *
+build_maildir_cur_path (const gchar *store_name,
+                        const gchar *folder_name)
+{
+	gchar *dir_name, *cur_path;
+
+	dir_name = g_strconcat (".", folder_name, NULL);
+	cur_path = g_build_filename (camel_test_get_dir (), store_name, dir_name, "cur", NULL);
+	g_free (dir_name);
+
+	return cur_path;
+}
+
+/* the raw transfer between maildir folders on the same file system
+   creates hard links, not copies of the message files */
+static void
+check_transferred_links (const gchar *source_store_name,
+                         const gchar *source_name,
+                         GPtrArray *source_uids,
+                         const gchar *dest_store_name,
+                         const gchar *dest_name,
+                         GPtrArray *transferred_uids)
+{
+	gchar *source_cur, *dest_cur;
+	guint ii;
+
+	g_assert_cmpuint (source_uids->len, ==, transferred_uids->len);
+
+	source_cur = build_maildir_cur_path (source_store_name, source_name);
+	dest_cur = build_maildir_cur_path (dest_store_name, dest_name);
+
+	for (ii = 0; ii < source_uids->len; ii++) {
+		GStatBuf source_st, dest_st;
+		gchar *source_file, *dest_file;
+
+		source_file = find_message_file_in_cur (source_cur, source_uids->pdata[ii]);
+		dest_file = find_message_file_in_cur (dest_cur, transferred_uids->pdata[ii]);
+		g_assert_nonnull (source_file);
+		g_assert_nonnull (dest_file);
+
+		g_assert_cmpint (g_stat (source_file, &source_st), ==, 0);
+		g_assert_cmpint (g_stat (dest_file, &dest_st), ==, 0);
+
+		g_assert_cmpuint (source_st.st_dev, ==, dest_st.st_dev);
+		g_assert_cmpuint (source_st.st_ino, ==, dest_st.st_ino);
+		g_assert_cmpuint (dest_st.st_nlink, >=, 2);
+
+		g_free (source_file);
+		g_free (dest_file);
+	}
+
+	g_free (source_cur);
+	g_free (dest_cur);
+}
+
+/* the raw transfer from an mbox folder copies the headers as they are in the mbox
+   file, while the parsed message would be written with "X-Raw-Check: raw" */
+static void
+check_transferred_raw_headers (const gchar *store_name,
+                               const gchar *dest_name,
+                               GPtrArray *transferred_uids)
+{
+	gchar *dest_cur;
+	guint ii;
+
+	dest_cur = build_maildir_cur_path (store_name, dest_name);
+
+	for (ii = 0; ii < transferred_uids->len; ii++) {
+		gchar *dest_file, *contents = NULL, *body;
+		GError *error = NULL;
+
+		dest_file = find_message_file_in_cur (dest_cur, transferred_uids->pdata[ii]);
+		g_assert_nonnull (dest_file);
+
+		g_file_get_contents (dest_file, &contents, NULL, &error);
+		g_assert_no_error (error);
+		g_assert_nonnull (contents);
+
+		g_assert_true (g_str_has_prefix (contents, "From: sender@example.com\n"));
+		g_assert_nonnull (strstr (contents, "\nX-Raw-Check:raw\n"));
+		g_assert_null (strstr (contents, "X-Evolution"));
+
+		body = g_strdup_printf ("\n\nBody of the message %u\n", ii);
+		g_assert_nonnull (strstr (contents, body));
+		g_free (body);
+
+		g_free (contents);
+		g_free (dest_file);
+	}
+
+	g_free (dest_cur);
+}
+
+/* writes the mbox file directly, thus the headers are not normalized by Camel */
+static void
+write_transfer_mbox (const gchar *filename,
+                     guint n_messages)
+{
+	GString *mbox;
+	GError *error = NULL;
+	guint ii;
+
+	mbox = g_string_new (NULL);
+
+	for (ii = 0; ii < n_messages; ii++) {
+		g_string_append_printf (mbox,
+			"From sender@example.com Mon Oct 19 10:%02u:00 2026\n"
+			"From: sender@example.com\n"
+			"To: recipient@example.com\n"
+			"Subject: Transferred message %u\n"
+			"Date: Mon, 19 Oct 2026 10:%02u:00 +0000\n"
+			"Message-ID: <raw-%u@example.com>\n"
+			"X-Raw-Check:raw\n"
+			"\n"
+			"Body of the message %u\n"
+			"\n",
+			ii, ii, ii, ii, ii);
+	}
+
+	g_file_set_contents (filename, mbox->str, mbox->len, &error);
+	g_assert_no_error (error);
+
+	g_string_free (mbox, TRUE);
+}
+
+static void
+fill_transfer_source (CamelFolder *folder,
+                      GPtrArray *uids,
+                      guint n_messages)
+{
+	guint ii;
+
+	for (ii = 0; ii < n_messages; ii++) {
+		CamelMimeMessage *msg;
+		CamelMessageInfo *info;
+		gchar *subject, *uid = NULL;
+		GError *error = NULL;
+
+		subject = g_strdup_printf ("Transferred message %u", ii);
+		msg = create_message (subject);
+
+		info = camel_message_info_new (NULL);
+		camel_message_info_set_flags (info, CAMEL_MESSAGE_SEEN, (ii % 2) == 0 ? CAMEL_MESSAGE_SEEN : 0);
+
+		camel_folder_append_message_sync (folder, msg, info, &uid, NULL, &error);
+		g_assert_no_error (error);
+		g_assert_nonnull (uid);
+
+		g_ptr_array_add (uids, uid);
+
+		g_clear_object (&info);
+		g_object_unref (msg);
+		g_free (subject);
+	}
+
+	camel_folder_synchronize_sync (folder, FALSE, NULL, NULL);
+}
+
+static void
+test_maildir_transfer_raw (void)
+{
+	CamelSession *session;
+	CamelStore *maildir_store, *other_store, *mbox_store;
+	CamelFolder *source, *dest;
+	GPtrArray *uids, *transferred_uids = NULL;
+	gchar *mbox_filename;
+	guint n_messages = 10, ii;
+	gboolean success;
+	GError *error = NULL;
+
+	session = g_object_new (CAMEL_TYPE_TEST_SESSION,
+		"user-data-dir", camel_test_get_dir (),
+		"user-cache-dir", camel_test_get_dir (),
+		NULL);
+
+	maildir_store = create_local_store (session, "test-transfer-maildir", "maildir");
+	other_store = create_local_store (session, "test-transfer-maildir-other", "maildir");
+	mbox_store = create_local_store (session, "test-transfer-mbox", "mbox");
+
+	/* maildir to maildir copy */
+	source = camel_store_get_folder_sync (maildir_store, "source", CAMEL_STORE_FOLDER_CREATE, NULL, &error);
+	g_assert_no_error (error);
+	dest = camel_store_get_folder_sync (maildir_store, "dest", CAMEL_STORE_FOLDER_CREATE, NULL, &error);
+	g_assert_no_error (error);
+
+	uids = g_ptr_array_new_with_free_func (g_free);
+	fill_transfer_source (source, uids, n_messages);
+
+	success = camel_folder_transfer_messages_to_sync (source, uids, dest, FALSE, &transferred_uids, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	check_transferred_messages (dest, transferred_uids, n_messages);
+	check_transferred_links ("test-transfer-maildir", "source", uids, "test-transfer-maildir", "dest", transferred_uids);
+	g_assert_cmpint (camel_folder_get_message_count (source), ==, n_messages);
+
+	g_clear_pointer (&transferred_uids, g_ptr_array_unref);
+	g_clear_object (&dest);
+
+	/* maildir to maildir copy between different stores */
+	dest = camel_store_get_folder_sync (other_store, "dest", CAMEL_STORE_FOLDER_CREATE, NULL, &error);
+	g_assert_no_error (error);
+
+	success = camel_folder_transfer_messages_to_sync (source, uids, dest, FALSE, &transferred_uids, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	check_transferred_messages (dest, transferred_uids, n_messages);
+	check_transferred_links ("test-transfer-maildir", "source", uids, "test-transfer-maildir-other", "dest", transferred_uids);
+	g_assert_cmpint (camel_folder_get_message_count (source), ==, n_messages);
+
+	g_clear_pointer (&transferred_uids, g_ptr_array_unref);
+	g_ptr_array_set_size (uids, 0);
+	g_clear_object (&source);
+	g_clear_object (&dest);
+
+	/* mbox to maildir move */
+	mbox_filename = g_build_filename (camel_test_get_dir (), "test-transfer-mbox", "source", NULL);
+	write_transfer_mbox (mbox_filename, n_messages);
+	g_free (mbox_filename);
+
+	source = camel_store_get_folder_sync (mbox_store, "source", 0, NULL, &error);
+	g_assert_no_error (error);
+	dest = camel_store_get_folder_sync (maildir_store, "dest-mbox", CAMEL_STORE_FOLDER_CREATE, NULL, &error);
+	g_assert_no_error (error);
+
+	success = camel_folder_refresh_info_sync (source, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	g_ptr_array_unref (uids);
+	uids = camel_folder_dup_uids (source);
+	g_assert_cmpuint (uids->len, ==, n_messages);
+	/* the mbox uids follow the order of the messages in the file */
+	camel_folder_sort_uids (source, uids);
+
+	for (ii = 0; ii < n_messages; ii++) {
+		camel_folder_set_message_flags (source, uids->pdata[ii], CAMEL_MESSAGE_SEEN,
+			(ii % 2) == 0 ? CAMEL_MESSAGE_SEEN : 0);
+	}
+
+	success = camel_folder_synchronize_sync (source, FALSE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	success = camel_folder_transfer_messages_to_sync (source, uids, dest, TRUE, &transferred_uids, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	check_transferred_messages (dest, transferred_uids, n_messages);
+	check_transferred_raw_headers ("test-transfer-maildir", "dest-mbox", transferred_uids);
+
+	/* the originals are only marked for deletion */
+	success = camel_folder_expunge_sync (source, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+	g_assert_cmpint (camel_folder_get_message_count (source), ==, 0);
+
+	g_clear_pointer (&transferred_uids, g_ptr_array_unref);
+	g_ptr_array_unref (uids);
+	g_clear_object (&source);
+	g_clear_object (&dest);
+	g_object_unref (maildir_store);
+	g_object_unref (other_store);
+	g_object_unref (mbox_store);
+	g_clear_object (&session);
+}
+
 gint
 main (gint argc,
       gchar **argv)
@@ -489,6 +1054,9 @@ main (gint argc,
 	g_test_add_func ("/Camel/maildir/flags/external-flag-removed", test_maildir_external_flag_removed);
 	g_test_add_func ("/Camel/maildir/flags/external-multiple-flags", test_maildir_external_multiple_flags);
 	g_test_add_func ("/Camel/maildir/flags/external-multiple-flags-removed", test_maildir_external_multiple_flags_removed);
+	g_test_add_func ("/Camel/maildir/flags/external-changes-while-open", test_maildir_external_changes_while_open);
+	g_test_add_func ("/Camel/maildir/flags/import-many", test_maildir_import_many);
+	g_test_add_func ("/Camel/maildir/flags/transfer-raw", test_maildir_transfer_raw);
 
 	ret = g_test_run ();
 	camel_test_shutdown ();
@@ -0,0 +1,420 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "camel-test.h"
+#include "camel-test-provider.h"
+#include "session.h"
+
+#include <camel/camel.h>
+
+#define N_MESSAGES 4
+
+static const gchar *local_drivers[] = { "local" };
+
+typedef struct _MboxFixture {
+	CamelSession *session;
+	CamelStore *store;
+	CamelFolder *folder;
+	gchar *mbox_path;
+	gchar *uids[N_MESSAGES];
+} MboxFixture;
+
+static CamelMimeMessage *
+create_message (guint index)
+{
+	CamelMimeMessage *msg;
+	CamelInternetAddress *addr;
+	gchar *subject, *body;
+
+	subject = g_strdup_printf ("Message %u", index);
+	body = g_strdup_printf ("Body of the message %u\n\nwith more than one line\n", index);
+
+	msg = camel_mime_message_new ();
+	camel_mime_message_set_subject (msg, subject);
+	camel_mime_message_set_date (msg, 0, 0);
+
+	addr = camel_internet_address_new ();
+	camel_internet_address_add (addr, "sender", "sender@example.com");
+	camel_mime_message_set_from (msg, addr);
+	g_object_unref (addr);
+
+	addr = camel_internet_address_new ();
+	camel_internet_address_add (addr, "recipient", "recipient@example.com");
+	camel_mime_message_set_recipients (msg, "To", addr);
+	g_object_unref (addr);
+
+	camel_mime_part_set_content (CAMEL_MIME_PART (msg), body, strlen (body), "text/plain");
+
+	g_free (subject);
+	g_free (body);
+
+	return msg;
+}
+
+static void
+mbox_fixture_init (MboxFixture *fixture,
+                   const gchar *name)
+{
+	CamelService *service;
+	CamelLocalSettings *local_settings;
+	gchar *store_path;
+	guint ii;
+	GError *error = NULL;
+
+	memset (fixture, 0, sizeof (MboxFixture));
+
+	fixture->session = g_object_new (CAMEL_TYPE_TEST_SESSION,
+		"user-data-dir", camel_test_get_dir (),
+		"user-cache-dir", camel_test_get_dir (),
+		NULL);
+
+	store_path = g_build_filename (camel_test_get_dir (), name, NULL);
+	g_mkdir_with_parents (store_path, 0700);
+
+	service = camel_session_add_service (fixture->session, name, "mbox", CAMEL_PROVIDER_STORE, &error);
+	g_assert_no_error (error);
+	fixture->store = CAMEL_STORE (service);
+
+	local_settings = CAMEL_LOCAL_SETTINGS (camel_service_ref_settings (service));
+	camel_local_settings_set_path (local_settings, store_path);
+	g_object_unref (local_settings);
+
+	fixture->folder = camel_store_get_folder_sync (fixture->store, "testbox", CAMEL_STORE_FOLDER_CREATE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (fixture->folder);
+
+	fixture->mbox_path = g_build_filename (store_path, "testbox", NULL);
+
+	for (ii = 0; ii < N_MESSAGES; ii++) {
+		CamelMimeMessage *msg;
+
+		msg = create_message (ii);
+		camel_folder_append_message_sync (fixture->folder, msg, NULL, &fixture->uids[ii], NULL, &error);
+		g_assert_no_error (error);
+		g_assert_nonnull (fixture->uids[ii]);
+		g_object_unref (msg);
+	}
+
+	camel_folder_synchronize_sync (fixture->folder, FALSE, NULL, &error);
+	g_assert_no_error (error);
+
+	g_free (store_path);
+}
+
+static void
+mbox_fixture_clear (MboxFixture *fixture)
+{
+	guint ii;
+
+	for (ii = 0; ii < N_MESSAGES; ii++) {
+		g_free (fixture->uids[ii]);
+	}
+
+	g_clear_object (&fixture->folder);
+	g_clear_object (&fixture->store);
+	g_clear_object (&fixture->session);
+	g_free (fixture->mbox_path);
+}
+
+static gchar *
+read_mbox (MboxFixture *fixture,
+           gsize *out_length)
+{
+	gchar *contents = NULL;
+	GError *error = NULL;
+
+	g_file_get_contents (fixture->mbox_path, &contents, out_length, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (contents);
+
+	return contents;
+}
+
+/* Fills offsets of the From_ lines of all the messages, with the file length
+   as the last item, thus each message is between offsets[ii] and offsets[ii + 1] */
+static void
+find_from_lines (const gchar *contents,
+                 gsize length,
+                 goffset offsets[N_MESSAGES + 1])
+{
+	gsize pos;
+	guint found = 0;
+
+	for (pos = 0; pos < length; pos++) {
+		if ((pos == 0 || contents[pos - 1] == '\n') &&
+		    strncmp (contents + pos, "From ", 5) == 0) {
+			g_assert_cmpuint (found, <, N_MESSAGES);
+			offsets[found++] = pos;
+		}
+	}
+
+	g_assert_cmpuint (found, ==, N_MESSAGES);
+	offsets[N_MESSAGES] = length;
+}
+
+static void
+set_message_flags (MboxFixture *fixture,
+                   guint index,
+                   guint32 flags)
+{
+	CamelMessageInfo *info;
+
+	info = camel_folder_get_message_info (fixture->folder, fixture->uids[index]);
+	g_assert_nonnull (info);
+	camel_message_info_set_flags (info, flags, flags);
+	g_clear_object (&info);
+}
+
+static void
+check_message (MboxFixture *fixture,
+               guint index,
+               gboolean exists)
+{
+	CamelMimeMessage *msg;
+	CamelMessageInfo *info;
+	gchar *subject;
+	GError *error = NULL;
+
+	info = camel_folder_get_message_info (fixture->folder, fixture->uids[index]);
+
+	if (!exists) {
+		g_assert_null (info);
+		return;
+	}
+
+	g_assert_nonnull (info);
+	g_clear_object (&info);
+
+	/* the stored offset still points to the right message */
+	msg = camel_folder_get_message_sync (fixture->folder, fixture->uids[index], NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (msg);
+
+	subject = g_strdup_printf ("Message %u", index);
+	g_assert_cmpstr (camel_mime_message_get_subject (msg), ==, subject);
+	g_free (subject);
+
+	g_object_unref (msg);
+}
+
+static void
+test_mbox_sync_flags_in_place (void)
+{
+	MboxFixture fixture;
+	goffset offsets[N_MESSAGES + 1];
+	gchar *before, *after;
+	const gchar *xev_start, *xev_end;
+	gsize before_len, after_len, ii;
+	GError *error = NULL;
+
+	mbox_fixture_init (&fixture, "test-flags");
+
+	before = read_mbox (&fixture, &before_len);
+	find_from_lines (before, before_len, offsets);
+
+	set_message_flags (&fixture, 1, CAMEL_MESSAGE_SEEN | CAMEL_MESSAGE_FLAGGED);
+
+	camel_folder_synchronize_sync (fixture.folder, FALSE, NULL, &error);
+	g_assert_no_error (error);
+
+	after = read_mbox (&fixture, &after_len);
+
+	/* the X-Evolution header has the same length, thus only its value changed */
+	g_assert_cmpuint (after_len, ==, before_len);
+	g_assert_true (memcmp (before, after, before_len) != 0);
+
+	xev_start = g_strstr_len (before + offsets[1], offsets[2] - offsets[1], "\nX-Evolution: ");
+	g_assert_nonnull (xev_start);
+	xev_end = strchr (xev_start + 1, '\n');
+	g_assert_nonnull (xev_end);
+
+	for (ii = 0; ii < before_len; ii++) {
+		if (before[ii] != after[ii]) {
+			g_assert_cmpuint (ii, >, xev_start - before);
+			g_assert_cmpuint (ii, <, xev_end - before);
+		}
+	}
+
+	g_free (before);
+	g_free (after);
+
+	/* the change is read back from the file */
+	g_clear_object (&fixture.folder);
+
+	fixture.folder = camel_store_get_folder_sync (fixture.store, "testbox", 0, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (fixture.folder);
+
+	camel_folder_refresh_info_sync (fixture.folder, NULL, &error);
+	g_assert_no_error (error);
+
+	g_assert_cmpuint (camel_folder_get_message_flags (fixture.folder, fixture.uids[1]) & (CAMEL_MESSAGE_SEEN | CAMEL_MESSAGE_FLAGGED), ==,
+		CAMEL_MESSAGE_SEEN | CAMEL_MESSAGE_FLAGGED);
+	g_assert_cmpuint (camel_folder_get_message_flags (fixture.folder, fixture.uids[0]) & CAMEL_MESSAGE_SEEN, ==, 0);
+
+	mbox_fixture_clear (&fixture);
+}
+
+static void
+test_mbox_sync_expunge_tail (void)
+{
+	MboxFixture fixture;
+	goffset offsets[N_MESSAGES + 1];
+	gchar *before, *after;
+	gsize before_len, after_len;
+	GError *error = NULL;
+
+	mbox_fixture_init (&fixture, "test-expunge-tail");
+
+	before = read_mbox (&fixture, &before_len);
+	find_from_lines (before, before_len, offsets);
+
+	set_message_flags (&fixture, 2, CAMEL_MESSAGE_DELETED);
+	set_message_flags (&fixture, 3, CAMEL_MESSAGE_DELETED);
+
+	camel_folder_synchronize_sync (fixture.folder, TRUE, NULL, &error);
+	g_assert_no_error (error);
+
+	/* the file is only truncated before the first removed message */
+	after = read_mbox (&fixture, &after_len);
+	g_assert_cmpuint (after_len, ==, offsets[2]);
+	g_assert_true (memcmp (before, after, after_len) == 0);
+
+	g_assert_cmpint (camel_folder_get_message_count (fixture.folder), ==, 2);
+	check_message (&fixture, 0, TRUE);
+	check_message (&fixture, 1, TRUE);
+	check_message (&fixture, 2, FALSE);
+	check_message (&fixture, 3, FALSE);
+
+	g_free (before);
+	g_free (after);
+
+	mbox_fixture_clear (&fixture);
+}
+
+static void
+test_mbox_sync_expunge_middle (void)
+{
+	MboxFixture fixture;
+	goffset offsets[N_MESSAGES + 1];
+	GString *expected;
+	gchar *before, *after;
+	gsize before_len, after_len;
+	GError *error = NULL;
+
+	mbox_fixture_init (&fixture, "test-expunge-middle");
+
+	before = read_mbox (&fixture, &before_len);
+	find_from_lines (before, before_len, offsets);
+
+	set_message_flags (&fixture, 1, CAMEL_MESSAGE_DELETED);
+
+	camel_folder_synchronize_sync (fixture.folder, TRUE, NULL, &error);
+	g_assert_no_error (error);
+
+	/* the messages before and after the removed one are kept byte by byte */
+	expected = g_string_new_len (before, offsets[1]);
+	g_string_append_len (expected, before + offsets[2], before_len - offsets[2]);
+
+	after = read_mbox (&fixture, &after_len);
+	g_assert_cmpuint (after_len, ==, expected->len);
+	g_assert_true (memcmp (expected->str, after, after_len) == 0);
+
+	g_assert_cmpint (camel_folder_get_message_count (fixture.folder), ==, 3);
+	check_message (&fixture, 0, TRUE);
+	check_message (&fixture, 1, FALSE);
+	check_message (&fixture, 2, TRUE);
+	check_message (&fixture, 3, TRUE);
+
+	g_string_free (expected, TRUE);
+	g_free (before);
+	g_free (after);
+
+	/* an expunge with nothing to remove does not modify the file */
+	before = read_mbox (&fixture, &before_len);
+
+	camel_folder_synchronize_sync (fixture.folder, TRUE, NULL, &error);
+	g_assert_no_error (error);
+
+	after = read_mbox (&fixture, &after_len);
+	g_assert_cmpuint (after_len, ==, before_len);
+	g_assert_true (memcmp (before, after, after_len) == 0);
+
+	g_free (before);
+	g_free (after);
+
+	mbox_fixture_clear (&fixture);
+}
+
+static void
+test_mbox_sync_expunge_with_flags (void)
+{
+	MboxFixture fixture;
+	goffset offsets[N_MESSAGES + 1];
+	goffset changed_at;
+	gchar *before, *after;
+	gsize before_len, after_len;
+	GError *error = NULL;
+
+	mbox_fixture_init (&fixture, "test-expunge-flags");
+
+	before = read_mbox (&fixture, &before_len);
+	find_from_lines (before, before_len, offsets);
+
+	/* one message is removed from the middle and a later one has changed flags */
+	set_message_flags (&fixture, 1, CAMEL_MESSAGE_DELETED);
+	set_message_flags (&fixture, 3, CAMEL_MESSAGE_SEEN);
+
+	camel_folder_synchronize_sync (fixture.folder, TRUE, NULL, &error);
+	g_assert_no_error (error);
+
+	after = read_mbox (&fixture, &after_len);
+
+	/* the prefix before the first change is untouched */
+	g_assert_cmpuint (after_len, ==, before_len - (offsets[2] - offsets[1]));
+	g_assert_true (memcmp (before, after, offsets[1]) == 0);
+
+	/* the message between the removed and the changed one is moved as is */
+	g_assert_true (memcmp (before + offsets[2], after + offsets[1], offsets[3] - offsets[2]) == 0);
+
+	/* the changed message has the same length, with only the X-Evolution header changed */
+	changed_at = offsets[1] + (offsets[3] - offsets[2]);
+	g_assert_cmpint (after_len - changed_at, ==, before_len - offsets[3]);
+	g_assert_true (strncmp (after + changed_at, "From ", 5) == 0);
+
+	g_assert_cmpint (camel_folder_get_message_count (fixture.folder), ==, 3);
+	check_message (&fixture, 0, TRUE);
+	check_message (&fixture, 1, FALSE);
+	check_message (&fixture, 2, TRUE);
+	check_message (&fixture, 3, TRUE);
+	g_assert_cmpuint (camel_folder_get_message_flags (fixture.folder, fixture.uids[3]) & CAMEL_MESSAGE_SEEN, ==, CAMEL_MESSAGE_SEEN);
+
+	g_free (before);
+	g_free (after);
+
+	mbox_fixture_clear (&fixture);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	gint ret;
+
+	camel_test_init (&argc, &argv);
+	camel_test_provider_init (1, local_drivers);
+
+	g_test_add_func ("/Camel/mbox/sync/flags-in-place", test_mbox_sync_flags_in_place);
+	g_test_add_func ("/Camel/mbox/sync/expunge-tail", test_mbox_sync_expunge_tail);
+	g_test_add_func ("/Camel/mbox/sync/expunge-middle", test_mbox_sync_expunge_middle);
+	g_test_add_func ("/Camel/mbox/sync/expunge-with-flags", test_mbox_sync_expunge_with_flags);
+
+	ret = g_test_run ();
+	camel_test_shutdown ();
+	return ret;
+}
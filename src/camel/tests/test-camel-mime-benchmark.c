@@ -0,0 +1,716 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+/* A benchmark of the MIME layer. It runs a reproducible corpus of messages
+ * through the parser, the message construction, the transfer encoding
+ * encoders and decoders, the charset filter and the header decoders, and
+ * reports throughput and the number of memory allocations per message
+ * for each of the stages.
+ *
+ * Run it in the performance mode, to use more iterations:
+ *
+ *    test-camel-mime-benchmark -m perf [--iterations=N] [message-file...]
+ *
+ * Any additional arguments are read as message files and added to the corpus,
+ * thus the numbers can be compared also on real-world data.
+ */
+
+#include "evolution-data-server-config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "camel-test.h"
+
+#if defined (__GLIBC__) && !defined (__SANITIZE_ADDRESS__) && !defined (G_OS_WIN32)
+#define COUNT_ALLOCATIONS 1
+
+/* Interpose the allocator, to count allocations done by the tested code */
+extern gpointer __libc_malloc (gsize size);
+extern gpointer __libc_calloc (gsize nmemb, gsize size);
+extern gpointer __libc_realloc (gpointer ptr, gsize size);
+
+static volatile gint n_allocations = 0;
+
+gpointer malloc (gsize size);
+gpointer calloc (gsize nmemb, gsize size);
+gpointer realloc (gpointer ptr, gsize size);
+
+gpointer
+malloc (gsize size)
+{
+	g_atomic_int_inc (&n_allocations);
+	return __libc_malloc (size);
+}
+
+gpointer
+calloc (gsize nmemb,
+	gsize size)
+{
+	g_atomic_int_inc (&n_allocations);
+	return __libc_calloc (nmemb, size);
+}
+
+gpointer
+realloc (gpointer ptr,
+	 gsize size)
+{
+	g_atomic_int_inc (&n_allocations);
+	return __libc_realloc (ptr, size);
+}
+#endif
+
+static gint n_iterations = 0;
+static GPtrArray *corpus = NULL; /* GBytes * */
+static GPtrArray *corpus_headers = NULL; /* gchar *, unfolded raw header values */
+static GPtrArray *corpus_base64 = NULL; /* GBytes *, the corpus encoded in base64 */
+static GPtrArray *corpus_qp = NULL; /* GBytes *, the corpus encoded in quoted-printable */
+static GPtrArray *corpus_uu = NULL; /* GBytes *, the corpus encoded in uuencode */
+
+static GOptionEntry entries[] = {
+	{ "iterations", 'i', 0, G_OPTION_ARG_INT, &n_iterations,
+	  "How many times to run each stage over the corpus", "N" },
+	{ NULL }
+};
+
+typedef gsize (* BenchmarkFunc) (GBytes *message);
+
+static void
+benchmark_append_random_text (GString *str,
+			      GRand *rnd,
+			      guint n_words)
+{
+	static const gchar *words[] = {
+		"the", "message", "folder", "summary", "server", "account", "attached", "please",
+		"review", "meeting", "tomorrow", "report", "quarterly", "numbers", "regards", "thanks",
+		"invoice", "schedule", "project", "update", "status", "release", "version", "build"
+	};
+	guint ii;
+
+	for (ii = 0; ii < n_words; ii++) {
+		if (ii > 0)
+			g_string_append_c (str, (ii % 12) == 0 ? '\n' : ' ');
+		g_string_append (str, words[g_rand_int_range (rnd, 0, G_N_ELEMENTS (words))]);
+	}
+
+	g_string_append_c (str, '\n');
+}
+
+static void
+benchmark_append_headers (GString *str,
+			  GRand *rnd,
+			  guint index,
+			  gboolean encoded)
+{
+	g_string_append_printf (str, "Message-ID: <%u.%u@bench.example.com>\n", index, g_rand_int (rnd));
+	g_string_append (str, "Date: Mon, 19 Oct 2026 10:11:12 +0200\n");
+	g_string_append_printf (str, "Received: from mx%u.example.com (mx%u.example.com [192.0.2.%u])\n"
+		"\tby mail.example.com with ESMTPS id %08x; Mon, 19 Oct 2026 10:11:13 +0200\n",
+		index % 10, index % 10, index % 250, g_rand_int (rnd));
+
+	if (encoded) {
+		g_string_append (str, "From: =?UTF-8?B?SsOhbiDEjGVybsO9?= <jan.cerny@example.com>\n");
+		g_string_append (str, "To: =?iso-8859-1?Q?J=F6rg_M=FCller?= <joerg@example.com>,\n"
+			"\t=?UTF-8?Q?Fran=C3=A7ois_P=C3=A9rez?= <francois@example.com>,\n"
+			"\t\"Plain Name\" <plain@example.com>\n");
+		g_string_append (str, "Subject: =?UTF-8?B?UmU6IFDFmcOtbG9oYSBrIHDFmWVkbsOhxaFjZQ==?=\n"
+			" =?UTF-8?Q?_a_dal=C5=A1=C3=AD_text?=\n");
+		g_string_append (str, "X-Encoded-1: =?koi8-r?B?8NLJ18XUIMnaIM3P08vX2Q==?=\n");
+		g_string_append (str, "X-Encoded-2: =?iso-8859-2?Q?=AElu=BBou=E8k=FD_k=F9=F2?=\n");
+	} else {
+		g_string_append (str, "From: Jan Novak <jan.novak@example.com>\n");
+		g_string_append (str, "To: Team <team@example.com>, \"Doe, John\" <john.doe@example.com>\n");
+		g_string_append_printf (str, "Subject: Weekly status report number %u\n", index);
+	}
+
+	g_string_append (str, "MIME-Version: 1.0\n");
+}
+
+static GBytes *
+benchmark_gen_plain (GRand *rnd,
+		     guint index)
+{
+	GString *str = g_string_new ("");
+
+	benchmark_append_headers (str, rnd, index, FALSE);
+	g_string_append (str, "Content-Type: text/plain; charset=us-ascii\n\n");
+	benchmark_append_random_text (str, rnd, 300);
+
+	return g_string_free_to_bytes (str);
+}
+
+static GBytes *
+benchmark_gen_encoded_headers (GRand *rnd,
+			       guint index)
+{
+	GString *str = g_string_new ("");
+	guint ii;
+
+	benchmark_append_headers (str, rnd, index, TRUE);
+
+	for (ii = 0; ii < 40; ii++) {
+		g_string_append_printf (str, "X-Extra-%u: =?UTF-8?Q?Hodnota_=C4=8D=C3=ADslo_%u?= and plain text\n", ii, ii);
+	}
+
+	g_string_append (str, "Content-Type: text/plain; charset=utf-8\n"
+		"Content-Transfer-Encoding: quoted-printable\n\n");
+
+	for (ii = 0; ii < 40; ii++) {
+		g_string_append (str, "P=C5=99=C3=ADli=C5=A1 =C5=BElu=C5=A5ou=C4=8Dk=C3=BD k=C5=AF=C5=88 "
+			"=C3=BAp=C4=9Bl =C4=8F=C3=A1belsk=C3=A9 =C3=B3dy, line which is long=\n enough\n");
+	}
+
+	return g_string_free_to_bytes (str);
+}
+
+static void
+benchmark_append_multipart (GString *str,
+			    GRand *rnd,
+			    guint depth)
+{
+	gchar *boundary;
+	guint ii;
+
+	boundary = g_strdup_printf ("=-bench-boundary-%u-%08x", depth, g_rand_int (rnd));
+
+	g_string_append_printf (str, "Content-Type: multipart/mixed; boundary=\"%s\"\n\n", boundary);
+	g_string_append (str, "This is a multi-part message in MIME format.\n");
+
+	for (ii = 0; ii < 3; ii++) {
+		g_string_append_printf (str, "\n--%s\n", boundary);
+
+		if (ii == 1 && depth > 0) {
+			benchmark_append_multipart (str, rnd, depth - 1);
+		} else {
+			g_string_append (str, "Content-Type: text/plain; charset=us-ascii\n\n");
+			benchmark_append_random_text (str, rnd, 40);
+		}
+	}
+
+	g_string_append_printf (str, "\n--%s--\n", boundary);
+
+	g_free (boundary);
+}
+
+static GBytes *
+benchmark_gen_deep_multipart (GRand *rnd,
+			      guint index)
+{
+	GString *str = g_string_new ("");
+
+	benchmark_append_headers (str, rnd, index, FALSE);
+	benchmark_append_multipart (str, rnd, 10);
+
+	return g_string_free_to_bytes (str);
+}
+
+static GBytes *
+benchmark_gen_attachment (GRand *rnd,
+			  guint index)
+{
+	GString *str = g_string_new ("");
+	guchar *data;
+	gchar *encoded;
+	gsize ii, data_len = 512 * 1024, line_len = 76;
+
+	benchmark_append_headers (str, rnd, index, FALSE);
+	g_string_append (str, "Content-Type: multipart/mixed; boundary=\"attach-boundary\"\n\n"
+		"--attach-boundary\n"
+		"Content-Type: text/plain; charset=us-ascii\n\n");
+	benchmark_append_random_text (str, rnd, 60);
+	g_string_append (str, "\n--attach-boundary\n"
+		"Content-Type: application/octet-stream; name=\"data.bin\"\n"
+		"Content-Disposition: attachment; filename=\"data.bin\"\n"
+		"Content-Transfer-Encoding: base64\n\n");
+
+	data = g_new (guchar, data_len);
+	for (ii = 0; ii < data_len; ii++) {
+		data[ii] = (guchar) g_rand_int_range (rnd, 0, 256);
+	}
+
+	encoded = g_base64_encode (data, data_len);
+
+	for (ii = 0; encoded[ii]; ii += line_len) {
+		g_string_append_len (str, encoded + ii, MIN (line_len, strlen (encoded + ii)));
+		g_string_append_c (str, '\n');
+	}
+
+	g_string_append (str, "\n--attach-boundary--\n");
+
+	g_free (encoded);
+	g_free (data);
+
+	return g_string_free_to_bytes (str);
+}
+
+static GBytes *
+benchmark_gen_charset (GRand *rnd,
+		       guint index,
+		       const gchar *charset)
+{
+	const gchar *utf8_text =
+		"Příliš žluťoučký kůň úpěl ďábelské ódy. Жълтата дюля беше щастлива. "
+		"Größe, Maß und Spaß. Ça va très bien, merci.\n";
+	GString *str = g_string_new ("");
+	gchar *converted;
+	gsize converted_len = 0;
+	guint ii;
+
+	converted = g_convert_with_fallback (utf8_text, -1, charset, "UTF-8", "?", NULL, &converted_len, NULL);
+	if (!converted) {
+		charset = "UTF-8";
+		converted = g_strdup (utf8_text);
+		converted_len = strlen (converted);
+	}
+
+	benchmark_append_headers (str, rnd, index, FALSE);
+	g_string_append_printf (str, "Content-Type: text/plain; charset=%s\n"
+		"Content-Transfer-Encoding: 8bit\n\n", charset);
+
+	for (ii = 0; ii < 60; ii++) {
+		g_string_append_len (str, converted, converted_len);
+	}
+
+	g_free (converted);
+
+	return g_string_free_to_bytes (str);
+}
+
+static void
+benchmark_collect_headers (GBytes *message)
+{
+	CamelMimeParser *parser;
+	CamelNameValueArray *headers;
+	const gchar *name, *value;
+	guint ii;
+
+	parser = camel_mime_parser_new ();
+	camel_mime_parser_init_with_bytes (parser, message);
+
+	if (camel_mime_parser_step (parser, NULL, NULL) != CAMEL_MIME_PARSER_STATE_EOF) {
+		headers = camel_mime_parser_dup_headers (parser);
+
+		for (ii = 0; camel_name_value_array_get (headers, ii, &name, &value); ii++) {
+			g_ptr_array_add (corpus_headers, camel_header_unfold (value));
+		}
+
+		camel_name_value_array_free (headers);
+	}
+
+	g_object_unref (parser);
+}
+
+static void
+benchmark_build_corpus (gint argc,
+			gchar **argv)
+{
+	const gchar *charsets[] = { "ISO-8859-1", "ISO-8859-2", "KOI8-R", "WINDOWS-1250", "ISO-2022-JP", "UTF-8" };
+	GRand *rnd;
+	guint ii;
+	gint jj;
+
+	corpus = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+	corpus_headers = g_ptr_array_new_with_free_func (g_free);
+
+	/* a fixed seed, to have the corpus the same on each run */
+	rnd = g_rand_new_with_seed (20261019);
+
+	for (ii = 0; ii < 20; ii++) {
+		g_ptr_array_add (corpus, benchmark_gen_plain (rnd, ii));
+		g_ptr_array_add (corpus, benchmark_gen_encoded_headers (rnd, ii));
+		g_ptr_array_add (corpus, benchmark_gen_deep_multipart (rnd, ii));
+		g_ptr_array_add (corpus, benchmark_gen_charset (rnd, ii, charsets[ii % G_N_ELEMENTS (charsets)]));
+	}
+
+	for (ii = 0; ii < 2; ii++) {
+		g_ptr_array_add (corpus, benchmark_gen_attachment (rnd, ii));
+	}
+
+	g_rand_free (rnd);
+
+	for (jj = 1; jj < argc; jj++) {
+		gchar *contents = NULL;
+		gsize length = 0;
+		GError *error = NULL;
+
+		if (argv[jj][0] == '-')
+			continue;
+
+		if (g_file_get_contents (argv[jj], &contents, &length, &error)) {
+			g_ptr_array_add (corpus, g_bytes_new_take (contents, length));
+		} else {
+			g_printerr ("Failed to read '%s': %s\n", argv[jj], error ? error->message : "Unknown error");
+			g_clear_error (&error);
+		}
+	}
+
+	for (ii = 0; ii < corpus->len; ii++) {
+		benchmark_collect_headers (corpus->pdata[ii]);
+	}
+}
+
+static void
+benchmark_run_data (const gchar *stage,
+		    GPtrArray *data, /* GBytes * */
+		    BenchmarkFunc func)
+{
+	GTimer *timer;
+	gdouble elapsed, mbps;
+	guint64 n_bytes = 0, n_messages = 0;
+	gint iteration, n_allocs = 0;
+	guint ii;
+
+	/* warm up caches, like the iconv or the charset maps */
+	for (ii = 0; ii < data->len && ii < 10; ii++) {
+		func (data->pdata[ii]);
+	}
+
+	timer = g_timer_new ();
+
+	for (iteration = 0; iteration < n_iterations; iteration++) {
+		#ifdef COUNT_ALLOCATIONS
+		gint n_allocs_before = g_atomic_int_get (&n_allocations);
+		#endif
+
+		for (ii = 0; ii < data->len; ii++) {
+			n_bytes += func (data->pdata[ii]);
+			n_messages++;
+		}
+
+		#ifdef COUNT_ALLOCATIONS
+		n_allocs += g_atomic_int_get (&n_allocations) - n_allocs_before;
+		#endif
+	}
+
+	g_timer_stop (timer);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_timer_destroy (timer);
+
+	mbps = elapsed > 0.0 ? (n_bytes / (1024.0 * 1024.0)) / elapsed : 0.0;
+
+	g_test_message ("%-24s %10.2f MB %8.3f s %10.2f MB/s %10.1f allocs/msg",
+		stage, n_bytes / (1024.0 * 1024.0), elapsed, mbps,
+		n_messages > 0 ? ((gdouble) n_allocs) / n_messages : 0.0);
+
+	if (g_test_perf ())
+		g_test_maximized_result (mbps, "%s: %.2f MB/s", stage, mbps);
+
+	g_assert_cmpuint (n_bytes, >, 0);
+}
+
+static void
+benchmark_run (const gchar *stage,
+	       BenchmarkFunc func)
+{
+	benchmark_run_data (stage, corpus, func);
+}
+
+static gsize
+benchmark_parser_func (GBytes *message)
+{
+	CamelMimeParser *parser;
+	CamelMimeParserState state;
+	gchar *buffer;
+	gsize len;
+
+	parser = camel_mime_parser_new ();
+	camel_mime_parser_init_with_bytes (parser, message);
+
+	do {
+		state = camel_mime_parser_step (parser, &buffer, &len);
+	} while (state != CAMEL_MIME_PARSER_STATE_EOF && state != CAMEL_MIME_PARSER_STATE_ERROR);
+
+	g_object_unref (parser);
+
+	return g_bytes_get_size (message);
+}
+
+static gsize
+benchmark_message_func (GBytes *message)
+{
+	CamelMimeMessage *msg;
+	CamelMimeParser *parser;
+	gboolean success;
+
+	parser = camel_mime_parser_new ();
+	camel_mime_parser_init_with_bytes (parser, message);
+
+	msg = camel_mime_message_new ();
+	success = camel_mime_part_construct_from_parser_sync (CAMEL_MIME_PART (msg), parser, NULL, NULL);
+	g_assert_true (success);
+
+	/* touch what the summary needs */
+	camel_mime_message_get_subject (msg);
+	camel_mime_message_get_from (msg);
+	camel_mime_message_get_date (msg, NULL);
+
+	g_object_unref (msg);
+	g_object_unref (parser);
+
+	return g_bytes_get_size (message);
+}
+
+static gsize
+benchmark_filter_data (GBytes *message,
+		       CamelMimeFilter *filter)
+{
+	CamelStream *null_stream, *filter_stream;
+	gconstpointer data;
+	gsize size = 0;
+
+	data = g_bytes_get_data (message, &size);
+
+	null_stream = camel_stream_null_new ();
+	filter_stream = camel_stream_filter_new (null_stream);
+	camel_stream_filter_add (CAMEL_STREAM_FILTER (filter_stream), filter);
+
+	camel_stream_write (filter_stream, data, size, NULL, NULL);
+	camel_stream_flush (filter_stream, NULL, NULL);
+
+	g_object_unref (filter_stream);
+	g_object_unref (null_stream);
+
+	return size;
+}
+
+static gsize
+benchmark_basic_filter (GBytes *message,
+			CamelMimeFilterBasicType type)
+{
+	CamelMimeFilter *filter;
+	gsize size;
+
+	filter = camel_mime_filter_basic_new (type);
+	size = benchmark_filter_data (message, filter);
+	g_object_unref (filter);
+
+	return size;
+}
+
+static gsize
+benchmark_base64_func (GBytes *message)
+{
+	return benchmark_basic_filter (message, CAMEL_MIME_FILTER_BASIC_BASE64_ENC);
+}
+
+static gsize
+benchmark_qp_func (GBytes *message)
+{
+	return benchmark_basic_filter (message, CAMEL_MIME_FILTER_BASIC_QP_ENC);
+}
+
+static gsize
+benchmark_base64_dec_func (GBytes *encoded)
+{
+	return benchmark_basic_filter (encoded, CAMEL_MIME_FILTER_BASIC_BASE64_DEC);
+}
+
+static gsize
+benchmark_qp_dec_func (GBytes *encoded)
+{
+	return benchmark_basic_filter (encoded, CAMEL_MIME_FILTER_BASIC_QP_DEC);
+}
+
+static gsize
+benchmark_uu_dec_func (GBytes *encoded)
+{
+	return benchmark_basic_filter (encoded, CAMEL_MIME_FILTER_BASIC_UU_DEC);
+}
+
+/* encodes the whole corpus with the @type encoder, as the input for the decoders */
+static GPtrArray *
+benchmark_encode_corpus (CamelMimeFilterBasicType type)
+{
+	GPtrArray *encoded;
+	guint ii;
+
+	encoded = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+
+	for (ii = 0; ii < corpus->len; ii++) {
+		CamelStream *mem_stream, *filter_stream;
+		CamelMimeFilter *filter;
+		GByteArray *buffer;
+		gconstpointer data;
+		gsize size = 0;
+
+		data = g_bytes_get_data (corpus->pdata[ii], &size);
+
+		buffer = g_byte_array_new ();
+		mem_stream = camel_stream_mem_new_with_byte_array (buffer);
+
+		/* the uudecoder skips anything before the begin line */
+		if (type == CAMEL_MIME_FILTER_BASIC_UU_ENC)
+			camel_stream_write_string (mem_stream, "begin 644 message.eml\n", NULL, NULL);
+
+		filter = camel_mime_filter_basic_new (type);
+		filter_stream = camel_stream_filter_new (mem_stream);
+		camel_stream_filter_add (CAMEL_STREAM_FILTER (filter_stream), filter);
+
+		camel_stream_write (filter_stream, data, size, NULL, NULL);
+		camel_stream_flush (filter_stream, NULL, NULL);
+
+		if (type == CAMEL_MIME_FILTER_BASIC_UU_ENC)
+			camel_stream_write_string (mem_stream, "end\n", NULL, NULL);
+
+		g_ptr_array_add (encoded, g_bytes_new (buffer->data, buffer->len));
+
+		g_object_unref (filter_stream);
+		g_object_unref (filter);
+		g_object_unref (mem_stream);
+	}
+
+	return encoded;
+}
+
+static gsize
+benchmark_charset_func (GBytes *message)
+{
+	CamelMimeFilter *filter;
+	gsize size;
+
+	filter = camel_mime_filter_charset_new ("ISO-8859-2", "UTF-8");
+	g_assert_nonnull (filter);
+	size = benchmark_filter_data (message, filter);
+	g_object_unref (filter);
+
+	return size;
+}
+
+static gsize
+benchmark_headers_func (GBytes *message)
+{
+	static guint next_header = 0;
+	gsize size = 0;
+	guint ii;
+
+	/* the headers are not related to the message, the corpus has more headers
+	   than messages, thus take a chunk of them for each call */
+	for (ii = 0; ii < 16 && corpus_headers->len > 0; ii++) {
+		const gchar *value = corpus_headers->pdata[next_header];
+		CamelHeaderAddress *addr;
+		gchar *decoded;
+
+		next_header = (next_header + 1) % corpus_headers->len;
+
+		decoded = camel_header_decode_string (value, "ISO-8859-1");
+		g_free (decoded);
+
+		decoded = g_strdup (value);
+		camel_header_decode_string_into (decoded, "ISO-8859-1", decoded, strlen (decoded) + 1);
+		g_free (decoded);
+
+		addr = camel_header_address_decode (value, "ISO-8859-1");
+		if (addr)
+			camel_header_address_list_clear (&addr);
+
+		size += strlen (value);
+	}
+
+	return size;
+}
+
+static void
+test_benchmark_parser (void)
+{
+	benchmark_run ("parser", benchmark_parser_func);
+}
+
+static void
+test_benchmark_message (void)
+{
+	benchmark_run ("message construction", benchmark_message_func);
+}
+
+static void
+test_benchmark_base64 (void)
+{
+	benchmark_run ("base64 encode filter", benchmark_base64_func);
+}
+
+static void
+test_benchmark_qp (void)
+{
+	benchmark_run ("QP encode filter", benchmark_qp_func);
+}
+
+static void
+test_benchmark_base64_dec (void)
+{
+	benchmark_run_data ("base64 decode filter", corpus_base64, benchmark_base64_dec_func);
+}
+
+static void
+test_benchmark_qp_dec (void)
+{
+	benchmark_run_data ("QP decode filter", corpus_qp, benchmark_qp_dec_func);
+}
+
+static void
+test_benchmark_uu_dec (void)
+{
+	benchmark_run_data ("uudecode filter", corpus_uu, benchmark_uu_dec_func);
+}
+
+static void
+test_benchmark_charset (void)
+{
+	benchmark_run ("charset filter", benchmark_charset_func);
+}
+
+static void
+test_benchmark_headers (void)
+{
+	benchmark_run ("header decoders", benchmark_headers_func);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	gint ret;
+
+	camel_test_init (&argc, &argv);
+
+	context = g_option_context_new ("[message-file...]");
+	g_option_context_add_main_entries (context, entries, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error))
+		g_error ("Failed to parse program arguments: %s", error->message);
+
+	g_option_context_free (context);
+
+	if (n_iterations <= 0)
+		n_iterations = g_test_perf () ? 50 : 1;
+
+	benchmark_build_corpus (argc, argv);
+
+	corpus_base64 = benchmark_encode_corpus (CAMEL_MIME_FILTER_BASIC_BASE64_ENC);
+	corpus_qp = benchmark_encode_corpus (CAMEL_MIME_FILTER_BASIC_QP_ENC);
+	corpus_uu = benchmark_encode_corpus (CAMEL_MIME_FILTER_BASIC_UU_ENC);
+
+	g_test_add_func ("/Camel/MimeBenchmark/Parser", test_benchmark_parser);
+	g_test_add_func ("/Camel/MimeBenchmark/Message", test_benchmark_message);
+	g_test_add_func ("/Camel/MimeBenchmark/Base64", test_benchmark_base64);
+	g_test_add_func ("/Camel/MimeBenchmark/QuotedPrintable", test_benchmark_qp);
+	g_test_add_func ("/Camel/MimeBenchmark/Base64Decode", test_benchmark_base64_dec);
+	g_test_add_func ("/Camel/MimeBenchmark/QuotedPrintableDecode", test_benchmark_qp_dec);
+	g_test_add_func ("/Camel/MimeBenchmark/UUDecode", test_benchmark_uu_dec);
+	g_test_add_func ("/Camel/MimeBenchmark/Charset", test_benchmark_charset);
+	g_test_add_func ("/Camel/MimeBenchmark/Headers", test_benchmark_headers);
+
+	ret = g_test_run ();
+
+	g_ptr_array_unref (corpus_uu);
+	g_ptr_array_unref (corpus_qp);
+	g_ptr_array_unref (corpus_base64);
+	g_ptr_array_unref (corpus_headers);
+	g_ptr_array_unref (corpus);
+
+	camel_test_shutdown ();
+
+	return ret;
+}
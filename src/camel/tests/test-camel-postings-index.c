@@ -0,0 +1,634 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "evolution-data-server-config.h"
+
+#include <fcntl.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "camel-test.h"
+
+static gchar *
+make_index_path (const gchar *name)
+{
+	return g_build_filename (camel_test_get_dir (), name, NULL);
+}
+
+static void
+index_add_words_to_name (CamelIndex *idx,
+                         const gchar *name,
+                         const gchar * const *words)
+{
+	CamelIndexName *idn;
+	gint ii;
+
+	idn = camel_index_add_name (idx, name);
+	g_assert_nonnull (idn);
+	for (ii = 0; words[ii] != NULL; ii++) {
+		camel_index_name_add_word (idn, words[ii]);
+	}
+	camel_index_write_name (idx, idn);
+	g_object_unref (idn);
+}
+
+static gboolean
+cursor_contains_name (CamelIndexCursor *idc,
+                      const gchar *name)
+{
+	const gchar *val;
+
+	while ((val = camel_index_cursor_next (idc)) != NULL) {
+		if (g_strcmp0 (val, name) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gint
+cursor_count (CamelIndexCursor *idc)
+{
+	gint count = 0;
+
+	while (camel_index_cursor_next (idc) != NULL) {
+		count++;
+	}
+
+	return count;
+}
+
+static gint
+find_count (CamelIndex *idx,
+            const gchar *word)
+{
+	CamelIndexCursor *idc;
+	gint count;
+
+	idc = camel_index_find (idx, word);
+	g_assert_nonnull (idc);
+	count = cursor_count (idc);
+	g_object_unref (idc);
+
+	return count;
+}
+
+static gboolean
+find_contains (CamelIndex *idx,
+               const gchar *word,
+               const gchar *name)
+{
+	CamelIndexCursor *idc;
+	gboolean contains;
+
+	idc = camel_index_find (idx, word);
+	g_assert_nonnull (idc);
+	contains = cursor_contains_name (idc, name);
+	g_object_unref (idc);
+
+	return contains;
+}
+
+static void
+test_create_and_check (void)
+{
+	CamelPostingsIndex *idx;
+	gchar *path;
+
+	path = make_index_path ("pidx-create");
+
+	/* does not exist and is not created without O_CREAT */
+	g_assert_null (camel_postings_index_new (path, O_RDWR));
+	g_assert_cmpint (camel_postings_index_check (path), ==, -1);
+
+	idx = camel_postings_index_new (path, O_RDWR | O_CREAT);
+	g_assert_nonnull (idx);
+	g_assert_cmpint (camel_index_sync (CAMEL_INDEX (idx)), ==, 0);
+	g_assert_cmpuint (camel_postings_index_get_n_segments (idx), ==, 0);
+	g_object_unref (idx);
+
+	g_assert_cmpint (camel_postings_index_check (path), ==, 0);
+
+	idx = camel_postings_index_new (path, O_RDONLY);
+	g_assert_nonnull (idx);
+	g_object_unref (idx);
+
+	camel_postings_index_remove (path);
+	g_assert_cmpint (camel_postings_index_check (path), ==, -1);
+	g_free (path);
+}
+
+static void
+test_add_and_find (void)
+{
+	const gchar *words_msg1[] = { "hello", "world", NULL };
+	const gchar *words_msg2[] = { "hello", "there", NULL };
+	CamelPostingsIndex *idx;
+	CamelIndex *ci;
+	gchar *path;
+
+	path = make_index_path ("pidx-find");
+	idx = camel_postings_index_new (path, O_RDWR | O_CREAT);
+	g_assert_nonnull (idx);
+	ci = CAMEL_INDEX (idx);
+
+	g_assert_false (camel_index_has_name (ci, "msg1"));
+
+	index_add_words_to_name (ci, "msg1", words_msg1);
+	index_add_words_to_name (ci, "msg2", words_msg2);
+
+	/* found also before written into a segment */
+	g_assert_true (camel_index_has_name (ci, "msg1"));
+	g_assert_cmpint (find_count (ci, "hello"), ==, 2);
+	g_assert_true (find_contains (ci, "world", "msg1"));
+
+	g_assert_cmpint (camel_index_sync (ci), ==, 0);
+	g_assert_cmpuint (camel_postings_index_get_n_segments (idx), ==, 1);
+
+	g_assert_true (camel_index_has_name (ci, "msg1"));
+	g_assert_true (camel_index_has_name (ci, "msg2"));
+	g_assert_false (camel_index_has_name (ci, "msg3"));
+	g_assert_cmpint (find_count (ci, "hello"), ==, 2);
+	g_assert_true (find_contains (ci, "world", "msg1"));
+	g_assert_false (find_contains (ci, "world", "msg2"));
+	g_assert_true (find_contains (ci, "there", "msg2"));
+	g_assert_true (find_contains (ci, "HELLO", "msg2"));
+	g_assert_cmpint (find_count (ci, "nonexistent"), ==, 0);
+	g_assert_null (camel_index_find_name (ci, "msg1"));
+
+	g_object_unref (idx);
+	camel_postings_index_remove (path);
+	g_free (path);
+}
+
+static void
+test_add_buffer (void)
+{
+	const gchar *text = "The quick brown fox jumps over the lazy dog; Žluťoučký kůň";
+	CamelPostingsIndex *idx;
+	CamelIndex *ci;
+	CamelIndexName *idn;
+	gchar long_word[200];
+	gchar *path, *long_text;
+
+	memset (long_word, 'x', sizeof (long_word) - 1);
+	long_word[sizeof (long_word) - 1] = '\0';
+
+	path = make_index_path ("pidx-buffer");
+	idx = camel_postings_index_new (path, O_RDWR | O_CREAT);
+	g_assert_nonnull (idx);
+	ci = CAMEL_INDEX (idx);
+
+	idn = camel_index_add_name (ci, "msg1");
+	g_assert_nonnull (idn);
+	camel_index_name_add_buffer (idn, text, strlen (text));
+	camel_index_name_add_buffer (idn, NULL, 0);
+	camel_index_write_name (ci, idn);
+	g_object_unref (idn);
+
+	long_text = g_strdup_printf ("%s short", long_word);
+	idn = camel_index_add_name (ci, "msg2");
+	g_assert_nonnull (idn);
+	camel_index_name_add_buffer (idn, long_text, strlen (long_text));
+	camel_index_name_add_buffer (idn, NULL, 0);
+	camel_index_write_name (ci, idn);
+	g_object_unref (idn);
+	g_free (long_text);
+
+	camel_index_sync (ci);
+
+	g_assert_true (find_contains (ci, "quick", "msg1"));
+	g_assert_true (find_contains (ci, "the", "msg1"));
+	g_assert_true (find_contains (ci, "dog", "msg1"));
+	g_assert_true (find_contains (ci, "žluťoučký", "msg1"));
+	g_assert_true (find_contains (ci, "KŮŇ", "msg1"));
+	g_assert_true (find_contains (ci, "short", "msg2"));
+	g_assert_cmpint (find_count (ci, long_word), ==, 0);
+
+	g_object_unref (idx);
+	camel_postings_index_remove (path);
+	g_free (path);
+}
+
+static void
+test_words_cursor (void)
+{
+	const gchar *words_msg1[] = { "alpha", "beta", NULL };
+	const gchar *words_msg2[] = { "beta", "gamma", NULL };
+	const gchar *words_msg3[] = { "delta", "alpha", NULL };
+	CamelPostingsIndex *idx;
+	CamelIndex *ci;
+	CamelIndexCursor *idc;
+	GHashTable *found;
+	const gchar *word;
+	gchar *path;
+	gint count = 0;
+
+	path = make_index_path ("pidx-words");
+	idx = camel_postings_index_new (path, O_RDWR | O_CREAT);
+	g_assert_nonnull (idx);
+	ci = CAMEL_INDEX (idx);
+
+	index_add_words_to_name (ci, "msg1", words_msg1);
+	camel_index_sync (ci);
+	index_add_words_to_name (ci, "msg2", words_msg2);
+	camel_index_sync (ci);
+	/* this one is not written yet */
+	index_add_words_to_name (ci, "msg3", words_msg3);
+
+	found = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	idc = camel_index_words (ci);
+	g_assert_nonnull (idc);
+	while ((word = camel_index_cursor_next (idc)) != NULL) {
+		g_hash_table_add (found, g_strdup (word));
+		count++;
+	}
+	g_object_unref (idc);
+
+	/* each word is returned only once */
+	g_assert_cmpint (count, ==, 4);
+	g_assert_true (g_hash_table_contains (found, "alpha"));
+	g_assert_true (g_hash_table_contains (found, "beta"));
+	g_assert_true (g_hash_table_contains (found, "gamma"));
+	g_assert_true (g_hash_table_contains (found, "delta"));
+
+	g_hash_table_destroy (found);
+	g_object_unref (idx);
+	camel_postings_index_remove (path);
+	g_free (path);
+}
+
+static void
+test_delete_and_replace (void)
+{
+	const gchar *words_alpha[] = { "alpha", "common", NULL };
+	const gchar *words_beta[] = { "beta", "common", NULL };
+	CamelPostingsIndex *idx;
+	CamelIndex *ci;
+	gchar *path;
+
+	path = make_index_path ("pidx-delete");
+	idx = camel_postings_index_new (path, O_RDWR | O_CREAT);
+	g_assert_nonnull (idx);
+	ci = CAMEL_INDEX (idx);
+
+	index_add_words_to_name (ci, "msg1", words_alpha);
+	index_add_words_to_name (ci, "msg2", words_alpha);
+	index_add_words_to_name (ci, "msg3", words_alpha);
+	camel_index_sync (ci);
+
+	/* delete from a segment and from the pending names */
+	camel_index_delete_name (ci, "msg1");
+	index_add_words_to_name (ci, "msg4", words_alpha);
+	camel_index_delete_name (ci, "msg4");
+
+	g_assert_false (camel_index_has_name (ci, "msg1"));
+	g_assert_false (camel_index_has_name (ci, "msg4"));
+	g_assert_true (camel_index_has_name (ci, "msg2"));
+	g_assert_false (find_contains (ci, "alpha", "msg1"));
+	g_assert_false (find_contains (ci, "alpha", "msg4"));
+	g_assert_cmpint (find_count (ci, "alpha"), ==, 2);
+
+	/* replace a name stored in a segment */
+	index_add_words_to_name (ci, "msg2", words_beta);
+	camel_index_sync (ci);
+
+	g_assert_true (camel_index_has_name (ci, "msg2"));
+	g_assert_false (find_contains (ci, "alpha", "msg2"));
+	g_assert_true (find_contains (ci, "beta", "msg2"));
+	g_assert_cmpint (find_count (ci, "common"), ==, 2);
+
+	/* the deletes are persistent */
+	g_object_unref (idx);
+	idx = camel_postings_index_new (path, O_RDWR);
+	g_assert_nonnull (idx);
+	ci = CAMEL_INDEX (idx);
+
+	g_assert_false (camel_index_has_name (ci, "msg1"));
+	g_assert_true (camel_index_has_name (ci, "msg2"));
+	g_assert_true (camel_index_has_name (ci, "msg3"));
+	g_assert_cmpint (find_count (ci, "alpha"), ==, 1);
+	g_assert_true (find_contains (ci, "alpha", "msg3"));
+	g_assert_true (find_contains (ci, "beta", "msg2"));
+
+	/* a name deleted while being indexed is not stored */
+	{
+		CamelIndexName *idn;
+
+		idn = camel_index_add_name (ci, "msg5");
+		camel_index_name_add_word (idn, "alpha");
+		camel_index_delete_name (ci, "msg5");
+		camel_index_write_name (ci, idn);
+		g_object_unref (idn);
+	}
+
+	g_assert_false (camel_index_has_name (ci, "msg5"));
+	g_assert_false (find_contains (ci, "alpha", "msg5"));
+
+	g_object_unref (idx);
+	camel_postings_index_remove (path);
+	g_free (path);
+}
+
+static void
+test_compress (void)
+{
+	const gchar *words_keep[] = { "keep", NULL };
+	const gchar *words_remove[] = { "remove", NULL };
+	CamelPostingsIndex *idx;
+	CamelIndex *ci;
+	gchar *path;
+
+	path = make_index_path ("pidx-compress");
+	idx = camel_postings_index_new (path, O_RDWR | O_CREAT);
+	g_assert_nonnull (idx);
+	ci = CAMEL_INDEX (idx);
+
+	index_add_words_to_name (ci, "msg1", words_keep);
+	camel_index_sync (ci);
+	index_add_words_to_name (ci, "msg2", words_remove);
+	camel_index_sync (ci);
+	index_add_words_to_name (ci, "msg3", words_keep);
+	camel_index_sync (ci);
+	g_assert_cmpuint (camel_postings_index_get_n_segments (idx), ==, 3);
+
+	camel_index_delete_name (ci, "msg2");
+	g_assert_cmpint (camel_index_compress (ci), ==, 0);
+	g_assert_cmpuint (camel_postings_index_get_n_segments (idx), ==, 1);
+
+	g_assert_true (camel_index_has_name (ci, "msg1"));
+	g_assert_false (camel_index_has_name (ci, "msg2"));
+	g_assert_true (camel_index_has_name (ci, "msg3"));
+	g_assert_cmpint (find_count (ci, "keep"), ==, 2);
+	g_assert_cmpint (find_count (ci, "remove"), ==, 0);
+
+	g_object_unref (idx);
+
+	idx = camel_postings_index_new (path, O_RDONLY);
+	g_assert_nonnull (idx);
+	ci = CAMEL_INDEX (idx);
+
+	g_assert_cmpuint (camel_postings_index_get_n_segments (idx), ==, 1);
+	g_assert_false (camel_index_has_name (ci, "msg2"));
+	g_assert_cmpint (find_count (ci, "keep"), ==, 2);
+
+	g_object_unref (idx);
+	camel_postings_index_remove (path);
+	g_free (path);
+}
+
+static void
+test_background_merge (void)
+{
+	CamelPostingsIndex *idx;
+	CamelIndex *ci;
+	gchar *path;
+	gint ii;
+
+	path = make_index_path ("pidx-merge");
+	idx = camel_postings_index_new (path, O_RDWR | O_CREAT);
+	g_assert_nonnull (idx);
+	ci = CAMEL_INDEX (idx);
+
+	/* each sync writes a new segment, which eventually triggers a merge */
+	for (ii = 0; ii < 40; ii++) {
+		const gchar *words[] = { "all", NULL, NULL };
+		gchar name[16], word[16];
+
+		g_snprintf (name, sizeof (name), "msg%d", ii);
+		g_snprintf (word, sizeof (word), "w%d", ii % 7);
+		words[1] = word;
+
+		index_add_words_to_name (ci, name, words);
+		if (ii % 5 == 4)
+			camel_index_delete_name (ci, "msg0");
+		camel_index_sync (ci);
+
+		g_assert_cmpint (find_count (ci, "all"), ==, ii < 4 ? ii + 1 : ii);
+	}
+
+	/* waits for a running merge */
+	g_assert_cmpint (camel_index_compress (ci), ==, 0);
+	g_assert_cmpuint (camel_postings_index_get_n_segments (idx), ==, 1);
+	g_assert_cmpint (find_count (ci, "all"), ==, 39);
+	g_assert_cmpint (find_count (ci, "w1"), ==, 6);
+	g_assert_true (find_contains (ci, "w3", "msg38"));
+
+	g_object_unref (idx);
+
+	g_assert_cmpint (camel_postings_index_check (path), ==, 0);
+
+	idx = camel_postings_index_new (path, O_RDWR);
+	g_assert_nonnull (idx);
+	g_assert_cmpint (find_count (CAMEL_INDEX (idx), "all"), ==, 39);
+	g_object_unref (idx);
+
+	camel_postings_index_remove (path);
+	g_free (path);
+}
+
+static void
+test_persist_many_names (void)
+{
+	CamelPostingsIndex *idx;
+	CamelIndex *ci;
+	CamelIndexCursor *idc;
+	GHashTable *found;
+	const gchar *val;
+	gchar *path;
+	guint n_names = 20000;
+	guint ii;
+
+	path = make_index_path ("pidx-many");
+	idx = camel_postings_index_new (path, O_RDWR | O_CREAT);
+	g_assert_nonnull (idx);
+	ci = CAMEL_INDEX (idx);
+
+	for (ii = 0; ii < n_names; ii++) {
+		const gchar *words[] = { "every", NULL, NULL };
+		gchar name[32], word[32];
+
+		g_snprintf (name, sizeof (name), "%u", ii);
+		g_snprintf (word, sizeof (word), "mod%u", ii % 100);
+		words[1] = word;
+
+		index_add_words_to_name (ci, name, words);
+	}
+
+	g_object_unref (idx);
+
+	idx = camel_postings_index_new (path, O_RDWR);
+	g_assert_nonnull (idx);
+	ci = CAMEL_INDEX (idx);
+
+	g_assert_cmpint (find_count (ci, "every"), ==, n_names);
+	g_assert_cmpint (find_count (ci, "mod42"), ==, n_names / 100);
+
+	found = g_hash_table_new (g_str_hash, g_str_equal);
+	idc = camel_index_find (ci, "mod7");
+	while ((val = camel_index_cursor_next (idc)) != NULL) {
+		g_hash_table_add (found, (gpointer) val);
+	}
+
+	for (ii = 7; ii < n_names; ii += 100) {
+		gchar name[32];
+
+		g_snprintf (name, sizeof (name), "%u", ii);
+		g_assert_true (g_hash_table_contains (found, name));
+	}
+
+	g_hash_table_destroy (found);
+	g_object_unref (idc);
+	g_object_unref (idx);
+	camel_postings_index_remove (path);
+	g_free (path);
+}
+
+static void
+test_rename (void)
+{
+	const gchar *words[] = { "word", NULL };
+	CamelPostingsIndex *idx;
+	gchar *path, *newpath, *otherpath;
+
+	path = make_index_path ("pidx-rename-old");
+	newpath = make_index_path ("pidx-rename-new");
+	otherpath = make_index_path ("pidx-rename-other");
+
+	idx = camel_postings_index_new (path, O_RDWR | O_CREAT);
+	g_assert_nonnull (idx);
+	index_add_words_to_name (CAMEL_INDEX (idx), "msg1", words);
+	camel_index_sync (CAMEL_INDEX (idx));
+	g_object_unref (idx);
+
+	g_assert_cmpint (camel_postings_index_rename (path, newpath), ==, 0);
+	g_assert_cmpint (camel_postings_index_check (newpath), ==, 0);
+	g_assert_cmpint (camel_postings_index_check (path), ==, -1);
+
+	/* rename of an opened index */
+	idx = camel_postings_index_new (newpath, O_RDWR);
+	g_assert_nonnull (idx);
+	g_assert_cmpint (camel_index_rename (CAMEL_INDEX (idx), otherpath), ==, 0);
+	index_add_words_to_name (CAMEL_INDEX (idx), "msg2", words);
+	camel_index_sync (CAMEL_INDEX (idx));
+	g_object_unref (idx);
+
+	g_assert_cmpint (camel_postings_index_check (newpath), ==, -1);
+	g_assert_cmpint (camel_postings_index_check (otherpath), ==, 0);
+
+	idx = camel_postings_index_new (otherpath, O_RDONLY);
+	g_assert_nonnull (idx);
+	g_assert_cmpint (find_count (CAMEL_INDEX (idx), "word"), ==, 2);
+	g_object_unref (idx);
+
+	camel_postings_index_remove (otherpath);
+	g_free (path);
+	g_free (newpath);
+	g_free (otherpath);
+}
+
+static void
+test_convert_text_index (void)
+{
+	const gchar *words_msg1[] = { "converted", "first", NULL };
+	const gchar *words_msg2[] = { "converted", "second", NULL };
+	const gchar *words_msg3[] = { "removed", NULL };
+	CamelTextIndex *text_index;
+	CamelPostingsIndex *idx;
+	CamelIndex *ci;
+	gchar *path;
+
+	path = make_index_path ("pidx-convert");
+
+	text_index = camel_text_index_new (path, O_RDWR | O_CREAT);
+	g_assert_nonnull (text_index);
+	index_add_words_to_name (CAMEL_INDEX (text_index), "msg1", words_msg1);
+	index_add_words_to_name (CAMEL_INDEX (text_index), "msg2", words_msg2);
+	index_add_words_to_name (CAMEL_INDEX (text_index), "msg3", words_msg3);
+	camel_index_delete_name (CAMEL_INDEX (text_index), "msg3");
+	camel_index_sync (CAMEL_INDEX (text_index));
+	g_object_unref (text_index);
+
+	g_assert_cmpint (camel_text_index_check (path), ==, 0);
+	g_assert_cmpint (camel_postings_index_check (path), ==, -1);
+
+	idx = camel_postings_index_new (path, O_RDWR | O_CREAT);
+	g_assert_nonnull (idx);
+	ci = CAMEL_INDEX (idx);
+
+	/* the old index is removed after the conversion */
+	g_assert_cmpint (camel_text_index_check (path), ==, -1);
+	g_assert_cmpint (camel_postings_index_check (path), ==, 0);
+
+	g_assert_true (camel_index_has_name (ci, "msg1"));
+	g_assert_true (camel_index_has_name (ci, "msg2"));
+	g_assert_false (camel_index_has_name (ci, "msg3"));
+	g_assert_cmpint (find_count (ci, "converted"), ==, 2);
+	g_assert_true (find_contains (ci, "first", "msg1"));
+	g_assert_true (find_contains (ci, "second", "msg2"));
+	g_assert_cmpint (find_count (ci, "removed"), ==, 0);
+
+	g_object_unref (idx);
+	camel_postings_index_remove (path);
+	g_free (path);
+}
+
+static void
+test_remove_leftovers (void)
+{
+	const gchar *words[] = { "word", NULL };
+	CamelPostingsIndex *idx;
+	gchar *path, *leftover;
+
+	path = make_index_path ("pidx-leftovers");
+	leftover = g_strconcat (path, ".0000ffff.postings", NULL);
+
+	idx = camel_postings_index_new (path, O_RDWR | O_CREAT);
+	g_assert_nonnull (idx);
+	index_add_words_to_name (CAMEL_INDEX (idx), "msg1", words);
+	camel_index_sync (CAMEL_INDEX (idx));
+	g_object_unref (idx);
+
+	/* like from an interrupted merge */
+	g_assert_true (g_file_set_contents (leftover, "x", 1, NULL));
+
+	idx = camel_postings_index_new (path, O_RDWR);
+	g_assert_nonnull (idx);
+	g_assert_false (g_file_test (leftover, G_FILE_TEST_EXISTS));
+	g_assert_cmpint (find_count (CAMEL_INDEX (idx), "word"), ==, 1);
+	g_object_unref (idx);
+
+	g_assert_cmpint (camel_postings_index_remove (path), ==, 0);
+	g_assert_cmpint (camel_postings_index_check (path), ==, -1);
+
+	g_free (leftover);
+	g_free (path);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	gint ret;
+
+	camel_test_init (&argc, &argv);
+
+	g_test_add_func ("/Camel/PostingsIndex/create-and-check", test_create_and_check);
+	g_test_add_func ("/Camel/PostingsIndex/add-and-find", test_add_and_find);
+	g_test_add_func ("/Camel/PostingsIndex/add-buffer", test_add_buffer);
+	g_test_add_func ("/Camel/PostingsIndex/words-cursor", test_words_cursor);
+	g_test_add_func ("/Camel/PostingsIndex/delete-and-replace", test_delete_and_replace);
+	g_test_add_func ("/Camel/PostingsIndex/compress", test_compress);
+	g_test_add_func ("/Camel/PostingsIndex/background-merge", test_background_merge);
+	g_test_add_func ("/Camel/PostingsIndex/persist-many-names", test_persist_many_names);
+	g_test_add_func ("/Camel/PostingsIndex/rename", test_rename);
+	g_test_add_func ("/Camel/PostingsIndex/convert-text-index", test_convert_text_index);
+	g_test_add_func ("/Camel/PostingsIndex/remove-leftovers", test_remove_leftovers);
+
+	ret = g_test_run ();
+	camel_test_shutdown ();
+	return ret;
+}
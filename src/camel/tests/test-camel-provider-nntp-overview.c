@@ -0,0 +1,347 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "evolution-data-server-config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <gio/gio.h>
+
+#include <camel/camel.h>
+
+#include "camel-test.h"
+#include "camel-test-provider.h"
+#include "session.h"
+
+#define FAKE_GROUP "camel.test.overview"
+#define FAKE_N_ARTICLES 20000
+
+static const gchar *nntp_drivers[] = { "nntp" };
+
+/* A minimal NNTP server with a single group, which serves the article
+   overviews over any number of connections */
+typedef struct _FakeNntpServer {
+	GSocketListener *listener;
+	GThread *accept_thread;
+	guint16 port;
+
+	GMutex lock;
+	GPtrArray *client_threads;	/* GThread * */
+	guint n_connections;
+	guint n_over_commands;
+} FakeNntpServer;
+
+static void
+fake_nntp_write (GOutputStream *ostream,
+		 const gchar *text)
+{
+	g_output_stream_write_all (ostream, text, strlen (text), NULL, NULL, NULL);
+}
+
+static void
+fake_nntp_write_overview (GOutputStream *ostream,
+			  guint low,
+			  guint high)
+{
+	GString *response;
+	guint nn;
+
+	response = g_string_new ("224 Overview information follows\r\n");
+
+	for (nn = MAX (low, 1); nn <= high && nn <= FAKE_N_ARTICLES; nn++) {
+		g_string_append_printf (response,
+			"%u\tSubject %u\tsender@example.com\tThu, 01 Jan 2026 00:00:00 +0000\t<%u@example.com>\t\t100\t5\r\n",
+			nn, nn, nn);
+	}
+
+	g_string_append (response, ".\r\n");
+
+	g_output_stream_write_all (ostream, response->str, response->len, NULL, NULL, NULL);
+	g_string_free (response, TRUE);
+}
+
+static gpointer
+fake_nntp_client_thread (gpointer user_data)
+{
+	GSocketConnection *connection = user_data;
+	FakeNntpServer *server = g_object_get_data (G_OBJECT (connection), "fake-server");
+	GDataInputStream *istream;
+	GOutputStream *ostream;
+	gchar *line;
+
+	istream = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+	g_data_input_stream_set_newline_type (istream, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+	ostream = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+	fake_nntp_write (ostream, "201 Fake NNTP server ready, no posting\r\n");
+
+	while ((line = g_data_input_stream_read_line (istream, NULL, NULL, NULL)) != NULL) {
+		if (!g_ascii_strcasecmp (line, "CAPABILITIES")) {
+			fake_nntp_write (ostream, "101 Capability list:\r\nVERSION 2\r\nREADER\r\nOVER\r\n.\r\n");
+		} else if (!g_ascii_strcasecmp (line, "MODE READER")) {
+			fake_nntp_write (ostream, "201 Posting prohibited\r\n");
+		} else if (!g_ascii_strcasecmp (line, "DATE")) {
+			fake_nntp_write (ostream, "111 20260101000000\r\n");
+		} else if (!g_ascii_strcasecmp (line, "LIST OVERVIEW.FMT")) {
+			fake_nntp_write (ostream, "215 Order of fields in overview database\r\n"
+				"Subject:\r\nFrom:\r\nDate:\r\nMessage-ID:\r\nReferences:\r\nBytes:\r\nLines:\r\n.\r\n");
+		} else if (!g_ascii_strcasecmp (line, "LIST")) {
+			gchar *response;
+
+			response = g_strdup_printf ("215 List of newsgroups follows\r\n%s %u 1 n\r\n.\r\n", FAKE_GROUP, FAKE_N_ARTICLES);
+			fake_nntp_write (ostream, response);
+			g_free (response);
+		} else if (!g_ascii_strncasecmp (line, "NEWGROUPS ", 10)) {
+			fake_nntp_write (ostream, "231 List of new newsgroups follows\r\n.\r\n");
+		} else if (!g_ascii_strcasecmp (line, "GROUP " FAKE_GROUP)) {
+			gchar *response;
+
+			response = g_strdup_printf ("211 %u 1 %u %s\r\n", FAKE_N_ARTICLES, FAKE_N_ARTICLES, FAKE_GROUP);
+			fake_nntp_write (ostream, response);
+			g_free (response);
+		} else if (!g_ascii_strncasecmp (line, "OVER ", 5) ||
+			   !g_ascii_strncasecmp (line, "XOVER ", 6)) {
+			gchar *range = strchr (line, ' ') + 1;
+			gchar *dash = NULL;
+			guint low, high;
+
+			low = strtoul (range, &dash, 10);
+			high = (dash && *dash == '-') ? strtoul (dash + 1, NULL, 10) : low;
+
+			g_mutex_lock (&server->lock);
+			server->n_over_commands++;
+			g_mutex_unlock (&server->lock);
+
+			/* the first range is the slowest, thus the later ranges
+			   are received before it with more connections */
+			if (low == 1)
+				g_usleep (G_USEC_PER_SEC / 2);
+
+			fake_nntp_write_overview (ostream, low, high);
+		} else if (!g_ascii_strcasecmp (line, "QUIT")) {
+			fake_nntp_write (ostream, "205 Bye\r\n");
+			g_free (line);
+			break;
+		} else {
+			fake_nntp_write (ostream, "500 Unknown command\r\n");
+		}
+
+		g_free (line);
+	}
+
+	g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+	g_object_unref (istream);
+	g_object_unref (connection);
+
+	return NULL;
+}
+
+static gpointer
+fake_nntp_accept_thread (gpointer user_data)
+{
+	FakeNntpServer *server = user_data;
+	GSocketConnection *connection;
+
+	/* runs until the listener is closed */
+	while ((connection = g_socket_listener_accept (server->listener, NULL, NULL, NULL)) != NULL) {
+		g_object_set_data (G_OBJECT (connection), "fake-server", server);
+
+		g_mutex_lock (&server->lock);
+		server->n_connections++;
+		g_ptr_array_add (server->client_threads, g_thread_new ("fake-nntp-client", fake_nntp_client_thread, connection));
+		g_mutex_unlock (&server->lock);
+	}
+
+	return NULL;
+}
+
+static FakeNntpServer *
+fake_nntp_server_new (void)
+{
+	FakeNntpServer *server;
+	GError *error = NULL;
+
+	server = g_new0 (FakeNntpServer, 1);
+	g_mutex_init (&server->lock);
+	server->client_threads = g_ptr_array_new ();
+	server->listener = g_socket_listener_new ();
+	server->port = g_socket_listener_add_any_inet_port (server->listener, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (server->port, !=, 0);
+
+	server->accept_thread = g_thread_new ("fake-nntp-server", fake_nntp_accept_thread, server);
+
+	return server;
+}
+
+static void
+fake_nntp_server_free (FakeNntpServer *server)
+{
+	guint ii;
+
+	g_socket_listener_close (server->listener);
+	g_thread_join (server->accept_thread);
+
+	/* the clients are disconnected already */
+	for (ii = 0; ii < server->client_threads->len; ii++) {
+		g_thread_join (g_ptr_array_index (server->client_threads, ii));
+	}
+
+	g_ptr_array_unref (server->client_threads);
+	g_object_unref (server->listener);
+	g_mutex_clear (&server->lock);
+	g_free (server);
+}
+
+static void
+test_flush_main_context (void)
+{
+	while (g_main_context_iteration (NULL, FALSE)) {
+	}
+}
+
+static void
+test_folder_changed_cb (CamelFolder *folder,
+			CamelFolderChangeInfo *changes,
+			gpointer user_data)
+{
+	GPtrArray *added_uids = user_data;
+	GPtrArray *uids;
+	guint ii;
+
+	uids = camel_folder_change_info_get_added_uids (changes);
+
+	for (ii = 0; uids && ii < uids->len; ii++) {
+		g_ptr_array_add (added_uids, g_strdup (g_ptr_array_index (uids, ii)));
+	}
+}
+
+static void
+test_nntp_overview (guint overview_connections)
+{
+	FakeNntpServer *server;
+	CamelSession *session;
+	CamelService *service;
+	CamelSettings *settings;
+	CamelFolderInfo *fi;
+	CamelFolder *folder;
+	GPtrArray *added_uids;
+	gulong handler_id;
+	guint ii, previous = 0, value = 0;
+	gboolean success;
+	GError *error = NULL;
+
+	server = fake_nntp_server_new ();
+
+	session = g_object_new (CAMEL_TYPE_TEST_SESSION,
+		"user-data-dir", camel_test_get_dir (),
+		"user-cache-dir", camel_test_get_dir (),
+		NULL);
+
+	service = camel_session_add_service (session, overview_connections > 1 ? "nntp-parallel" : "nntp-serial",
+		"nntp", CAMEL_PROVIDER_STORE, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (service);
+
+	settings = camel_service_ref_settings (service);
+	camel_network_settings_set_host (CAMEL_NETWORK_SETTINGS (settings), "127.0.0.1");
+	camel_network_settings_set_port (CAMEL_NETWORK_SETTINGS (settings), server->port);
+	camel_network_settings_set_security_method (CAMEL_NETWORK_SETTINGS (settings), CAMEL_NETWORK_SECURITY_METHOD_NONE);
+
+	/* only the main connection is used by default */
+	g_object_get (settings, "overview-connections", &value, NULL);
+	g_assert_cmpuint (value, ==, 1);
+
+	g_object_set (settings, "overview-connections", overview_connections, NULL);
+	g_object_unref (settings);
+
+	success = camel_offline_store_set_online_sync (CAMEL_OFFLINE_STORE (service), TRUE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	/* to have the group in the store summary */
+	fi = camel_store_get_folder_info_sync (CAMEL_STORE (service), NULL, CAMEL_STORE_FOLDER_INFO_RECURSIVE, NULL, &error);
+	g_assert_no_error (error);
+	camel_folder_info_free (fi);
+
+	folder = camel_store_get_folder_sync (CAMEL_STORE (service), FAKE_GROUP, 0, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (folder);
+
+	added_uids = g_ptr_array_new_with_free_func (g_free);
+	handler_id = g_signal_connect (folder, "changed", G_CALLBACK (test_folder_changed_cb), added_uids);
+
+	success = camel_folder_refresh_info_sync (folder, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	test_flush_main_context ();
+
+	/* all the articles are added, in the order of their numbers,
+	   regardless of the order the chunks had been received in */
+	g_assert_cmpuint (added_uids->len, ==, FAKE_N_ARTICLES);
+	g_assert_cmpint (camel_folder_get_message_count (folder), ==, FAKE_N_ARTICLES);
+
+	for (ii = 0; ii < added_uids->len; ii++) {
+		guint nn = strtoul (g_ptr_array_index (added_uids, ii), NULL, 10);
+
+		g_assert_cmpuint (nn, ==, previous + 1);
+		previous = nn;
+	}
+
+	g_signal_handler_disconnect (folder, handler_id);
+	g_ptr_array_unref (added_uids);
+	g_object_unref (folder);
+
+	success = camel_service_disconnect_sync (service, TRUE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	test_flush_main_context ();
+
+	camel_session_remove_service (session, service);
+	g_object_unref (service);
+	g_object_unref (session);
+
+	test_flush_main_context ();
+
+	/* the overviews are split into ranges, fetched in more connections when enabled */
+	g_assert_cmpuint (server->n_over_commands, >=, FAKE_N_ARTICLES / 5000);
+	if (overview_connections > 1)
+		g_assert_cmpuint (server->n_connections, >, 1);
+	else
+		g_assert_cmpuint (server->n_connections, ==, 1);
+
+	fake_nntp_server_free (server);
+}
+
+static void
+test_nntp_overview_serial (void)
+{
+	test_nntp_overview (1);
+}
+
+static void
+test_nntp_overview_parallel (void)
+{
+	test_nntp_overview (4);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	gint ret;
+
+	camel_test_init (&argc, &argv);
+	camel_test_provider_init (1, nntp_drivers);
+
+	g_test_add_func ("/Camel/NNTP/Overview/Serial", test_nntp_overview_serial);
+	g_test_add_func ("/Camel/NNTP/Overview/Parallel", test_nntp_overview_parallel);
+
+	ret = g_test_run ();
+	camel_test_shutdown ();
+	return ret;
+}
@@ -0,0 +1,387 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "evolution-data-server-config.h"
+
+#include <string.h>
+#include <gio/gio.h>
+
+#include <camel/camel.h>
+
+#include "camel-test.h"
+#include "camel-test-provider.h"
+#include "session.h"
+
+static const gchar *smtp_drivers[] = { "smtp" };
+
+/* A minimal SMTP server, which accepts a single connection and stores
+   the envelope and the message data as received */
+typedef struct _FakeSmtpServer {
+	GSocketListener *listener;
+	GThread *thread;
+	guint16 port;
+	gboolean chunking;
+
+	gchar *mail_from;
+	guint n_rcpts;
+	gboolean used_bdat;
+	gsize bdat_size;
+	GByteArray *data;
+} FakeSmtpServer;
+
+static void
+fake_smtp_write (GOutputStream *ostream,
+		 const gchar *text)
+{
+	g_output_stream_write_all (ostream, text, strlen (text), NULL, NULL, NULL);
+}
+
+static gpointer
+fake_smtp_server_thread (gpointer user_data)
+{
+	FakeSmtpServer *server = user_data;
+	GSocketConnection *connection;
+	GDataInputStream *istream;
+	GOutputStream *ostream;
+	gchar *line;
+	GError *error = NULL;
+
+	connection = g_socket_listener_accept (server->listener, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (connection);
+
+	istream = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+	g_data_input_stream_set_newline_type (istream, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+	ostream = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+	fake_smtp_write (ostream, "220 localhost ESMTP test server\r\n");
+
+	while ((line = g_data_input_stream_read_line (istream, NULL, NULL, NULL)) != NULL) {
+		if (!g_ascii_strncasecmp (line, "EHLO ", 5)) {
+			fake_smtp_write (ostream, "250-localhost\r\n250-PIPELINING\r\n");
+			if (server->chunking)
+				fake_smtp_write (ostream, "250-CHUNKING\r\n250-BINARYMIME\r\n");
+			fake_smtp_write (ostream, "250 8BITMIME\r\n");
+		} else if (!g_ascii_strncasecmp (line, "MAIL FROM:", 10)) {
+			g_free (server->mail_from);
+			server->mail_from = g_strdup (line);
+			fake_smtp_write (ostream, "250 2.1.0 Ok\r\n");
+		} else if (!g_ascii_strncasecmp (line, "RCPT TO:", 8)) {
+			server->n_rcpts++;
+			fake_smtp_write (ostream, "250 2.1.5 Ok\r\n");
+		} else if (!g_ascii_strncasecmp (line, "BDAT ", 5)) {
+			gsize bytes_read = 0;
+			gchar *buffer;
+
+			server->used_bdat = TRUE;
+			server->bdat_size = g_ascii_strtoull (line + 5, NULL, 10);
+			g_assert_true (g_str_has_suffix (line, " LAST"));
+
+			buffer = g_malloc (server->bdat_size);
+			g_input_stream_read_all (G_INPUT_STREAM (istream), buffer, server->bdat_size, &bytes_read, NULL, &error);
+			g_assert_no_error (error);
+			g_byte_array_append (server->data, (const guint8 *) buffer, bytes_read);
+			g_free (buffer);
+
+			fake_smtp_write (ostream, "250 2.0.0 Ok: queued\r\n");
+		} else if (!g_ascii_strcasecmp (line, "DATA")) {
+			fake_smtp_write (ostream, "354 End data with <CR><LF>.<CR><LF>\r\n");
+
+			g_free (line);
+
+			while ((line = g_data_input_stream_read_line (istream, NULL, NULL, NULL)) != NULL) {
+				if (!strcmp (line, "."))
+					break;
+
+				g_byte_array_append (server->data, (const guint8 *) line, strlen (line));
+				g_byte_array_append (server->data, (const guint8 *) "\r\n", 2);
+				g_free (line);
+			}
+
+			fake_smtp_write (ostream, "250 2.0.0 Ok: queued\r\n");
+		} else if (!g_ascii_strcasecmp (line, "RSET")) {
+			fake_smtp_write (ostream, "250 2.0.0 Ok\r\n");
+		} else if (!g_ascii_strcasecmp (line, "QUIT")) {
+			fake_smtp_write (ostream, "221 2.0.0 Bye\r\n");
+			g_free (line);
+			break;
+		} else {
+			fake_smtp_write (ostream, "502 5.5.2 Command not recognized\r\n");
+		}
+
+		g_free (line);
+	}
+
+	g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+	g_object_unref (istream);
+	g_object_unref (connection);
+
+	return NULL;
+}
+
+static FakeSmtpServer *
+fake_smtp_server_new (gboolean chunking)
+{
+	FakeSmtpServer *server;
+	GError *error = NULL;
+
+	server = g_new0 (FakeSmtpServer, 1);
+	server->chunking = chunking;
+	server->data = g_byte_array_new ();
+	server->listener = g_socket_listener_new ();
+	server->port = g_socket_listener_add_any_inet_port (server->listener, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (server->port, !=, 0);
+
+	server->thread = g_thread_new ("fake-smtp-server", fake_smtp_server_thread, server);
+
+	return server;
+}
+
+static void
+fake_smtp_server_free (FakeSmtpServer *server)
+{
+	g_socket_listener_close (server->listener);
+	g_object_unref (server->listener);
+	g_byte_array_unref (server->data);
+	g_free (server->mail_from);
+	g_free (server);
+}
+
+static CamelService *
+test_smtp_connect (CamelSession *session,
+		   FakeSmtpServer *server)
+{
+	CamelService *service;
+	CamelSettings *settings;
+	GError *error = NULL;
+	gboolean success;
+
+	service = camel_session_add_service (session, "smtp-test", "smtp", CAMEL_PROVIDER_TRANSPORT, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (service);
+
+	settings = camel_service_ref_settings (service);
+	camel_network_settings_set_host (CAMEL_NETWORK_SETTINGS (settings), "127.0.0.1");
+	camel_network_settings_set_port (CAMEL_NETWORK_SETTINGS (settings), server->port);
+	camel_network_settings_set_security_method (CAMEL_NETWORK_SETTINGS (settings), CAMEL_NETWORK_SECURITY_METHOD_NONE);
+	g_object_unref (settings);
+
+	success = camel_service_connect_sync (service, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	return service;
+}
+
+static void
+test_smtp_send (FakeSmtpServer *server,
+		CamelMimeMessage *message)
+{
+	CamelSession *session;
+	CamelService *service;
+	CamelInternetAddress *from, *recipients;
+	GError *error = NULL;
+	gboolean success;
+
+	session = g_object_new (CAMEL_TYPE_TEST_SESSION,
+		"user-data-dir", camel_test_get_dir (),
+		"user-cache-dir", camel_test_get_dir (),
+		NULL);
+
+	service = test_smtp_connect (session, server);
+
+	from = camel_internet_address_new ();
+	camel_internet_address_add (from, "sender", "sender@example.com");
+
+	recipients = camel_internet_address_new ();
+	camel_internet_address_add (recipients, "first", "first@example.com");
+	camel_internet_address_add (recipients, "second", "second@example.com");
+	camel_internet_address_add (recipients, "hidden", "hidden@example.com");
+
+	success = camel_transport_send_to_sync (CAMEL_TRANSPORT (service), message,
+		CAMEL_ADDRESS (from), CAMEL_ADDRESS (recipients), NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	success = camel_service_disconnect_sync (service, TRUE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+
+	g_thread_join (server->thread);
+	server->thread = NULL;
+
+	g_assert_nonnull (server->mail_from);
+	g_assert_cmpuint (server->n_rcpts, ==, 3);
+
+	/* the Bcc header is not sent, but it is kept in the message */
+	g_assert_null (g_strstr_len ((const gchar *) server->data->data, server->data->len, "\r\nBcc:"));
+	g_assert_cmpstr (camel_medium_get_header (CAMEL_MEDIUM (message), "Bcc"), !=, NULL);
+
+	g_object_unref (from);
+	g_object_unref (recipients);
+	camel_session_remove_service (session, service);
+	g_object_unref (service);
+	g_object_unref (session);
+}
+
+static CamelMimeMessage *
+test_smtp_create_message (gboolean with_binary)
+{
+	CamelMimeMessage *message;
+	CamelInternetAddress *addr;
+	const gchar *text = "First line\n.line with a leading dot\n\nFrom the last line\n";
+
+	message = camel_mime_message_new ();
+	camel_mime_message_set_subject (message, "Test message");
+	camel_mime_message_set_date (message, 0, 0);
+
+	addr = camel_internet_address_new ();
+	camel_internet_address_add (addr, "sender", "sender@example.com");
+	camel_mime_message_set_from (message, addr);
+	g_object_unref (addr);
+
+	addr = camel_internet_address_new ();
+	camel_internet_address_add (addr, "hidden", "hidden@example.com");
+	camel_mime_message_set_recipients (message, CAMEL_RECIPIENT_TYPE_BCC, addr);
+	g_object_unref (addr);
+
+	if (with_binary) {
+		CamelMultipart *multipart;
+		CamelMimePart *part;
+		const gchar binary[] = { 'a', '\n', 'b', '\r', 'c', '\0', (gchar) 0xff, '\r', '\n' };
+
+		multipart = camel_multipart_new ();
+		camel_data_wrapper_set_mime_type (CAMEL_DATA_WRAPPER (multipart), "multipart/mixed");
+		camel_multipart_set_boundary (multipart, NULL);
+
+		part = camel_mime_part_new ();
+		camel_mime_part_set_content (part, text, strlen (text), "text/plain");
+		camel_multipart_add_part (multipart, part);
+		g_object_unref (part);
+
+		part = camel_mime_part_new ();
+		camel_mime_part_set_content (part, binary, sizeof (binary), "application/octet-stream");
+		camel_mime_part_set_encoding (part, CAMEL_TRANSFER_ENCODING_BINARY);
+		camel_multipart_add_part (multipart, part);
+		g_object_unref (part);
+
+		camel_medium_set_content (CAMEL_MEDIUM (message), CAMEL_DATA_WRAPPER (multipart));
+		g_object_unref (multipart);
+	} else {
+		camel_mime_part_set_content (CAMEL_MIME_PART (message), text, strlen (text), "text/plain");
+	}
+
+	return message;
+}
+
+static void
+test_assert_crlf_only (GByteArray *data)
+{
+	guint ii;
+
+	g_assert_cmpuint (data->len, >, 2);
+	g_assert_cmpint (data->data[data->len - 2], ==, '\r');
+	g_assert_cmpint (data->data[data->len - 1], ==, '\n');
+
+	for (ii = 0; ii < data->len; ii++) {
+		if (data->data[ii] == '\n')
+			g_assert_true (ii > 0 && data->data[ii - 1] == '\r');
+	}
+}
+
+static void
+test_smtp_bdat (void)
+{
+	FakeSmtpServer *server;
+	CamelMimeMessage *message;
+	const gchar *data;
+
+	server = fake_smtp_server_new (TRUE);
+	message = test_smtp_create_message (FALSE);
+
+	test_smtp_send (server, message);
+
+	g_assert_true (server->used_bdat);
+
+	/* the announced chunk size matches what had been sent */
+	g_assert_cmpuint (server->bdat_size, >, 0);
+	g_assert_cmpuint (server->data->len, ==, server->bdat_size);
+	test_assert_crlf_only (server->data);
+
+	/* no dot stuffing with BDAT */
+	data = (const gchar *) server->data->data;
+	g_assert_nonnull (g_strstr_len (data, server->data->len, "\r\n.line with a leading dot\r\n"));
+	g_assert_null (g_strstr_len (data, server->data->len, "\r\n..line"));
+	g_assert_nonnull (g_strstr_len (data, server->data->len, "\r\nSubject: Test message\r\n"));
+
+	g_object_unref (message);
+	fake_smtp_server_free (server);
+}
+
+static void
+test_smtp_bdat_binary (void)
+{
+	FakeSmtpServer *server;
+	CamelMimeMessage *message;
+
+	server = fake_smtp_server_new (TRUE);
+	message = test_smtp_create_message (TRUE);
+
+	test_smtp_send (server, message);
+
+	g_assert_true (server->used_bdat);
+	g_assert_cmpuint (server->data->len, ==, server->bdat_size);
+	test_assert_crlf_only (server->data);
+
+	/* the message goes through the LF->CRLF conversion, which is
+	   not valid for BINARYMIME, thus it cannot be declared */
+	g_assert_null (camel_strstrcase (server->mail_from, "BINARYMIME"));
+
+	g_object_unref (message);
+	fake_smtp_server_free (server);
+}
+
+static void
+test_smtp_data (void)
+{
+	FakeSmtpServer *server;
+	CamelMimeMessage *message;
+	const gchar *data;
+
+	server = fake_smtp_server_new (FALSE);
+	message = test_smtp_create_message (FALSE);
+
+	test_smtp_send (server, message);
+
+	g_assert_false (server->used_bdat);
+	test_assert_crlf_only (server->data);
+
+	/* the lines beginning with a dot are escaped with DATA */
+	data = (const gchar *) server->data->data;
+	g_assert_nonnull (g_strstr_len (data, server->data->len, "\r\n..line with a leading dot\r\n"));
+	g_assert_nonnull (g_strstr_len (data, server->data->len, "\r\nSubject: Test message\r\n"));
+
+	g_object_unref (message);
+	fake_smtp_server_free (server);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	gint ret;
+
+	camel_test_init (&argc, &argv);
+	camel_test_provider_init (1, smtp_drivers);
+
+	g_test_add_func ("/Camel/Provider/SMTP/bdat", test_smtp_bdat);
+	g_test_add_func ("/Camel/Provider/SMTP/bdat-binary", test_smtp_bdat_binary);
+	g_test_add_func ("/Camel/Provider/SMTP/data", test_smtp_data);
+
+	ret = g_test_run ();
+	camel_test_shutdown ();
+	return ret;
+}
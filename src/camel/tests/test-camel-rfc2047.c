@@ -93,6 +93,40 @@ test_rfc2047_ctext_decoding (void)
 	}
 }
 
+static void
+test_rfc2047_decoding_into (void)
+{
+	const gchar *plain = "Re: a plain subject, without encoded words";
+	gchar buffer[128];
+	gchar *text;
+	gsize len;
+	gint i;
+
+	for (i = 0; i < G_N_ELEMENTS (test1); i++) {
+		len = camel_header_decode_string_into (test1[i].encoded, "iso-8859-1", buffer, sizeof (buffer));
+		g_assert_cmpuint (len, <, sizeof (buffer));
+		g_assert_cmpstr (buffer, ==, test1[i].decoded);
+		g_assert_cmpuint (len, ==, strlen (test1[i].decoded));
+	}
+
+	len = camel_header_decode_string_into (plain, NULL, buffer, sizeof (buffer));
+	g_assert_cmpuint (len, ==, strlen (plain));
+	g_assert_cmpstr (buffer, ==, plain);
+
+	/* too small buffer is not touched */
+	strcpy (buffer, "xyz");
+	len = camel_header_decode_string_into (plain, NULL, buffer, 10);
+	g_assert_cmpuint (len, ==, strlen (plain));
+	g_assert_cmpstr (buffer, ==, "xyz");
+
+	/* decode in place */
+	text = g_strdup (test1[0].encoded);
+	len = camel_header_decode_string_into (text, NULL, text, strlen (text) + 1);
+	g_assert_cmpuint (len, ==, strlen (test1[0].decoded));
+	g_assert_cmpstr (text, ==, test1[0].decoded);
+	g_free (text);
+}
+
 gint
 main (gint argc,
       gchar **argv)
@@ -103,6 +137,7 @@ main (gint argc,
 
 	g_test_add_func ("/Camel/RFC2047/decoding", test_rfc2047_decoding);
 	g_test_add_func ("/Camel/RFC2047/ctext-decoding", test_rfc2047_ctext_decoding);
+	g_test_add_func ("/Camel/RFC2047/decoding-into", test_rfc2047_decoding_into);
 
 	ret = g_test_run ();
 	camel_test_shutdown ();
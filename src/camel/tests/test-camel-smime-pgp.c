@@ -103,6 +103,43 @@ setup_gpg_environment (void)
 	g_free (sec_file);
 }
 
+/* moves the modification time of the keyring files forward */
+static void
+touch_keyring (void)
+{
+	const gchar *files[] = {
+		"pubring.kbx",
+		"pubring.gpg",
+		"trustdb.gpg",
+		"public-keys.d/pubring.db"
+	};
+	guint ii, n_touched = 0;
+
+	for (ii = 0; ii < G_N_ELEMENTS (files); ii++) {
+		GFileInfo *info;
+		GFile *file;
+		gchar *path;
+
+		path = g_build_filename (g_getenv ("GNUPGHOME"), files[ii], NULL);
+		file = g_file_new_for_path (path);
+		info = g_file_query_info (file, G_FILE_ATTRIBUTE_TIME_MODIFIED, G_FILE_QUERY_INFO_NONE, NULL, NULL);
+
+		if (info) {
+			guint64 mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+			if (g_file_set_attribute_uint64 (file, G_FILE_ATTRIBUTE_TIME_MODIFIED, mtime + 10, G_FILE_QUERY_INFO_NONE, NULL, NULL))
+				n_touched++;
+
+			g_object_unref (info);
+		}
+
+		g_object_unref (file);
+		g_free (path);
+	}
+
+	g_assert_cmpuint (n_touched, >, 0);
+}
+
 static void
 test_pgp_sign_verify (void)
 {
@@ -113,6 +150,8 @@ test_pgp_sign_verify (void)
 	CamelMimePart *sigpart, *conpart;
 	CamelDataWrapper *dw;
 	GError *error = NULL;
+	guint64 hits = 0, misses = 0, hits2 = 0, misses2 = 0;
+	guint ii;
 
 	if (!gpg_available) {
 		g_test_skip ("GPG is not available");
@@ -168,6 +207,52 @@ test_pgp_sign_verify (void)
 	g_assert_true (camel_cipher_validity_get_valid (valid));
 	camel_cipher_validity_free (valid);
 
+	/* repeated verifications of the same message do not need to run gpg */
+	camel_gpg_context_get_verify_cache_stats (&hits, &misses);
+
+	for (ii = 0; ii < 10; ii++) {
+		CamelCipherContext *ctx2;
+
+		ctx2 = camel_gpg_context_new (session);
+		camel_gpg_context_set_always_trust (CAMEL_GPG_CONTEXT (ctx2), TRUE);
+
+		valid = camel_cipher_context_verify_sync (ctx2, sigpart, NULL, &error);
+		if (error != NULL)
+			g_error ("PGP verify (repeated) failed: %s", error->message);
+		g_assert_true (camel_cipher_validity_get_valid (valid));
+		camel_cipher_validity_free (valid);
+
+		g_clear_object (&ctx2);
+	}
+
+	camel_gpg_context_get_verify_cache_stats (&hits2, &misses2);
+	g_assert_cmpuint (hits2, ==, hits + 10);
+	g_assert_cmpuint (misses2, ==, misses);
+
+	/* any change of the keyring invalidates the cached results */
+	touch_keyring ();
+
+	valid = camel_cipher_context_verify_sync (ctx, sigpart, NULL, &error);
+	if (error != NULL)
+		g_error ("PGP verify (keyring changed) failed: %s", error->message);
+	g_assert_true (camel_cipher_validity_get_valid (valid));
+	camel_cipher_validity_free (valid);
+
+	camel_gpg_context_get_verify_cache_stats (&hits, &misses);
+	g_assert_cmpuint (hits, ==, hits2);
+	g_assert_cmpuint (misses, ==, misses2 + 1);
+
+	/* and the new result is cached again */
+	valid = camel_cipher_context_verify_sync (ctx, sigpart, NULL, &error);
+	if (error != NULL)
+		g_error ("PGP verify (cached again) failed: %s", error->message);
+	g_assert_true (camel_cipher_validity_get_valid (valid));
+	camel_cipher_validity_free (valid);
+
+	camel_gpg_context_get_verify_cache_stats (&hits2, &misses2);
+	g_assert_cmpuint (hits2, ==, hits + 1);
+	g_assert_cmpuint (misses2, ==, misses);
+
 	g_clear_object (&conpart);
 	g_clear_object (&sigpart);
 	g_clear_object (&ctx);
@@ -0,0 +1,219 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "evolution-data-server-config.h"
+
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "camel-test.h"
+
+static GPtrArray *
+build_uids (guint from,
+            guint to)
+{
+	GPtrArray *uids;
+	guint ii;
+
+	uids = g_ptr_array_new_with_free_func (g_free);
+
+	for (ii = from; ii < to; ii++)
+		g_ptr_array_add (uids, g_strdup_printf ("uid-%05u", ii));
+
+	return uids;
+}
+
+static guint
+count_lines (const gchar *filename)
+{
+	gchar *contents = NULL;
+	guint n_lines = 0;
+	const gchar *ptr;
+
+	g_assert_true (g_file_get_contents (filename, &contents, NULL, NULL));
+
+	for (ptr = contents; *ptr; ptr++) {
+		if (*ptr == '\n')
+			n_lines++;
+	}
+
+	g_free (contents);
+
+	return n_lines;
+}
+
+static void
+test_save_and_load (void)
+{
+	CamelUIDCache *cache;
+	GPtrArray *uids, *new_uids;
+	gchar *filename;
+	guint ii;
+
+	filename = g_build_filename (camel_test_get_dir (), "uid-cache", NULL);
+	g_unlink (filename);
+
+	cache = camel_uid_cache_new (filename);
+	g_assert_nonnull (cache);
+
+	uids = build_uids (0, 100);
+	new_uids = camel_uid_cache_dup_new_uids (cache, uids);
+	g_assert_cmpuint (new_uids->len, ==, 100);
+
+	/* the same as the filter driver does */
+	for (ii = 0; ii < new_uids->len; ii++) {
+		camel_uid_cache_save_uid (cache, new_uids->pdata[ii]);
+		if ((ii % 10) == 0)
+			g_assert_true (camel_uid_cache_save (cache));
+	}
+
+	g_assert_true (camel_uid_cache_save (cache));
+	g_assert_cmpuint (count_lines (filename), ==, 100);
+
+	g_ptr_array_unref (new_uids);
+	g_ptr_array_unref (uids);
+	camel_uid_cache_destroy (cache);
+
+	cache = camel_uid_cache_new (filename);
+	g_assert_nonnull (cache);
+
+	/* five new messages on the server */
+	uids = build_uids (0, 105);
+	new_uids = camel_uid_cache_dup_new_uids (cache, uids);
+	g_assert_cmpuint (new_uids->len, ==, 5);
+	g_assert_cmpstr (new_uids->pdata[0], ==, "uid-00100");
+
+	for (ii = 0; ii < new_uids->len; ii++)
+		camel_uid_cache_save_uid (cache, new_uids->pdata[ii]);
+
+	/* saving twice does not store the UIDs twice */
+	g_assert_true (camel_uid_cache_save (cache));
+	g_assert_true (camel_uid_cache_save (cache));
+	g_assert_cmpuint (count_lines (filename), ==, 105);
+
+	g_ptr_array_unref (new_uids);
+	g_ptr_array_unref (uids);
+	camel_uid_cache_destroy (cache);
+
+	g_unlink (filename);
+	g_free (filename);
+}
+
+static void
+test_expire (void)
+{
+	CamelUIDCache *cache;
+	GPtrArray *uids, *new_uids;
+	gchar *filename;
+	guint ii;
+
+	filename = g_build_filename (camel_test_get_dir (), "uid-cache-expire", NULL);
+	g_unlink (filename);
+
+	cache = camel_uid_cache_new (filename);
+	g_assert_nonnull (cache);
+
+	uids = build_uids (0, 100);
+	new_uids = camel_uid_cache_dup_new_uids (cache, uids);
+	for (ii = 0; ii < new_uids->len; ii++)
+		camel_uid_cache_save_uid (cache, new_uids->pdata[ii]);
+	g_assert_true (camel_uid_cache_save (cache));
+	g_ptr_array_unref (new_uids);
+	g_ptr_array_unref (uids);
+
+	/* a few messages deleted on the server, the file is only appended */
+	uids = build_uids (5, 110);
+	new_uids = camel_uid_cache_dup_new_uids (cache, uids);
+	g_assert_cmpuint (new_uids->len, ==, 10);
+	for (ii = 0; ii < new_uids->len; ii++)
+		camel_uid_cache_save_uid (cache, new_uids->pdata[ii]);
+	g_assert_true (camel_uid_cache_save (cache));
+	g_assert_cmpuint (count_lines (filename), ==, 110);
+	g_ptr_array_unref (new_uids);
+	g_ptr_array_unref (uids);
+
+	/* most of them deleted on the server, the file is written again */
+	uids = build_uids (80, 110);
+	new_uids = camel_uid_cache_dup_new_uids (cache, uids);
+	g_assert_cmpuint (new_uids->len, ==, 0);
+	g_assert_true (camel_uid_cache_save (cache));
+	g_assert_cmpuint (count_lines (filename), ==, 30);
+	g_ptr_array_unref (new_uids);
+	g_ptr_array_unref (uids);
+
+	camel_uid_cache_destroy (cache);
+
+	cache = camel_uid_cache_new (filename);
+	g_assert_nonnull (cache);
+
+	uids = build_uids (0, 110);
+	new_uids = camel_uid_cache_dup_new_uids (cache, uids);
+	g_assert_cmpuint (new_uids->len, ==, 80);
+	g_ptr_array_unref (new_uids);
+	g_ptr_array_unref (uids);
+
+	camel_uid_cache_destroy (cache);
+
+	g_unlink (filename);
+	g_free (filename);
+}
+
+static void
+test_incomplete_line (void)
+{
+	CamelUIDCache *cache;
+	GPtrArray *uids, *new_uids;
+	gchar *filename;
+
+	filename = g_build_filename (camel_test_get_dir (), "uid-cache-incomplete", NULL);
+
+	/* as if an append had been interrupted */
+	g_assert_true (g_file_set_contents (filename, "uid-00000\nuid-00001\nuid-0", -1, NULL));
+
+	cache = camel_uid_cache_new (filename);
+	g_assert_nonnull (cache);
+
+	uids = build_uids (0, 3);
+	new_uids = camel_uid_cache_dup_new_uids (cache, uids);
+	g_assert_cmpuint (new_uids->len, ==, 1);
+	camel_uid_cache_save_uid (cache, new_uids->pdata[0]);
+	g_assert_true (camel_uid_cache_save (cache));
+	g_ptr_array_unref (new_uids);
+	g_ptr_array_unref (uids);
+
+	camel_uid_cache_destroy (cache);
+
+	g_assert_cmpuint (count_lines (filename), ==, 3);
+
+	cache = camel_uid_cache_new (filename);
+	g_assert_nonnull (cache);
+	uids = build_uids (0, 3);
+	new_uids = camel_uid_cache_dup_new_uids (cache, uids);
+	g_assert_cmpuint (new_uids->len, ==, 0);
+	g_ptr_array_unref (new_uids);
+	g_ptr_array_unref (uids);
+	camel_uid_cache_destroy (cache);
+
+	g_unlink (filename);
+	g_free (filename);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	gint ret;
+
+	camel_test_init (&argc, &argv);
+
+	g_test_add_func ("/Camel/UIDCache/save-and-load", test_save_and_load);
+	g_test_add_func ("/Camel/UIDCache/expire", test_expire);
+	g_test_add_func ("/Camel/UIDCache/incomplete-line", test_incomplete_line);
+
+	ret = g_test_run ();
+	camel_test_shutdown ();
+	return ret;
+}
@@ -20,7 +20,9 @@
 #include "evolution-data-server-config.h"
 
 #include <errno.h>
+#include <string.h>
 #include <sqlite3.h>
+#include <zlib.h>
 
 #include <glib.h>
 #include <glib/gi18n-lib.h>
@@ -35,6 +37,8 @@
 
 #define E_CACHE_KEY_VERSION	"version"
 #define E_CACHE_KEY_REVISION	"revision"
+#define E_CACHE_KEY_COMPRESS_OBJECTS	"compress_objects"
+#define E_CACHE_KEY_DICTIONARY	"object_dictionary"
 
 /* The number of SQLite virtual machine instructions that are
  * evaluated at a time, the user passed GCancellable is
@@ -45,6 +49,47 @@
 /* How many rows to read when e_cache_foreach_update() */
 #define E_CACHE_UPDATE_BATCH_SIZE	100
 
+/* How many prepared statements to keep; the least recently used are finalized when full */
+#define E_CACHE_MAX_PREPARED_STMTS	64
+
+/* At most how many read-only connections can be opened by e_cache_enable_wal_sync() */
+#define E_CACHE_MAX_READERS		8
+
+/* The compressed objects are stored as:
+ *    E_CACHE_COMPRESSED_MAGIC <dictionary ID> ':' <uncompressed length> ':' <data>
+ * where the <data> is a raw deflate stream with the 0x00 and 0x01 bytes
+ * escaped as 0x01 0x01 and 0x01 0x02, thus it can be read as a text
+ * by the sqlite3_exec(). The dictionary ID 0 means no dictionary.
+ * No vCard nor iCalendar object can start with the magic.
+ */
+#define E_CACHE_COMPRESSED_MAGIC	"\001Z"
+
+/* Shorter objects are not compressed */
+#define E_CACHE_COMPRESS_MIN_LENGTH	128
+
+/* After how many objects stored without a dictionary a new one is trained */
+#define E_CACHE_DICTIONARY_TRAIN_PUTS	256
+
+/* How many objects are sampled to train the dictionary, and how many at least */
+#define E_CACHE_DICTIONARY_SAMPLES	256
+#define E_CACHE_DICTIONARY_MIN_SAMPLES	16
+
+/* The deflate window is 32KB, the dictionary should leave space for the object itself */
+#define E_CACHE_DICTIONARY_MAX_SIZE	16384
+
+struct _ECacheStmt {
+	sqlite3_stmt *stmt;
+	gchar *sql;
+	GList *lru_link;	/* in ECachePrivate::prepared_stmts_lru */
+	guint in_use;		/* prepared, but not executed yet; such is not finalized */
+};
+
+/* A read-only connection, used for SELECT statements outside of a transaction */
+typedef struct _ECacheReader {
+	sqlite3 *db;
+	GCancellable *cancellable;	/* User passed GCancellable; used only by the thread which took the reader */
+} ECacheReader;
+
 struct _ECachePrivate {
 	gchar *filename;
 	sqlite3 *db;
@@ -58,6 +103,21 @@ struct _ECachePrivate {
 	gint revision_counter;
 	gint64 last_revision_time;
 	gboolean needs_revision_change;
+
+	GHashTable *prepared_stmts;	/* gchar *sql ~> ECacheStmt *; guarded by lock */
+	GQueue prepared_stmts_lru;	/* ECacheStmt *, the most recently used first; guarded by lock */
+
+	gpointer transaction_thread;	/* GThread * which started the outermost transaction; accessed atomically */
+	GMutex readers_lock;
+	GPtrArray *readers;		/* ECacheReader *, all the opened read-only connections; guarded by readers_lock */
+	GQueue unused_readers;		/* ECacheReader *, currently not used; guarded by readers_lock */
+
+	GMutex compression_lock;
+	gboolean compress_objects;	/* guarded by compression_lock */
+	guint dictionary_id;		/* the dictionary for newly compressed objects, 0 for none; guarded by compression_lock */
+	GHashTable *dictionaries;	/* GUINT_TO_POINTER (id) ~> GBytes *; guarded by compression_lock */
+	guint n_puts_without_dictionary; /* guarded by lock */
+	gboolean compression_changed;	/* in the current transaction; guarded by lock */
 };
 
 enum {
@@ -498,6 +558,293 @@ struct CacheSQLiteExecData {
 	gpointer user_data;
 };
 
+static GBytes *
+e_cache_ref_dictionary (ECache *cache,
+			guint dictionary_id)
+{
+	GBytes *dictionary = NULL;
+
+	if (!dictionary_id)
+		return NULL;
+
+	g_mutex_lock (&cache->priv->compression_lock);
+
+	dictionary = g_hash_table_lookup (cache->priv->dictionaries, GUINT_TO_POINTER (dictionary_id));
+	if (dictionary)
+		g_bytes_ref (dictionary);
+
+	g_mutex_unlock (&cache->priv->compression_lock);
+
+	return dictionary;
+}
+
+/* Returns the ID of the dictionary the @stored_object had been compressed with,
+   and sets the @out_length and the @out_data, or returns -1 when the header is invalid */
+static gint64
+e_cache_parse_compressed_header (const gchar *stored_object,
+				 gsize *out_length,
+				 const gchar **out_data)
+{
+	const gchar *ptr;
+	gchar *endptr = NULL;
+	guint64 dictionary_id, length;
+
+	ptr = stored_object + strlen (E_CACHE_COMPRESSED_MAGIC);
+
+	dictionary_id = g_ascii_strtoull (ptr, &endptr, 10);
+	if (!endptr || endptr == ptr || *endptr != ':' || dictionary_id > G_MAXUINT)
+		return -1;
+
+	ptr = endptr + 1;
+	endptr = NULL;
+
+	length = g_ascii_strtoull (ptr, &endptr, 10);
+	if (!endptr || endptr == ptr || *endptr != ':' || length >= G_MAXINT)
+		return -1;
+
+	*out_length = length;
+	*out_data = endptr + 1;
+
+	return dictionary_id;
+}
+
+/* Returns the @object compressed, or %NULL, when it's not worth it */
+static gchar *
+e_cache_compress_object_internal (ECache *cache,
+				  const gchar *object)
+{
+	GBytes *dictionary = NULL;
+	GString *result;
+	z_stream zs = { 0, };
+	guchar *data;
+	gsize length, data_length, ii;
+	guint dictionary_id;
+	gint ret;
+
+	length = strlen (object);
+	if (length < E_CACHE_COMPRESS_MIN_LENGTH || length >= G_MAXINT)
+		return NULL;
+
+	g_mutex_lock (&cache->priv->compression_lock);
+	dictionary_id = cache->priv->dictionary_id;
+	g_mutex_unlock (&cache->priv->compression_lock);
+
+	dictionary = e_cache_ref_dictionary (cache, dictionary_id);
+	if (!dictionary)
+		dictionary_id = 0;
+
+	if (deflateInit2 (&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		g_clear_pointer (&dictionary, g_bytes_unref);
+		return NULL;
+	}
+
+	if (dictionary) {
+		gsize dictionary_length = 0;
+		gconstpointer dictionary_data;
+
+		dictionary_data = g_bytes_get_data (dictionary, &dictionary_length);
+		deflateSetDictionary (&zs, dictionary_data, dictionary_length);
+	}
+
+	data_length = deflateBound (&zs, length);
+	data = g_malloc (data_length);
+
+	zs.next_in = (Bytef *) object;
+	zs.avail_in = length;
+	zs.next_out = data;
+	zs.avail_out = data_length;
+
+	ret = deflate (&zs, Z_FINISH);
+	data_length = zs.total_out;
+
+	deflateEnd (&zs);
+	g_clear_pointer (&dictionary, g_bytes_unref);
+
+	/* the header takes some bytes too */
+	if (ret != Z_STREAM_END || data_length + 16 >= length) {
+		g_free (data);
+		return NULL;
+	}
+
+	result = g_string_sized_new (data_length + (data_length / 64) + 32);
+	g_string_append_printf (result, E_CACHE_COMPRESSED_MAGIC "%u:%" G_GSIZE_FORMAT ":", dictionary_id, length);
+
+	for (ii = 0; ii < data_length; ii++) {
+		if (data[ii] <= 0x01) {
+			g_string_append_c (result, 0x01);
+			g_string_append_c (result, data[ii] + 1);
+		} else {
+			g_string_append_c (result, data[ii]);
+		}
+	}
+
+	g_free (data);
+
+	if (result->len >= length) {
+		g_string_free (result, TRUE);
+		return NULL;
+	}
+
+	return g_string_free (result, FALSE);
+}
+
+static gchar *
+e_cache_decompress_object_internal (ECache *cache,
+				    const gchar *stored_object)
+{
+	GBytes *dictionary = NULL;
+	z_stream zs = { 0, };
+	const gchar *ptr = NULL;
+	guchar *data;
+	gchar *object;
+	gsize length = 0, data_length = 0;
+	gint64 dictionary_id;
+	gboolean valid = TRUE;
+	gint ret;
+
+	dictionary_id = e_cache_parse_compressed_header (stored_object, &length, &ptr);
+	if (dictionary_id < 0)
+		return NULL;
+
+	if (dictionary_id) {
+		dictionary = e_cache_ref_dictionary (cache, (guint) dictionary_id);
+		if (!dictionary)
+			return NULL;
+	}
+
+	data = g_malloc (strlen (ptr) + 1);
+
+	for (; valid && *ptr; ptr++) {
+		if (*ptr == 0x01) {
+			ptr++;
+
+			valid = *ptr == 0x01 || *ptr == 0x02;
+			data[data_length++] = *ptr - 1;
+		} else {
+			data[data_length++] = *ptr;
+		}
+	}
+
+	if (!valid || inflateInit2 (&zs, -MAX_WBITS) != Z_OK) {
+		g_clear_pointer (&dictionary, g_bytes_unref);
+		g_free (data);
+		return NULL;
+	}
+
+	if (dictionary) {
+		gsize dictionary_length = 0;
+		gconstpointer dictionary_data;
+
+		dictionary_data = g_bytes_get_data (dictionary, &dictionary_length);
+		inflateSetDictionary (&zs, dictionary_data, dictionary_length);
+	}
+
+	object = g_malloc (length + 1);
+
+	zs.next_in = data;
+	zs.avail_in = data_length;
+	zs.next_out = (Bytef *) object;
+	zs.avail_out = length;
+
+	ret = inflate (&zs, Z_FINISH);
+
+	if (ret != Z_STREAM_END || zs.total_out != length) {
+		g_clear_pointer (&object, g_free);
+	} else {
+		object[length] = '\0';
+	}
+
+	inflateEnd (&zs);
+	g_clear_pointer (&dictionary, g_bytes_unref);
+	g_free (data);
+
+	return object;
+}
+
+/* Returns the @column_values with the compressed objects decompressed, the returned
+   array and the decompressed objects are added into the @inout_decompressed, which
+   is created when needed. */
+static const gchar **
+e_cache_decompress_column_values (ECache *cache,
+				  gint ncols,
+				  const gchar **column_names,
+				  const gchar **column_values,
+				  GPtrArray **inout_decompressed)
+{
+	const gchar **values = column_values;
+	gint ii;
+
+	for (ii = 0; ii < ncols; ii++) {
+		gchar *object;
+
+		if (!e_cache_object_is_compressed (column_values[ii]) ||
+		    !column_names[ii] ||
+		    g_ascii_strcasecmp (column_names[ii], E_CACHE_COLUMN_OBJECT) != 0)
+			continue;
+
+		if (values == column_values) {
+			values = g_new (const gchar *, ncols + 1);
+			memcpy (values, column_values, sizeof (const gchar *) * ncols);
+			values[ncols] = NULL;
+
+			if (!*inout_decompressed)
+				*inout_decompressed = g_ptr_array_new_with_free_func (g_free);
+
+			g_ptr_array_add (*inout_decompressed, values);
+		}
+
+		object = e_cache_decompress_object_internal (cache, column_values[ii]);
+		if (!object) {
+			g_warning ("%s: Failed to decompress an object in '%s'", G_STRFUNC, cache->priv->filename);
+			object = g_strdup ("");
+		}
+
+		g_ptr_array_add (*inout_decompressed, object);
+		values[ii] = object;
+	}
+
+	return values;
+}
+
+/* Implementation of E_CACHE_FUNC_OBJECT */
+static void
+e_cache_object_func (sqlite3_context *context,
+		     gint argc,
+		     sqlite3_value **argv)
+{
+	ECache *cache = sqlite3_user_data (context);
+	const gchar *stored_object;
+	gchar *object;
+
+	stored_object = (const gchar *) sqlite3_value_text (argv[0]);
+
+	if (!e_cache_object_is_compressed (stored_object)) {
+		sqlite3_result_value (context, argv[0]);
+		return;
+	}
+
+	object = e_cache_decompress_object_internal (cache, stored_object);
+
+	if (object)
+		sqlite3_result_text (context, object, -1, g_free);
+	else
+		sqlite3_result_null (context);
+}
+
+static gint
+e_cache_init_sqlite_functions (ECache *cache,
+			       sqlite3 *db)
+{
+	return sqlite3_create_function (
+		db,
+		E_CACHE_FUNC_OBJECT,
+		1,
+		SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+		cache,
+		e_cache_object_func,
+		NULL, NULL);
+}
+
 static gint
 e_cache_sqlite_exec_cb (gpointer user_data,
 			gint ncols,
@@ -505,43 +852,64 @@ e_cache_sqlite_exec_cb (gpointer user_data,
 			gchar **column_names)
 {
 	struct CacheSQLiteExecData *cse = user_data;
+	GPtrArray *decompressed = NULL;
+	const gchar **values;
+	gboolean success;
 
 	g_return_val_if_fail (cse != NULL, SQLITE_MISUSE);
 	g_return_val_if_fail (cse->callback != NULL, SQLITE_MISUSE);
 
-	if (!cse->callback (cse->cache, ncols, (const gchar **) column_names, (const gchar **) column_values, cse->user_data))
+	values = e_cache_decompress_column_values (cse->cache, ncols, (const gchar **) column_names, (const gchar **) column_values, &decompressed);
+
+	success = cse->callback (cse->cache, ncols, (const gchar **) column_names, values, cse->user_data);
+
+	if (decompressed)
+		g_ptr_array_unref (decompressed);
+
+	if (!success)
 		return SQLITE_ABORT;
 
 	return SQLITE_OK;
 }
 
-static gboolean
-e_cache_sqlite_exec_internal (ECache *cache,
-			      const gchar *stmt,
-			      ECacheSelectFunc callback,
-			      gpointer user_data,
-			      GCancellable *cancellable,
-			      GError **error)
+static void
+e_cache_set_sqlite_error (ECache *cache,
+			  gint ret,
+			  const gchar *errmsg,
+			  const gchar *stmt,
+			  GError **error)
+{
+	if (ret == SQLITE_CONSTRAINT) {
+		g_set_error_literal (error, E_CACHE_ERROR, E_CACHE_ERROR_CONSTRAINT, errmsg);
+	} else if (ret == SQLITE_ABORT || ret == SQLITE_INTERRUPT) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED, "Operation cancelled: %s", errmsg);
+	} else if (ret == SQLITE_CORRUPT && cache->priv->filename && *cache->priv->filename) {
+		g_set_error (error, E_CACHE_ERROR, E_CACHE_ERROR_CORRUPT,
+			"%s (%s)", errmsg, cache->priv->filename);
+	} else {
+		gchar *valid_utf8 = e_util_utf8_make_valid (stmt);
+		g_set_error (error, E_CACHE_ERROR, E_CACHE_ERROR_ENGINE,
+			"SQLite error code '%d': %s (statement:%s)", ret, errmsg, valid_utf8 ? valid_utf8 : stmt);
+		g_free (valid_utf8);
+	}
+}
+
+static gint
+e_cache_sqlite_exec_db (ECache *cache,
+			sqlite3 *db,
+			const gchar *stmt,
+			ECacheSelectFunc callback,
+			gpointer user_data,
+			gchar **out_errmsg)
 {
 	struct CacheSQLiteExecData cse;
-	GCancellable *previous_cancellable;
-	gchar *errmsg = NULL;
 	gint ret = -1, retries = 0;
 
-	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
-	g_return_val_if_fail (stmt != NULL, FALSE);
-
-	g_rec_mutex_lock (&cache->priv->lock);
-
-	previous_cancellable = cache->priv->cancellable;
-	if (cancellable)
-		cache->priv->cancellable = cancellable;
-
 	cse.cache = cache;
 	cse.callback = callback;
 	cse.user_data = user_data;
 
-	ret = sqlite3_exec (cache->priv->db, stmt, callback ? e_cache_sqlite_exec_cb : NULL, &cse, &errmsg);
+	ret = sqlite3_exec (db, stmt, callback ? e_cache_sqlite_exec_cb : NULL, &cse, out_errmsg);
 
 	while (ret == SQLITE_BUSY || ret == SQLITE_LOCKED || ret == -1) {
 		/* try for ~15 seconds, then give up */
@@ -549,31 +917,96 @@ e_cache_sqlite_exec_internal (ECache *cache,
 			break;
 		retries++;
 
-		g_clear_pointer (&errmsg, sqlite3_free);
+		g_clear_pointer (out_errmsg, sqlite3_free);
 		g_thread_yield ();
 		g_usleep (100 * 1000); /* Sleep for 100 ms */
 
-		ret = sqlite3_exec (cache->priv->db, stmt, callback ? e_cache_sqlite_exec_cb : NULL, &cse, &errmsg);
+		ret = sqlite3_exec (db, stmt, callback ? e_cache_sqlite_exec_cb : NULL, &cse, out_errmsg);
 	}
 
-	cache->priv->cancellable = previous_cancellable;
+	return ret;
+}
 
-	g_rec_mutex_unlock (&cache->priv->lock);
+/* Returns an unused read-only connection, which can run the @stmt,
+   or %NULL, when the main connection should be used. */
+static ECacheReader *
+e_cache_take_reader (ECache *cache,
+		     const gchar *stmt)
+{
+	ECacheReader *reader;
+
+	/* The thread in a transaction should see its own changes */
+	if (g_atomic_pointer_get (&cache->priv->transaction_thread) == (gpointer) g_thread_self ())
+		return NULL;
+
+	while (g_ascii_isspace (*stmt))
+		stmt++;
+
+	if (g_ascii_strncasecmp (stmt, "SELECT", 6) != 0)
+		return NULL;
+
+	g_mutex_lock (&cache->priv->readers_lock);
+	/* Do not wait for a reader when all are used, it could deadlock
+	   with a nested select run from the row callback */
+	reader = g_queue_pop_head (&cache->priv->unused_readers);
+	g_mutex_unlock (&cache->priv->readers_lock);
+
+	return reader;
+}
+
+static void
+e_cache_return_reader (ECache *cache,
+		       ECacheReader *reader)
+{
+	g_mutex_lock (&cache->priv->readers_lock);
+	g_queue_push_head (&cache->priv->unused_readers, reader);
+	g_mutex_unlock (&cache->priv->readers_lock);
+}
+
+static gboolean
+e_cache_sqlite_exec_internal (ECache *cache,
+			      const gchar *stmt,
+			      ECacheSelectFunc callback,
+			      gpointer user_data,
+			      GCancellable *cancellable,
+			      GError **error)
+{
+	ECacheReader *reader = NULL;
+	gchar *errmsg = NULL;
+	gint ret;
+
+	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
+	g_return_val_if_fail (stmt != NULL, FALSE);
+
+	if (callback)
+		reader = e_cache_take_reader (cache, stmt);
+
+	if (reader) {
+		reader->cancellable = cancellable;
+
+		ret = e_cache_sqlite_exec_db (cache, reader->db, stmt, callback, user_data, &errmsg);
+
+		reader->cancellable = NULL;
+
+		e_cache_return_reader (cache, reader);
+	} else {
+		GCancellable *previous_cancellable;
+
+		g_rec_mutex_lock (&cache->priv->lock);
+
+		previous_cancellable = cache->priv->cancellable;
+		if (cancellable)
+			cache->priv->cancellable = cancellable;
+
+		ret = e_cache_sqlite_exec_db (cache, cache->priv->db, stmt, callback, user_data, &errmsg);
+
+		cache->priv->cancellable = previous_cancellable;
+
+		g_rec_mutex_unlock (&cache->priv->lock);
+	}
 
 	if (ret != SQLITE_OK) {
-		if (ret == SQLITE_CONSTRAINT) {
-			g_set_error_literal (error, E_CACHE_ERROR, E_CACHE_ERROR_CONSTRAINT, errmsg);
-		} else if (ret == SQLITE_ABORT || ret == SQLITE_INTERRUPT) {
-			g_set_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED, "Operation cancelled: %s", errmsg);
-		} else if (ret == SQLITE_CORRUPT && cache->priv->filename && *cache->priv->filename) {
-			g_set_error (error, E_CACHE_ERROR, E_CACHE_ERROR_CORRUPT,
-				"%s (%s)", errmsg, cache->priv->filename);
-		} else {
-			gchar *valid_utf8 = e_util_utf8_make_valid (stmt);
-			g_set_error (error, E_CACHE_ERROR, E_CACHE_ERROR_ENGINE,
-				"SQLite error code '%d': %s (statement:%s)", ret, errmsg, valid_utf8 ? valid_utf8 : stmt);
-			g_free (valid_utf8);
-		}
+		e_cache_set_sqlite_error (cache, ret, errmsg, stmt, error);
 		sqlite3_free (errmsg);
 
 		return FALSE;
@@ -612,47 +1045,392 @@ e_cache_sqlite_exec_printf (ECache *cache,
 	return success;
 }
 
-static gboolean
-e_cache_read_key_value (ECache *cache,
-			gint ncols,
-			const gchar **column_names,
-			const gchar **column_values,
-			gpointer user_data)
+static void
+e_cache_stmt_free (gpointer ptr)
 {
-	gchar **pvalue = user_data;
+	ECacheStmt *stmt = ptr;
 
-	g_return_val_if_fail (ncols == 1, FALSE);
-	g_return_val_if_fail (column_names != NULL, FALSE);
-	g_return_val_if_fail (column_values != NULL, FALSE);
-	g_return_val_if_fail (pvalue != NULL, FALSE);
+	if (stmt) {
+		sqlite3_finalize (stmt->stmt);
+		g_free (stmt->sql);
+		g_slice_free (ECacheStmt, stmt);
+	}
+}
 
-	if (!*pvalue)
-		*pvalue = g_strdup (column_values[0]);
+/* Finalizes the least recently used statements, which are not in use,
+   when there are too many of them. Expects the cache->priv->lock held. */
+static void
+e_cache_stmt_evict_locked (ECache *cache)
+{
+	GList *link, *prev;
 
-	return TRUE;
+	for (link = cache->priv->prepared_stmts_lru.tail;
+	     link && g_hash_table_size (cache->priv->prepared_stmts) >= E_CACHE_MAX_PREPARED_STMTS;
+	     link = prev) {
+		ECacheStmt *stmt = link->data;
+
+		prev = link->prev;
+
+		if (stmt->in_use)
+			continue;
+
+		g_queue_delete_link (&cache->priv->prepared_stmts_lru, link);
+		g_hash_table_remove (cache->priv->prepared_stmts, stmt->sql);
+	}
 }
 
-static gchar *
-e_cache_build_user_key (const gchar *key)
+/* Finalizes all the statements, regardless whether they are in use.
+   Expects the cache->priv->lock held. */
+static void
+e_cache_stmt_clear_locked (ECache *cache)
 {
-	return g_strconcat ("user::", key, NULL);
+	g_queue_clear (&cache->priv->prepared_stmts_lru);
+
+	if (cache->priv->prepared_stmts)
+		g_hash_table_remove_all (cache->priv->prepared_stmts);
 }
 
-static gboolean
-e_cache_set_key_internal (ECache *cache,
-			  gboolean is_user_key,
-			  const gchar *key,
-			  const gchar *value,
-			  GError **error)
+/**
+ * e_cache_stmt_prepare:
+ * @cache: an #ECache
+ * @sql: an SQLite statement, with parameters
+ * @error: return location for a #GError, or %NULL
+ *
+ * Returns a prepared statement for the @sql. The statements are cached by
+ * the @cache, thus the @sql is compiled only for the first time and the next
+ * calls only reset the previously prepared statement. The parameters of
+ * the statement (like "?" or "?NNN") can be set with e_cache_stmt_bind_text()
+ * and the other bind functions, then the statement can be executed with
+ * e_cache_stmt_exec() or e_cache_stmt_select().
+ *
+ * The statement is shared, thus the caller should hold the @cache locked
+ * with e_cache_lock() from the preparation until the execution. When there
+ * are too many statements cached, the least recently used are finalized,
+ * but never those which had been prepared and not executed yet, thus
+ * the returned statement stays valid until it's executed.
+ *
+ * Returns: (transfer none) (nullable): a prepared statement for the @sql,
+ *    or %NULL on error
+ *
+ * Since: 3.62
+ **/
+ECacheStmt *
+e_cache_stmt_prepare (ECache *cache,
+		      const gchar *sql,
+		      GError **error)
 {
-	gchar *tmp = NULL;
-	const gchar *usekey;
-	gboolean success;
+	ECacheStmt *stmt;
 
-	if (is_user_key) {
-		tmp = e_cache_build_user_key (key);
-		usekey = tmp;
-	} else {
+	g_return_val_if_fail (E_IS_CACHE (cache), NULL);
+	g_return_val_if_fail (sql != NULL, NULL);
+
+	g_rec_mutex_lock (&cache->priv->lock);
+
+	stmt = g_hash_table_lookup (cache->priv->prepared_stmts, sql);
+	if (stmt) {
+		sqlite3_reset (stmt->stmt);
+		sqlite3_clear_bindings (stmt->stmt);
+
+		g_queue_unlink (&cache->priv->prepared_stmts_lru, stmt->lru_link);
+		g_queue_push_head_link (&cache->priv->prepared_stmts_lru, stmt->lru_link);
+	} else {
+		sqlite3_stmt *sqlite_stmt = NULL;
+		gint ret;
+
+		ret = sqlite3_prepare_v2 (cache->priv->db, sql, -1, &sqlite_stmt, NULL);
+		if (ret != SQLITE_OK || !sqlite_stmt) {
+			e_cache_set_sqlite_error (cache, ret != SQLITE_OK ? ret : SQLITE_MISUSE,
+				sqlite3_errmsg (cache->priv->db), sql, error);
+			sqlite3_finalize (sqlite_stmt);
+			g_rec_mutex_unlock (&cache->priv->lock);
+
+			return NULL;
+		}
+
+		e_cache_stmt_evict_locked (cache);
+
+		stmt = g_slice_new0 (ECacheStmt);
+		stmt->stmt = sqlite_stmt;
+		stmt->sql = g_strdup (sql);
+
+		g_queue_push_head (&cache->priv->prepared_stmts_lru, stmt);
+		stmt->lru_link = cache->priv->prepared_stmts_lru.head;
+
+		g_hash_table_insert (cache->priv->prepared_stmts, stmt->sql, stmt);
+	}
+
+	stmt->in_use++;
+
+	g_rec_mutex_unlock (&cache->priv->lock);
+
+	return stmt;
+}
+
+/**
+ * e_cache_stmt_bind_text:
+ * @stmt: an #ECacheStmt
+ * @index: a 1-based index of the parameter to set
+ * @value: (nullable): a value to set, or %NULL to set SQL NULL
+ *
+ * Sets the text parameter of the @stmt. The @value is not copied,
+ * it should be valid until the @stmt is executed.
+ *
+ * Since: 3.62
+ **/
+void
+e_cache_stmt_bind_text (ECacheStmt *stmt,
+			gint index,
+			const gchar *value)
+{
+	g_return_if_fail (stmt != NULL);
+
+	if (value)
+		sqlite3_bind_text (stmt->stmt, index, value, -1, SQLITE_STATIC);
+	else
+		sqlite3_bind_null (stmt->stmt, index);
+}
+
+/**
+ * e_cache_stmt_bind_int:
+ * @stmt: an #ECacheStmt
+ * @index: a 1-based index of the parameter to set
+ * @value: a value to set
+ *
+ * Sets the integer parameter of the @stmt.
+ *
+ * Since: 3.62
+ **/
+void
+e_cache_stmt_bind_int (ECacheStmt *stmt,
+		       gint index,
+		       gint value)
+{
+	g_return_if_fail (stmt != NULL);
+
+	sqlite3_bind_int (stmt->stmt, index, value);
+}
+
+/**
+ * e_cache_stmt_bind_int64:
+ * @stmt: an #ECacheStmt
+ * @index: a 1-based index of the parameter to set
+ * @value: a value to set
+ *
+ * Sets the 64-bit integer parameter of the @stmt.
+ *
+ * Since: 3.62
+ **/
+void
+e_cache_stmt_bind_int64 (ECacheStmt *stmt,
+			 gint index,
+			 gint64 value)
+{
+	g_return_if_fail (stmt != NULL);
+
+	sqlite3_bind_int64 (stmt->stmt, index, value);
+}
+
+/**
+ * e_cache_stmt_bind_null:
+ * @stmt: an #ECacheStmt
+ * @index: a 1-based index of the parameter to set
+ *
+ * Sets the parameter of the @stmt to SQL NULL.
+ *
+ * Since: 3.62
+ **/
+void
+e_cache_stmt_bind_null (ECacheStmt *stmt,
+			gint index)
+{
+	g_return_if_fail (stmt != NULL);
+
+	sqlite3_bind_null (stmt->stmt, index);
+}
+
+static gboolean
+e_cache_stmt_run (ECache *cache,
+		  ECacheStmt *stmt,
+		  ECacheSelectFunc callback,
+		  gpointer user_data,
+		  GCancellable *cancellable,
+		  GError **error)
+{
+	GCancellable *previous_cancellable;
+	const gchar **column_names = NULL, **column_values = NULL;
+	gint ret, ncols = 0, retries = 0;
+
+	g_rec_mutex_lock (&cache->priv->lock);
+
+	previous_cancellable = cache->priv->cancellable;
+	if (cancellable)
+		cache->priv->cancellable = cancellable;
+
+	if (callback) {
+		ncols = sqlite3_column_count (stmt->stmt);
+		column_names = g_newa (const gchar *, ncols + 1);
+		column_values = g_newa (const gchar *, ncols + 1);
+	}
+
+	for (;;) {
+		GPtrArray *decompressed = NULL;
+		const gchar **values;
+		gboolean keep_going;
+		gint ii;
+
+		ret = sqlite3_step (stmt->stmt);
+
+		if (ret == SQLITE_BUSY || ret == SQLITE_LOCKED) {
+			/* try for ~15 seconds, then give up */
+			if (retries > 150)
+				break;
+			retries++;
+
+			sqlite3_reset (stmt->stmt);
+			g_thread_yield ();
+			g_usleep (100 * 1000); /* Sleep for 100 ms */
+			continue;
+		}
+
+		if (ret != SQLITE_ROW)
+			break;
+
+		if (!callback)
+			continue;
+
+		for (ii = 0; ii < ncols; ii++) {
+			column_names[ii] = sqlite3_column_name (stmt->stmt, ii);
+			column_values[ii] = (const gchar *) sqlite3_column_text (stmt->stmt, ii);
+		}
+
+		column_names[ncols] = NULL;
+		column_values[ncols] = NULL;
+
+		values = e_cache_decompress_column_values (cache, ncols, column_names, column_values, &decompressed);
+		keep_going = callback (cache, ncols, column_names, values, user_data);
+
+		g_clear_pointer (&decompressed, g_ptr_array_unref);
+
+		if (!keep_going) {
+			ret = SQLITE_DONE;
+			break;
+		}
+	}
+
+	if (ret != SQLITE_DONE)
+		e_cache_set_sqlite_error (cache, ret, sqlite3_errmsg (cache->priv->db), stmt->sql, error);
+
+	/* release any locks held by the statement */
+	sqlite3_reset (stmt->stmt);
+
+	if (stmt->in_use)
+		stmt->in_use--;
+
+	cache->priv->cancellable = previous_cancellable;
+
+	g_rec_mutex_unlock (&cache->priv->lock);
+
+	return ret == SQLITE_DONE;
+}
+
+/**
+ * e_cache_stmt_exec:
+ * @cache: an #ECache
+ * @stmt: an #ECacheStmt, as returned by e_cache_stmt_prepare()
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Executes the prepared statement @stmt, with the parameters set
+ * by the bind functions. Use e_cache_stmt_select() for SELECT statements.
+ *
+ * Returns: Whether succeeded.
+ *
+ * Since: 3.62
+ **/
+gboolean
+e_cache_stmt_exec (ECache *cache,
+		   ECacheStmt *stmt,
+		   GCancellable *cancellable,
+		   GError **error)
+{
+	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
+	g_return_val_if_fail (stmt != NULL, FALSE);
+
+	return e_cache_stmt_run (cache, stmt, NULL, NULL, cancellable, error);
+}
+
+/**
+ * e_cache_stmt_select:
+ * @cache: an #ECache
+ * @stmt: an #ECacheStmt, as returned by e_cache_stmt_prepare()
+ * @func: (scope call): an #ECacheSelectFunc function to call for each row
+ * @user_data: user data for @func
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Executes the prepared SELECT statement @stmt, with the parameters set
+ * by the bind functions, and calls @func for each row of the result.
+ *
+ * Returns: Whether succeeded.
+ *
+ * Since: 3.62
+ **/
+gboolean
+e_cache_stmt_select (ECache *cache,
+		     ECacheStmt *stmt,
+		     ECacheSelectFunc func,
+		     gpointer user_data,
+		     GCancellable *cancellable,
+		     GError **error)
+{
+	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
+	g_return_val_if_fail (stmt != NULL, FALSE);
+	g_return_val_if_fail (func != NULL, FALSE);
+
+	return e_cache_stmt_run (cache, stmt, func, user_data, cancellable, error);
+}
+
+static gboolean
+e_cache_read_key_value (ECache *cache,
+			gint ncols,
+			const gchar **column_names,
+			const gchar **column_values,
+			gpointer user_data)
+{
+	gchar **pvalue = user_data;
+
+	g_return_val_if_fail (ncols == 1, FALSE);
+	g_return_val_if_fail (column_names != NULL, FALSE);
+	g_return_val_if_fail (column_values != NULL, FALSE);
+	g_return_val_if_fail (pvalue != NULL, FALSE);
+
+	if (!*pvalue)
+		*pvalue = g_strdup (column_values[0]);
+
+	return TRUE;
+}
+
+static gchar *
+e_cache_build_user_key (const gchar *key)
+{
+	return g_strconcat ("user::", key, NULL);
+}
+
+static gboolean
+e_cache_set_key_internal (ECache *cache,
+			  gboolean is_user_key,
+			  const gchar *key,
+			  const gchar *value,
+			  GError **error)
+{
+	gchar *tmp = NULL;
+	const gchar *usekey;
+	gboolean success;
+
+	if (is_user_key) {
+		tmp = e_cache_build_user_key (key);
+		usekey = tmp;
+	} else {
 		usekey = key;
 	}
 
@@ -718,6 +1496,110 @@ e_cache_check_cancelled_cb (gpointer user_data)
 	return SQLITE_OK;
 }
 
+static gint
+e_cache_reader_check_cancelled_cb (gpointer user_data)
+{
+	ECacheReader *reader = user_data;
+
+	g_return_val_if_fail (reader != NULL, SQLITE_ABORT);
+
+	if (reader->cancellable &&
+	    g_cancellable_is_cancelled (reader->cancellable)) {
+		return SQLITE_ABORT;
+	}
+
+	return SQLITE_OK;
+}
+
+static void
+e_cache_reader_free (gpointer ptr)
+{
+	ECacheReader *reader = ptr;
+
+	if (reader) {
+		g_warn_if_fail (reader->cancellable == NULL);
+		sqlite3_close (reader->db);
+		g_free (reader);
+	}
+}
+
+static void
+e_cache_close_readers (ECache *cache)
+{
+	g_mutex_lock (&cache->priv->readers_lock);
+
+	if (cache->priv->readers) {
+		g_warn_if_fail (g_queue_get_length (&cache->priv->unused_readers) == cache->priv->readers->len);
+
+		g_queue_clear (&cache->priv->unused_readers);
+		g_clear_pointer (&cache->priv->readers, g_ptr_array_unref);
+	}
+
+	g_mutex_unlock (&cache->priv->readers_lock);
+}
+
+static ECacheReader *
+e_cache_open_reader (ECache *cache,
+		     GError **error)
+{
+	ECacheClass *klass;
+	ECacheReader *reader;
+	gchar *errmsg = NULL;
+	gint ret;
+
+	reader = g_new0 (ECacheReader, 1);
+
+	ret = sqlite3_open_v2 (cache->priv->filename, &reader->db, SQLITE_OPEN_READONLY, NULL);
+	if (ret != SQLITE_OK) {
+		if (!reader->db) {
+			g_set_error_literal (error, E_CACHE_ERROR, E_CACHE_ERROR_LOAD, _("Out of memory"));
+		} else {
+			g_set_error (error, E_CACHE_ERROR, E_CACHE_ERROR_ENGINE,
+				_("Can’t open database %s: %s"), cache->priv->filename, sqlite3_errmsg (reader->db));
+		}
+
+		e_cache_reader_free (reader);
+
+		return NULL;
+	}
+
+	/* Handle GCancellable */
+	sqlite3_progress_handler (
+		reader->db,
+		E_CACHE_CANCEL_BATCH_SIZE,
+		e_cache_reader_check_cancelled_cb,
+		reader);
+
+	/* The same as for the main connection, for consistent LIKE results */
+	ret = sqlite3_exec (reader->db, "PRAGMA case_sensitive_like = ON", NULL, NULL, &errmsg);
+	if (ret != SQLITE_OK) {
+		e_cache_set_sqlite_error (cache, ret, errmsg, "PRAGMA case_sensitive_like = ON", error);
+		sqlite3_free (errmsg);
+		e_cache_reader_free (reader);
+
+		return NULL;
+	}
+
+	ret = e_cache_init_sqlite_functions (cache, reader->db);
+	if (ret != SQLITE_OK) {
+		g_set_error (error, E_CACHE_ERROR, E_CACHE_ERROR_ENGINE,
+			_("Can’t open database %s: %s"), cache->priv->filename, sqlite3_errmsg (reader->db));
+		e_cache_reader_free (reader);
+
+		return NULL;
+	}
+
+	klass = E_CACHE_GET_CLASS (cache);
+
+	if (klass->init_connection && !klass->init_connection (cache, reader->db, error)) {
+		e_cache_reader_free (reader);
+
+		return NULL;
+	}
+
+	return reader;
+}
+
 static gboolean
 e_cache_init_sqlite (ECache *cache,
 		     const gchar *filename,
@@ -756,6 +1638,14 @@ e_cache_init_sqlite (ECache *cache,
 		e_cache_check_cancelled_cb,
 		cache);
 
+	ret = e_cache_init_sqlite_functions (cache, cache->priv->db);
+	if (ret != SQLITE_OK) {
+		g_set_error (error, E_CACHE_ERROR, E_CACHE_ERROR_ENGINE,
+			_("Can’t open database %s: %s"), filename, sqlite3_errmsg (cache->priv->db));
+
+		return FALSE;
+	}
+
 	return e_cache_sqlite_exec_internal (cache, "ATTACH DATABASE ':memory:' AS mem", NULL, NULL, cancellable, error) &&
 		e_cache_sqlite_exec_internal (cache, "PRAGMA foreign_keys = ON",          NULL, NULL, cancellable, error) &&
 		e_cache_sqlite_exec_internal (cache, "PRAGMA case_sensitive_like = ON",   NULL, NULL, cancellable, error);
@@ -890,9 +1780,62 @@ e_cache_init_tables (ECache *cache,
 	return TRUE;
 }
 
-/**
- * e_cache_initialize_sync:
- * @cache: an #ECache
+static gboolean
+e_cache_load_dictionaries_cb (ECache *cache,
+			      gint ncols,
+			      const gchar **column_names,
+			      const gchar **column_values,
+			      gpointer user_data)
+{
+	guint64 dictionary_id;
+
+	g_return_val_if_fail (ncols == 2, FALSE);
+
+	if (!column_values[0] || !column_values[1] ||
+	    !g_str_has_prefix (column_values[0], E_CACHE_KEY_DICTIONARY ":"))
+		return TRUE;
+
+	dictionary_id = g_ascii_strtoull (column_values[0] + strlen (E_CACHE_KEY_DICTIONARY ":"), NULL, 10);
+
+	if (dictionary_id > 0 && dictionary_id <= G_MAXUINT) {
+		g_hash_table_insert (cache->priv->dictionaries, GUINT_TO_POINTER ((guint) dictionary_id),
+			g_bytes_new (column_values[1], strlen (column_values[1])));
+	}
+
+	return TRUE;
+}
+
+static gboolean
+e_cache_load_compression (ECache *cache,
+			  GCancellable *cancellable,
+			  GError **error)
+{
+	gchar *value;
+	gboolean success;
+
+	g_mutex_lock (&cache->priv->compression_lock);
+
+	value = e_cache_dup_key_internal (cache, FALSE, E_CACHE_KEY_COMPRESS_OBJECTS, NULL);
+	cache->priv->compress_objects = g_strcmp0 (value, "1") == 0;
+	g_free (value);
+
+	value = e_cache_dup_key_internal (cache, FALSE, E_CACHE_KEY_DICTIONARY, NULL);
+	cache->priv->dictionary_id = value ? (guint) g_ascii_strtoull (value, NULL, 10) : 0;
+	g_free (value);
+
+	/* All of them, the objects can be compressed with any older dictionary */
+	success = e_cache_sqlite_exec_internal (cache,
+		"SELECT key, value FROM " E_CACHE_TABLE_KEYS " WHERE key LIKE '" E_CACHE_KEY_DICTIONARY ":%'",
+		e_cache_load_dictionaries_cb, NULL, cancellable, error);
+
+	g_mutex_unlock (&cache->priv->compression_lock);
+
+	return success;
+}
+
+/**
+ * e_cache_initialize_sync:
+ * @cache: an #ECache
  * @filename: a filename of an SQLite database to use
  * @other_columns: (element-type ECacheColumnInfo) (nullable): an optional
  *    #GSList with additional columns to add to the objects table
@@ -939,7 +1882,8 @@ e_cache_initialize_sync (ECache *cache,
 	g_rec_mutex_lock (&cache->priv->lock);
 
 	success = e_cache_init_sqlite (cache, filename, cancellable, error) &&
-		e_cache_init_tables (cache, other_columns, cancellable, error);
+		e_cache_init_tables (cache, other_columns, cancellable, error) &&
+		e_cache_load_compression (cache, cancellable, error);
 
 	g_rec_mutex_unlock (&cache->priv->lock);
 
@@ -1190,6 +2134,7 @@ void
 e_cache_erase (ECache *cache)
 {
 	ECacheClass *klass;
+	gchar *tmp_filename;
 
 	g_return_if_fail (E_IS_CACHE (cache));
 
@@ -1202,11 +2147,26 @@ e_cache_erase (ECache *cache)
 	if (klass->erase)
 		klass->erase (cache);
 
+	e_cache_close_readers (cache);
+
+	g_rec_mutex_lock (&cache->priv->lock);
+	e_cache_stmt_clear_locked (cache);
+	g_rec_mutex_unlock (&cache->priv->lock);
+
 	sqlite3_close (cache->priv->db);
 	cache->priv->db = NULL;
 
 	g_unlink (cache->priv->filename);
 
+	/* Left behind when the cache used WAL journal */
+	tmp_filename = g_strconcat (cache->priv->filename, "-wal", NULL);
+	g_unlink (tmp_filename);
+	g_free (tmp_filename);
+
+	tmp_filename = g_strconcat (cache->priv->filename, "-shm", NULL);
+	g_unlink (tmp_filename);
+	g_free (tmp_filename);
+
 	g_free (cache->priv->filename);
 	cache->priv->filename = NULL;
 }
@@ -1245,27 +2205,37 @@ e_cache_contains (ECache *cache,
 		  const gchar *uid,
 		  ECacheDeletedFlag deleted_flag)
 {
+	ECacheStmt *stmt;
 	guint nrows = 0;
 
 	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
 	g_return_val_if_fail (uid != NULL, FALSE);
 
+	g_rec_mutex_lock (&cache->priv->lock);
+
 	if (deleted_flag == E_CACHE_INCLUDE_DELETED) {
-		e_cache_sqlite_exec_printf (cache,
+		stmt = e_cache_stmt_prepare (cache,
 			"SELECT " E_CACHE_COLUMN_UID " FROM " E_CACHE_TABLE_OBJECTS
-			" WHERE " E_CACHE_COLUMN_UID " = %Q"
+			" WHERE " E_CACHE_COLUMN_UID " = ?"
 			" LIMIT 2",
-			e_cache_count_rows_cb, &nrows, NULL, NULL,
-			uid);
+			NULL);
 	} else {
-		e_cache_sqlite_exec_printf (cache,
+		stmt = e_cache_stmt_prepare (cache,
 			"SELECT " E_CACHE_COLUMN_UID " FROM " E_CACHE_TABLE_OBJECTS
-			" WHERE " E_CACHE_COLUMN_UID " = %Q AND " E_CACHE_COLUMN_STATE " != %d"
+			" WHERE " E_CACHE_COLUMN_UID " = ? AND " E_CACHE_COLUMN_STATE " != ?"
 			" LIMIT 2",
-			e_cache_count_rows_cb, &nrows, NULL, NULL,
-			uid, E_OFFLINE_STATE_LOCALLY_DELETED);
+			NULL);
+		if (stmt)
+			e_cache_stmt_bind_int (stmt, 2, E_OFFLINE_STATE_LOCALLY_DELETED);
 	}
 
+	if (stmt) {
+		e_cache_stmt_bind_text (stmt, 1, uid);
+		e_cache_stmt_select (cache, stmt, e_cache_count_rows_cb, &nrows, NULL, NULL);
+	}
+
+	g_rec_mutex_unlock (&cache->priv->lock);
+
 	g_warn_if_fail (nrows <= 1);
 
 	return nrows > 0;
@@ -1480,6 +2450,45 @@ e_cache_put_locked (ECache *cache,
 	return success;
 }
 
+/* Expects the @cache being locked for write */
+static gboolean
+e_cache_put_one_locked (ECache *cache,
+			const gchar *uid,
+			const gchar *revision,
+			const gchar *object,
+			ECacheColumnValues *other_columns,
+			ECacheOfflineFlag offline_flag,
+			GCancellable *cancellable,
+			GError **error)
+{
+	EOfflineState offline_state;
+	gboolean is_replace;
+
+	if (offline_flag == E_CACHE_IS_ONLINE) {
+		is_replace = e_cache_contains (cache, uid, E_CACHE_EXCLUDE_DELETED);
+		offline_state = E_OFFLINE_STATE_SYNCED;
+	} else {
+		is_replace = e_cache_contains (cache, uid, E_CACHE_INCLUDE_DELETED);
+		if (is_replace) {
+			GError *local_error = NULL;
+
+			offline_state = e_cache_get_offline_state (cache, uid, cancellable, &local_error);
+
+			if (local_error) {
+				g_propagate_error (error, local_error);
+				return FALSE;
+			} else if (offline_state != E_OFFLINE_STATE_LOCALLY_CREATED) {
+				offline_state = E_OFFLINE_STATE_LOCALLY_MODIFIED;
+			}
+		} else {
+			offline_state = E_OFFLINE_STATE_LOCALLY_CREATED;
+		}
+	}
+
+	return e_cache_put_locked (cache, uid, revision, object, other_columns,
+		offline_state, is_replace, cancellable, error);
+}
+
 /**
  * e_cache_put:
  * @cache: an #ECache
@@ -1512,8 +2521,7 @@ e_cache_put (ECache *cache,
 	     GCancellable *cancellable,
 	     GError **error)
 {
-	EOfflineState offline_state;
-	gboolean success = TRUE, is_replace;
+	gboolean success;
 
 	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
 	g_return_val_if_fail (uid != NULL, FALSE);
@@ -1521,30 +2529,82 @@ e_cache_put (ECache *cache,
 
 	e_cache_lock (cache, E_CACHE_LOCK_WRITE);
 
-	if (offline_flag == E_CACHE_IS_ONLINE) {
-		is_replace = e_cache_contains (cache, uid, E_CACHE_EXCLUDE_DELETED);
-		offline_state = E_OFFLINE_STATE_SYNCED;
-	} else {
-		is_replace = e_cache_contains (cache, uid, E_CACHE_INCLUDE_DELETED);
-		if (is_replace) {
-			GError *local_error = NULL;
+	success = e_cache_put_one_locked (cache, uid, revision, object, other_columns,
+		offline_flag, cancellable, error);
 
-			offline_state = e_cache_get_offline_state (cache, uid, cancellable, &local_error);
+	e_cache_unlock (cache, success ? E_CACHE_UNLOCK_COMMIT : E_CACHE_UNLOCK_ROLLBACK);
 
-			if (local_error) {
-				success = FALSE;
-				g_propagate_error (error, local_error);
-			} else if (offline_state != E_OFFLINE_STATE_LOCALLY_CREATED) {
-				offline_state = E_OFFLINE_STATE_LOCALLY_MODIFIED;
-			}
-		} else {
-			offline_state = E_OFFLINE_STATE_LOCALLY_CREATED;
+	return success;
+}
+
+/**
+ * e_cache_put_many:
+ * @cache: an #ECache
+ * @uids: (element-type utf8): unique identifiers of the objects
+ * @revisions: (element-type utf8) (nullable): revisions of the objects, or %NULL
+ * @objects: (element-type utf8): the objects themselves
+ * @other_columns: (element-type ECacheColumnValues) (nullable): #ECacheColumnValues
+ *    with other columns to set for each object, or %NULL
+ * @offline_flag: one of #ECacheOfflineFlag, whether putting these objects in offline
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Stores multiple objects into the cache, the same as e_cache_put() does
+ * for one object. All the objects are stored in a single transaction, which
+ * is rolled back when any of them fails, and the revision of the @cache
+ * is changed only once. The statements are prepared only once and reused
+ * for each object.
+ *
+ * The @revisions and @other_columns, when not %NULL, should have the same length
+ * as the @uids and the @objects; their items can be %NULL.
+ *
+ * Returns: Whether succeeded.
+ *
+ * Since: 3.62
+ **/
+gboolean
+e_cache_put_many (ECache *cache,
+		  const GSList *uids,
+		  const GSList *revisions,
+		  const GSList *objects,
+		  const GSList *other_columns,
+		  ECacheOfflineFlag offline_flag,
+		  GCancellable *cancellable,
+		  GError **error)
+{
+	const GSList *ulink, *rlink, *olink, *clink;
+	gboolean success = TRUE;
+
+	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
+	g_return_val_if_fail (g_slist_length ((GSList *) uids) == g_slist_length ((GSList *) objects), FALSE);
+	g_return_val_if_fail (revisions == NULL || g_slist_length ((GSList *) uids) == g_slist_length ((GSList *) revisions), FALSE);
+	g_return_val_if_fail (other_columns == NULL || g_slist_length ((GSList *) uids) == g_slist_length ((GSList *) other_columns), FALSE);
+
+	e_cache_lock (cache, E_CACHE_LOCK_WRITE);
+	e_cache_freeze_revision_change (cache);
+
+	for (ulink = uids, rlink = revisions, olink = objects, clink = other_columns;
+	     ulink && olink && success;
+	     (ulink = g_slist_next (ulink)), (rlink = g_slist_next (rlink)), (olink = g_slist_next (olink)), (clink = g_slist_next (clink))) {
+		const gchar *uid = ulink->data;
+		const gchar *object = olink->data;
+
+		if (!uid || !object) {
+			g_warn_if_reached ();
+			success = FALSE;
+			break;
 		}
-	}
 
-	success = success && e_cache_put_locked (cache, uid, revision, object, other_columns,
-		offline_state, is_replace, cancellable, error);
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			success = FALSE;
+			break;
+		}
+
+		success = e_cache_put_one_locked (cache, uid, rlink ? rlink->data : NULL, object,
+			clink ? clink->data : NULL, offline_flag, cancellable, error);
+	}
 
+	e_cache_thaw_revision_change (cache);
 	e_cache_unlock (cache, success ? E_CACHE_UNLOCK_COMMIT : E_CACHE_UNLOCK_ROLLBACK);
 
 	return success;
@@ -2325,6 +3385,7 @@ e_cache_get_offline_state (ECache *cache,
 			   GError **error)
 {
 	EOfflineState offline_state = E_OFFLINE_STATE_UNKNOWN;
+	ECacheStmt *stmt;
 	gint64 value = offline_state;
 
 	g_return_val_if_fail (E_IS_CACHE (cache), E_OFFLINE_STATE_UNKNOWN);
@@ -2335,14 +3396,22 @@ e_cache_get_offline_state (ECache *cache,
 		return offline_state;
 	}
 
-	if (e_cache_sqlite_exec_printf (cache,
+	g_rec_mutex_lock (&cache->priv->lock);
+
+	stmt = e_cache_stmt_prepare (cache,
 		"SELECT " E_CACHE_COLUMN_STATE " FROM " E_CACHE_TABLE_OBJECTS
-		" WHERE " E_CACHE_COLUMN_UID " = %Q",
-		e_cache_get_int64_cb, &value, cancellable, error,
-		uid)) {
-		offline_state = value;
+		" WHERE " E_CACHE_COLUMN_UID " = ?",
+		error);
+
+	if (stmt) {
+		e_cache_stmt_bind_text (stmt, 1, uid);
+
+		if (e_cache_stmt_select (cache, stmt, e_cache_get_int64_cb, &value, cancellable, error))
+			offline_state = value;
 	}
 
+	g_rec_mutex_unlock (&cache->priv->lock);
+
 	return offline_state;
 }
 
@@ -2615,6 +3684,8 @@ e_cache_lock (ECache *cache,
 	g_return_if_fail (cache->priv->in_transaction > 0);
 
 	if (cache->priv->in_transaction == 1) {
+		g_atomic_pointer_set (&cache->priv->transaction_thread, g_thread_self ());
+
 		/* It's important to make the distinction between a
 		 * transaction which will read or one which will write.
 		 *
@@ -2665,214 +3736,893 @@ e_cache_unlock (ECache *cache,
 	g_return_if_fail (E_IS_CACHE (cache));
 	g_return_if_fail (cache->priv->in_transaction > 0);
 
-	cache->priv->in_transaction--;
+	cache->priv->in_transaction--;
+
+	if (cache->priv->in_transaction == 0) {
+		switch (action) {
+		case E_CACHE_UNLOCK_NONE:
+		case E_CACHE_UNLOCK_COMMIT:
+			e_cache_sqlite_exec_internal (cache, "COMMIT", NULL, NULL, NULL, NULL);
+			break;
+		case E_CACHE_UNLOCK_ROLLBACK:
+			e_cache_sqlite_exec_internal (cache, "ROLLBACK", NULL, NULL, NULL, NULL);
+
+			/* the stored dictionary and the setting are gone, use what's in the file */
+			if (cache->priv->compression_changed)
+				e_cache_load_compression (cache, NULL, NULL);
+			break;
+		}
+
+		cache->priv->compression_changed = FALSE;
+
+		g_atomic_pointer_set (&cache->priv->transaction_thread, NULL);
+	}
+
+	g_rec_mutex_unlock (&cache->priv->lock);
+}
+
+/**
+ * e_cache_get_sqlitedb:
+ * @cache: an #ECache
+ *
+ * Returns: (transfer none): An SQLite3 database pointer. It is owned by the @cache.
+ *
+ * Since: 3.26
+ **/
+gpointer
+e_cache_get_sqlitedb (ECache *cache)
+{
+	g_return_val_if_fail (E_IS_CACHE (cache), NULL);
+
+	return cache->priv->db;
+}
+
+/**
+ * e_cache_sqlite_exec:
+ * @cache: an #ECache
+ * @sql_stmt: an SQLite statement to execute
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Executes an SQLite statement. Use e_cache_sqlite_select() for
+ * SELECT statements.
+ *
+ * Returns: Whether succeeded.
+ *
+ * Since: 3.26
+ **/
+gboolean
+e_cache_sqlite_exec (ECache *cache,
+		     const gchar *sql_stmt,
+		     GCancellable *cancellable,
+		     GError **error)
+{
+	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
+
+	return e_cache_sqlite_exec_internal (cache, sql_stmt, NULL, NULL, cancellable, error);
+}
+
+/**
+ * e_cache_sqlite_select:
+ * @cache: an #ECache
+ * @sql_stmt: an SQLite SELECT statement to execute
+ * @func: (scope call): an #ECacheSelectFunc function to call for each row
+ * @user_data: user data for @func
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Executes a SELECT statement @sql_stmt and calls @func for each row of the result.
+ * Use e_cache_sqlite_exec() for statements which do not return row sets.
+ *
+ * Returns: Whether succeeded.
+ *
+ * Since: 3.26
+ **/
+gboolean
+e_cache_sqlite_select (ECache *cache,
+		       const gchar *sql_stmt,
+		       ECacheSelectFunc func,
+		       gpointer user_data,
+		       GCancellable *cancellable,
+		       GError **error)
+{
+	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
+	g_return_val_if_fail (sql_stmt, FALSE);
+	g_return_val_if_fail (func, FALSE);
+
+	return e_cache_sqlite_exec_internal (cache, sql_stmt, func, user_data, cancellable, error);
+}
+
+/**
+ * e_cache_sqlite_stmt_append_printf:
+ * @stmt: a #GString statement to append to
+ * @format: a printf-like format
+ * @...: arguments for the @format
+ *
+ * Appends an SQLite statement fragment based on the @format and
+ * its arguments to the @stmt.
+ * The @format can contain any values recognized by sqlite3_mprintf().
+ *
+ * Since: 3.26
+ **/
+void
+e_cache_sqlite_stmt_append_printf (GString *stmt,
+				   const gchar *format,
+				   ...)
+{
+	va_list args;
+	gchar *tmp_stmt;
+
+	g_return_if_fail (stmt != NULL);
+	g_return_if_fail (format != NULL);
+
+	va_start (args, format);
+	tmp_stmt = sqlite3_vmprintf (format, args);
+	va_end (args);
+
+	g_string_append (stmt, tmp_stmt);
+
+	sqlite3_free (tmp_stmt);
+}
+
+/**
+ * e_cache_sqlite_stmt_printf:
+ * @format: a printf-like format
+ * @...: arguments for the @format
+ *
+ * Creates an SQLite statement based on the @format and its arguments.
+ * The @format can contain any values recognized by sqlite3_mprintf().
+ *
+ * Returns: (transfer full): A new SQLite statement. Free the returned
+ *    string with e_cache_sqlite_stmt_free() when no longer needed.
+ *
+ * Since: 3.26
+ **/
+gchar *
+e_cache_sqlite_stmt_printf (const gchar *format,
+			    ...)
+{
+	va_list args;
+	gchar *stmt;
+
+	g_return_val_if_fail (format != NULL, NULL);
+
+	va_start (args, format);
+	stmt = sqlite3_vmprintf (format, args);
+	va_end (args);
+
+	return stmt;
+}
+
+/**
+ * e_cache_sqlite_stmt_free:
+ * @stmt: a statement to free
+ *
+ * Frees a statement previously constructed with e_cache_sqlite_stmt_printf().
+ *
+ * Since: 3.26
+ **/
+void
+e_cache_sqlite_stmt_free (gchar *stmt)
+{
+	if (stmt)
+		sqlite3_free (stmt);
+}
+
+/**
+ * e_cache_sqlite_maybe_vacuum:
+ * @cache: an #ECache
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Runs vacuum (compacts the database file), if needed.
+ *
+ * Returns: Whether succeeded. It doesn't mean that the vacuum had been run,
+ *    only that no error happened during the call.
+ *
+ * Since: 3.26
+ **/
+gboolean
+e_cache_sqlite_maybe_vacuum (ECache *cache,
+			     GCancellable *cancellable,
+			     GError **error)
+{
+	guint64 page_count = 0, page_size = 0, freelist_count = 0;
+	gboolean success = FALSE;
+	GError *local_error = NULL;
+
+	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
+
+	g_rec_mutex_lock (&cache->priv->lock);
+
+	if (e_cache_sqlite_exec_internal (cache, "PRAGMA page_count;", e_cache_get_uint64_cb, &page_count, cancellable, &local_error) &&
+	    e_cache_sqlite_exec_internal (cache, "PRAGMA page_size;", e_cache_get_uint64_cb, &page_size, cancellable, &local_error) &&
+	    e_cache_sqlite_exec_internal (cache, "PRAGMA freelist_count;", e_cache_get_uint64_cb, &freelist_count, cancellable, &local_error)) {
+		/* Vacuum, if there's more than 5% of the free pages, or when free pages use more than 10MB */
+		success = !page_count || !freelist_count ||
+			(freelist_count * page_size < 1024 * 1024 * 10 && freelist_count * 1000 / page_count <= 50) ||
+			e_cache_sqlite_exec_internal (cache, "vacuum;", NULL, NULL, cancellable, &local_error);
+	}
+
+	g_rec_mutex_unlock (&cache->priv->lock);
+
+	if (local_error) {
+		g_propagate_error (error, local_error);
+		success = FALSE;
+	}
+
+	return success;
+}
+
+static gboolean
+e_cache_get_journal_mode_cb (ECache *cache,
+			     gint ncols,
+			     const gchar **column_names,
+			     const gchar **column_values,
+			     gpointer user_data)
+{
+	gchar **pmode = user_data;
+
+	g_return_val_if_fail (pmode != NULL, FALSE);
+
+	if (ncols == 1 && !*pmode)
+		*pmode = g_strdup (column_values[0]);
+
+	return TRUE;
+}
+
+/**
+ * e_cache_enable_wal_sync:
+ * @cache: an #ECache
+ * @n_readers: how many read-only connections to open
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Switches the @cache to the write-ahead log journal and opens up to @n_readers
+ * read-only connections to it. The SELECT statements, which are not run
+ * by the thread holding the lock acquired with e_cache_lock(), use
+ * the read-only connections when any is available, thus they do not wait
+ * for the running write transactions to finish. The descendants should
+ * register their SQLite functions on each such connection in
+ * the #ECacheClass.init_connection() virtual method.
+ *
+ * The write-ahead log is stored persistently in the database file. It also
+ * uses "synchronous = NORMAL", thus the last committed transactions can be lost
+ * after a power failure, but the database stays consistent.
+ *
+ * This can be called only after e_cache_initialize_sync(), out of any transaction.
+ * Calling it again opens more read-only connections, when @n_readers
+ * is larger than before.
+ *
+ * Returns: Whether succeeded.
+ *
+ * Since: 3.62
+ **/
+gboolean
+e_cache_enable_wal_sync (ECache *cache,
+			 guint n_readers,
+			 GCancellable *cancellable,
+			 GError **error)
+{
+	gchar *journal_mode = NULL;
+	gboolean success;
+
+	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
+	g_return_val_if_fail (cache->priv->db != NULL, FALSE);
+
+	g_rec_mutex_lock (&cache->priv->lock);
+
+	if (cache->priv->in_transaction) {
+		g_rec_mutex_unlock (&cache->priv->lock);
+		g_return_val_if_reached (FALSE);
+	}
+
+	success = e_cache_sqlite_exec_internal (cache, "PRAGMA journal_mode = WAL", e_cache_get_journal_mode_cb, &journal_mode, cancellable, error);
+
+	if (success && g_ascii_strcasecmp (journal_mode ? journal_mode : "", "wal") != 0) {
+		g_set_error (error, E_CACHE_ERROR, E_CACHE_ERROR_ENGINE,
+			_("Failed to switch the database %s to the write-ahead log, it uses the journal mode “%s”"),
+			cache->priv->filename, journal_mode ? journal_mode : "");
+		success = FALSE;
+	}
+
+	success = success && e_cache_sqlite_exec_internal (cache, "PRAGMA synchronous = NORMAL", NULL, NULL, cancellable, error);
+
+	g_free (journal_mode);
+
+	n_readers = MIN (n_readers, E_CACHE_MAX_READERS);
+
+	g_mutex_lock (&cache->priv->readers_lock);
+
+	if (success && n_readers > 0 && !cache->priv->readers)
+		cache->priv->readers = g_ptr_array_new_with_free_func (e_cache_reader_free);
+
+	while (success && cache->priv->readers && cache->priv->readers->len < n_readers) {
+		ECacheReader *reader;
+
+		success = !g_cancellable_set_error_if_cancelled (cancellable, error);
+		if (!success)
+			break;
+
+		reader = e_cache_open_reader (cache, error);
+		success = reader != NULL;
+
+		if (reader) {
+			g_ptr_array_add (cache->priv->readers, reader);
+			g_queue_push_tail (&cache->priv->unused_readers, reader);
+		}
+	}
+
+	g_mutex_unlock (&cache->priv->readers_lock);
+
+	g_rec_mutex_unlock (&cache->priv->lock);
+
+	return success;
+}
+
+typedef struct _DictionaryItem {
+	gchar *text;
+	gsize length;
+	guint count;
+} DictionaryItem;
+
+typedef struct _TrainDictionaryData {
+	GHashTable *items;	/* gchar *text ~> DictionaryItem * */
+	guint n_samples;
+} TrainDictionaryData;
+
+static void
+e_cache_dictionary_item_free (gpointer ptr)
+{
+	DictionaryItem *item = ptr;
+
+	if (item) {
+		g_free (item->text);
+		g_free (item);
+	}
+}
+
+static gboolean
+e_cache_train_dictionary_cb (ECache *cache,
+			     gint ncols,
+			     const gchar **column_names,
+			     const gchar **column_values,
+			     gpointer user_data)
+{
+	TrainDictionaryData *tdd = user_data;
+	const gchar *line, *eol;
+
+	g_return_val_if_fail (ncols == 1, FALSE);
+	g_return_val_if_fail (tdd != NULL, FALSE);
+
+	tdd->n_samples++;
+
+	for (line = column_values[0]; line && *line; line = *eol ? eol + 1 : eol) {
+		const gchar *colon;
+		gsize length;
+		gint ii;
+
+		eol = strchr (line, '\n');
+		if (!eol)
+			eol = line + strlen (line);
+
+		length = eol - line;
+		if (length > 0 && line[length - 1] == '\r')
+			length--;
+
+		colon = memchr (line, ':', length);
+
+		/* the whole line, and its property name with the parameters */
+		for (ii = 0; ii < 2; ii++) {
+			DictionaryItem *item;
+			gchar *text;
+
+			if (ii == 1) {
+				if (!colon || colon + 1 == line + length)
+					break;
+
+				length = colon + 1 - line;
+			}
+
+			if (length < 4 || length > 256)
+				continue;
+
+			text = g_strndup (line, length);
+			item = g_hash_table_lookup (tdd->items, text);
+
+			if (item) {
+				item->count++;
+				g_free (text);
+			} else {
+				item = g_new0 (DictionaryItem, 1);
+				item->text = text;
+				item->length = length;
+				item->count = 1;
+
+				g_hash_table_insert (tdd->items, text, item);
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static gint
+e_cache_compare_dictionary_items (gconstpointer ptr1,
+				  gconstpointer ptr2)
+{
+	const DictionaryItem *item1 = *((const DictionaryItem **) ptr1);
+	const DictionaryItem *item2 = *((const DictionaryItem **) ptr2);
+	guint64 score1, score2;
+
+	/* how many bytes it can save */
+	score1 = ((guint64) item1->count - 1) * item1->length;
+	score2 = ((guint64) item2->count - 1) * item2->length;
+
+	if (score1 != score2)
+		return score1 > score2 ? -1 : 1;
+
+	return strcmp (item1->text, item2->text);
+}
+
+/* Trains a new compression dictionary from a sample of the stored objects,
+   which is used for the newly compressed objects; it's not an error when
+   there are too few objects to train it from. */
+static gboolean
+e_cache_train_dictionary_locked (ECache *cache,
+				 GCancellable *cancellable,
+				 GError **error)
+{
+	TrainDictionaryData tdd;
+	GPtrArray *items;
+	GHashTableIter iter;
+	GString *dictionary;
+	gpointer value;
+	gsize length = 0;
+	guint ii, n_used = 0, dictionary_id = 0;
+	gboolean success;
+
+	tdd.items = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, e_cache_dictionary_item_free);
+	tdd.n_samples = 0;
+
+	success = e_cache_sqlite_exec_internal (cache,
+		"SELECT " E_CACHE_COLUMN_OBJECT " FROM " E_CACHE_TABLE_OBJECTS
+		" LIMIT " G_STRINGIFY (E_CACHE_DICTIONARY_SAMPLES),
+		e_cache_train_dictionary_cb, &tdd, cancellable, error);
+
+	if (!success || tdd.n_samples < E_CACHE_DICTIONARY_MIN_SAMPLES) {
+		g_hash_table_destroy (tdd.items);
+		return success;
+	}
+
+	items = g_ptr_array_sized_new (g_hash_table_size (tdd.items));
+
+	g_hash_table_iter_init (&iter, tdd.items);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		DictionaryItem *item = value;
+
+		/* only what repeats in the objects */
+		if (item->count >= MAX (2, tdd.n_samples / 8))
+			g_ptr_array_add (items, item);
+	}
+
+	g_ptr_array_sort (items, e_cache_compare_dictionary_items);
+
+	for (ii = 0; ii < items->len; ii++) {
+		DictionaryItem *item = g_ptr_array_index (items, ii);
+
+		if (length + item->length + 2 > E_CACHE_DICTIONARY_MAX_SIZE)
+			break;
+
+		length += item->length + 2;
+		n_used++;
+	}
+
+	dictionary = g_string_sized_new (length + 1);
+
+	/* deflate prefers the matches closer to the compressed data,
+	   thus the most useful strings are at the end */
+	for (ii = n_used; ii > 0; ii--) {
+		DictionaryItem *item = g_ptr_array_index (items, ii - 1);
+
+		g_string_append_len (dictionary, item->text, item->length);
+		g_string_append (dictionary, "\r\n");
+	}
+
+	g_ptr_array_unref (items);
+	g_hash_table_destroy (tdd.items);
+
+	if (dictionary->len) {
+		gchar *key, *str_id;
+
+		g_mutex_lock (&cache->priv->compression_lock);
+
+		g_hash_table_iter_init (&iter, cache->priv->dictionaries);
+		while (g_hash_table_iter_next (&iter, &value, NULL)) {
+			dictionary_id = MAX (dictionary_id, GPOINTER_TO_UINT (value));
+		}
+
+		g_mutex_unlock (&cache->priv->compression_lock);
+
+		dictionary_id++;
+
+		key = g_strdup_printf (E_CACHE_KEY_DICTIONARY ":%u", dictionary_id);
+		str_id = g_strdup_printf ("%u", dictionary_id);
+
+		success = e_cache_set_key_internal (cache, FALSE, key, dictionary->str, error) &&
+			e_cache_set_key_internal (cache, FALSE, E_CACHE_KEY_DICTIONARY, str_id, error);
+
+		g_free (str_id);
+		g_free (key);
+	}
+
+	if (success && dictionary_id) {
+		g_mutex_lock (&cache->priv->compression_lock);
+
+		g_hash_table_insert (cache->priv->dictionaries, GUINT_TO_POINTER (dictionary_id),
+			g_bytes_new (dictionary->str, dictionary->len));
+		cache->priv->dictionary_id = dictionary_id;
+
+		g_mutex_unlock (&cache->priv->compression_lock);
+
+		cache->priv->compression_changed = TRUE;
+	}
+
+	g_string_free (dictionary, TRUE);
 
-	if (cache->priv->in_transaction == 0) {
-		switch (action) {
-		case E_CACHE_UNLOCK_NONE:
-		case E_CACHE_UNLOCK_COMMIT:
-			e_cache_sqlite_exec_internal (cache, "COMMIT", NULL, NULL, NULL, NULL);
-			break;
-		case E_CACHE_UNLOCK_ROLLBACK:
-			e_cache_sqlite_exec_internal (cache, "ROLLBACK", NULL, NULL, NULL, NULL);
-			break;
-		}
+	return success;
+}
+
+typedef struct _RecompressData {
+	gint64 last_rowid;
+	GSList *rows; /* RecompressRow * */
+} RecompressData;
+
+typedef struct _RecompressRow {
+	gint64 rowid;
+	gchar *stored_object;
+} RecompressRow;
+
+static void
+e_cache_recompress_row_free (gpointer ptr)
+{
+	RecompressRow *row = ptr;
+
+	if (row) {
+		g_free (row->stored_object);
+		g_free (row);
 	}
+}
 
-	g_rec_mutex_unlock (&cache->priv->lock);
+static gboolean
+e_cache_gather_recompress_rows_cb (ECache *cache,
+				   gint ncols,
+				   const gchar **column_names,
+				   const gchar **column_values,
+				   gpointer user_data)
+{
+	RecompressData *rd = user_data;
+	RecompressRow *row;
+
+	g_return_val_if_fail (ncols == 2, FALSE);
+	g_return_val_if_fail (rd != NULL, FALSE);
+
+	row = g_new0 (RecompressRow, 1);
+	row->rowid = g_ascii_strtoll (column_values[0], NULL, 10);
+	row->stored_object = g_strdup (column_values[1]);
+
+	rd->last_rowid = MAX (rd->last_rowid, row->rowid);
+	rd->rows = g_slist_prepend (rd->rows, row);
+
+	return TRUE;
 }
 
-/**
- * e_cache_get_sqlitedb:
- * @cache: an #ECache
- *
- * Returns: (transfer none): An SQLite3 database pointer. It is owned by the @cache.
- *
- * Since: 3.26
- **/
-gpointer
-e_cache_get_sqlitedb (ECache *cache)
+/* Rewrites the values of the @column_name, thus they are compressed with
+   the current dictionary when the @compress is %TRUE, or not compressed at all */
+static gboolean
+e_cache_recompress_column_locked (ECache *cache,
+				  const gchar *column_name,
+				  gboolean compress,
+				  GCancellable *cancellable,
+				  GError **error)
 {
-	g_return_val_if_fail (E_IS_CACHE (cache), NULL);
+	RecompressData rd;
+	ECacheStmt *update_stmt;
+	guint dictionary_id;
+	gboolean success = TRUE;
 
-	return cache->priv->db;
+	g_mutex_lock (&cache->priv->compression_lock);
+	dictionary_id = cache->priv->dictionary_id;
+	g_mutex_unlock (&cache->priv->compression_lock);
+
+	rd.last_rowid = 0;
+	rd.rows = NULL;
+
+	do {
+		GSList *link;
+		gchar *stmt;
+
+		g_slist_free_full (rd.rows, e_cache_recompress_row_free);
+		rd.rows = NULL;
+
+		/* Aliased, to not have the objects decompressed */
+		stmt = e_cache_sqlite_stmt_printf (
+			"SELECT rowid, %s AS stored_object FROM " E_CACHE_TABLE_OBJECTS
+			" WHERE rowid > %" G_GINT64_FORMAT " ORDER BY rowid LIMIT %d",
+			column_name, rd.last_rowid, E_CACHE_UPDATE_BATCH_SIZE);
+
+		success = e_cache_sqlite_exec_internal (cache, stmt, e_cache_gather_recompress_rows_cb, &rd, cancellable, error);
+
+		e_cache_sqlite_stmt_free (stmt);
+
+		for (link = rd.rows; success && link; link = g_slist_next (link)) {
+			RecompressRow *row = link->data;
+			gchar *object = NULL, *new_stored_object = NULL;
+
+			if (!row->stored_object)
+				continue;
+
+			if (e_cache_object_is_compressed (row->stored_object)) {
+				const gchar *data = NULL;
+				gsize length = 0;
+
+				if (compress && e_cache_parse_compressed_header (row->stored_object, &length, &data) == dictionary_id)
+					continue;
+
+				object = e_cache_decompress_object_internal (cache, row->stored_object);
+
+				/* cannot do anything with it */
+				if (!object)
+					continue;
+			} else if (!compress) {
+				continue;
+			}
+
+			if (compress)
+				new_stored_object = e_cache_compress_object_internal (cache, object ? object : row->stored_object);
+
+			if (new_stored_object || object) {
+				stmt = e_cache_sqlite_stmt_printf ("UPDATE " E_CACHE_TABLE_OBJECTS " SET %s=? WHERE rowid=?", column_name);
+				update_stmt = e_cache_stmt_prepare (cache, stmt, error);
+				e_cache_sqlite_stmt_free (stmt);
+
+				success = update_stmt != NULL;
+
+				if (success) {
+					e_cache_stmt_bind_text (update_stmt, 1, new_stored_object ? new_stored_object : object);
+					e_cache_stmt_bind_int64 (update_stmt, 2, row->rowid);
+
+					success = e_cache_stmt_exec (cache, update_stmt, cancellable, error);
+				}
+			}
+
+			g_free (new_stored_object);
+			g_free (object);
+		}
+	} while (success && rd.rows);
+
+	g_slist_free_full (rd.rows, e_cache_recompress_row_free);
+
+	return success;
 }
 
 /**
- * e_cache_sqlite_exec:
+ * e_cache_set_compress_objects_sync:
  * @cache: an #ECache
- * @sql_stmt: an SQLite statement to execute
+ * @compress: whether to compress the stored objects
  * @cancellable: optional #GCancellable object, or %NULL
  * @error: return location for a #GError, or %NULL
  *
- * Executes an SQLite statement. Use e_cache_sqlite_select() for
- * SELECT statements.
+ * Sets whether the objects stored in the @cache should be compressed.
+ * The setting is stored in the @cache, thus it's used also after the @cache
+ * is opened the next time.
+ *
+ * The compressed objects are decompressed transparently, when read
+ * by any of the functions, or when selected by e_cache_sqlite_select()
+ * or e_cache_stmt_select() as the %E_CACHE_COLUMN_OBJECT column.
+ * The SQL statements, which use the object in a condition, should
+ * use the %E_CACHE_FUNC_OBJECT function to get the decompressed object.
+ * The other columns are not compressed, unless the descendant stores them
+ * compressed with e_cache_compress_object(); such columns are recompressed
+ * in the #ECacheClass.recompress_columns_locked() virtual method.
+ *
+ * The compression uses a dictionary, trained from the stored objects,
+ * which is created when enough objects are stored. The already stored
+ * objects are compressed or decompressed by this function, which can take
+ * some time for large caches. Call e_cache_sqlite_maybe_vacuum() afterwards,
+ * to reclaim the freed space.
  *
  * Returns: Whether succeeded.
  *
- * Since: 3.26
+ * Since: 3.62
  **/
 gboolean
-e_cache_sqlite_exec (ECache *cache,
-		     const gchar *sql_stmt,
-		     GCancellable *cancellable,
-		     GError **error)
+e_cache_set_compress_objects_sync (ECache *cache,
+				   gboolean compress,
+				   GCancellable *cancellable,
+				   GError **error)
 {
+	gboolean success;
+
 	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
 
-	return e_cache_sqlite_exec_internal (cache, sql_stmt, NULL, NULL, cancellable, error);
+	e_cache_lock (cache, E_CACHE_LOCK_WRITE);
+
+	success = e_cache_set_key_internal (cache, FALSE, E_CACHE_KEY_COMPRESS_OBJECTS, compress ? "1" : NULL, error);
+
+	if (success && compress) {
+		guint dictionary_id;
+
+		g_mutex_lock (&cache->priv->compression_lock);
+		dictionary_id = cache->priv->dictionary_id;
+		g_mutex_unlock (&cache->priv->compression_lock);
+
+		if (!dictionary_id)
+			success = e_cache_train_dictionary_locked (cache, cancellable, error);
+	}
+
+	success = success && e_cache_recompress_column_locked (cache, E_CACHE_COLUMN_OBJECT, compress, cancellable, error);
+
+	if (success) {
+		ECacheClass *klass;
+
+		klass = E_CACHE_GET_CLASS (cache);
+
+		if (klass && klass->recompress_columns_locked)
+			success = klass->recompress_columns_locked (cache, compress, cancellable, error);
+	}
+
+	if (success) {
+		g_mutex_lock (&cache->priv->compression_lock);
+		cache->priv->compress_objects = compress;
+		g_mutex_unlock (&cache->priv->compression_lock);
+
+		cache->priv->n_puts_without_dictionary = 0;
+		cache->priv->compression_changed = TRUE;
+	}
+
+	e_cache_unlock (cache, success ? E_CACHE_UNLOCK_COMMIT : E_CACHE_UNLOCK_ROLLBACK);
+
+	return success;
 }
 
 /**
- * e_cache_sqlite_select:
+ * e_cache_recompress_column_sync:
  * @cache: an #ECache
- * @sql_stmt: an SQLite SELECT statement to execute
- * @func: (scope call): an #ECacheSelectFunc function to call for each row
- * @user_data: user data for @func
+ * @column_name: name of the column to recompress
+ * @compress: whether to compress the values
  * @cancellable: optional #GCancellable object, or %NULL
  * @error: return location for a #GError, or %NULL
  *
- * Executes a SELECT statement @sql_stmt and calls @func for each row of the result.
- * Use e_cache_sqlite_exec() for statements which do not return row sets.
+ * Compresses or decompresses the values of the @column_name, which
+ * were stored compressed by e_cache_compress_object(). The descendants
+ * call it from the #ECacheClass.recompress_columns_locked() virtual method,
+ * to have their other columns follow e_cache_set_compress_objects_sync().
  *
  * Returns: Whether succeeded.
  *
- * Since: 3.26
+ * Since: 3.62
  **/
 gboolean
-e_cache_sqlite_select (ECache *cache,
-		       const gchar *sql_stmt,
-		       ECacheSelectFunc func,
-		       gpointer user_data,
-		       GCancellable *cancellable,
-		       GError **error)
+e_cache_recompress_column_sync (ECache *cache,
+				const gchar *column_name,
+				gboolean compress,
+				GCancellable *cancellable,
+				GError **error)
 {
+	gboolean success;
+
 	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
-	g_return_val_if_fail (sql_stmt, FALSE);
-	g_return_val_if_fail (func, FALSE);
+	g_return_val_if_fail (column_name != NULL, FALSE);
 
-	return e_cache_sqlite_exec_internal (cache, sql_stmt, func, user_data, cancellable, error);
+	e_cache_lock (cache, E_CACHE_LOCK_WRITE);
+
+	success = e_cache_recompress_column_locked (cache, column_name, compress, cancellable, error);
+
+	e_cache_unlock (cache, success ? E_CACHE_UNLOCK_COMMIT : E_CACHE_UNLOCK_ROLLBACK);
+
+	return success;
 }
 
 /**
- * e_cache_sqlite_stmt_append_printf:
- * @stmt: a #GString statement to append to
- * @format: a printf-like format
- * @...: arguments for the @format
+ * e_cache_get_compress_objects:
+ * @cache: an #ECache
  *
- * Appends an SQLite statement fragment based on the @format and
- * its arguments to the @stmt.
- * The @format can contain any values recognized by sqlite3_mprintf().
+ * Returns: Whether the newly stored objects are compressed.
+ *    See e_cache_set_compress_objects_sync() for more information.
  *
- * Since: 3.26
+ * Since: 3.62
  **/
-void
-e_cache_sqlite_stmt_append_printf (GString *stmt,
-				   const gchar *format,
-				   ...)
+gboolean
+e_cache_get_compress_objects (ECache *cache)
 {
-	va_list args;
-	gchar *tmp_stmt;
-
-	g_return_if_fail (stmt != NULL);
-	g_return_if_fail (format != NULL);
+	gboolean compress;
 
-	va_start (args, format);
-	tmp_stmt = sqlite3_vmprintf (format, args);
-	va_end (args);
+	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
 
-	g_string_append (stmt, tmp_stmt);
+	g_mutex_lock (&cache->priv->compression_lock);
+	compress = cache->priv->compress_objects;
+	g_mutex_unlock (&cache->priv->compression_lock);
 
-	sqlite3_free (tmp_stmt);
+	return compress;
 }
 
 /**
- * e_cache_sqlite_stmt_printf:
- * @format: a printf-like format
- * @...: arguments for the @format
+ * e_cache_object_is_compressed:
+ * @stored_object: (nullable): an object, as stored in the #ECache
  *
- * Creates an SQLite statement based on the @format and its arguments.
- * The @format can contain any values recognized by sqlite3_mprintf().
+ * Checks whether the @stored_object, as read from the %E_CACHE_COLUMN_OBJECT
+ * column, is compressed. That can happen when it's read by an SQL function,
+ * or when it's selected with a different column name.
  *
- * Returns: (transfer full): A new SQLite statement. Free the returned
- *    string with e_cache_sqlite_stmt_free() when no longer needed.
+ * Returns: Whether the @stored_object is compressed.
  *
- * Since: 3.26
+ * Since: 3.62
  **/
-gchar *
-e_cache_sqlite_stmt_printf (const gchar *format,
-			    ...)
+gboolean
+e_cache_object_is_compressed (const gchar *stored_object)
 {
-	va_list args;
-	gchar *stmt;
-
-	g_return_val_if_fail (format != NULL, NULL);
-
-	va_start (args, format);
-	stmt = sqlite3_vmprintf (format, args);
-	va_end (args);
-
-	return stmt;
+	return stored_object && g_str_has_prefix (stored_object, E_CACHE_COMPRESSED_MAGIC);
 }
 
 /**
- * e_cache_sqlite_stmt_free:
- * @stmt: a statement to free
+ * e_cache_compress_object:
+ * @cache: an #ECache
+ * @object: an object to compress
  *
- * Frees a statement previously constructed with e_cache_sqlite_stmt_printf().
+ * Compresses the @object the same way as the objects stored
+ * in the @cache are compressed, when the compression is enabled,
+ * see e_cache_set_compress_objects_sync(). It can be used for values
+ * of the other columns, which are too large to be stored as they are.
+ * Such values are not decompressed automatically, use
+ * e_cache_decompress_object() to read them back.
  *
- * Since: 3.26
+ * Returns: (transfer full): the compressed @object, or a copy of it,
+ *    when the compression is disabled or it's not worth it. Free
+ *    the returned string with g_free(), when no longer needed.
+ *
+ * Since: 3.62
  **/
-void
-e_cache_sqlite_stmt_free (gchar *stmt)
+gchar *
+e_cache_compress_object (ECache *cache,
+			 const gchar *object)
 {
-	if (stmt)
-		sqlite3_free (stmt);
+	gchar *compressed = NULL;
+
+	g_return_val_if_fail (E_IS_CACHE (cache), NULL);
+	g_return_val_if_fail (object != NULL, NULL);
+
+	if (e_cache_get_compress_objects (cache))
+		compressed = e_cache_compress_object_internal (cache, object);
+
+	return compressed ? compressed : g_strdup (object);
 }
 
 /**
- * e_cache_sqlite_maybe_vacuum:
+ * e_cache_decompress_object:
  * @cache: an #ECache
- * @cancellable: optional #GCancellable object, or %NULL
- * @error: return location for a #GError, or %NULL
+ * @stored_object: an object, as stored in the @cache
  *
- * Runs vacuum (compacts the database file), if needed.
+ * Decompresses the @stored_object, if it's compressed,
+ * see e_cache_object_is_compressed().
  *
- * Returns: Whether succeeded. It doesn't mean that the vacuum had been run,
- *    only that no error happened during the call.
+ * Returns: (transfer full) (nullable): the decompressed @stored_object,
+ *    a copy of it, when it's not compressed, or %NULL, when it cannot be
+ *    decompressed. Free the returned string with g_free(), when no longer needed.
  *
- * Since: 3.26
+ * Since: 3.62
  **/
-gboolean
-e_cache_sqlite_maybe_vacuum (ECache *cache,
-			     GCancellable *cancellable,
-			     GError **error)
+gchar *
+e_cache_decompress_object (ECache *cache,
+			   const gchar *stored_object)
 {
-	guint64 page_count = 0, page_size = 0, freelist_count = 0;
-	gboolean success = FALSE;
-	GError *local_error = NULL;
-
-	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
-
-	g_rec_mutex_lock (&cache->priv->lock);
-
-	if (e_cache_sqlite_exec_internal (cache, "PRAGMA page_count;", e_cache_get_uint64_cb, &page_count, cancellable, &local_error) &&
-	    e_cache_sqlite_exec_internal (cache, "PRAGMA page_size;", e_cache_get_uint64_cb, &page_size, cancellable, &local_error) &&
-	    e_cache_sqlite_exec_internal (cache, "PRAGMA freelist_count;", e_cache_get_uint64_cb, &freelist_count, cancellable, &local_error)) {
-		/* Vacuum, if there's more than 5% of the free pages, or when free pages use more than 10MB */
-		success = !page_count || !freelist_count ||
-			(freelist_count * page_size < 1024 * 1024 * 10 && freelist_count * 1000 / page_count <= 50) ||
-			e_cache_sqlite_exec_internal (cache, "vacuum;", NULL, NULL, cancellable, &local_error);
-	}
-
-	g_rec_mutex_unlock (&cache->priv->lock);
+	g_return_val_if_fail (E_IS_CACHE (cache), NULL);
+	g_return_val_if_fail (stored_object != NULL, NULL);
 
-	if (local_error) {
-		g_propagate_error (error, local_error);
-		success = FALSE;
-	}
+	if (!e_cache_object_is_compressed (stored_object))
+		return g_strdup (stored_object);
 
-	return success;
+	return e_cache_decompress_object_internal (cache, stored_object);
 }
 
 static gboolean
@@ -2886,65 +4636,96 @@ e_cache_put_locked_default (ECache *cache,
 			    GCancellable *cancellable,
 			    GError **error)
 {
-	GString *statement, *other_names = NULL, *other_values = NULL;
-	gboolean success;
+	GString *statement, *other_params = NULL;
+	GPtrArray *other_values = NULL;
+	ECacheStmt *stmt;
+	gchar *compressed_object = NULL;
+	gboolean compress;
+	guint dictionary_id;
+	gboolean success = FALSE;
 
 	g_return_val_if_fail (E_IS_CACHE (cache), FALSE);
 	g_return_val_if_fail (uid != NULL, FALSE);
 	g_return_val_if_fail (object != NULL, FALSE);
 
+	g_mutex_lock (&cache->priv->compression_lock);
+	compress = cache->priv->compress_objects;
+	dictionary_id = cache->priv->dictionary_id;
+	g_mutex_unlock (&cache->priv->compression_lock);
+
+	if (compress) {
+		/* Train the dictionary, once there are enough objects; failing to do so is not fatal */
+		if (!dictionary_id) {
+			cache->priv->n_puts_without_dictionary++;
+
+			if (cache->priv->n_puts_without_dictionary >= E_CACHE_DICTIONARY_TRAIN_PUTS) {
+				cache->priv->n_puts_without_dictionary = 0;
+				e_cache_train_dictionary_locked (cache, cancellable, NULL);
+			}
+		}
+
+		compressed_object = e_cache_compress_object_internal (cache, object);
+	}
+
 	statement = g_string_sized_new (255);
 
-	e_cache_sqlite_stmt_append_printf (statement, "INSERT OR REPLACE INTO %Q ("
+	/* The values are bound to the parameters, thus the statement text
+	   depends only on the set of the other columns and it's prepared
+	   only once for each such set. */
+	g_string_append (statement, "INSERT OR REPLACE INTO " E_CACHE_TABLE_OBJECTS " ("
 		E_CACHE_COLUMN_UID ","
 		E_CACHE_COLUMN_REVISION ","
 		E_CACHE_COLUMN_OBJECT ","
-		E_CACHE_COLUMN_STATE,
-		E_CACHE_TABLE_OBJECTS);
+		E_CACHE_COLUMN_STATE);
 
-	if (other_columns) {
+	if (other_columns && e_cache_column_values_get_size (other_columns) > 0) {
 		GHashTableIter iter;
 		gpointer key, value;
 
+		other_params = g_string_new ("");
+		other_values = g_ptr_array_new ();
+
 		e_cache_column_values_init_iter (other_columns, &iter);
 		while (g_hash_table_iter_next (&iter, &key, &value)) {
-			if (!other_names)
-				other_names = g_string_new ("");
-			g_string_append_c (other_names, ',');
+			e_cache_sqlite_stmt_append_printf (statement, ",%Q", key);
+			g_string_append (other_params, ",?");
+			g_ptr_array_add (other_values, value);
+		}
+	}
 
-			e_cache_sqlite_stmt_append_printf (other_names, "%Q", key);
+	g_string_append (statement, ") VALUES (?,?,?,?");
 
-			if (!other_values)
-				other_values = g_string_new ("");
+	if (other_params)
+		g_string_append (statement, other_params->str);
 
-			g_string_append_c (other_values, ',');
-			if (value) {
-				e_cache_sqlite_stmt_append_printf (other_values, "%Q", value);
-			} else {
-				g_string_append (other_values, "NULL");
-			}
-		}
-	}
+	g_string_append_c (statement, ')');
 
-	if (other_names)
-		g_string_append (statement, other_names->str);
+	g_rec_mutex_lock (&cache->priv->lock);
 
-	g_string_append (statement, ") VALUES (");
+	stmt = e_cache_stmt_prepare (cache, statement->str, error);
+	if (stmt) {
+		guint ii;
 
-	e_cache_sqlite_stmt_append_printf (statement, "%Q,%Q,%Q,%d", uid, revision ? revision : "", object, offline_state);
+		e_cache_stmt_bind_text (stmt, 1, uid);
+		e_cache_stmt_bind_text (stmt, 2, revision ? revision : "");
+		e_cache_stmt_bind_text (stmt, 3, compressed_object ? compressed_object : object);
+		e_cache_stmt_bind_int (stmt, 4, offline_state);
 
-	if (other_values)
-		g_string_append (statement, other_values->str);
+		for (ii = 0; other_values && ii < other_values->len; ii++) {
+			e_cache_stmt_bind_text (stmt, 5 + ii, g_ptr_array_index (other_values, ii));
+		}
 
-	g_string_append_c (statement, ')');
+		success = e_cache_stmt_exec (cache, stmt, cancellable, error);
+	}
 
-	success = e_cache_sqlite_exec_internal (cache, statement->str, NULL, NULL, cancellable, error);
+	g_rec_mutex_unlock (&cache->priv->lock);
 
-	if (other_names)
-		g_string_free (other_names, TRUE);
+	if (other_params)
+		g_string_free (other_params, TRUE);
 	if (other_values)
-		g_string_free (other_values, TRUE);
+		g_ptr_array_free (other_values, TRUE);
 	g_string_free (statement, TRUE);
+	g_free (compressed_object);
 
 	return success;
 }
@@ -3071,9 +4852,18 @@ e_cache_finalize (GObject *object)
 	g_free (cache->priv->filename);
 	cache->priv->filename = NULL;
 
+	e_cache_close_readers (cache);
+
+	/* the statements should be finalized before the database is closed */
+	e_cache_stmt_clear_locked (cache);
+	g_clear_pointer (&cache->priv->prepared_stmts, g_hash_table_destroy);
 	g_clear_pointer (&cache->priv->db, sqlite3_close);
 
+	g_clear_pointer (&cache->priv->dictionaries, g_hash_table_destroy);
+
 	g_rec_mutex_clear (&cache->priv->lock);
+	g_mutex_clear (&cache->priv->readers_lock);
+	g_mutex_clear (&cache->priv->compression_lock);
 
 	g_warn_if_fail (cache->priv->cancellable == NULL);
 	g_clear_object (&cache->priv->cancellable);
@@ -3154,6 +4944,12 @@ e_cache_init (ECache *cache)
 	cache->priv->revision_counter = 0;
 	cache->priv->last_revision_time = 0;
 	cache->priv->needs_revision_change = FALSE;
+	cache->priv->prepared_stmts = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, e_cache_stmt_free);
+	cache->priv->dictionaries = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_bytes_unref);
 
 	g_rec_mutex_init (&cache->priv->lock);
+	g_mutex_init (&cache->priv->readers_lock);
+	g_mutex_init (&cache->priv->compression_lock);
+	g_queue_init (&cache->priv->unused_readers);
+	g_queue_init (&cache->priv->prepared_stmts_lru);
 }
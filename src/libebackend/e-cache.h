@@ -43,6 +43,21 @@ G_BEGIN_DECLS
 #define E_CACHE_COLUMN_OBJECT	"ECacheOBJ"
 #define E_CACHE_COLUMN_STATE	"ECacheState"
 
+/**
+ * E_CACHE_FUNC_OBJECT:
+ *
+ * Name of an SQL function, which returns its only argument, an object
+ * from the %E_CACHE_COLUMN_OBJECT column, decompressed. It should be used
+ * in the conditions on the object, like:
+ * |[
+ *    E_CACHE_FUNC_OBJECT "(" E_CACHE_COLUMN_OBJECT ") LIKE '%text%'"
+ * ]|
+ * See e_cache_set_compress_objects_sync().
+ *
+ * Since: 3.62
+ **/
+#define E_CACHE_FUNC_OBJECT	"ecache_object"
+
 /**
  * E_CACHE_ERROR:
  *
@@ -224,6 +239,16 @@ typedef struct _ECache ECache;
 typedef struct _ECacheClass ECacheClass;
 typedef struct _ECachePrivate ECachePrivate;
 
+/**
+ * ECacheStmt:
+ *
+ * An opaque structure of a prepared statement, as returned
+ * by e_cache_stmt_prepare().
+ *
+ * Since: 3.62
+ **/
+typedef struct _ECacheStmt ECacheStmt;
+
 /**
  * ECacheForeachFunc:
  * @cache: an #ECache
@@ -363,8 +388,18 @@ struct _ECacheClass {
 						 GError **error);
 	void		(* revision_changed)	(ECache *cache);
 
+	/* Virtual methods */
+	gboolean	(* init_connection)	(ECache *cache,
+						 gpointer sqlitedb,
+						 GError **error);
+	gboolean	(* recompress_columns_locked)
+						(ECache *cache,
+						 gboolean compress,
+						 GCancellable *cancellable,
+						 GError **error);
+
 	/* Padding for future expansion */
-	gpointer reserved[10];
+	gpointer reserved[8];
 };
 
 GType		e_cache_get_type		(void) G_GNUC_CONST;
@@ -411,6 +446,14 @@ gboolean	e_cache_put			(ECache *cache,
 						 ECacheOfflineFlag offline_flag,
 						 GCancellable *cancellable,
 						 GError **error);
+gboolean	e_cache_put_many		(ECache *cache,
+						 const GSList *uids, /* gchar * */
+						 const GSList *revisions, /* gchar * */
+						 const GSList *objects, /* gchar * */
+						 const GSList *other_columns, /* ECacheColumnValues * */
+						 ECacheOfflineFlag offline_flag,
+						 GCancellable *cancellable,
+						 GError **error);
 gboolean	e_cache_remove			(ECache *cache,
 						 const gchar *uid,
 						 ECacheOfflineFlag offline_flag,
@@ -510,6 +553,54 @@ gboolean	e_cache_sqlite_select		(ECache *cache,
 gboolean	e_cache_sqlite_maybe_vacuum	(ECache *cache,
 						 GCancellable *cancellable,
 						 GError **error);
+gboolean	e_cache_enable_wal_sync		(ECache *cache,
+						 guint n_readers,
+						 GCancellable *cancellable,
+						 GError **error);
+
+/* Objects compression */
+gboolean	e_cache_set_compress_objects_sync
+						(ECache *cache,
+						 gboolean compress,
+						 GCancellable *cancellable,
+						 GError **error);
+gboolean	e_cache_get_compress_objects	(ECache *cache);
+gboolean	e_cache_object_is_compressed	(const gchar *stored_object);
+gchar *		e_cache_compress_object		(ECache *cache,
+						 const gchar *object);
+gchar *		e_cache_decompress_object	(ECache *cache,
+						 const gchar *stored_object);
+gboolean	e_cache_recompress_column_sync	(ECache *cache,
+						 const gchar *column_name,
+						 gboolean compress,
+						 GCancellable *cancellable,
+						 GError **error);
+
+/* Prepared statements */
+ECacheStmt *	e_cache_stmt_prepare		(ECache *cache,
+						 const gchar *sql,
+						 GError **error);
+void		e_cache_stmt_bind_text		(ECacheStmt *stmt,
+						 gint index,
+						 const gchar *value);
+void		e_cache_stmt_bind_int		(ECacheStmt *stmt,
+						 gint index,
+						 gint value);
+void		e_cache_stmt_bind_int64		(ECacheStmt *stmt,
+						 gint index,
+						 gint64 value);
+void		e_cache_stmt_bind_null		(ECacheStmt *stmt,
+						 gint index);
+gboolean	e_cache_stmt_exec		(ECache *cache,
+						 ECacheStmt *stmt,
+						 GCancellable *cancellable,
+						 GError **error);
+gboolean	e_cache_stmt_select		(ECache *cache,
+						 ECacheStmt *stmt,
+						 ECacheSelectFunc func,
+						 gpointer user_data,
+						 GCancellable *cancellable,
+						 GError **error);
 
 void		e_cache_sqlite_stmt_append_printf
 						(GString *stmt,
@@ -0,0 +1,409 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+/* A benchmark of reading the vCard attributes. It constructs a set
+ * of generated vCards and accesses their attributes, once parsing
+ * the vCard strings and once reading the attributes serialized
+ * with e_vcard_serialize(), like the EBookCache does, and reports
+ * the vCards per second for both. It also parses vCards generated
+ * in the way the Google, Exchange and iCloud exports look like,
+ * and reports the parser throughput. At last it reads a set of fields
+ * of the parsed contacts repeatedly, like the views do, and reports
+ * the field accesses per second.
+ *
+ * Run it in the performance mode, to read 50000 vCards:
+ *
+ *    test-vcard-benchmark -m perf [--vcards N]
+ */
+
+#include <string.h>
+
+#include <libebook/libebook.h>
+
+static gint option_vcards = 0;
+
+static GOptionEntry entries[] = {
+
+	{ "vcards", 0, 0, G_OPTION_ARG_INT, &option_vcards,
+	  "How many vCards to read (default 50000 in the performance mode, 2000 otherwise)", "N" },
+	{ NULL }
+};
+
+static guint n_vcards = 0;
+static GPtrArray *vcards = NULL; /* gchar * */
+static GPtrArray *serialized = NULL; /* gchar * */
+
+static void
+benchmark_gen_vcards (void)
+{
+	guint ii;
+
+	vcards = g_ptr_array_new_full (n_vcards, g_free);
+	serialized = g_ptr_array_new_full (n_vcards, g_free);
+
+	for (ii = 0; ii < n_vcards; ii++) {
+		EVCard *vcard;
+		gchar *str;
+
+		str = g_strdup_printf (
+			"BEGIN:VCARD\r\n"
+			"VERSION:3.0\r\n"
+			"UID:benchmark-%u\r\n"
+			"REV:2026-01-01T00:00:%02uZ\r\n"
+			"FN:Given%u Family%u\r\n"
+			"N:Family%u;Given%u;;;\r\n"
+			"EMAIL;TYPE=WORK:given%u.family%u@example.com\r\n"
+			"EMAIL;TYPE=HOME:g%u@home.example.org\r\n"
+			"TEL;TYPE=CELL:+1 221 555 %04u\r\n"
+			"TEL;TYPE=WORK,VOICE:+1 221 556 %04u\r\n"
+			"ADR;TYPE=WORK:;;Street %u\\, Building %u;City;;%05u;Country\r\n"
+			"ORG:Company %u;Department %u\r\n"
+			"NOTE:A note of the contact number %u\\nspanning more lines\\, which\r\n"
+			"  is folded\r\n"
+			"END:VCARD",
+			ii, ii % 60, ii, ii, ii, ii, ii, ii, ii,
+			ii % 10000, ii % 10000, ii % 1000, ii % 7, ii % 100000,
+			ii % 100, ii % 7, ii);
+
+		vcard = e_vcard_new_from_string (str);
+
+		g_ptr_array_add (vcards, str);
+		g_ptr_array_add (serialized, e_vcard_serialize (vcard));
+
+		g_object_unref (vcard);
+	}
+}
+
+static void
+benchmark_report (const gchar *label,
+		  gdouble elapsed)
+{
+	g_test_message ("%-12s %8u vCards  %8.3f s  (%10.1f vCards/s)",
+		label, n_vcards, elapsed, elapsed > 0.0 ? n_vcards / elapsed : 0.0);
+
+	if (g_test_perf ())
+		g_test_maximized_result (elapsed > 0.0 ? n_vcards / elapsed : 0.0, "%s: %.1f vCards/s", label, n_vcards / elapsed);
+}
+
+static void
+benchmark_check_contact (EContact *contact,
+			 guint index)
+{
+	gchar *expected;
+
+	expected = g_strdup_printf ("Given%u Family%u", index, index);
+	g_assert_cmpstr (e_contact_get_const (contact, E_CONTACT_FULL_NAME), ==, expected);
+	g_free (expected);
+}
+
+typedef enum {
+	EXPORT_GOOGLE,
+	EXPORT_EXCHANGE,
+	EXPORT_ICLOUD,
+	N_EXPORTS
+} ExportKind;
+
+static gchar *
+benchmark_gen_export_vcard (ExportKind kind,
+			    guint index)
+{
+	GString *str;
+	gchar *photo, *ptr;
+	guchar data[640];
+	guint ii;
+
+	switch (kind) {
+	case EXPORT_GOOGLE:
+		return g_strdup_printf (
+			"BEGIN:VCARD\r\n"
+			"VERSION:3.0\r\n"
+			"FN:Given%u Family%u\r\n"
+			"N:Family%u;Given%u;;;\r\n"
+			"EMAIL;TYPE=INTERNET;TYPE=HOME:given%u@gmail.example.com\r\n"
+			"EMAIL;TYPE=INTERNET;TYPE=WORK:given%u.family%u@example.com\r\n"
+			"TEL;TYPE=CELL:+1 221 555 %04u\r\n"
+			"ADR;TYPE=HOME:;;Street %u;City;;%05u;Country\r\n"
+			"ORG:Company %u\r\n"
+			"item1.URL:http\\://www.example.com/%u\r\n"
+			"item1.X-ABLabel:PROFILE\r\n"
+			"CATEGORIES:myContacts,Friends\r\n"
+			"END:VCARD\r\n",
+			index, index, index, index, index, index, index,
+			index % 10000, index % 1000, index % 100000, index % 100, index);
+	case EXPORT_EXCHANGE:
+		return g_strdup_printf (
+			"BEGIN:VCARD\r\n"
+			"VERSION:2.1\r\n"
+			"N;LANGUAGE=en-us:Family%u;Given%u\r\n"
+			"FN:Given%u Family%u\r\n"
+			"ORG:Company %u;Department %u\r\n"
+			"TITLE:Engineer\r\n"
+			"TEL;WORK;VOICE:+1 221 556 %04u\r\n"
+			"TEL;CELL;VOICE:+1 221 555 %04u\r\n"
+			"ADR;WORK;PREF:;;Street %u;City;;%05u;Country\r\n"
+			"LABEL;WORK;PREF;ENCODING=QUOTED-PRINTABLE:Street %u=0D=0ACity %05u=0D=0ACo=\r\n"
+			"untry\r\n"
+			"EMAIL;PREF;INTERNET:given%u.family%u@example.com\r\n"
+			"REV:20260101T0000%02uZ\r\n"
+			"END:VCARD\r\n",
+			index, index, index, index, index % 100, index % 7,
+			index % 10000, index % 10000, index % 1000, index % 100000,
+			index % 1000, index % 100000, index, index, index % 60);
+	case EXPORT_ICLOUD:
+	default:
+		break;
+	}
+
+	for (ii = 0; ii < G_N_ELEMENTS (data); ii++) {
+		data[ii] = (index * 31 + ii * 7) & 0xff;
+	}
+
+	photo = g_base64_encode (data, sizeof (data));
+
+	str = g_string_sized_new (2048);
+
+	g_string_append_printf (str,
+		"BEGIN:VCARD\r\n"
+		"VERSION:3.0\r\n"
+		"PRODID:-//Apple Inc.//iPhone OS 17.0//EN\r\n"
+		"N:Family%u;Given%u;;;\r\n"
+		"FN:Given%u Family%u\r\n"
+		"EMAIL;type=INTERNET;type=HOME;type=pref:given%u@icloud.example.com\r\n"
+		"TEL;type=CELL;type=VOICE;type=pref:+1 221 555 %04u\r\n"
+		"item1.ADR;type=HOME;type=pref:;;Street %u;City;;%05u;Country\r\n"
+		"item1.X-ABADR:us\r\n"
+		"NOTE:First line\\nSecond line\\, with a comma\r\n",
+		index, index, index, index, index,
+		index % 10000, index % 1000, index % 100000);
+
+	/* fold the photo the same way the iCloud does */
+	g_string_append (str, "PHOTO;ENCODING=b;TYPE=JPEG:");
+	for (ptr = photo; *ptr; ptr += MIN (strlen (ptr), 74)) {
+		if (ptr != photo)
+			g_string_append (str, "\r\n ");
+		g_string_append_len (str, ptr, MIN (strlen (ptr), 74));
+	}
+
+	g_string_append (str,
+		"\r\n"
+		"END:VCARD\r\n");
+
+	g_free (photo);
+
+	return g_string_free (str, FALSE);
+}
+
+static void
+test_parse_exports (void)
+{
+	const gchar *labels[N_EXPORTS] = { "Google", "Exchange", "iCloud" };
+	guint kind;
+
+	for (kind = 0; kind < N_EXPORTS; kind++) {
+		GPtrArray *exports;
+		GTimer *timer;
+		guint64 n_bytes = 0;
+		gdouble elapsed;
+		guint ii;
+
+		exports = g_ptr_array_new_full (n_vcards, g_free);
+
+		for (ii = 0; ii < n_vcards; ii++) {
+			gchar *str = benchmark_gen_export_vcard (kind, ii);
+
+			n_bytes += strlen (str);
+			g_ptr_array_add (exports, str);
+		}
+
+		timer = g_timer_new ();
+
+		for (ii = 0; ii < n_vcards; ii++) {
+			EVCard *vcard;
+
+			vcard = e_vcard_new_from_string (exports->pdata[ii]);
+			g_assert_nonnull (e_vcard_get_attributes (vcard));
+
+			if (ii % 1000 == 0)
+				g_assert_nonnull (e_vcard_get_attribute (vcard, EVC_FN));
+
+			g_object_unref (vcard);
+		}
+
+		g_timer_stop (timer);
+		elapsed = g_timer_elapsed (timer, NULL);
+
+		g_test_message ("%-12s %8u vCards  %8.3f s  (%10.1f vCards/s, %8.2f MB/s)",
+			labels[kind], n_vcards, elapsed,
+			elapsed > 0.0 ? n_vcards / elapsed : 0.0,
+			elapsed > 0.0 ? n_bytes / elapsed / (1024.0 * 1024.0) : 0.0);
+
+		if (g_test_perf ())
+			g_test_maximized_result (elapsed > 0.0 ? n_bytes / elapsed / (1024.0 * 1024.0) : 0.0,
+				"%s: %.2f MB/s", labels[kind], n_bytes / elapsed / (1024.0 * 1024.0));
+
+		g_timer_destroy (timer);
+		g_ptr_array_unref (exports);
+	}
+}
+
+static void
+test_read_parse (void)
+{
+	GTimer *timer;
+	guint ii;
+
+	timer = g_timer_new ();
+
+	for (ii = 0; ii < n_vcards; ii++) {
+		EContact *contact;
+
+		contact = e_contact_new_from_vcard (vcards->pdata[ii]);
+		g_assert_nonnull (e_vcard_get_attributes (E_VCARD (contact)));
+
+		if (ii % 1000 == 0)
+			benchmark_check_contact (contact, ii);
+
+		g_object_unref (contact);
+	}
+
+	g_timer_stop (timer);
+
+	benchmark_report ("parse", g_timer_elapsed (timer, NULL));
+
+	g_timer_destroy (timer);
+}
+
+static void
+test_read_serialized (void)
+{
+	GTimer *timer;
+	guint ii;
+
+	timer = g_timer_new ();
+
+	for (ii = 0; ii < n_vcards; ii++) {
+		EContact *contact;
+
+		contact = e_contact_new ();
+		e_vcard_construct_serialized (E_VCARD (contact), vcards->pdata[ii], serialized->pdata[ii], NULL);
+		g_assert_nonnull (e_vcard_get_attributes (E_VCARD (contact)));
+
+		if (ii % 1000 == 0)
+			benchmark_check_contact (contact, ii);
+
+		g_object_unref (contact);
+	}
+
+	g_timer_stop (timer);
+
+	benchmark_report ("serialized", g_timer_elapsed (timer, NULL));
+
+	g_timer_destroy (timer);
+}
+
+static void
+test_field_access (void)
+{
+	const EContactField fields[] = {
+		E_CONTACT_UID,
+		E_CONTACT_FULL_NAME,
+		E_CONTACT_FAMILY_NAME,
+		E_CONTACT_GIVEN_NAME,
+		E_CONTACT_ORG,
+		E_CONTACT_ORG_UNIT,
+		E_CONTACT_NOTE,
+		E_CONTACT_REV,
+		E_CONTACT_NICKNAME,
+		E_CONTACT_TITLE
+	};
+	GPtrArray *contacts;
+	GTimer *timer;
+	gdouble elapsed;
+	guint64 n_accesses = 0;
+	guint ii, jj, round;
+
+	contacts = g_ptr_array_new_full (n_vcards, g_object_unref);
+
+	for (ii = 0; ii < n_vcards; ii++) {
+		EContact *contact;
+
+		contact = e_contact_new_from_vcard (vcards->pdata[ii]);
+		g_assert_nonnull (e_vcard_get_attributes (E_VCARD (contact)));
+
+		g_ptr_array_add (contacts, contact);
+	}
+
+	timer = g_timer_new ();
+
+	for (round = 0; round < 5; round++) {
+		for (ii = 0; ii < contacts->len; ii++) {
+			EContact *contact = contacts->pdata[ii];
+			EContactName *name;
+
+			for (jj = 0; jj < G_N_ELEMENTS (fields); jj++) {
+				e_contact_get_const (contact, fields[jj]);
+				n_accesses++;
+			}
+
+			name = e_contact_get (contact, E_CONTACT_NAME);
+			g_assert_nonnull (name);
+			e_contact_name_free (name);
+			n_accesses++;
+
+			if (round == 0 && ii % 1000 == 0)
+				benchmark_check_contact (contact, ii);
+		}
+	}
+
+	g_timer_stop (timer);
+	elapsed = g_timer_elapsed (timer, NULL);
+
+	g_test_message ("%-12s %8lu accesses  %8.3f s  (%10.1f accesses/s)",
+		"fields", (gulong) n_accesses, elapsed, elapsed > 0.0 ? n_accesses / elapsed : 0.0);
+
+	if (g_test_perf ())
+		g_test_maximized_result (elapsed > 0.0 ? n_accesses / elapsed : 0.0, "fields: %.1f accesses/s", n_accesses / elapsed);
+
+	g_timer_destroy (timer);
+	g_ptr_array_unref (contacts);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	GOptionContext *context;
+	gint ret;
+
+	/* the unknown options are left for the g_test_init() */
+	context = g_option_context_new (NULL);
+	g_option_context_add_main_entries (context, entries, NULL);
+	g_option_context_set_ignore_unknown_options (context, TRUE);
+	g_option_context_set_help_enabled (context, FALSE);
+	g_option_context_parse (context, &argc, &argv, NULL);
+	g_option_context_free (context);
+
+	g_test_init (&argc, &argv, NULL);
+	g_test_bug_base ("https://gitlab.gnome.org/GNOME/evolution-data-server/");
+
+	if (option_vcards > 0)
+		n_vcards = option_vcards;
+	else
+		n_vcards = g_test_perf () ? 50000 : 2000;
+
+	benchmark_gen_vcards ();
+
+	g_test_add_func ("/EVCard/Benchmark/ReadParse", test_read_parse);
+	g_test_add_func ("/EVCard/Benchmark/ReadSerialized", test_read_serialized);
+	g_test_add_func ("/EVCard/Benchmark/ParseExports", test_parse_exports);
+	g_test_add_func ("/EVCard/Benchmark/FieldAccess", test_field_access);
+
+	ret = g_test_run ();
+
+	g_ptr_array_unref (vcards);
+	g_ptr_array_unref (serialized);
+
+	return ret;
+}
@@ -2257,6 +2257,242 @@ test_misc_add_attributes (void)
 	g_clear_object (&vcard);
 }
 
+static void
+test_vcard_lines (void)
+{
+	const gchar *vcard_str =
+		"BEGIN:VCARD\r\n"
+		"VERSION:3.0\r\n"
+		"F\r\n"
+		" N:Folded\r\n"
+		"\tName\r\n"
+		"N:Fam\\;ily;Giv\\,en;;;\r\n"
+		"CATEGORIES:One,Tw\\,o,Three\\;\r\n"
+		"TEL;WORK;VOICE;TYPE=pref:+1 221 555 0101\r\n"
+		"item2.EMAIL;TYPE=home;X-EVOLUTION-UI-SLOT=1;TYPE=internet,HOME:home@no.where\r\n"
+		"X-EMPTY;;X-PARAM=a:;\r\n"
+		"PHOTO;BASE64;TYPE=PNG:aGVs\r\n"
+		" bG8=\r\n"
+		"NOTE:Line\\nand \\x\\\\\r\n"
+		"X-BACKSLASH:ends with\\\r\n"
+		"END:VCARD\r\n";
+	EVCard *vcard;
+	EVCardAttribute *attr;
+	GList *values;
+	GString *value;
+
+	vcard = e_vcard_new_from_string (vcard_str);
+
+	verify_attr_simple ("FN", "FoldedName");
+
+	attr = e_vcard_get_attribute (vcard, EVC_N);
+	g_assert_nonnull (attr);
+	g_assert_cmpstr (e_vcard_attribute_get_nth_value (attr, 0), ==, "Fam;ily");
+	g_assert_cmpstr (e_vcard_attribute_get_nth_value (attr, 1), ==, "Giv,en");
+	g_assert_cmpuint (g_list_length (e_vcard_attribute_get_values (attr)), ==, 5);
+
+	attr = e_vcard_get_attribute (vcard, EVC_CATEGORIES);
+	g_assert_nonnull (attr);
+	values = e_vcard_attribute_get_values (attr);
+	g_assert_cmpuint (g_list_length (values), ==, 3);
+	g_assert_cmpstr (values->data, ==, "One");
+	g_assert_cmpstr (values->next->data, ==, "Tw,o");
+	g_assert_cmpstr (values->next->next->data, ==, "Three;");
+
+	attr = e_vcard_get_attribute (vcard, EVC_TEL);
+	g_assert_nonnull (attr);
+	g_assert_true (e_vcard_attribute_has_type (attr, "WORK"));
+	g_assert_true (e_vcard_attribute_has_type (attr, "VOICE"));
+	g_assert_true (e_vcard_attribute_has_type (attr, "PREF"));
+	g_assert_cmpuint (g_list_length (e_vcard_attribute_get_params (attr)), ==, 1);
+
+	/* the same parameters are merged */
+	attr = e_vcard_get_attribute (vcard, EVC_EMAIL);
+	g_assert_nonnull (attr);
+	g_assert_cmpstr (e_vcard_attribute_get_group (attr), ==, "item2");
+	g_assert_cmpuint (g_list_length (e_vcard_attribute_get_param (attr, EVC_TYPE)), ==, 2);
+	g_assert_cmpuint (g_list_length (e_vcard_attribute_get_params (attr)), ==, 2);
+	g_assert_cmpstr (e_vcard_attribute_get_nth_value (attr, 0), ==, "home@no.where");
+
+	attr = e_vcard_get_attribute (vcard, "X-EMPTY");
+	g_assert_nonnull (attr);
+	g_assert_cmpuint (g_list_length (e_vcard_attribute_get_params (attr)), ==, 1);
+	g_assert_cmpuint (g_list_length (e_vcard_attribute_get_values (attr)), ==, 2);
+	g_assert_cmpstr (e_vcard_attribute_get_nth_value (attr, 0), ==, "");
+	g_assert_cmpstr (e_vcard_attribute_get_nth_value (attr, 1), ==, "");
+
+	attr = e_vcard_get_attribute (vcard, EVC_PHOTO);
+	g_assert_nonnull (attr);
+	g_assert_cmpstr (e_vcard_attribute_get_nth_value (attr, 0), ==, "aGVsbG8=");
+	value = e_vcard_attribute_get_value_decoded (attr);
+	g_assert_nonnull (value);
+	g_assert_cmpstr (value->str, ==, "hello");
+	g_string_free (value, TRUE);
+
+	verify_attr_simple ("NOTE", "Line\nand \\x\\");
+
+	attr = e_vcard_get_attribute (vcard, "X-BACKSLASH");
+	g_assert_nonnull (attr);
+	g_assert_true (g_str_has_prefix (e_vcard_attribute_get_nth_value (attr, 0), "ends with\\"));
+
+	g_assert_cmpuint (g_list_length (e_vcard_get_attributes (vcard)), ==, 10);
+
+	g_object_unref (vcard);
+}
+
+static void
+test_vcard_attribute_index (void)
+{
+	EVCard *vcard;
+	EVCardAttribute *attr, *first_email;
+
+	vcard = e_vcard_new_from_string (
+		"BEGIN:VCARD\r\n"
+		"VERSION:3.0\r\n"
+		"FN:Full Name\r\n"
+		"EMAIL:first@no.where\r\n"
+		"email:second@no.where\r\n"
+		"END:VCARD\r\n");
+
+	/* the first of the attributes, regardless of the letter case */
+	first_email = e_vcard_get_attribute (vcard, "Email");
+	g_assert_nonnull (first_email);
+	g_assert_cmpstr (e_vcard_attribute_get_nth_value (first_email, 0), ==, "first@no.where");
+	g_assert_true (e_vcard_get_attribute (vcard, EVC_EMAIL) == first_email);
+	g_assert_true (e_vcard_get_attribute_if_parsed (vcard, "email") == first_email);
+	g_assert_null (e_vcard_get_attribute (vcard, "X-NOT-THERE-AT-ALL"));
+
+	/* appended attribute does not replace the first one */
+	e_vcard_append_attribute_with_value (vcard, e_vcard_attribute_new (NULL, EVC_EMAIL), "third@no.where");
+	g_assert_true (e_vcard_get_attribute (vcard, EVC_EMAIL) == first_email);
+
+	e_vcard_append_attribute_with_value (vcard, e_vcard_attribute_new (NULL, "x-new-attr"), "value");
+	verify_attr_simple ("X-NEW-ATTR", "value");
+
+	/* added attribute is the first one */
+	attr = e_vcard_attribute_new (NULL, EVC_EMAIL);
+	e_vcard_add_attribute_with_value (vcard, attr, "zero@no.where");
+	g_assert_true (e_vcard_get_attribute (vcard, EVC_EMAIL) == attr);
+
+	e_vcard_remove_attribute (vcard, attr);
+	g_assert_true (e_vcard_get_attribute (vcard, EVC_EMAIL) == first_email);
+
+	e_vcard_remove_attribute (vcard, first_email);
+	verify_attr_simple ("EMAIL", "second@no.where");
+
+	e_vcard_remove_attributes (vcard, NULL, EVC_EMAIL);
+	g_assert_null (e_vcard_get_attribute (vcard, EVC_EMAIL));
+	verify_attr_simple ("FN", "Full Name");
+
+	g_object_unref (vcard);
+}
+
+static void
+test_vcard_serialized (void)
+{
+	const gchar *vcard_str =
+		"BEGIN:VCARD\r\n"
+		"VERSION:3.0\r\n"
+		"UID:some-uid\r\n"
+		"FN:Full\\, Name\r\n"
+		"N:Name;Full;;;\r\n"
+		"item1.EMAIL;TYPE=WORK,PREF;X-CUSTOM=\"a;b\":work@no.where\r\n"
+		"TEL;TYPE=CELL:+1 221 555\r\n"
+		" 0101\r\n"
+		"NOTE;ENCODING=QUOTED-PRINTABLE;CHARSET=UTF-8:Long=0Anote\r\n"
+		"PHOTO;ENCODING=b;TYPE=PNG:aGVsbG8=\r\n"
+		"item2.LOGO;VALUE=uri:https://no.where/logo.png\r\n"
+		"item2.LOGO;ENCODING=b;TYPE=PNG:bG9n\r\n"
+		" bw==\r\n"
+		"ADR;TYPE=HOME:;;Street 1;City;;12345;Country\r\n"
+		"END:VCARD";
+	EVCard *vc1, *vc2;
+	GList *attrs;
+	GString *decoded;
+	gchar *serialized, *serialized2, *str1, *str2;
+
+	vc1 = e_vcard_new_from_string (vcard_str);
+	serialized = e_vcard_serialize (vc1);
+	g_assert_nonnull (serialized);
+	g_assert_true (e_vcard_is_parsed (vc1));
+
+	/* The binary values are not stored twice */
+	g_assert_null (strstr (serialized, "aGVsbG8="));
+	g_assert_null (strstr (serialized, "bG9n"));
+	g_assert_nonnull (strstr (serialized, "https://no.where/logo.png"));
+
+	/* The attributes are read from the serialized form only when needed */
+	vc2 = e_vcard_new ();
+	e_vcard_construct_serialized (vc2, vcard_str, serialized, NULL);
+	g_assert_false (e_vcard_is_parsed (vc2));
+	str1 = e_vcard_to_string (vc2);
+	g_assert_cmpstr (str1, ==, vcard_str);
+	g_free (str1);
+	g_assert_false (e_vcard_is_parsed (vc2));
+
+	g_assert_true (compare_single_value (vc2, "FN", "Full, Name"));
+	g_assert_true (e_vcard_is_parsed (vc2));
+	g_assert_true (compare_single_value (vc2, "UID", "some-uid"));
+	g_assert_true (compare_single_value (vc2, "TEL", "+1 221 5550101"));
+	g_assert_true (compare_single_value (vc2, "NOTE", "Long\nnote"));
+	g_assert_cmpstr (e_vcard_attribute_get_group (e_vcard_get_attribute (vc2, "EMAIL")), ==, "item1");
+	g_assert_true (e_vcard_attribute_has_type (e_vcard_get_attribute (vc2, "EMAIL"), "PREF"));
+	g_assert_cmpint (e_vcard_get_version (vc2), ==, E_VCARD_VERSION_30);
+
+	/* The binary attributes are read from the vCard, in the right place */
+	decoded = e_vcard_attribute_get_value_decoded (e_vcard_get_attribute (vc2, "PHOTO"));
+	g_assert_nonnull (decoded);
+	g_assert_cmpstr (decoded->str, ==, "hello");
+	g_string_free (decoded, TRUE);
+
+	attrs = e_vcard_get_attributes (vc2);
+	while (attrs && g_strcmp0 (e_vcard_attribute_get_name (attrs->data), "LOGO") != 0) {
+		attrs = g_list_next (attrs);
+	}
+	g_assert_nonnull (attrs);
+	g_assert_true (compare_single_value (vc2, "LOGO", "https://no.where/logo.png"));
+	g_assert_nonnull (g_list_next (attrs));
+	g_assert_cmpstr (e_vcard_attribute_get_group (g_list_next (attrs)->data), ==, "item2");
+	decoded = e_vcard_attribute_get_value_decoded (g_list_next (attrs)->data);
+	g_assert_nonnull (decoded);
+	g_assert_cmpstr (decoded->str, ==, "logo");
+	g_string_free (decoded, TRUE);
+
+	serialized2 = e_vcard_serialize (vc2);
+	g_assert_cmpstr (serialized2, ==, serialized);
+	g_free (serialized2);
+
+	str1 = e_vcard_to_string (vc1);
+	str2 = e_vcard_to_string (vc2);
+	g_assert_cmpstr (str1, ==, str2);
+	g_free (str1);
+	g_free (str2);
+
+	g_object_unref (vc2);
+
+	/* The UID argument replaces the UID from the serialized form */
+	vc2 = e_vcard_new ();
+	e_vcard_construct_serialized (vc2, vcard_str, serialized, "other-uid");
+	g_assert_true (compare_single_value (vc2, "UID", "other-uid"));
+	g_assert_false (e_vcard_is_parsed (vc2));
+	g_assert_true (compare_single_value (vc2, "FN", "Full, Name"));
+	g_assert_true (has_only_one (vc2, "UID"));
+	g_assert_true (compare_single_value (vc2, "UID", "other-uid"));
+	g_object_unref (vc2);
+
+	/* Invalid serialized form means to parse the vCard */
+	vc2 = e_vcard_new ();
+	e_vcard_construct_serialized (vc2, vcard_str, "EVCS1:5:group3:FN", NULL);
+	g_assert_true (compare_single_value (vc2, "FN", "Full, Name"));
+	serialized2 = e_vcard_serialize (vc2);
+	g_assert_cmpstr (serialized2, ==, serialized);
+	g_free (serialized2);
+	g_object_unref (vc2);
+
+	g_object_unref (vc1);
+	g_free (serialized);
+}
+
 gint
 main (gint argc,
       gchar **argv)
@@ -2270,6 +2506,9 @@ main (gint argc,
 	g_test_add_func ("/Parsing/VCard/Charset", test_vcard_charset);
 	g_test_add_func ("/Parsing/VCard/CharsetMixed", test_vcard_charset_mixed);
 	g_test_add_func ("/Parsing/VCard/CharsetBroken", test_vcard_charset_broken);
+	g_test_add_func ("/Parsing/VCard/Lines", test_vcard_lines);
+	g_test_add_func ("/Parsing/VCard/AttributeIndex", test_vcard_attribute_index);
+	g_test_add_func ("/Parsing/VCard/Serialized", test_vcard_serialized);
 	g_test_add_func ("/Parsing/Contact/WithUID", test_contact_with_uid);
 	g_test_add_func ("/Parsing/Contact/WithoutUID", test_contact_without_uid);
 	g_test_add_func ("/Parsing/Contact/EmptyValue", test_contact_empty_value);
@@ -92,6 +92,232 @@ test_search (TCUFixture *fixture,
 	test_search_phone (fixture, "custom-1");
 }
 
+static gboolean
+read_stored_object_cb (ECache *cache,
+		       gint ncols,
+		       const gchar **column_names,
+		       const gchar **column_values,
+		       gpointer user_data)
+{
+	gchar **pvalue = user_data;
+
+	g_assert_cmpint (ncols, ==, 1);
+
+	if (!*pvalue)
+		*pvalue = g_strdup (column_values[0]);
+
+	return TRUE;
+}
+
+static void
+test_compression_check_stored (TCUFixture *fixture,
+			       const gchar *uid,
+			       gboolean expect_compressed)
+{
+	EContact *contact = NULL;
+	gchar *stored_object = NULL, *object = NULL, *vcard = NULL, *serialized = NULL, *stmt;
+	GError *error = NULL;
+
+	/* not aliased, thus decompressed */
+	stmt = e_cache_sqlite_stmt_printf ("SELECT " E_CACHE_COLUMN_OBJECT " FROM " E_CACHE_TABLE_OBJECTS
+		" WHERE " E_CACHE_COLUMN_UID "=%Q", uid);
+	g_assert_true (e_cache_sqlite_select (E_CACHE (fixture->book_cache), stmt, read_stored_object_cb, &object, NULL, &error));
+	g_assert_no_error (error);
+	e_cache_sqlite_stmt_free (stmt);
+
+	stmt = e_cache_sqlite_stmt_printf ("SELECT " E_CACHE_COLUMN_OBJECT " AS stored FROM " E_CACHE_TABLE_OBJECTS
+		" WHERE " E_CACHE_COLUMN_UID "=%Q", uid);
+	g_assert_true (e_cache_sqlite_select (E_CACHE (fixture->book_cache), stmt, read_stored_object_cb, &stored_object, NULL, &error));
+	g_assert_no_error (error);
+	e_cache_sqlite_stmt_free (stmt);
+
+	g_assert_nonnull (object);
+	g_assert_nonnull (stored_object);
+	g_assert_cmpint (e_cache_object_is_compressed (object) ? 1 : 0, ==, 0);
+	g_assert_cmpint (e_cache_object_is_compressed (stored_object) ? 1 : 0, ==, expect_compressed ? 1 : 0);
+
+	/* the serialized contact follows the compression of the object */
+	stmt = e_cache_sqlite_stmt_printf ("SELECT serialized FROM " E_CACHE_TABLE_OBJECTS
+		" WHERE " E_CACHE_COLUMN_UID "=%Q", uid);
+	g_assert_true (e_cache_sqlite_select (E_CACHE (fixture->book_cache), stmt, read_stored_object_cb, &serialized, NULL, &error));
+	g_assert_no_error (error);
+	e_cache_sqlite_stmt_free (stmt);
+
+	g_assert_nonnull (serialized);
+	g_assert_cmpint (e_cache_object_is_compressed (serialized) ? 1 : 0, ==, expect_compressed ? 1 : 0);
+
+	g_assert_true (e_book_cache_get_vcard (fixture->book_cache, uid, FALSE, &vcard, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_cmpstr (vcard, ==, object);
+
+	g_free (object);
+	object = e_cache_decompress_object (E_CACHE (fixture->book_cache), stored_object);
+	g_assert_cmpstr (vcard, ==, object);
+
+	g_assert_true (e_book_cache_get_contact (fixture->book_cache, uid, FALSE, &contact, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_cmpstr (e_contact_get_const (contact, E_CONTACT_UID), ==, uid);
+	g_assert_true (g_str_has_prefix (e_contact_get_const (contact, E_CONTACT_NOTE), "A note of the generated contact"));
+
+	g_clear_object (&contact);
+	g_free (serialized);
+	g_free (stored_object);
+	g_free (object);
+	g_free (vcard);
+}
+
+static void
+test_compression_put_contact (TCUFixture *fixture,
+			      guint index)
+{
+	EContact *contact;
+	GError *error = NULL;
+	gchar *vcard;
+
+	vcard = g_strdup_printf (
+		"BEGIN:VCARD\r\n"
+		"VERSION:3.0\r\n"
+		"UID:generated-%u\r\n"
+		"FN:Given%u Family%u\r\n"
+		"N:Family%u;Given%u;;;\r\n"
+		"EMAIL;TYPE=WORK:given%u.family%u@example.com\r\n"
+		"TEL;TYPE=CELL:+49 30 555 %04u\r\n"
+		"NOTE:A note of the generated contact number %u, long enough to have also the serialized contact compressed\r\n"
+		"END:VCARD",
+		index, index, index, index, index, index, index, index, index);
+
+	contact = e_contact_new_from_vcard (vcard);
+
+	if (!e_book_cache_put_contact (fixture->book_cache, contact, NULL, 0, E_CACHE_IS_ONLINE, NULL, &error))
+		g_error ("Failed to put contact: %s", error->message);
+
+	g_object_unref (contact);
+	g_free (vcard);
+}
+
+static void
+test_compression (TCUFixture *fixture,
+		  gconstpointer user_data)
+{
+	GError *error = NULL;
+	guint ii;
+
+	g_assert_false (e_cache_get_compress_objects (E_CACHE (fixture->book_cache)));
+
+	tcu_add_contact_from_test_case (fixture, "simple-1", NULL);
+	tcu_add_contact_from_test_case (fixture, "custom-1", NULL);
+
+	/* enough of them to train the dictionary from */
+	for (ii = 0; ii < 32; ii++) {
+		test_compression_put_contact (fixture, ii);
+	}
+
+	test_compression_check_stored (fixture, "generated-7", FALSE);
+
+	g_assert_true (e_cache_set_compress_objects_sync (E_CACHE (fixture->book_cache), TRUE, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_true (e_cache_get_compress_objects (E_CACHE (fixture->book_cache)));
+
+	test_compression_check_stored (fixture, "generated-7", TRUE);
+
+	/* the empty summary uses the vCard for the searches */
+	test_search_result (fixture, "(exists \"wants_html\")", "simple-1");
+	test_search_result (fixture, "(contains \"email\" \"given7.family7\")", "generated-7");
+	test_search_phone (fixture, "custom-1");
+
+	/* newly stored */
+	test_compression_put_contact (fixture, 100);
+	test_compression_check_stored (fixture, "generated-100", TRUE);
+
+	g_assert_true (e_cache_set_compress_objects_sync (E_CACHE (fixture->book_cache), FALSE, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_false (e_cache_get_compress_objects (E_CACHE (fixture->book_cache)));
+
+	test_compression_check_stored (fixture, "generated-7", FALSE);
+	test_compression_check_stored (fixture, "generated-100", FALSE);
+	test_search_result (fixture, "(contains \"email\" \"given7.family7\")", "generated-7");
+	test_search_phone (fixture, "custom-1");
+}
+
+static gboolean
+test_prepared_stmts_count_cb (ECache *cache,
+			      gint ncols,
+			      const gchar **column_names,
+			      const gchar **column_values,
+			      gpointer user_data)
+{
+	guint *pcount = user_data;
+
+	*pcount = *pcount + 1;
+
+	return TRUE;
+}
+
+static void
+test_prepared_stmts (TCUFixture *fixture,
+		     gconstpointer user_data)
+{
+	ECache *cache = E_CACHE (fixture->book_cache);
+	ECacheStmt *held_select, *held_count, *stmt;
+	GError *error = NULL;
+	guint ii, count = 0;
+	gboolean success;
+
+	tcu_add_contact_from_test_case (fixture, "simple-1", NULL);
+	tcu_add_contact_from_test_case (fixture, "simple-2", NULL);
+
+	e_cache_lock (cache, E_CACHE_LOCK_READ);
+
+	/* prepared, but not executed yet */
+	held_select = e_cache_stmt_prepare (cache, "SELECT " E_CACHE_COLUMN_UID " FROM " E_CACHE_TABLE_OBJECTS
+		" WHERE " E_CACHE_COLUMN_UID "=?", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (held_select);
+	e_cache_stmt_bind_text (held_select, 1, "simple-1");
+
+	held_count = e_cache_stmt_prepare (cache, "SELECT " E_CACHE_COLUMN_UID " FROM " E_CACHE_TABLE_OBJECTS, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (held_count);
+
+	/* many more statements than the cache keeps, some of them used repeatedly */
+	for (ii = 0; ii < 300; ii++) {
+		gchar *sql;
+		guint value = 0;
+
+		sql = g_strdup_printf ("SELECT %u + ?", ii % 150);
+
+		stmt = e_cache_stmt_prepare (cache, sql, &error);
+		g_assert_no_error (error);
+		g_assert_nonnull (stmt);
+
+		e_cache_stmt_bind_int (stmt, 1, 1);
+
+		success = e_cache_stmt_select (cache, stmt, test_prepared_stmts_count_cb, &value, NULL, &error);
+		g_assert_no_error (error);
+		g_assert_true (success);
+		g_assert_cmpuint (value, ==, 1);
+
+		g_free (sql);
+	}
+
+	/* the held statements were not finalized and kept their parameters */
+	success = e_cache_stmt_select (cache, held_select, test_prepared_stmts_count_cb, &count, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+	g_assert_cmpuint (count, ==, 1);
+
+	count = 0;
+	success = e_cache_stmt_select (cache, held_count, test_prepared_stmts_count_cb, &count, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+	g_assert_cmpuint (count, ==, 2);
+
+	e_cache_unlock (cache, E_CACHE_UNLOCK_NONE);
+
+	/* and the cache still works after the evictions */
+	test_get_contact (fixture, user_data);
+}
+
 static TCUClosure closures[] = {
 	{ NULL },
 	{ tcu_setup_empty_book },
@@ -127,5 +353,12 @@ main (gint argc,
 			tcu_fixture_setup, ii < 2 ? test_get_contact : test_search, tcu_fixture_teardown);
 	}
 
+	g_test_add (
+		"/EBookCache/EmptySummary/Compression", TCUFixture, &closures[1],
+		tcu_fixture_setup, test_compression, tcu_fixture_teardown);
+	g_test_add (
+		"/EBookCache/DefaultSummary/PreparedStatements", TCUFixture, &closures[0],
+		tcu_fixture_setup, test_prepared_stmts, tcu_fixture_teardown);
+
 	return e_test_server_utils_run_full (argc, argv, 0);
 }
@@ -0,0 +1,175 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+/* A benchmark of storing contacts into the EBookCache. It stores a set
+ * of generated contacts one by one, each in its own transaction, like
+ * the backends did before, and then all at once with e_book_cache_put_contacts(),
+ * like on the initial synchronization of a large address book, and reports
+ * the contacts per second for both.
+ *
+ * Run it in the performance mode, to store 30000 contacts:
+ *
+ *    test-book-cache-put-benchmark -m perf [--contacts N]
+ */
+
+#include <stdlib.h>
+#include <locale.h>
+#include <libebook/libebook.h>
+
+#include "e-test-server-utils.h"
+#include "test-book-cache-utils.h"
+
+static guint n_contacts = 0;
+
+static GSList *
+benchmark_gen_contacts (const gchar *uid_prefix)
+{
+	GSList *contacts = NULL;
+	guint ii;
+
+	for (ii = 0; ii < n_contacts; ii++) {
+		EContact *contact;
+		gchar *vcard;
+
+		vcard = g_strdup_printf (
+			"BEGIN:VCARD\r\n"
+			"VERSION:3.0\r\n"
+			"UID:%s-%u\r\n"
+			"REV:2026-01-01T00:00:%02uZ\r\n"
+			"FN:Given%u Family%u\r\n"
+			"N:Family%u;Given%u;;;\r\n"
+			"EMAIL;TYPE=WORK:given%u.family%u@example.com\r\n"
+			"EMAIL;TYPE=HOME:g%u@home.example.org\r\n"
+			"TEL;TYPE=CELL:+1 221 555 %04u\r\n"
+			"TEL;TYPE=WORK:+1 221 556 %04u\r\n"
+			"ORG:Company %u;Department %u\r\n"
+			"NOTE:A note of the contact number %u\r\n"
+			"END:VCARD",
+			uid_prefix, ii, ii % 60, ii, ii, ii, ii, ii, ii, ii,
+			ii % 10000, ii % 10000, ii % 100, ii % 7, ii);
+
+		contact = e_contact_new_from_vcard (vcard);
+		g_assert_nonnull (contact);
+
+		contacts = g_slist_prepend (contacts, contact);
+
+		g_free (vcard);
+	}
+
+	return g_slist_reverse (contacts);
+}
+
+static void
+benchmark_report (const gchar *label,
+		  gdouble elapsed)
+{
+	g_test_message ("%-12s %8u contacts  %8.3f s  (%10.1f contacts/s)",
+		label, n_contacts, elapsed, elapsed > 0.0 ? n_contacts / elapsed : 0.0);
+
+	if (g_test_perf ())
+		g_test_maximized_result (elapsed > 0.0 ? n_contacts / elapsed : 0.0, "%s: %.1f contacts/s", label, n_contacts / elapsed);
+}
+
+static void
+benchmark_verify_count (TCUFixture *fixture)
+{
+	GError *error = NULL;
+	guint count;
+
+	count = e_cache_get_count (E_CACHE (fixture->book_cache), E_CACHE_EXCLUDE_DELETED, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (count, ==, n_contacts);
+}
+
+static void
+test_put_one_by_one (TCUFixture *fixture,
+		     gconstpointer user_data)
+{
+	GSList *contacts, *link;
+	GTimer *timer;
+	GError *error = NULL;
+
+	contacts = benchmark_gen_contacts ("single");
+
+	timer = g_timer_new ();
+
+	for (link = contacts; link; link = g_slist_next (link)) {
+		if (!e_book_cache_put_contact (fixture->book_cache, link->data, NULL, 0, E_CACHE_IS_ONLINE, NULL, &error))
+			g_error ("Failed to put contact: %s", error->message);
+	}
+
+	g_timer_stop (timer);
+
+	benchmark_report ("one by one", g_timer_elapsed (timer, NULL));
+	benchmark_verify_count (fixture);
+
+	g_timer_destroy (timer);
+	g_slist_free_full (contacts, g_object_unref);
+}
+
+static void
+test_put_bulk (TCUFixture *fixture,
+	       gconstpointer user_data)
+{
+	GSList *contacts;
+	GTimer *timer;
+	GError *error = NULL;
+
+	contacts = benchmark_gen_contacts ("bulk");
+
+	timer = g_timer_new ();
+
+	if (!e_book_cache_put_contacts (fixture->book_cache, contacts, NULL, NULL, E_CACHE_IS_ONLINE, NULL, &error))
+		g_error ("Failed to put contacts: %s", error->message);
+
+	g_timer_stop (timer);
+
+	benchmark_report ("bulk", g_timer_elapsed (timer, NULL));
+	benchmark_verify_count (fixture);
+
+	/* storing the same contacts again replaces them */
+	if (!e_book_cache_put_contacts (fixture->book_cache, contacts, NULL, NULL, E_CACHE_IS_ONLINE, NULL, &error))
+		g_error ("Failed to put contacts: %s", error->message);
+
+	benchmark_verify_count (fixture);
+
+	g_timer_destroy (timer);
+	g_slist_free_full (contacts, g_object_unref);
+}
+
+static TCUClosure closure = { NULL };
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	gint ii;
+
+	g_test_init (&argc, &argv, NULL);
+	g_test_bug_base ("https://gitlab.gnome.org/GNOME/evolution-data-server/");
+
+	tcu_read_args (argc, argv);
+
+	for (ii = 1; ii < argc; ii++) {
+		if (g_strcmp0 (argv[ii], "--contacts") == 0 && ii + 1 < argc) {
+			n_contacts = (guint) g_ascii_strtoull (argv[ii + 1], NULL, 10);
+			ii++;
+		}
+	}
+
+	if (!n_contacts)
+		n_contacts = g_test_perf () ? 30000 : 2000;
+
+	/* Ensure that the client and server get the same locale */
+	g_assert_true (g_setenv ("LC_ALL", "en_US.UTF-8", TRUE));
+	setlocale (LC_ALL, "");
+
+	g_test_add ("/EBookCache/PutBenchmark/OneByOne", TCUFixture, &closure,
+		tcu_fixture_setup, test_put_one_by_one, tcu_fixture_teardown);
+	g_test_add ("/EBookCache/PutBenchmark/Bulk", TCUFixture, &closure,
+		tcu_fixture_setup, test_put_bulk, tcu_fixture_teardown);
+
+	return e_test_server_utils_run_full (argc, argv, 0);
+}
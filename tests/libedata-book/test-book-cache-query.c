@@ -567,11 +567,85 @@ test_book_cache_query_contains_phone (TCUFixture *fixture,
 	g_clear_pointer (&contacts, g_ptr_array_unref);
 }
 
+static ESourceBackendSummarySetup *
+setup_substring_summary (void)
+{
+	ESourceBackendSummarySetup *setup;
+
+	setup = tcu_setup_empty_book ();
+
+	e_source_backend_summary_setup_set_summary_fields (setup,
+		E_CONTACT_FULL_NAME,
+		E_CONTACT_NICKNAME,
+		E_CONTACT_EMAIL,
+		0);
+
+	e_source_backend_summary_setup_set_indexed_fields (setup,
+		E_CONTACT_FULL_NAME, E_BOOK_INDEX_SUBSTRING,
+		E_CONTACT_FULL_NAME, E_BOOK_INDEX_PREFIX,
+		E_CONTACT_EMAIL, E_BOOK_INDEX_SUBSTRING,
+		0);
+
+	return setup;
+}
+
+static void
+assert_query_count (TCUFixture *fixture,
+		    const gchar *sexp,
+		    guint expected)
+{
+	guint n_total = G_MAXUINT;
+	gboolean success;
+	GError *error = NULL;
+
+	success = e_book_cache_count_query (fixture->book_cache, sexp, &n_total, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (success);
+	g_assert_cmpuint (n_total, ==, expected);
+}
+
+static void
+test_book_cache_query_substring (TCUFixture *fixture,
+				 gconstpointer user_data)
+{
+	GError *error = NULL;
+
+	tcu_add_contact_from_test_case (fixture, "custom-1", NULL);
+	tcu_add_contact_from_test_case (fixture, "custom-2", NULL);
+	tcu_add_contact_from_test_case (fixture, "custom-3", NULL);
+
+	assert_query_count (fixture, "(contains \"full_name\" \"ACKSO\")", 2);
+	assert_query_count (fixture, "(contains \"full_name\" \"by br\")", 1);
+	assert_query_count (fixture, "(contains \"full_name\" \"xyz\")", 0);
+	/* too short for the substring index */
+	assert_query_count (fixture, "(contains \"full_name\" \"ja\")", 2);
+	/* not indexed */
+	assert_query_count (fixture, "(contains \"nickname\" \"ackso\")", 2);
+	/* the second value of a multi-valued field */
+	assert_query_count (fixture, "(contains \"email\" \"brown.com\")", 1);
+	assert_query_count (fixture, "(contains \"email\" \"nny@j\")", 1);
+	assert_query_count (fixture, "(or (contains \"email\" \"brown\") (contains \"full_name\" \"janet\"))", 2);
+	assert_query_count (fixture, "(and (contains \"email\" \"jackson\") (not (contains \"full_name\" \"janet\")))", 1);
+
+	g_assert_true (e_book_cache_remove_contact (fixture->book_cache, "custom-2", 0, E_CACHE_IS_ONLINE, NULL, &error));
+	g_assert_no_error (error);
+
+	assert_query_count (fixture, "(contains \"full_name\" \"ackso\")", 1);
+	assert_query_count (fixture, "(contains \"email\" \"nny@j\")", 0);
+
+	/* re-adding the contact indexes it again */
+	tcu_add_contact_from_test_case (fixture, "custom-2", NULL);
+
+	assert_query_count (fixture, "(contains \"full_name\" \"ackso\")", 2);
+	assert_query_count (fixture, "(contains \"email\" \"nny@j\")", 1);
+}
+
 gint
 main (gint argc,
       gchar **argv)
 {
 	TCUClosure closure = { NULL };
+	TCUClosure closure_substring = { setup_substring_summary };
 
 	g_test_init (&argc, &argv, NULL);
 	g_test_bug_base ("https://gitlab.gnome.org/GNOME/evolution-data-server/");
@@ -590,6 +664,8 @@ main (gint argc,
 		tcu_fixture_setup, test_book_cache_query_contains_nickname, tcu_fixture_teardown);
 	g_test_add ("/EBookCache/QueryContainsPhone", TCUFixture, &closure,
 		tcu_fixture_setup, test_book_cache_query_contains_phone, tcu_fixture_teardown);
+	g_test_add ("/EBookCache/QuerySubstring", TCUFixture, &closure_substring,
+		tcu_fixture_setup, test_book_cache_query_substring, tcu_fixture_teardown);
 
 	return e_test_server_utils_run_full (argc, argv, 0);
 }
@@ -305,6 +305,24 @@ test_search_contains (TCUFixture *fixture,
 	test_search (fixture, "(contains? \"priority\" \"NORMAL\")", searches_events ? NULL : "task-6");
 	test_search (fixture, "(contains? \"priority\" \"LOW\")", searches_events ? NULL : "task-5");
 	test_search (fixture, "(contains? \"priority\" \"UNDEFINED\")", searches_events ? NULL : "task-1");
+	test_search (fixture, "(contains? \"any\" \"kitchen\")", searches_events ? "event-3" : "task-5");
+	/* too short for the text index */
+	test_search (fixture, "(contains? \"summary\" \"me\")", searches_events ? "event-8" : NULL);
+	test_search (fixture, "(contains? \"any\" \"ki\")", searches_events ? "event-3" : "task-5");
+
+	if (searches_events) {
+		GError *error = NULL;
+
+		g_assert_true (e_cal_cache_remove_component (fixture->cal_cache, "event-3", NULL, 0, E_CACHE_IS_ONLINE, NULL, &error));
+		g_assert_no_error (error);
+
+		test_search (fixture, "(contains? \"location\" \"kitchen\")", "!event-3");
+		test_search (fixture, "(contains? \"any\" \"kitchen\")", "!event-3");
+
+		tcu_add_component_from_test_case (fixture, "event-3", NULL);
+
+		test_search (fixture, "(contains? \"location\" \"kitchen\")", "event-3");
+	}
 }
 
 static void
@@ -464,6 +482,411 @@ test_search_starts_before (TCUFixture *fixture,
 	test_search (fixture, "(starts-before? (make-time \"20170214T000000Z\"))", "task-9");
 }
 
+typedef struct _ReadersData {
+	ECache *cache;
+	GMutex lock;
+	GCond cond;
+	gboolean locked;
+	gboolean done;
+} ReadersData;
+
+static gpointer
+test_search_readers_thread (gpointer user_data)
+{
+	ReadersData *rd = user_data;
+
+	e_cache_lock (rd->cache, E_CACHE_LOCK_WRITE);
+
+	g_mutex_lock (&rd->lock);
+	rd->locked = TRUE;
+	g_cond_signal (&rd->cond);
+	while (!rd->done)
+		g_cond_wait (&rd->cond, &rd->lock);
+	g_mutex_unlock (&rd->lock);
+
+	e_cache_unlock (rd->cache, E_CACHE_UNLOCK_ROLLBACK);
+
+	return NULL;
+}
+
+static void
+test_search_readers (TCUFixture *fixture,
+		     gconstpointer user_data)
+{
+	ReadersData rd;
+	GThread *thread;
+	GError *error = NULL;
+
+	g_assert_true (e_cache_enable_wal_sync (E_CACHE (fixture->cal_cache), 2, NULL, &error));
+	g_assert_no_error (error);
+
+	rd.cache = E_CACHE (fixture->cal_cache);
+	rd.locked = FALSE;
+	rd.done = FALSE;
+	g_mutex_init (&rd.lock);
+	g_cond_init (&rd.cond);
+
+	/* another thread holds a write transaction, the searches
+	   cannot use the main connection meanwhile */
+	thread = g_thread_new ("readers-thread", test_search_readers_thread, &rd);
+
+	g_mutex_lock (&rd.lock);
+	while (!rd.locked)
+		g_cond_wait (&rd.cond, &rd.lock);
+	g_mutex_unlock (&rd.lock);
+
+	test_search (fixture, "(uid? \"event-3\")", "event-3");
+	test_search (fixture, "(contains? \"summary\" \"meet\")", "event-8");
+	test_search (fixture, "(contains? \"any\" \"party\")", "event-5");
+
+	g_mutex_lock (&rd.lock);
+	rd.done = TRUE;
+	g_cond_signal (&rd.cond);
+	g_mutex_unlock (&rd.lock);
+
+	g_thread_join (thread);
+
+	g_mutex_clear (&rd.lock);
+	g_cond_clear (&rd.cond);
+
+	/* and when the write transaction is finished */
+	test_search (fixture, "(uid? \"event-6\")", "event-6");
+}
+
+static void
+test_search_components_cache (TCUFixture *fixture,
+			      gconstpointer user_data)
+{
+	const gchar *expr = "(occur-in-time-range? (make-time \"20170209T000000Z\") (make-time \"20170210T000000Z\"))";
+	ECalComponent *comp;
+	ICalTime *itt;
+	GSList *components = NULL, *link;
+	guint64 hits = 0, misses = 0, hits2 = 0, misses2 = 0;
+	time_t range_start, range_end;
+	gboolean found = FALSE;
+	GError *error = NULL;
+
+	g_assert_cmpuint (e_cal_cache_get_components_cache_size (fixture->cal_cache), >, 0);
+
+	test_search (fixture, expr, "event-1");
+
+	e_cal_cache_get_components_cache_stats (fixture->cal_cache, &hits, &misses);
+	g_assert_cmpuint (misses, >, 0);
+
+	/* the components are not parsed again */
+	test_search (fixture, expr, "event-1");
+
+	e_cal_cache_get_components_cache_stats (fixture->cal_cache, &hits2, &misses2);
+	g_assert_cmpuint (hits2, >, hits);
+
+	/* a changed component is not returned from the cache */
+	comp = tcu_new_component_from_test_case ("event-1");
+	i_cal_component_set_summary (e_cal_component_get_icalcomponent (comp), "Changed summary");
+
+	g_assert_true (e_cal_cache_put_component (fixture->cal_cache, comp, NULL, 0, E_CACHE_IS_ONLINE, NULL, &error));
+	g_assert_no_error (error);
+
+	g_object_unref (comp);
+
+	itt = i_cal_time_new_from_string ("20170209T000000Z");
+	range_start = i_cal_time_as_timet (itt);
+	g_object_unref (itt);
+
+	itt = i_cal_time_new_from_string ("20170210T000000Z");
+	range_end = i_cal_time_as_timet (itt);
+	g_object_unref (itt);
+
+	g_assert_true (e_cal_cache_get_components_in_range (fixture->cal_cache, range_start, range_end, &components, NULL, &error));
+	g_assert_no_error (error);
+
+	for (link = components; link; link = g_slist_next (link)) {
+		comp = link->data;
+
+		if (g_strcmp0 (e_cal_component_get_uid (comp), "event-1") == 0) {
+			g_assert_cmpstr (i_cal_component_get_summary (e_cal_component_get_icalcomponent (comp)), ==, "Changed summary");
+			found = TRUE;
+		}
+	}
+
+	g_assert_true (found);
+
+	g_slist_free_full (components, g_object_unref);
+
+	test_search (fixture, expr, "event-1");
+
+	/* nothing is cached when disabled */
+	e_cal_cache_set_components_cache_size (fixture->cal_cache, 0);
+	g_assert_cmpuint (e_cal_cache_get_components_cache_size (fixture->cal_cache), ==, 0);
+
+	e_cal_cache_get_components_cache_stats (fixture->cal_cache, &hits, NULL);
+
+	test_search (fixture, expr, "event-1");
+
+	e_cal_cache_get_components_cache_stats (fixture->cal_cache, &hits2, NULL);
+	g_assert_cmpuint (hits2, ==, hits);
+}
+
+static void
+test_search_components_cache_collision (TCUFixture *fixture,
+					gconstpointer user_data)
+{
+	const gchar *expr = "(occur-in-time-range? (make-time \"20170209T000000Z\") (make-time \"20170210T000000Z\"))";
+	ECalComponent *comp;
+	ICalTime *itt;
+	GSList *components = NULL, *link;
+	time_t range_start, range_end;
+	gboolean found = FALSE;
+	GError *error = NULL;
+
+	/* the "ar" and "bQ" give the same g_str_hash(), thus the changed
+	   string has the same hash and length as the cached one */
+	g_assert_cmpuint (g_str_hash ("SUMMARY:Alarmed"), ==, g_str_hash ("SUMMARY:AlbQmed"));
+
+	test_search (fixture, expr, "event-1");
+
+	/* changed behind the cache's back, like by another process */
+	g_assert_true (e_cache_sqlite_exec (E_CACHE (fixture->cal_cache),
+		"UPDATE " E_CACHE_TABLE_OBJECTS
+		" SET " E_CACHE_COLUMN_OBJECT "=replace(" E_CACHE_COLUMN_OBJECT ",'SUMMARY:Alarmed','SUMMARY:AlbQmed')"
+		" WHERE " E_CACHE_COLUMN_UID "='event-1'",
+		NULL, &error));
+	g_assert_no_error (error);
+
+	itt = i_cal_time_new_from_string ("20170209T000000Z");
+	range_start = i_cal_time_as_timet (itt);
+	g_object_unref (itt);
+
+	itt = i_cal_time_new_from_string ("20170210T000000Z");
+	range_end = i_cal_time_as_timet (itt);
+	g_object_unref (itt);
+
+	g_assert_true (e_cal_cache_get_components_in_range (fixture->cal_cache, range_start, range_end, &components, NULL, &error));
+	g_assert_no_error (error);
+
+	for (link = components; link; link = g_slist_next (link)) {
+		comp = link->data;
+
+		if (g_strcmp0 (e_cal_component_get_uid (comp), "event-1") == 0) {
+			g_assert_cmpstr (i_cal_component_get_summary (e_cal_component_get_icalcomponent (comp)), ==, "AlbQmed");
+			found = TRUE;
+		}
+	}
+
+	g_assert_true (found);
+
+	g_slist_free_full (components, g_object_unref);
+}
+
+static void
+test_search_occurrences_put_zone (TCUFixture *fixture,
+				  const gchar *offset)
+{
+	ICalComponent *icomp;
+	ICalTimezone *zone;
+	gchar *str;
+	GError *error = NULL;
+
+	str = g_strdup_printf (
+		"BEGIN:VTIMEZONE\r\n"
+		"TZID:Test/Occurrences\r\n"
+		"BEGIN:STANDARD\r\n"
+		"DTSTART:19700101T000000\r\n"
+		"TZOFFSETFROM:%s\r\n"
+		"TZOFFSETTO:%s\r\n"
+		"END:STANDARD\r\n"
+		"END:VTIMEZONE\r\n",
+		offset, offset);
+
+	icomp = i_cal_component_new_from_string (str);
+	g_assert_nonnull (icomp);
+
+	zone = i_cal_timezone_new ();
+	g_assert_true (i_cal_timezone_set_component (zone, icomp));
+
+	g_assert_true (e_cal_cache_put_timezone (fixture->cal_cache, zone, 0, NULL, &error));
+	g_assert_no_error (error);
+
+	g_object_unref (zone);
+	g_object_unref (icomp);
+	g_free (str);
+}
+
+static void
+test_search_occurrences (TCUFixture *fixture,
+			 gconstpointer user_data)
+{
+	ECalComponent *comp;
+	GError *error = NULL;
+
+	test_search_occurrences_put_zone (fixture, "+0100");
+
+	comp = e_cal_component_new_from_string (
+		"BEGIN:VEVENT\r\n"
+		"UID:weekly\r\n"
+		"DTSTAMP:20170101T000000Z\r\n"
+		"DTSTART;TZID=Test/Occurrences:20170102T100000\r\n"
+		"DTEND;TZID=Test/Occurrences:20170102T110000\r\n"
+		"RRULE:FREQ=WEEKLY;COUNT=100\r\n"
+		"SUMMARY:Weekly\r\n"
+		"END:VEVENT\r\n");
+	g_assert_nonnull (comp);
+
+	g_assert_true (e_cal_cache_put_component (fixture->cal_cache, comp, NULL, 0, E_CACHE_IS_ONLINE, NULL, &error));
+	g_assert_no_error (error);
+
+	g_object_unref (comp);
+
+	test_search (fixture, "(occur-in-time-range? (make-time \"20170306T090000Z\") (make-time \"20170306T093000Z\"))", "weekly");
+	test_search (fixture, "(occur-in-time-range? (make-time \"20170307T090000Z\") (make-time \"20170307T093000Z\"))", "!weekly");
+	test_search (fixture, "(occur-in-time-range? (make-time \"20170306T090000Z\") (make-time \"20170306T093000Z\") \"Europe/Berlin\")", "weekly");
+	test_search (fixture, "(and (occur-in-time-range? (make-time \"20170306T000000Z\") (make-time \"20170307T000000Z\")) (contains? \"summary\" \"weekly\"))", "weekly");
+
+	/* the instances follow the changed time zone */
+	test_search_occurrences_put_zone (fixture, "+0300");
+
+	test_search (fixture, "(occur-in-time-range? (make-time \"20170306T070000Z\") (make-time \"20170306T073000Z\"))", "weekly");
+	test_search (fixture, "(occur-in-time-range? (make-time \"20170306T090000Z\") (make-time \"20170306T093000Z\"))", "!weekly");
+
+	/* and are removed with the component */
+	g_assert_true (e_cal_cache_remove_component (fixture->cal_cache, "weekly", NULL, 0, E_CACHE_IS_ONLINE, NULL, &error));
+	g_assert_no_error (error);
+
+	test_search (fixture, "(occur-in-time-range? (make-time \"20170306T070000Z\") (make-time \"20170306T073000Z\"))", "!weekly");
+
+	/* too far to be covered by the occurrences */
+	test_search (fixture, "(occur-in-time-range? (make-time \"19000101T000000Z\") (make-time \"20300101T000000Z\"))", "event-1");
+}
+
+static gint64
+test_search_occurrences_get_key (ECache *cache,
+				 const gchar *key)
+{
+	gchar *value;
+	gint64 res;
+
+	value = e_cache_dup_key (cache, key, NULL);
+	g_assert_nonnull (value);
+
+	res = g_ascii_strtoll (value, NULL, 10);
+
+	g_free (value);
+
+	return res;
+}
+
+static void
+test_search_occurrences_set_key (ECache *cache,
+				 const gchar *key,
+				 gint64 value)
+{
+	GError *error = NULL;
+	gchar *str;
+
+	str = g_strdup_printf ("%" G_GINT64_FORMAT, value);
+	g_assert_true (e_cache_set_key (cache, key, str, &error));
+	g_assert_no_error (error);
+	g_free (str);
+}
+
+static gboolean
+test_search_occurrences_get_count_cb (ECache *cache,
+				      gint ncols,
+				      const gchar **column_names,
+				      const gchar **column_values,
+				      gpointer user_data)
+{
+	guint *pcount = user_data;
+
+	g_return_val_if_fail (ncols == 1, FALSE);
+
+	*pcount = column_values[0] ? (guint) g_ascii_strtoull (column_values[0], NULL, 10) : 0;
+
+	return FALSE;
+}
+
+static guint
+test_search_occurrences_count_rows (ECache *cache,
+				    const gchar *uid)
+{
+	GError *error = NULL;
+	guint count = 0;
+
+	g_assert_true (e_cache_sqlite_exec_printf (cache,
+		"SELECT COUNT(*) FROM occurrences WHERE uid=%Q",
+		test_search_occurrences_get_count_cb, &count, NULL, &error, uid));
+	g_assert_no_error (error);
+
+	return count;
+}
+
+static void
+test_search_occurrences_roll (TCUFixture *fixture,
+			      gconstpointer user_data)
+{
+	ECache *cache = E_CACHE (fixture->cal_cache);
+	ECalCache *reopened;
+	const gint64 day = 24 * 60 * 60;
+	gint64 now, start, end, old_start;
+	gchar *stmt;
+	GError *error = NULL;
+
+	now = (gint64) time (NULL);
+	old_start = now - 5 * 366 * day;
+
+	/* a horizon extended to the past by a search, long ago */
+	test_search_occurrences_set_key (cache, "occurrences_start", old_start);
+	test_search_occurrences_set_key (cache, "occurrences_end", now + 2 * 366 * day);
+
+	stmt = g_strdup_printf ("INSERT INTO occurrences (uid,instance_start,instance_end,kind,is_long)"
+		" VALUES ('old-instance',%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT ",0,0)",
+		old_start + day, old_start + 2 * day);
+	g_assert_true (e_cache_sqlite_exec (cache, stmt, NULL, &error));
+	g_assert_no_error (error);
+	g_free (stmt);
+
+	g_assert_cmpuint (test_search_occurrences_count_rows (cache, "old-instance"), ==, 1);
+
+	/* the start of the horizon is rolled forward on open,
+	   and the instances before it are removed */
+	reopened = e_cal_cache_new (e_cache_get_filename (cache), NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (reopened);
+
+	start = test_search_occurrences_get_key (E_CACHE (reopened), "occurrences_start");
+	end = test_search_occurrences_get_key (E_CACHE (reopened), "occurrences_end");
+
+	g_assert_cmpint (start, >=, now - 367 * day);
+	g_assert_cmpint (start, <=, now - 365 * day);
+	g_assert_cmpint (end, ==, now + 2 * 366 * day);
+	g_assert_cmpuint (test_search_occurrences_count_rows (E_CACHE (reopened), "old-instance"), ==, 0);
+
+	g_object_unref (reopened);
+
+	/* the horizon is not changed when it's off by less than a step */
+	test_search_occurrences_set_key (cache, "occurrences_start", start - 7 * day);
+	test_search_occurrences_set_key (cache, "occurrences_end", end - 7 * day);
+
+	reopened = e_cal_cache_new (e_cache_get_filename (cache), NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (reopened);
+
+	g_assert_cmpint (test_search_occurrences_get_key (E_CACHE (reopened), "occurrences_start"), ==, start - 7 * day);
+	g_assert_cmpint (test_search_occurrences_get_key (E_CACHE (reopened), "occurrences_end"), ==, end - 7 * day);
+
+	g_object_unref (reopened);
+
+	/* the end is extended, when the current time passes it by a step */
+	test_search_occurrences_set_key (cache, "occurrences_end", now + 300 * day);
+
+	reopened = e_cal_cache_new (e_cache_get_filename (cache), NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (reopened);
+
+	g_assert_cmpint (test_search_occurrences_get_key (E_CACHE (reopened), "occurrences_end"), >=, now + 2 * 366 * day);
+
+	g_object_unref (reopened);
+}
+
 gint
 main (gint argc,
       gchar **argv)
@@ -533,6 +956,16 @@ main (gint argc,
 		tcu_fixture_setup, test_search_complex, tcu_fixture_teardown);
 	g_test_add ("/ECalCache/Search/StartsBefore", TCUFixture, &closure_tasks,
 		tcu_fixture_setup, test_search_starts_before, tcu_fixture_teardown);
+	g_test_add ("/ECalCache/Search/Readers", TCUFixture, &closure_events,
+		tcu_fixture_setup, test_search_readers, tcu_fixture_teardown);
+	g_test_add ("/ECalCache/Search/ComponentsCache", TCUFixture, &closure_events,
+		tcu_fixture_setup, test_search_components_cache, tcu_fixture_teardown);
+	g_test_add ("/ECalCache/Search/ComponentsCacheCollision", TCUFixture, &closure_events,
+		tcu_fixture_setup, test_search_components_cache_collision, tcu_fixture_teardown);
+	g_test_add ("/ECalCache/Search/Occurrences", TCUFixture, &closure_events,
+		tcu_fixture_setup, test_search_occurrences, tcu_fixture_teardown);
+	g_test_add ("/ECalCache/Search/OccurrencesRoll", TCUFixture, &closure_events,
+		tcu_fixture_setup, test_search_occurrences_roll, tcu_fixture_teardown);
 
 	return e_test_server_utils_run_full (argc, argv, 0);
 }